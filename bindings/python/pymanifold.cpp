@@ -12,6 +12,11 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+
 #include "manifold.h"
 #include "pybind11/functional.h"
 #include "pybind11/numpy.h"
@@ -30,12 +35,82 @@ struct PolygonsWrapper {
   std::unique_ptr<Polygons> polygons;
 };
 
+// Taken as C-contiguous arrays of T, so numpy only converts arrays that are
+// not already.
+template <typename T>
+using Array = py::array_t<T, py::array::c_style | py::array::forcecast>;
+
+// Copies an (n, width) array into n glm vectors with a single memcpy. Empty
+// arrays of any shape give an empty vector.
+template <typename Vec, typename T>
+std::vector<Vec> ToVec(const Array<T> &array, const char *name) {
+  constexpr int width = sizeof(Vec) / sizeof(T);
+  if (array.size() == 0) return {};
+  if (array.ndim() != 2 || array.shape(1) != width)
+    throw std::runtime_error(std::string("Invalid ") + name + " shape");
+  std::vector<Vec> vec(array.shape(0));
+  std::memcpy(vec.data(), array.data(), array.nbytes());
+  return vec;
+}
+
+// An (n, width) view of the glm vectors of an object owned by base, which the
+// view keeps alive.
+template <typename T, typename Vec>
+py::array_t<T> ToArray(const std::vector<Vec> &vec, py::handle base) {
+  constexpr int width = sizeof(Vec) / sizeof(T);
+  return py::array_t<T>({static_cast<py::ssize_t>(vec.size()),
+                         static_cast<py::ssize_t>(width)},
+                        reinterpret_cast<const T *>(vec.data()), base);
+}
+
+// Evaluates the meshes on a pool of threads, with the GIL released by the
+// caller.
+std::vector<Mesh> BatchToMesh(const std::vector<Manifold> &manifolds,
+                              int numThreads) {
+  const int size = manifolds.size();
+  if (numThreads <= 0) numThreads = std::thread::hardware_concurrency();
+  numThreads = std::max(1, std::min(numThreads, size));
+  std::vector<Mesh> meshes(size);
+  std::atomic<int> next(0);
+  auto work = [&]() {
+    for (int i = next++; i < size; i = next++)
+      meshes[i] = manifolds[i].GetMesh();
+  };
+  std::vector<std::thread> pool;
+  for (int i = 1; i < numThreads; ++i) pool.emplace_back(work);
+  work();
+  for (std::thread &thread : pool) thread.join();
+  return meshes;
+}
+
 PYBIND11_MODULE(pymanifold, m) {
   m.doc() =
       "Python binding for the manifold library. Please check the C++ "
       "documentation for APIs.\n"
       "This binding will perform copying to make the API more familiar to "
       "OpenSCAD users.";
+
+  py::enum_<Manifold::OpType>(m, "OpType")
+      .value("ADD", Manifold::OpType::ADD)
+      .value("SUBTRACT", Manifold::OpType::SUBTRACT)
+      .value("INTERSECT", Manifold::OpType::INTERSECT);
+
+  m.def("batch_to_mesh", &BatchToMesh, py::arg("manifolds"),
+        py::arg("num_threads") = 0,
+        py::call_guard<py::gil_scoped_release>(),
+        "Evaluate independent manifolds concurrently on a pool of threads, "
+        "without holding the GIL, and return their meshes in order.\n"
+        "\n"
+        ":param manifolds: The manifolds to evaluate. Unevaluated results "
+        "that share operands must not be evaluated concurrently, so evaluate "
+        "any shared operand first, e.g. with to_mesh().\n"
+        ":param num_threads: Number of threads, by default one per core.");
+  // The methods that build or evaluate the lazy CSG tree keep the GIL: a
+  // tree's nodes are shared between the manifolds built from them and are
+  // evaluated in place, so two Python threads working on manifolds with a
+  // common operand would race. Only computations on fresh inputs, such as
+  // from_mesh and smooth, release it, while batch_to_mesh documents what it
+  // requires of its inputs.
   py::class_<Manifold>(m, "Manifold")
       .def(py::init<>())
       .def(py::init([](std::vector<Manifold> &manifolds) {
@@ -47,6 +122,14 @@ PYBIND11_MODULE(pymanifold, m) {
       .def(py::self + py::self, "Boolean union.")
       .def(py::self - py::self, "Boolean difference.")
       .def(py::self ^ py::self, "Boolean intersection.")
+      .def_static(
+          "batch_boolean",
+          [](const std::vector<Manifold> &manifolds, Manifold::OpType op) {
+            return Manifold::BatchBoolean(manifolds, op);
+          },
+          py::arg("manifolds"), py::arg("op"),
+          "Combine all the manifolds with the same operation, in the order "
+          "that minimizes the work.")
       .def(
           "transform",
           [](Manifold self, py::array_t<float> &mat) {
@@ -196,7 +279,51 @@ PYBIND11_MODULE(pymanifold, m) {
           ":param n: The number of pieces to split every edge into. Must be > "
           "1.")
       .def("to_mesh", &Manifold::GetMesh)
+      .def(
+          "to_mesh_gl",
+          [](Manifold &self, const std::string &normals, bool index16) {
+            MeshGLLayout layout;
+            if (normals == "none")
+              layout.normal = MeshGLLayout::Normal::NONE;
+            else if (normals == "snorm16")
+              layout.normal = MeshGLLayout::Normal::SNORM16;
+            else if (normals != "float")
+              throw std::runtime_error("Invalid normals: " + normals);
+            layout.index16 = index16;
+            const int numVert = self.NumVert();
+            const int numTri = self.NumTri();
+            const int stride = layout.VertStride();
+
+            // The arrays are written in place, without intermediate copies.
+            py::array verts =
+                layout.normal == MeshGLLayout::Normal::SNORM16
+                    ? py::array(py::dtype::of<uint8_t>(),
+                                std::vector<py::ssize_t>({numVert, stride}))
+                    : py::array(py::dtype::of<float>(),
+                                std::vector<py::ssize_t>(
+                                    {numVert, stride / int(sizeof(float))}));
+            py::array indices =
+                layout.IndexSize(numVert) == 2
+                    ? py::array(py::dtype::of<uint16_t>(),
+                                std::vector<py::ssize_t>({numTri, 3}))
+                    : py::array(py::dtype::of<uint32_t>(),
+                                std::vector<py::ssize_t>({numTri, 3}));
+            self.WriteMeshGL(layout, verts.mutable_data(),
+                             indices.mutable_data());
+            return py::make_tuple(verts, indices);
+          },
+          py::arg("normals") = "float", py::arg("index16") = true,
+          "Write the mesh into GPU-ready buffers, as a tuple of a vertex "
+          "array and an index array.\n"
+          "\n"
+          ":param normals: 'float' to follow each position with its normal "
+          "as three floats, 'snorm16' for four normalized int16s, the last "
+          "zero, in which case the vertex array is raw bytes, or 'none' for "
+          "positions only.\n"
+          ":param index16: Whether to return uint16 indices when the vertex "
+          "count allows, rather than uint32.")
       .def_static("smooth", Manifold::Smooth,
+                  py::call_guard<py::gil_scoped_release>(),
 
                   "Constructs a smooth version of the input mesh by creating "
                   "tangents; this\n"
@@ -245,7 +372,7 @@ PYBIND11_MODULE(pymanifold, m) {
                   "cones to be formed.")
       .def_static(
           "from_mesh", [](const Mesh &mesh) { return Manifold(mesh); },
-          py::arg("mesh"))
+          py::arg("mesh"), py::call_guard<py::gil_scoped_release>())
       .def_static(
           "tetrahedron", []() { return Manifold::Tetrahedron(); },
           "Constructs a tetrahedron centered at the origin with one vertex at "
@@ -407,98 +534,47 @@ PYBIND11_MODULE(pymanifold, m) {
           "calculated by the static Defaults.");
 
   py::class_<Mesh>(m, "Mesh")
-      .def(py::init([](py::array_t<float> &vertPos, py::array_t<int> &triVerts,
-                       py::array_t<float> &vertNormal,
-                       py::array_t<float> &halfedgeTangent) {
-             auto vertPos_view = vertPos.unchecked<2>();
-             auto triVerts_view = triVerts.unchecked<2>();
-             auto vertNormal_view = vertNormal.unchecked<2>();
-             auto halfedgeTangent_view = halfedgeTangent.unchecked<2>();
-             if (vertPos_view.shape(1) != 3)
-               throw std::runtime_error("Invalid vert_pos shape");
-             if (triVerts_view.shape(1) != 3)
-               throw std::runtime_error("Invalid tri_verts shape");
-             if (vertNormal_view.shape(0) != 0) {
-               if (vertNormal_view.shape(1) != 3)
-                 throw std::runtime_error("Invalid vert_normal shape");
-               if (vertNormal_view.shape(0) != vertPos_view.shape(0))
-                 throw std::runtime_error(
-                     "vert_normal must have the same length as vert_pos");
-             }
-             if (halfedgeTangent_view.shape(0) != 0) {
-               if (halfedgeTangent_view.shape(1) != 4)
-                 throw std::runtime_error("Invalid halfedge_tangent shape");
-               if (halfedgeTangent_view.shape(0) != triVerts_view.shape(0) * 3)
-                 throw std::runtime_error(
-                     "halfedge_tangent must be three times as long as "
-                     "tri_verts");
-             }
-             std::vector<glm::vec3> vertPos_vec(vertPos_view.shape(0));
-             std::vector<glm::ivec3> triVerts_vec(triVerts_view.shape(0));
-             std::vector<glm::vec3> vertNormal_vec(vertNormal_view.shape(0));
-             std::vector<glm::vec4> halfedgeTangent_vec(
-                 halfedgeTangent_view.shape(0));
-             for (int i = 0; i < vertPos_view.shape(0); i++)
-               for (const int j : {0, 1, 2})
-                 vertPos_vec[i][j] = vertPos_view(i, j);
-             for (int i = 0; i < triVerts_view.shape(0); i++)
-               for (const int j : {0, 1, 2})
-                 triVerts_vec[i][j] = triVerts_view(i, j);
-             for (int i = 0; i < vertNormal_view.shape(0); i++)
-               for (const int j : {0, 1, 2})
-                 vertNormal_vec[i][j] = vertNormal_view(i, j);
-             for (int i = 0; i < halfedgeTangent_view.shape(0); i++)
-               for (const int j : {0, 1, 2, 3})
-                 halfedgeTangent_vec[i][j] = halfedgeTangent_view(i, j);
-             return Mesh({vertPos_vec, triVerts_vec, vertNormal_vec,
-                          halfedgeTangent_vec});
+      .def(py::init([](const Array<float> &vertPos, const Array<int> &triVerts,
+                       const Array<float> &vertNormal,
+                       const Array<float> &halfedgeTangent) {
+             Mesh mesh;
+             mesh.vertPos = ToVec<glm::vec3>(vertPos, "vert_pos");
+             mesh.triVerts = ToVec<glm::ivec3>(triVerts, "tri_verts");
+             mesh.vertNormal = ToVec<glm::vec3>(vertNormal, "vert_normal");
+             mesh.halfedgeTangent =
+                 ToVec<glm::vec4>(halfedgeTangent, "halfedge_tangent");
+             if (!mesh.vertNormal.empty() &&
+                 mesh.vertNormal.size() != mesh.vertPos.size())
+               throw std::runtime_error(
+                   "vert_normal must have the same length as vert_pos");
+             if (!mesh.halfedgeTangent.empty() &&
+                 mesh.halfedgeTangent.size() != mesh.triVerts.size() * 3)
+               throw std::runtime_error(
+                   "halfedge_tangent must be three times as long as "
+                   "tri_verts");
+             return mesh;
            }),
            py::arg("vert_pos"), py::arg("tri_verts"), py::arg("vert_normal"),
-           py::arg("halfedge_tangent"))
+           py::arg("halfedge_tangent"),
+           "Construct a Mesh from C-contiguous arrays, each copied with a "
+           "single memcpy; others are converted first.")
+      // These are views of the Mesh, which they keep alive, not copies.
       .def_property_readonly("vert_pos",
-                             [](Mesh &self) {
-                               const int numVert = self.vertPos.size();
-                               py::array_t<float> vert_pos({numVert, 3});
-                               auto vert_pos_view =
-                                   vert_pos.mutable_unchecked<2>();
-
-                               for (int i = 0; i < numVert; ++i)
-                                 for (const int j : {0, 1, 2})
-                                   vert_pos_view(i, j) = self.vertPos[i][j];
-                               return vert_pos;
+                             [](py::object self) {
+                               return ToArray<float>(
+                                   self.cast<Mesh &>().vertPos, self);
                              })
       .def_property_readonly("tri_verts",
-                             [](Mesh &self) {
-                               const int numTri = self.triVerts.size();
-                               py::array_t<int> tri_verts({numTri, 3});
-                               auto tri_verts_view =
-                                   tri_verts.mutable_unchecked<2>();
-
-                               for (int i = 0; i < numTri; ++i)
-                                 for (const int j : {0, 1, 2})
-                                   tri_verts_view(i, j) = self.triVerts[i][j];
-                               return tri_verts;
+                             [](py::object self) {
+                               return ToArray<int>(
+                                   self.cast<Mesh &>().triVerts, self);
                              })
-      .def_property_readonly(
-          "vert_normal",
-          [](Mesh &self) {
-            const int numVert = self.vertNormal.size();
-            py::array_t<float> vert_normal({numVert, 3});
-            auto vert_normal_view = vert_normal.mutable_unchecked<2>();
-
-            for (int i = 0; i < numVert; ++i)
-              for (const int j : {0, 1, 2})
-                vert_normal_view(i, j) = self.vertNormal[i][j];
-            return vert_normal;
-          })
-      .def_property_readonly("halfedge_tangent", [](Mesh &self) {
-        const int numEdge = self.halfedgeTangent.size();
-        py::array_t<float> halfedge_tangent({numEdge, 4});
-        auto halfedge_tangent_view = halfedge_tangent.mutable_unchecked<2>();
-
-        for (int i = 0; i < numEdge; ++i)
-          for (const int j : {0, 1, 2, 3})
-            halfedge_tangent_view(i, j) = self.halfedgeTangent[i][j];
-        return halfedge_tangent;
+      .def_property_readonly("vert_normal",
+                             [](py::object self) {
+                               return ToArray<float>(
+                                   self.cast<Mesh &>().vertNormal, self);
+                             })
+      .def_property_readonly("halfedge_tangent", [](py::object self) {
+        return ToArray<float>(self.cast<Mesh &>().halfedgeTangent, self);
       });
 }
@@ -77,6 +77,42 @@ val GetMeshJS(const Manifold& manifold) {
   return meshJS;
 }
 
+val GetMeshGLLodsJS(const Manifold& manifold,
+                    const std::vector<float>& tolerances) {
+  MeshGLLods lods = manifold.GetMeshGLLods(tolerances);
+  val lodsJS = val::object();
+
+  lodsJS.set("vertPos", val(typed_memory_view(lods.mesh.vertPos.size(),
+                                              lods.mesh.vertPos.data()))
+                            .call<val>("slice"));
+  lodsJS.set("vertNormal", val(typed_memory_view(lods.mesh.vertNormal.size(),
+                                                 lods.mesh.vertNormal.data()))
+                               .call<val>("slice"));
+  lodsJS.set("triVerts", val(typed_memory_view(lods.mesh.triVerts.size(),
+                                               lods.mesh.triVerts.data()))
+                             .call<val>("slice"));
+  lodsJS.set("tolerance", val(typed_memory_view(lods.tolerance.size(),
+                                                lods.tolerance.data()))
+                              .call<val>("slice"));
+  lodsJS.set("numVert", val(typed_memory_view(lods.numVert.size(),
+                                              lods.numVert.data()))
+                            .call<val>("slice"));
+  lodsJS.set("triStart", val(typed_memory_view(lods.triStart.size(),
+                                               lods.triStart.data()))
+                             .call<val>("slice"));
+
+  return lodsJS;
+}
+
+void WriteMeshGLJS(const Manifold& manifold, int normal, bool index16,
+                   uintptr_t vertBuffer, uintptr_t indexBuffer) {
+  MeshGLLayout layout;
+  layout.normal = static_cast<MeshGLLayout::Normal>(normal);
+  layout.index16 = index16;
+  manifold.WriteMeshGL(layout, reinterpret_cast<void*>(vertBuffer),
+                       reinterpret_cast<void*>(indexBuffer));
+}
+
 MeshGL MeshJS2GL(const val& mesh) {
   MeshGL out;
   out.triVerts = convertJSArrayToNumberVector<uint32_t>(mesh["triVerts"]);
@@ -161,7 +197,8 @@ EMSCRIPTEN_BINDINGS(whatever) {
       .value("TRI_PROPERTIES_WRONG_LENGTH",
              Manifold::Error::TRI_PROPERTIES_WRONG_LENGTH)
       .value("TRI_PROPERTIES_OUT_OF_BOUNDS",
-             Manifold::Error::TRI_PROPERTIES_OUT_OF_BOUNDS);
+             Manifold::Error::TRI_PROPERTIES_OUT_OF_BOUNDS)
+      .value("INVALID_SERIALIZATION", Manifold::Error::INVALID_SERIALIZATION);
 
   value_object<Box>("box").field("min", &Box::min).field("max", &Box::max);
 
@@ -207,6 +244,8 @@ EMSCRIPTEN_BINDINGS(whatever) {
       .function("subtract", &Difference)
       .function("intersect", &Intersection)
       .function("_GetMeshJS", &GetMeshJS)
+      .function("_WriteMeshGL", &WriteMeshGLJS)
+      .function("_GetMeshGLLods", &GetMeshGLLodsJS)
       .function("refine", &Manifold::Refine)
       .function("_Warp", &Warp)
       .function("_Transform", &Transform)
@@ -242,6 +281,9 @@ EMSCRIPTEN_BINDINGS(whatever) {
   function("_intersectionN", &IntersectionN);
   function("_Compose", &Manifold::Compose);
 
+  function("setMaxThreads", &SetMaxThreads);
+  function("maxThreads", &MaxThreads);
+
   function("setMinCircularAngle", &Manifold::SetMinCircularAngle);
   function("setMinCircularEdgeLength", &Manifold::SetMinCircularEdgeLength);
   function("setCircularSegments", &Manifold::SetCircularSegments);
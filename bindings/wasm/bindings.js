@@ -165,6 +165,40 @@ Module.setup = function() {
     return new Mesh(this._GetMeshJS());
   };
 
+  const meshGLNormal = {none: 0, float: 1, snorm16: 2};
+
+  // Writes straight into the wasm heap, returning views that must be used
+  // before anything else allocates, and then freed.
+  Module.Manifold.prototype.getMeshGL = function(
+      {normals = 'float', index16 = true} = {}) {
+    const normal = meshGLNormal[normals];
+    console.assert(
+        normal !== undefined, 'normals must be none, float or snorm16');
+    const numVert = this.numVert();
+    const numTri = this.numTri();
+    const stride = 12 + [0, 12, 8][normal];
+    const indexSize = index16 && numVert <= 65536 ? 2 : 4;
+    const vertBytes = numVert * stride;
+    const ptr = _malloc(vertBytes + 3 * numTri * indexSize);
+    this._WriteMeshGL(normal, index16, ptr, ptr + vertBytes);
+    const IndexArray = indexSize == 2 ? Uint16Array : Uint32Array;
+    return {
+      stride,
+      vertices: normal == meshGLNormal.snorm16 ?
+          new Uint8Array(HEAPU8.buffer, ptr, vertBytes) :
+          new Float32Array(HEAPU8.buffer, ptr, vertBytes / 4),
+      indices: new IndexArray(HEAPU8.buffer, ptr + vertBytes, 3 * numTri),
+      free: () => _free(ptr)
+    };
+  };
+
+  Module.Manifold.prototype.getMeshGLLods = function(tolerances) {
+    const vec = toVec(new Module.Vector_f32(), tolerances);
+    const result = this._GetMeshGLLods(vec);
+    vec.delete();
+    return result;
+  };
+
   Module.Manifold.prototype.getMeshRelation = function() {
     const result = this._getMeshRelation();
     const oldBarycentric = result.barycentric;
@@ -214,6 +248,9 @@ Module.setup = function() {
         break;
       case Module.status.TRI_PROPERTIES_OUT_OF_BOUNDS.value:
         message = 'Tri properties out of bounds';
+        break;
+      case Module.status.INVALID_SERIALIZATION.value:
+        message = 'Invalid serialization';
     }
 
     const base = Error.apply(this, [message, ...args]);
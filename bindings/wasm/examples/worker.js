@@ -12,9 +12,17 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+// The multithreaded module needs SharedArrayBuffer, so it is only used on
+// cross-origin isolated pages, and only where it has been built.
+try {
+  if (!self.crossOriginIsolated) throw new Error('not cross-origin isolated');
+  importScripts('manifold-threads.js');
+} catch (e) {
+  importScripts('manifold.js');
+}
 const threePath = 'https://cdn.jsdelivr.net/npm/three@0.144.0/';
 importScripts(
-    'manifold.js', threePath + 'build/three.js',
+    threePath + 'build/three.js',
     threePath + 'examples/js/exporters/GLTFExporter.js');
 
 // manifold member functions that returns a new manifold
@@ -29,7 +37,7 @@ const constructors = [
 ];
 const utils = [
   'setMinCircularAngle', 'setMinCircularEdgeLength', 'setCircularSegments',
-  'getCircularSegments', 'Mesh'
+  'getCircularSegments', 'setMaxThreads', 'maxThreads', 'Mesh'
 ];
 const exposedFunctions = constructors.concat(utils);
 
@@ -49,6 +49,22 @@ type MeshRelation = {
   triBary: BaryRef[],
 };
 
+declare interface MeshGL {
+  stride: number;
+  vertices: Float32Array|Uint8Array;
+  indices: Uint16Array|Uint32Array;
+  free(): void;
+}
+
+declare interface MeshGLLods {
+  vertPos: Float32Array;
+  vertNormal: Float32Array;
+  triVerts: Uint32Array;
+  tolerance: Float32Array;
+  numVert: Int32Array;
+  triStart: Int32Array;
+}
+
 declare class Mesh {
   vertPos: Float32Array;
   triVerts: Uint32Array;
@@ -217,6 +233,33 @@ declare class Manifold {
    */
   getMesh(): Mesh;
 
+  /**
+   * Writes the mesh straight into the wasm heap, in parallel, in a layout
+   * ready to upload to the GPU, and returns views of it without copying. The
+   * views are invalidated by anything that grows the heap, so upload them
+   * right away, and then call free().
+   *
+   * @param normals 'float' to follow each position with its normal as three
+   * floats, 'snorm16' for four normalized int16s, the last zero, in which case
+   * the vertices are returned as bytes, or 'none' for positions only.
+   * @param index16 Whether to return 16-bit indices when the vertex count
+   * allows.
+   */
+  getMeshGL(options?: {normals?: 'none'|'float'|'snorm16', index16?: boolean}):
+      MeshGL;
+
+  /**
+   * Simplifies the mesh to each tolerance and returns the nested levels of
+   * detail, coarsest first, sharing one vertex buffer. The verts are ordered
+   * so that level i uses only the first numVert[i] of them, and its triangles
+   * are triVerts from triStart[i] up to triStart[i + 1], so the coarse level
+   * can be rendered while the finer ones stream in.
+   *
+   * @param tolerances The maximum distance the surface may move for each
+   * level, in any order. A tolerance of zero gives the full mesh.
+   */
+  getMeshGLLods(tolerances: number[]): MeshGLLods;
+
   /**
    * Gets the relationship to the previous meshes, for the purpose of assigning
    * properties like texture coordinates. The triBary vector is the same length
@@ -419,6 +462,14 @@ declare function setCircularSegments(segments: number): void;
 declare function getCircularSegments(radius: number): number;
 ///@}
 
+/**
+ * Limits the number of threads used by the multithreaded module, which by
+ * default uses one per core; zero restores the default. The single-threaded
+ * module, loaded where the page is not cross-origin isolated, ignores this.
+ */
+declare function setMaxThreads(numThreads: number): void;
+declare function maxThreads(): number;
+
 /**
  * Create a Manifold from a serialized Mesh object (MeshVec). Unlike the
  * constructor, this method does not dispose the Mesh after using it.
@@ -444,6 +495,8 @@ declare interface ManifoldStatic {
   setMinCircularEdgeLength: typeof setMinCircularEdgeLength;
   setCircularSegments: typeof setCircularSegments;
   getCircularSegments: typeof getCircularSegments;
+  setMaxThreads: typeof setMaxThreads;
+  maxThreads: typeof maxThreads;
   ManifoldFromMeshVec: typeof ManifoldFromMeshVec;
   Manifold: typeof Manifold;
   setup: () => void;
@@ -0,0 +1,418 @@
+// Copyright 2022 The Manifold Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Benchmark suite covering the typical workloads of the library. Each case is
+// run over a range of sizes and thread counts and reported as JSON, so that
+// runs can be diffed between releases.
+//
+// Usage: manifold_bench [--filter=<substring>] [--threads=1,4,...]
+//                       [--min-time=<seconds>] [--out=<file.json>]
+//                       [--calibrate]
+//
+// --calibrate runs CalibratePolicyThresholds() first, prints the result and
+// applies it to the benchmarks that follow.
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "manifold.h"
+#include "polygon.h"
+#include "samples.h"
+#include "sdf.h"
+
+#if MANIFOLD_PAR == 'T'
+#include <tbb/global_control.h>
+#include <tbb/task_arena.h>
+#elif MANIFOLD_PAR == 'O'
+#include <omp.h>
+#endif
+
+using namespace manifold;
+
+namespace {
+
+// Returns the number of output triangles, or another measure of the work done.
+using Run = std::function<int()>;
+
+struct Benchmark {
+  std::string name;
+  std::vector<int> sizes;
+  // Prepares the (evaluated) inputs for this size outside of the timing, and
+  // returns the operation to be timed.
+  std::function<Run(int)> setup;
+};
+
+struct Gyroid {
+  __host__ __device__ float operator()(glm::vec3 p) const {
+    p -= glm::pi<float>() / 4;
+    return cos(p.x) * sin(p.y) + cos(p.y) * sin(p.z) + cos(p.z) * sin(p.x);
+  }
+};
+
+// n^3 overlapping spheres, their union is one connected part.
+std::vector<Manifold> SphereGrid(int n, int segments) {
+  std::vector<Manifold> spheres;
+  const Manifold sphere = Manifold::Sphere(0.6f, segments);
+  for (int i = 0; i < n; ++i)
+    for (int j = 0; j < n; ++j)
+      for (int k = 0; k < n; ++k)
+        spheres.push_back(sphere.Translate(glm::vec3(i, j, k)));
+  return spheres;
+}
+
+// n^3 disjoint cubes.
+std::vector<Manifold> CubeGrid(int n) {
+  std::vector<Manifold> cubes;
+  const Manifold cube = Manifold::Cube(glm::vec3(0.5f));
+  for (int i = 0; i < n; ++i)
+    for (int j = 0; j < n; ++j)
+      for (int k = 0; k < n; ++k)
+        cubes.push_back(cube.Translate(glm::vec3(i, j, k)));
+  return cubes;
+}
+
+// A disk with n vertices and a ring of n / 16 square holes.
+Polygons HoleyDisk(int n) {
+  Polygons polys(1);
+  int idx = 0;
+  for (int i = 0; i < n; ++i) {
+    const float angle = glm::two_pi<float>() * i / n;
+    const float radius = i % 2 == 0 ? 100.0f : 99.0f;
+    polys[0].push_back({radius * glm::vec2(cos(angle), sin(angle)), idx++});
+  }
+  const int numHole = glm::max(n / 16, 1);
+  for (int i = 0; i < numHole; ++i) {
+    const float angle = glm::two_pi<float>() * (i + 0.5f) / numHole;
+    const glm::vec2 center = 50.0f * glm::vec2(cos(angle), sin(angle));
+    const float half = glm::min(20.0f * glm::pi<float>() / numHole, 5.0f);
+    SimplePolygon hole;
+    // clockwise
+    for (glm::vec2 corner : {glm::vec2(-1, -1), glm::vec2(-1, 1),
+                             glm::vec2(1, 1), glm::vec2(1, -1)})
+      hole.push_back({center + half * corner, idx++});
+    polys.push_back(hole);
+  }
+  return polys;
+}
+
+Run DifferenceSpheres(int segments) {
+  const Manifold sphere = Manifold::Sphere(1, segments);
+  const Manifold sphere2 = sphere.Translate(glm::vec3(0.5));
+  sphere2.NumTri();
+  return [=]() { return (sphere - sphere2).NumTri(); };
+}
+
+Run UnionSphereGrid(int n) {
+  const std::vector<Manifold> spheres = SphereGrid(n, 32);
+  for (const Manifold& sphere : spheres) sphere.NumTri();
+  return [=]() {
+    return Manifold::BatchBoolean(spheres, Manifold::OpType::ADD).NumTri();
+  };
+}
+
+Run ComposeCubeGrid(int n) {
+  const std::vector<Manifold> cubes = CubeGrid(n);
+  for (const Manifold& cube : cubes) cube.NumTri();
+  return [=]() { return Manifold::Compose(cubes).NumTri(); };
+}
+
+Run DecomposeCubeGrid(int n) {
+  const Manifold cubes = Manifold::Compose(CubeGrid(n));
+  cubes.NumTri();
+  return [=]() { return static_cast<int>(cubes.Decompose().size()); };
+}
+
+Run RefineSphere(int n) {
+  const Manifold sphere = Manifold::Sphere(1, 64);
+  sphere.NumTri();
+  return [=]() { return sphere.Refine(n).NumTri(); };
+}
+
+Run SmoothTetrahedron(int n) {
+  const Manifold smooth = Manifold::Smooth(Manifold::Tetrahedron().GetMesh());
+  smooth.NumTri();
+  return [=]() { return smooth.Refine(n).NumTri(); };
+}
+
+Run LevelSetGyroid(int n) {
+  const float period = glm::two_pi<float>();
+  const Box bounds(glm::vec3(-period), glm::vec3(period));
+  return [=]() {
+    const Mesh mesh = LevelSet(Gyroid(), bounds, period / n, 0.4f);
+    return static_cast<int>(mesh.triVerts.size());
+  };
+}
+
+Run TriangulateHoleyDisk(int n) {
+  const Polygons polys = HoleyDisk(n);
+  return [=]() { return static_cast<int>(Triangulate(polys).size()); };
+}
+
+// Construction from a dense sphere Mesh, of about segments^2 / 2 triangles.
+Run ConstructSphere(int segments, bool trusted) {
+  const Mesh mesh = Manifold::Sphere(1, segments).GetMesh();
+  return [=]() {
+    ManifoldParams().trustInputMesh = trusted;
+    const int numTri = Manifold(mesh).NumTri();
+    ManifoldParams().trustInputMesh = false;
+    return numTri;
+  };
+}
+
+// Many high-segment cylinders, as for a pattern of holes.
+Run ConstructCylinders(int segments) {
+  return [=]() {
+    int numTri = 0;
+    for (int i = 0; i < 100; ++i)
+      numTri += Manifold::Cylinder(1, 0.1, -1, segments).NumTri();
+    return numTri;
+  };
+}
+
+Run GetMeshGLSphere(int segments) {
+  const Manifold sphere = Manifold::Sphere(1, segments);
+  sphere.NumTri();
+  return [=]() { return sphere.GetMeshGL().NumTri(); };
+}
+
+// The following two stream the halfedges while touching only some of their
+// fields, as do Boolean3's edge kernels; see Difference/Spheres.
+Run IsManifoldSphere(int segments) {
+  const Manifold sphere = Manifold::Sphere(1, segments);
+  sphere.NumTri();
+  return [=]() { return sphere.IsManifold() ? sphere.NumTri() : 0; };
+}
+
+// SimplifyTopology and Finish, which sorts and reindexes the halfedges.
+Run AsOriginalSphere(int segments) {
+  const Manifold sphere = Manifold::Sphere(1, segments);
+  sphere.NumTri();
+  return [=]() { return sphere.AsOriginal().NumTri(); };
+}
+
+Run SampleMengerSponge(int n) {
+  return [=]() { return MengerSponge(n).NumTri(); };
+}
+
+Run SampleStretchyBracelet(int nDecor) {
+  return [=]() {
+    return StretchyBracelet(30.0f, 8.0f, 15.0f, 0.4f, nDecor).NumTri();
+  };
+}
+
+const std::vector<Benchmark> kBenchmarks = {
+    {"Difference/Spheres", {32, 64, 128, 256, 512}, DifferenceSpheres},
+    {"BatchBoolean/UnionSphereGrid", {2, 4, 6, 8}, UnionSphereGrid},
+    {"Compose/CubeGrid", {4, 8, 16, 32}, ComposeCubeGrid},
+    {"Decompose/CubeGrid", {4, 8, 16, 32}, DecomposeCubeGrid},
+    {"Refine/Sphere", {2, 4, 8, 16}, RefineSphere},
+    {"Smooth/Tetrahedron", {8, 16, 32, 64}, SmoothTetrahedron},
+    {"LevelSet/Gyroid", {10, 20, 40, 80}, LevelSetGyroid},
+    {"Triangulate/HoleyDisk", {1 << 10, 1 << 12, 1 << 14, 1 << 16},
+     TriangulateHoleyDisk},
+    {"Construct/Sphere", {1416, 4000, 10000},
+     [](int n) { return ConstructSphere(n, false); }},
+    {"Construct/SphereTrusted", {1416, 4000, 10000},
+     [](int n) { return ConstructSphere(n, true); }},
+    {"Construct/Cylinders", {64, 256, 1024}, ConstructCylinders},
+    {"GetMeshGL/Sphere", {64, 256, 1024}, GetMeshGLSphere},
+    {"IsManifold/Sphere", {256, 1024, 2048}, IsManifoldSphere},
+    {"AsOriginal/Sphere", {64, 256, 1024}, AsOriginalSphere},
+    {"Sample/MengerSponge", {1, 2, 3, 4}, SampleMengerSponge},
+    {"Sample/StretchyBracelet", {10, 20, 40}, SampleStretchyBracelet},
+};
+
+struct Result {
+  std::string name;
+  int size;
+  int threads;
+  int iterations;
+  int work;
+  double min, median, mean;
+};
+
+Result Measure(const Benchmark& benchmark, int size, int threads,
+               double minTime) {
+  const Run run = benchmark.setup(size);
+  std::vector<double> times;
+  double total = 0;
+  int work = 0;
+  // at least three iterations, and until minTime has elapsed
+  while (times.size() < 3 || (total < minTime && times.size() < 1000)) {
+    const auto start = std::chrono::steady_clock::now();
+    work = run();
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    times.push_back(elapsed.count());
+    total += elapsed.count();
+  }
+  std::sort(times.begin(), times.end());
+
+  Result result;
+  result.name = benchmark.name;
+  result.size = size;
+  result.threads = threads;
+  result.iterations = times.size();
+  result.work = work;
+  result.min = times.front();
+  result.median = times[times.size() / 2];
+  result.mean = total / times.size();
+  return result;
+}
+
+// Runs f with at most the given number of threads for the parallel backend;
+// zero means the backend's default.
+void WithThreads(int threads, const std::function<void()>& f) {
+#if MANIFOLD_PAR == 'T'
+  if (threads > 0) {
+    tbb::global_control control(tbb::global_control::max_allowed_parallelism,
+                                threads);
+    f();
+    return;
+  }
+#elif MANIFOLD_PAR == 'O'
+  if (threads > 0) {
+    const int previous = omp_get_max_threads();
+    omp_set_num_threads(threads);
+    f();
+    omp_set_num_threads(previous);
+    return;
+  }
+#endif
+  f();
+}
+
+int DefaultThreads() {
+#if MANIFOLD_PAR == 'T'
+  return tbb::this_task_arena::max_concurrency();
+#elif MANIFOLD_PAR == 'O'
+  return omp_get_max_threads();
+#else
+  return 1;
+#endif
+}
+
+std::vector<int> ParseList(const std::string& list) {
+  std::vector<int> values;
+  std::stringstream stream(list);
+  std::string item;
+  while (std::getline(stream, item, ',')) values.push_back(std::stoi(item));
+  return values;
+}
+
+std::string Backend() {
+#if MANIFOLD_PAR == 'T'
+  const std::string backend = "TBB";
+#elif MANIFOLD_PAR == 'O'
+  const std::string backend = "OMP";
+#else
+  const std::string backend = "CPP";
+#endif
+  return CudaEnabled() ? backend + "+CUDA" : backend;
+}
+
+void PrintThresholds(const PolicyThresholds& thresholds) {
+  const char* names[PolicyThresholds::kNumCost] = {"Light", "Scan", "Sort",
+                                                    "Heavy"};
+  for (int i = 0; i < PolicyThresholds::kNumCost; ++i) {
+    std::cerr << names[i] << ": seqMax " << thresholds.seqMax[i] << ", parMax "
+              << thresholds.parMax[i] << std::endl;
+  }
+}
+
+void WriteJSON(std::ostream& out, const std::vector<Result>& results) {
+  out << "{\n  \"context\": {\"backend\": \"" << Backend()
+      << "\", \"default_threads\": " << DefaultThreads() << "},\n";
+  out << "  \"benchmarks\": [\n";
+  for (size_t i = 0; i < results.size(); ++i) {
+    const Result& r = results[i];
+    out << "    {\"name\": \"" << r.name << "\", \"size\": " << r.size
+        << ", \"threads\": " << r.threads
+        << ", \"iterations\": " << r.iterations << ", \"work\": " << r.work
+        << ", \"min_sec\": " << r.min << ", \"median_sec\": " << r.median
+        << ", \"mean_sec\": " << r.mean << "}"
+        << (i + 1 < results.size() ? ",\n" : "\n");
+  }
+  out << "  ]\n}\n";
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::string filter;
+  std::string outPath;
+  std::vector<int> threadCounts = {0};
+  double minTime = 0.5;
+  bool calibrate = false;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    auto value = [&](const std::string& flag) {
+      return arg.substr(flag.size());
+    };
+    if (arg.rfind("--filter=", 0) == 0) {
+      filter = value("--filter=");
+    } else if (arg.rfind("--threads=", 0) == 0) {
+      threadCounts = ParseList(value("--threads="));
+    } else if (arg.rfind("--min-time=", 0) == 0) {
+      minTime = std::stod(value("--min-time="));
+    } else if (arg.rfind("--out=", 0) == 0) {
+      outPath = value("--out=");
+    } else if (arg == "--calibrate") {
+      calibrate = true;
+    } else {
+      std::cerr << "Usage: " << argv[0]
+                << " [--filter=<substring>] [--threads=1,4,...]"
+                   " [--min-time=<seconds>] [--out=<file.json>]"
+                   " [--calibrate]"
+                << std::endl;
+      return 1;
+    }
+  }
+
+  if (calibrate) {
+    const PolicyThresholds thresholds = CalibratePolicyThresholds();
+    PrintThresholds(thresholds);
+    SetPolicyThresholds(thresholds);
+  }
+
+  std::vector<Result> results;
+  for (const Benchmark& benchmark : kBenchmarks) {
+    if (benchmark.name.find(filter) == std::string::npos) continue;
+    for (int threads : threadCounts) {
+      for (int size : benchmark.sizes) {
+        WithThreads(threads, [&]() {
+          results.push_back(Measure(benchmark, size,
+                                    threads > 0 ? threads : DefaultThreads(),
+                                    minTime));
+        });
+        const Result& r = results.back();
+        std::cerr << r.name << "/" << r.size << "/threads:" << r.threads
+                  << ": " << r.median << " sec (" << r.iterations
+                  << " iterations)" << std::endl;
+      }
+    }
+  }
+
+  if (outPath.empty()) {
+    WriteJSON(std::cout, results);
+  } else {
+    std::ofstream out(outPath);
+    WriteJSON(out, results);
+  }
+}
@@ -19,24 +19,77 @@
 
 namespace manifold {
 
+/** @ingroup Private */
+struct Ray {
+  vec3 origin;
+  vec3 invDirection;
+  // the ray is the segment from the origin to this distance along it
+  Real tMax;
+
+  Ray() {}
+  // direction must be nonzero; it is normalized, so t is a distance
+  Ray(vec3 origin, vec3 direction, Real tMax)
+      : origin(origin),
+        invDirection(Real(1) / glm::normalize(direction)),
+        tMax(tMax) {}
+
+  __host__ __device__ vec3 Direction() const { return Real(1) / invDirection; }
+};
+
 /** @ingroup Private */
 class Collider {
  public:
+  // A node of the tree that is traversed, with the boxes of its children stored
+  // by coordinate, so that they are all tested against a query together.
+  struct WideNode {
+    static constexpr int kWidth = 4;
+    Real minX[kWidth], minY[kWidth], minZ[kWidth];
+    Real maxX[kWidth], maxY[kWidth], maxZ[kWidth];
+    // wide node index, or -1 - leaf index for leaves
+    int child[kWidth];
+  };
+
   Collider() {}
   Collider(const VecDH<Box>& leafBB, const VecDH<uint32_t>& leafMorton);
   // Aborts and returns false if transform is not axis aligned.
-  bool Transform(glm::mat4x3);
+  bool Transform(mat4x3);
   void UpdateBoxes(const VecDH<Box>& leafBB);
+  // Surface area heuristic cost of the current boxes, normalized by the root.
+  Real SAH() const;
+  // Whether refitting has degraded the tree enough to warrant a Rebuild.
+  bool Degraded() const;
+  // Bytes reserved by the hierarchy's buffers.
+  size_t Bytes() const;
+  void Rebuild(const VecDH<Box>& leafBB, const VecDH<uint32_t>& leafMorton);
   // Collisions returns a sparse result, where i is the query index and j is
   // the leaf index where their bounding boxes overlap.
   template <typename T>
   SparseIndices Collisions(const VecDH<T>& queriesIn) const;
+  // Total number of overlaps, found without recording them.
+  template <typename T>
+  int NumCollisions(const VecDH<T>& queriesIn) const;
 
  private:
   VecDH<Box> nodeBBox_;
   VecDH<int> nodeParent_;
   // even nodes are leaves, odd nodes are internal, root is 1
   VecDH<thrust::pair<int, int>> internalChildren_;
+  // input index of each leaf after a Rebuild; empty means the identity
+  VecDH<int> leafIndex_;
+  // SAH() of the tree as built, measured by the first refit; negative until
+  // then
+  Real builtSAH_ = -1;
+  // 4-wide tree of the even levels of the binary one, root is 0
+  VecDH<WideNode> wideNode_;
+  VecDH<int> internal2Wide_;
+  VecDH<int> wide2Internal_;
+
+  void BuildTree(const VecDH<uint32_t>& sortedMorton);
+  void FitBoxes(const VecDH<Box>& leafBB);
+  void BuildWide();
+  void UpdateWide();
+
+  friend struct Serializer;
 
   int NumInternal() const { return internalChildren_.size(); };
   int NumLeaves() const { return NumInternal() + 1; };
@@ -14,6 +14,12 @@
 
 #include "collider.h"
 
+#include <thrust/reduce.h>
+#include <thrust/transform_reduce.h>
+
+#include <algorithm>
+#include <limits>
+
 #include "par.h"
 #include "utils.h"
 
@@ -24,6 +30,8 @@
 // Adjustable parameters
 constexpr int kInitialLength = 128;
 constexpr int kLengthMultiple = 4;
+// Refit trees whose SAH cost grew by more than this factor are rebuilt.
+constexpr Real kMaxSAHGrowth = 1.5f;
 // Fundamental constants
 constexpr int kRoot = 1;
 
@@ -157,63 +165,169 @@ struct CreateRadixTree {
   }
 };
 
-template <typename T, const bool allocateOnly>
-struct FindCollisions {
-  thrust::pair<int*, int*> queryTri_;
-  int* counts;
-  const Box* nodeBBox_;
-  const thrust::pair<int, int>* internalChildren_;
+// The radix tree has max depth 30 (Morton code) + 32 (index), so the wide tree
+// has max depth 31, and each wide node pushes at most kWidth - 1 children.
+constexpr int kStack = 32 * (Collider::WideNode::kWidth - 1);
 
-  __host__ __device__ int RecordCollision(int node,
-                                          thrust::tuple<T, int>& query) {
-    const T& queryObj = thrust::get<0>(query);
-    const int queryIdx = thrust::get<1>(query);
-    int& count = counts[queryIdx];
+__host__ __device__ bool Overlaps(const Collider::WideNode& node, int i,
+                                  const Box& box) {
+  return node.minX[i] <= box.max.x && node.minY[i] <= box.max.y &&
+         node.minZ[i] <= box.max.z && node.maxX[i] >= box.min.x &&
+         node.maxY[i] >= box.min.y && node.maxZ[i] >= box.min.z;
+}
 
-    bool overlaps = nodeBBox_[node].DoesOverlap(queryObj);
-    if (overlaps && IsLeaf(node)) {
-      if (allocateOnly) {
-        count++;
-      } else {
-        int pos = count++;
-        queryTri_.first[pos] = queryIdx;
-        queryTri_.second[pos] = Node2Leaf(node);
-      }
+__host__ __device__ bool Overlaps(const Collider::WideNode& node, int i,
+                                  const vec3& p) {  // projected in z
+  return node.minX[i] <= p.x && node.minY[i] <= p.y && node.maxX[i] >= p.x &&
+         node.maxY[i] >= p.y;
+}
+
+__host__ __device__ bool Overlaps(const Collider::WideNode& node, int i,
+                                  const Ray& ray) {
+  // empty slots are inverted boxes, which the slabs below would not reject
+  if (node.minX[i] > node.maxX[i]) return false;
+  const Real min[3] = {node.minX[i], node.minY[i], node.minZ[i]};
+  const Real max[3] = {node.maxX[i], node.maxY[i], node.maxZ[i]};
+  Real tNear = 0;
+  Real tFar = ray.tMax;
+  for (int j : {0, 1, 2}) {
+    const Real inv = ray.invDirection[j];
+    if (glm::isinf(inv)) {
+      // parallel to this slab, which avoids 0 * inf
+      if (ray.origin[j] < min[j] || ray.origin[j] > max[j]) return false;
+      continue;
+    }
+    const Real t0 = (min[j] - ray.origin[j]) * inv;
+    const Real t1 = (max[j] - ray.origin[j]) * inv;
+    tNear = glm::max(tNear, glm::min(t0, t1));
+    tFar = glm::min(tFar, glm::max(t0, t1));
+  }
+  return tNear <= tFar;
+}
+
+/**
+ * Depth-first search of the wide tree, calling record with the index of each
+ * leaf whose box overlaps the query. All children of a node are tested
+ * together, with the comparisons laid out for the compiler to vectorize.
+ */
+template <typename T, typename Record>
+__host__ __device__ void ForEachOverlap(const Collider::WideNode* wideNode,
+                                        const T& query, Record& record) {
+  constexpr int kWidth = Collider::WideNode::kWidth;
+  int stack[kStack];
+  int top = -1;
+  int node = 0;
+  while (1) {
+    const Collider::WideNode& wide = wideNode[node];
+    bool overlaps[kWidth];
+    for (int i = 0; i < kWidth; ++i) overlaps[i] = Overlaps(wide, i, query);
+    int next = -1;
+    for (int i = 0; i < kWidth; ++i) {
+      if (!overlaps[i]) continue;
+      const int child = wide.child[i];
+      if (child < 0)
+        record(-1 - child);
+      else if (next < 0)
+        next = child;  // go here next
+      else
+        stack[++top] = child;  // save the others for later
     }
-    return overlaps && IsInternal(node);  // Should traverse into node
+    if (next < 0) {
+      if (top < 0) break;   // done
+      next = stack[top--];  // get a saved node
+    }
+    node = next;
+  }
+}
+
+struct Counter {
+  int count;
+  __host__ __device__ void operator()(int leaf) { ++count; }
+};
+
+struct Recorder {
+  int* query;
+  int* leafOut;
+  int queryIdx;
+  int pos;
+  __host__ __device__ void operator()(int leaf) {
+    query[pos] = queryIdx;
+    leafOut[pos++] = leaf;
+  }
+};
+
+template <typename T>
+struct CountCollisions {
+  int* counts;
+  const Collider::WideNode* wideNode_;
+
+  __host__ __device__ void operator()(thrust::tuple<T, int> query) {
+    Counter counter({0});
+    ForEachOverlap(wideNode_, thrust::get<0>(query), counter);
+    counts[thrust::get<1>(query)] = counter.count;
   }
+};
+
+template <typename T>
+struct RecordCollisions {
+  thrust::pair<int*, int*> queryTri_;
+  const int* offset;
+  const Collider::WideNode* wideNode_;
 
   __host__ __device__ void operator()(thrust::tuple<T, int> query) {
-    // stack cannot overflow because radix tree has max depth 30 (Morton code) +
-    // 32 (index).
-    int stack[64];
-    int top = -1;
-    // Depth-first search
-    int node = kRoot;
     const int queryIdx = thrust::get<1>(query);
     // same implies that this query do not have any collision
-    if (!allocateOnly && counts[queryIdx] == counts[queryIdx + 1]) return;
-    while (1) {
-      int internal = Node2Internal(node);
-      int child1 = internalChildren_[internal].first;
-      int child2 = internalChildren_[internal].second;
+    if (offset[queryIdx] == offset[queryIdx + 1]) return;
+    Recorder recorder(
+        {queryTri_.first, queryTri_.second, queryIdx, offset[queryIdx]});
+    ForEachOverlap(wideNode_, thrust::get<0>(query), recorder);
+  }
+};
 
-      int traverse1 = RecordCollision(child1, query);
-      int traverse2 = RecordCollision(child2, query);
+// The collisions of a contiguous range of queries, found by one CPU thread.
+struct Chunk {
+  std::vector<int> query;
+  std::vector<int> leaf;
+};
 
-      if (!traverse1 && !traverse2) {
-        if (top < 0) break;   // done
-        node = stack[top--];  // get a saved node
-      } else {
-        node = traverse1 ? child1 : child2;  // go here next
-        if (traverse1 && traverse2) {
-          stack[++top] = child2;  // save the other for later
-        }
-      }
+constexpr int kChunkSize = 1024;
+
+// Host-only, as the chunks grow as the collisions are found, so that each
+// query is traversed just once.
+template <typename T>
+struct CollectChunk {
+  Chunk* chunks;
+  const T* queries;
+  const int numQuery;
+  const Collider::WideNode* wideNode_;
+
+  void operator()(int c) {
+    Chunk& chunk = chunks[c];
+    const int end = glm::min((c + 1) * kChunkSize, numQuery);
+    for (int queryIdx = c * kChunkSize; queryIdx < end; ++queryIdx) {
+      auto record = [&chunk, queryIdx](int leaf) {
+        chunk.query.push_back(queryIdx);
+        chunk.leaf.push_back(leaf);
+      };
+      ForEachOverlap(wideNode_, queries[queryIdx], record);
     }
   }
 };
 
+struct CopyChunk {
+  thrust::pair<int*, int*> queryTri_;
+  const Chunk* chunks;
+  const int* chunkStart;
+
+  void operator()(int c) {
+    const Chunk& chunk = chunks[c];
+    std::copy(chunk.query.begin(), chunk.query.end(),
+              queryTri_.first + chunkStart[c]);
+    std::copy(chunk.leaf.begin(), chunk.leaf.end(),
+              queryTri_.second + chunkStart[c]);
+  }
+};
+
 struct BuildInternalBoxes {
   Box* nodeBBox_;
   int* counter_;
@@ -232,8 +346,93 @@ struct BuildInternalBoxes {
   }
 };
 
+struct InternalArea {
+  const Box* nodeBBox_;
+
+  __host__ __device__ Real operator()(int internal) {
+    const vec3 size = nodeBBox_[Internal2Node(internal)].Size();
+    return size.x * size.y + size.y * size.z + size.z * size.x;
+  }
+};
+
+// Internal nodes at even depth head the wide nodes; the others are absorbed
+// into their parent's.
+struct MarkWide {
+  int* isWide;
+  const int* nodeParent_;
+
+  __host__ __device__ void operator()(int internal) {
+    int depth = 0;
+    for (int node = Internal2Node(internal); node != kRoot;
+         node = nodeParent_[node])
+      ++depth;
+    isWide[internal] = depth % 2 == 0;
+  }
+};
+
+struct ListWide {
+  int* wide2Internal_;
+  const int* isWide;
+  const int* internal2Wide_;
+
+  __host__ __device__ void operator()(int internal) {
+    if (isWide[internal]) wide2Internal_[internal2Wide_[internal]] = internal;
+  }
+};
+
+struct FillWideNode {
+  Collider::WideNode* wideNode_;
+  const int* wide2Internal_;
+  const int* internal2Wide_;
+  const int* leafIndex_;
+  const Box* nodeBBox_;
+  const thrust::pair<int, int>* internalChildren_;
+
+  __host__ __device__ void SetSlot(Collider::WideNode& wide, int slot,
+                                   int node) {
+    const Box& box = nodeBBox_[node];
+    wide.minX[slot] = box.min.x;
+    wide.minY[slot] = box.min.y;
+    wide.minZ[slot] = box.min.z;
+    wide.maxX[slot] = box.max.x;
+    wide.maxY[slot] = box.max.y;
+    wide.maxZ[slot] = box.max.z;
+    if (IsLeaf(node)) {
+      const int leaf = Node2Leaf(node);
+      wide.child[slot] = -1 - (leafIndex_ == nullptr ? leaf : leafIndex_[leaf]);
+    } else {
+      wide.child[slot] = internal2Wide_[Node2Internal(node)];
+    }
+  }
+
+  __host__ __device__ void operator()(int w) {
+    Collider::WideNode& wide = wideNode_[w];
+    const thrust::pair<int, int> children =
+        internalChildren_[wide2Internal_[w]];
+    int slot = 0;
+    for (const int child : {children.first, children.second}) {
+      if (IsLeaf(child)) {
+        SetSlot(wide, slot++, child);
+      } else {
+        const thrust::pair<int, int> grandchildren =
+            internalChildren_[Node2Internal(child)];
+        SetSlot(wide, slot++, grandchildren.first);
+        SetSlot(wide, slot++, grandchildren.second);
+      }
+    }
+    // empty slots never overlap anything
+    for (; slot < Collider::WideNode::kWidth; ++slot) {
+      wide.child[slot] = 0;
+      wide.minX[slot] = wide.minY[slot] = wide.minZ[slot] =
+          std::numeric_limits<Real>::infinity();
+      wide.maxX[slot] = wide.maxY[slot] = wide.maxZ[slot] =
+          -std::numeric_limits<Real>::infinity();
+    }
+  }
+};
+
 struct TransformBox {
-  const glm::mat4x3 transform;
+  const mat4x3 transform;
   __host__ __device__ void operator()(Box& box) {
     box = box.Transform(transform);
   }
@@ -251,58 +450,161 @@ Collider::Collider(const VecDH<Box>& leafBB,
                    const VecDH<uint32_t>& leafMorton) {
   ASSERT(leafBB.size() == leafMorton.size(), userErr,
          "vectors must be the same length");
-  int num_nodes = 2 * leafBB.size() - 1;
+  BuildTree(leafMorton);
+  FitBoxes(leafBB);
+}
+
+/**
+ * Discards the hierarchy and builds a new one for these leaf boxes, which need
+ * not be sorted by Morton code; the leaves are reordered internally, so
+ * Collisions still reports the input indices. UpdateBoxes takes the boxes in
+ * the same input order afterwards.
+ */
+void Collider::Rebuild(const VecDH<Box>& leafBB,
+                       const VecDH<uint32_t>& leafMorton) {
+  ASSERT(leafBB.size() == leafMorton.size(), userErr,
+         "vectors must be the same length");
+  auto policy = autoPolicy(leafMorton.size(), KernelCost::Sort);
+  VecDH<uint32_t> sortedMorton(leafMorton);
+  leafIndex_.resize(leafMorton.size());
+  sequence(policy, leafIndex_.begin(), leafIndex_.end());
+  stable_sort_by_key(policy, sortedMorton.begin(), sortedMorton.end(),
+                     leafIndex_.begin());
+  BuildTree(sortedMorton);
+  FitBoxes(leafBB);
+}
+
+void Collider::BuildTree(const VecDH<uint32_t>& sortedMorton) {
+  builtSAH_ = -1;
+  int num_nodes = 2 * sortedMorton.size() - 1;
   // assign and allocate members
   nodeBBox_.resize(num_nodes);
   nodeParent_.resize(num_nodes, -1);
-  internalChildren_.resize(leafBB.size() - 1, thrust::make_pair(-1, -1));
+  internalChildren_.resize(sortedMorton.size() - 1, thrust::make_pair(-1, -1));
   // organize tree
   for_each_n(autoPolicy(NumInternal()), countAt(0), NumInternal(),
              CreateRadixTree(
-                 {nodeParent_.ptrD(), internalChildren_.ptrD(), leafMorton}));
-  UpdateBoxes(leafBB);
+                 {nodeParent_.ptrD(), internalChildren_.ptrD(), sortedMorton}));
+  BuildWide();
+}
+
+/**
+ * Collapses the binary radix tree into the wide tree that is traversed, by
+ * merging each node at odd depth into its parent.
+ */
+void Collider::BuildWide() {
+  auto policy = autoPolicy(NumInternal());
+  VecDH<int> isWide(NumInternal());
+  for_each_n(policy, countAt(0), NumInternal(),
+             MarkWide({isWide.ptrD(), nodeParent_.ptrD()}));
+  internal2Wide_.resize(NumInternal());
+  exclusive_scan(policy, isWide.begin(), isWide.end(), internal2Wide_.begin());
+  const int numWide =
+      NumInternal() == 0 ? 0 : internal2Wide_.back() + isWide.back();
+  wideNode_.resize(numWide);
+  wide2Internal_.resize(numWide);
+  for_each_n(policy, countAt(0), NumInternal(),
+             ListWide({wide2Internal_.ptrD(), isWide.cptrD(),
+                       internal2Wide_.cptrD()}));
+}
+
+/**
+ * Copies the boxes of the binary tree into the wide nodes.
+ */
+void Collider::UpdateWide() {
+  const int* leafIndex = leafIndex_.size() == 0 ? nullptr : leafIndex_.cptrD();
+  for_each_n(autoPolicy(wideNode_.size()), countAt(0), wideNode_.size(),
+             FillWideNode({wideNode_.ptrD(), wide2Internal_.cptrD(),
+                           internal2Wide_.cptrD(), leafIndex, nodeBBox_.cptrD(),
+                           internalChildren_.cptrD()}));
 }
 
 /**
  * For a vector of query objects, this returns a sparse array of overlaps
  * between the queries and the bounding boxes of the collider. Queries are
  * normally axis-aligned bounding boxes. Points can also be used, and this case
- * overlaps are defined as lying in the XY projection of the bounding box.
+ * overlaps are defined as lying in the XY projection of the bounding box. Rays
+ * overlap the boxes they pass through within their length. The result is
+ * grouped by query.
  */
 template <typename T>
 SparseIndices Collider::Collisions(const VecDH<T>& queriesIn) const {
-  // note that the length is 1 larger than the number of queries so the last
-  // element can store the sum when using exclusive scan
-  VecDH<int> counts(queriesIn.size() + 1, 0);
-  auto policy = autoPolicy(queriesIn.size());
-  // compute the number of collisions to determine the size for allocation and
-  // offset, this avoids the need for atomic
-  for_each_n(policy, zip(queriesIn.cbegin(), countAt(0)), queriesIn.size(),
-             FindCollisions<T, true>(
-                 {thrust::pair<int*, int*>(nullptr, nullptr), counts.ptrD(),
-                  nodeBBox_.ptrD(), internalChildren_.ptrD()}));
+  const int numQuery = queriesIn.size();
+  if (wideNode_.size() == 0 || numQuery == 0) return SparseIndices();
+  auto policy = autoPolicy(numQuery, KernelCost::Heavy);
+  if (policy != ParUnseq) {
+    // On the CPU each chunk of queries is traversed once, recording its
+    // collisions as they are found; the chunks are concatenated in order.
+    const int numChunk = (numQuery + kChunkSize - 1) / kChunkSize;
+    const ExecutionPolicy chunkPolicy = numChunk > 1 ? policy : Seq;
+    std::vector<Chunk> chunks(numChunk);
+    for_each_n(chunkPolicy, countAt(0), numChunk,
+               CollectChunk<T>({chunks.data(), queriesIn.cptrH(), numQuery,
+                                wideNode_.cptrH()}));
+    std::vector<int> chunkStart(numChunk + 1, 0);
+    for (int c = 0; c < numChunk; ++c)
+      chunkStart[c + 1] = chunkStart[c] + chunks[c].query.size();
+    SparseIndices queryTri(chunkStart.back());
+    for_each_n(
+        chunkPolicy, countAt(0), numChunk,
+        CopyChunk({queryTri.ptrDpq(), chunks.data(), chunkStart.data()}));
+    return queryTri;
+  }
+  // On the GPU, counting first determines the size for allocation and the
+  // offsets, which avoids the need for atomics. Note that the length is 1
+  // larger than the number of queries so the last element can store the sum
+  // when using exclusive scan.
+  VecDH<int> counts(numQuery + 1, 0);
+  for_each_n(policy, zip(queriesIn.cbegin(), countAt(0)), numQuery,
+             CountCollisions<T>({counts.ptrD(), wideNode_.cptrD()}));
   // compute start index for each query and total count
   exclusive_scan(policy, counts.begin(), counts.end(), counts.begin());
   SparseIndices queryTri(counts.back());
   // actually recording collisions
-  for_each_n(
-      policy, zip(queriesIn.cbegin(), countAt(0)), queriesIn.size(),
-      FindCollisions<T, false>({queryTri.ptrDpq(), counts.ptrD(),
-                                nodeBBox_.ptrD(), internalChildren_.ptrD()}));
+  for_each_n(policy, zip(queriesIn.cbegin(), countAt(0)), numQuery,
+             RecordCollisions<T>(
+                 {queryTri.ptrDpq(), counts.cptrD(), wideNode_.cptrD()}));
   return queryTri;
 }
 
+/**
+ * Counts the overlaps Collisions would return, with a single traversal and no
+ * allocation of the result, for when only their number is needed.
+ */
+template <typename T>
+int Collider::NumCollisions(const VecDH<T>& queriesIn) const {
+  if (wideNode_.size() == 0) return 0;
+  VecDH<int> counts(queriesIn.size(), 0);
+  auto policy = autoPolicy(queriesIn.size(), KernelCost::Heavy);
+  for_each_n(policy, zip(queriesIn.cbegin(), countAt(0)), queriesIn.size(),
+             CountCollisions<T>({counts.ptrD(), wideNode_.cptrD()}));
+  return reduce<int>(policy, counts.begin(), counts.end(), 0);
+}
+
 /**
  * Recalculate the collider's internal bounding boxes without changing the
- * hierarchy.
+ * hierarchy. This refit is much cheaper than building a new collider, but the
+ * tree only stays efficient while the leaves keep their relative arrangement,
+ * as under rigid motion; check Degraded() after large deformations.
  */
 void Collider::UpdateBoxes(const VecDH<Box>& leafBB) {
+  // The cost of the tree as built only matters once it is refit, so it is
+  // measured here, once, rather than on every build.
+  if (builtSAH_ < 0) builtSAH_ = SAH();
+  FitBoxes(leafBB);
+}
+
+void Collider::FitBoxes(const VecDH<Box>& leafBB) {
   ASSERT(leafBB.size() == NumLeaves(), userErr,
          "must have the same number of updated boxes as original");
   // copy in leaf node Boxes
   strided_range<VecDH<Box>::Iter> leaves(nodeBBox_.begin(), nodeBBox_.end(), 2);
   auto policy = autoPolicy(NumInternal());
-  copy(policy, leafBB.cbegin(), leafBB.cend(), leaves.begin());
+  if (leafIndex_.size() == 0)
+    copy(policy, leafBB.cbegin(), leafBB.cend(), leaves.begin());
+  else
+    gather(policy, leafIndex_.begin(), leafIndex_.end(), leafBB.cbegin(),
+           leaves.begin());
   // create global counters
   VecDH<int> counter(NumInternal(), 0);
   // kernel over leaves to save internal Boxes
@@ -310,13 +612,43 @@ void Collider::UpdateBoxes(const VecDH<Box>& leafBB) {
       policy, countAt(0), NumLeaves(),
       BuildInternalBoxes({nodeBBox_.ptrD(), counter.ptrD(), nodeParent_.ptrD(),
                           internalChildren_.ptrD()}));
+  UpdateWide();
+}
+
+/**
+ * The surface area heuristic: the expected number of internal nodes a random
+ * query visits, which is the sum of their surface areas relative to the root.
+ * Being scale-invariant, it can be compared across transforms.
+ */
+Real Collider::SAH() const {
+  if (NumInternal() == 0) return 0;
+  const Real rootArea = InternalArea({nodeBBox_.cptrH()})(0);
+  if (!(rootArea > 0)) return 0;
+  const Real area = transform_reduce<Real>(
+      autoPolicy(NumInternal()), countAt(0), countAt(NumInternal()),
+      InternalArea({nodeBBox_.cptrD()}), 0.0f, thrust::plus<Real>());
+  return area / rootArea;
+}
+
+/**
+ * Whether the SAH cost has grown enough since the hierarchy was built that a
+ * Rebuild will pay for itself over the following queries.
+ */
+bool Collider::Degraded() const {
+  return builtSAH_ > 0 && SAH() > kMaxSAHGrowth * builtSAH_;
+}
+
+size_t Collider::Bytes() const {
+  return nodeBBox_.Bytes() + nodeParent_.Bytes() + internalChildren_.Bytes() +
+         leafIndex_.Bytes() + wideNode_.Bytes() + internal2Wide_.Bytes() +
+         wide2Internal_.Bytes();
 }
 
 /**
  * Apply axis-aligned transform to all bounding boxes. If transform is not
  * axis-aligned, abort and return false to indicate recalculation is necessary.
  */
-bool Collider::Transform(glm::mat4x3 transform) {
+bool Collider::Transform(mat4x3 transform) {
   bool axisAligned = true;
   for (int row : {0, 1, 2}) {
     int count = 0;
@@ -328,13 +660,19 @@ bool Collider::Transform(glm::mat4x3 transform) {
   if (axisAligned) {
     for_each(autoPolicy(nodeBBox_.size()), nodeBBox_.begin(), nodeBBox_.end(),
              TransformBox({transform}));
+    UpdateWide();
   }
   return axisAligned;
 }
 
 template SparseIndices Collider::Collisions<Box>(const VecDH<Box>&) const;
 
-template SparseIndices Collider::Collisions<glm::vec3>(
-    const VecDH<glm::vec3>&) const;
+template SparseIndices Collider::Collisions<vec3>(const VecDH<vec3>&) const;
+
+template SparseIndices Collider::Collisions<Ray>(const VecDH<Ray>&) const;
+
+template int Collider::NumCollisions<Box>(const VecDH<Box>&) const;
+
+template int Collider::NumCollisions<vec3>(const VecDH<vec3>&) const;
 
 }  // namespace manifold
@@ -0,0 +1,80 @@
+// Copyright 2022 The Manifold Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include "public.h"
+
+namespace manifold {
+
+/** @addtogroup Core
+ *  @{
+ */
+
+/** @defgroup MeshFile
+ *  @brief Native STL, OBJ and 3MF reading and writing, without Assimp
+ * @{
+ */
+
+/**
+ * Thrown when a mesh file cannot be opened, read or written.
+ */
+struct ioErr : public virtual std::runtime_error {
+  using std::runtime_error::runtime_error;
+};
+
+enum class MeshFormat {
+  STL,     ///< binary or ASCII on input, binary on output
+  OBJ,     ///< positions and faces only; polygons are fan-triangulated
+  THREEMF  ///< the mesh objects of the build, with their transforms
+};
+
+MeshFormat FormatOf(const std::string& filename);
+
+Mesh ReadMesh(const std::string& filename);
+Mesh ReadMesh(const char* data, size_t size, MeshFormat format);
+void WeldVerts(Mesh& mesh);
+
+/**
+ * Writes meshes to a file as they are added, in the format given by its
+ * extension. Each added mesh is formatted in parallel and written out before
+ * Add() returns, so only one is held at a time. In an STL or OBJ file they
+ * make up a single mesh; in a 3MF file each becomes an object of the build.
+ * The file is complete once Close() is called or the writer is destroyed.
+ */
+class MeshWriter {
+ public:
+  explicit MeshWriter(const std::string& filename);
+  ~MeshWriter();
+  MeshWriter(const MeshWriter&) = delete;
+  MeshWriter& operator=(const MeshWriter&) = delete;
+
+  void Add(const MeshGL& mesh);
+  void Add(const float* vertPos, int numVert, const uint32_t* triVerts,
+           int numTri);
+  void Close();
+
+  struct Impl;
+
+ private:
+  std::unique_ptr<Impl> pImpl_;
+};
+
+void WriteMesh(const std::string& filename, const MeshGL& mesh);
+/** @} */
+/** @} */
+}  // namespace manifold
@@ -0,0 +1,106 @@
+// Copyright 2022 The Manifold Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "mesh_io.h"
+#include "par.h"
+#include "utils.h"
+
+namespace manifold {
+
+/** @addtogroup Private
+ *  @{
+ */
+
+/**
+ * The format-specific part of a MeshWriter.
+ */
+struct MeshWriter::Impl {
+  virtual ~Impl() {}
+  virtual void Add(const float* vertPos, int numVert, const uint32_t* triVerts,
+                   int numTri) = 0;
+  virtual void Close() = 0;
+};
+
+bool ParseReal(const char*& p, const char* end, Real& value);
+bool ParseInt(const char*& p, const char* end, long long& value);
+
+// The parsers and writers work on the caller's host memory, so they never run
+// on the GPU.
+inline ExecutionPolicy HostPolicy(int size) {
+  const ExecutionPolicy policy = autoPolicy(size);
+  return policy == ExecutionPolicy::ParUnseq ? ExecutionPolicy::Par : policy;
+}
+
+std::unique_ptr<MeshWriter::Impl> Make3MFWriter(const std::string& filename);
+void Read3MF(const char* data, size_t size, Mesh& mesh);
+
+inline void AppendFloat(std::string& text, float value) {
+  // nine significant digits round-trip any float
+  char buffer[32];
+  const int length = std::snprintf(buffer, sizeof(buffer), "%.9g", value);
+  text.append(buffer, length);
+}
+
+inline void AppendInt(std::string& text, uint32_t value) {
+  char buffer[16];
+  const int length = std::snprintf(buffer, sizeof(buffer), "%u", value);
+  text.append(buffer, length);
+}
+
+/**
+ * Formats count items as text, or binary records, and passes them to sink in
+ * order. The items are formatted in parallel blocks, a group of blocks at a
+ * time, so that the memory held stays bounded whatever the count.
+ *
+ * @param format Appends item i to a string: `void(int i, std::string&)`.
+ * @param sink Consumes the next block: `void(const std::string&)`.
+ */
+template <typename Format, typename Sink>
+void FormatBlocks(int count, Format format, Sink sink) {
+  constexpr int kBlock = 1 << 12;
+  constexpr int kGroup = 64;
+  const int numBlock = (count + kBlock - 1) / kBlock;
+  std::vector<std::string> text(glm::min(numBlock, kGroup));
+  for (int first = 0; first < numBlock; first += kGroup) {
+    const int numGroup = glm::min(kGroup, numBlock - first);
+    // the text grows, so a failed allocation must not escape the parallel
+    // backend
+    std::vector<std::exception_ptr> errors(numGroup);
+    for_each_n(numGroup > 1 ? ExecutionPolicy::Par : ExecutionPolicy::Seq,
+               countAt(0), numGroup, [&](int block) {
+                 std::string& out = text[block];
+                 out.clear();
+                 const int start = (first + block) * kBlock;
+                 const int end = glm::min(count, start + kBlock);
+                 try {
+                   for (int i = start; i < end; ++i) format(i, out);
+                 } catch (...) {
+                   errors[block] = std::current_exception();
+                 }
+               });
+    for (const auto& error : errors) {
+      if (error) std::rethrow_exception(error);
+    }
+    for (int block = 0; block < numGroup; ++block) sink(text[block]);
+  }
+}
+/** @} */
+}  // namespace manifold
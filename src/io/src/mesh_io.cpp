@@ -0,0 +1,666 @@
+// Copyright 2022 The Manifold Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mesh_io.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "io_impl.h"
+
+namespace {
+using namespace manifold;
+
+/**
+ * A read-only view of a whole file, memory-mapped where available so that
+ * the parsers read straight from the page cache.
+ */
+class MappedFile {
+ public:
+  explicit MappedFile(const std::string& filename) {
+#ifdef _WIN32
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    if (!file) throw ioErr("Cannot open " + filename);
+    buffer_.resize(file.tellg());
+    file.seekg(0);
+    file.read(buffer_.data(), buffer_.size());
+    if (!file) throw ioErr("Cannot read " + filename);
+    data_ = buffer_.data();
+    size_ = buffer_.size();
+#else
+    const int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) throw ioErr("Cannot open " + filename);
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+      close(fd);
+      throw ioErr("Cannot read " + filename);
+    }
+    size_ = info.st_size;
+    if (size_ > 0) {
+      void* map = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (map == MAP_FAILED) {
+        close(fd);
+        throw ioErr("Cannot map " + filename);
+      }
+      madvise(map, size_, MADV_WILLNEED);
+      data_ = static_cast<const char*>(map);
+    }
+    close(fd);
+#endif
+  }
+
+  ~MappedFile() {
+#ifndef _WIN32
+    if (data_ != nullptr) munmap(const_cast<char*>(data_), size_);
+#endif
+  }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  const char* Data() const { return data_; }
+  size_t Size() const { return size_; }
+
+ private:
+  const char* data_ = nullptr;
+  size_t size_ = 0;
+  std::vector<char> buffer_;
+};
+
+bool IsSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+bool IsNumberChar(char c) {
+  return (c >= '0' && c <= '9') || c == '+' || c == '-' || c == '.' ||
+         c == 'e' || c == 'E';
+}
+
+void SkipSpace(const char*& p, const char* end) {
+  while (p < end && IsSpace(*p)) ++p;
+}
+
+const char* LineEnd(const char* p, const char* end) {
+  const void* newline = std::memchr(p, '\n', end - p);
+  return newline == nullptr ? end : static_cast<const char*>(newline);
+}
+
+// Whether the line at p starts with this keyword, followed by a space.
+bool IsKeyword(const char* p, const char* end, const char* keyword) {
+  const size_t length = std::strlen(keyword);
+  return end - p > length && std::memcmp(p, keyword, length) == 0 &&
+         IsSpace(p[length]);
+}
+
+/**
+ * The lines of a text file between begin and end, which are line starts, and
+ * what was parsed from them. OBJ indices are made zero-based; those counted
+ * back from the last vertex are relative to this chunk's first vertex until
+ * the chunks are joined, and are marked in relative.
+ */
+struct TextChunk {
+  const char* begin;
+  const char* end;
+  std::vector<vec3> verts;
+  std::vector<glm::ivec3> tris;
+  // bit i of each triangle marks a relative corner i; empty if there are none
+  std::vector<uint8_t> relative;
+  bool valid = true;
+
+  void AddTri(const glm::ivec3& tri, uint8_t mask) {
+    if (mask != 0 && relative.empty()) relative.resize(tris.size(), 0);
+    if (!relative.empty()) relative.push_back(mask);
+    tris.push_back(tri);
+  }
+};
+
+void ParseSTLLine(const char* p, const char* end, TextChunk& chunk) {
+  if (!IsKeyword(p, end, "vertex")) return;
+  p += 6;
+  vec3 vert;
+  for (int i : {0, 1, 2}) {
+    if (!ParseReal(p, end, vert[i])) {
+      chunk.valid = false;
+      return;
+    }
+  }
+  chunk.verts.push_back(vert);
+}
+
+void ParseOBJLine(const char* p, const char* end, TextChunk& chunk) {
+  if (IsKeyword(p, end, "v")) {
+    ++p;
+    vec3 vert;
+    for (int i : {0, 1, 2}) {
+      if (!ParseReal(p, end, vert[i])) {
+        chunk.valid = false;
+        return;
+      }
+    }
+    chunk.verts.push_back(vert);
+  } else if (IsKeyword(p, end, "f")) {
+    ++p;
+    // polygons are fan-triangulated
+    int numCorner = 0;
+    int first = 0;
+    int prev = 0;
+    uint8_t firstRel = 0;
+    uint8_t prevRel = 0;
+    for (;;) {
+      SkipSpace(p, end);
+      if (p == end || *p == '#') break;
+      long long index;
+      if (!ParseInt(p, end, index) || index == 0) {
+        chunk.valid = false;
+        return;
+      }
+      // skip the texture coordinate and normal indices
+      while (p < end && !IsSpace(*p)) ++p;
+      const uint8_t rel = index < 0 ? 1 : 0;
+      const int corner =
+          static_cast<int>(rel ? chunk.verts.size() + index : index - 1);
+      if (numCorner == 0) {
+        first = corner;
+        firstRel = rel;
+      } else if (numCorner > 1) {
+        chunk.AddTri({first, prev, corner},
+                     firstRel | (prevRel << 1) | (rel << 2));
+      }
+      prev = corner;
+      prevRel = rel;
+      ++numCorner;
+    }
+    if (numCorner < 3) chunk.valid = false;
+  }
+}
+
+/**
+ * Splits the text into chunks of whole lines, enough to keep every thread
+ * busy while not so many that their joining dominates.
+ */
+std::vector<TextChunk> SplitLines(const char* data, size_t size) {
+  constexpr size_t kMinChunk = 1 << 20;
+  const size_t maxChunk = 4 * static_cast<size_t>(MaxThreads());
+  const int numChunk =
+      std::max<size_t>(1, std::min(size / kMinChunk, maxChunk));
+  std::vector<TextChunk> chunks(numChunk);
+  const char* end = data + size;
+  const char* begin = data;
+  for (int i = 0; i < numChunk; ++i) {
+    chunks[i].begin = begin;
+    if (i + 1 < numChunk) {
+      const char* split = std::max(begin, data + size * (i + 1) / numChunk);
+      const char* lineEnd = LineEnd(split, end);
+      begin = lineEnd == end ? end : lineEnd + 1;
+    } else {
+      begin = end;
+    }
+    chunks[i].end = begin;
+  }
+  return chunks;
+}
+
+void ParseLines(std::vector<TextChunk>& chunks, MeshFormat format) {
+  const int numChunk = chunks.size();
+  // The chunks grow their buffers, so a failed allocation is kept to be
+  // rethrown after the loop rather than escape the parallel backend.
+  std::vector<std::exception_ptr> errors(numChunk);
+  for_each_n(numChunk > 1 ? ExecutionPolicy::Par : ExecutionPolicy::Seq,
+             countAt(0), numChunk, [&](int i) {
+               TextChunk& chunk = chunks[i];
+               try {
+                 for (const char* line = chunk.begin; line < chunk.end;) {
+                   const char* lineEnd = LineEnd(line, chunk.end);
+                   const char* p = line;
+                   SkipSpace(p, lineEnd);
+                   if (format == MeshFormat::STL)
+                     ParseSTLLine(p, lineEnd, chunk);
+                   else
+                     ParseOBJLine(p, lineEnd, chunk);
+                   line = lineEnd + 1;
+                 }
+               } catch (...) {
+                 errors[i] = std::current_exception();
+               }
+             });
+  for (const auto& error : errors) {
+    if (error) std::rethrow_exception(error);
+  }
+}
+
+void JoinChunks(std::vector<TextChunk>& chunks, Mesh& mesh) {
+  const int numChunk = chunks.size();
+  std::vector<int> vertStart(numChunk + 1, 0);
+  std::vector<int> triStart(numChunk + 1, 0);
+  for (int i = 0; i < numChunk; ++i) {
+    if (!chunks[i].valid) throw ioErr("Malformed vertex or face line.");
+    vertStart[i + 1] = vertStart[i] + chunks[i].verts.size();
+    triStart[i + 1] = triStart[i] + chunks[i].tris.size();
+  }
+  mesh.vertPos.resize(vertStart.back());
+  mesh.triVerts.resize(triStart.back());
+  for_each_n(numChunk > 1 ? ExecutionPolicy::Par : ExecutionPolicy::Seq,
+             countAt(0), numChunk, [&](int i) {
+               TextChunk& chunk = chunks[i];
+               std::copy(chunk.verts.begin(), chunk.verts.end(),
+                         mesh.vertPos.begin() + vertStart[i]);
+               for (int tri = 0; tri < chunk.tris.size(); ++tri) {
+                 glm::ivec3 verts = chunk.tris[tri];
+                 const uint8_t mask =
+                     chunk.relative.empty() ? 0 : chunk.relative[tri];
+                 for (int j : {0, 1, 2}) {
+                   if (mask & (1 << j)) verts[j] += vertStart[i];
+                 }
+                 mesh.triVerts[triStart[i] + tri] = verts;
+               }
+               std::vector<vec3>().swap(chunk.verts);
+               std::vector<glm::ivec3>().swap(chunk.tris);
+             });
+}
+
+void ReadSTL(const char* data, size_t size, Mesh& mesh) {
+  uint32_t numTri = 0;
+  if (size >= 84) std::memcpy(&numTri, data + 80, sizeof(uint32_t));
+  // an ASCII file may start with "solid" but so may a binary header, so the
+  // size decides
+  const bool binary = size >= 84 && 84 + 50 * uint64_t(numTri) == size;
+  if (binary) {
+    mesh.vertPos.resize(3 * numTri);
+    vec3* vertPos = mesh.vertPos.data();
+    for_each_n(HostPolicy(numTri), countAt(0), numTri, [=](int tri) {
+      // each record is a normal, three vertices and two attribute bytes
+      const char* record = data + 84 + 50 * size_t(tri) + 12;
+      for (int i : {0, 1, 2}) {
+        float xyz[3];
+        std::memcpy(xyz, record + 12 * i, sizeof(xyz));
+        vertPos[3 * tri + i] = vec3(xyz[0], xyz[1], xyz[2]);
+      }
+    });
+  } else {
+    if (size < 5 || std::memcmp(data, "solid", 5) != 0)
+      throw ioErr("Truncated binary STL.");
+    std::vector<TextChunk> chunks = SplitLines(data, size);
+    ParseLines(chunks, MeshFormat::STL);
+    JoinChunks(chunks, mesh);
+    if (mesh.vertPos.size() % 3 != 0)
+      throw ioErr("ASCII STL facet without three vertices.");
+    numTri = mesh.vertPos.size() / 3;
+  }
+  mesh.triVerts.resize(numTri);
+  glm::ivec3* triVerts = mesh.triVerts.data();
+  for_each_n(HostPolicy(numTri), countAt(0), numTri, [=](int tri) {
+    triVerts[tri] = glm::ivec3(3 * tri, 3 * tri + 1, 3 * tri + 2);
+  });
+}
+
+uint64_t HashVert(const vec3& vert) {
+  uint64_t seed = 0;
+  for (int i : {0, 1, 2}) {
+    // adding zero turns -0 into +0, which compares equal to it
+    const Real value = vert[i] + Real(0);
+    uint64_t bits = 0;
+    std::memcpy(&bits, &value, sizeof(Real));
+    seed ^= bits + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2);
+    seed = (seed ^ (seed >> 30)) * 0xbf58476d1ce4e5b9ull;
+    seed = (seed ^ (seed >> 27)) * 0x94d049bb133111ebull;
+  }
+  return seed ^ (seed >> 31);
+}
+
+class STLWriter : public MeshWriter::Impl {
+ public:
+  explicit STLWriter(const std::string& filename)
+      : file_(filename, std::ios::binary) {
+    if (!file_) throw ioErr("Cannot open " + filename + " for writing.");
+    // the triangle count after the header is filled in by Close()
+    char header[84] = "Binary STL written by Manifold";
+    file_.write(header, sizeof(header));
+  }
+
+  void Add(const float* vertPos, int numVert, const uint32_t* triVerts,
+           int numTri) override {
+    FormatBlocks(
+        numTri,
+        [=](int tri, std::string& out) {
+          glm::vec3 verts[3];
+          for (int i : {0, 1, 2}) {
+            const float* pos = vertPos + 3 * triVerts[3 * tri + i];
+            verts[i] = glm::vec3(pos[0], pos[1], pos[2]);
+          }
+          glm::vec3 normal = glm::normalize(
+              glm::cross(verts[1] - verts[0], verts[2] - verts[0]));
+          if (!glm::all(glm::isfinite(normal))) normal = glm::vec3(0);
+          out.append(reinterpret_cast<const char*>(&normal), 12);
+          out.append(reinterpret_cast<const char*>(verts), 36);
+          out.append(2, '\0');
+        },
+        [this](const std::string& block) {
+          file_.write(block.data(), block.size());
+        });
+    numTri_ += numTri;
+  }
+
+  void Close() override {
+    if (!file_.is_open()) return;
+    file_.seekp(80);
+    file_.write(reinterpret_cast<const char*>(&numTri_), sizeof(uint32_t));
+    file_.close();
+    if (file_.fail()) throw ioErr("Failed to write STL.");
+  }
+
+ private:
+  std::ofstream file_;
+  uint32_t numTri_ = 0;
+};
+
+class OBJWriter : public MeshWriter::Impl {
+ public:
+  explicit OBJWriter(const std::string& filename) : file_(filename) {
+    if (!file_) throw ioErr("Cannot open " + filename + " for writing.");
+  }
+
+  void Add(const float* vertPos, int numVert, const uint32_t* triVerts,
+           int numTri) override {
+    auto sink = [this](const std::string& block) {
+      file_.write(block.data(), block.size());
+    };
+    FormatBlocks(
+        numVert,
+        [=](int vert, std::string& out) {
+          out += "v";
+          for (int i : {0, 1, 2}) {
+            out += ' ';
+            AppendFloat(out, vertPos[3 * vert + i]);
+          }
+          out += '\n';
+        },
+        sink);
+    const uint32_t start = numVert_ + 1;
+    FormatBlocks(
+        numTri,
+        [=](int tri, std::string& out) {
+          out += "f";
+          for (int i : {0, 1, 2}) {
+            out += ' ';
+            AppendInt(out, start + triVerts[3 * tri + i]);
+          }
+          out += '\n';
+        },
+        sink);
+    numVert_ += numVert;
+  }
+
+  void Close() override {
+    if (!file_.is_open()) return;
+    file_.close();
+    if (file_.fail()) throw ioErr("Failed to write OBJ.");
+  }
+
+ private:
+  std::ofstream file_;
+  uint32_t numVert_ = 0;
+};
+}  // namespace
+
+namespace manifold {
+
+/**
+ * Parses the number at p, after any spaces, and advances p past it. Returns
+ * false if there is none. The number is copied out first, as the input, which
+ * may be a memory-mapped file, need not be null-terminated.
+ */
+bool ParseReal(const char*& p, const char* end, Real& value) {
+  SkipSpace(p, end);
+  char token[64];
+  int length = 0;
+  while (p + length < end && length < 63 && IsNumberChar(p[length])) {
+    token[length] = p[length];
+    ++length;
+  }
+  token[length] = '\0';
+  char* tokenEnd;
+  const double parsed = std::strtod(token, &tokenEnd);
+  if (tokenEnd == token) return false;
+  value = parsed;
+  p += tokenEnd - token;
+  return true;
+}
+
+bool ParseInt(const char*& p, const char* end, long long& value) {
+  SkipSpace(p, end);
+  const bool negative = p < end && *p == '-';
+  if (p < end && (*p == '-' || *p == '+')) ++p;
+  if (p == end || *p < '0' || *p > '9') return false;
+  value = 0;
+  while (p < end && *p >= '0' && *p <= '9') value = 10 * value + (*p++ - '0');
+  if (negative) value = -value;
+  return true;
+}
+
+/**
+ * The format of a mesh file, from its extension, regardless of case.
+ */
+MeshFormat FormatOf(const std::string& filename) {
+  const size_t dot = filename.find_last_of('.');
+  std::string ext = dot == std::string::npos ? "" : filename.substr(dot + 1);
+  for (char& c : ext) c = std::tolower(static_cast<unsigned char>(c));
+  if (ext == "stl") return MeshFormat::STL;
+  if (ext == "obj") return MeshFormat::OBJ;
+  if (ext == "3mf") return MeshFormat::THREEMF;
+  throw ioErr("Unsupported mesh file type: " + filename);
+}
+
+/**
+ * Reads a mesh file in the format given by its extension, see FormatOf(). The
+ * file is memory-mapped rather than read into a buffer.
+ */
+Mesh ReadMesh(const std::string& filename) {
+  MappedFile file(filename);
+  return ReadMesh(file.Data(), file.Size(), FormatOf(filename));
+}
+
+/**
+ * Reads a mesh from a file's contents, ready to construct a Manifold from.
+ * Binary STLs are read a triangle per thread and text files in chunks of
+ * lines per thread. Vertices at identical positions are then merged by
+ * WeldVerts(), which STLs cannot be manifold without, and which merely
+ * cleans up the others.
+ *
+ * @param data The file's contents, which need not be null-terminated.
+ * @param size The number of bytes of data.
+ * @param format How to read it; 3MF files are zip archives, which may be
+ * stored or deflated.
+ */
+Mesh ReadMesh(const char* data, size_t size, MeshFormat format) {
+  Mesh mesh;
+  switch (format) {
+    case MeshFormat::STL:
+      ReadSTL(data, size, mesh);
+      break;
+    case MeshFormat::OBJ: {
+      std::vector<TextChunk> chunks = SplitLines(data, size);
+      ParseLines(chunks, MeshFormat::OBJ);
+      JoinChunks(chunks, mesh);
+      break;
+    }
+    case MeshFormat::THREEMF:
+      Read3MF(data, size, mesh);
+      break;
+  }
+  WeldVerts(mesh);
+  return mesh;
+}
+
+/**
+ * Merges the vertices at bitwise identical positions, treating -0 as 0, and
+ * drops the triangles this collapses. The vertices are hashed and sorted by
+ * hash in parallel, so that only those sharing a hash are compared; each
+ * keeps the index of its first occurrence, so the vertex order is preserved.
+ * A merged vertex keeps the normal of its first occurrence, and the tangents
+ * of dropped triangles are dropped with them. Indices out of bounds are left
+ * for the Manifold constructor to report.
+ */
+void WeldVerts(Mesh& mesh) {
+  const int numVert = mesh.vertPos.size();
+  const int numTri = mesh.triVerts.size();
+  if (numVert == 0) return;
+  const auto policy = HostPolicy(numVert);
+  const vec3* vertPos = mesh.vertPos.data();
+
+  std::vector<uint64_t> hash(numVert);
+  std::vector<int> sorted2vert(numVert);
+  transform(policy, mesh.vertPos.begin(), mesh.vertPos.end(), hash.begin(),
+            HashVert);
+  sequence(policy, sorted2vert.begin(), sorted2vert.end());
+  stable_sort_by_key(HostPolicy(numVert), hash.begin(), hash.end(),
+                     sorted2vert.begin());
+
+  // the first vertex, in sorted order, at the same position as each
+  std::vector<int> sortedFirst(numVert);
+  std::vector<int> isFirst(numVert);
+  const uint64_t* hashes = hash.data();
+  const int* sorted = sorted2vert.data();
+  int* first = sortedFirst.data();
+  int* firsts = isFirst.data();
+  for_each_n(policy, countAt(0), numVert, [=](int i) {
+    first[i] = i;
+    const vec3 pos = vertPos[sorted[i]];
+    for (int j = i - 1; j >= 0 && hashes[j] == hashes[i]; --j) {
+      if (vertPos[sorted[j]] == pos) first[i] = j;
+    }
+    firsts[sorted[i]] = first[i] == i;
+  });
+
+  std::vector<int> newIndex(numVert);
+  exclusive_scan(policy, isFirst.begin(), isFirst.end(), newIndex.begin(), 0);
+  const int numNew = newIndex.back() + isFirst.back();
+  if (numNew == numVert) return;
+
+  std::vector<int> old2new(numVert);
+  std::vector<vec3> newPos(numNew);
+  std::vector<vec3> newNormal(mesh.vertNormal.size() == numVert ? numNew : 0);
+  const int* index = newIndex.data();
+  int* remap = old2new.data();
+  vec3* pos = newPos.data();
+  vec3* normal = newNormal.empty() ? nullptr : newNormal.data();
+  const vec3* vertNormal = mesh.vertNormal.data();
+  for_each_n(policy, countAt(0), numVert, [=](int i) {
+    const int vert = sorted[i];
+    remap[vert] = index[sorted[first[i]]];
+    if (first[i] != i) return;
+    pos[index[vert]] = vertPos[vert];
+    if (normal != nullptr) normal[index[vert]] = vertNormal[vert];
+  });
+  mesh.vertPos.swap(newPos);
+  mesh.vertNormal.swap(newNormal);
+
+  glm::ivec3* triVerts = mesh.triVerts.data();
+  for_each_n(HostPolicy(numTri), countAt(0), numTri, [=](int tri) {
+    for (int i : {0, 1, 2}) {
+      int& vert = triVerts[tri][i];
+      if (vert >= 0 && vert < numVert) vert = remap[vert];
+    }
+  });
+
+  const bool tangents = mesh.halfedgeTangent.size() == 3 * numTri;
+  int numKept = 0;
+  for (int tri = 0; tri < numTri; ++tri) {
+    const glm::ivec3 verts = mesh.triVerts[tri];
+    if (verts[0] == verts[1] || verts[1] == verts[2] || verts[2] == verts[0])
+      continue;
+    mesh.triVerts[numKept] = verts;
+    if (tangents) {
+      for (int i : {0, 1, 2})
+        mesh.halfedgeTangent[3 * numKept + i] =
+            mesh.halfedgeTangent[3 * tri + i];
+    }
+    ++numKept;
+  }
+  mesh.triVerts.resize(numKept);
+  if (tangents) mesh.halfedgeTangent.resize(3 * numKept);
+}
+
+MeshWriter::MeshWriter(const std::string& filename) {
+  switch (FormatOf(filename)) {
+    case MeshFormat::STL:
+      pImpl_ = std::make_unique<STLWriter>(filename);
+      break;
+    case MeshFormat::OBJ:
+      pImpl_ = std::make_unique<OBJWriter>(filename);
+      break;
+    case MeshFormat::THREEMF:
+      pImpl_ = Make3MFWriter(filename);
+      break;
+  }
+}
+
+MeshWriter::~MeshWriter() {
+  // errors can only be reported by calling Close() explicitly
+  try {
+    Close();
+  } catch (...) {
+  }
+}
+
+/**
+ * Formats and writes a mesh of the shape of MeshGL, such as one returned by
+ * Manifold.GetMeshGL().
+ */
+void MeshWriter::Add(const MeshGL& mesh) {
+  Add(mesh.vertPos.data(), mesh.NumVert(), mesh.triVerts.data(),
+      mesh.NumTri());
+}
+
+/**
+ * As above, from raw buffers, which need only live until this returns.
+ *
+ * @param vertPos Three floats per vertex.
+ * @param numVert The number of vertices.
+ * @param triVerts Three vertex indices per triangle, counter-clockwise from
+ * the outside.
+ * @param numTri The number of triangles.
+ */
+void MeshWriter::Add(const float* vertPos, int numVert,
+                     const uint32_t* triVerts, int numTri) {
+  if (pImpl_ == nullptr) throw ioErr("MeshWriter is closed.");
+  pImpl_->Add(vertPos, numVert, triVerts, numTri);
+}
+
+/**
+ * Completes the file; nothing more can be added afterward.
+ */
+void MeshWriter::Close() {
+  if (pImpl_ == nullptr) return;
+  std::unique_ptr<Impl> impl = std::move(pImpl_);
+  impl->Close();
+}
+
+/**
+ * Writes a single mesh to a file in the format given by its extension.
+ */
+void WriteMesh(const std::string& filename, const MeshGL& mesh) {
+  MeshWriter writer(filename);
+  writer.Add(mesh);
+  writer.Close();
+}
+
+}  // namespace manifold
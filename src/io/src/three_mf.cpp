@@ -0,0 +1,669 @@
+// Copyright 2022 The Manifold Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <unordered_map>
+
+#include "io_impl.h"
+
+namespace {
+using namespace manifold;
+
+constexpr uint32_t kLocalHeader = 0x04034b50;
+constexpr uint32_t kCentralHeader = 0x02014b50;
+constexpr uint32_t kEndOfDirectory = 0x06054b50;
+// 1980-01-01, the earliest DOS date
+constexpr uint16_t kDosDate = (1 << 5) | 1;
+
+const char* kContentTypes =
+    "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+    "<Types xmlns=\"http://schemas.openxmlformats.org/package/2006/"
+    "content-types\"><Default Extension=\"rels\" ContentType=\"application/"
+    "vnd.openxmlformats-package.relationships+xml\"/><Default "
+    "Extension=\"model\" ContentType=\"application/"
+    "vnd.ms-package.3dmanufacturing-3dmodel+xml\"/></Types>\n";
+
+const char* kRelationships =
+    "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+    "<Relationships xmlns=\"http://schemas.openxmlformats.org/package/2006/"
+    "relationships\"><Relationship Target=\"/3D/3dmodel.model\" Id=\"rel0\" "
+    "Type=\"http://schemas.microsoft.com/3dmanufacturing/2013/01/3dmodel\"/>"
+    "</Relationships>\n";
+
+const char* kModelStart =
+    "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+    "<model unit=\"millimeter\" xml:lang=\"en-US\" "
+    "xmlns=\"http://schemas.microsoft.com/3dmanufacturing/core/2015/02\">\n"
+    "<resources>\n";
+
+uint32_t Crc32(uint32_t crc, const char* data, size_t size) {
+  static const std::array<uint32_t, 256> table = []() {
+    std::array<uint32_t, 256> table;
+    for (uint32_t n = 0; n < 256; ++n) {
+      uint32_t c = n;
+      for (int k = 0; k < 8; ++k) c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+      table[n] = c;
+    }
+    return table;
+  }();
+  crc = ~crc;
+  for (size_t i = 0; i < size; ++i)
+    crc = table[(crc ^ static_cast<uint8_t>(data[i])) & 0xff] ^ (crc >> 8);
+  return ~crc;
+}
+
+uint32_t Get16(const char* p) {
+  const uint8_t* b = reinterpret_cast<const uint8_t*>(p);
+  return b[0] | (b[1] << 8);
+}
+
+uint32_t Get32(const char* p) {
+  return Get16(p) | (Get16(p + 2) << 16);
+}
+
+void Put16(std::string& out, uint32_t value) {
+  out += static_cast<char>(value & 0xff);
+  out += static_cast<char>((value >> 8) & 0xff);
+}
+
+void Put32(std::string& out, uint32_t value) {
+  Put16(out, value & 0xffff);
+  Put16(out, value >> 16);
+}
+
+/**
+ * Raw DEFLATE (RFC 1951) decoder, decoding Huffman codes a bit at a time from
+ * their canonical form, after zlib's puff. The models it reads are dwarfed by
+ * the meshes they hold, so simplicity wins over speed here.
+ */
+class Inflater {
+ public:
+  Inflater(const char* in, size_t size, std::vector<char>& out)
+      : in_(reinterpret_cast<const uint8_t*>(in)), size_(size), out_(out) {}
+
+  void Run() {
+    bool last;
+    do {
+      last = Bits(1);
+      switch (Bits(2)) {
+        case 0:
+          Stored();
+          break;
+        case 1:
+          Fixed();
+          break;
+        case 2:
+          Dynamic();
+          break;
+        default:
+          throw ioErr("Invalid deflate block in 3MF.");
+      }
+    } while (!last);
+  }
+
+ private:
+  static constexpr int kMaxBits = 15;
+
+  struct Huffman {
+    // number of codes of each length, and the symbols ordered by code
+    short count[kMaxBits + 1];
+    short symbol[288];
+  };
+
+  const uint8_t* in_;
+  const size_t size_;
+  size_t pos_ = 0;
+  uint32_t bitBuf_ = 0;
+  int bitCount_ = 0;
+  std::vector<char>& out_;
+
+  int Bits(int need) {
+    uint32_t value = bitBuf_;
+    while (bitCount_ < need) {
+      if (pos_ == size_) throw ioErr("Truncated deflate stream in 3MF.");
+      value |= static_cast<uint32_t>(in_[pos_++]) << bitCount_;
+      bitCount_ += 8;
+    }
+    bitBuf_ = value >> need;
+    bitCount_ -= need;
+    return value & ((1u << need) - 1);
+  }
+
+  void Stored() {
+    bitBuf_ = 0;
+    bitCount_ = 0;
+    if (pos_ + 4 > size_) throw ioErr("Truncated deflate stream in 3MF.");
+    const uint32_t length = in_[pos_] | (in_[pos_ + 1] << 8);
+    const uint32_t check = in_[pos_ + 2] | (in_[pos_ + 3] << 8);
+    pos_ += 4;
+    if (length != (~check & 0xffff) || pos_ + length > size_)
+      throw ioErr("Invalid stored deflate block in 3MF.");
+    out_.insert(out_.end(), in_ + pos_, in_ + pos_ + length);
+    pos_ += length;
+  }
+
+  // Returns the number of unused codes, negative if over-subscribed.
+  static int Construct(Huffman& h, const short* length, int n) {
+    std::fill(h.count, h.count + kMaxBits + 1, 0);
+    for (int symbol = 0; symbol < n; ++symbol) ++h.count[length[symbol]];
+    if (h.count[0] == n) return 0;
+    int left = 1;
+    for (int len = 1; len <= kMaxBits; ++len) {
+      left <<= 1;
+      left -= h.count[len];
+      if (left < 0) return left;
+    }
+    short offset[kMaxBits + 1];
+    offset[1] = 0;
+    for (int len = 1; len < kMaxBits; ++len)
+      offset[len + 1] = offset[len] + h.count[len];
+    for (int symbol = 0; symbol < n; ++symbol) {
+      if (length[symbol] != 0) h.symbol[offset[length[symbol]]++] = symbol;
+    }
+    return left;
+  }
+
+  int Decode(const Huffman& h) {
+    int code = 0;
+    int first = 0;
+    int index = 0;
+    for (int len = 1; len <= kMaxBits; ++len) {
+      code |= Bits(1);
+      const int count = h.count[len];
+      if (code - count < first) return h.symbol[index + (code - first)];
+      index += count;
+      first += count;
+      first <<= 1;
+      code <<= 1;
+    }
+    throw ioErr("Invalid deflate code in 3MF.");
+  }
+
+  void Codes(const Huffman& lengthCode, const Huffman& distCode) {
+    static const short kLengthBase[29] = {
+        3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+        31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+    static const short kLengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1,
+                                           1, 1, 2, 2, 2, 2, 3, 3, 3, 3,
+                                           4, 4, 4, 4, 5, 5, 5, 5, 0};
+    static const short kDistBase[30] = {
+        1,   2,   3,   4,   5,   7,    9,    13,   17,   25,
+        33,  49,  65,  97,  129, 193,  257,  385,  513,  769,
+        1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+    static const short kDistExtra[30] = {0, 0, 0, 0, 1, 1, 2,  2,  3,  3,
+                                         4, 4, 5, 5, 6, 6, 7,  7,  8,  8,
+                                         9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+    for (;;) {
+      int symbol = Decode(lengthCode);
+      if (symbol < 256) {
+        out_.push_back(static_cast<char>(symbol));
+        continue;
+      }
+      if (symbol == 256) return;
+      symbol -= 257;
+      if (symbol >= 29) throw ioErr("Invalid deflate length in 3MF.");
+      const int length = kLengthBase[symbol] + Bits(kLengthExtra[symbol]);
+      symbol = Decode(distCode);
+      if (symbol >= 30) throw ioErr("Invalid deflate distance in 3MF.");
+      const size_t dist = kDistBase[symbol] + Bits(kDistExtra[symbol]);
+      if (dist > out_.size()) throw ioErr("Invalid deflate distance in 3MF.");
+      // byte by byte, as the copy may overlap what it writes
+      size_t from = out_.size() - dist;
+      for (int i = 0; i < length; ++i) out_.push_back(out_[from++]);
+    }
+  }
+
+  void Fixed() {
+    static const std::array<Huffman, 2> codes = []() {
+      std::array<Huffman, 2> codes;
+      short length[288];
+      int symbol = 0;
+      for (; symbol < 144; ++symbol) length[symbol] = 8;
+      for (; symbol < 256; ++symbol) length[symbol] = 9;
+      for (; symbol < 280; ++symbol) length[symbol] = 7;
+      for (; symbol < 288; ++symbol) length[symbol] = 8;
+      Construct(codes[0], length, 288);
+      for (symbol = 0; symbol < 30; ++symbol) length[symbol] = 5;
+      Construct(codes[1], length, 30);
+      return codes;
+    }();
+    Codes(codes[0], codes[1]);
+  }
+
+  void Dynamic() {
+    static const short kOrder[19] = {16, 17, 18, 0, 8,  7, 9,  6, 10, 5,
+                                     11, 4,  12, 3, 13, 2, 14, 1, 15};
+    const int numLength = Bits(5) + 257;
+    const int numDist = Bits(5) + 1;
+    const int numCode = Bits(4) + 4;
+    if (numLength > 286 || numDist > 30)
+      throw ioErr("Invalid deflate header in 3MF.");
+
+    short length[320] = {};
+    for (int i = 0; i < numCode; ++i) length[kOrder[i]] = Bits(3);
+    Huffman lengthCode, distCode;
+    if (Construct(lengthCode, length, 19) != 0)
+      throw ioErr("Invalid deflate header in 3MF.");
+
+    int index = 0;
+    while (index < numLength + numDist) {
+      int symbol = Decode(lengthCode);
+      if (symbol < 16) {
+        length[index++] = symbol;
+        continue;
+      }
+      short repeat = 0;
+      if (symbol == 16) {
+        if (index == 0) throw ioErr("Invalid deflate header in 3MF.");
+        repeat = length[index - 1];
+        symbol = 3 + Bits(2);
+      } else if (symbol == 17) {
+        symbol = 3 + Bits(3);
+      } else {
+        symbol = 11 + Bits(7);
+      }
+      if (index + symbol > numLength + numDist)
+        throw ioErr("Invalid deflate header in 3MF.");
+      while (symbol-- > 0) length[index++] = repeat;
+    }
+    if (length[256] == 0) throw ioErr("Invalid deflate header in 3MF.");
+    // incomplete codes are allowed, as encoders emit them for tiny blocks
+    if (Construct(lengthCode, length, numLength) < 0 ||
+        Construct(distCode, length + numLength, numDist) < 0)
+      throw ioErr("Invalid deflate header in 3MF.");
+    Codes(lengthCode, distCode);
+  }
+};
+
+/**
+ * Finds the model part of a 3MF archive in its central directory, returning
+ * it directly when stored and in inflated when deflated.
+ */
+void FindModel(const char* data, size_t size, std::vector<char>& inflated,
+               const char*& model, size_t& modelSize) {
+  if (size < 22) throw ioErr("3MF is not a zip archive.");
+  size_t end = size - 22;
+  const size_t minEnd = size > 22 + 0xffff ? size - 22 - 0xffff : 0;
+  while (Get32(data + end) != kEndOfDirectory) {
+    if (end == minEnd) throw ioErr("3MF is not a zip archive.");
+    --end;
+  }
+  const int numEntry = Get16(data + end + 10);
+  size_t pos = Get32(data + end + 16);
+
+  bool found = false;
+  uint32_t method = 0, compressed = 0, uncompressed = 0, offset = 0;
+  for (int i = 0; i < numEntry; ++i) {
+    if (pos + 46 > size || Get32(data + pos) != kCentralHeader)
+      throw ioErr("Corrupt 3MF zip directory.");
+    const uint32_t nameLength = Get16(data + pos + 28);
+    if (pos + 46 + nameLength > size) throw ioErr("Corrupt 3MF zip directory.");
+    const std::string name(data + pos + 46, nameLength);
+    const bool isModel = name.size() > 6 &&
+                         name.compare(name.size() - 6, 6, ".model") == 0;
+    // the standard location takes precedence over any other model
+    if (isModel && (!found || name == "3D/3dmodel.model")) {
+      found = true;
+      method = Get16(data + pos + 10);
+      compressed = Get32(data + pos + 20);
+      uncompressed = Get32(data + pos + 24);
+      offset = Get32(data + pos + 42);
+    }
+    pos += 46 + nameLength + Get16(data + pos + 30) + Get16(data + pos + 32);
+  }
+  if (!found) throw ioErr("3MF has no model.");
+  if (compressed == 0xffffffff || offset == 0xffffffff)
+    throw ioErr("ZIP64 3MF files are not supported.");
+
+  if (offset + 30 > size || Get32(data + offset) != kLocalHeader)
+    throw ioErr("Corrupt 3MF zip entry.");
+  const size_t start =
+      offset + 30 + Get16(data + offset + 26) + Get16(data + offset + 28);
+  if (start + compressed > size) throw ioErr("Truncated 3MF.");
+  if (method == 0) {
+    model = data + start;
+    modelSize = compressed;
+  } else if (method == 8) {
+    inflated.reserve(uncompressed);
+    Inflater(data + start, compressed, inflated).Run();
+    model = inflated.data();
+    modelSize = inflated.size();
+  } else {
+    throw ioErr("Unsupported 3MF compression method.");
+  }
+}
+
+bool IsXmlSpace(char c) {
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// Whether the tag name between begin and end is name, ignoring any namespace
+// prefix.
+bool IsTag(const char* begin, const char* end, const char* name) {
+  const char* colon =
+      static_cast<const char*>(std::memchr(begin, ':', end - begin));
+  if (colon != nullptr) begin = colon + 1;
+  const size_t length = std::strlen(name);
+  return end - begin == length && std::memcmp(begin, name, length) == 0;
+}
+
+// Finds the named attribute among those between begin and end, pointing value
+// at the start of its quoted value.
+bool FindAttr(const char* begin, const char* end, const char* name,
+              const char*& value) {
+  const size_t length = std::strlen(name);
+  for (const char* p = begin;; ++p) {
+    p = std::search(p, end, name, name + length);
+    if (p == end) return false;
+    if (p != begin && !IsXmlSpace(p[-1])) continue;
+    const char* q = p + length;
+    while (q < end && IsXmlSpace(*q)) ++q;
+    if (q == end || *q != '=') continue;
+    ++q;
+    while (q < end && IsXmlSpace(*q)) ++q;
+    if (q == end || (*q != '"' && *q != '\'')) continue;
+    value = q + 1;
+    return true;
+  }
+}
+
+Real RealAttr(const char* begin, const char* end, const char* name) {
+  const char* value;
+  Real result;
+  if (!FindAttr(begin, end, name, value) || !ParseReal(value, end, result))
+    throw ioErr("3MF element without a valid " + std::string(name) + ".");
+  return result;
+}
+
+int IntAttr(const char* begin, const char* end, const char* name) {
+  const char* value;
+  long long result;
+  if (!FindAttr(begin, end, name, value) || !ParseInt(value, end, result))
+    throw ioErr("3MF element without a valid " + std::string(name) + ".");
+  return result;
+}
+
+// 3MF transforms are of row vectors, so their twelve values are the four
+// columns of a mat4x3 in turn.
+mat4x3 TransformAttr(const char* begin, const char* end) {
+  mat4x3 transform(1.0f);
+  const char* value;
+  if (!FindAttr(begin, end, "transform", value)) return transform;
+  for (int i = 0; i < 12; ++i) {
+    if (!ParseReal(value, end, transform[i / 3][i % 3]))
+      throw ioErr("Invalid 3MF transform.");
+  }
+  return transform;
+}
+
+struct Object {
+  std::vector<vec3> verts;
+  std::vector<glm::ivec3> tris;
+  std::vector<std::pair<int, mat4x3>> components;
+};
+
+void AddObject(const std::unordered_map<int, Object>& objects, int id,
+               const mat4x3& transform, int depth, Mesh& mesh) {
+  constexpr int kMaxDepth = 64;
+  auto it = objects.find(id);
+  if (it == objects.end())
+    throw ioErr("3MF refers to missing object " + std::to_string(id) + ".");
+  if (depth > kMaxDepth) throw ioErr("3MF components nest too deeply.");
+  const Object& object = it->second;
+
+  const int numVert = object.verts.size();
+  const int start = mesh.vertPos.size();
+  for (const vec3& vert : object.verts)
+    mesh.vertPos.push_back(transform * vec4(vert, 1));
+  // mirroring turns the triangles inside out
+  const bool flip = glm::determinant(mat3(transform)) < 0;
+  for (glm::ivec3 tri : object.tris) {
+    for (int i : {0, 1, 2}) {
+      if (tri[i] < 0 || tri[i] >= numVert)
+        throw ioErr("3MF triangle index out of bounds.");
+    }
+    if (flip) std::swap(tri[1], tri[2]);
+    mesh.triVerts.push_back(tri + start);
+  }
+  for (const auto& component : object.components)
+    AddObject(objects, component.first, transform * mat4(component.second),
+              depth + 1, mesh);
+}
+
+class ThreeMFWriter : public MeshWriter::Impl {
+ public:
+  explicit ThreeMFWriter(const std::string& filename)
+      : file_(filename, std::ios::binary) {
+    if (!file_) throw ioErr("Cannot open " + filename + " for writing.");
+    AddEntry("[Content_Types].xml", kContentTypes);
+    AddEntry("_rels/.rels", kRelationships);
+    BeginEntry("3D/3dmodel.model");
+    Write(kModelStart);
+  }
+
+  void Add(const float* vertPos, int numVert, const uint32_t* triVerts,
+           int numTri) override {
+    auto sink = [this](const std::string& block) { Write(block); };
+    Write("<object id=\"" + std::to_string(++numObject_) +
+          "\" type=\"model\"><mesh><vertices>\n");
+    FormatBlocks(
+        numVert,
+        [=](int vert, std::string& out) {
+          out += "<vertex x=\"";
+          AppendFloat(out, vertPos[3 * vert]);
+          out += "\" y=\"";
+          AppendFloat(out, vertPos[3 * vert + 1]);
+          out += "\" z=\"";
+          AppendFloat(out, vertPos[3 * vert + 2]);
+          out += "\"/>\n";
+        },
+        sink);
+    Write("</vertices><triangles>\n");
+    FormatBlocks(
+        numTri,
+        [=](int tri, std::string& out) {
+          out += "<triangle v1=\"";
+          AppendInt(out, triVerts[3 * tri]);
+          out += "\" v2=\"";
+          AppendInt(out, triVerts[3 * tri + 1]);
+          out += "\" v3=\"";
+          AppendInt(out, triVerts[3 * tri + 2]);
+          out += "\"/>\n";
+        },
+        sink);
+    Write("</triangles></mesh></object>\n");
+  }
+
+  void Close() override {
+    if (!file_.is_open()) return;
+    std::string build = "</resources>\n<build>";
+    for (int id = 1; id <= numObject_; ++id)
+      build += "<item objectid=\"" + std::to_string(id) + "\"/>";
+    Write(build + "</build>\n</model>\n");
+    EndEntry();
+
+    std::string directory;
+    for (const Entry& entry : entries_) {
+      Put32(directory, kCentralHeader);
+      Put16(directory, 20);  // made by
+      Put16(directory, 20);  // needed to extract
+      Put16(directory, 0);   // flags
+      Put16(directory, 0);   // stored
+      Put16(directory, 0);   // time
+      Put16(directory, kDosDate);
+      Put32(directory, entry.crc);
+      Put32(directory, entry.size);
+      Put32(directory, entry.size);
+      Put16(directory, entry.name.size());
+      Put16(directory, 0);  // extra field
+      Put16(directory, 0);  // comment
+      Put16(directory, 0);  // disk
+      Put16(directory, 0);  // internal attributes
+      Put32(directory, 0);  // external attributes
+      Put32(directory, entry.offset);
+      directory += entry.name;
+    }
+    std::string end;
+    Put32(end, kEndOfDirectory);
+    Put16(end, 0);
+    Put16(end, 0);
+    Put16(end, entries_.size());
+    Put16(end, entries_.size());
+    Put32(end, directory.size());
+    Put32(end, offset_);
+    Put16(end, 0);
+    RawWrite(directory + end);
+    file_.close();
+    if (file_.fail()) throw ioErr("Failed to write 3MF.");
+  }
+
+ private:
+  // Entries are stored uncompressed; their CRCs and sizes are patched into
+  // their local headers once written out.
+  struct Entry {
+    std::string name;
+    uint32_t offset;
+    uint32_t crc;
+    uint32_t size;
+  };
+
+  std::ofstream file_;
+  std::vector<Entry> entries_;
+  uint64_t offset_ = 0;
+  uint64_t entrySize_ = 0;
+  int numObject_ = 0;
+
+  void RawWrite(const std::string& data) {
+    offset_ += data.size();
+    if (offset_ > 0xffffffff) throw ioErr("3MF files over 4 GB need ZIP64.");
+    file_.write(data.data(), data.size());
+  }
+
+  void Write(const std::string& data) {
+    Entry& entry = entries_.back();
+    entry.crc = Crc32(entry.crc, data.data(), data.size());
+    entrySize_ += data.size();
+    RawWrite(data);
+  }
+
+  void BeginEntry(const std::string& name) {
+    entries_.push_back({name, static_cast<uint32_t>(offset_), 0, 0});
+    entrySize_ = 0;
+    std::string header;
+    Put32(header, kLocalHeader);
+    Put16(header, 20);  // needed to extract
+    Put16(header, 0);   // flags
+    Put16(header, 0);   // stored
+    Put16(header, 0);   // time
+    Put16(header, kDosDate);
+    Put32(header, 0);  // CRC, patched by EndEntry()
+    Put32(header, 0);  // compressed size
+    Put32(header, 0);  // uncompressed size
+    Put16(header, name.size());
+    Put16(header, 0);  // extra field
+    RawWrite(header + name);
+  }
+
+  void EndEntry() {
+    Entry& entry = entries_.back();
+    entry.size = entrySize_;
+    std::string patch;
+    Put32(patch, entry.crc);
+    Put32(patch, entry.size);
+    Put32(patch, entry.size);
+    file_.seekp(entry.offset + 14);
+    file_.write(patch.data(), patch.size());
+    file_.seekp(offset_);
+  }
+
+  void AddEntry(const std::string& name, const std::string& content) {
+    BeginEntry(name);
+    Write(content);
+    EndEntry();
+  }
+};
+}  // namespace
+
+namespace manifold {
+
+std::unique_ptr<MeshWriter::Impl> Make3MFWriter(const std::string& filename) {
+  return std::make_unique<ThreeMFWriter>(filename);
+}
+
+/**
+ * Reads the meshes of a 3MF file's build, each placed by its item's
+ * transform, with components expanded. Only the core spec is read: colors,
+ * materials, units and slices are ignored.
+ */
+void Read3MF(const char* data, size_t size, Mesh& mesh) {
+  std::vector<char> inflated;
+  const char* xml;
+  size_t xmlSize;
+  FindModel(data, size, inflated, xml, xmlSize);
+
+  std::unordered_map<int, Object> objects;
+  std::vector<std::pair<int, mat4x3>> items;
+  Object* object = nullptr;
+  const char* end = xml + xmlSize;
+  for (const char* p = xml;;) {
+    p = static_cast<const char*>(std::memchr(p, '<', end - p));
+    if (p == nullptr) break;
+    ++p;
+    if (end - p >= 3 && std::memcmp(p, "!--", 3) == 0) {
+      const char* close = "-->";
+      p = std::search(p, end, close, close + 3);
+      continue;
+    }
+    const char* name = p;
+    while (p < end && !IsXmlSpace(*p) && *p != '/' && *p != '>') ++p;
+    const char* nameEnd = p;
+    // the attributes end at the first '>' outside of a quoted value
+    char quote = 0;
+    while (p < end && (quote != 0 || *p != '>')) {
+      if (quote != 0) {
+        if (*p == quote) quote = 0;
+      } else if (*p == '"' || *p == '\'') {
+        quote = *p;
+      }
+      ++p;
+    }
+    const char* attrs = nameEnd;
+    const char* attrsEnd = p;
+
+    if (IsTag(name, nameEnd, "object")) {
+      object = &objects[IntAttr(attrs, attrsEnd, "id")];
+    } else if (IsTag(name, nameEnd, "vertex") && object != nullptr) {
+      object->verts.push_back({RealAttr(attrs, attrsEnd, "x"),
+                               RealAttr(attrs, attrsEnd, "y"),
+                               RealAttr(attrs, attrsEnd, "z")});
+    } else if (IsTag(name, nameEnd, "triangle") && object != nullptr) {
+      object->tris.push_back({IntAttr(attrs, attrsEnd, "v1"),
+                              IntAttr(attrs, attrsEnd, "v2"),
+                              IntAttr(attrs, attrsEnd, "v3")});
+    } else if (IsTag(name, nameEnd, "component") && object != nullptr) {
+      object->components.push_back({IntAttr(attrs, attrsEnd, "objectid"),
+                                    TransformAttr(attrs, attrsEnd)});
+    } else if (IsTag(name, nameEnd, "item")) {
+      items.push_back({IntAttr(attrs, attrsEnd, "objectid"),
+                       TransformAttr(attrs, attrsEnd)});
+    }
+  }
+
+  for (const auto& item : items)
+    AddObject(objects, item.first, item.second, 0, mesh);
+}
+
+}  // namespace manifold
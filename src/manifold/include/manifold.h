@@ -14,7 +14,12 @@
 
 #pragma once
 #include <functional>
+#include <future>
+#include <iosfwd>
+#include <limits>
 #include <memory>
+#include <string>
+#include <tuple>
 
 #include "public.h"
 
@@ -52,20 +57,20 @@ class Manifold {
   Manifold(
       const Mesh&,
       const std::vector<glm::ivec3>& triProperties = std::vector<glm::ivec3>(),
-      const std::vector<float>& properties = std::vector<float>(),
-      const std::vector<float>& propertyTolerance = std::vector<float>());
+      const std::vector<Real>& properties = std::vector<Real>(),
+      const std::vector<Real>& propertyTolerance = std::vector<Real>());
 
   static Manifold Smooth(const Mesh&,
                          const std::vector<Smoothness>& sharpenedEdges = {});
   static Manifold Tetrahedron();
-  static Manifold Cube(glm::vec3 size = glm::vec3(1.0f), bool center = false);
-  static Manifold Cylinder(float height, float radiusLow,
-                           float radiusHigh = -1.0f, int circularSegments = 0,
+  static Manifold Cube(vec3 size = vec3(1.0f), bool center = false);
+  static Manifold Cylinder(Real height, Real radiusLow,
+                           Real radiusHigh = -1.0f, int circularSegments = 0,
                            bool center = false);
-  static Manifold Sphere(float radius, int circularSegments = 0);
-  static Manifold Extrude(Polygons crossSection, float height,
-                          int nDivisions = 0, float twistDegrees = 0.0f,
-                          glm::vec2 scaleTop = glm::vec2(1.0f));
+  static Manifold Sphere(Real radius, int circularSegments = 0);
+  static Manifold Extrude(Polygons crossSection, Real height,
+                          int nDivisions = 0, Real twistDegrees = 0.0f,
+                          vec2 scaleTop = vec2(1.0f));
   static Manifold Revolve(const Polygons& crossSection,
                           int circularSegments = 0);
   ///@}
@@ -87,10 +92,10 @@ class Manifold {
    * must be specified.
    */
   ///@{
-  static void SetMinCircularAngle(float degrees);
-  static void SetMinCircularEdgeLength(float length);
+  static void SetMinCircularAngle(Real degrees);
+  static void SetMinCircularEdgeLength(Real length);
   static void SetCircularSegments(int number);
-  static int GetCircularSegments(float radius);
+  static int GetCircularSegments(Real radius);
   ///@}
 
   /** @name Information
@@ -99,6 +104,9 @@ class Manifold {
   ///@{
   Mesh GetMesh() const;
   MeshGL GetMeshGL() const;
+  MeshGLLods GetMeshGLLods(std::vector<float> tolerances) const;
+  void WriteMeshGL(const MeshGLLayout& layout, void* vertBuffer,
+                   void* indexBuffer) const;
   bool IsEmpty() const;
   enum class Error {
     NO_ERROR,
@@ -108,16 +116,19 @@ class Manifold {
     PROPERTIES_WRONG_LENGTH,
     TRI_PROPERTIES_WRONG_LENGTH,
     TRI_PROPERTIES_OUT_OF_BOUNDS,
+    INVALID_SERIALIZATION,
   };
   Error Status() const;
   int NumVert() const;
   int NumEdge() const;
   int NumTri() const;
   Box BoundingBox() const;
-  float Precision() const;
+  Real Precision() const;
   int Genus() const;
   Properties GetProperties() const;
   Curvature GetCurvature() const;
+  MemoryUsage GetMemoryUsage() const;
+  std::vector<Polygons> Slices(const std::vector<Real>& heights) const;
   ///@}
 
   /** @name Relation
@@ -133,15 +144,19 @@ class Manifold {
   /** @name Modification
    */
   ///@{
-  Manifold Translate(glm::vec3) const;
-  Manifold Scale(glm::vec3) const;
-  Manifold Rotate(float xDegrees, float yDegrees = 0.0f,
-                  float zDegrees = 0.0f) const;
-  Manifold Transform(const glm::mat4x3&) const;
-  Manifold Warp(std::function<void(glm::vec3&)>) const;
+  Manifold Translate(vec3) const;
+  Manifold Scale(vec3) const;
+  Manifold Rotate(Real xDegrees, Real yDegrees = 0.0f,
+                  Real zDegrees = 0.0f) const;
+  Manifold Transform(const mat4x3&) const;
+  Manifold Warp(std::function<void(vec3&)>) const;
+  // defined in warp.h, which brings in the parallel backend
+  template <typename Func>
+  Manifold Warp(Func warpFunc, bool threadSafe) const;
   Manifold Refine(int) const;
-  // Manifold RefineToLength(float);
-  // Manifold RefineToPrecision(float);
+  Manifold RefineToLength(Real) const;
+  Manifold RefineToPrecision(Real) const;
+  Manifold Simplify(Real tolerance) const;
   ///@}
 
   /** @name Boolean
@@ -155,6 +170,8 @@ class Manifold {
   Manifold Boolean(const Manifold& second, OpType op) const;
   static Manifold BatchBoolean(const std::vector<Manifold>& manifolds,
                                OpType op);
+  static std::vector<Manifold> BooleanBatch(
+      const std::vector<std::tuple<Manifold, Manifold, OpType>>& jobs);
   // Boolean operation shorthand
   Manifold operator+(const Manifold&) const;  // ADD (Union)
   Manifold& operator+=(const Manifold&);
@@ -163,9 +180,89 @@ class Manifold {
   Manifold operator^(const Manifold&) const;  // INTERSECT
   Manifold& operator^=(const Manifold&);
   std::pair<Manifold, Manifold> Split(const Manifold&) const;
-  std::pair<Manifold, Manifold> SplitByPlane(glm::vec3 normal,
-                                             float originOffset) const;
-  Manifold TrimByPlane(glm::vec3 normal, float originOffset) const;
+  std::pair<Manifold, Manifold> SplitByPlane(vec3 normal,
+                                             Real originOffset) const;
+  Manifold TrimByPlane(vec3 normal, Real originOffset) const;
+  static void SetRobustPredicates(bool enable);
+  static bool RobustPredicates();
+  ///@}
+
+  /** @name Result cache
+   *  Opt-in process-wide cache of Boolean results, keyed by the structure and
+   *  content of the CSG subtree being evaluated.
+   */
+  ///@{
+  static void SetCacheBudget(size_t bytes);
+  static CacheStats GetCacheStats();
+  static void ClearCache();
+  std::vector<int> ChangedChildren() const;
+  ///@}
+
+  /** @name Asynchronous evaluation
+   *  Evaluate the lazy CSG tree of this manifold on another thread.
+   */
+  ///@{
+  /**
+   * Called with the number of op nodes evaluated so far and their total;
+   * returning false cancels the evaluation.
+   */
+  using ProgressCallback = std::function<bool(int done, int total)>;
+  std::future<Manifold> EvaluateAsync(
+      ProgressCallback progress = nullptr) const;
+  ///@}
+
+  /** @name Collision
+   *  Broad-phase contact queries between many manifolds, see CollisionScene.
+   */
+  ///@{
+  static std::vector<OverlapPair> Overlaps(const std::vector<Manifold>&);
+  ///@}
+
+  /** @name Point queries
+   *  Batched inside tests, distances and ray casts, accelerated by the face
+   *  collider.
+   */
+  ///@{
+  std::vector<bool> Contains(const std::vector<vec3>& points) const;
+  std::vector<Real> SignedDistance(
+      const std::vector<vec3>& points,
+      Real maxDistance = std::numeric_limits<Real>::infinity()) const;
+  void SignedDistance(
+      const vec3* points, Real* distances, int n,
+      Real maxDistance = std::numeric_limits<Real>::infinity()) const;
+  std::vector<RayHit> RayCast(
+      const std::vector<vec3>& origins, const std::vector<vec3>& directions,
+      Real maxDistance = std::numeric_limits<Real>::infinity()) const;
+  ///@}
+
+  /** @name Instrumentation
+   *  Statistics of the Boolean operations, process-wide or of one result, in
+   *  all builds, and an opt-in timeline of the CSG evaluation.
+   */
+  ///@{
+  BooleanStats GetResultStats() const;
+  static BooleanStats GetBooleanStats();
+  static void ResetBooleanStats();
+  static void StartTrace();
+  static std::string StopTrace();
+  ///@}
+
+  /** @name Cold storage
+   *  A compact in-memory form for manifolds kept around for reuse.
+   */
+  ///@{
+  Manifold Compact(int positionBits = 0) const;
+  bool IsCompact() const;
+  ///@}
+
+  /** @name Serialization
+   *  A versioned native binary format, which stores the manifold as it is held
+   *  in memory, so that loading rebuilds nothing.
+   */
+  ///@{
+  void Serialize(std::ostream& stream, bool withCollider = true) const;
+  static Manifold Deserialize(const void* data, size_t size);
+  static Manifold Deserialize(std::istream& stream);
   ///@}
 
   /** @name Testing hooks
@@ -187,10 +284,37 @@ class Manifold {
   mutable std::shared_ptr<CsgNode> pNode_;
 
   CsgLeafNode& GetCsgLeafNode() const;
+  friend class CollisionScene;
+
+  Manifold WarpVerts(std::function<void(vec3*, int)> warpVerts,
+                     bool onDevice) const;
 
   static int circularSegments_;
-  static float circularAngle_;
-  static float circularEdgeLength_;
+  static Real circularAngle_;
+  static Real circularEdgeLength_;
+};
+
+/**
+ * A broad-phase collision structure over a fixed set of manifolds, for
+ * workloads like nesting and packing that test many pairs for contact. One
+ * bounding volume hierarchy over the manifolds' bounding boxes finds the
+ * candidate pairs, whose overlaps are then counted with the face hierarchy of
+ * each manifold, all pairs in parallel.
+ */
+class CollisionScene {
+ public:
+  CollisionScene(const std::vector<Manifold>& manifolds);
+  ~CollisionScene();
+  CollisionScene(CollisionScene&&) noexcept;
+  CollisionScene& operator=(CollisionScene&&) noexcept;
+
+  int NumManifold() const;
+  std::vector<OverlapPair> Overlaps() const;
+  std::vector<std::pair<int, int>> Query(const Manifold& query) const;
+
+ private:
+  struct Impl;
+  std::unique_ptr<Impl> pImpl_;
 };
 /** @} */
 }  // namespace manifold
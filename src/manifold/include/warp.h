@@ -0,0 +1,47 @@
+// Copyright 2022 The Manifold Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include "manifold.h"
+#include "par.h"
+
+namespace manifold {
+
+/**
+ * Like Warp(std::function<void(vec3&)>), but with the function inlined into
+ * the loop over the vertices instead of called through a std::function. If
+ * threadSafe is set, the vertices are moved in parallel, so warpFunc must not
+ * have side effects beyond the vertex it is given; when built with CUDA it
+ * must also be a __host__ __device__ functor, as large meshes are warped on
+ * the GPU.
+ *
+ * This is kept out of manifold.h, as the loop is compiled in the caller's
+ * translation unit and so needs the parallel backend's headers; include this
+ * header to use it.
+ *
+ * @param warpFunc A functor that modifies a given vertex position.
+ * @param threadSafe Whether warpFunc may be called concurrently.
+ */
+template <typename Func>
+Manifold Manifold::Warp(Func warpFunc, bool threadSafe) const {
+  const ExecutionPolicy policy = threadSafe
+                                     ? autoPolicy(NumVert(), KernelCost::Heavy)
+                                     : ExecutionPolicy::Seq;
+  return WarpVerts(
+      [&warpFunc, policy](vec3* vertPos, int numVert) {
+        for_each_n(policy, vertPos, numVert, warpFunc);
+      },
+      policy == ExecutionPolicy::ParUnseq);
+}
+}  // namespace manifold
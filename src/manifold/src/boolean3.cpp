@@ -14,9 +14,12 @@
 
 #include "boolean3.h"
 
+#include <atomic>
 #include <limits>
+#include <mutex>
 
 #include "par.h"
+#include "trace.h"
 
 using namespace manifold;
 
@@ -25,40 +28,49 @@ namespace {
 // These two functions (Interpolate and Intersect) are the only places where
 // floating-point operations take place in the whole Boolean function. These are
 // carefully designed to minimize rounding error and to eliminate it at edge
-// cases to ensure consistency.
-
-__host__ __device__ glm::vec2 Interpolate(glm::vec3 pL, glm::vec3 pR, float x) {
-  float dxL = x - pL.x;
-  float dxR = x - pR.x;
+// cases to ensure consistency. They are evaluated in float, and in robust mode
+// also in double for the rare comparisons of their results that float cannot
+// decide, see NearTie().
+
+// Bound on the relative rounding error of Interpolate() and Intersect() in
+// float, with a safety margin.
+constexpr Real kFilter = 16 * std::numeric_limits<Real>::epsilon();
+
+template <typename T>
+__host__ __device__ glm::tvec2<T> Interpolate(glm::tvec3<T> pL,
+                                              glm::tvec3<T> pR, T x) {
+  T dxL = x - pL.x;
+  T dxR = x - pR.x;
 #ifdef MANIFOLD_DEBUG
   if (dxL * dxR > 0) printf("Not in domain!\n");
 #endif
   bool useL = fabs(dxL) < fabs(dxR);
-  float lambda = (useL ? dxL : dxR) / (pR.x - pL.x);
-  if (!isfinite(lambda)) return glm::vec2(pL.y, pL.z);
-  glm::vec2 yz;
+  T lambda = (useL ? dxL : dxR) / (pR.x - pL.x);
+  if (!isfinite(lambda)) return glm::tvec2<T>(pL.y, pL.z);
+  glm::tvec2<T> yz;
   yz[0] = (useL ? pL.y : pR.y) + lambda * (pR.y - pL.y);
   yz[1] = (useL ? pL.z : pR.z) + lambda * (pR.z - pL.z);
   return yz;
 }
 
-__host__ __device__ glm::vec4 Intersect(const glm::vec3 &pL,
-                                        const glm::vec3 &pR,
-                                        const glm::vec3 &qL,
-                                        const glm::vec3 &qR) {
-  float dyL = qL.y - pL.y;
-  float dyR = qR.y - pR.y;
+template <typename T>
+__host__ __device__ glm::tvec4<T> Intersect(const glm::tvec3<T> &pL,
+                                            const glm::tvec3<T> &pR,
+                                            const glm::tvec3<T> &qL,
+                                            const glm::tvec3<T> &qR) {
+  T dyL = qL.y - pL.y;
+  T dyR = qR.y - pR.y;
 #ifdef MANIFOLD_DEBUG
   if (dyL * dyR > 0) printf("No intersection!\n");
 #endif
   bool useL = fabs(dyL) < fabs(dyR);
-  float dx = pR.x - pL.x;
-  float lambda = (useL ? dyL : dyR) / (dyL - dyR);
-  if (!isfinite(lambda)) lambda = 0.0f;
-  glm::vec4 xyzz;
+  T dx = pR.x - pL.x;
+  T lambda = (useL ? dyL : dyR) / (dyL - dyR);
+  if (!isfinite(lambda)) lambda = 0;
+  glm::tvec4<T> xyzz;
   xyzz.x = (useL ? pL.x : pR.x) + lambda * dx;
-  float pDy = pR.y - pL.y;
-  float qDy = qR.y - qL.y;
+  T pDy = pR.y - pL.y;
+  T qDy = qR.y - qL.y;
   bool useP = fabs(pDy) < fabs(qDy);
   xyzz.y = (useL ? (useP ? pL.y : qL.y) : (useP ? pR.y : qR.y)) +
            lambda * (useP ? pDy : qDy);
@@ -67,10 +79,19 @@ __host__ __device__ glm::vec4 Intersect(const glm::vec3 &pL,
   return xyzz;
 }
 
+/**
+ * Whether a float result of Interpolate() or Intersect() of values up to scale
+ * in magnitude is too close to b for their comparison to be trusted. This is a
+ * floating-point filter: only these cases are escalated to double.
+ */
+__host__ __device__ bool NearTie(Real a, Real b, Real scale) {
+  return fabs(a - b) <= kFilter * scale;
+}
+
 struct CopyFaceEdges {
   // x can be either vert or edge (0 or 1).
   thrust::pair<int *, int *> pXq1;
-  const Halfedge *halfedgesQ;
+  HalfedgeCPtr halfedgesQ;
 
   __host__ __device__ void operator()(thrust::tuple<int, int, int> in) {
     int idx = 3 * thrust::get<0>(in);
@@ -102,7 +123,8 @@ SparseIndices Filter11(const Manifold::Impl &inP, const Manifold::Impl &inQ,
   return p1q1;
 }
 
-__host__ __device__ bool Shadows(float p, float q, float dir) {
+template <typename T>
+__host__ __device__ bool Shadows(T p, T q, T dir) {
   return p == q ? dir < 0 : p < q;
 }
 
@@ -117,33 +139,52 @@ __host__ __device__ bool Shadows(float p, float q, float dir) {
  * compiled function (they must agree on CPU or GPU). This is now taken care of
  * by the shared policy_ member.
  */
-__host__ __device__ thrust::pair<int, glm::vec2> Shadow01(
-    const int p0, const int q1, const glm::vec3 *vertPosP,
-    const glm::vec3 *vertPosQ, const Halfedge *halfedgeQ, const float expandP,
-    const glm::vec3 *normalP, const bool reverse) {
+__host__ __device__ thrust::pair<int, vec2> Shadow01(
+    const int p0, const int q1, const vec3 *vertPosP,
+    const vec3 *vertPosQ, HalfedgeCPtr halfedgeQ, const Real expandP,
+    const vec3 *normalP, const bool reverse, const bool robust,
+    int *numTie) {
   const int q1s = halfedgeQ[q1].startVert;
   const int q1e = halfedgeQ[q1].endVert;
-  const float p0x = vertPosP[p0].x;
-  const float q1sx = vertPosQ[q1s].x;
-  const float q1ex = vertPosQ[q1e].x;
+  const Real p0x = vertPosP[p0].x;
+  const Real q1sx = vertPosQ[q1s].x;
+  const Real q1ex = vertPosQ[q1e].x;
   int s01 = reverse ? Shadows(q1sx, p0x, expandP * normalP[q1s].x) -
                           Shadows(q1ex, p0x, expandP * normalP[q1e].x)
                     : Shadows(p0x, q1ex, expandP * normalP[p0].x) -
                           Shadows(p0x, q1sx, expandP * normalP[p0].x);
-  glm::vec2 yz01(NAN);
+  vec2 yz01(NAN);
 
   if (s01 != 0) {
-    yz01 = Interpolate(vertPosQ[q1s], vertPosQ[q1e], vertPosP[p0].x);
+    const vec3 posP = vertPosP[p0];
+    const vec3 posQs = vertPosQ[q1s];
+    const vec3 posQe = vertPosQ[q1e];
+    yz01 = Interpolate(posQs, posQe, posP.x);
+    Real dir;
     if (reverse) {
-      glm::vec3 diff = vertPosQ[q1s] - vertPosP[p0];
-      const float start2 = glm::dot(diff, diff);
-      diff = vertPosQ[q1e] - vertPosP[p0];
-      const float end2 = glm::dot(diff, diff);
-      const float dir = start2 < end2 ? normalP[q1s].y : normalP[q1e].y;
-      if (!Shadows(yz01[0], vertPosP[p0].y, expandP * dir)) s01 = 0;
+      vec3 diff = posQs - posP;
+      const Real start2 = glm::dot(diff, diff);
+      diff = posQe - posP;
+      const Real end2 = glm::dot(diff, diff);
+      dir = start2 < end2 ? normalP[q1s].y : normalP[q1e].y;
+    } else {
+      dir = normalP[p0].y;
+    }
+    bool shadows;
+    if (robust &&
+        NearTie(yz01[0], posP.y, glm::abs(posQs.y) + glm::abs(posQe.y))) {
+      AtomicAdd(*numTie, 1);
+      const glm::dvec2 yz = Interpolate(glm::dvec3(posQs), glm::dvec3(posQe),
+                                        static_cast<double>(posP.x));
+      const double y = posP.y;
+      shadows = reverse ? Shadows(yz[0], y, expandP * dir)
+                        : Shadows(y, yz[0], expandP * dir);
+      yz01 = vec2(yz);
     } else {
-      if (!Shadows(vertPosP[p0].y, yz01[0], expandP * normalP[p0].y)) s01 = 0;
+      shadows = reverse ? Shadows(yz01[0], posP.y, expandP * dir)
+                        : Shadows(posP.y, yz01[0], expandP * dir);
     }
+    if (!shadows) s01 = 0;
   }
   return thrust::make_pair(s01, yz01);
 }
@@ -172,23 +213,25 @@ __host__ __device__ int BinarySearch(
 }
 
 struct Kernel11 {
-  const glm::vec3 *vertPosP;
-  const glm::vec3 *vertPosQ;
-  const Halfedge *halfedgeP;
-  const Halfedge *halfedgeQ;
-  float expandP;
-  const glm::vec3 *normalP;
+  const vec3 *vertPosP;
+  const vec3 *vertPosQ;
+  HalfedgeCPtr halfedgeP;
+  HalfedgeCPtr halfedgeQ;
+  Real expandP;
+  const vec3 *normalP;
+  const bool robust;
+  int *numTie;
 
   __host__ __device__ void operator()(
-      thrust::tuple<glm::vec4 &, int &, int, int> inout) {
-    glm::vec4 &xyzz11 = thrust::get<0>(inout);
+      thrust::tuple<vec4 &, int &, int, int> inout) {
+    vec4 &xyzz11 = thrust::get<0>(inout);
     int &s11 = thrust::get<1>(inout);
     const int p1 = thrust::get<2>(inout);
     const int q1 = thrust::get<3>(inout);
 
     // For pRL[k], qRL[k], k==0 is the left and k==1 is the right.
     int k = 0;
-    glm::vec3 pRL[2], qRL[2];
+    vec3 pRL[2], qRL[2];
     // Either the left or right must shadow, but not both. This ensures the
     // intersection is between the left and right.
     bool shadows = false;
@@ -197,16 +240,16 @@ struct Kernel11 {
     const int p0[2] = {halfedgeP[p1].startVert, halfedgeP[p1].endVert};
     for (int i : {0, 1}) {
       const auto syz01 = Shadow01(p0[i], q1, vertPosP, vertPosQ, halfedgeQ,
-                                  expandP, normalP, false);
+                                  expandP, normalP, false, robust, numTie);
       const int s01 = syz01.first;
-      const glm::vec2 yz01 = syz01.second;
+      const vec2 yz01 = syz01.second;
       // If the value is NaN, then these do not overlap.
       if (isfinite(yz01[0])) {
         s11 += s01 * (i == 0 ? -1 : 1);
         if (k < 2 && (k == 0 || (s01 != 0) != shadows)) {
           shadows = s01 != 0;
           pRL[k] = vertPosP[p0[i]];
-          qRL[k] = glm::vec3(pRL[k].x, yz01);
+          qRL[k] = vec3(pRL[k].x, yz01);
           ++k;
         }
       }
@@ -215,23 +258,23 @@ struct Kernel11 {
     const int q0[2] = {halfedgeQ[q1].startVert, halfedgeQ[q1].endVert};
     for (int i : {0, 1}) {
       const auto syz10 = Shadow01(q0[i], p1, vertPosQ, vertPosP, halfedgeP,
-                                  expandP, normalP, true);
+                                  expandP, normalP, true, robust, numTie);
       const int s10 = syz10.first;
-      const glm::vec2 yz10 = syz10.second;
+      const vec2 yz10 = syz10.second;
       // If the value is NaN, then these do not overlap.
       if (isfinite(yz10[0])) {
         s11 += s10 * (i == 0 ? -1 : 1);
         if (k < 2 && (k == 0 || (s10 != 0) != shadows)) {
           shadows = s10 != 0;
           qRL[k] = vertPosQ[q0[i]];
-          pRL[k] = glm::vec3(qRL[k].x, yz10);
+          pRL[k] = vec3(qRL[k].x, yz10);
           ++k;
         }
       }
     }
 
     if (s11 == 0) {  // No intersection
-      xyzz11 = glm::vec4(NAN);
+      xyzz11 = vec4(NAN);
     } else {
 #ifdef MANIFOLD_DEBUG
       // Assert left and right were both found
@@ -243,31 +286,46 @@ struct Kernel11 {
 
       const int p1s = halfedgeP[p1].startVert;
       const int p1e = halfedgeP[p1].endVert;
-      glm::vec3 diff = vertPosP[p1s] - glm::vec3(xyzz11);
-      const float start2 = glm::dot(diff, diff);
-      diff = vertPosP[p1e] - glm::vec3(xyzz11);
-      const float end2 = glm::dot(diff, diff);
-      const float dir = start2 < end2 ? normalP[p1s].z : normalP[p1e].z;
-
-      if (!Shadows(xyzz11.z, xyzz11.w, expandP * dir)) s11 = 0;
+      vec3 diff = vertPosP[p1s] - vec3(xyzz11);
+      const Real start2 = glm::dot(diff, diff);
+      diff = vertPosP[p1e] - vec3(xyzz11);
+      const Real end2 = glm::dot(diff, diff);
+      const Real dir = start2 < end2 ? normalP[p1s].z : normalP[p1e].z;
+
+      bool shadows11;
+      if (robust &&
+          NearTie(xyzz11.z, xyzz11.w,
+                  glm::abs(pRL[0].z) + glm::abs(pRL[1].z) +
+                      glm::abs(qRL[0].z) + glm::abs(qRL[1].z))) {
+        AtomicAdd(*numTie, 1);
+        const glm::dvec4 xyzz =
+            Intersect(glm::dvec3(pRL[0]), glm::dvec3(pRL[1]),
+                      glm::dvec3(qRL[0]), glm::dvec3(qRL[1]));
+        shadows11 = Shadows(xyzz.z, xyzz.w, expandP * dir);
+        xyzz11 = vec4(xyzz);
+      } else {
+        shadows11 = Shadows(xyzz11.z, xyzz11.w, expandP * dir);
+      }
+      if (!shadows11) s11 = 0;
     }
   }
 };
 
-std::tuple<VecDH<int>, VecDH<glm::vec4>> Shadow11(SparseIndices &p1q1,
-                                                  const Manifold::Impl &inP,
-                                                  const Manifold::Impl &inQ,
-                                                  float expandP,
-                                                  ExecutionPolicy policy) {
+std::tuple<VecDH<int>, VecDH<vec4>> Shadow11(SparseIndices &p1q1,
+                                             const Manifold::Impl &inP,
+                                             const Manifold::Impl &inQ,
+                                             Real expandP, bool robust,
+                                             int *numTie,
+                                             ExecutionPolicy policy) {
   VecDH<int> s11(p1q1.size());
-  VecDH<glm::vec4> xyzz11(p1q1.size());
+  VecDH<vec4> xyzz11(p1q1.size());
 
   for_each_n(policy,
              zip(xyzz11.begin(), s11.begin(), p1q1.begin(0), p1q1.begin(1)),
              p1q1.size(),
              Kernel11({inP.vertPos_.cptrD(), inQ.vertPos_.cptrD(),
                        inP.halfedge_.cptrD(), inQ.halfedge_.cptrD(), expandP,
-                       inP.vertNormal_.cptrD()}));
+                       inP.vertNormal_.cptrD(), robust, numTie}));
 
   p1q1.KeepFinite(xyzz11, s11);
 
@@ -275,31 +333,33 @@ std::tuple<VecDH<int>, VecDH<glm::vec4>> Shadow11(SparseIndices &p1q1,
 };
 
 struct Kernel02 {
-  const glm::vec3 *vertPosP;
-  const Halfedge *halfedgeQ;
-  const glm::vec3 *vertPosQ;
+  const vec3 *vertPosP;
+  HalfedgeCPtr halfedgeQ;
+  const vec3 *vertPosQ;
   const bool forward;
-  const float expandP;
-  const glm::vec3 *vertNormalP;
+  const Real expandP;
+  const vec3 *vertNormalP;
+  const bool robust;
+  int *numTie;
 
   __host__ __device__ void operator()(
-      thrust::tuple<int &, float &, int, int> inout) {
+      thrust::tuple<int &, Real &, int, int> inout) {
     int &s02 = thrust::get<0>(inout);
-    float &z02 = thrust::get<1>(inout);
+    Real &z02 = thrust::get<1>(inout);
     const int p0 = thrust::get<2>(inout);
     const int q2 = thrust::get<3>(inout);
 
     // For yzzLR[k], k==0 is the left and k==1 is the right.
     int k = 0;
-    glm::vec3 yzzRL[2];
+    vec3 yzzRL[2];
     // Either the left or right must shadow, but not both. This ensures the
     // intersection is between the left and right.
     bool shadows = false;
     int closestVert = -1;
-    float minMetric = std::numeric_limits<float>::infinity();
+    Real minMetric = std::numeric_limits<Real>::infinity();
     s02 = 0;
 
-    const glm::vec3 posP = vertPosP[p0];
+    const vec3 posP = vertPosP[p0];
     for (const int i : {0, 1, 2}) {
       const int q1 = 3 * q2 + i;
       const Halfedge edge = halfedgeQ[q1];
@@ -307,8 +367,8 @@ struct Kernel02 {
 
       if (!forward) {
         const int qVert = halfedgeQ[q1F].startVert;
-        const glm::vec3 diff = posP - vertPosQ[qVert];
-        const float metric = glm::dot(diff, diff);
+        const vec3 diff = posP - vertPosQ[qVert];
+        const Real metric = glm::dot(diff, diff);
         if (metric < minMetric) {
           minMetric = metric;
           closestVert = qVert;
@@ -316,15 +376,16 @@ struct Kernel02 {
       }
 
       const auto syz01 = Shadow01(p0, q1F, vertPosP, vertPosQ, halfedgeQ,
-                                  expandP, vertNormalP, !forward);
+                                  expandP, vertNormalP, !forward, robust,
+                                  numTie);
       const int s01 = syz01.first;
-      const glm::vec2 yz01 = syz01.second;
+      const vec2 yz01 = syz01.second;
       // If the value is NaN, then these do not overlap.
       if (isfinite(yz01[0])) {
         s02 += s01 * (forward == edge.IsForward() ? -1 : 1);
         if (k < 2 && (k == 0 || (s01 != 0) != shadows)) {
           shadows = s01 != 0;
-          yzzRL[k++] = glm::vec3(yz01[0], yz01[1], yz01[1]);
+          yzzRL[k++] = vec3(yz01[0], yz01[1], yz01[1]);
         }
       }
     }
@@ -338,26 +399,37 @@ struct Kernel02 {
         printf("k = %d\n", k);
       }
 #endif
-      glm::vec3 vertPos = vertPosP[p0];
+      vec3 vertPos = vertPosP[p0];
       z02 = Interpolate(yzzRL[0], yzzRL[1], vertPos.y)[1];
-      if (forward) {
-        if (!Shadows(vertPos.z, z02, expandP * vertNormalP[p0].z)) s02 = 0;
+      // ASSERT(closestVert != -1, topologyErr, "No closest vert");
+      const Real dir = forward ? vertNormalP[p0].z : vertNormalP[closestVert].z;
+      bool shadows02;
+      if (robust && NearTie(z02, vertPos.z,
+                            glm::abs(yzzRL[0].z) + glm::abs(yzzRL[1].z))) {
+        AtomicAdd(*numTie, 1);
+        const double z = Interpolate(glm::dvec3(yzzRL[0]), glm::dvec3(yzzRL[1]),
+                                     static_cast<double>(vertPos.y))[1];
+        const double posZ = vertPos.z;
+        shadows02 = forward ? Shadows(posZ, z, expandP * dir)
+                            : Shadows(z, posZ, expandP * dir);
+        z02 = z;
       } else {
-        // ASSERT(closestVert != -1, topologyErr, "No closest vert");
-        if (!Shadows(z02, vertPos.z, expandP * vertNormalP[closestVert].z))
-          s02 = 0;
+        shadows02 = forward ? Shadows(vertPos.z, z02, expandP * dir)
+                            : Shadows(z02, vertPos.z, expandP * dir);
       }
+      if (!shadows02) s02 = 0;
     }
   }
 };
 
-std::tuple<VecDH<int>, VecDH<float>> Shadow02(const Manifold::Impl &inP,
-                                              const Manifold::Impl &inQ,
-                                              SparseIndices &p0q2, bool forward,
-                                              float expandP,
-                                              ExecutionPolicy policy) {
+std::tuple<VecDH<int>, VecDH<Real>> Shadow02(const Manifold::Impl &inP,
+                                             const Manifold::Impl &inQ,
+                                             SparseIndices &p0q2, bool forward,
+                                             Real expandP, bool robust,
+                                             int *numTie,
+                                             ExecutionPolicy policy) {
   VecDH<int> s02(p0q2.size());
-  VecDH<float> z02(p0q2.size());
+  VecDH<Real> z02(p0q2.size());
 
   auto vertNormalP =
       forward ? inP.vertNormal_.cptrD() : inQ.vertNormal_.cptrD();
@@ -366,7 +438,8 @@ std::tuple<VecDH<int>, VecDH<float>> Shadow02(const Manifold::Impl &inP,
       zip(s02.begin(), z02.begin(), p0q2.begin(!forward), p0q2.begin(forward)),
       p0q2.size(),
       Kernel02({inP.vertPos_.cptrD(), inQ.halfedge_.cptrD(),
-                inQ.vertPos_.cptrD(), forward, expandP, vertNormalP}));
+                inQ.vertPos_.cptrD(), forward, expandP, vertNormalP,
+                robust, numTie}));
 
   p0q2.KeepFinite(z02, s02);
 
@@ -376,28 +449,28 @@ std::tuple<VecDH<int>, VecDH<float>> Shadow02(const Manifold::Impl &inP,
 struct Kernel12 {
   const thrust::pair<const int *, const int *> p0q2;
   const int *s02;
-  const float *z02;
+  const Real *z02;
   const int size02;
   const thrust::pair<const int *, const int *> p1q1;
   const int *s11;
-  const glm::vec4 *xyzz11;
+  const vec4 *xyzz11;
   const int size11;
-  const Halfedge *halfedgesP;
-  const Halfedge *halfedgesQ;
-  const glm::vec3 *vertPosP;
+  HalfedgeCPtr halfedgesP;
+  HalfedgeCPtr halfedgesQ;
+  const vec3 *vertPosP;
   const bool forward;
 
   __host__ __device__ void operator()(
-      thrust::tuple<int &, glm::vec3 &, int, int> inout) {
+      thrust::tuple<int &, vec3 &, int, int> inout) {
     int &x12 = thrust::get<0>(inout);
-    glm::vec3 &v12 = thrust::get<1>(inout);
+    vec3 &v12 = thrust::get<1>(inout);
     const int p1 = thrust::get<2>(inout);
     const int q2 = thrust::get<3>(inout);
 
     // For xzyLR-[k], k==0 is the left and k==1 is the right.
     int k = 0;
-    glm::vec3 xzyLR0[2];
-    glm::vec3 xzyLR1[2];
+    vec3 xzyLR0[2];
+    vec3 xzyLR1[2];
     // Either the left or right must shadow, but not both. This ensures the
     // intersection is between the left and right.
     bool shadows = false;
@@ -435,7 +508,7 @@ struct Kernel12 {
         x12 -= s * (edge.IsForward() ? 1 : -1);
         if (k < 2 && (k == 0 || (s != 0) != shadows)) {
           shadows = s != 0;
-          const glm::vec4 xyzz = xyzz11[idx];
+          const vec4 xyzz = xyzz11[idx];
           xzyLR0[k][0] = xyzz.x;
           xzyLR0[k][1] = xyzz.z;
           xzyLR0[k][2] = xyzz.y;
@@ -448,7 +521,7 @@ struct Kernel12 {
     }
 
     if (x12 == 0) {  // No intersection
-      v12 = glm::vec3(NAN);
+      v12 = vec3(NAN);
     } else {
 #ifdef MANIFOLD_DEBUG
       // Assert left and right were both found
@@ -456,8 +529,7 @@ struct Kernel12 {
         printf("k = %d\n", k);
       }
 #endif
-      const glm::vec4 xzyy =
-          Intersect(xzyLR0[0], xzyLR0[1], xzyLR1[0], xzyLR1[1]);
+      const vec4 xzyy = Intersect(xzyLR0[0], xzyLR0[1], xzyLR1[0], xzyLR1[1]);
       v12.x = xzyy[0];
       v12.y = xzyy[2];
       v12.z = xzyy[1];
@@ -465,13 +537,13 @@ struct Kernel12 {
   }
 };
 
-std::tuple<VecDH<int>, VecDH<glm::vec3>> Intersect12(
+std::tuple<VecDH<int>, VecDH<vec3>> Intersect12(
     const Manifold::Impl &inP, const Manifold::Impl &inQ, const VecDH<int> &s02,
     const SparseIndices &p0q2, const VecDH<int> &s11, const SparseIndices &p1q1,
-    const VecDH<float> &z02, const VecDH<glm::vec4> &xyzz11,
+    const VecDH<Real> &z02, const VecDH<vec4> &xyzz11,
     SparseIndices &p1q2, bool forward, ExecutionPolicy policy) {
   VecDH<int> x12(p1q2.size());
-  VecDH<glm::vec3> v12(p1q2.size());
+  VecDH<vec3> v12(p1q2.size());
 
   for_each_n(
       policy,
@@ -508,6 +580,78 @@ VecDH<int> Winding03(const Manifold::Impl &inP, SparseIndices &p0q2,
               thrust::negate<int>());
   return w03;
 };
+
+struct IsRootVert {
+  const int *vertRoot;
+
+  __host__ __device__ bool operator()(int vert) {
+    return vertRoot[vert] == vert;
+  }
+};
+
+struct RootWinding {
+  const int *vertRoot;
+  const int *rootWinding;
+
+  __host__ __device__ int operator()(int vert) {
+    return rootWinding[vertRoot[vert]];
+  }
+};
+
+// Winding numbers of the verts of inP with respect to inQ if forward, else
+// those of inQ with respect to inP, for surfaces that don't touch. Then each
+// connected component is wholly inside or outside the other mesh, so only the
+// root vert of each component is tested. Sets uniform if all components share
+// one winding number.
+VecDH<int> ComponentWinding(const Manifold::Impl &inP,
+                            const Manifold::Impl &inQ, Real expandP,
+                            bool robust, int *numTie, bool forward,
+                            bool &uniform) {
+  const Manifold::Impl &vertMesh = forward ? inP : inQ;
+  const Manifold::Impl &faceMesh = forward ? inQ : inP;
+  const int numVert = vertMesh.NumVert();
+  auto policy = autoPolicy(numVert);
+  const VecDH<int> vertRoot = vertMesh.VertRoots();
+
+  VecDH<int> roots(numVert);
+  const int numRoot =
+      copy_if<decltype(roots.begin())>(policy, countAt(0), countAt(numVert),
+                                       roots.begin(),
+                                       IsRootVert({vertRoot.cptrD()})) -
+      roots.begin();
+  roots.resize(numRoot);
+  VecDH<vec3> rootPos(numRoot);
+  gather(policy, roots.begin(), roots.end(), vertMesh.vertPos_.begin(),
+         rootPos.begin());
+
+  // The queries are numbered by root; refer to them by vert instead, which
+  // keeps them grouped as the roots are ascending.
+  SparseIndices p0q2 = faceMesh.VertexCollisionsZ(rootPos);
+  const VecDH<int> query = p0q2.Copy(false);
+  gather(autoPolicy(query.size()), query.begin(), query.end(), roots.begin(),
+         p0q2.begin(false));
+  if (!forward) p0q2.SwapPQ();
+  VecDH<int> s02;
+  VecDH<Real> z02;
+  std::tie(s02, z02) = Shadow02(vertMesh, faceMesh, p0q2, forward, expandP,
+                                robust, numTie, autoPolicy(p0q2.size()));
+  const VecDH<int> rootWinding =
+      Winding03(vertMesh, p0q2, s02, !forward, autoPolicy(p0q2.size()));
+
+  uniform = true;
+  const int *rootH = roots.cptrH();
+  for (int i = 1; i < numRoot && uniform; ++i)
+    uniform = rootWinding[rootH[i]] == rootWinding[rootH[0]];
+
+  VecDH<int> winding(numVert);
+  transform(policy, countAt(0), countAt(numVert), winding.begin(),
+            RootWinding({vertRoot.cptrD(), rootWinding.cptrD()}));
+  return winding;
+}
+
+std::mutex statsMutex;
+BooleanStats totals;
+std::atomic<bool> robustPredicates(false);
 }  // namespace
 
 namespace manifold {
@@ -521,15 +665,17 @@ Boolean3::Boolean3(const Manifold::Impl &inP, const Manifold::Impl &inQ,
   // Union -> expand inP
   // Difference, Intersection -> contract inP
 
-#ifdef MANIFOLD_DEBUG
-  Timer broad;
-  broad.Start();
-#endif
+  PhaseClock clock(stats_);
+  TraceSpan span("Boolean3");
+  span.Arg("numVertP", inP.NumVert());
+  span.Arg("numVertQ", inQ.NumVert());
 
   if (inP.IsEmpty() || inQ.IsEmpty() || !inP.bBox_.DoesOverlap(inQ.bBox_)) {
     PRINT("No overlap, early out");
     w03_.resize(inP.NumVert(), 0);
     w30_.resize(inQ.NumVert(), 0);
+    separate_ = true;
+    clock.Lap(BooleanStats::Collide);
     return;
   }
 
@@ -538,54 +684,84 @@ Boolean3::Boolean3(const Manifold::Impl &inP, const Manifold::Impl &inQ,
   p1q2_ = inQ_.EdgeCollisions(inP_);
   p2q1_ = inP_.EdgeCollisions(inQ_);
 
-  policy_ = autoPolicy(glm::max(p1q2_.size(), p2q1_.size()));
-  p1q2_.Sort(policy_);
+  if (p1q2_.size() == 0 && p2q1_.size() == 0) {
+    // No edge comes near a face of the other mesh, so the surfaces don't
+    // touch and all the verts of each connected component share a winding
+    // number, which one of its verts decides. Only if all the components of
+    // each mesh agree is each mesh kept whole or dropped; otherwise Result()
+    // assembles the components that are kept.
+    PRINT("Separate surfaces, early out");
+    clock.Lap(BooleanStats::Collide);
+    const bool robust = RobustPredicates();
+    VecDH<int> numTie(1, 0);
+    bool uniformP, uniformQ;
+    w03_ = ComponentWinding(inP, inQ, expandP_, robust, numTie.ptrD(), true,
+                            uniformP);
+    w30_ = ComponentWinding(inP, inQ, expandP_, robust, numTie.ptrD(), false,
+                            uniformQ);
+    separate_ = uniformP && uniformQ;
+    stats_.robustTies = numTie[0];
+    clock.Lap(BooleanStats::Winding03);
+    return;
+  }
+
+  // policy_ is shared by the intersection and winding kernels below
+  policy_ =
+      autoPolicy(glm::max(p1q2_.size(), p2q1_.size()), KernelCost::Heavy);
+  p1q2_.Sort(autoPolicy(p1q2_.size(), KernelCost::Sort));
   PRINT("p1q2 size = " << p1q2_.size());
 
   p2q1_.SwapPQ();
-  p2q1_.Sort(policy_);
+  p2q1_.Sort(autoPolicy(p2q1_.size(), KernelCost::Sort));
   PRINT("p2q1 size = " << p2q1_.size());
 
   // Level 2
   // Find vertices that overlap faces in XY-projection
   SparseIndices p0q2 = inQ.VertexCollisionsZ(inP.vertPos_);
-  p0q2.Sort(policy_);
+  p0q2.Sort(autoPolicy(p0q2.size(), KernelCost::Sort));
   PRINT("p0q2 size = " << p0q2.size());
 
   SparseIndices p2q0 = inP.VertexCollisionsZ(inQ.vertPos_);
   p2q0.SwapPQ();
-  p2q0.Sort(policy_);
+  p2q0.Sort(autoPolicy(p2q0.size(), KernelCost::Sort));
   PRINT("p2q0 size = " << p2q0.size());
+  clock.Lap(BooleanStats::Collide);
+  span.Arg("p1q2", p1q2_.size());
+  span.Arg("p2q1", p2q1_.size());
 
   // Find involved edge pairs from Level 3
   SparseIndices p1q1 = Filter11(inP_, inQ_, p1q2_, p2q1_, policy_);
   PRINT("p1q1 size = " << p1q1.size());
-
-#ifdef MANIFOLD_DEBUG
-  broad.Stop();
-  Timer intersections;
-  intersections.Start();
-#endif
+  clock.Lap(BooleanStats::Filter11);
 
   // Level 2
   // Build up XY-projection intersection of two edges, including the z-value for
   // each edge, keeping only those whose intersection exists.
   VecDH<int> s11;
-  VecDH<glm::vec4> xyzz11;
-  std::tie(s11, xyzz11) = Shadow11(p1q1, inP, inQ, expandP_, policy_);
+  VecDH<vec4> xyzz11;
+  const bool robust = RobustPredicates();
+  // comparisons re-evaluated in double, counted for the stats
+  VecDH<int> numTie(1, 0);
+  std::tie(s11, xyzz11) =
+      Shadow11(p1q1, inP, inQ, expandP_, robust, numTie.ptrD(), policy_);
   PRINT("s11 size = " << s11.size());
+  clock.Lap(BooleanStats::Shadow11);
 
   // Build up Z-projection of vertices onto triangles, keeping only those that
   // fall inside the triangle.
   VecDH<int> s02;
-  VecDH<float> z02;
-  std::tie(s02, z02) = Shadow02(inP, inQ, p0q2, true, expandP_, policy_);
+  VecDH<Real> z02;
+  std::tie(s02, z02) =
+      Shadow02(inP, inQ, p0q2, true, expandP_, robust, numTie.ptrD(), policy_);
   PRINT("s02 size = " << s02.size());
 
   VecDH<int> s20;
-  VecDH<float> z20;
-  std::tie(s20, z20) = Shadow02(inQ, inP, p2q0, false, expandP_, policy_);
+  VecDH<Real> z20;
+  std::tie(s20, z20) =
+      Shadow02(inQ, inP, p2q0, false, expandP_, robust, numTie.ptrD(),
+               policy_);
   PRINT("s20 size = " << s20.size());
+  clock.Lap(BooleanStats::Shadow02);
 
   // Level 3
   // Build up the intersection of the edges and triangles, keeping only those
@@ -598,20 +774,75 @@ Boolean3::Boolean3(const Manifold::Impl &inP, const Manifold::Impl &inQ,
   std::tie(x21_, v21_) = Intersect12(inQ, inP, s20, p2q0, s11, p1q1, z20,
                                      xyzz11, p2q1_, false, policy_);
   PRINT("x21 size = " << x21_.size());
+  clock.Lap(BooleanStats::Intersect12);
 
   // Sum up the winding numbers of all vertices.
   w03_ = Winding03(inP, p0q2, s02, false, policy_);
 
   w30_ = Winding03(inQ, p2q0, s20, true, policy_);
+  clock.Lap(BooleanStats::Winding03);
+
+  stats_.p1q2 = p1q2_.size();
+  stats_.p2q1 = p2q1_.size();
+  stats_.p0q2 = p0q2.size();
+  stats_.p2q0 = p2q0.size();
+  stats_.p1q1 = p1q1.size();
+  stats_.s11 = s11.size();
+  stats_.s02 = s02.size();
+  stats_.s20 = s20.size();
+  stats_.x12 = x12_.size();
+  stats_.x21 = x21_.size();
+  stats_.robustTies = numTie[0];
 
 #ifdef MANIFOLD_DEBUG
-  intersections.Stop();
-
   if (ManifoldParams().verbose) {
-    broad.Print("Broad phase");
-    intersections.Print("Intersections");
     MemUsage();
   }
 #endif
 }
+
+/**
+ * Completes the stats of this operation and attaches them to its result,
+ * added to those of the operands, so that concurrent Booleans can be told
+ * apart. They are also added to the process-wide totals, on the first call
+ * only.
+ */
+void Boolean3::Publish(BooleanStats& stats, Manifold::Impl& result) const {
+  stats.numBoolean = 1;
+  stats.maxSeconds = stats.TotalSeconds();
+  if (pool_.Pool() != nullptr) {
+    stats.bytesRequested = pool_.Pool()->BytesRequested();
+    stats.bytesAllocated = pool_.Pool()->BytesAllocated();
+  }
+  auto history = std::make_shared<BooleanStats>(stats);
+  if (inP_.booleanStats_ != nullptr) *history += *inP_.booleanStats_;
+  if (inQ_.booleanStats_ != nullptr) *history += *inQ_.booleanStats_;
+  result.booleanStats_ = history;
+  if (published_.exchange(true)) return;
+#ifdef MANIFOLD_DEBUG
+  if (ManifoldParams().verbose) {
+    for (int i = 0; i < BooleanStats::kNumPhase; ++i) {
+      const auto phase = static_cast<BooleanStats::Phase>(i);
+      std::cout << "----------- " << std::round(1000 * stats.seconds[i])
+                << " ms for " << BooleanStats::PhaseName(phase) << std::endl;
+    }
+  }
+#endif
+  std::lock_guard<std::mutex> lock(statsMutex);
+  totals += stats;
+}
+
+BooleanStats GetBooleanStats() {
+  std::lock_guard<std::mutex> lock(statsMutex);
+  return totals;
+}
+
+void ResetBooleanStats() {
+  std::lock_guard<std::mutex> lock(statsMutex);
+  totals = BooleanStats();
+}
+
+void SetRobustPredicates(bool enable) { robustPredicates.store(enable); }
+
+bool RobustPredicates() { return robustPredicates.load(); }
 }  // namespace manifold
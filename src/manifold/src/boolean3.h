@@ -13,6 +13,9 @@
 // limitations under the License.
 
 #pragma once
+#include <atomic>
+#include <chrono>
+
 #include "impl.h"
 
 #ifdef MANIFOLD_DEBUG
@@ -44,7 +47,37 @@
 
 namespace manifold {
 
-/** @ingroup Private */
+/** @addtogroup Private
+ *  @{
+ */
+BooleanStats GetBooleanStats();
+void ResetBooleanStats();
+void SetRobustPredicates(bool enable);
+bool RobustPredicates();
+
+/**
+ * Accumulates wall time into the phases of a BooleanStats, each Lap() closing
+ * the phase that has run since the previous one.
+ */
+class PhaseClock {
+ public:
+  explicit PhaseClock(BooleanStats& stats) : stats_(stats), last_(Now()) {}
+
+  void Lap(BooleanStats::Phase phase) {
+    const auto now = Now();
+    stats_.seconds[phase] += std::chrono::duration<double>(now - last_).count();
+    last_ = now;
+  }
+
+ private:
+  BooleanStats& stats_;
+  std::chrono::steady_clock::time_point last_;
+
+  static std::chrono::steady_clock::time_point Now() {
+    return std::chrono::steady_clock::now();
+  }
+};
+
 class Boolean3 {
  public:
   Boolean3(const Manifold::Impl& inP, const Manifold::Impl& inQ,
@@ -52,11 +85,24 @@ class Boolean3 {
   Manifold::Impl Result(Manifold::OpType op) const;
 
  private:
+  // First, so that it outlives the temporaries it serves.
+  MemoryPoolScope pool_;
   const Manifold::Impl &inP_, &inQ_;
-  const float expandP_;
+  const Real expandP_;
   SparseIndices p1q2_, p2q1_;
   VecDH<int> x12_, x21_, w03_, w30_;
-  VecDH<glm::vec3> v12_, v21_;
+  VecDH<vec3> v12_, v21_;
   ExecutionPolicy policy_;
+  // Whether the surfaces are apart, so that each mesh is entirely inside or
+  // outside the other.
+  bool separate_ = false;
+  // The constructor's part; Result() completes and publishes a copy.
+  BooleanStats stats_;
+  // Set by the first Publish(), so that an operation whose Result() is taken
+  // more than once, as by Split(), is counted once in the totals.
+  mutable std::atomic<bool> published_{false};
+
+  void Publish(BooleanStats& stats, Manifold::Impl& result) const;
 };
+/** @} */
 }  // namespace manifold
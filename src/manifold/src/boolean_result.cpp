@@ -13,11 +13,11 @@
 // limitations under the License.
 
 #include <algorithm>
-#include <map>
 
 #include "boolean3.h"
 #include "par.h"
 #include "polygon.h"
+#include "trace.h"
 
 using namespace manifold;
 using namespace thrust::placeholders;
@@ -29,12 +29,12 @@ struct AbsSum : public thrust::binary_function<int, int, int> {
 };
 
 struct DuplicateVerts {
-  glm::vec3 *vertPosR;
+  vec3 *vertPosR;
 
-  __host__ __device__ void operator()(thrust::tuple<int, int, glm::vec3> in) {
+  __host__ __device__ void operator()(thrust::tuple<int, int, vec3> in) {
     int inclusion = abs(thrust::get<0>(in));
     int vertR = thrust::get<1>(in);
-    glm::vec3 vertPosP = thrust::get<2>(in);
+    vec3 vertPosP = thrust::get<2>(in);
 
     for (int i = 0; i < inclusion; ++i) {
       vertPosR[vertR + i] = vertPosP;
@@ -46,15 +46,17 @@ struct CountVerts {
   int *count;
   const int *inclusion;
 
-  __host__ __device__ void operator()(const Halfedge &edge) {
-    AtomicAdd(count[edge.face], glm::abs(inclusion[edge.startVert]));
+  __host__ __device__ void operator()(thrust::tuple<int, int> edge) {
+    const int face = thrust::get<0>(edge);
+    const int startVert = thrust::get<1>(edge);
+    AtomicAdd(count[face], glm::abs(inclusion[startVert]));
   }
 };
 
 struct CountNewVerts {
   int *countP;
   int *countQ;
-  const Halfedge *halfedges;
+  HalfedgeCPtr halfedges;
 
   __host__ __device__ void operator()(thrust::tuple<int, int, int> in) {
     int edgeP = thrust::get<0>(in);
@@ -81,10 +83,12 @@ std::tuple<VecDH<int>, VecDH<int>> SizeOutput(
   auto sidesPerFaceP = sidesPerFacePQ.ptrD();
   auto sidesPerFaceQ = sidesPerFacePQ.ptrD() + inP.NumTri();
 
-  for_each(policy, inP.halfedge_.begin(), inP.halfedge_.end(),
-           CountVerts({sidesPerFaceP, i03.cptrD()}));
-  for_each(policy, inQ.halfedge_.begin(), inQ.halfedge_.end(),
-           CountVerts({sidesPerFaceQ, i30.cptrD()}));
+  for_each_n(policy,
+             zip(inP.halfedge_.face.begin(), inP.halfedge_.startVert.begin()),
+             inP.halfedge_.size(), CountVerts({sidesPerFaceP, i03.cptrD()}));
+  for_each_n(policy,
+             zip(inQ.halfedge_.face.begin(), inQ.halfedge_.startVert.begin()),
+             inQ.halfedge_.size(), CountVerts({sidesPerFaceQ, i30.cptrD()}));
   for_each_n(
       policy, zip(p1q2.begin(0), p1q2.begin(1), i12.begin()), i12.size(),
       CountNewVerts({sidesPerFaceP, sidesPerFaceQ, inP.halfedge_.cptrD()}));
@@ -106,9 +110,9 @@ std::tuple<VecDH<int>, VecDH<int>> SizeOutput(
       outR.faceNormal_.begin(), thrust::identity<bool>());
   if (invertQ) {
     auto start = thrust::make_transform_iterator(inQ.faceNormal_.begin(),
-                                                 thrust::negate<glm::vec3>());
+                                                 thrust::negate<vec3>());
     auto end = thrust::make_transform_iterator(inQ.faceNormal_.end(),
-                                               thrust::negate<glm::vec3>());
+                                               thrust::negate<vec3>());
     copy_if<decltype(inQ.faceNormal_.begin())>(policy, start, end,
                                                keepFace + inP.NumTri(), next,
                                                thrust::identity<bool>());
@@ -127,75 +131,163 @@ std::tuple<VecDH<int>, VecDH<int>> SizeOutput(
   return std::make_tuple(faceEdge, facePQ2R);
 }
 
-struct EdgePos {
+// A vert along an intersected edge of P or Q, or along a new edge between a
+// face of P and a face of Q. The group is the forward halfedge of P or Q for
+// the former, or the pair of faces for the latter; the verts of each group are
+// paired up into edges once sorted.
+struct EdgeVert {
+  uint64_t group;
   int vert;
-  float edgePos;
+  Real edgePos;
   bool isStart;
 };
 
-void AddNewEdgeVerts(
-    std::map<int, std::vector<EdgePos>> &edgesP,
-    std::map<std::pair<int, int>, std::vector<EdgePos>> &edgesNew,
-    const SparseIndices &p1q2, const VecDH<int> &i12, const VecDH<int> &v12R,
-    const VecDH<Halfedge> &halfedgeP, bool forward) {
-  // For each edge of P that intersects a face of Q (p1q2), add this vertex to
-  // P's corresponding edge vector and to the two new edges, which are
-  // intersections between the face of Q and the two faces of P attached to the
-  // edge. The direction and duplicity are given by i12, while v12R remaps to
-  // the output vert index. When forward is false, all is reversed.
-  const VecDH<int> &p1 = p1q2.Get(!forward);
-  const VecDH<int> &q2 = p1q2.Get(forward);
-  for (int i = 0; i < p1q2.size(); ++i) {
+// Sorts the start verts of each group before its end verts, each in order
+// along the edge. The vert only breaks ties, for determinism.
+struct EdgeVertLess {
+  __host__ __device__ bool operator()(const EdgeVert &a,
+                                      const EdgeVert &b) const {
+    if (a.group != b.group) return a.group < b.group;
+    if (a.isStart != b.isStart) return a.isStart;
+    if (a.edgePos != b.edgePos) return a.edgePos < b.edgePos;
+    return a.vert < b.vert;
+  }
+};
+
+struct EdgeVertGroup {
+  __host__ __device__ uint64_t operator()(const EdgeVert &edgeVert) const {
+    return edgeVert.group;
+  }
+};
+
+struct EdgeGroup {
+  __host__ __device__ uint64_t operator()(int edge) const { return edge; }
+};
+
+__host__ __device__ uint64_t FacePair(int faceP, int faceQ) {
+  return (static_cast<uint64_t>(faceP) << 32) | static_cast<uint32_t>(faceQ);
+}
+
+struct NewEdgeVerts {
+  EdgeVert *edgeVertsP;
+  EdgeVert *edgeVertsNew;
+  const int *p1;
+  const int *q2;
+  const int *i12;
+  const int *v12R;
+  const int *offset;
+  HalfedgeCPtr halfedgeP;
+  const bool forward;
+
+  __host__ __device__ void operator()(int i) {
+    // For each edge of P that intersects a face of Q (p1q2), add this vertex
+    // to P's corresponding edge and to the two new edges, which are
+    // intersections between the face of Q and the two faces of P attached to
+    // the edge. The direction and duplicity are given by i12, while v12R
+    // remaps to the output vert index. When forward is false, all is reversed.
     const int edgeP = p1[i];
     const int faceQ = q2[i];
-    const int vert = v12R[i];
     const int inclusion = i12[i];
 
-    auto &edgePosP = edgesP[edgeP];
+    const Halfedge halfedge = halfedgeP[edgeP];
+    const int faceRightP = halfedgeP[halfedge.pairedHalfedge].face;
+    const uint64_t keyRight =
+        forward ? FacePair(faceRightP, faceQ) : FacePair(faceQ, faceRightP);
+    const uint64_t keyLeft = forward ? FacePair(halfedge.face, faceQ)
+                                     : FacePair(faceQ, halfedge.face);
+
+    const bool isStart = inclusion < 0;
+    for (int j = 0; j < glm::abs(inclusion); ++j) {
+      const int k = offset[i] + j;
+      const int vert = v12R[i] + j;
+      edgeVertsP[k] = {static_cast<uint64_t>(edgeP), vert, 0, isStart};
+      edgeVertsNew[2 * k] = {keyRight, vert, 0, forward == isStart};
+      edgeVertsNew[2 * k + 1] = {keyLeft, vert, 0, forward != isStart};
+    }
+  }
+};
 
-    Halfedge halfedge = halfedgeP[edgeP];
-    std::pair<int, int> key = {halfedgeP[halfedge.pairedHalfedge].face, faceQ};
-    if (!forward) std::swap(key.first, key.second);
-    auto &edgePosRight = edgesNew[key];
+struct CountRetainedVerts {
+  HalfedgeCPtr halfedgeP;
+  const int *i03;
 
-    key = {halfedge.face, faceQ};
-    if (!forward) std::swap(key.first, key.second);
-    auto &edgePosLeft = edgesNew[key];
+  __host__ __device__ int operator()(int edgeP) {
+    const Halfedge halfedge = halfedgeP[edgeP];
+    return glm::abs(i03[halfedge.startVert]) + glm::abs(i03[halfedge.endVert]);
+  }
+};
 
-    EdgePos edgePos = {vert, 0.0f, inclusion < 0};
-    EdgePos edgePosRev = edgePos;
-    edgePosRev.isStart = !edgePos.isStart;
+struct AddRetainedVerts {
+  EdgeVert *edgeVerts;
+  const int *edgesP;
+  const int *offset;
+  HalfedgeCPtr halfedgeP;
+  const int *i03;
+  const int *vP2R;
 
-    for (int j = 0; j < glm::abs(inclusion); ++j) {
-      edgePosP.push_back(edgePos);
-      edgePosRight.push_back(forward ? edgePos : edgePosRev);
-      edgePosLeft.push_back(forward ? edgePosRev : edgePos);
-      ++edgePos.vert;
-      ++edgePosRev.vert;
-    }
+  __host__ __device__ void operator()(int i) {
+    // Include the original verts of a partially retained edge based on their
+    // winding number (i03), remapped to the output using vP2R.
+    const int edgeP = edgesP[i];
+    const Halfedge halfedge = halfedgeP[edgeP];
+    int k = offset[i];
+    int inclusion = i03[halfedge.startVert];
+    for (int j = 0; j < glm::abs(inclusion); ++j)
+      edgeVerts[k++] = {static_cast<uint64_t>(edgeP),
+                        vP2R[halfedge.startVert] + j, 0, inclusion > 0};
+    inclusion = i03[halfedge.endVert];
+    for (int j = 0; j < glm::abs(inclusion); ++j)
+      edgeVerts[k++] = {static_cast<uint64_t>(edgeP),
+                        vP2R[halfedge.endVert] + j, 0, inclusion < 0};
   }
-}
+};
 
-std::vector<Halfedge> PairUp(std::vector<EdgePos> &edgePos) {
-  // Pair start vertices with end vertices to form edges. The choice of pairing
-  // is arbitrary for the manifoldness guarantee, but must be ordered to be
-  // geometrically valid. If the order does not go start-end-start-end... then
-  // the input and output are not geometrically valid and this algorithm becomes
-  // a heuristic.
-  ASSERT(edgePos.size() % 2 == 0, topologyErr,
-         "Non-manifold edge! Not an even number of points.");
-  int nEdges = edgePos.size() / 2;
-  auto middle = std::partition(edgePos.begin(), edgePos.end(),
-                               [](EdgePos x) { return x.isStart; });
-  ASSERT(middle - edgePos.begin() == nEdges, topologyErr, "Non-manifold edge!");
-  auto cmp = [](EdgePos a, EdgePos b) { return a.edgePos < b.edgePos; };
-  std::sort(edgePos.begin(), middle, cmp);
-  std::sort(middle, edgePos.end(), cmp);
-  std::vector<Halfedge> edges;
-  for (int i = 0; i < nEdges; ++i)
-    edges.push_back({edgePos[i].vert, edgePos[i + nEdges].vert, -1, -1});
-  return edges;
-}
+struct PartialEdgePos {
+  const vec3 *vertPosR;
+  const vec3 *vertPosP;
+  HalfedgeCPtr halfedgeP;
+
+  __host__ __device__ void operator()(EdgeVert &edgeVert) {
+    // project the verts along the edge vector to order them
+    const Halfedge halfedge = halfedgeP[edgeVert.group];
+    const vec3 edgeVec =
+        vertPosP[halfedge.endVert] - vertPosP[halfedge.startVert];
+    edgeVert.edgePos = glm::dot(vertPosR[edgeVert.vert], edgeVec);
+  }
+};
+
+struct NewEdgePos {
+  EdgeVert *edgeVerts;
+  const int *groupStart;
+  const vec3 *vertPosR;
+
+  __host__ __device__ void operator()(int i) {
+    Box bbox;
+    for (int k = groupStart[i]; k < groupStart[i + 1]; ++k)
+      bbox.Union(vertPosR[edgeVerts[k].vert]);
+    const vec3 size = bbox.Size();
+    // Order the points along their longest dimension.
+    const int axis = (size.x > size.y && size.x > size.z) ? 0
+                     : size.y > size.z                    ? 1
+                                                          : 2;
+    for (int k = groupStart[i]; k < groupStart[i + 1]; ++k)
+      edgeVerts[k].edgePos = vertPosR[edgeVerts[k].vert][axis];
+  }
+};
+
+struct ValidPairs {
+  const EdgeVert *edgeVerts;
+  const int *groupStart;
+
+  __host__ __device__ bool operator()(int i) {
+    // There must be as many start verts as end verts, which sort first.
+    const int size = groupStart[i + 1] - groupStart[i];
+    if (size % 2 != 0) return false;
+    const int middle = groupStart[i] + size / 2;
+    return (size == 0 || edgeVerts[middle - 1].isStart) &&
+           (middle == groupStart[i + 1] || !edgeVerts[middle].isStart);
+  }
+};
 
 // A Ref carries the reference of a halfedge's startVert back to the input
 // manifolds. PQ is 0 if the halfedge comes from triangle tri of P, and 1 for Q.
@@ -204,64 +296,53 @@ struct Ref {
   int PQ, tri, vert;
 };
 
-void AppendPartialEdges(Manifold::Impl &outR, VecDH<char> &wholeHalfedgeP,
-                        VecDH<int> &facePtrR,
-                        std::map<int, std::vector<EdgePos>> &edgesP,
-                        VecDH<Ref> &halfedgeRef, const Manifold::Impl &inP,
-                        const VecDH<int> &i03, const VecDH<int> &vP2R,
-                        const VecDH<int>::IterC faceP2R, bool forward) {
-  // Each edge in the map is partially retained; for each of these, look up
-  // their original verts and include them based on their winding number (i03),
-  // while remapping them to the output using vP2R. Use the verts position
-  // projected along the edge vector to pair them up, then distribute these
-  // edges to their faces.
-  VecDH<Halfedge> &halfedgeR = outR.halfedge_;
-  const VecDH<glm::vec3> &vertPosP = inP.vertPos_;
-  const VecDH<Halfedge> &halfedgeP = inP.halfedge_;
+__host__ __device__ void PairUp(HalfedgePtr halfedgeR, Ref *halfedgeRef,
+                                int *facePtrR, const EdgeVert *edgeVerts,
+                                int numVert, int faceLeft, int faceRight,
+                                Ref forwardRef, Ref backwardRef) {
+  // Pair start vertices with end vertices to form edges. The choice of pairing
+  // is arbitrary for the manifoldness guarantee, but must be ordered to be
+  // geometrically valid. If the order does not go start-end-start-end... then
+  // the input and output are not geometrically valid and this algorithm becomes
+  // a heuristic.
+  const int numEdge = numVert / 2;
+  for (int i = 0; i < numEdge; ++i) {
+    const int startVert = edgeVerts[i].vert;
+    const int endVert = edgeVerts[i + numEdge].vert;
+    const int forwardEdge = AtomicAdd(facePtrR[faceLeft], 1);
+    const int backwardEdge = AtomicAdd(facePtrR[faceRight], 1);
+
+    halfedgeR.Set(forwardEdge, {startVert, endVert, backwardEdge, faceLeft});
+    halfedgeRef[forwardEdge] = forwardRef;
+
+    halfedgeR.Set(backwardEdge, {endVert, startVert, forwardEdge, faceRight});
+    halfedgeRef[backwardEdge] = backwardRef;
+  }
+}
 
-  for (auto &value : edgesP) {
-    const int edgeP = value.first;
-    std::vector<EdgePos> &edgePosP = value.second;
+struct AppendPartialEdge {
+  HalfedgePtr halfedgeR;
+  Ref *halfedgeRef;
+  int *facePtrR;
+  char *wholeHalfedgeP;
+  const EdgeVert *edgeVerts;
+  const int *groupStart;
+  const int *edgesP;
+  HalfedgeCPtr halfedgeP;
+  const int *i03;
+  const int *faceP2R;
+  const bool forward;
 
-    const Halfedge &halfedge = halfedgeP[edgeP];
+  __host__ __device__ void operator()(int i) {
+    const int edgeP = edgesP[i];
+    const Halfedge halfedge = halfedgeP[edgeP];
     wholeHalfedgeP[edgeP] = false;
     wholeHalfedgeP[halfedge.pairedHalfedge] = false;
 
-    const int vStart = halfedge.startVert;
-    const int vEnd = halfedge.endVert;
-    const glm::vec3 edgeVec = vertPosP[vEnd] - vertPosP[vStart];
-    // Fill in the edge positions of the old points.
-    for (EdgePos &edge : edgePosP) {
-      edge.edgePos = glm::dot(outR.vertPos_[edge.vert], edgeVec);
-    }
-
-    int inclusion = i03[vStart];
-    bool reversed = inclusion < 0;
-    EdgePos edgePos = {vP2R[vStart],
-                       glm::dot(outR.vertPos_[vP2R[vStart]], edgeVec),
-                       inclusion > 0};
-    for (int j = 0; j < glm::abs(inclusion); ++j) {
-      edgePosP.push_back(edgePos);
-      ++edgePos.vert;
-    }
-
-    inclusion = i03[vEnd];
-    reversed |= inclusion < 0;
-    edgePos = {vP2R[vEnd], glm::dot(outR.vertPos_[vP2R[vEnd]], edgeVec),
-               inclusion < 0};
-    for (int j = 0; j < glm::abs(inclusion); ++j) {
-      edgePosP.push_back(edgePos);
-      ++edgePos.vert;
-    }
-
-    // sort edges into start/end pairs along length
-    std::vector<Halfedge> edges = PairUp(edgePosP);
-
-    // add halfedges to result
+    const bool reversed =
+        i03[halfedge.startVert] < 0 || i03[halfedge.endVert] < 0;
     const int faceLeftP = halfedge.face;
-    const int faceLeft = faceP2R[faceLeftP];
     const int faceRightP = halfedgeP[halfedge.pairedHalfedge].face;
-    const int faceRight = faceP2R[faceRightP];
     // Negative inclusion means the halfedges are reversed, which means our
     // reference is now to the endVert instead of the startVert, which is one
     // position advanced CCW. This is only valid if this is a retained vert; it
@@ -272,81 +353,165 @@ void AppendPartialEdges(Manifold::Impl &outR, VecDH<char> &wholeHalfedgeP,
         forward ? 0 : 1, faceRightP,
         (halfedge.pairedHalfedge + (reversed ? 1 : 0)) % 3};
 
-    for (Halfedge e : edges) {
-      const int forwardEdge = facePtrR[faceLeft]++;
-      const int backwardEdge = facePtrR[faceRight]++;
-
-      e.face = faceLeft;
-      e.pairedHalfedge = backwardEdge;
-      halfedgeR[forwardEdge] = e;
-      halfedgeRef[forwardEdge] = forwardRef;
+    PairUp(halfedgeR, halfedgeRef, facePtrR, edgeVerts + groupStart[i],
+           groupStart[i + 1] - groupStart[i], faceP2R[faceLeftP],
+           faceP2R[faceRightP], forwardRef, backwardRef);
+  }
+};
 
-      std::swap(e.startVert, e.endVert);
-      e.face = faceRight;
-      e.pairedHalfedge = forwardEdge;
-      halfedgeR[backwardEdge] = e;
-      halfedgeRef[backwardEdge] = backwardRef;
-    }
+struct AppendNewEdge {
+  HalfedgePtr halfedgeR;
+  Ref *halfedgeRef;
+  int *facePtrR;
+  const EdgeVert *edgeVerts;
+  const int *groupStart;
+  const int *facePQ2R;
+  const int numFaceP;
+
+  __host__ __device__ void operator()(int i) {
+    // distribute to faces based on the indices in the group
+    const EdgeVert *begin = edgeVerts + groupStart[i];
+    const int faceP = begin->group >> 32;
+    const int faceQ = begin->group & 0xffffffff;
+    PairUp(halfedgeR, halfedgeRef, facePtrR, begin,
+           groupStart[i + 1] - groupStart[i], facePQ2R[faceP],
+           facePQ2R[numFaceP + faceQ], {0, faceP, -4}, {1, faceQ, -4});
   }
-}
+};
 
-void AppendNewEdges(
-    Manifold::Impl &outR, VecDH<int> &facePtrR,
-    std::map<std::pair<int, int>, std::vector<EdgePos>> &edgesNew,
-    VecDH<Ref> &halfedgeRef, const VecDH<int> &facePQ2R, const int numFaceP) {
-  // Pair up each edge's verts and distribute to faces based on indices in key.
-  VecDH<Halfedge> &halfedgeR = outR.halfedge_;
-  VecDH<glm::vec3> &vertPosR = outR.vertPos_;
+/**
+ * Returns the start of the verts of each of the sorted groups, followed by
+ * their total. Groups without any verts are empty.
+ */
+template <typename Iter>
+VecDH<int> GroupStart(const VecDH<EdgeVert> &edgeVerts, Iter groupBegin,
+                      Iter groupEnd, ExecutionPolicy policy) {
+  auto group =
+      thrust::make_transform_iterator(edgeVerts.begin(), EdgeVertGroup());
+  VecDH<int> groupStart(groupEnd - groupBegin + 1, edgeVerts.size());
+  lower_bound(policy, group, group + edgeVerts.size(), groupBegin, groupEnd,
+              groupStart.begin());
+  return groupStart;
+}
 
-  for (auto &value : edgesNew) {
-    const int faceP = value.first.first;
-    const int faceQ = value.first.second;
-    std::vector<EdgePos> &edgePos = value.second;
+// Offsets of the verts duplicated by each inclusion value; returns their total.
+int InclusionOffsets(VecDH<int> &offset, const VecDH<int> &inclusion,
+                     ExecutionPolicy policy) {
+  offset.resize(inclusion.size());
+  if (inclusion.size() == 0) return 0;
+  exclusive_scan(policy, inclusion.begin(), inclusion.end(), offset.begin(), 0,
+                 AbsSum());
+  return AbsSum()(offset.back(), inclusion.back());
+}
 
-    Box bbox;
-    for (auto edge : edgePos) {
-      bbox.Union(vertPosR[edge.vert]);
-    }
-    const glm::vec3 size = bbox.Size();
-    // Order the points along their longest dimension.
-    const int i = (size.x > size.y && size.x > size.z) ? 0
-                  : size.y > size.z                    ? 1
-                                                       : 2;
-    for (auto &edge : edgePos) {
-      edge.edgePos = vertPosR[edge.vert][i];
-    }
+/**
+ * Adds the new verts along the intersected edges of P, and returns those
+ * edges, which are then only partially retained.
+ */
+VecDH<int> AddNewEdgeVerts(VecDH<EdgeVert> &edgeVertsP,
+                           VecDH<EdgeVert> &edgeVertsNew, int newStart,
+                           const SparseIndices &p1q2, const VecDH<int> &i12,
+                           const VecDH<int> &v12R, const HalfedgeVec &halfedgeP,
+                           bool forward, ExecutionPolicy policy) {
+  const VecDH<int> &p1 = p1q2.Get(!forward);
+  const VecDH<int> &q2 = p1q2.Get(forward);
+  VecDH<int> offset;
+  edgeVertsP.resize(InclusionOffsets(offset, i12, policy));
+  for_each_n(policy, countAt(0), p1q2.size(),
+             NewEdgeVerts({edgeVertsP.ptrD(), edgeVertsNew.ptrD() + newStart,
+                           p1.cptrD(), q2.cptrD(), i12.cptrD(), v12R.cptrD(),
+                           offset.cptrD(), halfedgeP.cptrD(), forward}));
+
+  VecDH<int> edgesP(p1);
+  sort(policy, edgesP.begin(), edgesP.end());
+  auto end = unique<decltype(edgesP.begin())>(policy, edgesP.begin(),
+                                              edgesP.end());
+  edgesP.resize(end - edgesP.begin());
+  return edgesP;
+}
 
-    // sort edges into start/end pairs along length.
-    std::vector<Halfedge> edges = PairUp(edgePos);
-
-    // add halfedges to result
-    const int faceLeft = facePQ2R[faceP];
-    const int faceRight = facePQ2R[numFaceP + faceQ];
-    const Ref forwardRef = {0, faceP, -4};
-    const Ref backwardRef = {1, faceQ, -4};
-    for (Halfedge e : edges) {
-      const int forwardEdge = facePtrR[faceLeft]++;
-      const int backwardEdge = facePtrR[faceRight]++;
-
-      e.face = faceLeft;
-      e.pairedHalfedge = backwardEdge;
-      halfedgeR[forwardEdge] = e;
-      halfedgeRef[forwardEdge] = forwardRef;
+void AppendPartialEdges(Manifold::Impl &outR, VecDH<char> &wholeHalfedgeP,
+                        VecDH<int> &facePtrR, VecDH<EdgeVert> &edgeVertsP,
+                        const VecDH<int> &edgesP, VecDH<Ref> &halfedgeRef,
+                        const Manifold::Impl &inP, const VecDH<int> &i03,
+                        const VecDH<int> &vP2R, const int *faceP2R,
+                        bool forward, ExecutionPolicy policy) {
+  // Each of these edges is partially retained; for each of these, look up
+  // their original verts and include them based on their winding number (i03),
+  // while remapping them to the output using vP2R. Use the verts position
+  // projected along the edge vector to pair them up, then distribute these
+  // edges to their faces.
+  const int numEdge = edgesP.size();
+  if (numEdge == 0) return;
+  VecDH<int> offset(numEdge);
+  const int numNew = edgeVertsP.size();
+  auto count = thrust::make_transform_iterator(
+      edgesP.begin(), CountRetainedVerts({inP.halfedge_.cptrD(), i03.cptrD()}));
+  exclusive_scan(policy, count, count + numEdge, offset.begin(), numNew);
+  edgeVertsP.resize(offset.back() + count[numEdge - 1]);
+  for_each_n(policy, countAt(0), numEdge,
+             AddRetainedVerts({edgeVertsP.ptrD(), edgesP.cptrD(),
+                               offset.cptrD(), inP.halfedge_.cptrD(),
+                               i03.cptrD(), vP2R.cptrD()}));
+
+  for_each(policy, edgeVertsP.begin(), edgeVertsP.end(),
+           PartialEdgePos({outR.vertPos_.cptrD(), inP.vertPos_.cptrD(),
+                           inP.halfedge_.cptrD()}));
+  sort(policy, edgeVertsP.begin(), edgeVertsP.end(), EdgeVertLess());
+  auto group = thrust::make_transform_iterator(edgesP.begin(), EdgeGroup());
+  const VecDH<int> groupStart =
+      GroupStart(edgeVertsP, group, group + numEdge, policy);
+
+  ASSERT(all_of(policy, countAt(0), countAt(numEdge),
+                ValidPairs({edgeVertsP.cptrD(), groupStart.cptrD()})),
+         topologyErr, "Non-manifold edge!");
+  for_each_n(policy, countAt(0), numEdge,
+             AppendPartialEdge({outR.halfedge_.ptrD(), halfedgeRef.ptrD(),
+                                facePtrR.ptrD(), wholeHalfedgeP.ptrD(),
+                                edgeVertsP.cptrD(), groupStart.cptrD(),
+                                edgesP.cptrD(), inP.halfedge_.cptrD(),
+                                i03.cptrD(), faceP2R, forward}));
+}
 
-      std::swap(e.startVert, e.endVert);
-      e.face = faceRight;
-      e.pairedHalfedge = forwardEdge;
-      halfedgeR[backwardEdge] = e;
-      halfedgeRef[backwardEdge] = backwardRef;
-    }
-  }
+void AppendNewEdges(Manifold::Impl &outR, VecDH<int> &facePtrR,
+                    VecDH<EdgeVert> &edgeVertsNew, VecDH<Ref> &halfedgeRef,
+                    const VecDH<int> &facePQ2R, const int numFaceP,
+                    ExecutionPolicy policy) {
+  // Pair up each edge's verts and distribute to faces based on indices in key.
+  const int numVert = edgeVertsNew.size();
+  if (numVert == 0) return;
+  sort(policy, edgeVertsNew.begin(), edgeVertsNew.end(), EdgeVertLess());
+  VecDH<uint64_t> groups(numVert);
+  auto group =
+      thrust::make_transform_iterator(edgeVertsNew.begin(), EdgeVertGroup());
+  copy(policy, group, group + numVert, groups.begin());
+  auto end =
+      unique<decltype(groups.begin())>(policy, groups.begin(), groups.end());
+  groups.resize(end - groups.begin());
+  const VecDH<int> groupStart =
+      GroupStart(edgeVertsNew, groups.cbegin(), groups.cend(), policy);
+  const int numGroup = groups.size();
+  // the order along each edge only depends on its own verts, so it is only
+  // known once grouped
+  for_each_n(policy, countAt(0), numGroup,
+             NewEdgePos({edgeVertsNew.ptrD(), groupStart.cptrD(),
+                         outR.vertPos_.cptrD()}));
+  sort(policy, edgeVertsNew.begin(), edgeVertsNew.end(), EdgeVertLess());
+
+  ASSERT(all_of(policy, countAt(0), countAt(numGroup),
+                ValidPairs({edgeVertsNew.cptrD(), groupStart.cptrD()})),
+         topologyErr, "Non-manifold edge!");
+  for_each_n(policy, countAt(0), numGroup,
+             AppendNewEdge({outR.halfedge_.ptrD(), halfedgeRef.ptrD(),
+                            facePtrR.ptrD(), edgeVertsNew.cptrD(),
+                            groupStart.cptrD(), facePQ2R.cptrD(), numFaceP}));
 }
 
 struct DuplicateHalfedges {
-  Halfedge *halfedgesR;
+  HalfedgePtr halfedgesR;
   Ref *halfedgeRef;
   int *facePtr;
-  const Halfedge *halfedgesP;
+  HalfedgeCPtr halfedgesP;
   const int *i03;
   const int *vP2R;
   const int *faceP2R;
@@ -385,9 +550,9 @@ struct DuplicateHalfedges {
       int backwardEdge = AtomicAdd(facePtr[faceRight], 1);
       halfedge.pairedHalfedge = backwardEdge;
 
-      halfedgesR[forwardEdge] = halfedge;
-      halfedgesR[backwardEdge] = {halfedge.endVert, halfedge.startVert,
-                                  forwardEdge, faceRight};
+      halfedgesR.Set(forwardEdge, halfedge);
+      halfedgesR.Set(backwardEdge, {halfedge.endVert, halfedge.startVert,
+                                    forwardEdge, faceRight});
       halfedgeRef[forwardEdge] = forwardRef;
       halfedgeRef[backwardEdge] = backwardRef;
 
@@ -411,23 +576,23 @@ void AppendWholeEdges(Manifold::Impl &outR, VecDH<int> &facePtrR,
 }
 
 struct CreateBarycentric {
-  glm::vec3 *barycentricR;
+  vec3 *barycentricR;
   BaryRef *faceRef;
   int *idx;
 
   const int offsetQ;
   const int firstNewVert;
-  const glm::vec3 *vertPosR;
-  const glm::vec3 *vertPosP;
-  const glm::vec3 *vertPosQ;
-  const Halfedge *halfedgeP;
-  const Halfedge *halfedgeQ;
+  const vec3 *vertPosR;
+  const vec3 *vertPosP;
+  const vec3 *vertPosQ;
+  HalfedgeCPtr halfedgeP;
+  HalfedgeCPtr halfedgeQ;
   const BaryRef *triBaryP;
   const BaryRef *triBaryQ;
-  const glm::vec3 *barycentricP;
-  const glm::vec3 *barycentricQ;
+  const vec3 *barycentricP;
+  const vec3 *barycentricQ;
   const bool invertQ;
-  const float precision;
+  const Real precision;
 
   __host__ __device__ void operator()(
       thrust::tuple<int &, Ref, Halfedge> inOut) {
@@ -435,8 +600,7 @@ struct CreateBarycentric {
     const Ref halfedgeRef = thrust::get<1>(inOut);
     const Halfedge halfedgeR = thrust::get<2>(inOut);
 
-    const glm::vec3 *barycentric =
-        halfedgeRef.PQ == 0 ? barycentricP : barycentricQ;
+    const vec3 *barycentric = halfedgeRef.PQ == 0 ? barycentricP : barycentricQ;
     const int tri = halfedgeRef.tri;
     const BaryRef oldRef = halfedgeRef.PQ == 0 ? triBaryP[tri] : triBaryQ[tri];
 
@@ -459,18 +623,18 @@ struct CreateBarycentric {
     } else {  // new vert
       halfedgeBary = AtomicAdd(*idx, 1);
 
-      const glm::vec3 *vertPos = halfedgeRef.PQ == 0 ? vertPosP : vertPosQ;
-      const Halfedge *halfedge = halfedgeRef.PQ == 0 ? halfedgeP : halfedgeQ;
+      const vec3 *vertPos = halfedgeRef.PQ == 0 ? vertPosP : vertPosQ;
+      const HalfedgeCPtr halfedge = halfedgeRef.PQ == 0 ? halfedgeP : halfedgeQ;
 
-      glm::mat3 triPos;
+      mat3 triPos;
       for (int i : {0, 1, 2})
         triPos[i] = vertPos[halfedge[3 * tri + i].startVert];
 
-      glm::mat3 uvwOldTri;
+      mat3 uvwOldTri;
       for (int i : {0, 1, 2})
         uvwOldTri[i] = UVW(oldRef.vertBary[i], barycentric);
 
-      const glm::vec3 uvw =
+      const vec3 uvw =
           GetBarycentric(vertPosR[halfedgeR.startVert], triPos, precision);
       barycentricR[halfedgeBary] = uvwOldTri * uvw;
     }
@@ -489,7 +653,7 @@ std::pair<VecDH<BaryRef>, VecDH<int>> CalculateMeshRelation(
   VecDH<int> idx(1, 0);
   for_each_n(
       policy,
-      zip(halfedgeBary.begin(), halfedgeRef.begin(), outR.halfedge_.cbegin()),
+      zip(halfedgeBary.begin(), halfedgeRef.begin(), outR.halfedge_.begin()),
       halfedgeRef.size(),
       CreateBarycentric(
           {outR.meshRelation_.barycentric.ptrD(), faceRef.ptrD(), idx.ptrD(),
@@ -507,10 +671,9 @@ std::pair<VecDH<BaryRef>, VecDH<int>> CalculateMeshRelation(
 namespace manifold {
 
 Manifold::Impl Boolean3::Result(Manifold::OpType op) const {
-#ifdef MANIFOLD_DEBUG
-  Timer assemble;
-  assemble.Start();
-#endif
+  BooleanStats stats = stats_;
+  PhaseClock clock(stats);
+  TraceSpan span("Boolean3::Result");
 
   ASSERT((expandP_ > 0) == (op == Manifold::OpType::ADD), logicErr,
          "Result op type not compatible with constructor op type.");
@@ -518,16 +681,34 @@ Manifold::Impl Boolean3::Result(Manifold::OpType op) const {
   const int c2 = op == Manifold::OpType::ADD ? 1 : 0;
   const int c3 = op == Manifold::OpType::INTERSECT ? 1 : -1;
 
-  if (w03_.size() == 0) {
-    if (w30_.size() != 0 && op == Manifold::OpType::ADD) {
-      return inQ_;
+  if (w03_.size() == 0 || w30_.size() == 0) {
+    Manifold::Impl result;
+    if (w03_.size() == 0) {
+      if (w30_.size() != 0 && op == Manifold::OpType::ADD) result = inQ_;
+    } else if (op != Manifold::OpType::INTERSECT) {
+      result = inP_;
     }
-    return Manifold::Impl();
-  } else if (w30_.size() == 0) {
-    if (op == Manifold::OpType::INTERSECT) {
-      return Manifold::Impl();
+    Publish(stats, result);
+    return result;
+  }
+
+  if (separate_) {
+    // Each mesh is kept whole or dropped, so unless both are kept, which
+    // makes a union of meshes apart or a difference leaving a void, the
+    // result is one of the inputs.
+    const bool pInQ = w03_[0] != 0;
+    const bool qInP = w30_[0] != 0;
+    const bool keepP = op == Manifold::OpType::INTERSECT ? pInQ : !pInQ;
+    const bool keepQ = op == Manifold::OpType::ADD ? !qInP : qInP;
+    if (!(keepP && keepQ)) {
+      Manifold::Impl result;
+      if (keepP)
+        result = inP_;
+      else if (keepQ)
+        result = inQ_;
+      Publish(stats, result);
+      return result;
     }
-    return inP_;
   }
 
   const bool invertQ = op == Manifold::OpType::SUBTRACT;
@@ -573,7 +754,10 @@ Manifold::Impl Boolean3::Result(Manifold::OpType op) const {
   // Create the output Manifold
   Manifold::Impl outR;
 
-  if (numVertR == 0) return outR;
+  if (numVertR == 0) {
+    Publish(stats, outR);
+    return outR;
+  }
 
   outR.precision_ = glm::max(inP_.precision_, inQ_.precision_);
 
@@ -595,25 +779,31 @@ Manifold::Impl Boolean3::Result(Manifold::OpType op) const {
   PRINT(n12 << " new verts from edgesP -> facesQ");
   PRINT(n21 << " new verts from facesP -> edgesQ");
 
-  // Build up new polygonal faces from triangle intersections. At this point the
-  // calculation switches from parallel to serial.
+  // Build up new polygonal faces from triangle intersections. Each edge is
+  // built from the verts of its group once they are sorted together, so this
+  // stays parallel (and device-resident) throughout.
 
   // Level 3
 
-  // This key is the forward halfedge index of P or Q. Only includes intersected
-  // edges.
-  std::map<int, std::vector<EdgePos>> edgesP, edgesQ;
-  // This key is the face index of <P, Q>
-  std::map<std::pair<int, int>, std::vector<EdgePos>> edgesNew;
-
-  AddNewEdgeVerts(edgesP, edgesNew, p1q2_, i12, v12R, inP_.halfedge_, true);
-  AddNewEdgeVerts(edgesQ, edgesNew, p2q1_, i21, v21R, inQ_.halfedge_, false);
+  // The verts along each of the intersected forward halfedges of P or Q, and
+  // along each new edge between a face of P and a face of Q.
+  VecDH<EdgeVert> edgeVertsP, edgeVertsQ;
+  // each new vert is on two new edges
+  VecDH<EdgeVert> edgeVertsNew(2 * (n12 + n21));
+  const VecDH<int> edgesP =
+      AddNewEdgeVerts(edgeVertsP, edgeVertsNew, 0, p1q2_, i12, v12R,
+                      inP_.halfedge_, true, policy_);
+  const VecDH<int> edgesQ =
+      AddNewEdgeVerts(edgeVertsQ, edgeVertsNew, 2 * n12, p2q1_, i21, v21R,
+                      inQ_.halfedge_, false, policy_);
+  clock.Lap(BooleanStats::AddVerts);
 
   // Level 4
   VecDH<int> faceEdge;
   VecDH<int> facePQ2R;
   std::tie(faceEdge, facePQ2R) = SizeOutput(
       outR, inP_, inQ_, i03, i30, i12, i21, p1q2_, p2q1_, invertQ, policy_);
+  clock.Lap(BooleanStats::SizeOutput);
 
   const int numFaceR = faceEdge.size() - 1;
   // This gets incremented for each halfedge that's added to a face so that the
@@ -626,13 +816,16 @@ Manifold::Impl Boolean3::Result(Manifold::OpType op) const {
   // are triangulated.
   VecDH<Ref> halfedgeRef(2 * outR.NumEdge());
 
-  AppendPartialEdges(outR, wholeHalfedgeP, facePtrR, edgesP, halfedgeRef, inP_,
-                     i03, vP2R, facePQ2R.begin(), true);
-  AppendPartialEdges(outR, wholeHalfedgeQ, facePtrR, edgesQ, halfedgeRef, inQ_,
-                     i30, vQ2R, facePQ2R.begin() + inP_.NumTri(), false);
+  AppendPartialEdges(outR, wholeHalfedgeP, facePtrR, edgeVertsP, edgesP,
+                     halfedgeRef, inP_, i03, vP2R, facePQ2R.cptrD(), true,
+                     policy_);
+  AppendPartialEdges(outR, wholeHalfedgeQ, facePtrR, edgeVertsQ, edgesQ,
+                     halfedgeRef, inQ_, i30, vQ2R,
+                     facePQ2R.cptrD() + inP_.NumTri(), false, policy_);
+  clock.Lap(BooleanStats::AppendPartialEdges);
 
-  AppendNewEdges(outR, facePtrR, edgesNew, halfedgeRef, facePQ2R,
-                 inP_.NumTri());
+  AppendNewEdges(outR, facePtrR, edgeVertsNew, halfedgeRef, facePQ2R,
+                 inP_.NumTri(), policy_);
 
   AppendWholeEdges(outR, facePtrR, halfedgeRef, inP_, wholeHalfedgeP, i03, vP2R,
                    facePQ2R.cptrD(), true, policy_);
@@ -643,12 +836,7 @@ Manifold::Impl Boolean3::Result(Manifold::OpType op) const {
   VecDH<int> halfedgeBary;
   std::tie(faceRef, halfedgeBary) = CalculateMeshRelation(
       outR, halfedgeRef, inP_, inQ_, nPv + nQv, numFaceR, invertQ, policy_);
-
-#ifdef MANIFOLD_DEBUG
-  assemble.Stop();
-  Timer triangulate;
-  triangulate.Start();
-#endif
+  clock.Lap(BooleanStats::AppendEdges);
 
   // Level 6
 
@@ -656,12 +844,7 @@ Manifold::Impl Boolean3::Result(Manifold::OpType op) const {
     ASSERT(outR.IsManifold(), logicErr, "polygon mesh is not manifold!");
 
   outR.Face2Tri(faceEdge, faceRef, halfedgeBary);
-
-#ifdef MANIFOLD_DEBUG
-  triangulate.Stop();
-  Timer simplify;
-  simplify.Start();
-#endif
+  clock.Lap(BooleanStats::Face2Tri);
 
   if (ManifoldParams().intermediateChecks)
     ASSERT(outR.IsManifold(), logicErr, "triangulated mesh is not manifold!");
@@ -672,26 +855,17 @@ Manifold::Impl Boolean3::Result(Manifold::OpType op) const {
     ASSERT(outR.Is2Manifold(), logicErr, "simplified mesh is not 2-manifold!");
 
   outR.IncrementMeshIDs(0, outR.NumTri());
-
-#ifdef MANIFOLD_DEBUG
-  simplify.Stop();
-  Timer sort;
-  sort.Start();
-#endif
+  clock.Lap(BooleanStats::SimplifyTopology);
 
   outR.Finish();
-
-#ifdef MANIFOLD_DEBUG
-  sort.Stop();
-  if (ManifoldParams().verbose) {
-    assemble.Print("Assembly");
-    triangulate.Print("Triangulation");
-    simplify.Print("Simplification");
-    sort.Print("Sorting");
-    std::cout << outR.NumVert() << " verts and " << outR.NumTri() << " tris"
-              << std::endl;
-  }
-#endif
+  clock.Lap(BooleanStats::Finish);
+
+  stats.numVert = outR.NumVert();
+  stats.numTri = outR.NumTri();
+  span.Arg("numVert", outR.NumVert());
+  span.Arg("numTri", outR.NumTri());
+  PRINT(outR.NumVert() << " verts and " << outR.NumTri() << " tris");
+  Publish(stats, outR);
 
   return outR;
 }
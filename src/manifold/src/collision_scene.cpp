@@ -0,0 +1,212 @@
+// Copyright 2022 The Manifold Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <exception>
+
+#include "csg_tree.h"
+#include "impl.h"
+#include "par.h"
+
+namespace {
+using namespace manifold;
+
+using ImplPtr = std::shared_ptr<const Manifold::Impl>;
+
+// The counts allocate, so exceptions, e.g. memoryErr, must not escape the
+// parallel backend; they are kept in errors to be rethrown after the loop.
+struct CountPair {
+  OverlapPair* pairs;
+  const ImplPtr* impls;
+  std::exception_ptr* errors;
+
+  void operator()(int i) {
+    OverlapPair& pair = pairs[i];
+    const Manifold::Impl& a = *impls[pair.first];
+    const Manifold::Impl& b = *impls[pair.second];
+    try {
+      pair.numOverlaps = a.NumEdgeCollisions(b) + b.NumEdgeCollisions(a);
+    } catch (...) {
+      errors[i] = std::current_exception();
+    }
+  }
+};
+
+struct CountQuery {
+  std::pair<int, int>* hits;
+  const ImplPtr* impls;
+  const Manifold::Impl& query;
+  std::exception_ptr* errors;
+
+  void operator()(int i) {
+    const Manifold::Impl& other = *impls[hits[i].first];
+    try {
+      hits[i].second =
+          other.NumEdgeCollisions(query) + query.NumEdgeCollisions(other);
+    } catch (...) {
+      errors[i] = std::current_exception();
+    }
+  }
+};
+
+void RethrowFirst(const std::vector<std::exception_ptr>& errors) {
+  for (const auto& error : errors) {
+    if (error) std::rethrow_exception(error);
+  }
+}
+}  // namespace
+
+namespace manifold {
+
+struct CollisionScene::Impl {
+  std::vector<ImplPtr> impls;
+  // the nonempty manifolds, in the order of the collider's leaves
+  std::vector<int> leaf2manifold;
+  VecDH<Box> leafBox;
+  Collider collider;
+
+  /**
+   * Returns the (query, manifold) pairs of overlapping bounding boxes, grouped
+   * by query. The collider needs at least two leaves, so smaller scenes are
+   * checked directly.
+   */
+  std::vector<std::pair<int, int>> BoxPairs(const VecDH<Box>& queries) const {
+    std::vector<std::pair<int, int>> pairs;
+    if (leafBox.size() < 2) {
+      for (int i = 0; i < queries.size(); ++i) {
+        for (int leaf = 0; leaf < leafBox.size(); ++leaf) {
+          if (queries[i].DoesOverlap(leafBox[leaf]))
+            pairs.push_back({i, leaf2manifold[leaf]});
+        }
+      }
+      return pairs;
+    }
+    const SparseIndices overlaps = collider.Collisions(queries);
+    const int* query = overlaps.Get(0).cptrH();
+    const int* leaf = overlaps.Get(1).cptrH();
+    pairs.reserve(overlaps.size());
+    for (int i = 0; i < overlaps.size(); ++i)
+      pairs.push_back({query[i], leaf2manifold[leaf[i]]});
+    return pairs;
+  }
+};
+
+/**
+ * Evaluates the manifolds and builds the hierarchy over their bounding boxes.
+ * Their face hierarchies are the ones each manifold already keeps; those of
+ * transformed manifolds are refit rather than rebuilt.
+ */
+CollisionScene::CollisionScene(const std::vector<Manifold>& manifolds)
+    : pImpl_(std::make_unique<Impl>()) {
+  Impl& scene = *pImpl_;
+  Box bBox;
+  std::vector<Box> boxes;
+  for (int i = 0; i < manifolds.size(); ++i) {
+    scene.impls.push_back(manifolds[i].GetCsgLeafNode().GetImpl());
+    if (scene.impls.back()->IsEmpty()) continue;
+    scene.leaf2manifold.push_back(i);
+    boxes.push_back(scene.impls.back()->bBox_);
+    bBox = bBox.Union(boxes.back());
+  }
+  scene.leafBox = VecDH<Box>(boxes);
+  if (boxes.size() < 2) return;
+
+  const int numLeaf = boxes.size();
+  VecDH<uint32_t> leafMorton(numLeaf);
+  transform(autoPolicy(numLeaf), scene.leafBox.begin(), scene.leafBox.end(),
+            leafMorton.begin(), BoxMorton({bBox}));
+  scene.collider.Rebuild(scene.leafBox, leafMorton);
+}
+
+CollisionScene::~CollisionScene() = default;
+CollisionScene::CollisionScene(CollisionScene&&) noexcept = default;
+CollisionScene& CollisionScene::operator=(CollisionScene&&) noexcept = default;
+
+int CollisionScene::NumManifold() const { return pImpl_->impls.size(); }
+
+/**
+ * Returns every pair of manifolds in the scene whose surfaces may touch,
+ * sorted by index, with their overlap counts. This is equivalent to calling
+ * NumOverlaps() on every pair, but only pairs with overlapping bounding boxes
+ * are counted, and those concurrently.
+ */
+std::vector<OverlapPair> CollisionScene::Overlaps() const {
+  const Impl& scene = *pImpl_;
+  std::vector<OverlapPair> pairs;
+  for (const auto& pair : scene.BoxPairs(scene.leafBox)) {
+    const int first = scene.leaf2manifold[pair.first];
+    if (first < pair.second) pairs.push_back({first, pair.second, 0});
+  }
+  std::sort(pairs.begin(), pairs.end(),
+            [](const OverlapPair& a, const OverlapPair& b) {
+              return a.first != b.first ? a.first < b.first
+                                        : a.second < b.second;
+            });
+
+  const int numPair = pairs.size();
+  std::vector<std::exception_ptr> errors(numPair);
+  for_each_n(numPair > 1 ? ExecutionPolicy::Par : ExecutionPolicy::Seq,
+             countAt(0), numPair,
+             CountPair({pairs.data(), scene.impls.data(), errors.data()}));
+  RethrowFirst(errors);
+  pairs.erase(std::remove_if(pairs.begin(), pairs.end(),
+                             [](const OverlapPair& pair) {
+                               return pair.numOverlaps == 0;
+                             }),
+              pairs.end());
+  return pairs;
+}
+
+/**
+ * Returns the index of each manifold in the scene whose surface may touch the
+ * query, with their overlap count, sorted by index. The query is not added to
+ * the scene, so this is the inner loop of a packing search.
+ */
+std::vector<std::pair<int, int>> CollisionScene::Query(
+    const Manifold& query) const {
+  const Impl& scene = *pImpl_;
+  const ImplPtr queryImpl = query.GetCsgLeafNode().GetImpl();
+  std::vector<std::pair<int, int>> hits;
+  if (queryImpl->IsEmpty()) return hits;
+
+  for (const auto& pair : scene.BoxPairs(VecDH<Box>(1, queryImpl->bBox_)))
+    hits.push_back({pair.second, 0});
+  std::sort(hits.begin(), hits.end());
+
+  const int numHit = hits.size();
+  std::vector<std::exception_ptr> errors(numHit);
+  for_each_n(
+      numHit > 1 ? ExecutionPolicy::Par : ExecutionPolicy::Seq, countAt(0),
+      numHit,
+      CountQuery({hits.data(), scene.impls.data(), *queryImpl, errors.data()}));
+  RethrowFirst(errors);
+  hits.erase(std::remove_if(hits.begin(), hits.end(),
+                            [](const std::pair<int, int>& hit) {
+                              return hit.second == 0;
+                            }),
+             hits.end());
+  return hits;
+}
+
+/**
+ * Returns every pair of these manifolds whose surfaces may touch, with the
+ * number of overlaps NumOverlaps() would report. Build a CollisionScene
+ * instead to query the same set repeatedly.
+ */
+std::vector<OverlapPair> Manifold::Overlaps(
+    const std::vector<Manifold>& manifolds) {
+  return CollisionScene(manifolds).Overlaps();
+}
+
+}  // namespace manifold
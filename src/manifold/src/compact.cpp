@@ -0,0 +1,185 @@
+// Copyright 2022 The Manifold Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "impl.h"
+#include "par.h"
+
+namespace {
+using namespace manifold;
+
+constexpr int kMaxPositionBits = 21;
+
+// Grid spacing of positions quantized to bits per axis over bBox; zero along
+// a flat axis.
+vec3 GridStep(const Box& bBox, int bits) {
+  const Real cells = static_cast<Real>((uint64_t(1) << bits) - 1);
+  return (bBox.max - bBox.min) / cells;
+}
+
+struct QuantizePos {
+  const vec3 origin;
+  const vec3 step;
+  const int bits;
+
+  __host__ __device__ uint64_t operator()(vec3 pos) {
+    const uint64_t maxCell = (uint64_t(1) << bits) - 1;
+    uint64_t packed = 0;
+    for (int i : {2, 1, 0}) {
+      uint64_t cell = 0;
+      if (step[i] > 0) {
+        const Real x = glm::round((pos[i] - origin[i]) / step[i]);
+        cell = x <= 0 ? 0 : glm::min(static_cast<uint64_t>(x), maxCell);
+      }
+      packed = (packed << bits) | cell;
+    }
+    return packed;
+  }
+};
+
+struct DequantizePos {
+  const vec3 origin;
+  const vec3 step;
+  const int bits;
+
+  __host__ __device__ vec3 operator()(uint64_t packed) {
+    const uint64_t mask = (uint64_t(1) << bits) - 1;
+    vec3 pos;
+    for (int i : {0, 1, 2}) {
+      pos[i] = origin[i] + step[i] * static_cast<Real>(packed & mask);
+      packed >>= bits;
+    }
+    return pos;
+  }
+};
+
+// The faces and end verts are implied by the layout of three halfedges per
+// triangle.
+struct CornerToHalfedge {
+  int* endVert;
+  int* face;
+  const int* cornerVert;
+
+  __host__ __device__ void operator()(int edge) {
+    const int tri = edge / 3;
+    face[edge] = tri;
+    endVert[edge] = cornerVert[3 * tri + (edge + 1) % 3];
+  }
+};
+}  // namespace
+
+namespace manifold {
+
+/**
+ * Returns the cold form of this Impl: only bBox_, precision_, status_ and the
+ * cached properties are kept in place, while the mesh goes to compact_ with
+ * the derived normals and collider dropped and the halfedges reduced to a
+ * corner table of start verts and pairs. With positionBits in [1, 21] the
+ * positions are also quantized to that many bits per axis over bBox_, which
+ * is lossy: the positions are then only exact to half a grid step, so the
+ * precision is raised to cover that already here, where it can be queried
+ * without expanding. See Manifold::Compact().
+ */
+Manifold::Impl Manifold::Impl::Compact(int positionBits) const {
+  ASSERT(!IsCompact(), logicErr, "Impl is already compact!");
+  ASSERT(positionBits >= 0 && positionBits <= kMaxPositionBits, userErr,
+         "positionBits must be in [0, 21].");
+  auto compact = std::make_shared<CompactMesh>();
+  compact->numVert = NumVert();
+  compact->positionBits = positionBits;
+  Real precision = precision_;
+  if (positionBits == 0) {
+    compact->vertPos = vertPos_;
+  } else {
+    const vec3 step = GridStep(bBox_, positionBits);
+    compact->vertGrid.resize(NumVert());
+    transform(autoPolicy(NumVert()), vertPos_.begin(), vertPos_.end(),
+              compact->vertGrid.begin(),
+              QuantizePos({bBox_.min, step, positionBits}));
+    precision = glm::max(precision, glm::length(step));
+  }
+  compact->cornerVert = halfedge_.startVert;
+  compact->cornerPair = halfedge_.pairedHalfedge;
+  compact->halfedgeTangent = halfedgeTangent_;
+  compact->meshRelation = meshRelation_;
+
+  Impl cold;
+  cold.bBox_ = bBox_;
+  cold.precision_ = precision;
+  cold.status_ = status_;
+  cold.properties_ = properties_;
+  cold.booleanStats_ = booleanStats_;
+  cold.compact_ = compact;
+  return cold;
+}
+
+/**
+ * Rebuilds the full Impl from a compact one. The halfedges, tangents and mesh
+ * relation come back exactly, and so do the positions unless they were
+ * quantized. The face normals are recalculated from the positions, as for a
+ * Mesh given without them, and then the vert normals and the collider. The
+ * faces keep their order, so the collider is built without sorting them.
+ *
+ * Triangles that quantized positions collapse within the precision are
+ * removed as after a Boolean.
+ */
+Manifold::Impl Manifold::Impl::Expand() const {
+  ASSERT(IsCompact(), logicErr, "Impl is not compact!");
+  const CompactMesh& compact = *compact_;
+  Impl impl;
+  impl.bBox_ = bBox_;
+  impl.precision_ = precision_;
+  impl.status_ = status_;
+  impl.properties_ = properties_;
+  impl.booleanStats_ = booleanStats_;
+  if (compact.positionBits == 0) {
+    impl.vertPos_ = compact.vertPos;
+  } else {
+    const vec3 step = GridStep(bBox_, compact.positionBits);
+    impl.vertPos_.resize(compact.numVert);
+    transform(autoPolicy(compact.numVert), compact.vertGrid.begin(),
+              compact.vertGrid.end(), impl.vertPos_.begin(),
+              DequantizePos({bBox_.min, step, compact.positionBits}));
+  }
+
+  const int numHalfedge = compact.cornerVert.size();
+  impl.halfedge_.startVert = compact.cornerVert;
+  impl.halfedge_.pairedHalfedge = compact.cornerPair;
+  impl.halfedge_.endVert.resize(numHalfedge);
+  impl.halfedge_.face.resize(numHalfedge);
+  for_each_n(autoPolicy(numHalfedge), countAt(0), numHalfedge,
+             CornerToHalfedge({impl.halfedge_.endVert.ptrD(),
+                               impl.halfedge_.face.ptrD(),
+                               impl.halfedge_.startVert.cptrD()}));
+  impl.halfedgeTangent_ = compact.halfedgeTangent;
+  impl.meshRelation_ = compact.meshRelation;
+
+  impl.CalculateNormals();
+  if (compact.positionBits == 0) {
+    VecDH<Box> faceBox;
+    VecDH<uint32_t> faceMorton;
+    impl.GetFaceBoxMorton(faceBox, faceMorton);
+    impl.collider_.Rebuild(faceBox, faceMorton);
+  } else {
+    // The buffers taken from compact_ are still shared with it, so detach
+    // them before they are rewritten in place.
+    impl.halfedge_.ptrH();
+    impl.halfedgeTangent_.ptrH();
+    impl.meshRelation_.triBary.ptrH();
+    impl.meshRelation_.barycentric.ptrH();
+    impl.SimplifyTopology();
+    impl.Finish();
+  }
+  return impl;
+}
+}  // namespace manifold
@@ -14,8 +14,9 @@
 
 #include <thrust/sequence.h>
 
+#include <exception>
+
 #include "csg_tree.h"
-#include "graph.h"
 #include "impl.h"
 #include "par.h"
 #include "polygon.h"
@@ -25,26 +26,230 @@ using namespace manifold;
 using namespace thrust::placeholders;
 
 struct ToSphere {
-  float length;
-  __host__ __device__ void operator()(glm::vec3& v) {
-    v = glm::cos(glm::half_pi<float>() * (1.0f - v));
+  Real length;
+  __host__ __device__ void operator()(vec3& v) {
+    v = glm::cos(glm::half_pi<Real>() * (1.0f - v));
     v = length * glm::normalize(v);
-    if (isnan(v.x)) v = glm::vec3(0.0);
+    if (isnan(v.x)) v = vec3(0.0);
+  }
+};
+
+/**
+ * The known topology of Cylinder(), from which its halfedges are written
+ * directly. The verts are the bottom ring, then the top ring, or the single
+ * apex of a cone. The faces are the sides, two per segment for a cylinder or
+ * one for a cone, followed by the bottom cap and then the top cap. Each cap is
+ * a strip zigzagging across its ring, by strip positions: 0, 1, n - 1, 2, ...,
+ * which keeps its triangles well shaped.
+ */
+struct CylinderTopology {
+  int n;
+  bool cone;
+
+  __host__ __device__ int NumSide() const { return cone ? n : 2 * n; }
+  __host__ __device__ int NumTri() const {
+    return NumSide() + (cone ? 1 : 2) * (n - 2);
+  }
+  __host__ __device__ int NumVert() const { return cone ? n + 1 : 2 * n; }
+  __host__ __device__ int Next(int i) const { return i + 1 == n ? 0 : i + 1; }
+  __host__ __device__ int Prev(int i) const { return i == 0 ? n - 1 : i - 1; }
+
+  // The halfedges of the sides along the rings: from bottom vert i to i + 1,
+  // and from top vert i + 1 to i.
+  __host__ __device__ int BottomRing(int i) const {
+    return 3 * (cone ? i : 2 * i);
+  }
+  __host__ __device__ int TopRing(int i) const { return 3 * (2 * i + 1) + 1; }
+
+  __host__ __device__ int StripVert(int k) const {
+    return k == 0 ? 0 : k % 2 == 1 ? (k + 1) / 2 : n - k / 2;
+  }
+  __host__ __device__ int StripPos(int vert) const {
+    if (vert == 0) return 0;
+    return 2 * vert - 1 <= n - 1 ? 2 * vert - 1 : 2 * (n - vert);
+  }
+  __host__ __device__ int CapFace(int cap, int k) const {
+    return NumSide() + cap * (n - 2) + k;
+  }
+
+  // Ring verts of triangle k of a cap, wound clockwise from above for the
+  // bottom cap and counterclockwise for the top one. Even triangles of the
+  // strip are counterclockwise.
+  __host__ __device__ glm::ivec3 CapTri(int cap, int k) const {
+    const int a = StripVert(k);
+    const int b = StripVert(k + 1);
+    const int c = StripVert(k + 2);
+    return (k % 2 == 0) == (cap == 1) ? glm::ivec3(a, b, c)
+                                      : glm::ivec3(a, c, b);
+  }
+
+  // The cap triangle along the ring edge from vert i to i + 1.
+  __host__ __device__ int RingTri(int i) const {
+    const int p = StripPos(i);
+    const int q = StripPos(Next(i));
+    const int low = glm::min(p, q);
+    if (glm::abs(p - q) == 2) return low;
+    return low == 0 ? 0 : n - 3;
+  }
+
+  // The halfedge of cap triangle k from ring vert a to b.
+  __host__ __device__ int CapHalfedge(int cap, int k, int a, int b) const {
+    const glm::ivec3 tri = CapTri(cap, k);
+    int i = 0;
+    while (tri[i] != a || tri[(i + 1) % 3] != b) ++i;
+    return 3 * CapFace(cap, k) + i;
+  }
+
+  __host__ __device__ int CapPair(int cap, int k, int a, int b) const {
+    const int p = StripPos(a);
+    const int q = StripPos(b);
+    const int low = glm::min(p, q);
+    if (glm::abs(p - q) == 1 && low >= 1 && low <= n - 3)
+      // shared by triangles low - 1 and low of the strip
+      return CapHalfedge(cap, k == low ? low - 1 : low, b, a);
+    // the bottom cap runs backward along its ring, the top one forward
+    return cap == 0 ? BottomRing(b) : TopRing(a);
+  }
+
+  __host__ __device__ void Face(int face, glm::ivec3& verts,
+                                glm::ivec3& pairs) const {
+    const int top = n;
+    if (face < NumSide()) {
+      const int i = cone ? face : face / 2;
+      const int bottomPair = CapHalfedge(0, RingTri(i), Next(i), i);
+      if (cone) {
+        verts = {i, Next(i), top};
+        pairs = {bottomPair, 3 * Next(i) + 2, 3 * Prev(i) + 1};
+      } else if (face % 2 == 0) {
+        verts = {i, Next(i), top + Next(i)};
+        pairs = {bottomPair, 3 * (2 * Next(i) + 1) + 2, 3 * (2 * i + 1)};
+      } else {
+        verts = {i, top + Next(i), top + i};
+        pairs = {3 * (2 * i) + 2, CapHalfedge(1, RingTri(i), i, Next(i)),
+                 3 * (2 * Prev(i)) + 1};
+      }
+      return;
+    }
+    const int cap = (face - NumSide()) / (n - 2);
+    const int k = (face - NumSide()) % (n - 2);
+    const glm::ivec3 tri = CapTri(cap, k);
+    for (int i : {0, 1, 2}) {
+      verts[i] = tri[i] + (cap == 1 ? top : 0);
+      pairs[i] = CapPair(cap, k, tri[i], tri[(i + 1) % 3]);
+    }
   }
 };
 
-struct Equals {
-  int val;
-  __host__ __device__ bool operator()(int x) { return x == val; }
+struct CylinderHalfedges {
+  HalfedgePtr halfedge;
+  const CylinderTopology topology;
+
+  __host__ __device__ void operator()(int face) {
+    glm::ivec3 verts, pairs;
+    topology.Face(face, verts, pairs);
+    for (int i : {0, 1, 2})
+      halfedge.Set(3 * face + i,
+                   {verts[i], verts[(i + 1) % 3], pairs[i], face});
+  }
 };
 
-struct RemoveFace {
-  const Halfedge* halfedge;
-  const int* vertLabel;
-  const int keepLabel;
+struct CylinderVert {
+  const CylinderTopology topology;
+  const Real radiusLow;
+  const Real radiusHigh;
+  const Real height;
 
-  __host__ __device__ bool operator()(int face) {
-    return vertLabel[halfedge[3 * face].startVert] != keepLabel;
+  __host__ __device__ void operator()(thrust::tuple<vec3&, int> inOut) {
+    vec3& pos = thrust::get<0>(inOut);
+    const int vert = thrust::get<1>(inOut);
+    const int n = topology.n;
+    const bool bottom = vert < n;
+    if (!bottom && topology.cone) {
+      pos = vec3(0, 0, height);
+      return;
+    }
+    const Real phi = (360.0f / n) * (bottom ? vert : vert - n);
+    pos = vec3((bottom ? radiusLow : radiusHigh) * vec2(cosd(phi), sind(phi)),
+               bottom ? 0 : height);
+  }
+};
+
+// Returns the root of vert in the disjoint-set forest, halving the path on the
+// way up. This is safe to run concurrently with UnionEdge, as every link only
+// ever points to an ancestor.
+__host__ __device__ int FindRoot(int* parent, int vert) {
+  while (true) {
+    const int next = AtomicLoad(parent[vert]);
+    if (next == vert) return vert;
+    const int grand = AtomicLoad(parent[next]);
+    // A failed exchange means another thread already moved this link up.
+    if (grand != next) AtomicCompareExchange(parent[vert], next, grand);
+    vert = grand;
+  }
+}
+
+// Lock-free union: the larger root is linked under the smaller one, retrying
+// if either is no longer a root by the time of the exchange.
+struct UnionEdge {
+  int* parent;
+  HalfedgeCPtr halfedge;
+
+  __host__ __device__ void operator()(int edge) {
+    const Halfedge h = halfedge[edge];
+    if (!h.IsForward()) return;
+    int a = h.startVert;
+    int b = h.endVert;
+    while (true) {
+      a = FindRoot(parent, a);
+      b = FindRoot(parent, b);
+      if (a == b) return;
+      if (a < b) thrust::swap(a, b);
+      if (AtomicCompareExchange(parent[a], a, b)) return;
+    }
+  }
+};
+
+struct VertRoot {
+  int* parent;
+
+  __host__ __device__ int operator()(int vert) {
+    return FindRoot(parent, vert);
+  }
+};
+
+struct IsRoot {
+  const int* vertRoot;
+
+  __host__ __device__ int operator()(int vert) {
+    return vertRoot[vert] == vert;
+  }
+};
+
+struct VertComponent {
+  const int* rootComponent;
+
+  __host__ __device__ int operator()(int root) { return rootComponent[root]; }
+};
+
+struct FaceComponent {
+  HalfedgeCPtr halfedge;
+  const int* vertComponent;
+
+  __host__ __device__ int operator()(int face) {
+    return vertComponent[halfedge[3 * face].startVert];
+  }
+};
+
+// Maps each old index to its index within its own component, given the sorted
+// components and their starts.
+struct LocalIndex {
+  int* old2new;
+  const int* new2old;
+  const int* component;
+  const int* componentStart;
+
+  __host__ __device__ void operator()(int i) {
+    old2new[new2old[i]] = i - componentStart[component[i]];
   }
 };
 }  // namespace
@@ -104,10 +309,10 @@ Manifold Manifold::Tetrahedron() {
  * @param size The X, Y, and Z dimensions of the box.
  * @param center Set to true to shift the center to the origin.
  */
-Manifold Manifold::Cube(glm::vec3 size, bool center) {
+Manifold Manifold::Cube(vec3 size, bool center) {
   auto cube = Manifold(std::make_shared<Impl>(Impl::Shape::CUBE));
   cube = cube.Scale(size);
-  if (center) cube = cube.Translate(-size / 2.0f);
+  if (center) cube = cube.Translate(-size / Real(2));
   return cube;
 }
 
@@ -124,21 +329,28 @@ Manifold Manifold::Cube(glm::vec3 size, bool center) {
  * @param center Set to true to shift the center to the origin. Default is
  * origin at the bottom.
  */
-Manifold Manifold::Cylinder(float height, float radiusLow, float radiusHigh,
+Manifold Manifold::Cylinder(Real height, Real radiusLow, Real radiusHigh,
                             int circularSegments, bool center) {
-  float scale = radiusHigh >= 0.0f ? radiusHigh / radiusLow : 1.0f;
-  float radius = fmax(radiusLow, radiusHigh);
+  if (radiusHigh < 0.0f) radiusHigh = radiusLow;
+  Real radius = fmax(radiusLow, radiusHigh);
   int n = circularSegments > 2 ? circularSegments : GetCircularSegments(radius);
-  Polygons circle(1);
-  float dPhi = 360.0f / n;
-  for (int i = 0; i < n; ++i) {
-    circle[0].push_back(
-        {radiusLow * glm::vec2(cosd(dPhi * i), sind(dPhi * i)), 0});
-  }
-  Manifold cylinder =
-      Manifold::Extrude(circle, height, 0, 0.0f, glm::vec2(scale));
-  if (center)
-    cylinder = cylinder.Translate(glm::vec3(0.0f, 0.0f, -height / 2.0f));
+  if (n < 3) return Manifold();
+
+  // the topology is known, so the halfedges are written with their pairs
+  const CylinderTopology topology({n, radiusHigh == 0.0f});
+  const int numVert = topology.NumVert();
+  const int numTri = topology.NumTri();
+  auto pImpl_ = std::make_shared<Impl>();
+  pImpl_->vertPos_.resize(numVert);
+  for_each_n(autoPolicy(numVert), zip(pImpl_->vertPos_.begin(), countAt(0)),
+             numVert, CylinderVert({topology, radiusLow, radiusHigh, height}));
+  pImpl_->halfedge_.resize(3 * numTri);
+  for_each_n(autoPolicy(numTri), countAt(0), numTri,
+             CylinderHalfedges({pImpl_->halfedge_.ptrD(), topology}));
+  pImpl_->Finish();
+  pImpl_->InitializeNewReference();
+  Manifold cylinder(pImpl_);
+  if (center) cylinder = cylinder.Translate(vec3(0.0f, 0.0f, -height / 2.0f));
   return cylinder;
 }
 
@@ -152,7 +364,7 @@ Manifold Manifold::Cylinder(float height, float radiusLow, float radiusHigh,
  * there are a circle of vertices on all three of the axis planes. Default is
  * calculated by the static Defaults.
  */
-Manifold Manifold::Sphere(float radius, int circularSegments) {
+Manifold Manifold::Sphere(Real radius, int circularSegments) {
   int n = circularSegments > 0 ? (circularSegments + 3) / 4
                                : GetCircularSegments(radius) / 4;
   auto pImpl_ = std::make_shared<Impl>(Impl::Shape::OCTAHEDRON);
@@ -180,10 +392,10 @@ Manifold Manifold::Sphere(float radius, int circularSegments) {
  * scale is {0, 0}, a pure cone is formed with only a single vertex at the top.
  * Default {1, 1}.
  */
-Manifold Manifold::Extrude(Polygons crossSection, float height, int nDivisions,
-                           float twistDegrees, glm::vec2 scaleTop) {
-  scaleTop.x = glm::max(scaleTop.x, 0.0f);
-  scaleTop.y = glm::max(scaleTop.y, 0.0f);
+Manifold Manifold::Extrude(Polygons crossSection, Real height, int nDivisions,
+                           Real twistDegrees, vec2 scaleTop) {
+  scaleTop.x = glm::max(scaleTop.x, Real(0));
+  scaleTop.y = glm::max(scaleTop.y, Real(0));
 
   auto pImpl_ = std::make_shared<Impl>();
   ++nDivisions;
@@ -191,21 +403,27 @@ Manifold Manifold::Extrude(Polygons crossSection, float height, int nDivisions,
   VecDH<glm::ivec3> triVertsDH;
   auto& triVerts = triVertsDH;
   int nCrossSection = 0;
+  for (const auto& poly : crossSection) nCrossSection += poly.size();
   bool isCone = scaleTop.x == 0.0 && scaleTop.y == 0.0;
+  // enough for the walls and both caps, so the buffers are allocated once: a
+  // cap of n verts in p polygons has at most n + 2 * p triangles, n - 2 plus
+  // two per hole
+  vertPos.reserve(nCrossSection * (nDivisions + 1) + crossSection.size());
+  triVerts.reserve(2 * nCrossSection * nDivisions +
+                   2 * (nCrossSection + 2 * crossSection.size()));
   int idx = 0;
   for (auto& poly : crossSection) {
-    nCrossSection += poly.size();
     for (PolyVert& polyVert : poly) {
       vertPos.push_back({polyVert.pos.x, polyVert.pos.y, 0.0f});
       polyVert.idx = idx++;
     }
   }
   for (int i = 1; i < nDivisions + 1; ++i) {
-    float alpha = i / float(nDivisions);
-    float phi = alpha * twistDegrees;
-    glm::mat2 transform(cosd(phi), sind(phi), -sind(phi), cosd(phi));
-    glm::vec2 scale = glm::mix(glm::vec2(1.0f), scaleTop, alpha);
-    transform = transform * glm::mat2(scale.x, 0.0f, 0.0f, scale.y);
+    Real alpha = i / Real(nDivisions);
+    Real phi = alpha * twistDegrees;
+    mat2 transform(cosd(phi), sind(phi), -sind(phi), cosd(phi));
+    vec2 scale = glm::mix(vec2(1.0f), scaleTop, alpha);
+    transform = transform * mat2(scale.x, 0.0f, 0.0f, scale.y);
     int j = 0;
     int idx = 0;
     for (const auto& poly : crossSection) {
@@ -217,7 +435,7 @@ Manifold Manifold::Extrude(Polygons crossSection, float height, int nDivisions,
           triVerts.push_back({nCrossSection * i + j, lastVert - nCrossSection,
                               thisVert - nCrossSection});
         } else {
-          glm::vec2 pos = transform * poly[vert].pos;
+          vec2 pos = transform * poly[vert].pos;
           vertPos.push_back({pos.x, pos.y, height * alpha});
           triVerts.push_back({thisVert, lastVert, thisVert - nCrossSection});
           triVerts.push_back(
@@ -255,7 +473,7 @@ Manifold Manifold::Extrude(Polygons crossSection, float height, int nDivisions,
  * calculated by the static Defaults.
  */
 Manifold Manifold::Revolve(const Polygons& crossSection, int circularSegments) {
-  float radius = 0.0f;
+  Real radius = 0.0f;
   for (const auto& poly : crossSection) {
     for (const auto& vert : poly) {
       radius = fmax(radius, vert.pos.x);
@@ -267,7 +485,12 @@ Manifold Manifold::Revolve(const Polygons& crossSection, int circularSegments) {
   auto& vertPos = pImpl_->vertPos_;
   VecDH<glm::ivec3> triVertsDH;
   auto& triVerts = triVertsDH;
-  float dPhi = 360.0f / nDivisions;
+  int nPolyVert = 0;
+  for (const auto& poly : crossSection) nPolyVert += poly.size();
+  // each polygon vert becomes at most one ring and one axis vert
+  vertPos.reserve(nPolyVert * (nDivisions + 1));
+  triVerts.reserve(2 * nPolyVert * nDivisions);
+  Real dPhi = 360.0f / nDivisions;
   for (const auto& poly : crossSection) {
     int start = -1;
     for (int polyVert = 0; polyVert < poly.size(); ++polyVert) {
@@ -284,8 +507,8 @@ Manifold Manifold::Revolve(const Polygons& crossSection, int circularSegments) {
             (polyVert == 0 ? nDivisions * (poly.size() - 1) : -nDivisions);
         for (int slice = 0; slice < nDivisions; ++slice) {
           int lastSlice = (slice == 0 ? nDivisions : slice) - 1;
-          float phi = slice * dPhi;
-          glm::vec2 pos = poly[polyVert].pos;
+          Real phi = slice * dPhi;
+          vec2 pos = poly[polyVert].pos;
           vertPos.push_back({pos.x * cosd(phi), pos.x * sind(phi), pos.y});
           triVerts.push_back({startVert + slice, startVert + lastSlice,
                               lastStart + lastSlice});
@@ -295,21 +518,21 @@ Manifold Manifold::Revolve(const Polygons& crossSection, int circularSegments) {
       }
     } else {  // poly crosses zero
       int polyVert = start;
-      glm::vec2 pos = poly[polyVert].pos;
+      vec2 pos = poly[polyVert].pos;
       do {
-        glm::vec2 lastPos = pos;
+        vec2 lastPos = pos;
         polyVert = (polyVert + 1) % poly.size();
         pos = poly[polyVert].pos;
         if (pos.x > 0) {
           if (lastPos.x <= 0) {
-            float a = pos.x / (pos.x - lastPos.x);
+            Real a = pos.x / (pos.x - lastPos.x);
             vertPos.push_back({0.0f, 0.0f, glm::mix(pos.y, lastPos.y, a)});
           }
           int startVert = vertPos.size();
           for (int slice = 0; slice < nDivisions; ++slice) {
             int lastSlice = (slice == 0 ? nDivisions : slice) - 1;
-            float phi = slice * dPhi;
-            glm::vec2 pos = poly[polyVert].pos;
+            Real phi = slice * dPhi;
+            vec2 pos = poly[polyVert].pos;
             vertPos.push_back({pos.x * cosd(phi), pos.x * sind(phi), pos.y});
             if (lastPos.x > 0) {
               triVerts.push_back({startVert + slice, startVert + lastSlice,
@@ -324,7 +547,7 @@ Manifold Manifold::Revolve(const Polygons& crossSection, int circularSegments) {
           }
         } else if (lastPos.x > 0) {
           int startVert = vertPos.size();
-          float a = pos.x / (pos.x - lastPos.x);
+          Real a = pos.x / (pos.x - lastPos.x);
           vertPos.push_back({0.0f, 0.0f, glm::mix(pos.y, lastPos.y, a)});
           for (int slice = 0; slice < nDivisions; ++slice) {
             int lastSlice = (slice == 0 ? nDivisions : slice) - 1;
@@ -357,64 +580,125 @@ Manifold Manifold::Compose(const std::vector<Manifold>& manifolds) {
   return Manifold(std::make_shared<Impl>(CsgLeafNode::Compose(children)));
 }
 
+/**
+ * Labels the connected components of the mesh: the root of each vert is the
+ * smallest vert of its component.
+ */
+VecDH<int> Manifold::Impl::VertRoots() const {
+  const int numVert = NumVert();
+  auto policy = autoPolicy(halfedge_.size());
+  VecDH<int> parent(numVert);
+  sequence(policy, parent.begin(), parent.end());
+  for_each_n(policy, countAt(0), halfedge_.size(),
+             UnionEdge({parent.ptrD(), halfedge_.cptrD()}));
+  VecDH<int> vertRoot(numVert);
+  transform(policy, countAt(0), countAt(numVert), vertRoot.begin(),
+            VertRoot({parent.ptrD()}));
+  return vertRoot;
+}
+
 /**
  * This operation returns a vector of Manifolds that are topologically
  * disconnected. If everything is connected, the vector is length one,
  * containing a copy of the original. It is the inverse operation of Compose().
+ *
+ * The connected components are found by a parallel union-find over the edges,
+ * then the verts and faces are sorted by component once, so each of them is
+ * built from its own contiguous range in time proportional to its size.
  */
 std::vector<Manifold> Manifold::Decompose() const {
-  Graph graph;
   auto pImpl_ = GetCsgLeafNode().GetImpl();
-  for (int i = 0; i < NumVert(); ++i) {
-    graph.add_nodes(i);
-  }
-  for (const Halfedge& halfedge : pImpl_->halfedge_) {
-    if (halfedge.IsForward())
-      graph.add_edge(halfedge.startVert, halfedge.endVert);
-  }
-  std::vector<int> components;
-  const int numLabel = ConnectedComponents(components, graph);
+  const Impl& old = *pImpl_;
+  const int numVert = NumVert();
+  const int numTri = NumTri();
+  auto policy = autoPolicy(old.halfedge_.size());
+
+  const VecDH<int> vertRoot = old.VertRoots();
 
+  // Number the components in the order of their first vert.
+  VecDH<int> rootComponent(numVert);
+  transform(policy, countAt(0), countAt(numVert), rootComponent.begin(),
+            IsRoot({vertRoot.cptrD()}));
+  const int numLabel =
+      reduce<int>(policy, rootComponent.begin(), rootComponent.end());
   if (numLabel == 1) {
     std::vector<Manifold> meshes(1);
     meshes[0] = *this;
     return meshes;
   }
-  VecDH<int> vertLabel(components);
-
-  std::vector<Manifold> meshes;
-  for (int i = 0; i < numLabel; ++i) {
-    auto impl = std::make_shared<Impl>();
-    // inherit original object's precision
-    impl->precision_ = pImpl_->precision_;
-    impl->vertPos_.resize(NumVert());
-    VecDH<int> vertNew2Old(NumVert());
-    auto policy = autoPolicy(NumVert());
-    auto start = zip(impl->vertPos_.begin(), vertNew2Old.begin());
-    int nVert =
-        copy_if<decltype(start)>(
-            policy, zip(pImpl_->vertPos_.begin(), countAt(0)),
-            zip(pImpl_->vertPos_.end(), countAt(NumVert())), vertLabel.begin(),
-            zip(impl->vertPos_.begin(), vertNew2Old.begin()), Equals({i})) -
-        start;
-    impl->vertPos_.resize(nVert);
-
-    VecDH<int> faceNew2Old(NumTri());
-    sequence(policy, faceNew2Old.begin(), faceNew2Old.end());
-
-    int nFace =
-        remove_if<decltype(faceNew2Old.begin())>(
-            policy, faceNew2Old.begin(), faceNew2Old.end(),
-            RemoveFace({pImpl_->halfedge_.cptrD(), vertLabel.cptrD(), i})) -
-        faceNew2Old.begin();
-    faceNew2Old.resize(nFace);
-
-    impl->GatherFaces(*pImpl_, faceNew2Old);
-    impl->ReindexVerts(vertNew2Old, pImpl_->NumVert());
-
-    impl->Finish();
-
-    meshes.push_back(Manifold(impl));
+  exclusive_scan(policy, rootComponent.begin(), rootComponent.end(),
+                 rootComponent.begin());
+
+  VecDH<int> vertComponent(numVert);
+  transform(policy, vertRoot.begin(), vertRoot.end(), vertComponent.begin(),
+            VertComponent({rootComponent.cptrD()}));
+  VecDH<int> faceComponent(numTri);
+  transform(policy, countAt(0), countAt(numTri), faceComponent.begin(),
+            FaceComponent({old.halfedge_.cptrD(), vertComponent.cptrD()}));
+
+  VecDH<int> vertNew2Old(numVert);
+  sequence(policy, vertNew2Old.begin(), vertNew2Old.end());
+  stable_sort_by_key(policy, vertComponent.begin(), vertComponent.end(),
+                     vertNew2Old.begin());
+  VecDH<int> faceNew2Old(numTri);
+  sequence(policy, faceNew2Old.begin(), faceNew2Old.end());
+  stable_sort_by_key(policy, faceComponent.begin(), faceComponent.end(),
+                     faceNew2Old.begin());
+
+  VecDH<int> vertStart(numLabel + 1);
+  lower_bound(policy, vertComponent.begin(), vertComponent.end(), countAt(0),
+              countAt(numLabel + 1), vertStart.begin());
+  VecDH<int> faceStart(numLabel + 1);
+  lower_bound(policy, faceComponent.begin(), faceComponent.end(), countAt(0),
+              countAt(numLabel + 1), faceStart.begin());
+
+  VecDH<int> vertOld2New(numVert);
+  for_each_n(policy, countAt(0), numVert,
+             LocalIndex({vertOld2New.ptrD(), vertNew2Old.cptrD(),
+                         vertComponent.cptrD(), vertStart.cptrD()}));
+  VecDH<int> faceOld2New(numTri);
+  for_each_n(policy, countAt(0), numTri,
+             LocalIndex({faceOld2New.ptrD(), faceNew2Old.cptrD(),
+                         faceComponent.cptrD(), faceStart.cptrD()}));
+
+  // The components are independent, so they are built concurrently.
+  std::vector<Manifold> meshes(numLabel);
+  const int* vertStartH = vertStart.cptrH();
+  const int* faceStartH = faceStart.cptrH();
+  const int* vertNew2OldH = vertNew2Old.cptrH();
+  const int* faceNew2OldH = faceNew2Old.cptrH();
+  old.vertPos_.cptrH();
+  faceOld2New.cptrH();
+  vertOld2New.cptrH();
+  // Exceptions, e.g. memoryErr, must not escape the parallel backend.
+  std::vector<std::exception_ptr> errors(numLabel);
+  for_each_n(numLabel > 1 ? ExecutionPolicy::Par : ExecutionPolicy::Seq,
+             countAt(0), numLabel, [&](int i) {
+               const int nVert = vertStartH[i + 1] - vertStartH[i];
+               const int nFace = faceStartH[i + 1] - faceStartH[i];
+               try {
+                 auto impl = std::make_shared<Impl>();
+                 // inherit original object's precision
+                 impl->precision_ = old.precision_;
+                 impl->vertPos_.resize(nVert);
+                 for (int v = 0; v < nVert; ++v)
+                   impl->vertPos_[v] =
+                       old.vertPos_[vertNew2OldH[vertStartH[i] + v]];
+                 VecDH<int> componentFaces(nFace);
+                 std::copy(faceNew2OldH + faceStartH[i],
+                           faceNew2OldH + faceStartH[i + 1],
+                           componentFaces.ptrH());
+
+                 impl->GatherFaces(old, componentFaces, faceOld2New,
+                                   vertOld2New);
+                 impl->Finish();
+                 meshes[i] = Manifold(impl);
+               } catch (...) {
+                 errors[i] = std::current_exception();
+               }
+             });
+  for (const auto &error : errors) {
+    if (error) std::rethrow_exception(error);
   }
   return meshes;
 }
@@ -0,0 +1,284 @@
+// Copyright 2022 The Manifold Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "csg_cache.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "boolean3.h"
+#include "par.h"
+
+namespace {
+using namespace manifold;
+
+template <typename T>
+uint64_t HashWords(uint64_t seed, const VecDH<T>& vec) {
+  static_assert(sizeof(T) % sizeof(uint32_t) == 0,
+                "Only types made of 32-bit words can be hashed.");
+  constexpr int kWords = sizeof(T) / sizeof(uint32_t);
+  seed = HashCombine(seed, vec.size());
+  const T* data = vec.cptrH();
+  for (int i = 0; i < vec.size(); ++i) {
+    uint32_t words[kWords];
+    std::memcpy(words, data + i, sizeof(T));
+    for (int j = 0; j < kWords; ++j) seed = HashCombine(seed, words[j]);
+  }
+  return seed;
+}
+
+uint64_t HashFloat(uint64_t seed, Real value) {
+  uint64_t bits = 0;
+  std::memcpy(&bits, &value, sizeof(Real));
+  return HashCombine(seed, bits);
+}
+
+// Results computed with and without robust predicates may differ, so the
+// mode is folded into every hash the cache stores or looks up.
+uint64_t WithPredicates(uint64_t hash) {
+  return HashCombine(hash, RobustPredicates());
+}
+
+// Whether this thread holds the cache's mutex, so that the memory-pressure
+// handler can tell an allocation made inside the cache from one made
+// elsewhere, without locking a mutex its own thread may already own.
+thread_local bool insideCache = false;
+
+class CacheLock {
+ public:
+  explicit CacheLock(std::mutex& mutex) : lock_(mutex) { insideCache = true; }
+  ~CacheLock() { insideCache = false; }
+
+ private:
+  std::lock_guard<std::mutex> lock_;
+};
+
+struct RemapOriginalID {
+  const int* oldIDs;
+  const int* newIDs;
+  const int numID;
+
+  __host__ __device__ void operator()(BaryRef& ref) {
+    // oldIDs is sorted
+    int start = 0;
+    int end = numID;
+    while (start < end) {
+      const int mid = (start + end) / 2;
+      if (oldIDs[mid] < ref.originalID)
+        start = mid + 1;
+      else
+        end = mid;
+    }
+    if (start < numID && oldIDs[start] == ref.originalID)
+      ref.originalID = newIDs[start];
+  }
+};
+}  // namespace
+
+namespace manifold {
+
+uint64_t HashCombine(uint64_t seed, uint64_t value) {
+  // hash_combine from boost, with a splitmix64 finalizer for 64-bit mixing
+  uint64_t x = seed ^ (value + 0x9e3779b97f4a7c15ull + (seed << 6) +
+                       (seed >> 2));
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+  return x ^ (x >> 31);
+}
+
+uint64_t HashMatrix(uint64_t seed, const mat4x3& transform) {
+  for (int col : {0, 1, 2, 3})
+    for (int row : {0, 1, 2}) seed = HashFloat(seed, transform[col][row]);
+  return seed;
+}
+
+void CacheKey::AddTerms(const mat4x3& transform) {
+  for (int col : {0, 1, 2, 3})
+    for (int row : {0, 1, 2}) {
+      uint64_t bits = 0;
+      std::memcpy(&bits, &transform[col][row], sizeof(Real));
+      AddTerm(bits);
+    }
+}
+
+/**
+ * Hash everything the result of a Boolean depends on: the geometry and
+ * topology as well as the mesh relation. The meshIDs and originalIDs are
+ * hashed by their rank of first appearance, and the distinct originalIDs are
+ * returned in that order.
+ */
+uint64_t HashImpl(const Manifold::Impl& impl, std::vector<int>& originalIDs) {
+  uint64_t seed = HashFloat(0, impl.precision_);
+  seed = HashWords(seed, impl.vertPos_);
+  seed = HashWords(seed, impl.halfedge_.startVert);
+  seed = HashWords(seed, impl.halfedge_.endVert);
+  seed = HashWords(seed, impl.halfedge_.pairedHalfedge);
+  seed = HashWords(seed, impl.halfedge_.face);
+  seed = HashWords(seed, impl.halfedgeTangent_);
+  seed = HashWords(seed, impl.meshRelation_.barycentric);
+
+  CacheKey originals;
+  std::unordered_map<int, int> meshIDrank;
+  const VecDH<BaryRef>& triBary = impl.meshRelation_.triBary;
+  seed = HashCombine(seed, triBary.size());
+  for (int i = 0; i < triBary.size(); ++i) {
+    const BaryRef& ref = triBary[i];
+    const int meshID =
+        meshIDrank.emplace(ref.meshID, meshIDrank.size()).first->second;
+    seed = HashCombine(seed, meshID);
+    seed = HashCombine(seed, originals.Rank(ref.originalID));
+    seed = HashCombine(seed, ref.tri);
+    for (int j : {0, 1, 2}) seed = HashCombine(seed, ref.vertBary[j]);
+  }
+  originalIDs = originals.originalIDs;
+  return seed;
+}
+
+/**
+ * Approximate memory held by an Impl: its buffers, counted in full even when
+ * they are shared, plus the structure itself.
+ */
+size_t ImplBytes(const Manifold::Impl& impl) {
+  return sizeof(Manifold::Impl) + impl.GetMemoryUsage().Total();
+}
+
+CsgCache& CsgCache::Get() {
+  static CsgCache cache;
+  return cache;
+}
+
+/**
+ * When an allocation would exceed the memory budget, the cached results are
+ * the first to go. The handler runs inside whichever allocation hit the
+ * budget, possibly one made while this thread holds the mutex, in which case
+ * it gives up rather than lock it again.
+ */
+CsgCache::CsgCache() {
+  MemoryResource::SetPressureHandler([this]() {
+    if (insideCache) return;
+    CacheLock lock(mutex_);
+    Evict(0);
+  });
+}
+
+CsgCache::~CsgCache() { MemoryResource::SetPressureHandler(nullptr); }
+
+void CsgCache::SetBudget(size_t bytes) {
+  CacheLock lock(mutex_);
+  budget_.store(bytes, std::memory_order_relaxed);
+  Evict(bytes);
+}
+
+void CsgCache::Clear() {
+  CacheLock lock(mutex_);
+  Evict(0);
+  hits_ = 0;
+  misses_ = 0;
+}
+
+CacheStats CsgCache::Stats() const {
+  CacheLock lock(mutex_);
+  CacheStats stats;
+  stats.hits = hits_;
+  stats.misses = misses_;
+  stats.entries = lru_.size();
+  stats.bytes = bytes_;
+  stats.budget = budget_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+/**
+ * Returns a new copy of the cached result for this key, or nullptr on a miss.
+ * The copy gets fresh meshIDs, like any Boolean result, and its originalIDs
+ * are remapped onto the ones of the subtree being evaluated.
+ */
+std::shared_ptr<const Manifold::Impl> CsgCache::Find(const CacheKey& key) {
+  std::shared_ptr<const Manifold::Impl> cached;
+  std::vector<int> cachedIDs;
+  {
+    CacheLock lock(mutex_);
+    auto it = index_.find(WithPredicates(key.hash));
+    if (it == index_.end() || it->second->terms != key.terms ||
+        it->second->originalIDs.size() != key.originalIDs.size()) {
+      ++misses_;
+      return nullptr;
+    }
+    ++hits_;
+    lru_.splice(lru_.begin(), lru_, it->second);
+    cached = it->second->result;
+    cachedIDs = it->second->originalIDs;
+  }
+
+  auto result = std::make_shared<Manifold::Impl>(*cached);
+  if (cachedIDs != key.originalIDs) {
+    VecDH<int> oldIDs(cachedIDs);
+    VecDH<int> newIDs(key.originalIDs);
+    sort_by_key(autoPolicy(oldIDs.size()), oldIDs.begin(), oldIDs.end(),
+                newIDs.begin());
+    for_each(autoPolicy(result->NumTri()),
+             result->meshRelation_.triBary.begin(),
+             result->meshRelation_.triBary.end(),
+             RemapOriginalID({oldIDs.cptrD(), newIDs.cptrD(), oldIDs.size()}));
+  }
+  result->IncrementMeshIDs(0, result->NumTri());
+  return result;
+}
+
+void CsgCache::Insert(const CacheKey& key,
+                      std::shared_ptr<const Manifold::Impl> result,
+                      std::vector<uint64_t> members) {
+  const size_t bytes =
+      ImplBytes(*result) + key.terms.size() * sizeof(uint64_t);
+  const uint64_t hash = WithPredicates(key.hash);
+  for (uint64_t& member : members) member = WithPredicates(member);
+  CacheLock lock(mutex_);
+  const size_t budget = budget_.load(std::memory_order_relaxed);
+  if (bytes > budget || index_.find(hash) != index_.end()) return;
+  Evict(budget - bytes);
+  for (uint64_t member : members) ++members_[member];
+  lru_.push_front(
+      {hash, result, key.originalIDs, key.terms, std::move(members), bytes});
+  index_[hash] = lru_.begin();
+  bytes_ += bytes;
+}
+
+/**
+ * Whether this hash is the key of a cached result or the hash of an operand
+ * of one of the cached partial unions.
+ */
+bool CsgCache::Contains(uint64_t hash) const {
+  hash = WithPredicates(hash);
+  CacheLock lock(mutex_);
+  return index_.find(hash) != index_.end() ||
+         members_.find(hash) != members_.end();
+}
+
+/**
+ * Drop the least recently used results until at most budget bytes are held.
+ * The mutex must be held by the caller.
+ */
+void CsgCache::Evict(size_t budget) {
+  while (bytes_ > budget && !lru_.empty()) {
+    const Entry& entry = lru_.back();
+    for (uint64_t member : entry.members) {
+      auto it = members_.find(member);
+      if (--it->second == 0) members_.erase(it);
+    }
+    bytes_ -= entry.bytes;
+    index_.erase(entry.hash);
+    lru_.pop_back();
+  }
+}
+
+}  // namespace manifold
@@ -0,0 +1,112 @@
+// Copyright 2022 The Manifold Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+#include "impl.h"
+
+namespace manifold {
+
+/** @addtogroup Private
+ *  @{
+ */
+uint64_t HashCombine(uint64_t seed, uint64_t value);
+uint64_t HashMatrix(uint64_t seed, const mat4x3& transform);
+uint64_t HashImpl(const Manifold::Impl& impl, std::vector<int>& originalIDs);
+size_t ImplBytes(const Manifold::Impl& impl);
+
+/**
+ * The structural key of a CSG subtree. The originalIDs of the leaves are not
+ * hashed directly, but by the rank of their first appearance in the subtree,
+ * so that identical trees built from separately constructed meshes share a
+ * key. The actual IDs are kept so that a cached result can be remapped.
+ *
+ * Besides the hash, the key records in terms everything that went into it,
+ * with each leaf mesh represented by its content hash, so that a lookup only
+ * hits a result of the same tree and not of another one whose hash collides.
+ */
+struct CacheKey {
+  uint64_t hash = 0;
+  std::vector<int> originalIDs;
+  std::vector<uint64_t> terms;
+
+  int Rank(int originalID) {
+    auto it = id2rank_.find(originalID);
+    if (it != id2rank_.end()) return it->second;
+    const int rank = originalIDs.size();
+    originalIDs.push_back(originalID);
+    id2rank_.emplace(originalID, rank);
+    return rank;
+  }
+
+  void AddTerm(uint64_t value) { terms.push_back(value); }
+  void AddTerms(const mat4x3& transform);
+
+ private:
+  std::unordered_map<int, int> id2rank_;
+};
+
+/**
+ * Process-wide LRU cache of Boolean results, disabled until given a nonzero
+ * memory budget. Besides whole CsgOpNode results, it holds the partial unions
+ * of BatchUnion's spatial clusters, which makes re-evaluating an edited tree
+ * incremental: only the clusters touched by a changed operand are recomputed.
+ */
+class CsgCache {
+ public:
+  static CsgCache& Get();
+
+  bool Enabled() const { return budget_.load(std::memory_order_relaxed) > 0; }
+  void SetBudget(size_t bytes);
+  void Clear();
+  CacheStats Stats() const;
+
+  std::shared_ptr<const Manifold::Impl> Find(const CacheKey& key);
+  void Insert(const CacheKey& key, std::shared_ptr<const Manifold::Impl> result,
+              std::vector<uint64_t> members = {});
+  bool Contains(uint64_t hash) const;
+
+ private:
+  struct Entry {
+    uint64_t hash;
+    std::shared_ptr<const Manifold::Impl> result;
+    std::vector<int> originalIDs;
+    std::vector<uint64_t> terms;
+    // standalone hashes of the operands whose union this result is
+    std::vector<uint64_t> members;
+    size_t bytes;
+  };
+
+  CsgCache();
+  ~CsgCache();
+
+  mutable std::mutex mutex_;
+  std::atomic<size_t> budget_{0};
+  size_t bytes_ = 0;
+  size_t hits_ = 0;
+  size_t misses_ = 0;
+  // most recently used first
+  std::list<Entry> lru_;
+  std::unordered_map<uint64_t, std::list<Entry>::iterator> index_;
+  // reference count of each member hash over all entries
+  std::unordered_map<uint64_t, int> members_;
+
+  void Evict(size_t budget);
+};
+/** @} */
+}  // namespace manifold
@@ -14,28 +14,28 @@
 
 #include "csg_tree.h"
 
+#include <thrust/transform_reduce.h>
+
 #include <algorithm>
+#include <exception>
+#include <limits>
+#include <unordered_set>
 
 #include "boolean3.h"
+#include "csg_cache.h"
+#include "graph.h"
 #include "impl.h"
 #include "par.h"
+#include "trace.h"
 
 namespace {
 using namespace manifold;
-struct Transform4x3 {
-  const glm::mat4x3 transform;
-
-  __host__ __device__ glm::vec3 operator()(glm::vec3 position) {
-    return transform * glm::vec4(position, 1.0f);
-  }
-};
-
 struct TransformNormals {
-  const glm::mat3 transform;
+  const mat3 transform;
 
-  __host__ __device__ glm::vec3 operator()(glm::vec3 normal) {
+  __host__ __device__ vec3 operator()(vec3 normal) {
     normal = glm::normalize(transform * normal);
-    if (isnan(normal.x)) normal = glm::vec3(0.0f);
+    if (isnan(normal.x)) normal = vec3(0.0f);
     return normal;
   }
 };
@@ -50,54 +50,267 @@ struct UpdateTriBary {
   }
 };
 
-struct UpdateHalfedge {
-  const int nextVert;
-  const int nextEdge;
-  const int nextFace;
+// The buffers of one of the nodes of a Compose, and where they go in the
+// output. The buffers a node lacks are nullptr.
+struct ComposeNode {
+  const vec3 *vertPos;
+  const vec3 *faceNormal;
+  const vec4 *halfedgeTangent;
+  const vec3 *barycentric;
+  const BaryRef *triBary;
+  HalfedgeCPtr halfedge;
+  mat4x3 transform;
+  mat3 normalTransform;
+  bool identity;
+  int vertStart, edgeStart, triStart, baryStart;
+};
+
+// Index of the node whose range holds element i, given the start of each
+// node's range; empty nodes share their start with the next one.
+__host__ __device__ int NodeOf(const int *start, int numNode, int i) {
+  int lo = 0;
+  int hi = numNode;
+  while (hi - lo > 1) {
+    const int mid = (lo + hi) / 2;
+    if (start[mid] <= i)
+      lo = mid;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+struct ComposeVerts {
+  vec3 *vertPosR;
+  const ComposeNode *nodes;
+  const int *vertStart;
+  const int numNode;
+
+  __host__ __device__ void operator()(int vert) {
+    const ComposeNode &node = nodes[NodeOf(vertStart, numNode, vert)];
+    const vec3 pos = node.vertPos[vert - node.vertStart];
+    vertPosR[vert] = node.identity ? pos : node.transform * vec4(pos, 1.0f);
+  }
+};
+
+struct ComposeHalfedges {
+  HalfedgePtr halfedgeR;
+  vec4 *halfedgeTangentR;
+  const ComposeNode *nodes;
+  const int *edgeStart;
+  const int numNode;
+
+  __host__ __device__ void operator()(int edge) {
+    const ComposeNode &node = nodes[NodeOf(edgeStart, numNode, edge)];
+    const int local = edge - node.edgeStart;
+    Halfedge halfedge = node.halfedge[local];
+    halfedge.startVert += node.vertStart;
+    halfedge.endVert += node.vertStart;
+    halfedge.pairedHalfedge += node.edgeStart;
+    halfedge.face += node.triStart;
+    halfedgeR.Set(edge, halfedge);
+    halfedgeTangentR[edge] = node.halfedgeTangent == nullptr
+                                 ? vec4(0.0f)
+                                 : node.halfedgeTangent[local];
+  }
+};
+
+struct ComposeTris {
+  vec3 *faceNormalR;
+  BaryRef *triBaryR;
+  uint64_t *meshKey;
+  const ComposeNode *nodes;
+  const int *triStart;
+  const int numNode;
+
+  __host__ __device__ void operator()(int tri) {
+    const int n = NodeOf(triStart, numNode, tri);
+    const ComposeNode &node = nodes[n];
+    const int local = tri - node.triStart;
+    vec3 normal(0.0f);
+    if (node.faceNormal != nullptr) {
+      normal = node.faceNormal[local];
+      if (!node.identity)
+        normal = TransformNormals({node.normalTransform})(normal);
+    }
+    faceNormalR[tri] = normal;
+    const BaryRef ref = UpdateTriBary({node.baryStart})(node.triBary[local]);
+    triBaryR[tri] = ref;
+    // Since the nodes may be copies containing the same meshIDs, each node
+    // instance gets its own new meshIDs.
+    meshKey[tri] = (static_cast<uint64_t>(n) << 32) | ref.meshID;
+  }
+};
+
+struct ComposeBarycentric {
+  vec3 *barycentricR;
+  const ComposeNode *nodes;
+  const int *baryStart;
+  const int numNode;
 
-  __host__ __device__ Halfedge operator()(Halfedge edge) {
-    edge.startVert += nextVert;
-    edge.endVert += nextVert;
-    edge.pairedHalfedge += nextEdge;
-    edge.face += nextFace;
-    return edge;
+  __host__ __device__ void operator()(int bary) {
+    const ComposeNode &node = nodes[NodeOf(baryStart, numNode, bary)];
+    barycentricR[bary] = node.barycentric[bary - node.baryStart];
   }
 };
 
-struct CheckOverlap {
-  const Box *boxes;
-  const size_t i;
-  __host__ __device__ bool operator()(int j) {
-    return boxes[i].DoesOverlap(boxes[j]);
+struct UpdateComposedMeshID {
+  BaryRef *triBaryR;
+  const int *meshIndex;
+  const int meshIDstart;
+
+  __host__ __device__ void operator()(int tri) {
+    triBaryR[tri].meshID = meshIDstart + meshIndex[tri];
+  }
+};
+
+struct TransformBox {
+  const mat4x3 transform;
+
+  __host__ __device__ Box operator()(vec3 position) {
+    const vec3 pos = transform * vec4(position, 1.0f);
+    return Box(pos, pos);
+  }
+};
+
+struct UnionBox {
+  __host__ __device__ Box operator()(const Box &a, const Box &b) {
+    return a.Union(b);
   }
 };
+
+// Exceptions, e.g. memoryErr, must not escape the parallel backend, so they
+// are kept in errors to be rethrown after the loop.
+struct BooleanPair {
+  const std::shared_ptr<CsgLeafNode> *inputs;
+  std::shared_ptr<CsgLeafNode> *outputs;
+  std::exception_ptr *errors;
+  const Manifold::OpType operation;
+
+  void operator()(int i) {
+    TraceSpan span("BatchBoolean pair");
+    span.Arg("numVertA", inputs[2 * i]->NumVert());
+    span.Arg("numVertB", inputs[2 * i + 1]->NumVert());
+    try {
+      outputs[i] =
+          CsgLeafNode::Boolean(*inputs[2 * i], *inputs[2 * i + 1], operation);
+    } catch (...) {
+      errors[i] = std::current_exception();
+      return;
+    }
+    span.Arg("numVert", outputs[i]->NumVert());
+  }
+};
+
+const char *OpName(CsgNodeType op) {
+  switch (op) {
+    case CsgNodeType::UNION:
+      return "union";
+    case CsgNodeType::INTERSECTION:
+      return "intersection";
+    case CsgNodeType::DIFFERENCE:
+      return "difference";
+    case CsgNodeType::LEAF:
+      break;
+  }
+  return "leaf";
+}
+
+// Greedily partitions the boxes, in Morton order, into sets of pairwise
+// disjoint ones, as BatchUnion() does within each of its clusters.
+std::vector<std::vector<int>> DisjointSets(const std::vector<Box> &boxesIn) {
+  const int numBox = boxesIn.size();
+  if (numBox < 2) return {std::vector<int>(numBox, 0)};
+  Box bBox;
+  for (const Box &box : boxesIn) bBox = bBox.Union(box);
+  VecDH<Box> boxes(boxesIn);
+  auto policy = autoPolicy(numBox);
+  VecDH<uint32_t> boxMorton(numBox);
+  VecDH<int> sorted2box(numBox);
+  sequence(policy, sorted2box.begin(), sorted2box.end());
+  transform(policy, boxes.begin(), boxes.end(), boxMorton.begin(),
+            BoxMorton({bBox}));
+  sort_by_key(policy, boxMorton.begin(), boxMorton.end(),
+              zip(boxes.begin(), sorted2box.begin()));
+
+  Collider collider(boxes, boxMorton);
+  SparseIndices overlaps = collider.Collisions(boxes);
+  VecDH<int> neighborStart(numBox + 1);
+  lower_bound(policy, overlaps.Get(0).begin(), overlaps.Get(0).end(),
+              countAt(0), countAt(numBox + 1), neighborStart.begin());
+  const int *neighborStartH = neighborStart.cptrH();
+  const int *neighbor = overlaps.Get(1).cptrH();
+  const int *sortedBox = sorted2box.cptrH();
+
+  std::vector<std::vector<int>> disjointSets;
+  std::vector<int> disjointSetOf(numBox, -1);
+  for (int i = 0; i < numBox; ++i) {
+    std::vector<bool> taken(disjointSets.size(), false);
+    for (int k = neighborStartH[i]; k < neighborStartH[i + 1]; ++k) {
+      const int set = disjointSetOf[neighbor[k]];
+      if (set >= 0) taken[set] = true;
+    }
+    const int set =
+        std::find(taken.begin(), taken.end(), false) - taken.begin();
+    if (set == disjointSets.size()) disjointSets.emplace_back();
+    disjointSets[set].push_back(sortedBox[i]);
+    disjointSetOf[i] = set;
+  }
+  return disjointSets;
+}
+
+// Leaves may be shared by subtrees which are evaluated concurrently.
+std::mutex leafHashMutex;
 }  // namespace
 namespace manifold {
 
-std::shared_ptr<CsgNode> CsgNode::Translate(const glm::vec3 &t) const {
-  glm::mat4x3 transform(1.0f);
+/**
+ * Throws cancelErr once the evaluation has been cancelled. This is only called
+ * between op nodes, so a Boolean already running is finished first.
+ */
+void EvalContext::Check() const {
+  if (cancelled.load(std::memory_order_relaxed))
+    throw cancelErr("CSG evaluation was cancelled.");
+}
+
+/**
+ * Reports the evaluation of one more op node to the progress callback, which
+ * cancels the evaluation by returning false.
+ */
+void EvalContext::Step() {
+  if (!progress) {
+    ++done;
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mutex);
+  const int numDone = ++done;
+  if (!progress(glm::min(numDone, total), total)) cancelled = true;
+}
+
+std::shared_ptr<CsgNode> CsgNode::Translate(const vec3 &t) const {
+  mat4x3 transform(1.0f);
   transform[3] += t;
   return Transform(transform);
 }
 
-std::shared_ptr<CsgNode> CsgNode::Scale(const glm::vec3 &v) const {
-  glm::mat4x3 transform(1.0f);
+std::shared_ptr<CsgNode> CsgNode::Scale(const vec3 &v) const {
+  mat4x3 transform(1.0f);
   for (int i : {0, 1, 2}) transform[i] *= v;
   return Transform(transform);
 }
 
-std::shared_ptr<CsgNode> CsgNode::Rotate(float xDegrees, float yDegrees,
-                                         float zDegrees) const {
-  glm::mat3 rX(1.0f, 0.0f, 0.0f,                      //
-               0.0f, cosd(xDegrees), sind(xDegrees),  //
-               0.0f, -sind(xDegrees), cosd(xDegrees));
-  glm::mat3 rY(cosd(yDegrees), 0.0f, -sind(yDegrees),  //
-               0.0f, 1.0f, 0.0f,                       //
-               sind(yDegrees), 0.0f, cosd(yDegrees));
-  glm::mat3 rZ(cosd(zDegrees), sind(zDegrees), 0.0f,   //
-               -sind(zDegrees), cosd(zDegrees), 0.0f,  //
-               0.0f, 0.0f, 1.0f);
-  glm::mat4x3 transform(rZ * rY * rX);
+std::shared_ptr<CsgNode> CsgNode::Rotate(Real xDegrees, Real yDegrees,
+                                         Real zDegrees) const {
+  mat3 rX(1.0f, 0.0f, 0.0f,                      //
+          0.0f, cosd(xDegrees), sind(xDegrees),  //
+          0.0f, -sind(xDegrees), cosd(xDegrees));
+  mat3 rY(cosd(yDegrees), 0.0f, -sind(yDegrees),  //
+          0.0f, 1.0f, 0.0f,                       //
+          sind(yDegrees), 0.0f, cosd(yDegrees));
+  mat3 rZ(cosd(zDegrees), sind(zDegrees), 0.0f,   //
+          -sind(zDegrees), cosd(zDegrees), 0.0f,  //
+          0.0f, 0.0f, 1.0f);
+  mat4x3 transform(rZ * rY * rX);
   return Transform(transform);
 }
 
@@ -107,119 +320,324 @@ CsgLeafNode::CsgLeafNode(std::shared_ptr<const Manifold::Impl> pImpl_)
     : pImpl_(pImpl_) {}
 
 CsgLeafNode::CsgLeafNode(std::shared_ptr<const Manifold::Impl> pImpl_,
-                         glm::mat4x3 transform_)
+                         mat4x3 transform_)
     : pImpl_(pImpl_), transform_(transform_) {}
 
 std::shared_ptr<const Manifold::Impl> CsgLeafNode::GetImpl() const {
-  if (transform_ == glm::mat4x3(1.0f)) return pImpl_;
+  if (pImpl_->IsCompact()) return Expanded()->GetImpl();
+  if (transform_ == mat4x3(1.0f)) return pImpl_;
+  if (CsgCache::Get().Enabled()) {
+    std::lock_guard<std::mutex> lock(leafHashMutex);
+    if (!hashed_) HashContent();
+  }
   pImpl_ =
       std::make_shared<const Manifold::Impl>(pImpl_->Transform(transform_));
-  transform_ = glm::mat4x3(1.0f);
+  if (hashed_) hashTransform_ = transform_ * mat4(hashTransform_);
+  transform_ = mat4x3(1.0f);
   return pImpl_;
 }
 
-glm::mat4x3 CsgLeafNode::GetTransform() const { return transform_; }
+/**
+ * The Impl as it is stored, possibly compact and without applying the pending
+ * transform, for the queries that neither changes.
+ */
+std::shared_ptr<const Manifold::Impl> CsgLeafNode::GetStoredImpl() const {
+  return pImpl_;
+}
+
+mat4x3 CsgLeafNode::GetTransform() const { return transform_; }
+
+int CsgLeafNode::NumVert() const { return pImpl_->NumVert(); }
+
+bool CsgLeafNode::IsCompact() const { return pImpl_->IsCompact(); }
+
+/**
+ * A copy of this leaf with its Impl expanded, if it was compacted. This node
+ * is left as it is, so that it stays cold; see Manifold::Compact().
+ */
+std::shared_ptr<CsgLeafNode> CsgLeafNode::Expanded() const {
+  auto leaf = std::make_shared<CsgLeafNode>(*this);
+  if (pImpl_->IsCompact())
+    leaf->pImpl_ = std::make_shared<const Manifold::Impl>(pImpl_->Expand());
+  return leaf;
+}
+
+/**
+ * The memory of this leaf's Impl as it is stored, without applying the
+ * pending transform.
+ */
+MemoryUsage CsgLeafNode::GetMemoryUsage() const {
+  return pImpl_->GetMemoryUsage();
+}
+
+/**
+ * The properties of this leaf, taken from its Impl's cache when the pending
+ * transform allows it, so that a moved copy need not be evaluated.
+ */
+Properties CsgLeafNode::GetProperties() const {
+  Properties properties;
+  if (pImpl_->CachedProperties(properties, transform_)) return properties;
+  return GetImpl()->GetProperties();
+}
+
+/**
+ * Bounding box of the transformed mesh. The pending transform is applied to
+ * the vertices on the fly, without building the transformed Impl.
+ */
+Box CsgLeafNode::GetBoundingBox() const {
+  if (transform_ == mat4x3(1.0f)) return pImpl_->bBox_;
+  if (pImpl_->IsCompact()) return Expanded()->GetBoundingBox();
+  const auto &vertPos = pImpl_->vertPos_;
+  return transform_reduce<Box>(autoPolicy(vertPos.size()), vertPos.begin(),
+                               vertPos.end(), TransformBox({transform_}),
+                               Box(), UnionBox());
+}
+
+/**
+ * Boolean of two leaves, leaving their transforms pending where possible. A
+ * Boolean commutes with any affine transform applied to both of its operands,
+ * so it is evaluated in the frame of the larger operand: only the smaller one
+ * is transformed, by the relative transform, and the larger one's transform
+ * is left pending on the result. Operands sharing a transform, such as the
+ * children of a transformed subtree, are not copied at all. Mirroring or
+ * singular frames are applied eagerly as before.
+ *
+ * This only reads the nodes, so it is safe to call concurrently on shared
+ * ones.
+ */
+std::shared_ptr<CsgLeafNode> CsgLeafNode::Boolean(const CsgLeafNode &a,
+                                                  const CsgLeafNode &b,
+                                                  Manifold::OpType op) {
+  if (a.IsCompact() || b.IsCompact())
+    return Boolean(*a.Expanded(), *b.Expanded(), op);
+  // Operands that are empty or apart need neither a common frame nor a
+  // Boolean3. Transformed boxes only grow, so apart here means apart.
+  const Box aBox = a.pImpl_->bBox_.Transform(a.transform_);
+  const Box bBox = b.pImpl_->bBox_.Transform(b.transform_);
+  if (a.pImpl_->IsEmpty() || b.pImpl_->IsEmpty() || !aBox.DoesOverlap(bBox)) {
+    switch (op) {
+      case Manifold::OpType::ADD:
+        if (a.pImpl_->IsEmpty()) return std::make_shared<CsgLeafNode>(b);
+        if (b.pImpl_->IsEmpty()) return std::make_shared<CsgLeafNode>(a);
+        return std::make_shared<CsgLeafNode>(
+            std::make_shared<const Manifold::Impl>(
+                Compose({std::make_shared<CsgLeafNode>(a),
+                         std::make_shared<CsgLeafNode>(b)})));
+      case Manifold::OpType::SUBTRACT:
+        return std::make_shared<CsgLeafNode>(a);
+      case Manifold::OpType::INTERSECT:
+        return std::make_shared<CsgLeafNode>();
+    }
+  }
+
+  const bool aIsFrame = a.pImpl_->NumVert() >= b.pImpl_->NumVert();
+  const CsgLeafNode &frame = aIsFrame ? a : b;
+  const CsgLeafNode &other = aIsFrame ? b : a;
+  mat4x3 pending = frame.transform_;
+  std::shared_ptr<const Manifold::Impl> frameImpl = frame.pImpl_;
+  std::shared_ptr<const Manifold::Impl> otherImpl = other.pImpl_;
+
+  if (!(glm::determinant(mat3(pending)) > 0)) {
+    frameImpl = std::make_shared<const Manifold::Impl>(
+        frame.pImpl_->Transform(pending));
+    otherImpl = std::make_shared<const Manifold::Impl>(
+        other.pImpl_->Transform(other.transform_));
+    pending = mat4x3(1.0f);
+  } else if (other.transform_ != pending) {
+    const mat4x3 relative(glm::inverse(mat4(pending)) * mat4(other.transform_));
+    otherImpl = std::make_shared<const Manifold::Impl>(
+        other.pImpl_->Transform(relative));
+  }
+
+  const Manifold::Impl &inP = aIsFrame ? *frameImpl : *otherImpl;
+  const Manifold::Impl &inQ = aIsFrame ? *otherImpl : *frameImpl;
+  Boolean3 boolean(inP, inQ, op);
+  return std::make_shared<CsgLeafNode>(
+      std::make_shared<const Manifold::Impl>(boolean.Result(op)), pending);
+}
 
-std::shared_ptr<CsgLeafNode> CsgLeafNode::ToLeafNode() const {
+std::shared_ptr<CsgLeafNode> CsgLeafNode::ToLeafNode(
+    EvalContext *context) const {
   return std::make_shared<CsgLeafNode>(*this);
 }
 
-std::shared_ptr<CsgNode> CsgLeafNode::Transform(const glm::mat4x3 &m) const {
-  return std::make_shared<CsgLeafNode>(pImpl_, m * glm::mat4(transform_));
+std::shared_ptr<CsgNode> CsgLeafNode::Transform(const mat4x3 &m) const {
+  auto node = std::make_shared<CsgLeafNode>(pImpl_, m * mat4(transform_));
+  // same pImpl_, so the content hash carries over
+  node->hashed_ = hashed_;
+  node->contentHash_ = contentHash_;
+  node->contentIDs_ = contentIDs_;
+  node->hashTransform_ = hashTransform_;
+  return node;
 }
 
 CsgNodeType CsgLeafNode::GetNodeType() const { return CsgNodeType::LEAF; }
 
+void CsgLeafNode::HashContent() const {
+  if (pImpl_->IsCompact()) {
+    contentHash_ = HashImpl(pImpl_->Expand(), contentIDs_);
+  } else {
+    contentHash_ = HashImpl(*pImpl_, contentIDs_);
+  }
+  hashTransform_ = mat4x3(1.0f);
+  hashed_ = true;
+}
+
+uint64_t CsgLeafNode::Hash(CacheKey &key) const {
+  std::lock_guard<std::mutex> lock(leafHashMutex);
+  if (!hashed_) HashContent();
+  const mat4x3 transform = transform_ * mat4(hashTransform_);
+  uint64_t hash = HashMatrix(contentHash_, transform);
+  key.AddTerm(contentHash_);
+  key.AddTerms(transform);
+  for (int id : contentIDs_) {
+    const int rank = key.Rank(id);
+    hash = HashCombine(hash, rank);
+    key.AddTerm(rank);
+  }
+  return hash;
+}
+
 /**
- * Efficient union of a set of pairwise disjoint meshes.
+ * Efficient union of a set of pairwise disjoint meshes. The output ranges of
+ * the nodes are laid out first, then each buffer is filled by a single pass
+ * over all of its elements, with each node's transform applied on the fly, so
+ * that many small nodes still make for large parallel passes.
  */
 Manifold::Impl CsgLeafNode::Compose(
     const std::vector<std::shared_ptr<CsgLeafNode>> &nodes) {
-  float precision = -1;
+  const auto isCompact = [](const std::shared_ptr<CsgLeafNode> &node) {
+    return node->IsCompact();
+  };
+  if (std::any_of(nodes.begin(), nodes.end(), isCompact)) {
+    std::vector<std::shared_ptr<CsgLeafNode>> expanded;
+    for (const auto &node : nodes) expanded.push_back(node->Expanded());
+    return Compose(expanded);
+  }
+  const int numNode = nodes.size();
+  TraceSpan span("Compose");
+  span.Arg("numNode", numNode);
+  Real precision = -1;
+  VecDH<ComposeNode> composeNodes(numNode);
+  VecDH<int> vertStart(numNode + 1);
+  VecDH<int> edgeStart(numNode + 1);
+  VecDH<int> triStart(numNode + 1);
+  VecDH<int> baryStart(numNode + 1);
   int numVert = 0;
   int numEdge = 0;
   int numTri = 0;
   int numBary = 0;
-  for (auto &node : nodes) {
-    float nodeOldScale = node->pImpl_->bBox_.Scale();
-    float nodeNewScale =
-        node->pImpl_->bBox_.Transform(node->transform_).Scale();
-    float nodePrecision = node->pImpl_->precision_;
-    nodePrecision *= glm::max(1.0f, nodeNewScale / nodeOldScale);
+  // the result is made of the operands, so it is credited with their Booleans
+  std::shared_ptr<BooleanStats> history;
+  for (int i = 0; i < numNode; ++i) {
+    const CsgLeafNode &node = *nodes[i];
+    const Manifold::Impl &impl = *node.pImpl_;
+    if (impl.booleanStats_ != nullptr) {
+      if (history == nullptr) history = std::make_shared<BooleanStats>();
+      *history += *impl.booleanStats_;
+    }
+    Real nodeOldScale = impl.bBox_.Scale();
+    Real nodeNewScale = impl.bBox_.Transform(node.transform_).Scale();
+    Real nodePrecision = impl.precision_;
+    nodePrecision *= glm::max(Real(1), nodeNewScale / nodeOldScale);
     nodePrecision = glm::max(nodePrecision, kTolerance * nodeNewScale);
     if (!glm::isfinite(nodePrecision)) nodePrecision = -1;
     precision = glm::max(precision, nodePrecision);
 
-    numVert += node->pImpl_->NumVert();
-    numEdge += node->pImpl_->NumEdge();
-    numTri += node->pImpl_->NumTri();
-    numBary += node->pImpl_->meshRelation_.barycentric.size();
+    const bool identity = node.transform_ == mat4x3(1.0f);
+    composeNodes[i] = {impl.vertPos_.cptrD(),
+                       impl.faceNormal_.cptrD(),
+                       impl.halfedgeTangent_.cptrD(),
+                       impl.meshRelation_.barycentric.cptrD(),
+                       impl.meshRelation_.triBary.cptrD(),
+                       impl.halfedge_.cptrD(),
+                       node.transform_,
+                       identity ? mat3(1.0f)
+                                : glm::inverse(glm::transpose(
+                                      mat3(node.transform_))),
+                       identity,
+                       numVert,
+                       2 * numEdge,
+                       numTri,
+                       numBary};
+    vertStart[i] = numVert;
+    edgeStart[i] = 2 * numEdge;
+    triStart[i] = numTri;
+    baryStart[i] = numBary;
+    numVert += impl.NumVert();
+    numEdge += impl.NumEdge();
+    numTri += impl.NumTri();
+    numBary += impl.meshRelation_.barycentric.size();
   }
+  vertStart[numNode] = numVert;
+  edgeStart[numNode] = 2 * numEdge;
+  triStart[numNode] = numTri;
+  baryStart[numNode] = numBary;
 
   Manifold::Impl combined;
   combined.precision_ = precision;
+  combined.booleanStats_ = history;
   combined.vertPos_.resize(numVert);
   combined.halfedge_.resize(2 * numEdge);
   combined.faceNormal_.resize(numTri);
   combined.halfedgeTangent_.resize(2 * numEdge);
   combined.meshRelation_.barycentric.resize(numBary);
   combined.meshRelation_.triBary.resize(numTri);
-  auto policy = autoPolicy(numTri);
-
-  int nextVert = 0;
-  int nextEdge = 0;
-  int nextTri = 0;
-  int nextBary = 0;
-  for (auto &node : nodes) {
-    if (node->transform_ == glm::mat4x3(1.0f)) {
-      copy(policy, node->pImpl_->vertPos_.begin(), node->pImpl_->vertPos_.end(),
-           combined.vertPos_.begin() + nextVert);
-      copy(policy, node->pImpl_->faceNormal_.begin(),
-           node->pImpl_->faceNormal_.end(),
-           combined.faceNormal_.begin() + nextTri);
-    } else {
-      // no need to apply the transform to the node, just copy the vertices and
-      // face normals and apply transform on the fly
-      auto vertPosBegin = thrust::make_transform_iterator(
-          node->pImpl_->vertPos_.begin(), Transform4x3({node->transform_}));
-      glm::mat3 normalTransform =
-          glm::inverse(glm::transpose(glm::mat3(node->transform_)));
-      auto faceNormalBegin =
-          thrust::make_transform_iterator(node->pImpl_->faceNormal_.begin(),
-                                          TransformNormals({normalTransform}));
-      copy_n(policy, vertPosBegin, node->pImpl_->vertPos_.size(),
-             combined.vertPos_.begin() + nextVert);
-      copy_n(policy, faceNormalBegin, node->pImpl_->faceNormal_.size(),
-             combined.faceNormal_.begin() + nextTri);
-    }
-    copy(policy, node->pImpl_->halfedgeTangent_.begin(),
-         node->pImpl_->halfedgeTangent_.end(),
-         combined.halfedgeTangent_.begin() + nextEdge);
-    copy(policy, node->pImpl_->meshRelation_.barycentric.begin(),
-         node->pImpl_->meshRelation_.barycentric.end(),
-         combined.meshRelation_.barycentric.begin() + nextBary);
-    transform(policy, node->pImpl_->meshRelation_.triBary.begin(),
-              node->pImpl_->meshRelation_.triBary.end(),
-              combined.meshRelation_.triBary.begin() + nextTri,
-              UpdateTriBary({nextBary}));
-    transform(policy, node->pImpl_->halfedge_.begin(),
-              node->pImpl_->halfedge_.end(),
-              combined.halfedge_.begin() + nextEdge,
-              UpdateHalfedge({nextVert, nextEdge, nextTri}));
-
-    // Since the nodes may be copies containing the same meshIDs, it is
-    // important to increment them separately so that each node instance gets
-    // unique meshIDs.
-    combined.IncrementMeshIDs(nextTri, node->pImpl_->NumTri());
-
-    nextVert += node->pImpl_->NumVert();
-    nextEdge += 2 * node->pImpl_->NumEdge();
-    nextTri += node->pImpl_->NumTri();
-    nextBary += node->pImpl_->meshRelation_.barycentric.size();
-  }
+  VecDH<uint64_t> meshKey(numTri);
+
+  for_each_n(autoPolicy(numVert), countAt(0), numVert,
+             ComposeVerts({combined.vertPos_.ptrD(), composeNodes.cptrD(),
+                           vertStart.cptrD(), numNode}));
+  for_each_n(autoPolicy(2 * numEdge), countAt(0), 2 * numEdge,
+             ComposeHalfedges({combined.halfedge_.ptrD(),
+                               combined.halfedgeTangent_.ptrD(),
+                               composeNodes.cptrD(), edgeStart.cptrD(),
+                               numNode}));
+  for_each_n(autoPolicy(numTri), countAt(0), numTri,
+             ComposeTris({combined.faceNormal_.ptrD(),
+                          combined.meshRelation_.triBary.ptrD(),
+                          meshKey.ptrD(), composeNodes.cptrD(),
+                          triStart.cptrD(), numNode}));
+  for_each_n(autoPolicy(numBary), countAt(0), numBary,
+             ComposeBarycentric({combined.meshRelation_.barycentric.ptrD(),
+                                 composeNodes.cptrD(), baryStart.cptrD(),
+                                 numNode}));
+
+  // Number the distinct (node, meshID) pairs in order, which is the order in
+  // which IncrementMeshIDs() would give them out node by node.
+  auto policy = autoPolicy(numTri, KernelCost::Sort);
+  VecDH<uint64_t> meshKeys(meshKey);
+  sort(policy, meshKeys.begin(), meshKeys.end());
+  auto end = unique<decltype(meshKeys.begin())>(policy, meshKeys.begin(),
+                                                meshKeys.end());
+  const int numMeshID = end - meshKeys.begin();
+  VecDH<int> meshIndex(numTri);
+  lower_bound(policy, meshKeys.cbegin(), meshKeys.cbegin() + numMeshID,
+              meshKey.cbegin(), meshKey.cend(), meshIndex.begin());
+  const int meshIDstart = Manifold::Impl::meshIDCounter_.fetch_add(
+      numMeshID, std::memory_order_relaxed);
+  for_each_n(autoPolicy(numTri), countAt(0), numTri,
+             UpdateComposedMeshID({combined.meshRelation_.triBary.ptrD(),
+                                   meshIndex.cptrD(), meshIDstart}));
+
   // required to remove parts that are smaller than the precision
   combined.SimplifyTopology();
   combined.Finish();
+
+  // The properties are additive over disjoint parts, so if those of every
+  // node are known already, so are those of the result.
+  Properties total = {0, 0};
+  bool cached = true;
+  for (int i = 0; i < numNode && cached; ++i) {
+    Properties properties;
+    cached =
+        nodes[i]->pImpl_->CachedProperties(properties, nodes[i]->transform_);
+    total.surfaceArea += properties.surfaceArea;
+    total.volume += properties.volume;
+  }
+  if (cached) combined.properties_.Set(total);
+  span.Arg("numVert", combined.NumVert());
+  span.Arg("numTri", combined.NumTri());
   return combined;
 }
 
@@ -243,18 +661,50 @@ CsgOpNode::CsgOpNode(std::vector<std::shared_ptr<CsgNode>> &&children,
   GetChildren(false);
 }
 
-std::shared_ptr<CsgNode> CsgOpNode::Transform(const glm::mat4x3 &m) const {
+std::shared_ptr<CsgNode> CsgOpNode::Transform(const mat4x3 &m) const {
   auto node = std::make_shared<CsgOpNode>();
   node->impl_ = impl_;
-  node->transform_ = m * glm::mat4(transform_);
+  node->transform_ = m * mat4(transform_);
   return node;
 }
 
-std::shared_ptr<CsgLeafNode> CsgOpNode::ToLeafNode() const {
+std::shared_ptr<CsgLeafNode> CsgOpNode::ToLeafNode(
+    EvalContext *context) const {
   if (cache_ != nullptr) return cache_;
   if (impl_->children_.empty()) return nullptr;
+  if (context != nullptr) context->Check();
+  TraceSpan span("CsgOpNode");
+  span.Arg("op", OpName(impl_->op_));
+  span.Arg("numChild", impl_->children_.size());
+  // Look up the global result cache; the key excludes transform_, as the
+  // result is stored in impl_ which is shared by transformed copies.
+  CsgCache &resultCache = CsgCache::Get();
+  const bool useCache =
+      resultCache.Enabled() &&
+      (impl_->children_.size() > 1 ||
+       impl_->children_.front()->GetNodeType() != CsgNodeType::LEAF);
+  CacheKey key;
+  std::vector<uint64_t> members;
+  if (useCache) {
+    key.hash = ImplHash(key);
+    for (const auto &child : impl_->children_) {
+      CacheKey operandKey;
+      members.push_back(child->Hash(operandKey));
+    }
+    auto result = resultCache.Find(key);
+    if (result != nullptr) {
+      span.Arg("cached", 1);
+      impl_->children_ = {std::make_shared<CsgLeafNode>(result)};
+      impl_->simplified_ = true;
+      impl_->flattened_ = true;
+      cache_ = std::dynamic_pointer_cast<CsgLeafNode>(
+          impl_->children_.front()->Transform(transform_));
+      return cache_;
+    }
+  }
   // turn the children into leaf nodes
-  GetChildren();
+  GetChildren(true, context);
+  if (context != nullptr) context->Check();
   auto &children_ = impl_->children_;
   if (children_.size() > 1) {
     switch (impl_->op_) {
@@ -262,29 +712,39 @@ std::shared_ptr<CsgLeafNode> CsgOpNode::ToLeafNode() const {
         BatchUnion();
         break;
       case CsgNodeType::INTERSECTION: {
-        std::vector<std::shared_ptr<const Manifold::Impl>> impls;
+        std::vector<std::shared_ptr<CsgLeafNode>> leaves;
+        // The intervals of the bounding boxes along each axis have a common
+        // overlap only if the result can be nonempty.
+        Box common(vec3(-std::numeric_limits<Real>::infinity()),
+                   vec3(std::numeric_limits<Real>::infinity()));
         for (auto &child : children_) {
-          impls.push_back(
-              std::dynamic_pointer_cast<CsgLeafNode>(child)->GetImpl());
+          leaves.push_back(std::dynamic_pointer_cast<CsgLeafNode>(child));
+          const Box box = leaves.back()->GetBoundingBox();
+          common.min = glm::max(common.min, box.min);
+          common.max = glm::min(common.max, box.max);
+        }
+        if (glm::any(glm::greaterThan(common.min, common.max))) {
+          leaves = {std::make_shared<CsgLeafNode>()};
+        } else {
+          BatchBoolean(Manifold::OpType::INTERSECT, leaves);
         }
-        BatchBoolean(Manifold::OpType::INTERSECT, impls);
         children_.clear();
-        children_.push_back(std::make_shared<CsgLeafNode>(impls.front()));
+        children_.push_back(leaves.front());
         break;
       };
       case CsgNodeType::DIFFERENCE: {
-        // take the lhs out and treat the remaining nodes as the rhs, perform
-        // union optimization for them
+        // take the lhs out and treat the remaining nodes as the rhs; those
+        // that miss the bounding box of the lhs cannot change it
         auto lhs = std::dynamic_pointer_cast<CsgLeafNode>(children_.front());
-        children_.erase(children_.begin());
-        BatchUnion();
-        auto rhs = std::dynamic_pointer_cast<CsgLeafNode>(children_.front());
+        const Box lhsBox = lhs->GetBoundingBox();
+        std::vector<std::shared_ptr<CsgLeafNode>> rhs;
+        for (int i = 1; i < children_.size(); ++i) {
+          auto leaf = std::dynamic_pointer_cast<CsgLeafNode>(children_[i]);
+          if (leaf->GetBoundingBox().DoesOverlap(lhsBox)) rhs.push_back(leaf);
+        }
         children_.clear();
-        Boolean3 boolean(*lhs->GetImpl(), *rhs->GetImpl(),
-                         Manifold::OpType::SUBTRACT);
-        children_.push_back(
-            std::make_shared<CsgLeafNode>(std::make_shared<Manifold::Impl>(
-                boolean.Result(Manifold::OpType::SUBTRACT))));
+        children_.push_back(BatchDifference(lhs, rhs));
+        break;
       };
       case CsgNodeType::LEAF:
         // unreachable
@@ -293,111 +753,309 @@ std::shared_ptr<CsgLeafNode> CsgOpNode::ToLeafNode() const {
   }
   // children_ must contain only one CsgLeafNode now, and its Transform will
   // give CsgLeafNode as well
+  if (useCache) {
+    // the result may be one of the operands, shared with other subtrees, so
+    // its pending transform is applied to a copy
+    auto leaf = std::make_shared<CsgLeafNode>(
+        *std::dynamic_pointer_cast<CsgLeafNode>(children_.front()));
+    resultCache.Insert(key, leaf->GetImpl(), std::move(members));
+    children_.front() = leaf;
+  }
   cache_ = std::dynamic_pointer_cast<CsgLeafNode>(
       children_.front()->Transform(transform_));
+  span.Arg("numVert", cache_->NumVert());
+  if (context != nullptr) context->Step();
   return cache_;
 }
 
+/**
+ * Number of distinct op nodes that ToLeafNode() has yet to evaluate in this
+ * subtree, used as the total for progress reporting.
+ */
+int CsgOpNode::NumPending() const {
+  std::unordered_set<const Impl *> impls;
+  PendingImpls(impls);
+  return impls.size();
+}
+
+/**
+ * Adds the op nodes not yet evaluated in this subtree to impls, by their
+ * shared Impl, which transformed copies of a node have in common.
+ */
+void CsgOpNode::PendingImpls(std::unordered_set<const Impl *> &impls) const {
+  if (cache_ != nullptr || !impls.insert(impl_.get()).second) return;
+  for (const auto &child : impl_->children_) {
+    if (child->GetNodeType() == CsgNodeType::LEAF) continue;
+    std::dynamic_pointer_cast<CsgOpNode>(child)->PendingImpls(impls);
+  }
+}
+
+/**
+ * Returns the indices of the children (as flattened) which are not known to
+ * the result cache, i.e. which have changed since a previous evaluation of an
+ * otherwise identical tree. Only the branches containing these, and for a
+ * union the clusters of parts they touch, will be recomputed by ToLeafNode().
+ */
+std::vector<int> CsgOpNode::ChangedChildren() const {
+  std::vector<int> changed;
+  if (cache_ != nullptr) return changed;
+  CsgCache &resultCache = CsgCache::Get();
+  const auto &children = GetChildren(false);
+  for (int i = 0; i < children.size(); ++i) {
+    CacheKey key;
+    bool cached = resultCache.Contains(children[i]->Hash(key));
+    if (!cached && children[i]->GetNodeType() != CsgNodeType::LEAF) {
+      CacheKey implKey;
+      cached = resultCache.Contains(
+          std::dynamic_pointer_cast<CsgOpNode>(children[i])->ImplHash(implKey));
+    }
+    if (!cached) changed.push_back(i);
+  }
+  return changed;
+}
+
 /**
  * Efficient boolean operation on a set of nodes utilizing commutativity of the
  * operation. Only supports union and intersection.
  */
 void CsgOpNode::BatchBoolean(
     Manifold::OpType operation,
-    std::vector<std::shared_ptr<const Manifold::Impl>> &results) {
+    std::vector<std::shared_ptr<CsgLeafNode>> &results) {
   ASSERT(operation != Manifold::OpType::SUBTRACT, logicErr,
          "BatchBoolean doesn't support Difference.");
-  auto cmpFn = [](std::shared_ptr<const Manifold::Impl> a,
-                  std::shared_ptr<const Manifold::Impl> b) {
-    // invert the order because we want a min heap
-    return a->NumVert() > b->NumVert();
+  auto cmpFn = [](const std::shared_ptr<CsgLeafNode> &a,
+                  const std::shared_ptr<CsgLeafNode> &b) {
+    return a->NumVert() < b->NumVert();
   };
 
-  // apply boolean operations starting from smaller meshes
-  // the assumption is that boolean operations on smaller meshes is faster,
-  // due to less data being copied and processed
-  std::make_heap(results.begin(), results.end(), cmpFn);
+  // Tree reduction: each round sorts the meshes by size and pairs them up
+  // smallest-first, so boolean operations on smaller meshes still happen
+  // first, as they are faster due to less data being copied and processed.
+  // The pairs within a round are independent, so they are evaluated
+  // concurrently on the parallel backend, on top of the parallelism inside
+  // each Boolean3. A lone leftover (the largest mesh) is carried over to the
+  // next round. The pairing only depends on the input, so the result is
+  // deterministic regardless of the number of threads.
   while (results.size() > 1) {
-    std::pop_heap(results.begin(), results.end(), cmpFn);
-    auto a = std::move(results.back());
-    results.pop_back();
-    std::pop_heap(results.begin(), results.end(), cmpFn);
-    auto b = std::move(results.back());
-    results.pop_back();
-    // boolean operation
-    Boolean3 boolean(*a, *b, operation);
-    results.push_back(
-        std::make_shared<const Manifold::Impl>(boolean.Result(operation)));
-    std::push_heap(results.begin(), results.end(), cmpFn);
+    std::stable_sort(results.begin(), results.end(), cmpFn);
+    const int numPair = results.size() / 2;
+    std::vector<std::shared_ptr<CsgLeafNode>> merged(numPair);
+    std::vector<std::exception_ptr> errors(numPair);
+    for_each_n(
+        numPair > 1 ? ExecutionPolicy::Par : ExecutionPolicy::Seq, countAt(0),
+        numPair,
+        BooleanPair({results.data(), merged.data(), errors.data(), operation}));
+    for (const auto &error : errors) {
+      if (error) std::rethrow_exception(error);
+    }
+    if (results.size() % 2 == 1) merged.push_back(std::move(results.back()));
+    results = std::move(merged);
   }
 }
 
+/**
+ * Subtracts all of the rhs nodes from lhs. The rhs is partitioned into sets of
+ * pairwise disjoint nodes, each of which is composed, so that one Boolean
+ * subtracts any number of them, with a single collider sweep and assembly of
+ * the output. When there are only a few such sets, they are subtracted in
+ * turn, which avoids building the union of the rhs at all; otherwise the sets
+ * are unioned first, so that lhs is only processed once.
+ */
+std::shared_ptr<CsgLeafNode> CsgOpNode::BatchDifference(
+    std::shared_ptr<CsgLeafNode> lhs,
+    const std::vector<std::shared_ptr<CsgLeafNode>> &rhs) {
+  if (rhs.empty()) return lhs;
+  std::vector<Box> boxes;
+  for (const auto &node : rhs) boxes.push_back(node->GetBoundingBox());
+
+  std::vector<std::shared_ptr<CsgLeafNode>> composed;
+  for (const std::vector<int> &set : DisjointSets(boxes)) {
+    if (set.size() == 1) {
+      composed.push_back(rhs[set[0]]);
+    } else {
+      std::vector<std::shared_ptr<CsgLeafNode>> tmp;
+      for (int i : set) tmp.push_back(rhs[i]);
+      composed.push_back(std::make_shared<CsgLeafNode>(
+          std::make_shared<const Manifold::Impl>(CsgLeafNode::Compose(tmp))));
+    }
+  }
+
+  constexpr int kMaxSubtractions = 4;
+  if (composed.size() > kMaxSubtractions) {
+    BatchBoolean(Manifold::OpType::ADD, composed);
+    composed.resize(1);
+  }
+  for (const auto &node : composed)
+    lhs = CsgLeafNode::Boolean(*lhs, *node, Manifold::OpType::SUBTRACT);
+  return lhs;
+}
+
 /**
  * Efficient union operation on a set of nodes by doing Compose as much as
- * possible.
- * Note: Due to some unknown issues with `Compose`, we are now doing
- * `BatchBoolean` instead of using `Compose` for non-intersecting manifolds.
+ * possible. The children are sorted along a Morton curve of their bounding
+ * box centers and a Collider is built over their boxes to find the
+ * potentially overlapping pairs in O(n log n). The connected components of
+ * this overlap graph are spatial clusters which are unioned independently, so
+ * intermediate meshes only ever contain nearby parts. The clusters' results
+ * are pairwise disjoint and are composed at the end.
  */
 void CsgOpNode::BatchUnion() const {
   // INVARIANT: children_ is a vector of leaf nodes
-  // this kMaxUnionSize is a heuristic to avoid the pairwise disjoint check
-  // with O(n^2) complexity to take too long.
-  // If the number of children exceeded this limit, we will operate on chunks
-  // with size kMaxUnionSize.
-  constexpr int kMaxUnionSize = 1000;
   auto &children_ = impl_->children_;
-  while (children_.size() > 1) {
-    const int start = (children_.size() > kMaxUnionSize)
-                          ? (children_.size() - kMaxUnionSize)
-                          : 0;
-    VecDH<Box> boxes;
-    boxes.reserve(children_.size() - start);
-    for (int i = start; i < children_.size(); i++) {
-      boxes.push_back(std::dynamic_pointer_cast<CsgLeafNode>(children_[i])
-                          ->GetImpl()
-                          ->bBox_);
+  const int numChild = children_.size();
+  if (numChild < 2) return;
+  TraceSpan span("BatchUnion");
+  span.Arg("numChild", numChild);
+
+  std::vector<std::shared_ptr<CsgLeafNode>> leaves(numChild);
+  VecDH<Box> boxes(numChild);
+  Box bBox;
+  for (int i = 0; i < numChild; ++i) {
+    leaves[i] = std::dynamic_pointer_cast<CsgLeafNode>(children_[i]);
+    // the leaves' transforms stay pending, so they are only read from here on
+    boxes[i] = leaves[i]->GetBoundingBox();
+    bBox = bBox.Union(boxes[i]);
+  }
+
+  auto policy = autoPolicy(numChild);
+  VecDH<uint32_t> boxMorton(numChild);
+  VecDH<int> sorted2child(numChild);
+  sequence(policy, sorted2child.begin(), sorted2child.end());
+  transform(policy, boxes.begin(), boxes.end(), boxMorton.begin(),
+            BoxMorton({bBox}));
+  sort_by_key(policy, boxMorton.begin(), boxMorton.end(),
+              zip(boxes.begin(), sorted2child.begin()));
+
+  Collider collider(boxes, boxMorton);
+  // p is the query and q the leaf; both are sorted indices, grouped by p.
+  SparseIndices overlaps = collider.Collisions(boxes);
+  const int numOverlap = overlaps.size();
+  VecDH<int> neighborStart(numChild + 1);
+  lower_bound(policy, overlaps.Get(0).begin(), overlaps.Get(0).end(),
+              countAt(0), countAt(numChild + 1), neighborStart.begin());
+
+  const int *query = overlaps.Get(0).cptrH();
+  const int *neighbor = overlaps.Get(1).cptrH();
+
+  Graph graph;
+  for (int i = 0; i < numChild; ++i) {
+    graph.add_nodes(i);
+  }
+  for (int k = 0; k < numOverlap; ++k) {
+    if (query[k] < neighbor[k]) graph.add_edge(query[k], neighbor[k]);
+  }
+  std::vector<int> components;
+  const int numCluster = ConnectedComponents(components, graph);
+  span.Arg("numCluster", numCluster);
+
+  std::vector<std::vector<int>> clusters(numCluster);
+  for (int i = 0; i < numChild; ++i) {
+    clusters[components[i]].push_back(i);
+  }
+  const int *sortedChild = sorted2child.cptrH();
+
+  // With the result cache enabled, each cluster's partial union is cached on
+  // its own, keyed by its operands in child order, so that re-evaluating an
+  // edited tree only recomputes the clusters touched by the changed operands.
+  CsgCache &resultCache = CsgCache::Get();
+  const bool useCache = resultCache.Enabled();
+  std::vector<CacheKey> clusterKey(useCache ? numCluster : 0);
+  std::vector<std::vector<uint64_t>> clusterMembers(clusterKey.size());
+  for (int c = 0; c < clusterKey.size(); ++c) {
+    if (clusters[c].size() == 1) continue;
+    std::vector<int> members;
+    for (int i : clusters[c]) members.push_back(sortedChild[i]);
+    std::sort(members.begin(), members.end());
+    CacheKey &key = clusterKey[c];
+    key.hash = HashCombine(static_cast<uint64_t>(CsgNodeType::UNION),
+                           members.size());
+    key.AddTerm(static_cast<uint64_t>(CsgNodeType::UNION));
+    key.AddTerm(members.size());
+    for (int child : members) {
+      key.hash = HashCombine(key.hash, leaves[child]->Hash(key));
+      CacheKey operandKey;
+      clusterMembers[c].push_back(leaves[child]->Hash(operandKey));
     }
-    const Box *boxesD = boxes.cptrD();
-    // partition the children into a set of disjoint sets
-    // each set contains a set of children that are pairwise disjoint
-    std::vector<VecDH<size_t>> disjointSets;
-    for (size_t i = 0; i < boxes.size(); i++) {
-      auto lambda = [boxesD, i](const VecDH<size_t> &set) {
-        return find_if<decltype(set.end())>(
-                   autoPolicy(set.size()), set.begin(), set.end(),
-                   CheckOverlap({boxesD, i})) == set.end();
-      };
-      auto it = std::find_if(disjointSets.begin(), disjointSets.end(), lambda);
-      if (it == disjointSets.end()) {
-        disjointSets.push_back(std::vector<size_t>{i});
-      } else {
-        it->push_back(i);
+  }
+
+  const int *neighborStartH = neighborStart.cptrH();
+  std::vector<int> disjointSetOf(numChild, -1);
+  std::vector<std::shared_ptr<CsgLeafNode>> results(numCluster);
+  auto unionCluster = [&](int c) {
+    const std::vector<int> &cluster = clusters[c];
+    if (cluster.size() == 1) {
+      results[c] = leaves[sortedChild[cluster[0]]];
+      return;
+    }
+    if (useCache) {
+      auto cached = resultCache.Find(clusterKey[c]);
+      if (cached != nullptr) {
+        results[c] = std::make_shared<CsgLeafNode>(cached);
+        return;
       }
     }
+    // Greedily partition the cluster, in Morton order, into sets of pairwise
+    // disjoint children. Only neighbors in the same cluster are ever read, so
+    // clusters can be processed concurrently.
+    std::vector<std::vector<int>> disjointSets;
+    for (int i : cluster) {
+      std::vector<bool> taken(disjointSets.size(), false);
+      for (int k = neighborStartH[i]; k < neighborStartH[i + 1]; ++k) {
+        const int set = disjointSetOf[neighbor[k]];
+        if (set >= 0) taken[set] = true;
+      }
+      const int set =
+          std::find(taken.begin(), taken.end(), false) - taken.begin();
+      if (set == disjointSets.size()) disjointSets.emplace_back();
+      disjointSets[set].push_back(i);
+      disjointSetOf[i] = set;
+    }
     // compose each set of disjoint children
-    std::vector<std::shared_ptr<const Manifold::Impl>> impls;
+    std::vector<std::shared_ptr<CsgLeafNode>> composed;
     for (const auto &set : disjointSets) {
       if (set.size() == 1) {
-        impls.push_back(
-            std::dynamic_pointer_cast<CsgLeafNode>(children_[start + set[0]])
-                ->GetImpl());
+        composed.push_back(leaves[sortedChild[set[0]]]);
       } else {
         std::vector<std::shared_ptr<CsgLeafNode>> tmp;
-        for (size_t j : set) {
-          tmp.push_back(
-              std::dynamic_pointer_cast<CsgLeafNode>(children_[start + j]));
+        for (int i : set) {
+          tmp.push_back(leaves[sortedChild[i]]);
         }
-        impls.push_back(
-            std::make_shared<const Manifold::Impl>(CsgLeafNode::Compose(tmp)));
+        composed.push_back(std::make_shared<CsgLeafNode>(
+            std::make_shared<const Manifold::Impl>(CsgLeafNode::Compose(tmp))));
       }
     }
-    BatchBoolean(Manifold::OpType::ADD, impls);
-    children_.erase(children_.begin() + start, children_.end());
-    children_.push_back(std::make_shared<CsgLeafNode>(impls.back()));
-    // move it to the front as we process from the back, and the newly added
-    // child should be quite complicated
-    std::swap(children_.front(), children_.back());
+    BatchBoolean(Manifold::OpType::ADD, composed);
+    results[c] = composed.front();
+    if (useCache) {
+      // the result is a new node of this cluster's own, so applying its
+      // pending transform here does not race with the other clusters
+      resultCache.Insert(clusterKey[c], results[c]->GetImpl(),
+                         std::move(clusterMembers[c]));
+    }
+  };
+  // Exceptions, e.g. memoryErr, must not escape the parallel backend.
+  std::vector<std::exception_ptr> errors(numCluster);
+  for_each_n(numCluster > 1 ? ExecutionPolicy::Par : ExecutionPolicy::Seq,
+             countAt(0), numCluster, [&](int c) {
+               try {
+                 unionCluster(c);
+               } catch (...) {
+                 errors[c] = std::current_exception();
+               }
+             });
+  for (const auto &error : errors) {
+    if (error) std::rethrow_exception(error);
   }
+
+  std::shared_ptr<CsgLeafNode> combined;
+  if (numCluster == 1) {
+    combined = results.front();
+  } else {
+    combined = std::make_shared<CsgLeafNode>(
+        std::make_shared<const Manifold::Impl>(CsgLeafNode::Compose(results)));
+  }
+  children_.clear();
+  children_.push_back(combined);
 }
 
 /**
@@ -406,38 +1064,75 @@ void CsgOpNode::BatchUnion() const {
  * (i.e. no ops). Otherwise, the list may contain ops.
  * Note that this function will not apply the transform to children, as they may
  * be shared with other nodes.
+ *
+ * The op children are independent subtrees unless they share an op node, so
+ * in that case only are they evaluated one after the other.
  */
 std::vector<std::shared_ptr<CsgNode>> &CsgOpNode::GetChildren(
-    bool finalize) const {
+    bool finalize, EvalContext *context) const {
   auto &children_ = impl_->children_;
   if (children_.empty() || (impl_->simplified_ && !finalize) ||
       impl_->flattened_)
     return children_;
-  impl_->simplified_ = true;
-  impl_->flattened_ = finalize;
   std::vector<std::shared_ptr<CsgNode>> newChildren;
+  std::vector<int> pending;
 
   CsgNodeType op = impl_->op_;
   for (auto &child : children_) {
     if (child->GetNodeType() == op && child.use_count() == 1 &&
         std::dynamic_pointer_cast<CsgOpNode>(child)->impl_.use_count() == 1) {
-      auto grandchildren =
-          std::dynamic_pointer_cast<CsgOpNode>(child)->GetChildren(finalize);
-      int start = children_.size();
+      auto grandchildren = std::dynamic_pointer_cast<CsgOpNode>(child)
+                               ->GetChildren(finalize, context);
       for (auto &grandchild : grandchildren) {
         newChildren.push_back(grandchild->Transform(child->GetTransform()));
       }
     } else {
-      if (!finalize || child->GetNodeType() == CsgNodeType::LEAF) {
-        newChildren.push_back(child);
-      } else {
-        newChildren.push_back(child->ToLeafNode());
-      }
+      if (finalize && child->GetNodeType() != CsgNodeType::LEAF)
+        pending.push_back(newChildren.size());
+      newChildren.push_back(child);
     }
     // special handling for difference: we treat it as first - (second + third +
     // ...) so op = UNION after the first node
     if (op == CsgNodeType::DIFFERENCE) op = CsgNodeType::UNION;
   }
+
+  // Compacted leaves are expanded once here, rather than by each of the
+  // batched operations that read them.
+  if (finalize) {
+    for (auto &child : newChildren) {
+      if (child->GetNodeType() != CsgNodeType::LEAF) continue;
+      auto leaf = std::static_pointer_cast<CsgLeafNode>(child);
+      if (leaf->IsCompact()) child = leaf->Expanded();
+    }
+  }
+
+  const int numPending = pending.size();
+  bool disjoint = true;
+  std::unordered_set<const Impl *> seen;
+  for (int i = 0; i < numPending && disjoint; ++i) {
+    std::unordered_set<const Impl *> impls;
+    std::dynamic_pointer_cast<CsgOpNode>(newChildren[pending[i]])
+        ->PendingImpls(impls);
+    for (const Impl *impl : impls) disjoint &= seen.insert(impl).second;
+  }
+  // Exceptions, e.g. from cancellation, must not escape the parallel backend.
+  std::vector<std::exception_ptr> errors(numPending);
+  for_each_n(numPending > 1 && disjoint ? ExecutionPolicy::Par
+                                        : ExecutionPolicy::Seq,
+             countAt(0), numPending, [&](int i) {
+               auto &child = newChildren[pending[i]];
+               try {
+                 child = child->ToLeafNode(context);
+               } catch (...) {
+                 errors[i] = std::current_exception();
+               }
+             });
+  for (const auto &error : errors) {
+    if (error) std::rethrow_exception(error);
+  }
+  // only now, so that an evaluation which threw can be retried
+  impl_->simplified_ = true;
+  impl_->flattened_ = finalize;
   children_ = newChildren;
   return children_;
 }
@@ -456,6 +1151,23 @@ void CsgOpNode::SetOp(Manifold::OpType op) {
   }
 }
 
-glm::mat4x3 CsgOpNode::GetTransform() const { return transform_; }
+mat4x3 CsgOpNode::GetTransform() const { return transform_; }
+
+uint64_t CsgOpNode::Hash(CacheKey &key) const {
+  const uint64_t hash = HashMatrix(ImplHash(key), transform_);
+  key.AddTerms(transform_);
+  return hash;
+}
+
+uint64_t CsgOpNode::ImplHash(CacheKey &key) const {
+  uint64_t hash = HashCombine(static_cast<uint64_t>(impl_->op_),
+                              impl_->children_.size());
+  key.AddTerm(static_cast<uint64_t>(impl_->op_));
+  key.AddTerm(impl_->children_.size());
+  for (const auto &child : impl_->children_) {
+    hash = HashCombine(hash, child->Hash(key));
+  }
+  return hash;
+}
 
 }  // namespace manifold
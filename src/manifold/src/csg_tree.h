@@ -13,6 +13,10 @@
 // limitations under the License.
 
 #pragma once
+#include <atomic>
+#include <mutex>
+#include <unordered_set>
+
 #include "manifold.h"
 
 namespace manifold {
@@ -20,43 +24,92 @@ namespace manifold {
 enum class CsgNodeType { UNION, INTERSECTION, DIFFERENCE, LEAF };
 
 class CsgLeafNode;
+struct CacheKey;
+
+/**
+ * State shared by one evaluation of a CSG tree, see Manifold::EvaluateAsync().
+ * Sibling subtrees are evaluated concurrently, so Step() may be called from
+ * several threads at once.
+ */
+struct EvalContext {
+  Manifold::ProgressCallback progress;
+  int total = 0;
+  std::atomic<int> done{0};
+  std::atomic<bool> cancelled{false};
+  std::mutex mutex;
+
+  void Check() const;
+  void Step();
+};
 
 class CsgNode {
  public:
-  virtual std::shared_ptr<CsgLeafNode> ToLeafNode() const = 0;
-  virtual std::shared_ptr<CsgNode> Transform(const glm::mat4x3 &m) const = 0;
+  virtual std::shared_ptr<CsgLeafNode> ToLeafNode(
+      EvalContext *context = nullptr) const = 0;
+  virtual std::shared_ptr<CsgNode> Transform(const mat4x3 &m) const = 0;
   virtual CsgNodeType GetNodeType() const = 0;
-  virtual glm::mat4x3 GetTransform() const = 0;
-
-  std::shared_ptr<CsgNode> Translate(const glm::vec3 &t) const;
-  std::shared_ptr<CsgNode> Scale(const glm::vec3 &s) const;
-  std::shared_ptr<CsgNode> Rotate(float xDegrees = 0, float yDegrees = 0,
-                                  float zDegrees = 0) const;
+  virtual mat4x3 GetTransform() const = 0;
+  // Structural hash of this subtree for the Boolean result cache.
+  virtual uint64_t Hash(CacheKey &key) const = 0;
+
+  std::shared_ptr<CsgNode> Translate(const vec3 &t) const;
+  std::shared_ptr<CsgNode> Scale(const vec3 &s) const;
+  std::shared_ptr<CsgNode> Rotate(Real xDegrees = 0, Real yDegrees = 0,
+                                  Real zDegrees = 0) const;
 };
 
 class CsgLeafNode final : public CsgNode {
  public:
   CsgLeafNode();
   CsgLeafNode(std::shared_ptr<const Manifold::Impl> pImpl_);
-  CsgLeafNode(std::shared_ptr<const Manifold::Impl> pImpl_,
-              glm::mat4x3 transform_);
+  CsgLeafNode(std::shared_ptr<const Manifold::Impl> pImpl_, mat4x3 transform_);
 
   std::shared_ptr<const Manifold::Impl> GetImpl() const;
 
-  std::shared_ptr<CsgLeafNode> ToLeafNode() const override;
+  std::shared_ptr<const Manifold::Impl> GetStoredImpl() const;
 
-  std::shared_ptr<CsgNode> Transform(const glm::mat4x3 &m) const override;
+  std::shared_ptr<CsgLeafNode> ToLeafNode(
+      EvalContext *context = nullptr) const override;
+
+  std::shared_ptr<CsgNode> Transform(const mat4x3 &m) const override;
 
   CsgNodeType GetNodeType() const override;
 
-  glm::mat4x3 GetTransform() const override;
+  mat4x3 GetTransform() const override;
+
+  int NumVert() const;
+
+  Box GetBoundingBox() const;
+
+  bool IsCompact() const;
+
+  std::shared_ptr<CsgLeafNode> Expanded() const;
+
+  MemoryUsage GetMemoryUsage() const;
+
+  Properties GetProperties() const;
+
+  uint64_t Hash(CacheKey &key) const override;
+
+  static std::shared_ptr<CsgLeafNode> Boolean(const CsgLeafNode &a,
+                                              const CsgLeafNode &b,
+                                              Manifold::OpType op);
 
   static Manifold::Impl Compose(
       const std::vector<std::shared_ptr<CsgLeafNode>> &nodes);
 
  private:
   mutable std::shared_ptr<const Manifold::Impl> pImpl_;
-  mutable glm::mat4x3 transform_ = glm::mat4x3(1.0f);
+  mutable mat4x3 transform_ = mat4x3(1.0f);
+  // Memoized content hash of the mesh this node was created from. Applying
+  // the transform accumulates it in hashTransform_, so that the structural
+  // hash of a node does not depend on whether it has been evaluated.
+  mutable bool hashed_ = false;
+  mutable uint64_t contentHash_ = 0;
+  mutable std::vector<int> contentIDs_;
+  mutable mat4x3 hashTransform_ = mat4x3(1.0f);
+
+  void HashContent() const;
 };
 
 class CsgOpNode final : public CsgNode {
@@ -69,13 +122,20 @@ class CsgOpNode final : public CsgNode {
   CsgOpNode(std::vector<std::shared_ptr<CsgNode>> &&children,
             Manifold::OpType op);
 
-  std::shared_ptr<CsgNode> Transform(const glm::mat4x3 &m) const override;
+  std::shared_ptr<CsgNode> Transform(const mat4x3 &m) const override;
+
+  std::shared_ptr<CsgLeafNode> ToLeafNode(
+      EvalContext *context = nullptr) const override;
+
+  std::vector<int> ChangedChildren() const;
 
-  std::shared_ptr<CsgLeafNode> ToLeafNode() const override;
+  int NumPending() const;
 
   CsgNodeType GetNodeType() const override { return impl_->op_; }
 
-  glm::mat4x3 GetTransform() const override;
+  mat4x3 GetTransform() const override;
+
+  uint64_t Hash(CacheKey &key) const override;
 
  private:
   struct Impl {
@@ -85,20 +145,28 @@ class CsgOpNode final : public CsgNode {
     mutable bool flattened_ = false;
   };
   std::shared_ptr<Impl> impl_ = nullptr;
-  glm::mat4x3 transform_ = glm::mat4x3(1.0f);
+  mat4x3 transform_ = mat4x3(1.0f);
   // the following fields are for lazy evaluation, so they are mutable
   mutable std::shared_ptr<CsgLeafNode> cache_ = nullptr;
 
   void SetOp(Manifold::OpType);
 
+  uint64_t ImplHash(CacheKey &key) const;
+
   static void BatchBoolean(
       Manifold::OpType operation,
-      std::vector<std::shared_ptr<const Manifold::Impl>> &results);
+      std::vector<std::shared_ptr<CsgLeafNode>> &results);
+
+  static std::shared_ptr<CsgLeafNode> BatchDifference(
+      std::shared_ptr<CsgLeafNode> lhs,
+      const std::vector<std::shared_ptr<CsgLeafNode>> &rhs);
 
   void BatchUnion() const;
 
+  void PendingImpls(std::unordered_set<const Impl *> &impls) const;
+
   std::vector<std::shared_ptr<CsgNode>> &GetChildren(
-      bool finalize = true) const;
+      bool finalize = true, EvalContext *context = nullptr) const;
 };
 
 }  // namespace manifold
@@ -12,12 +12,16 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <limits>
+
 #include "impl.h"
 #include "par.h"
 
 namespace {
 using namespace manifold;
 
+constexpr int kUnclaimed = std::numeric_limits<int>::max();
+
 __host__ __device__ glm::ivec3 TriOf(int edge) {
   glm::ivec3 triEdge;
   triEdge[0] = edge;
@@ -26,40 +30,44 @@ __host__ __device__ glm::ivec3 TriOf(int edge) {
   return triEdge;
 }
 
-__host__ __device__ bool Is01Longest(glm::vec2 v0, glm::vec2 v1, glm::vec2 v2) {
-  const glm::vec2 e[3] = {v1 - v0, v2 - v1, v0 - v2};
-  float l[3];
+__host__ __device__ bool Is01Longest(vec2 v0, vec2 v1, vec2 v2) {
+  const vec2 e[3] = {v1 - v0, v2 - v1, v0 - v2};
+  Real l[3];
   for (int i : {0, 1, 2}) l[i] = glm::dot(e[i], e[i]);
   return l[0] > l[1] && l[0] > l[2];
 }
 
+struct EdgeKey {
+  __host__ __device__ uint64_t operator()(thrust::tuple<int, int> verts) {
+    const uint64_t start = static_cast<uint32_t>(thrust::get<0>(verts));
+    return (start << 32) | static_cast<uint32_t>(thrust::get<1>(verts));
+  }
+};
+
 struct DuplicateEdge {
-  const Halfedge* sortedHalfedge;
+  const uint64_t* sortedKey;
 
   __host__ __device__ bool operator()(int edge) {
-    const Halfedge& halfedge = sortedHalfedge[edge];
-    const Halfedge& nextHalfedge = sortedHalfedge[edge + 1];
-    return halfedge.startVert == nextHalfedge.startVert &&
-           halfedge.endVert == nextHalfedge.endVert;
+    return sortedKey[edge] == sortedKey[edge + 1];
   }
 };
 
 struct ShortEdge {
-  const Halfedge* halfedge;
-  const glm::vec3* vertPos;
-  const float precision;
+  HalfedgeCPtr halfedge;
+  const vec3* vertPos;
+  const Real precision;
 
   __host__ __device__ bool operator()(int edge) {
     if (halfedge[edge].pairedHalfedge < 0) return false;
     // Flag short edges
-    const glm::vec3 delta =
+    const vec3 delta =
         vertPos[halfedge[edge].endVert] - vertPos[halfedge[edge].startVert];
     return glm::dot(delta, delta) < precision * precision;
   }
 };
 
 struct FlagEdge {
-  const Halfedge* halfedge;
+  HalfedgeCPtr halfedge;
   const BaryRef* triBary;
 
   __host__ __device__ bool operator()(int edge) {
@@ -81,19 +89,78 @@ struct FlagEdge {
   }
 };
 
+// Calls func on each vertex of the triangles around the startVert of edge.
+template <typename Func>
+void ForEachRingVert(HalfedgeCPtr halfedge, int edge, Func func) {
+  int current = edge;
+  do {
+    const int tri = current / 3;
+    for (int i : {0, 1, 2}) func(halfedge[3 * tri + i].startVert);
+    current = NextHalfedge(halfedge[current].pairedHalfedge);
+  } while (current != edge);
+}
+
+// The vertices whose data or incident triangles the collapse of this edge may
+// read or write: those of all the triangles around both of its ends.
+template <typename Func>
+void ForEachFootprintVert(HalfedgeCPtr halfedge, int edge, Func func) {
+  ForEachRingVert(halfedge, edge, func);
+  ForEachRingVert(halfedge, halfedge[edge].pairedHalfedge, func);
+}
+
+struct ClaimFootprint {
+  HalfedgeCPtr halfedge;
+  const int* pending;
+  int* vertClaim;
+
+  void operator()(int i) {
+    const int edge = pending[i];
+    if (halfedge[edge].pairedHalfedge < 0) return;
+    ForEachFootprintVert(halfedge, edge, [this, i](int vert) {
+      AtomicMin(vertClaim[vert], i);
+    });
+  }
+};
+
+struct WonFootprint {
+  HalfedgeCPtr halfedge;
+  const int* pending;
+  const int* vertClaim;
+
+  bool operator()(int i) {
+    const int edge = pending[i];
+    // already removed; collapsing it is a no-op
+    if (halfedge[edge].pairedHalfedge < 0) return true;
+    bool won = true;
+    ForEachFootprintVert(halfedge, edge, [this, i, &won](int vert) {
+      won &= vertClaim[vert] == i;
+    });
+    return won;
+  }
+};
+
+struct Scramble {
+  uint32_t operator()(int edge) {
+    uint32_t x = edge;
+    x = (x ^ (x >> 16)) * 0x45d9f3bu;
+    x = (x ^ (x >> 16)) * 0x45d9f3bu;
+    return x ^ (x >> 16);
+  }
+};
+
 struct SwappableEdge {
-  const Halfedge* halfedge;
-  const glm::vec3* vertPos;
-  const glm::vec3* triNormal;
-  const float precision;
+  HalfedgeCPtr halfedge;
+  const vec3* vertPos;
+  const vec3* triNormal;
+  const Real precision;
 
   __host__ __device__ bool operator()(int edge) {
     if (halfedge[edge].pairedHalfedge < 0) return false;
 
     int tri = halfedge[edge].face;
     glm::ivec3 triedge = TriOf(edge);
-    glm::mat3x2 projection = GetAxisAlignedProjection(triNormal[tri]);
-    glm::vec2 v[3];
+    mat3x2 projection = GetAxisAlignedProjection(triNormal[tri]);
+    vec2 v[3];
     for (int i : {0, 1, 2})
       v[i] = projection * vertPos[halfedge[triedge[i]].startVert];
     if (CCW(v[0], v[1], v[2], precision) > 0 || !Is01Longest(v[0], v[1], v[2]))
@@ -110,6 +177,131 @@ struct SwappableEdge {
            Is01Longest(v[0], v[1], v[2]);
   }
 };
+
+// The error quadric of a set of planes: its value at a point is the sum of the
+// squared distances to those planes. It is symmetric, so only the upper
+// triangle of its 4x4 matrix is stored, row by row.
+struct Quadric {
+  Real q[10];
+
+  __host__ __device__ void Add(const Quadric& other) {
+    for (int k = 0; k < 10; ++k) q[k] += other.q[k];
+  }
+
+  __host__ __device__ Real Error(vec3 p) const {
+    const vec4 x(p, 1);
+    Real error = 0;
+    int k = 0;
+    for (int i : {0, 1, 2, 3})
+      for (int j = i; j < 4; ++j)
+        error += (i == j ? 1 : 2) * q[k++] * x[i] * x[j];
+    return error;
+  }
+};
+
+struct FaceQuadric {
+  Quadric* faceQuadric;
+  HalfedgeCPtr halfedge;
+  const vec3* vertPos;
+
+  __host__ __device__ void operator()(int face) {
+    Quadric& quadric = faceQuadric[face];
+    for (int k = 0; k < 10; ++k) quadric.q[k] = 0;
+    const vec3 p0 = vertPos[halfedge[3 * face].startVert];
+    const vec3 normal =
+        glm::cross(vertPos[halfedge[3 * face + 1].startVert] - p0,
+                   vertPos[halfedge[3 * face + 2].startVert] - p0);
+    const Real length = glm::length(normal);
+    // degenerate triangles have no plane to stay close to
+    if (length == 0) return;
+    const vec4 plane(normal / length, -glm::dot(normal, p0) / length);
+    int k = 0;
+    for (int i : {0, 1, 2, 3})
+      for (int j = i; j < 4; ++j) quadric.q[k++] = plane[i] * plane[j];
+  }
+};
+
+struct FirstHalfedge {
+  int* vertHalfedge;
+  HalfedgeCPtr halfedge;
+
+  __host__ __device__ void operator()(int edge) {
+    AtomicMin(vertHalfedge[halfedge[edge].startVert], edge);
+  }
+};
+
+struct VertQuadric {
+  Quadric* vertQuadric;
+  const Quadric* faceQuadric;
+  HalfedgeCPtr halfedge;
+  const int* vertHalfedge;
+
+  __host__ __device__ void operator()(int vert) {
+    Quadric& quadric = vertQuadric[vert];
+    for (int k = 0; k < 10; ++k) quadric.q[k] = 0;
+    const int edge = vertHalfedge[vert];
+    if (edge == kUnclaimed) return;
+    int current = edge;
+    do {
+      quadric.Add(faceQuadric[current / 3]);
+      current = NextHalfedge(halfedge[current].pairedHalfedge);
+    } while (current != edge);
+  }
+};
+
+// The error of collapsing the startVert of edge onto its endVert, which keeps
+// its position, as CollapseEdge() does.
+struct CollapseError {
+  HalfedgeCPtr halfedge;
+  const vec3* vertPos;
+  const Quadric* vertQuadric;
+
+  __host__ __device__ Real operator()(int edge) {
+    const Halfedge h = halfedge[edge];
+    if (h.pairedHalfedge < 0) return std::numeric_limits<Real>::infinity();
+    const vec3 pNew = vertPos[h.endVert];
+    return vertQuadric[h.startVert].Error(pNew) +
+           vertQuadric[h.endVert].Error(pNew);
+  }
+};
+
+struct CheapEdge {
+  HalfedgeCPtr halfedge;
+  const Real* error;
+  const char* rejected;
+  const Real tolerance2;
+
+  __host__ __device__ bool operator()(int edge) {
+    const int pair = halfedge[edge].pairedHalfedge;
+    if (pair < 0 || rejected[edge] || error[edge] > tolerance2) return false;
+    // Only the cheaper of the two directions of an edge is a candidate.
+    return rejected[pair] || error[edge] < error[pair] ||
+           (error[edge] == error[pair] && edge < pair);
+  }
+};
+
+// Whether the barycentric slot of this halfedge is still used by its corner.
+struct KeptSlot {
+  HalfedgeCPtr halfedge;
+  const BaryRef* triBary;
+  const int baryStart;
+
+  __host__ __device__ bool operator()(int edge) {
+    return halfedge[edge].pairedHalfedge >= 0 &&
+           triBary[edge / 3].vertBary[edge % 3] == baryStart + edge;
+  }
+};
+
+struct MoveSlot {
+  BaryRef* triBary;
+  const int* kept;
+  const int baryStart;
+
+  __host__ __device__ void operator()(int slot) {
+    const int edge = kept[slot];
+    triBary[edge / 3].vertBary[edge % 3] = baryStart + slot;
+  }
+};
 }  // namespace
 
 namespace manifold {
@@ -132,23 +324,31 @@ namespace manifold {
  *
  * Rather than actually removing the edges, this step merely marks them for
  * removal, by setting vertPos to NaN and halfedge to {-1, -1, -1, -1}.
+ *
+ * Large sets of edge collapses run in parallel, see CollapseEdges(), while
+ * deduplication and edge swaps remain serial, as swaps recurse into their
+ * neighbors.
  */
 void Manifold::Impl::SimplifyTopology() {
   if (!halfedge_.size()) return;
 
   auto policy = autoPolicy(halfedge_.size());
 
-  VecDH<Halfedge> halfedge(halfedge_);
+  // Only the verts are needed to find duplicate edges, packed into one key.
+  VecDH<uint64_t> edgeKey(halfedge_.size());
+  transform(policy, zip(halfedge_.startVert.begin(), halfedge_.endVert.begin()),
+            zip(halfedge_.startVert.end(), halfedge_.endVert.end()),
+            edgeKey.begin(), EdgeKey());
   VecDH<int> idx(halfedge_.size());
   sequence(policy, idx.begin(), idx.end());
-  sort_by_key(policy, halfedge.begin(), halfedge.end(), idx.begin());
+  sort_by_key(policy, edgeKey.begin(), edgeKey.end(), idx.begin());
 
   VecDH<int> flaggedEdges(halfedge_.size());
 
   int numFlagged =
       copy_if<decltype(flaggedEdges.begin())>(
           policy, idx.begin(), idx.end() - 1, countAt(0), flaggedEdges.begin(),
-          DuplicateEdge({halfedge.cptrD()})) -
+          DuplicateEdge({edgeKey.cptrD()})) -
       flaggedEdges.begin();
   flaggedEdges.resize(numFlagged);
 
@@ -162,7 +362,7 @@ void Manifold::Impl::SimplifyTopology() {
       flaggedEdges.begin();
   flaggedEdges.resize(numFlagged);
 
-  for (const int edge : flaggedEdges) CollapseEdge(edge);
+  CollapseEdges(flaggedEdges);
 
   flaggedEdges.resize(halfedge_.size());
   numFlagged =
@@ -172,7 +372,7 @@ void Manifold::Impl::SimplifyTopology() {
       flaggedEdges.begin();
   flaggedEdges.resize(numFlagged);
 
-  for (const int edge : flaggedEdges) CollapseEdge(edge);
+  CollapseEdges(flaggedEdges);
 
   flaggedEdges.resize(halfedge_.size());
   numFlagged =
@@ -190,28 +390,28 @@ void Manifold::Impl::SimplifyTopology() {
 
 void Manifold::Impl::DedupeEdge(const int edge) {
   // Orbit endVert
-  const int startVert = halfedge_[edge].startVert;
-  const int endVert = halfedge_[edge].endVert;
-  int current = halfedge_[NextHalfedge(edge)].pairedHalfedge;
+  const int startVert = halfedge_.startVert[edge];
+  const int endVert = halfedge_.endVert[edge];
+  int current = halfedge_.pairedHalfedge[NextHalfedge(edge)];
   while (current != edge) {
-    const int vert = halfedge_[current].startVert;
+    const int vert = halfedge_.startVert[current];
     if (vert == startVert) {
       const int newVert = vertPos_.size();
       vertPos_.push_back(vertPos_[endVert]);
       if (vertNormal_.size() > 0) vertNormal_.push_back(vertNormal_[endVert]);
-      current = halfedge_[NextHalfedge(current)].pairedHalfedge;
-      const int opposite = halfedge_[NextHalfedge(edge)].pairedHalfedge;
+      current = halfedge_.pairedHalfedge[NextHalfedge(current)];
+      const int opposite = halfedge_.pairedHalfedge[NextHalfedge(edge)];
 
       UpdateVert(newVert, current, opposite);
 
       int newHalfedge = halfedge_.size();
       int newFace = newHalfedge / 3;
-      int oldFace = halfedge_[current].face;
-      int outsideVert = halfedge_[current].startVert;
+      int oldFace = halfedge_.face[current];
+      int outsideVert = halfedge_.startVert[current];
       halfedge_.push_back({endVert, newVert, -1, newFace});
       halfedge_.push_back({newVert, outsideVert, -1, newFace});
       halfedge_.push_back({outsideVert, endVert, -1, newFace});
-      PairUp(newHalfedge + 2, halfedge_[current].pairedHalfedge);
+      PairUp(newHalfedge + 2, halfedge_.pairedHalfedge[current]);
       PairUp(newHalfedge + 1, current);
       if (meshRelation_.triBary.size() > 0)
         meshRelation_.triBary.push_back(meshRelation_.triBary[oldFace]);
@@ -219,12 +419,12 @@ void Manifold::Impl::DedupeEdge(const int edge) {
 
       newHalfedge += 3;
       ++newFace;
-      oldFace = halfedge_[opposite].face;
-      outsideVert = halfedge_[opposite].startVert;
+      oldFace = halfedge_.face[opposite];
+      outsideVert = halfedge_.startVert[opposite];
       halfedge_.push_back({newVert, endVert, -1, newFace});
       halfedge_.push_back({endVert, outsideVert, -1, newFace});
       halfedge_.push_back({outsideVert, newVert, -1, newFace});
-      PairUp(newHalfedge + 2, halfedge_[opposite].pairedHalfedge);
+      PairUp(newHalfedge + 2, halfedge_.pairedHalfedge[opposite]);
       PairUp(newHalfedge + 1, opposite);
       PairUp(newHalfedge, newHalfedge - 3);
       if (meshRelation_.triBary.size() > 0)
@@ -234,13 +434,13 @@ void Manifold::Impl::DedupeEdge(const int edge) {
       break;
     }
 
-    current = halfedge_[NextHalfedge(current)].pairedHalfedge;
+    current = halfedge_.pairedHalfedge[NextHalfedge(current)];
   }
 }
 
 void Manifold::Impl::PairUp(int edge0, int edge1) {
-  halfedge_[edge0].pairedHalfedge = edge1;
-  halfedge_[edge1].pairedHalfedge = edge0;
+  halfedge_.pairedHalfedge[edge0] = edge1;
+  halfedge_.pairedHalfedge[edge1] = edge0;
 }
 
 // Traverses CW around startEdge.endVert from startEdge to endEdge
@@ -248,10 +448,10 @@ void Manifold::Impl::PairUp(int edge0, int edge1) {
 // to vert instead.
 void Manifold::Impl::UpdateVert(int vert, int startEdge, int endEdge) {
   while (startEdge != endEdge) {
-    halfedge_[startEdge].endVert = vert;
+    halfedge_.endVert[startEdge] = vert;
     startEdge = NextHalfedge(startEdge);
-    halfedge_[startEdge].startVert = vert;
-    startEdge = halfedge_[startEdge].pairedHalfedge;
+    halfedge_.startVert[startEdge] = vert;
+    startEdge = halfedge_.pairedHalfedge[startEdge];
   }
 }
 
@@ -260,47 +460,47 @@ void Manifold::Impl::UpdateVert(int vert, int startEdge, int endEdge) {
 // across this edge.
 void Manifold::Impl::FormLoop(int current, int end) {
   int startVert = vertPos_.size();
-  vertPos_.push_back(vertPos_[halfedge_[current].startVert]);
+  vertPos_.push_back(vertPos_[halfedge_.startVert[current]]);
   int endVert = vertPos_.size();
-  vertPos_.push_back(vertPos_[halfedge_[current].endVert]);
+  vertPos_.push_back(vertPos_[halfedge_.endVert[current]]);
 
-  int oldMatch = halfedge_[current].pairedHalfedge;
-  int newMatch = halfedge_[end].pairedHalfedge;
+  int oldMatch = halfedge_.pairedHalfedge[current];
+  int newMatch = halfedge_.pairedHalfedge[end];
 
   UpdateVert(startVert, oldMatch, newMatch);
   UpdateVert(endVert, end, current);
 
-  halfedge_[current].pairedHalfedge = newMatch;
-  halfedge_[newMatch].pairedHalfedge = current;
-  halfedge_[end].pairedHalfedge = oldMatch;
-  halfedge_[oldMatch].pairedHalfedge = end;
+  halfedge_.pairedHalfedge[current] = newMatch;
+  halfedge_.pairedHalfedge[newMatch] = current;
+  halfedge_.pairedHalfedge[end] = oldMatch;
+  halfedge_.pairedHalfedge[oldMatch] = end;
 
   RemoveIfFolded(end);
 }
 
 void Manifold::Impl::CollapseTri(const glm::ivec3& triEdge) {
-  int pair1 = halfedge_[triEdge[1]].pairedHalfedge;
-  int pair2 = halfedge_[triEdge[2]].pairedHalfedge;
-  halfedge_[pair1].pairedHalfedge = pair2;
-  halfedge_[pair2].pairedHalfedge = pair1;
+  int pair1 = halfedge_.pairedHalfedge[triEdge[1]];
+  int pair2 = halfedge_.pairedHalfedge[triEdge[2]];
+  halfedge_.pairedHalfedge[pair1] = pair2;
+  halfedge_.pairedHalfedge[pair2] = pair1;
   for (int i : {0, 1, 2}) {
-    halfedge_[triEdge[i]] = {-1, -1, -1, -1};
+    halfedge_.Set(triEdge[i], {-1, -1, -1, -1});
   }
 }
 
 void Manifold::Impl::RemoveIfFolded(int edge) {
   const glm::ivec3 tri0edge = TriOf(edge);
-  const glm::ivec3 tri1edge = TriOf(halfedge_[edge].pairedHalfedge);
-  if (halfedge_[tri0edge[1]].endVert == halfedge_[tri1edge[1]].endVert) {
+  const glm::ivec3 tri1edge = TriOf(halfedge_.pairedHalfedge[edge]);
+  if (halfedge_.endVert[tri0edge[1]] == halfedge_.endVert[tri1edge[1]]) {
     for (int i : {0, 1, 2}) {
-      vertPos_[halfedge_[tri0edge[i]].startVert] = glm::vec3(NAN);
-      halfedge_[tri0edge[i]] = {-1, -1, -1, -1};
-      halfedge_[tri1edge[i]] = {-1, -1, -1, -1};
+      vertPos_[halfedge_.startVert[tri0edge[i]]] = vec3(NAN);
+      halfedge_.Set(tri0edge[i], {-1, -1, -1, -1});
+      halfedge_.Set(tri1edge[i], {-1, -1, -1, -1});
     }
   }
 }
 
-void Manifold::Impl::CollapseEdge(const int edge) {
+void Manifold::Impl::CollapseEdge(const int edge, const bool force) {
   VecDH<BaryRef>& triBary = meshRelation_.triBary;
 
   const Halfedge toRemove = halfedge_[edge];
@@ -310,30 +510,30 @@ void Manifold::Impl::CollapseEdge(const int edge) {
   const glm::ivec3 tri0edge = TriOf(edge);
   const glm::ivec3 tri1edge = TriOf(toRemove.pairedHalfedge);
 
-  const glm::vec3 pNew = vertPos_[endVert];
-  const glm::vec3 pOld = vertPos_[toRemove.startVert];
-  const glm::vec3 delta = pNew - pOld;
+  const vec3 pNew = vertPos_[endVert];
+  const vec3 pOld = vertPos_[toRemove.startVert];
+  const vec3 delta = pNew - pOld;
   const bool shortEdge = glm::dot(delta, delta) < precision_ * precision_;
 
   std::vector<int> edges;
   // Orbit endVert
-  int current = halfedge_[tri0edge[1]].pairedHalfedge;
+  int current = halfedge_.pairedHalfedge[tri0edge[1]];
   while (current != tri1edge[2]) {
     current = NextHalfedge(current);
     edges.push_back(current);
-    current = halfedge_[current].pairedHalfedge;
+    current = halfedge_.pairedHalfedge[current];
   }
 
   // Orbit startVert
-  int start = halfedge_[tri1edge[1]].pairedHalfedge;
+  int start = halfedge_.pairedHalfedge[tri1edge[1]];
   const BaryRef ref0 = triBary[edge / 3];
   const BaryRef ref1 = triBary[toRemove.pairedHalfedge / 3];
-  if (!shortEdge) {
+  if (!shortEdge && !force) {
     current = start;
-    glm::vec3 pLast = vertPos_[halfedge_[tri1edge[1]].endVert];
+    vec3 pLast = vertPos_[halfedge_.endVert[tri1edge[1]]];
     while (current != tri0edge[2]) {
       current = NextHalfedge(current);
-      glm::vec3 pNext = vertPos_[halfedge_[current].endVert];
+      vec3 pNext = vertPos_[halfedge_.endVert[current]];
       const int tri = current / 3;
       const BaryRef ref = triBary[tri];
       // Don't collapse if the edge is not redundant (this may have changed due
@@ -343,18 +543,18 @@ void Manifold::Impl::CollapseEdge(const int edge) {
         return;
 
       // Don't collapse edge if it would cause a triangle to invert.
-      const glm::mat3x2 projection = GetAxisAlignedProjection(faceNormal_[tri]);
+      const mat3x2 projection = GetAxisAlignedProjection(faceNormal_[tri]);
       if (CCW(projection * pNext, projection * pLast, projection * pNew,
               precision_) < 0)
         return;
 
       pLast = pNext;
-      current = halfedge_[current].pairedHalfedge;
+      current = halfedge_.pairedHalfedge[current];
     }
   }
 
   // Remove toRemove.startVert and replace with endVert.
-  vertPos_[toRemove.startVert] = glm::vec3(NAN);
+  vertPos_[toRemove.startVert] = vec3(NAN);
   CollapseTri(tri1edge);
 
   // Orbit startVert
@@ -362,7 +562,7 @@ void Manifold::Impl::CollapseEdge(const int edge) {
   while (current != tri0edge[2]) {
     current = NextHalfedge(current);
 
-    if (!shortEdge) {
+    if (!shortEdge && !force) {
       // Update the shifted triangles to the vertBary of endVert
       const int tri = current / 3;
       const int vIdx = current - 3 * tri;
@@ -372,10 +572,10 @@ void Manifold::Impl::CollapseEdge(const int edge) {
               : ref1.vertBary[toRemove.pairedHalfedge % 3];
     }
 
-    const int vert = halfedge_[current].endVert;
-    const int next = halfedge_[current].pairedHalfedge;
+    const int vert = halfedge_.endVert[current];
+    const int next = halfedge_.pairedHalfedge[current];
     for (int i = 0; i < edges.size(); ++i) {
-      if (vert == halfedge_[edges[i]].endVert) {
+      if (vert == halfedge_.endVert[edges[i]]) {
         FormLoop(edges[i], current);
         start = next;
         edges.resize(i);
@@ -390,11 +590,333 @@ void Manifold::Impl::CollapseEdge(const int edge) {
   RemoveIfFolded(start);
 }
 
+/**
+ * Collapses the given edges, as CollapseEdge() does one at a time. Large sets
+ * are processed in parallel rounds of deterministic reservations: each pending
+ * edge, in a fixed pseudo-random priority order, claims the vertices of its
+ * footprint (the triangles around both of its ends), and those that won all of
+ * their claims form an independent set whose collapses touch disjoint parts of
+ * the mesh, so they run concurrently. The others retry in the next round. The
+ * result depends only on the input, not on the number of threads.
+ *
+ * Collapses that need FormLoop() add vertices, so those are deferred to a
+ * final serial pass.
+ */
+void Manifold::Impl::CollapseEdges(const VecDH<int>& edges) {
+  if (autoPolicy(edges.size(), KernelCost::Heavy) == Seq) {
+    for (const int edge : edges) CollapseEdge(edge);
+    return;
+  }
+  // CollapseEdge is host code.
+  const ExecutionPolicy policy = Par;
+  // Accessing elements concurrently is only safe once they are on the host and
+  // no longer shared with other copies, as the collapses write through them.
+  halfedge_.ptrH();
+  const HalfedgeCPtr halfedge = halfedge_.cptrH();
+  vertPos_.ptrH();
+  faceNormal_.ptrH();
+  halfedgeTangent_.ptrH();
+  meshRelation_.triBary.ptrH();
+  meshRelation_.barycentric.ptrH();
+
+  VecDH<int> pending(edges);
+  VecDH<uint32_t> priority(pending.size());
+  transform(policy, pending.begin(), pending.end(), priority.begin(),
+            Scramble());
+  stable_sort_by_key(policy, priority.begin(), priority.end(),
+                     pending.begin());
+
+  VecDH<int> vertClaim(NumVert());
+  VecDH<char> won;
+  VecDH<char> deferred;
+  std::vector<int> serial;
+  while (pending.size() > 0) {
+    const int numPending = pending.size();
+    fill(policy, vertClaim.begin(), vertClaim.end(), kUnclaimed);
+    for_each_n(policy, countAt(0), numPending,
+               ClaimFootprint({halfedge, pending.cptrH(), vertClaim.ptrH()}));
+    won.resize(numPending);
+    transform(policy, countAt(0), countAt(numPending), won.begin(),
+              WonFootprint({halfedge, pending.cptrH(), vertClaim.cptrH()}));
+
+    deferred.resize(numPending);
+    fill(policy, deferred.begin(), deferred.end(), 0);
+    const int* pendingH = pending.cptrH();
+    const char* wonH = won.cptrH();
+    char* deferredH = deferred.ptrH();
+    for_each_n(policy, countAt(0), numPending, [&](int i) {
+      if (!wonH[i]) return;
+      if (CollapseFormsLoop(pendingH[i]))
+        deferredH[i] = 1;
+      else
+        CollapseEdge(pendingH[i]);
+    });
+
+    for (int i = 0; i < numPending; ++i)
+      if (deferredH[i]) serial.push_back(pendingH[i]);
+    const int numLeft =
+        remove_if<decltype(pending.begin())>(policy, pending.begin(),
+                                             pending.end(), won.begin(),
+                                             thrust::identity<char>()) -
+        pending.begin();
+    pending.resize(numLeft);
+  }
+
+  for (const int edge : serial) CollapseEdge(edge);
+}
+
+/**
+ * Whether collapsing this edge would take the FormLoop() path, i.e. a vertex
+ * around its startVert is also connected to its endVert. This follows the
+ * orbits of CollapseEdge() without modifying anything.
+ */
+bool Manifold::Impl::CollapseFormsLoop(const int edge) const {
+  const Halfedge toRemove = halfedge_[edge];
+  if (toRemove.pairedHalfedge < 0) return false;
+  const glm::ivec3 tri0edge = TriOf(edge);
+  const glm::ivec3 tri1edge = TriOf(toRemove.pairedHalfedge);
+
+  std::vector<int> endVerts;
+  // Orbit endVert
+  int current = halfedge_.pairedHalfedge[tri0edge[1]];
+  while (current != tri1edge[2]) {
+    current = NextHalfedge(current);
+    endVerts.push_back(halfedge_.endVert[current]);
+    current = halfedge_.pairedHalfedge[current];
+  }
+
+  // Orbit startVert
+  current = halfedge_.pairedHalfedge[tri1edge[1]];
+  while (current != tri0edge[2]) {
+    current = NextHalfedge(current);
+    const int vert = halfedge_.endVert[current];
+    for (const int endVert : endVerts)
+      if (vert == endVert) return true;
+    current = halfedge_.pairedHalfedge[current];
+  }
+  return false;
+}
+
+/**
+ * Whether collapsing this edge would flip a triangle around its startVert over
+ * or leave one thinner than precision_. Unlike the check in CollapseEdge(),
+ * the normals come from the verts, as those of moved triangles are stale.
+ */
+bool Manifold::Impl::CollapseInverts(const int edge) const {
+  const Halfedge toRemove = halfedge_[edge];
+  if (toRemove.pairedHalfedge < 0) return false;
+  const glm::ivec3 tri0edge = TriOf(edge);
+  const glm::ivec3 tri1edge = TriOf(toRemove.pairedHalfedge);
+  const vec3 pNew = vertPos_[toRemove.endVert];
+  const vec3 pOld = vertPos_[toRemove.startVert];
+
+  // Orbit startVert
+  int current = halfedge_.pairedHalfedge[tri1edge[1]];
+  while (current != tri0edge[2]) {
+    current = NextHalfedge(current);
+    const vec3 p1 = vertPos_[halfedge_.endVert[current]];
+    const vec3 p2 = vertPos_[halfedge_.endVert[NextHalfedge(current)]];
+    const vec3 normal = glm::cross(p1 - pOld, p2 - pOld);
+    const Real length = glm::length(normal);
+    if (length > 0 && glm::dot(normal, glm::cross(p1 - pNew, p2 - pNew)) <=
+                          length * precision_ * glm::length(p2 - p1))
+      return true;
+    current = halfedge_.pairedHalfedge[current];
+  }
+  return false;
+}
+
+/**
+ * Before collapsing this edge, gives the corners of the triangles around its
+ * startVert the barycentric coordinates of endVert with respect to their
+ * original triangles, found by projecting it onto their current planes. The
+ * new coordinates go in the slots from baryStart, one per halfedge, so that
+ * independent collapses can write them concurrently.
+ */
+void Manifold::Impl::ProjectCollapse(const int edge, const int baryStart) {
+  VecDH<BaryRef>& triBary = meshRelation_.triBary;
+  vec3* barycentric = meshRelation_.barycentric.ptrH();
+  const Halfedge toRemove = halfedge_[edge];
+  const glm::ivec3 tri0edge = TriOf(edge);
+  const glm::ivec3 tri1edge = TriOf(toRemove.pairedHalfedge);
+  const vec3 pNew = vertPos_[toRemove.endVert];
+
+  // Orbit startVert
+  int current = halfedge_.pairedHalfedge[tri1edge[1]];
+  while (current != tri0edge[2]) {
+    current = NextHalfedge(current);
+    const int tri = current / 3;
+    const int vIdx = current - 3 * tri;
+    mat3 triPos;
+    for (int j : {0, 1, 2})
+      triPos[j] = vertPos_[halfedge_.startVert[3 * tri + j]];
+    const vec3 normal =
+        glm::cross(triPos[1] - triPos[0], triPos[2] - triPos[0]);
+    const Real area2 = glm::dot(normal, normal);
+    // A degenerate triangle keeps its coordinates.
+    if (area2 > 0) {
+      vec3 uvw(0);
+      for (int j : {0, 1, 2}) {
+        const int j1 = (j + 1) % 3;
+        const int j2 = (j + 2) % 3;
+        const Real coord =
+            glm::dot(glm::cross(triPos[j2] - triPos[j1], pNew - triPos[j1]),
+                     normal) /
+            area2;
+        uvw += coord * UVW(triBary[tri].vertBary[j], barycentric);
+      }
+      barycentric[baryStart + current] = uvw;
+      triBary[tri].vertBary[vIdx] = baryStart + current;
+    }
+    current = halfedge_.pairedHalfedge[current];
+  }
+}
+
+/**
+ * Decimates the mesh with quadric error metrics: each vert accumulates the
+ * planes of its original triangles, and edges are collapsed as long as the sum
+ * of squared distances of the result to the planes of both ends stays within
+ * tolerance^2, so no surface moves by more than tolerance.
+ *
+ * Each collapse keeps the position of the endVert, as CollapseEdge() does,
+ * which keeps the new verts on the surface. Collapses that would change the
+ * topology or invert a triangle are rejected. Rounds of independent sets run
+ * in parallel, as in CollapseEdges(), but prioritized by error rather than
+ * pseudo-randomly. The mesh relation follows the moved corners by projection.
+ *
+ * If vertNew2Old is given, it is filled with the index each remaining vert had
+ * before simplifying, see Finish().
+ */
+void Manifold::Impl::Simplify(const Real tolerance, VecDH<int>* vertNew2Old) {
+  if (IsEmpty() || !(tolerance > 0)) {
+    if (vertNew2Old != nullptr) {
+      vertNew2Old->resize(NumVert());
+      sequence(autoPolicy(NumVert()), vertNew2Old->begin(),
+               vertNew2Old->end());
+    }
+    return;
+  }
+  halfedgeTangent_.resize(0);
+  const int numHalfedge = halfedge_.size();
+  const int numTri = NumTri();
+  const int numVert = NumVert();
+
+  VecDH<Quadric> vertQuadric(numVert);
+  {
+    auto policy = autoPolicy(numHalfedge);
+    VecDH<Quadric> faceQuadric(numTri);
+    for_each_n(policy, countAt(0), numTri,
+               FaceQuadric({faceQuadric.ptrD(), halfedge_.cptrD(),
+                            vertPos_.cptrD()}));
+    VecDH<int> vertHalfedge(numVert, kUnclaimed);
+    for_each_n(policy, countAt(0), numHalfedge,
+               FirstHalfedge({vertHalfedge.ptrD(), halfedge_.cptrD()}));
+    for_each_n(policy, countAt(0), numVert,
+               VertQuadric({vertQuadric.ptrD(), faceQuadric.cptrD(),
+                            halfedge_.cptrD(), vertHalfedge.cptrD()}));
+  }
+
+  // One slot of barycentric coordinates per halfedge, see ProjectCollapse().
+  const int baryStart = meshRelation_.barycentric.size();
+  meshRelation_.barycentric.resize(baryStart + numHalfedge);
+
+  // CollapseEdge is host code.
+  const ExecutionPolicy policy =
+      autoPolicy(numHalfedge, KernelCost::Heavy) == Seq ? Seq : Par;
+  // Accessing elements concurrently is only safe once they are on the host and
+  // no longer shared with other copies.
+  halfedge_.ptrH();
+  const HalfedgeCPtr halfedge = halfedge_.cptrH();
+  const vec3* vertPos = vertPos_.ptrH();
+  meshRelation_.triBary.ptrH();
+  meshRelation_.barycentric.ptrH();
+  Quadric* quadric = vertQuadric.ptrH();
+
+  VecDH<Real> error(numHalfedge);
+  VecDH<char> rejected(numHalfedge, 0);
+  VecDH<int> pending;
+  VecDH<Real> priority;
+  VecDH<int> vertClaim(numVert);
+  VecDH<char> won;
+  VecDH<char> collapsed;
+  while (true) {
+    transform(policy, countAt(0), countAt(numHalfedge), error.begin(),
+              CollapseError({halfedge, vertPos, quadric}));
+    pending.resize(numHalfedge);
+    const int numPending =
+        copy_if<decltype(pending.begin())>(
+            policy, countAt(0), countAt(numHalfedge), pending.begin(),
+            CheapEdge({halfedge, error.cptrH(), rejected.cptrH(),
+                       tolerance * tolerance})) -
+        pending.begin();
+    if (numPending == 0) break;
+    pending.resize(numPending);
+    priority.resize(numPending);
+    gather(policy, pending.begin(), pending.end(), error.begin(),
+           priority.begin());
+    stable_sort_by_key(policy, priority.begin(), priority.end(),
+                       pending.begin());
+
+    fill(policy, vertClaim.begin(), vertClaim.end(), kUnclaimed);
+    for_each_n(policy, countAt(0), numPending,
+               ClaimFootprint({halfedge, pending.cptrH(), vertClaim.ptrH()}));
+    won.resize(numPending);
+    transform(policy, countAt(0), countAt(numPending), won.begin(),
+              WonFootprint({halfedge, pending.cptrH(), vertClaim.cptrH()}));
+
+    collapsed.resize(numPending);
+    fill(policy, collapsed.begin(), collapsed.end(), 0);
+    const int* pendingH = pending.cptrH();
+    const char* wonH = won.cptrH();
+    char* rejectedH = rejected.ptrH();
+    char* collapsedH = collapsed.ptrH();
+    for_each_n(policy, countAt(0), numPending, [&](int i) {
+      if (!wonH[i]) return;
+      const int edge = pendingH[i];
+      if (CollapseFormsLoop(edge) || CollapseInverts(edge)) {
+        rejectedH[edge] = 1;
+        return;
+      }
+      ProjectCollapse(edge, baryStart);
+      quadric[halfedge[edge].endVert].Add(quadric[halfedge[edge].startVert]);
+      CollapseEdge(edge, true);
+      collapsedH[i] = 1;
+    });
+
+    // Rejections may no longer hold once their neighbors have changed, so they
+    // only persist through rounds that make no progress.
+    if (count_if(policy, collapsed.begin(), collapsed.end(),
+                 thrust::identity<char>()) > 0)
+      fill(policy, rejected.begin(), rejected.end(), 0);
+  }
+
+  // Compact the slots that are still in use.
+  VecDH<int> kept(numHalfedge);
+  const int numKept =
+      copy_if<decltype(kept.begin())>(
+          policy, countAt(0), countAt(numHalfedge), kept.begin(),
+          KeptSlot({halfedge, meshRelation_.triBary.cptrH(), baryStart})) -
+      kept.begin();
+  kept.resize(numKept);
+  VecDH<vec3> slots(numKept);
+  gather(policy, kept.begin(), kept.end(),
+         meshRelation_.barycentric.begin() + baryStart, slots.begin());
+  meshRelation_.barycentric.resize(baryStart + numKept);
+  copy(policy, slots.begin(), slots.end(),
+       meshRelation_.barycentric.begin() + baryStart);
+  for_each_n(policy, countAt(0), numKept,
+             MoveSlot({meshRelation_.triBary.ptrH(), kept.cptrH(), baryStart}));
+
+  // The faces have moved, so their normals are recalculated.
+  faceNormal_.resize(0);
+  Finish(vertNew2Old);
+}
+
 void Manifold::Impl::RecursiveEdgeSwap(const int edge) {
   VecDH<BaryRef>& triBary = meshRelation_.triBary;
 
   if (edge < 0) return;
-  const int pair = halfedge_[edge].pairedHalfedge;
+  const int pair = halfedge_.pairedHalfedge[edge];
   if (pair < 0) return;
 
   const glm::ivec3 tri0edge = TriOf(edge);
@@ -402,47 +924,47 @@ void Manifold::Impl::RecursiveEdgeSwap(const int edge) {
   const glm::ivec3 perm0 = TriOf(edge % 3);
   const glm::ivec3 perm1 = TriOf(pair % 3);
 
-  glm::mat3x2 projection = GetAxisAlignedProjection(faceNormal_[edge / 3]);
-  glm::vec2 v[4];
+  mat3x2 projection = GetAxisAlignedProjection(faceNormal_[edge / 3]);
+  vec2 v[4];
   for (int i : {0, 1, 2})
-    v[i] = projection * vertPos_[halfedge_[tri0edge[i]].startVert];
+    v[i] = projection * vertPos_[halfedge_.startVert[tri0edge[i]]];
   // Only operate on the long edge of a degenerate triangle.
   if (CCW(v[0], v[1], v[2], precision_) > 0 || !Is01Longest(v[0], v[1], v[2]))
     return;
 
   // Switch to neighbor's projection.
-  projection = GetAxisAlignedProjection(faceNormal_[halfedge_[pair].face]);
+  projection = GetAxisAlignedProjection(faceNormal_[halfedge_.face[pair]]);
   for (int i : {0, 1, 2})
-    v[i] = projection * vertPos_[halfedge_[tri0edge[i]].startVert];
-  v[3] = projection * vertPos_[halfedge_[tri1edge[2]].startVert];
+    v[i] = projection * vertPos_[halfedge_.startVert[tri0edge[i]]];
+  v[3] = projection * vertPos_[halfedge_.startVert[tri1edge[2]]];
 
   auto SwapEdge = [&]() {
     // The 0-verts are swapped to the opposite 2-verts.
-    const int v0 = halfedge_[tri0edge[2]].startVert;
-    const int v1 = halfedge_[tri1edge[2]].startVert;
-    halfedge_[tri0edge[0]].startVert = v1;
-    halfedge_[tri0edge[2]].endVert = v1;
-    halfedge_[tri1edge[0]].startVert = v0;
-    halfedge_[tri1edge[2]].endVert = v0;
-    PairUp(tri0edge[0], halfedge_[tri1edge[2]].pairedHalfedge);
-    PairUp(tri1edge[0], halfedge_[tri0edge[2]].pairedHalfedge);
+    const int v0 = halfedge_.startVert[tri0edge[2]];
+    const int v1 = halfedge_.startVert[tri1edge[2]];
+    halfedge_.startVert[tri0edge[0]] = v1;
+    halfedge_.endVert[tri0edge[2]] = v1;
+    halfedge_.startVert[tri1edge[0]] = v0;
+    halfedge_.endVert[tri1edge[2]] = v0;
+    PairUp(tri0edge[0], halfedge_.pairedHalfedge[tri1edge[2]]);
+    PairUp(tri1edge[0], halfedge_.pairedHalfedge[tri0edge[2]]);
     PairUp(tri0edge[2], tri1edge[2]);
     // Both triangles are now subsets of the neighboring triangle.
-    const int tri0 = halfedge_[tri0edge[0]].face;
-    const int tri1 = halfedge_[tri1edge[0]].face;
+    const int tri0 = halfedge_.face[tri0edge[0]];
+    const int tri1 = halfedge_.face[tri1edge[0]];
     faceNormal_[tri0] = faceNormal_[tri1];
     triBary[tri0] = triBary[tri1];
     triBary[tri0].vertBary[perm0[1]] = triBary[tri1].vertBary[perm1[0]];
     triBary[tri0].vertBary[perm0[0]] = triBary[tri1].vertBary[perm1[2]];
     // Calculate a new barycentric coordinate for the split triangle.
-    const glm::vec3 uvw0 = UVW(triBary[tri1].vertBary[perm1[0]],
-                               meshRelation_.barycentric.cptrH());
-    const glm::vec3 uvw1 = UVW(triBary[tri1].vertBary[perm1[1]],
-                               meshRelation_.barycentric.cptrH());
-    const float l01 = glm::length(v[1] - v[0]);
-    const float l02 = glm::length(v[2] - v[0]);
-    const float a = glm::max(0.0f, glm::min(1.0f, l02 / l01));
-    const glm::vec3 uvw2 = a * uvw0 + (1 - a) * uvw1;
+    const vec3 uvw0 = UVW(triBary[tri1].vertBary[perm1[0]],
+                          meshRelation_.barycentric.cptrH());
+    const vec3 uvw1 = UVW(triBary[tri1].vertBary[perm1[1]],
+                          meshRelation_.barycentric.cptrH());
+    const Real l01 = glm::length(v[1] - v[0]);
+    const Real l02 = glm::length(v[2] - v[0]);
+    const Real a = glm::max(Real(0), glm::min(Real(1), l02 / l01));
+    const vec3 uvw2 = a * uvw0 + (1 - a) * uvw1;
     // And assign it.
     const int newBary = meshRelation_.barycentric.size();
     meshRelation_.barycentric.push_back(uvw2);
@@ -450,16 +972,16 @@ void Manifold::Impl::RecursiveEdgeSwap(const int edge) {
     triBary[tri0].vertBary[perm0[2]] = newBary;
 
     // if the new edge already exists, duplicate the verts and split the mesh.
-    int current = halfedge_[tri1edge[0]].pairedHalfedge;
-    const int endVert = halfedge_[tri1edge[1]].endVert;
+    int current = halfedge_.pairedHalfedge[tri1edge[0]];
+    const int endVert = halfedge_.endVert[tri1edge[1]];
     while (current != tri0edge[1]) {
       current = NextHalfedge(current);
-      if (halfedge_[current].endVert == endVert) {
+      if (halfedge_.endVert[current] == endVert) {
         FormLoop(tri0edge[2], current);
         RemoveIfFolded(tri0edge[2]);
         return;
       }
-      current = halfedge_[current].pairedHalfedge;
+      current = halfedge_.pairedHalfedge[current];
     }
   };
 
@@ -468,7 +990,7 @@ void Manifold::Impl::RecursiveEdgeSwap(const int edge) {
     if (!Is01Longest(v[1], v[0], v[3])) return;
     // Two facing, long-edge degenerates can swap.
     SwapEdge();
-    const glm::vec2 e23 = v[3] - v[2];
+    const vec2 e23 = v[3] - v[2];
     if (glm::dot(e23, e23) < precision_ * precision_) {
       CollapseEdge(tri0edge[2]);
     } else {
@@ -484,7 +1006,7 @@ void Manifold::Impl::RecursiveEdgeSwap(const int edge) {
   }
   // Normal path
   SwapEdge();
-  RecursiveEdgeSwap(halfedge_[tri0edge[1]].pairedHalfedge);
-  RecursiveEdgeSwap(halfedge_[tri1edge[0]].pairedHalfedge);
+  RecursiveEdgeSwap(halfedge_.pairedHalfedge[tri0edge[1]]);
+  RecursiveEdgeSwap(halfedge_.pairedHalfedge[tri1edge[0]]);
 }
 }  // namespace manifold
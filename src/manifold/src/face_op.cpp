@@ -12,6 +12,7 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <exception>
 #include <map>
 
 #include "impl.h"
@@ -32,126 +33,171 @@ namespace manifold {
 void Manifold::Impl::Face2Tri(const VecDH<int>& faceEdge,
                               const VecDH<BaryRef>& faceRef,
                               const VecDH<int>& halfedgeBary) {
-  VecDH<glm::ivec3> triVerts;
-  VecDH<glm::vec3> triNormal;
-  VecDH<BaryRef>& triBary = meshRelation_.triBary;
-  triBary.resize(0);
-  triVerts.reserve(halfedge_.size());
-  triNormal.reserve(halfedge_.size());
-  triBary.reserve(halfedge_.size());
-
-  for (int face = 0; face < faceEdge.size() - 1; ++face) {
-    const int firstEdge = faceEdge[face];
-    const int lastEdge = faceEdge[face + 1];
-    const int numEdge = lastEdge - firstEdge;
-    ASSERT(numEdge >= 3, topologyErr, "face has less than three edges.");
-    const glm::vec3 normal = faceNormal_[face];
-
-    auto linearSearch = [](const int* mapping, int value) {
-      int i = 0;
-      while (mapping[i] != value) ++i;
-      return i;
-    };
-
-    if (numEdge == 3) {  // Single triangle
-      int mapping[3] = {halfedge_[firstEdge].startVert,
-                        halfedge_[firstEdge + 1].startVert,
-                        halfedge_[firstEdge + 2].startVert};
-      glm::ivec3 tri(halfedge_[firstEdge].startVert,
-                     halfedge_[firstEdge + 1].startVert,
-                     halfedge_[firstEdge + 2].startVert);
-      glm::ivec3 ends(halfedge_[firstEdge].endVert,
-                      halfedge_[firstEdge + 1].endVert,
-                      halfedge_[firstEdge + 2].endVert);
-      if (ends[0] == tri[2]) {
-        std::swap(tri[1], tri[2]);
-        std::swap(ends[1], ends[2]);
-      }
-      ASSERT(ends[0] == tri[1] && ends[1] == tri[2] && ends[2] == tri[0],
-             topologyErr, "These 3 edges do not form a triangle!");
-
-      triVerts.push_back(tri);
-      triNormal.push_back(normal);
-      triBary.push_back(faceRef[face]);
-      for (int k : {0, 1, 2}) {
-        int index = linearSearch(mapping, tri[k]);
-        triBary.back().vertBary[k] = halfedgeBary[firstEdge + index];
+  const int numFace = faceEdge.size() - 1;
+  // Triangulation is host code, so faces are processed by CPU threads at
+  // most. Everything read below is moved to the host first and read through
+  // const pointers, so that the concurrent element accesses neither migrate
+  // memory nor copy a shared buffer.
+  const ExecutionPolicy policy =
+      autoPolicy(numFace, KernelCost::Heavy) == Seq ? Seq : Par;
+  const int* faceEdgeH = faceEdge.cptrH();
+  const BaryRef* faceRefH = faceRef.cptrH();
+  const int* halfedgeBaryH = halfedgeBary.cptrH();
+  const int* startVert = halfedge_.startVert.cptrH();
+  const int* endVert = halfedge_.endVert.cptrH();
+  const vec3* vertPosH = vertPos_.cptrH();
+  const vec3* faceNormalH = faceNormal_.cptrH();
+  // Failed checks and triangulations must not throw out of the parallel
+  // backend, so the first error in face order is rethrown after each pass.
+  std::vector<std::exception_ptr> errors(numFace);
+  auto rethrow = [&errors]() {
+    for (const auto& error : errors) {
+      if (error) std::rethrow_exception(error);
+    }
+  };
+
+  // First pass: count the triangles of each face. General faces are
+  // triangulated right away, as their count is only known afterwards.
+  std::vector<std::vector<glm::ivec3>> generalTris(numFace);
+  VecDH<int> triStart(numFace + 1, 0);
+  int* triStartH = triStart.ptrH();
+  for_each_n(policy, countAt(0), numFace, [&](int face) {
+    try {
+      const int numEdge = faceEdgeH[face + 1] - faceEdgeH[face];
+      ASSERT(numEdge >= 3, topologyErr, "face has less than three edges.");
+      if (numEdge > 4) {
+        const mat3x2 projection = GetAxisAlignedProjection(faceNormalH[face]);
+        const Polygons polys = Face2Polygons(face, projection, faceEdge);
+        generalTris[face] = Triangulate(polys, precision_);
+        triStartH[face] = generalTris[face].size();
+      } else {
+        triStartH[face] = numEdge - 2;
       }
-    } else if (numEdge == 4) {  // Pair of triangles
-      int mapping[4] = {halfedge_[firstEdge].startVert,
-                        halfedge_[firstEdge + 1].startVert,
-                        halfedge_[firstEdge + 2].startVert,
-                        halfedge_[firstEdge + 3].startVert};
-      const glm::mat3x2 projection = GetAxisAlignedProjection(normal);
-      auto triCCW = [&projection, this](const glm::ivec3 tri) {
-        return CCW(projection * this->vertPos_[tri[0]],
-                   projection * this->vertPos_[tri[1]],
-                   projection * this->vertPos_[tri[2]], precision_) >= 0;
+    } catch (...) {
+      errors[face] = std::current_exception();
+    }
+  });
+  rethrow();
+  exclusive_scan(policy, triStart.begin(), triStart.end(), triStart.begin());
+
+  // Second pass: write the triangles of each face into its slots, in face
+  // order, exactly as a serial append would.
+  const int numTri = triStart[numFace];
+  VecDH<glm::ivec3> triVerts(numTri);
+  VecDH<vec3> triNormal(numTri);
+  VecDH<BaryRef>& triBary = meshRelation_.triBary;
+  triBary.resize(numTri);
+  glm::ivec3* triVertsH = triVerts.ptrH();
+  vec3* triNormalH = triNormal.ptrH();
+  BaryRef* triBaryH = triBary.ptrH();
+  triStartH = triStart.ptrH();
+
+  for_each_n(policy, countAt(0), numFace, [&](int face) {
+    try {
+      const int firstEdge = faceEdgeH[face];
+      const int lastEdge = faceEdgeH[face + 1];
+      const int numEdge = lastEdge - firstEdge;
+      const vec3 normal = faceNormalH[face];
+
+      int nextTri = triStartH[face];
+      auto addTri = [&](glm::ivec3 verts) -> BaryRef& {
+        triVertsH[nextTri] = verts;
+        triNormalH[nextTri] = normal;
+        triBaryH[nextTri] = faceRefH[face];
+        return triBaryH[nextTri++];
       };
 
-      glm::ivec3 tri0(halfedge_[firstEdge].startVert,
-                      halfedge_[firstEdge].endVert, -1);
-      glm::ivec3 tri1(-1, -1, tri0[0]);
-      for (const int i : {1, 2, 3}) {
-        if (halfedge_[firstEdge + i].startVert == tri0[1]) {
-          tri0[2] = halfedge_[firstEdge + i].endVert;
-          tri1[0] = tri0[2];
+      auto linearSearch = [](const int* mapping, int value) {
+        int i = 0;
+        while (mapping[i] != value) ++i;
+        return i;
+      };
+
+      if (numEdge == 3) {  // Single triangle
+        int mapping[3] = {startVert[firstEdge], startVert[firstEdge + 1],
+                          startVert[firstEdge + 2]};
+        glm::ivec3 tri(startVert[firstEdge], startVert[firstEdge + 1],
+                       startVert[firstEdge + 2]);
+        glm::ivec3 ends(endVert[firstEdge], endVert[firstEdge + 1],
+                        endVert[firstEdge + 2]);
+        if (ends[0] == tri[2]) {
+          std::swap(tri[1], tri[2]);
+          std::swap(ends[1], ends[2]);
         }
-        if (halfedge_[firstEdge + i].endVert == tri0[0]) {
-          tri1[1] = halfedge_[firstEdge + i].startVert;
+        ASSERT(ends[0] == tri[1] && ends[1] == tri[2] && ends[2] == tri[0],
+               topologyErr, "These 3 edges do not form a triangle!");
+
+        BaryRef& bary = addTri(tri);
+        for (int k : {0, 1, 2}) {
+          int index = linearSearch(mapping, tri[k]);
+          bary.vertBary[k] = halfedgeBaryH[firstEdge + index];
         }
-      }
-      ASSERT(glm::all(glm::greaterThanEqual(tri0, glm::ivec3(0))) &&
-                 glm::all(glm::greaterThanEqual(tri1, glm::ivec3(0))),
-             topologyErr, "non-manifold quad!");
-      bool firstValid = triCCW(tri0) && triCCW(tri1);
-      tri0[2] = tri1[1];
-      tri1[2] = tri0[1];
-      bool secondValid = triCCW(tri0) && triCCW(tri1);
-
-      if (!secondValid) {
-        tri0[2] = tri1[0];
-        tri1[2] = tri0[0];
-      } else if (firstValid) {
-        glm::vec3 firstCross = vertPos_[tri0[0]] - vertPos_[tri1[0]];
-        glm::vec3 secondCross = vertPos_[tri0[1]] - vertPos_[tri1[1]];
-        if (glm::dot(firstCross, firstCross) <
-            glm::dot(secondCross, secondCross)) {
+      } else if (numEdge == 4) {  // Pair of triangles
+        int mapping[4] = {startVert[firstEdge], startVert[firstEdge + 1],
+                          startVert[firstEdge + 2], startVert[firstEdge + 3]};
+        const mat3x2 projection = GetAxisAlignedProjection(normal);
+        auto triCCW = [&projection, vertPosH, this](const glm::ivec3 tri) {
+          return CCW(projection * vertPosH[tri[0]],
+                     projection * vertPosH[tri[1]],
+                     projection * vertPosH[tri[2]], precision_) >= 0;
+        };
+
+        glm::ivec3 tri0(startVert[firstEdge], endVert[firstEdge], -1);
+        glm::ivec3 tri1(-1, -1, tri0[0]);
+        for (const int i : {1, 2, 3}) {
+          if (startVert[firstEdge + i] == tri0[1]) {
+            tri0[2] = endVert[firstEdge + i];
+            tri1[0] = tri0[2];
+          }
+          if (endVert[firstEdge + i] == tri0[0]) {
+            tri1[1] = startVert[firstEdge + i];
+          }
+        }
+        ASSERT(glm::all(glm::greaterThanEqual(tri0, glm::ivec3(0))) &&
+                   glm::all(glm::greaterThanEqual(tri1, glm::ivec3(0))),
+               topologyErr, "non-manifold quad!");
+        bool firstValid = triCCW(tri0) && triCCW(tri1);
+        tri0[2] = tri1[1];
+        tri1[2] = tri0[1];
+        bool secondValid = triCCW(tri0) && triCCW(tri1);
+
+        if (!secondValid) {
           tri0[2] = tri1[0];
           tri1[2] = tri0[0];
+        } else if (firstValid) {
+          vec3 firstCross = vertPosH[tri0[0]] - vertPosH[tri1[0]];
+          vec3 secondCross = vertPosH[tri0[1]] - vertPosH[tri1[1]];
+          if (glm::dot(firstCross, firstCross) <
+              glm::dot(secondCross, secondCross)) {
+            tri0[2] = tri1[0];
+            tri1[2] = tri0[0];
+          }
         }
-      }
 
-      for (auto tri : {tri0, tri1}) {
-        triVerts.push_back(tri);
-        triNormal.push_back(normal);
-        triBary.push_back(faceRef[face]);
-        for (int k : {0, 1, 2}) {
-          int index = linearSearch(mapping, tri[k]);
-          triBary.back().vertBary[k] = halfedgeBary[firstEdge + index];
+        for (auto tri : {tri0, tri1}) {
+          BaryRef& bary = addTri(tri);
+          for (int k : {0, 1, 2}) {
+            int index = linearSearch(mapping, tri[k]);
+            bary.vertBary[k] = halfedgeBaryH[firstEdge + index];
+          }
         }
-      }
-    } else {  // General triangulation
-      const glm::mat3x2 projection = GetAxisAlignedProjection(normal);
-
-      std::map<int, int> vertBary;
-      for (int j = firstEdge; j < lastEdge; ++j)
-        vertBary[halfedge_[j].startVert] = halfedgeBary[j];
-
-      const Polygons polys = Face2Polygons(face, projection, faceEdge);
-
-      std::vector<glm::ivec3> newTris = Triangulate(polys, precision_);
-
-      for (auto tri : newTris) {
-        triVerts.push_back(tri);
-        triNormal.push_back(normal);
-        triBary.push_back(faceRef[face]);
-        for (int k : {0, 1, 2}) {
-          triBary.back().vertBary[k] = vertBary[tri[k]];
+      } else {  // General triangulation
+        std::map<int, int> vertBary;
+        for (int j = firstEdge; j < lastEdge; ++j)
+          vertBary[startVert[j]] = halfedgeBaryH[j];
+
+        for (auto tri : generalTris[face]) {
+          BaryRef& bary = addTri(tri);
+          for (int k : {0, 1, 2}) {
+            bary.vertBary[k] = vertBary[tri[k]];
+          }
         }
       }
+    } catch (...) {
+      errors[face] = std::current_exception();
     }
-  }
+  });
+  rethrow();
   faceNormal_ = std::move(triNormal);
   CreateHalfedges(triVerts);
 }
@@ -160,7 +206,7 @@ void Manifold::Impl::Face2Tri(const VecDH<int>& faceEdge,
  * For the input face index, return a set of 2D polygons formed by the input
  * projection of the vertices.
  */
-Polygons Manifold::Impl::Face2Polygons(int face, glm::mat3x2 projection,
+Polygons Manifold::Impl::Face2Polygons(int face, mat3x2 projection,
                                        const VecDH<int>& faceEdge) const {
   const int firstEdge = faceEdge[face];
   const int lastEdge = faceEdge[face + 1];
@@ -168,7 +214,7 @@ Polygons Manifold::Impl::Face2Polygons(int face, glm::mat3x2 projection,
   std::map<int, int> vert_edge;
   for (int edge = firstEdge; edge < lastEdge; ++edge) {
     const bool inserted =
-        vert_edge.emplace(std::make_pair(halfedge_[edge].startVert, edge))
+        vert_edge.emplace(std::make_pair(halfedge_.startVert[edge], edge))
             .second;
     ASSERT(inserted, topologyErr, "face has duplicate vertices.");
   }
@@ -183,9 +229,9 @@ Polygons Manifold::Impl::Face2Polygons(int face, glm::mat3x2 projection,
       thisEdge = startEdge;
       polys.push_back({});
     }
-    int vert = halfedge_[thisEdge].startVert;
+    int vert = halfedge_.startVert[thisEdge];
     polys.back().push_back({projection * vertPos_[vert], vert});
-    const auto result = vert_edge.find(halfedge_[thisEdge].endVert);
+    const auto result = vert_edge.find(halfedge_.endVert[thisEdge]);
     ASSERT(result != vert_edge.end(), topologyErr, "non-manifold edge");
     thisEdge = result->second;
     vert_edge.erase(result);
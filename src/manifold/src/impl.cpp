@@ -26,86 +26,48 @@
 namespace {
 using namespace manifold;
 
-__host__ __device__ void AtomicAddVec3(glm::vec3& target,
-                                       const glm::vec3& add) {
-  for (int i : {0, 1, 2}) {
-#ifdef __CUDA_ARCH__
-    atomicAdd(&target[i], add[i]);
-#else
-    std::atomic<float>& tar = reinterpret_cast<std::atomic<float>&>(target[i]);
-    float old_val = tar.load(std::memory_order_relaxed);
-    while (!tar.compare_exchange_weak(old_val, old_val + add[i],
-                                      std::memory_order_relaxed))
-      ;
-#endif
-  }
-}
-
 struct Normalize {
-  __host__ __device__ void operator()(glm::vec3& v) { v = SafeNormalize(v); }
+  __host__ __device__ void operator()(vec3& v) { v = SafeNormalize(v); }
 };
 
 struct Transform4x3 {
-  const glm::mat4x3 transform;
+  const mat4x3 transform;
 
-  __host__ __device__ glm::vec3 operator()(glm::vec3 position) {
-    return transform * glm::vec4(position, 1.0f);
+  __host__ __device__ vec3 operator()(vec3 position) {
+    return transform * vec4(position, 1.0f);
   }
 };
 
 struct TransformNormals {
-  const glm::mat3 transform;
+  const mat3 transform;
 
-  __host__ __device__ glm::vec3 operator()(glm::vec3 normal) {
+  __host__ __device__ vec3 operator()(vec3 normal) {
     normal = glm::normalize(transform * normal);
-    if (isnan(normal.x)) normal = glm::vec3(0.0f);
+    if (isnan(normal.x)) normal = vec3(0.0f);
     return normal;
   }
 };
 
 struct AssignNormals {
-  glm::vec3* vertNormal;
-  const glm::vec3* vertPos;
-  const Halfedge* halfedges;
-  const float precision;
+  vec3* vertNormal;
+  const vec3* vertPos;
+  HalfedgeCPtr halfedges;
+  const Real precision;
   const bool calculateTriNormal;
 
-  __host__ __device__ void operator()(thrust::tuple<glm::vec3&, int> in) {
-    glm::vec3& triNormal = thrust::get<0>(in);
+  __host__ __device__ void operator()(thrust::tuple<vec3&, int> in) {
+    vec3& triNormal = thrust::get<0>(in);
     const int face = thrust::get<1>(in);
 
     glm::ivec3 triVerts;
     for (int i : {0, 1, 2}) triVerts[i] = halfedges[3 * face + i].startVert;
-
-    glm::vec3 edge[3];
-    for (int i : {0, 1, 2}) {
-      const int j = (i + 1) % 3;
-      edge[i] = glm::normalize(vertPos[triVerts[j]] - vertPos[triVerts[i]]);
-    }
-
-    if (calculateTriNormal) {
-      triNormal = glm::normalize(glm::cross(edge[0], edge[1]));
-      if (isnan(triNormal.x)) triNormal = glm::vec3(0, 0, 1);
-    }
-
-    // corner angles
-    glm::vec3 phi;
-    float dot = -glm::dot(edge[2], edge[0]);
-    phi[0] = dot >= 1 ? 0 : (dot <= -1 ? glm::pi<float>() : glm::acos(dot));
-    dot = -glm::dot(edge[0], edge[1]);
-    phi[1] = dot >= 1 ? 0 : (dot <= -1 ? glm::pi<float>() : glm::acos(dot));
-    phi[2] = glm::pi<float>() - phi[0] - phi[1];
-
-    // assign weighted sum
-    for (int i : {0, 1, 2}) {
-      AtomicAddVec3(vertNormal[triVerts[i]], phi[i] * triNormal);
-    }
+    AddAngleWeightedNormal(vertNormal, vertPos, triVerts, triNormal,
+                           calculateTriNormal);
   }
 };
 
 struct Tri2Halfedges {
-  Halfedge* halfedges;
-  glm::uint64_t* edges;
+  HalfedgePtr halfedges;
 
   __host__ __device__ void operator()(
       thrust::tuple<int, const glm::ivec3&> in) {
@@ -113,27 +75,113 @@ struct Tri2Halfedges {
     const glm::ivec3& triVerts = thrust::get<1>(in);
     for (const int i : {0, 1, 2}) {
       const int j = (i + 1) % 3;
-      const int edge = 3 * tri + i;
-      halfedges[edge] = {triVerts[i], triVerts[j], -1, tri};
-      // Sort the forward halfedges in front of the backward ones by setting the
-      // highest-order bit.
-      edges[edge] = glm::uint64_t(triVerts[i] < triVerts[j] ? 1 : 0) << 63 |
-                    ((glm::uint64_t)glm::min(triVerts[i], triVerts[j])) << 32 |
-                    glm::max(triVerts[i], triVerts[j]);
+      halfedges.Set(3 * tri + i, {triVerts[i], triVerts[j], -1, tri});
     }
   }
 };
 
+__host__ __device__ int EdgeSlot(int vert0, int vert1, int mask) {
+  // splitmix64 finalizer of the unordered vertex pair
+  glm::uint64_t key = ((glm::uint64_t)glm::min(vert0, vert1)) << 32 |
+                      glm::max(vert0, vert1);
+  key = (key ^ (key >> 30)) * 0xbf58476d1ce4e5b9ull;
+  key = (key ^ (key >> 27)) * 0x94d049bb133111ebull;
+  return (key ^ (key >> 31)) & mask;
+}
+
+/**
+ * Inserts each forward halfedge (startVert < endVert) into an open-addressed
+ * table, flagging a failure if the same forward halfedge is found twice.
+ */
+struct InsertForwardHalfedge {
+  int* table;
+  int* failed;
+  const int* startVert;
+  const int* endVert;
+  const int mask;
+
+  __host__ __device__ void operator()(int edge) {
+    const int start = startVert[edge];
+    const int end = endVert[edge];
+    if (start == end) {
+      AtomicAdd(failed[0], 1);
+      return;
+    }
+    if (start > end) return;
+    int slot = EdgeSlot(start, end, mask);
+    while (!AtomicCompareExchange(table[slot], -1, edge)) {
+      const int other = AtomicLoad(table[slot]);
+      if (startVert[other] == start && endVert[other] == end) {
+        AtomicAdd(failed[0], 1);
+        return;
+      }
+      slot = (slot + 1) & mask;
+    }
+  }
+};
+
+/**
+ * Pairs each backward halfedge with its forward halfedge from the table,
+ * flagging a failure if there is none or it is already taken.
+ */
+struct PairBackwardHalfedge {
+  int* pairedHalfedge;
+  int* failed;
+  const int* table;
+  const int* startVert;
+  const int* endVert;
+  const int mask;
+
+  __host__ __device__ void operator()(int edge) {
+    const int start = startVert[edge];
+    const int end = endVert[edge];
+    if (start <= end) return;
+    int slot = EdgeSlot(start, end, mask);
+    int forward = table[slot];
+    while (forward >= 0 &&
+           (startVert[forward] != end || endVert[forward] != start)) {
+      slot = (slot + 1) & mask;
+      forward = table[slot];
+    }
+    if (forward < 0 ||
+        !AtomicCompareExchange(pairedHalfedge[forward], -1, edge)) {
+      AtomicAdd(failed[0], 1);
+      return;
+    }
+    pairedHalfedge[edge] = forward;
+  }
+};
+
+struct IsPaired {
+  __host__ __device__ bool operator()(int pairedHalfedge) {
+    return pairedHalfedge >= 0;
+  }
+};
+
+struct EdgeSortKey {
+  const int* startVert;
+  const int* endVert;
+
+  __host__ __device__ glm::uint64_t operator()(int edge) {
+    const int start = startVert[edge];
+    const int end = endVert[edge];
+    // Sort the forward halfedges in front of the backward ones by setting the
+    // highest-order bit.
+    return glm::uint64_t(start < end ? 1 : 0) << 63 |
+           ((glm::uint64_t)glm::min(start, end)) << 32 | glm::max(start, end);
+  }
+};
+
 struct LinkHalfedges {
-  Halfedge* halfedges;
+  int* pairedHalfedge;
   const int* ids;
   const int numEdge;
 
   __host__ __device__ void operator()(int i) {
     const int pair0 = ids[i];
     const int pair1 = ids[i + numEdge];
-    halfedges[pair0].pairedHalfedge = pair1;
-    halfedges[pair1].pairedHalfedge = pair0;
+    pairedHalfedge[pair0] = pair1;
+    pairedHalfedge[pair1] = pair0;
   }
 };
 
@@ -159,7 +207,7 @@ struct ReindexTriVerts {
 
 struct InitializeBaryRef {
   const int meshID;
-  const Halfedge* halfedge;
+  HalfedgeCPtr halfedge;
 
   __host__ __device__ void operator()(thrust::tuple<BaryRef&, int> inOut) {
     BaryRef& baryRef = thrust::get<0>(inOut);
@@ -200,14 +248,14 @@ struct CheckProperties {
 };
 
 struct CoplanarEdge {
-  float* triArea;
-  const Halfedge* halfedge;
-  const glm::vec3* vertPos;
+  Real* triArea;
+  HalfedgeCPtr halfedge;
+  const vec3* vertPos;
   const glm::ivec3* triProp;
-  const float* prop;
-  const float* propTol;
+  const Real* prop;
+  const Real* propTol;
   const int numProp;
-  const float precision;
+  const Real precision;
 
   __host__ __device__ void operator()(
       thrust::tuple<thrust::pair<int, int>&, int> inOut) {
@@ -217,29 +265,29 @@ struct CoplanarEdge {
     const Halfedge edge = halfedge[edgeIdx];
     if (!edge.IsForward()) return;
     const Halfedge pair = halfedge[edge.pairedHalfedge];
-    const glm::vec3 base = vertPos[edge.startVert];
+    const vec3 base = vertPos[edge.startVert];
 
     const int baseNum = edgeIdx - 3 * edge.face;
     const int jointNum = edge.pairedHalfedge - 3 * pair.face;
     const int edgeNum = baseNum == 0 ? 2 : baseNum - 1;
     const int pairNum = jointNum == 0 ? 2 : jointNum - 1;
 
-    const glm::vec3 jointVec = vertPos[pair.startVert] - base;
-    const glm::vec3 edgeVec =
+    const vec3 jointVec = vertPos[pair.startVert] - base;
+    const vec3 edgeVec =
         vertPos[halfedge[3 * edge.face + edgeNum].startVert] - base;
-    const glm::vec3 pairVec =
+    const vec3 pairVec =
         vertPos[halfedge[3 * pair.face + pairNum].startVert] - base;
 
-    const float length = glm::max(glm::length(jointVec), glm::length(edgeVec));
-    const float lengthPair =
+    const Real length = glm::max(glm::length(jointVec), glm::length(edgeVec));
+    const Real lengthPair =
         glm::max(glm::length(jointVec), glm::length(pairVec));
-    glm::vec3 normal = glm::cross(jointVec, edgeVec);
-    const float area = glm::length(normal);
-    const float areaPair = glm::length(glm::cross(pairVec, jointVec));
+    vec3 normal = glm::cross(jointVec, edgeVec);
+    const Real area = glm::length(normal);
+    const Real areaPair = glm::length(glm::cross(pairVec, jointVec));
     // Don't link degenerate triangles
     if (area < length * precision || areaPair < lengthPair * precision) return;
 
-    const float volume = glm::abs(glm::dot(normal, pairVec));
+    const Real volume = glm::abs(glm::dot(normal, pairVec));
     // Only operate on coplanar triangles
     if (volume > glm::max(area, areaPair) * precision) return;
 
@@ -247,25 +295,22 @@ struct CoplanarEdge {
     if (area > 0) {
       normal /= area;
       for (int i = 0; i < numProp; ++i) {
-        const float scale = precision / propTol[i];
+        const Real scale = precision / propTol[i];
 
-        const float baseProp = prop[numProp * triProp[edge.face][baseNum] + i];
-        const float jointProp =
-            prop[numProp * triProp[pair.face][jointNum] + i];
-        const float edgeProp = prop[numProp * triProp[edge.face][edgeNum] + i];
-        const float pairProp = prop[numProp * triProp[pair.face][pairNum] + i];
+        const Real baseProp = prop[numProp * triProp[edge.face][baseNum] + i];
+        const Real jointProp = prop[numProp * triProp[pair.face][jointNum] + i];
+        const Real edgeProp = prop[numProp * triProp[edge.face][edgeNum] + i];
+        const Real pairProp = prop[numProp * triProp[pair.face][pairNum] + i];
 
-        const glm::vec3 iJointVec =
+        const vec3 iJointVec =
             jointVec + normal * scale * (jointProp - baseProp);
-        const glm::vec3 iEdgeVec =
-            edgeVec + normal * scale * (edgeProp - baseProp);
-        const glm::vec3 iPairVec =
-            pairVec + normal * scale * (pairProp - baseProp);
+        const vec3 iEdgeVec = edgeVec + normal * scale * (edgeProp - baseProp);
+        const vec3 iPairVec = pairVec + normal * scale * (pairProp - baseProp);
 
-        glm::vec3 cross = glm::cross(iJointVec, iEdgeVec);
-        const float area = glm::max(
+        vec3 cross = glm::cross(iJointVec, iEdgeVec);
+        const Real area = glm::max(
             glm::length(cross), glm::length(glm::cross(iPairVec, iJointVec)));
-        const float volume = glm::abs(glm::dot(cross, iPairVec));
+        const Real volume = glm::abs(glm::dot(cross, iPairVec));
         // Only operate on consistent triangles
         if (volume > area * precision) return;
       }
@@ -279,7 +324,7 @@ struct CoplanarEdge {
 };
 
 struct EdgeBox {
-  const glm::vec3* vertPos;
+  const vec3* vertPos;
 
   __host__ __device__ void operator()(
       thrust::tuple<Box&, const TmpEdge&> inout) {
@@ -301,8 +346,8 @@ std::atomic<int> Manifold::Impl::meshIDCounter_(1);
  */
 Manifold::Impl::Impl(const Mesh& mesh,
                      const std::vector<glm::ivec3>& triProperties,
-                     const std::vector<float>& properties,
-                     const std::vector<float>& propertyTolerance)
+                     const std::vector<Real>& properties,
+                     const std::vector<Real>& propertyTolerance)
     : vertPos_(mesh.vertPos), halfedgeTangent_(mesh.halfedgeTangent) {
   VecDH<glm::ivec3> triVerts = mesh.triVerts;
   if (!IsIndexInBounds(triVerts)) {
@@ -318,8 +363,9 @@ Manifold::Impl::Impl(const Mesh& mesh,
   }
   SetPrecision();
 
-  CreateHalfedges(triVerts);
-  if (!IsManifold()) {
+  // a successful hash pairing is already a full manifold check
+  const bool paired = CreateHalfedges(triVerts);
+  if (!paired && !IsManifold()) {
     MarkFailure(Error::NOT_MANIFOLD);
     return;
   }
@@ -327,7 +373,7 @@ Manifold::Impl::Impl(const Mesh& mesh,
   InitializeNewReference(triProperties, properties, propertyTolerance);
   if (status_ != Error::NO_ERROR) return;
 
-  SimplifyTopology();
+  if (!paired || !ManifoldParams().trustInputMesh) SimplifyTopology();
   Finish();
 }
 
@@ -336,7 +382,7 @@ Manifold::Impl::Impl(const Mesh& mesh,
  * first octant, while the others are symmetric about the origin.
  */
 Manifold::Impl::Impl(Shape shape) {
-  std::vector<glm::vec3> vertPos;
+  std::vector<vec3> vertPos;
   std::vector<glm::ivec3> triVerts;
   switch (shape) {
     case Shape::TETRAHEDRON:
@@ -387,7 +433,7 @@ void Manifold::Impl::RemoveUnreferencedVerts(VecDH<glm::ivec3>& triVerts) {
   for_each(policy, triVerts.cbegin(), triVerts.cend(),
            MarkVerts({vertOld2New.ptrD() + 1}));
 
-  const VecDH<glm::vec3> oldVertPos = vertPos_;
+  const VecDH<vec3> oldVertPos = vertPos_;
   vertPos_.resize(copy_if<decltype(vertPos_.begin())>(
                       policy, oldVertPos.cbegin(), oldVertPos.cend(),
                       vertOld2New.cbegin() + 1, vertPos_.begin(),
@@ -412,8 +458,8 @@ void Manifold::Impl::ReinitializeReference(int meshID) {
 
 int Manifold::Impl::InitializeNewReference(
     const std::vector<glm::ivec3>& triProperties,
-    const std::vector<float>& properties,
-    const std::vector<float>& propertyTolerance) {
+    const std::vector<Real>& properties,
+    const std::vector<Real>& propertyTolerance) {
   meshRelation_.triBary.resize(NumTri());
   const int nextMeshID = meshIDCounter_.fetch_add(1, std::memory_order_relaxed);
   ReinitializeReference(nextMeshID);
@@ -421,8 +467,8 @@ int Manifold::Impl::InitializeNewReference(
   const int numProps = propertyTolerance.size();
 
   VecDH<glm::ivec3> triPropertiesD(triProperties);
-  VecDH<float> propertiesD(properties);
-  VecDH<float> propertyToleranceD(propertyTolerance);
+  VecDH<Real> propertiesD(properties);
+  VecDH<Real> propertyToleranceD(propertyTolerance);
 
   if (numProps > 0) {
     if (triProperties.size() != NumTri() && triProperties.size() != 0) {
@@ -443,7 +489,7 @@ int Manifold::Impl::InitializeNewReference(
   }
 
   VecDH<thrust::pair<int, int>> face2face(halfedge_.size(), {-1, -1});
-  VecDH<float> triArea(NumTri());
+  VecDH<Real> triArea(NumTri());
   for_each_n(autoPolicy(halfedge_.size()), zip(face2face.begin(), countAt(0)),
              halfedge_.size(),
              CoplanarEdge({triArea.ptrD(), halfedge_.cptrD(), vertPos_.cptrD(),
@@ -480,9 +526,9 @@ int Manifold::Impl::InitializeNewReference(
     const int refTri = comp2tri[components[tri]];
     if (refTri == tri) continue;
 
-    glm::mat3 triPos;
+    mat3 triPos;
     for (int i : {0, 1, 2}) {
-      const int vert = halfedge_[3 * refTri + i].startVert;
+      const int vert = halfedge_.startVert[3 * refTri + i];
       triPos[i] = vertPos_[vert];
       triVert2bary[{refTri, vert}] = i - 3;
     }
@@ -490,10 +536,9 @@ int Manifold::Impl::InitializeNewReference(
     glm::ivec3 vertBary;
     bool coplanar = true;
     for (int i : {0, 1, 2}) {
-      const int vert = halfedge_[3 * tri + i].startVert;
+      const int vert = halfedge_.startVert[3 * tri + i];
       if (triVert2bary.find({refTri, vert}) == triVert2bary.end()) {
-        const glm::vec3 uvw =
-            GetBarycentric(vertPos_[vert], triPos, precision_);
+        const vec3 uvw = GetBarycentric(vertPos_[vert], triPos, precision_);
         if (isnan(uvw[0])) {
           coplanar = false;
           triVert2bary[{refTri, vert}] = -4;
@@ -522,19 +567,55 @@ int Manifold::Impl::InitializeNewReference(
 
 /**
  * Create the halfedge_ data structure from an input triVerts array like Mesh.
+ * Halfedges are paired through a hash table of their vertex pairs. If that
+ * finds any edge that is not shared by exactly one halfedge in each
+ * direction, the pairing falls back to a stable sort, which leaves such edges
+ * for SimplifyTopology to fix.
+ *
+ * Returns true if the hash pairing succeeded, in which case the result is
+ * known to be an oriented 2-manifold without further checks.
  */
-void Manifold::Impl::CreateHalfedges(const VecDH<glm::ivec3>& triVerts) {
+bool Manifold::Impl::CreateHalfedges(const VecDH<glm::ivec3>& triVerts) {
   const int numTri = triVerts.size();
-  const int numEdge = 3 * numTri / 2;
+  const int numHalfedge = 3 * numTri;
   // drop the old value first to avoid copy
   halfedge_.resize(0);
-  halfedge_.resize(2 * numEdge);
-  VecDH<uint64_t> edge(2 * numEdge);
-  VecDH<int> ids(2 * numEdge);
+  halfedge_.resize(numHalfedge);
   auto policy = autoPolicy(numTri);
-  sequence(policy, ids.begin(), ids.end());
   for_each_n(policy, zip(countAt(0), triVerts.begin()), numTri,
-             Tri2Halfedges({halfedge_.ptrD(), edge.ptrD()}));
+             Tri2Halfedges({halfedge_.ptrD()}));
+
+  // at most half full, as there is one entry per forward halfedge
+  int tableSize = 1;
+  while (tableSize < numHalfedge) tableSize <<= 1;
+  const int mask = tableSize - 1;
+  VecDH<int> table(tableSize, -1);
+  VecDH<int> failed(1, 0);
+  const int* startVert = halfedge_.startVert.cptrD();
+  const int* endVert = halfedge_.endVert.cptrD();
+  for_each_n(
+      policy, countAt(0), numHalfedge,
+      InsertForwardHalfedge({table.ptrD(), failed.ptrD(), startVert, endVert,
+                             mask}));
+  if (failed[0] == 0) {
+    for_each_n(policy, countAt(0), numHalfedge,
+               PairBackwardHalfedge({halfedge_.pairedHalfedge.ptrD(),
+                                     failed.ptrD(), table.cptrD(), startVert,
+                                     endVert, mask}));
+  }
+  if (failed[0] == 0 &&
+      all_of(policy, halfedge_.pairedHalfedge.begin(),
+             halfedge_.pairedHalfedge.end(), IsPaired()))
+    return true;
+
+  const int numEdge = numHalfedge / 2;
+  fill(policy, halfedge_.pairedHalfedge.begin(), halfedge_.pairedHalfedge.end(),
+       -1);
+  VecDH<uint64_t> edge(numHalfedge);
+  VecDH<int> ids(numHalfedge);
+  sequence(policy, ids.begin(), ids.end());
+  transform(policy, countAt(0), countAt(numHalfedge), edge.begin(),
+            EdgeSortKey({startVert, endVert}));
   // Stable sort is required here so that halfedges from the same face are
   // paired together (the triangles were created in face order). In some
   // degenerate situations the triangulator can add the same internal edge in
@@ -544,23 +625,30 @@ void Manifold::Impl::CreateHalfedges(const VecDH<glm::ivec3>& triVerts) {
   // Once sorted, the first half of the range is the forward halfedges, which
   // correspond to their backward pair at the same offset in the second half
   // of the range.
-  for_each_n(policy, countAt(0), numEdge,
-             LinkHalfedges({halfedge_.ptrD(), ids.ptrD(), numEdge}));
+  for_each_n(
+      policy, countAt(0), numEdge,
+      LinkHalfedges({halfedge_.pairedHalfedge.ptrD(), ids.ptrD(), numEdge}));
+  return false;
 }
 
 /**
  * Does a full recalculation of the face bounding boxes, including updating the
- * collider, but does not resort the faces.
+ * collider, but does not resort the faces. The collider is refit, unless its
+ * hierarchy no longer suits the new vertex positions, in which case it is
+ * rebuilt.
  */
 void Manifold::Impl::Update() {
+  properties_.Invalidate();
   CalculateBBox();
   VecDH<Box> faceBox;
   VecDH<uint32_t> faceMorton;
   GetFaceBoxMorton(faceBox, faceMorton);
   collider_.UpdateBoxes(faceBox);
+  if (collider_.Degraded()) collider_.Rebuild(faceBox, faceMorton);
 }
 
 void Manifold::Impl::MarkFailure(Error status) {
+  properties_.Invalidate();
   bBox_ = Box();
   vertPos_.resize(0);
   halfedge_.resize(0);
@@ -571,8 +659,8 @@ void Manifold::Impl::MarkFailure(Error status) {
   status_ = status;
 }
 
-Manifold::Impl Manifold::Impl::Transform(const glm::mat4x3& transform_) const {
-  if (transform_ == glm::mat4x3(1.0f)) return *this;
+Manifold::Impl Manifold::Impl::Transform(const mat4x3& transform_) const {
+  if (transform_ == mat4x3(1.0f)) return *this;
   auto policy = autoPolicy(NumVert());
   Impl result;
   result.collider_ = collider_;
@@ -588,24 +676,28 @@ Manifold::Impl Manifold::Impl::Transform(const glm::mat4x3& transform_) const {
   transform(policy, vertPos_.begin(), vertPos_.end(), result.vertPos_.begin(),
             Transform4x3({transform_}));
 
-  glm::mat3 normalTransform =
-      glm::inverse(glm::transpose(glm::mat3(transform_)));
+  mat3 normalTransform = glm::inverse(glm::transpose(mat3(transform_)));
   transform(policy, faceNormal_.begin(), faceNormal_.end(),
             result.faceNormal_.begin(), TransformNormals({normalTransform}));
   transform(policy, vertNormal_.begin(), vertNormal_.end(),
             result.vertNormal_.begin(), TransformNormals({normalTransform}));
   // This optimization does a cheap collider update if the transform is
-  // axis-aligned.
-  if (!result.collider_.Transform(transform_)) result.Update();
-
-  result.CalculateBBox();
-  float scale = 0;
+  // axis-aligned. Otherwise the collider is refit to the new face boxes, which
+  // keeps its hierarchy, as rigid motions preserve the arrangement of faces.
+  if (!result.collider_.Transform(transform_))
+    result.Update();
+  else
+    result.CalculateBBox();
+  Real scale = 0;
   for (int i : {0, 1, 2})
     scale =
         glm::max(scale, transform_[0][i] + transform_[1][i] + transform_[2][i]);
   result.precision_ *= scale;
   // Maximum of inherited precision loss and translational precision loss.
   result.SetPrecision(result.precision_);
+  Properties properties;
+  if (CachedProperties(properties, transform_))
+    result.properties_.Set(properties);
   return result;
 }
 
@@ -613,7 +705,7 @@ Manifold::Impl Manifold::Impl::Transform(const glm::mat4x3& transform_) const {
  * Sets the precision based on the bounding box, and limits its minimum value by
  * the optional input.
  */
-void Manifold::Impl::SetPrecision(float minPrecision) {
+void Manifold::Impl::SetPrecision(Real minPrecision) {
   precision_ = glm::max(minPrecision, kTolerance * bBox_.Scale());
   if (!glm::isfinite(precision_)) precision_ = -1;
 }
@@ -633,7 +725,7 @@ void Manifold::Impl::SetPrecision(float minPrecision) {
 void Manifold::Impl::CalculateNormals() {
   vertNormal_.resize(NumVert());
   auto policy = autoPolicy(NumTri());
-  fill(policy, vertNormal_.begin(), vertNormal_.end(), glm::vec3(0));
+  fill(policy, vertNormal_.begin(), vertNormal_.end(), vec3(0));
   bool calculateTriNormal = false;
   if (faceNormal_.size() != NumTri()) {
     faceNormal_.resize(NumTri());
@@ -695,12 +787,24 @@ SparseIndices Manifold::Impl::EdgeCollisions(const Impl& Q) const {
   return q1p2;
 }
 
+/**
+ * The number of overlaps EdgeCollisions would return, without recording them.
+ */
+int Manifold::Impl::NumEdgeCollisions(const Impl& Q) const {
+  VecDH<TmpEdge> edges = CreateTmpEdges(Q.halfedge_);
+  const int numEdge = edges.size();
+  VecDH<Box> QedgeBB(numEdge);
+  for_each_n(autoPolicy(numEdge), zip(QedgeBB.begin(), edges.cbegin()),
+             numEdge, EdgeBox({Q.vertPos_.cptrD()}));
+  return collider_.NumCollisions(QedgeBB);
+}
+
 /**
  * Returns a sparse array of the input vertices that project inside the XY
  * bounding boxes of the faces of this manifold.
  */
 SparseIndices Manifold::Impl::VertexCollisionsZ(
-    const VecDH<glm::vec3>& vertsIn) const {
+    const VecDH<vec3>& vertsIn) const {
   return collider_.Collisions(vertsIn);
 }
 }  // namespace manifold
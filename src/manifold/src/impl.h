@@ -13,6 +13,8 @@
 // limitations under the License.
 
 #pragma once
+#include <atomic>
+
 #include "collider.h"
 #include "manifold.h"
 #include "optional_assert.h"
@@ -26,22 +28,79 @@ namespace manifold {
 /** @ingroup Private */
 struct Manifold::Impl {
   struct MeshRelationD {
-    VecDH<glm::vec3> barycentric;
+    VecDH<vec3> barycentric;
     VecDH<BaryRef> triBary;
     /// The meshID of this Manifold if it is an original; -1 otherwise.
     int originalID = -1;
   };
 
   Box bBox_;
-  float precision_ = -1;
+  Real precision_ = -1;
   Error status_ = Error::NO_ERROR;
-  VecDH<glm::vec3> vertPos_;
-  VecDH<Halfedge> halfedge_;
-  VecDH<glm::vec3> vertNormal_;
-  VecDH<glm::vec3> faceNormal_;
-  VecDH<glm::vec4> halfedgeTangent_;
+  VecDH<vec3> vertPos_;
+  HalfedgeVec halfedge_;
+  VecDH<vec3> vertNormal_;
+  VecDH<vec3> faceNormal_;
+  VecDH<vec4> halfedgeTangent_;
   MeshRelationD meshRelation_;
   Collider collider_;
+  // The stats of the Booleans that produced this Impl, including those of its
+  // operands, or null if none did; see Manifold::GetResultStats().
+  std::shared_ptr<const BooleanStats> booleanStats_;
+
+  /**
+   * The lazily computed result of GetProperties(). A const Impl may be shared
+   * by many threads, so it is set atomically. Every change to the geometry
+   * ends in Finish(), Update() or MarkFailure(), which invalidate it.
+   */
+  struct PropertiesCache {
+    std::atomic<bool> valid{false};
+    std::atomic<Real> surfaceArea{0};
+    std::atomic<Real> volume{0};
+
+    PropertiesCache() {}
+    PropertiesCache(const PropertiesCache& other) { *this = other; }
+    PropertiesCache& operator=(const PropertiesCache& other) {
+      Properties properties;
+      if (other.Get(properties))
+        Set(properties);
+      else
+        Invalidate();
+      return *this;
+    }
+
+    bool Get(Properties& properties) const {
+      if (!valid.load(std::memory_order_acquire)) return false;
+      properties = {surfaceArea.load(std::memory_order_relaxed),
+                    volume.load(std::memory_order_relaxed)};
+      return true;
+    }
+    void Set(const Properties& properties) {
+      surfaceArea.store(properties.surfaceArea, std::memory_order_relaxed);
+      volume.store(properties.volume, std::memory_order_relaxed);
+      valid.store(true, std::memory_order_release);
+    }
+    void Invalidate() { valid.store(false, std::memory_order_relaxed); }
+  };
+  mutable PropertiesCache properties_;
+
+  /**
+   * The mesh of a compacted Impl, whose own buffers are then empty; see
+   * Compact(). Shared and never modified, like the buffers it replaces.
+   */
+  struct CompactMesh {
+    int numVert = 0;
+    // bits per axis of the quantized positions, or 0 if they are exact
+    int positionBits = 0;
+    VecDH<vec3> vertPos;
+    VecDH<uint64_t> vertGrid;
+    // the start vert and paired halfedge of each halfedge
+    VecDH<int> cornerVert;
+    VecDH<int> cornerPair;
+    VecDH<vec4> halfedgeTangent;
+    MeshRelationD meshRelation;
+  };
+  std::shared_ptr<const CompactMesh> compact_;
 
   static std::atomic<int> meshIDCounter_;
 
@@ -51,62 +110,80 @@ struct Manifold::Impl {
 
   Impl(const Mesh&,
        const std::vector<glm::ivec3>& triProperties = std::vector<glm::ivec3>(),
-       const std::vector<float>& properties = std::vector<float>(),
-       const std::vector<float>& propertyTolerance = std::vector<float>());
+       const std::vector<Real>& properties = std::vector<Real>(),
+       const std::vector<Real>& propertyTolerance = std::vector<Real>());
 
   int InitializeNewReference(
       const std::vector<glm::ivec3>& triProperties = std::vector<glm::ivec3>(),
-      const std::vector<float>& properties = std::vector<float>(),
-      const std::vector<float>& propertyTolerance = std::vector<float>());
+      const std::vector<Real>& properties = std::vector<Real>(),
+      const std::vector<Real>& propertyTolerance = std::vector<Real>());
 
   void RemoveUnreferencedVerts(VecDH<glm::ivec3>& triVerts);
   void ReinitializeReference(int meshID);
-  void CreateHalfedges(const VecDH<glm::ivec3>& triVerts);
+  bool CreateHalfedges(const VecDH<glm::ivec3>& triVerts);
   void CalculateNormals();
   void IncrementMeshIDs(int start, int length);
 
   void Update();
   void MarkFailure(Error status);
-  Impl Transform(const glm::mat4x3& transform) const;
+  Impl Transform(const mat4x3& transform) const;
   SparseIndices EdgeCollisions(const Impl& B) const;
-  SparseIndices VertexCollisionsZ(const VecDH<glm::vec3>& vertsIn) const;
+  int NumEdgeCollisions(const Impl& B) const;
+  SparseIndices VertexCollisionsZ(const VecDH<vec3>& vertsIn) const;
 
   bool IsEmpty() const { return NumVert() == 0; }
-  int NumVert() const { return vertPos_.size(); }
-  int NumEdge() const { return halfedge_.size() / 2; }
-  int NumTri() const { return halfedge_.size() / 3; }
+  int NumVert() const {
+    return compact_ ? compact_->numVert : vertPos_.size();
+  }
+  int NumEdge() const { return NumHalfedge() / 2; }
+  int NumTri() const { return NumHalfedge() / 3; }
+  int NumHalfedge() const {
+    return compact_ ? compact_->cornerVert.size() : halfedge_.size();
+  }
 
   // properties.cu
   Properties GetProperties() const;
+  bool CachedProperties(Properties& properties,
+                        const mat4x3& transform = mat4x3(1.0f)) const;
   Curvature GetCurvature() const;
+  MemoryUsage GetMemoryUsage() const;
   void CalculateBBox();
   bool IsFinite() const;
   bool IsIndexInBounds(const VecDH<glm::ivec3>& triVerts) const;
-  void SetPrecision(float minPrecision = -1);
+  void SetPrecision(Real minPrecision = -1);
   bool IsManifold() const;
   bool Is2Manifold() const;
   bool MatchesTriNormals() const;
   int NumDegenerateTris() const;
 
   // sort.cu
-  void Finish();
-  void SortVerts();
-  void ReindexVerts(const VecDH<int>& vertNew2Old, int numOldVert);
+  void Finish(VecDH<int>* vertNew2Old = nullptr);
+  void SortVerts(VecDH<int>& vertNew2Old, VecDH<int>& vertOld2New);
   void GetFaceBoxMorton(VecDH<Box>& faceBox, VecDH<uint32_t>& faceMorton) const;
-  void SortFaces(VecDH<Box>& faceBox, VecDH<uint32_t>& faceMorton);
-  void GatherFaces(const VecDH<int>& faceNew2Old);
+  void SortFaces(VecDH<Box>& faceBox, VecDH<uint32_t>& faceMorton,
+                 VecDH<int>& faceNew2Old) const;
+  void GatherFaces(const VecDH<int>& faceNew2Old,
+                   const VecDH<int>& vertOld2New);
   void GatherFaces(const Impl& old, const VecDH<int>& faceNew2Old);
+  void GatherFaces(const Impl& old, const VecDH<int>& faceNew2Old,
+                   const VecDH<int>& faceOld2New,
+                   const VecDH<int>& vertOld2New);
 
   // face_op.cu
   void Face2Tri(const VecDH<int>& faceEdge, const VecDH<BaryRef>& faceRef,
                 const VecDH<int>& halfedgeBary);
-  Polygons Face2Polygons(int face, glm::mat3x2 projection,
+  Polygons Face2Polygons(int face, mat3x2 projection,
                          const VecDH<int>& faceEdge) const;
 
   // edge_op.cu
   void SimplifyTopology();
   void DedupeEdge(int edge);
-  void CollapseEdge(int edge);
+  void CollapseEdge(int edge, bool force = false);
+  void CollapseEdges(const VecDH<int>& edges);
+  bool CollapseFormsLoop(int edge) const;
+  bool CollapseInverts(int edge) const;
+  void ProjectCollapse(int edge, int baryStart);
+  void Simplify(Real tolerance, VecDH<int>* vertNew2Old = nullptr);
   void RecursiveEdgeSwap(int edge);
   void RemoveIfFolded(int edge);
   void PairUp(int edge0, int edge1);
@@ -114,9 +191,34 @@ struct Manifold::Impl {
   void FormLoop(int current, int end);
   void CollapseTri(const glm::ivec3& triEdge);
 
+  // plane_op.cu
+  Impl Trim(vec3 normal, Real originOffset) const;
+  std::vector<Polygons> Slices(const std::vector<Real>& heights) const;
+
+  // queries.cu
+  void Winding(const vec3* points, int numPoint, int* winding) const;
+  void SignedDistance(const vec3* points, int numPoint, Real maxDistance,
+                      Real* distance) const;
+  void RayCast(const vec3* origins, const vec3* directions, int numRay,
+               Real maxDistance, RayHit* hits) const;
+
   // smoothing.cu
   void CreateTangents(const std::vector<Smoothness>&);
   MeshRelationD Subdivide(int n);
+  MeshRelationD Subdivide(const VecDH<TmpEdge>& edges,
+                          const VecDH<int>& edgeDivisions);
   void Refine(int n);
+  void RefineToLength(Real length);
+  void RefineToPrecision(Real precision);
+  void Refine(const VecDH<TmpEdge>& edges, const VecDH<int>& edgeDivisions);
+  void Interpolate(const Impl& old, const MeshRelationD& relation);
+
+  // constructors.cu
+  VecDH<int> VertRoots() const;
+
+  // compact.cu
+  Impl Compact(int positionBits) const;
+  Impl Expand() const;
+  bool IsCompact() const { return compact_ != nullptr; }
 };
 }  // namespace manifold
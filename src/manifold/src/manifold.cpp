@@ -12,10 +12,17 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <functional>
+
 #include "boolean3.h"
+#include "csg_cache.h"
 #include "csg_tree.h"
 #include "impl.h"
 #include "par.h"
+#include "trace.h"
 
 namespace {
 using namespace manifold;
@@ -24,7 +31,7 @@ using namespace thrust::placeholders;
 ExecutionParams params;
 
 struct MakeTri {
-  const Halfedge* halfedges;
+  HalfedgeCPtr halfedges;
 
   __host__ __device__ void operator()(thrust::tuple<glm::ivec3&, int> inOut) {
     glm::ivec3& tri = thrust::get<0>(inOut);
@@ -36,17 +43,86 @@ struct MakeTri {
   }
 };
 
-Manifold Halfspace(Box bBox, glm::vec3 normal, float originOffset) {
-  normal = glm::normalize(normal);
-  Manifold cutter =
-      Manifold::Cube(glm::vec3(2.0f), true).Translate({1.0f, 0.0f, 0.0f});
-  float size = glm::length(bBox.Center() - normal * originOffset) +
-               0.5f * glm::length(bBox.Size());
-  cutter = cutter.Scale(glm::vec3(size)).Translate({originOffset, 0.0f, 0.0f});
-  float yDeg = glm::degrees(-glm::asin(normal.z));
-  float zDeg = glm::degrees(glm::atan(normal.y, normal.x));
-  return cutter.Rotate(0.0f, yDeg, zDeg);
+// These write to the caller's host memory, so they never run on the GPU.
+ExecutionPolicy HostPolicy(int size) {
+  const ExecutionPolicy policy = autoPolicy(size);
+  return policy == ExecutionPolicy::ParUnseq ? ExecutionPolicy::Par : policy;
 }
+
+struct WriteVert {
+  char* out;
+  const vec3* vertPos;
+  const vec3* vertNormal;
+  const MeshGLLayout::Normal normal;
+  const int stride;
+
+  void operator()(int vert) {
+    // GPU buffers are always single precision
+    char* dst = out + static_cast<size_t>(vert) * stride;
+    const glm::vec3 pos(vertPos[vert]);
+    const glm::vec3 norm(vertNormal[vert]);
+    std::memcpy(dst, &pos, sizeof(pos));
+    dst += sizeof(pos);
+    if (normal == MeshGLLayout::Normal::FLOAT) {
+      std::memcpy(dst, &norm, sizeof(norm));
+    } else if (normal == MeshGLLayout::Normal::SNORM16) {
+      const glm::vec3 n = glm::round(
+          32767.0f * glm::clamp(norm, glm::vec3(-1), glm::vec3(1)));
+      const int16_t snorm[4] = {static_cast<int16_t>(n.x),
+                                static_cast<int16_t>(n.y),
+                                static_cast<int16_t>(n.z), 0};
+      std::memcpy(dst, snorm, sizeof(snorm));
+    }
+  }
+};
+
+template <typename Index>
+struct WriteIndex {
+  Index* out;
+  HalfedgeCPtr halfedge;
+
+  void operator()(int i) { out[i] = halfedge[i].startVert; }
+};
+
+// The levels are visited from fine to coarse, so the last to write a vert is
+// the coarsest one using it. A level maps its verts to distinct fine verts, so
+// no two threads write the same one.
+struct FirstLod {
+  int* firstLod;
+  const int lod;
+
+  __host__ __device__ void operator()(int fineVert) {
+    firstLod[fineVert] = lod;
+  }
+};
+
+struct WriteLodVert {
+  float* vertPos;
+  float* vertNormal;
+  const vec3* fineVertPos;
+  const vec3* fineVertNormal;
+  const int* new2Fine;
+
+  void operator()(int vert) {
+    const int fine = new2Fine[vert];
+    for (int i : {0, 1, 2}) {
+      vertPos[3 * vert + i] = fineVertPos[fine][i];
+      vertNormal[3 * vert + i] = fineVertNormal[fine][i];
+    }
+  }
+};
+
+struct WriteLodIndex {
+  uint32_t* out;
+  HalfedgeCPtr halfedge;
+  const int* level2Fine;
+  const int* fine2New;
+
+  void operator()(int i) {
+    const int vert = halfedge[i].startVert;
+    out[i] = fine2New[level2Fine == nullptr ? vert : level2Fine[vert]];
+  }
+};
 }  // namespace
 
 namespace manifold {
@@ -109,8 +185,8 @@ CsgLeafNode& Manifold::GetCsgLeafNode() const {
  */
 Manifold::Manifold(const Mesh& mesh,
                    const std::vector<glm::ivec3>& triProperties,
-                   const std::vector<float>& properties,
-                   const std::vector<float>& propertyTolerance)
+                   const std::vector<Real>& properties,
+                   const std::vector<Real>& propertyTolerance)
     : pNode_(std::make_shared<CsgLeafNode>(std::make_shared<Impl>(
           mesh, triProperties, properties, propertyTolerance))) {}
 
@@ -140,6 +216,10 @@ Mesh Manifold::GetMesh() const {
 
 MeshGL Manifold::GetMeshGL() const {
   const Impl& impl = *GetCsgLeafNode().GetImpl();
+  static_assert(sizeof(vec3) == 3 * sizeof(Real),
+                "vec3 must be tightly packed.");
+  static_assert(sizeof(vec4) == 4 * sizeof(Real),
+                "vec4 must be tightly packed.");
 
   const int numVert = NumVert();
   const int numTri = NumTri();
@@ -148,35 +228,143 @@ MeshGL Manifold::GetMeshGL() const {
   out.vertPos.resize(3 * numVert);
   out.vertNormal.resize(3 * numVert);
   out.triVerts.resize(3 * numTri);
-  for (int i = 0; i < numVert; ++i) {
-    const glm::vec3 v = impl.vertPos_[i];
-    out.vertPos[3 * i] = v.x;
-    out.vertPos[3 * i + 1] = v.y;
-    out.vertPos[3 * i + 2] = v.z;
-    const glm::vec3 n = impl.vertNormal_[i];
-    out.vertNormal[3 * i] = n.x;
-    out.vertNormal[3 * i + 1] = n.y;
-    out.vertNormal[3 * i + 2] = n.z;
-  }
-  for (int i = 0; i < numTri * 3; ++i) {
-    out.triVerts[i] = impl.halfedge_[i].startVert;
-  }
+  // a plain copy for float, which also narrows a double build's vectors
+  const Real* vertPos = reinterpret_cast<const Real*>(impl.vertPos_.cptrH());
+  const Real* vertNormal =
+      reinterpret_cast<const Real*>(impl.vertNormal_.cptrH());
+  std::copy(vertPos, vertPos + 3 * numVert, out.vertPos.begin());
+  std::copy(vertNormal, vertNormal + 3 * numVert, out.vertNormal.begin());
+  for_each_n(HostPolicy(3 * numTri), countAt(0), 3 * numTri,
+             WriteIndex<uint32_t>(
+                 {out.triVerts.data(), impl.halfedge_.cptrH()}));
   const int numHalfedge = impl.halfedgeTangent_.size();
   out.halfedgeTangent.resize(4 * numHalfedge);
-  for (int i = 0; i < numHalfedge; ++i) {
-    const glm::vec4 t = impl.halfedgeTangent_[i];
-    out.halfedgeTangent[4 * i] = t.x;
-    out.halfedgeTangent[4 * i + 1] = t.y;
-    out.halfedgeTangent[4 * i + 2] = t.z;
-    out.halfedgeTangent[4 * i + 3] = t.w;
+  const Real* tangent =
+      reinterpret_cast<const Real*>(impl.halfedgeTangent_.cptrH());
+  std::copy(tangent, tangent + 4 * numHalfedge, out.halfedgeTangent.begin());
+
+  return out;
+}
+
+/**
+ * Simplifies the mesh to each of the given tolerances, see Simplify(), and
+ * returns the levels together in one MeshGLLods, coarsest first. Each level is
+ * simplified from the next finer one, and Simplify() leaves the verts where
+ * they were, so the levels nest and share the verts and normals of the finest
+ * level, ordered so that each level uses a prefix of them. The verts of each
+ * level are mapped to the finest one by the index maps that Simplify()
+ * returns, so coincident verts are told apart.
+ *
+ * @param tolerances The maximum distance the surface may move for each level,
+ * in any order. A tolerance of zero gives the full mesh.
+ */
+MeshGLLods Manifold::GetMeshGLLods(std::vector<float> tolerances) const {
+  std::sort(tolerances.begin(), tolerances.end(), std::greater<float>());
+  const int numLod = tolerances.size();
+  MeshGLLods out;
+  out.tolerance = tolerances;
+  out.numVert.resize(numLod);
+  out.triStart.resize(numLod + 1, 0);
+  if (numLod == 0) return out;
+
+  std::vector<std::shared_ptr<const Impl>> levels(numLod);
+  // the verts of each level by their index in the next finer one
+  std::vector<VecDH<int>> level2Finer(numLod);
+  auto current = std::make_shared<Impl>(*GetCsgLeafNode().GetImpl());
+  for (int lod = numLod - 1; lod >= 0; --lod) {
+    current->Simplify(tolerances[lod], &level2Finer[lod]);
+    levels[lod] = std::make_shared<const Impl>(*current);
   }
+  const Impl& fine = *levels.back();
+  const int numFine = fine.NumVert();
 
+  // The coarsest level that references each fine vert orders them.
+  std::vector<VecDH<int>> level2Fine(numLod - 1);
+  VecDH<int> firstLod(numFine, numLod - 1);
+  auto policy = autoPolicy(numFine);
+  for (int lod = numLod - 2; lod >= 0; --lod) {
+    VecDH<int>& toFine = level2Fine[lod];
+    const VecDH<int>& toFiner = level2Finer[lod];
+    policy = autoPolicy(toFiner.size());
+    if (lod == numLod - 2) {
+      toFine = toFiner;
+    } else {
+      toFine.resize(toFiner.size());
+      gather(policy, toFiner.begin(), toFiner.end(),
+             level2Fine[lod + 1].begin(), toFine.begin());
+    }
+    for_each(policy, toFine.begin(), toFine.end(),
+             FirstLod({firstLod.ptrD(), lod}));
+  }
+  VecDH<int> new2Fine(numFine);
+  policy = autoPolicy(numFine, KernelCost::Sort);
+  sequence(policy, new2Fine.begin(), new2Fine.end());
+  stable_sort_by_key(policy, firstLod.begin(), firstLod.end(),
+                     new2Fine.begin());
+  VecDH<int> fine2New(numFine);
+  scatter(policy, countAt(0), countAt(numFine), new2Fine.begin(),
+          fine2New.begin());
+  for (int lod = 0; lod < numLod; ++lod) {
+    out.numVert[lod] = std::upper_bound(firstLod.cbegin(), firstLod.cend(),
+                                        lod) -
+                       firstLod.cbegin();
+    out.triStart[lod + 1] = out.triStart[lod] + levels[lod]->NumTri();
+  }
+
+  out.mesh.vertPos.resize(3 * numFine);
+  out.mesh.vertNormal.resize(3 * numFine);
+  for_each_n(HostPolicy(numFine), countAt(0), numFine,
+             WriteLodVert({out.mesh.vertPos.data(), out.mesh.vertNormal.data(),
+                           fine.vertPos_.cptrH(), fine.vertNormal_.cptrH(),
+                           new2Fine.cptrH()}));
+  out.mesh.triVerts.resize(3 * out.triStart.back());
+  for (int lod = 0; lod < numLod; ++lod) {
+    const int numIndex = 3 * levels[lod]->NumTri();
+    const int* toFine = lod < numLod - 1 ? level2Fine[lod].cptrH() : nullptr;
+    for_each_n(HostPolicy(numIndex), countAt(0), numIndex,
+               WriteLodIndex({out.mesh.triVerts.data() + 3 * out.triStart[lod],
+                              levels[lod]->halfedge_.cptrH(), toFine,
+                              fine2New.cptrH()}));
+  }
   return out;
 }
 
+/**
+ * Writes the mesh straight into caller-provided buffers, in parallel, in a
+ * layout ready to upload to the GPU. This avoids the intermediate vectors of
+ * GetMeshGL(), which is what makes exporting large meshes expensive.
+ *
+ * @param layout The vertex format and index size to write.
+ * @param vertBuffer Receives layout.VertBytes(NumVert()) bytes: each vertex's
+ * position, followed by its normal according to layout.normal.
+ * @param indexBuffer Receives layout.IndexBytes(NumVert(), NumTri()) bytes:
+ * the three vertex indices of each triangle in CCW order, as uint16_t if
+ * layout.IndexSize(NumVert()) is 2 and as uint32_t otherwise.
+ */
+void Manifold::WriteMeshGL(const MeshGLLayout& layout, void* vertBuffer,
+                           void* indexBuffer) const {
+  const Impl& impl = *GetCsgLeafNode().GetImpl();
+  const int numVert = NumVert();
+  const int numIndex = 3 * NumTri();
+
+  for_each_n(HostPolicy(numVert), countAt(0), numVert,
+             WriteVert({static_cast<char*>(vertBuffer), impl.vertPos_.cptrH(),
+                        impl.vertNormal_.cptrH(), layout.normal,
+                        layout.VertStride()}));
+  if (layout.IndexSize(numVert) == 2) {
+    for_each_n(HostPolicy(numIndex), countAt(0), numIndex,
+               WriteIndex<uint16_t>({static_cast<uint16_t*>(indexBuffer),
+                                     impl.halfedge_.cptrH()}));
+  } else {
+    for_each_n(HostPolicy(numIndex), countAt(0), numIndex,
+               WriteIndex<uint32_t>({static_cast<uint32_t*>(indexBuffer),
+                                     impl.halfedge_.cptrH()}));
+  }
+}
+
 int Manifold::circularSegments_ = 0;
-float Manifold::circularAngle_ = 10.0f;
-float Manifold::circularEdgeLength_ = 1.0f;
+Real Manifold::circularAngle_ = 10.0f;
+Real Manifold::circularEdgeLength_ = 1.0f;
 
 /**
  * Sets an angle constraint the default number of circular segments for the
@@ -187,7 +375,7 @@ float Manifold::circularEdgeLength_ = 1.0f;
  * angle will increase if the the segments hit the minimum edge length. Default
  * is 10 degrees.
  */
-void Manifold::SetMinCircularAngle(float angle) {
+void Manifold::SetMinCircularAngle(Real angle) {
   if (angle <= 0) return;
   Manifold::circularAngle_ = angle;
 }
@@ -200,7 +388,7 @@ void Manifold::SetMinCircularAngle(float angle) {
  * @param length The minimum length of segments. The length will
  * increase if the the segments hit the minimum angle. Default is 1.0.
  */
-void Manifold::SetMinCircularEdgeLength(float length) {
+void Manifold::SetMinCircularEdgeLength(Real length) {
   if (length <= 0) return;
   Manifold::circularEdgeLength_ = length;
 }
@@ -225,10 +413,10 @@ void Manifold::SetCircularSegments(int number) {
  * @param radius For a given radius of circle, determine how many default
  * segments there will be.
  */
-int Manifold::GetCircularSegments(float radius) {
+int Manifold::GetCircularSegments(Real radius) {
   if (Manifold::circularSegments_ > 0) return Manifold::circularSegments_;
   int nSegA = 360.0f / Manifold::circularAngle_;
-  int nSegL = 2.0f * radius * glm::pi<float>() / Manifold::circularEdgeLength_;
+  int nSegL = 2.0f * radius * glm::pi<Real>() / Manifold::circularEdgeLength_;
   int nSeg = fmin(nSegA, nSegL) + 3;
   nSeg -= nSeg % 4;
   return nSeg;
@@ -237,7 +425,9 @@ int Manifold::GetCircularSegments(float radius) {
 /**
  * Does the Manifold have any triangles?
  */
-bool Manifold::IsEmpty() const { return GetCsgLeafNode().GetImpl()->IsEmpty(); }
+bool Manifold::IsEmpty() const {
+  return GetCsgLeafNode().GetStoredImpl()->IsEmpty();
+}
 /**
  * Returns the reason for an input Mesh producing an empty Manifold. This Status
  * only applies to Manifolds newly-created from an input Mesh - once they are
@@ -247,25 +437,33 @@ bool Manifold::IsEmpty() const { return GetCsgLeafNode().GetImpl()->IsEmpty(); }
  * precision to be collapsed to nothing.
  */
 Manifold::Error Manifold::Status() const {
-  return GetCsgLeafNode().GetImpl()->status_;
+  return GetCsgLeafNode().GetStoredImpl()->status_;
 }
 /**
  * The number of vertices in the Manifold.
  */
-int Manifold::NumVert() const { return GetCsgLeafNode().GetImpl()->NumVert(); }
+int Manifold::NumVert() const {
+  return GetCsgLeafNode().GetStoredImpl()->NumVert();
+}
 /**
  * The number of edges in the Manifold.
  */
-int Manifold::NumEdge() const { return GetCsgLeafNode().GetImpl()->NumEdge(); }
+int Manifold::NumEdge() const {
+  return GetCsgLeafNode().GetStoredImpl()->NumEdge();
+}
 /**
  * The number of triangles in the Manifold.
  */
-int Manifold::NumTri() const { return GetCsgLeafNode().GetImpl()->NumTri(); }
+int Manifold::NumTri() const {
+  return GetCsgLeafNode().GetStoredImpl()->NumTri();
+}
 
 /**
  * Returns the axis-aligned bounding box of all the Manifold's vertices.
  */
-Box Manifold::BoundingBox() const { return GetCsgLeafNode().GetImpl()->bBox_; }
+Box Manifold::BoundingBox() const {
+  return GetCsgLeafNode().GetBoundingBox();
+}
 
 /**
  * Returns the precision of this Manifold's vertices, which tracks the
@@ -274,8 +472,11 @@ Box Manifold::BoundingBox() const { return GetCsgLeafNode().GetImpl()->bBox_; }
  * considered degenerate and removed. This is the value of &epsilon; defining
  * [&epsilon;-valid](https://github.com/elalish/manifold/wiki/Manifold-Library#definition-of-%CE%B5-valid).
  */
-float Manifold::Precision() const {
-  return GetCsgLeafNode().GetImpl()->precision_;
+Real Manifold::Precision() const {
+  const CsgLeafNode& leaf = GetCsgLeafNode();
+  if (leaf.GetTransform() == mat4x3(1.0f))
+    return leaf.GetStoredImpl()->precision_;
+  return leaf.GetImpl()->precision_;
 }
 
 /**
@@ -292,10 +493,11 @@ int Manifold::Genus() const {
  * Returns the surface area and volume of the manifold. These properties are
  * clamped to zero for a given face if they are within the Precision(). This
  * means degenerate manifolds can by identified by testing these properties as
- * == 0.
+ * == 0. They are computed once and cached, and carried through Transform()s
+ * that preserve shape, and through Compose().
  */
 Properties Manifold::GetProperties() const {
-  return GetCsgLeafNode().GetImpl()->GetProperties();
+  return GetCsgLeafNode().GetProperties();
 }
 
 /**
@@ -310,6 +512,86 @@ Curvature Manifold::GetCurvature() const {
   return GetCsgLeafNode().GetImpl()->GetCurvature();
 }
 
+/**
+ * Returns the bytes reserved by each buffer of this manifold, evaluating it
+ * first if needed. Buffers are shared copy-on-write between copies and
+ * transforms of a manifold, so summing this over several manifolds may
+ * overcount; the process-wide total is MemoryInUse().
+ */
+MemoryUsage Manifold::GetMemoryUsage() const {
+  return GetCsgLeafNode().GetMemoryUsage();
+}
+
+/**
+ * Returns the cross sections of this manifold at each of the given Z heights,
+ * in the same order. They are the same as the caps of TrimByPlane() at those
+ * heights would be, but all are found in a single pass over the faces. The
+ * polygons of each slice are oriented counter-clockwise (holes clockwise) when
+ * viewed from above, as Extrude() and Triangulate() expect, and the idx of
+ * each PolyVert is unique within its slice.
+ *
+ * @param heights The Z values at which to slice, in any order.
+ */
+std::vector<Polygons> Manifold::Slices(const std::vector<Real>& heights) const {
+  return GetCsgLeafNode().GetImpl()->Slices(heights);
+}
+
+/**
+ * Returns whether each point is inside the manifold, by its winding number.
+ * Points within floating-point error of the surface may go either way.
+ */
+std::vector<bool> Manifold::Contains(const std::vector<vec3>& points) const {
+  std::vector<int> winding(points.size());
+  GetCsgLeafNode().GetImpl()->Winding(points.data(), points.size(),
+                                      winding.data());
+  std::vector<bool> inside(points.size());
+  for (size_t i = 0; i < points.size(); ++i) inside[i] = winding[i] > 0;
+  return inside;
+}
+
+/**
+ * Returns the distance of each point to the surface, positive inside and
+ * negative outside, as LevelSet expects of its SDF.
+ *
+ * @param maxDistance Distances are clamped to within this value, which bounds
+ * the search for points far from the surface; pass the level set's grid
+ * spacing times a few when only the sign matters further away.
+ */
+std::vector<Real> Manifold::SignedDistance(const std::vector<vec3>& points,
+                                           Real maxDistance) const {
+  std::vector<Real> distances(points.size());
+  SignedDistance(points.data(), distances.data(), points.size(),
+                 maxDistance);
+  return distances;
+}
+
+/**
+ * The same as above, on the caller's arrays of n points and distances, so
+ * that it can be passed directly as the batch SDF of LevelSetTiled.
+ */
+void Manifold::SignedDistance(const vec3* points, Real* distances, int n,
+                              Real maxDistance) const {
+  GetCsgLeafNode().GetImpl()->SignedDistance(points, n, maxDistance,
+                                             distances);
+}
+
+/**
+ * Returns the nearest hit of each ray within maxDistance, with the corners of
+ * its triangle and of the original triangle it came from, see RayHit. Rays
+ * are given by their origins and matching nonzero directions; throws
+ * argumentErr if their lengths differ.
+ */
+std::vector<RayHit> Manifold::RayCast(const std::vector<vec3>& origins,
+                                      const std::vector<vec3>& directions,
+                                      Real maxDistance) const {
+  if (origins.size() != directions.size())
+    throw argumentErr("origins and directions must be the same length");
+  std::vector<RayHit> hits(origins.size());
+  GetCsgLeafNode().GetImpl()->RayCast(origins.data(), directions.data(),
+                                      origins.size(), maxDistance, hits.data());
+  return hits;
+}
+
 /**
  * Gets the relationship to the previous meshes, for the purpose of assigning
  * properties like texture coordinates. The triBary vector is the same length as
@@ -396,13 +678,10 @@ int Manifold::NumDegenerateTris() const {
  * @param other A Manifold to overlap with.
  */
 int Manifold::NumOverlaps(const Manifold& other) const {
-  SparseIndices overlaps = GetCsgLeafNode().GetImpl()->EdgeCollisions(
-      *other.GetCsgLeafNode().GetImpl());
-  int num_overlaps = overlaps.size();
-
-  overlaps = other.GetCsgLeafNode().GetImpl()->EdgeCollisions(
-      *GetCsgLeafNode().GetImpl());
-  return num_overlaps += overlaps.size();
+  const auto impl = GetCsgLeafNode().GetImpl();
+  const auto otherImpl = other.GetCsgLeafNode().GetImpl();
+  return impl->NumEdgeCollisions(*otherImpl) +
+         otherImpl->NumEdgeCollisions(*impl);
 }
 
 /**
@@ -411,7 +690,7 @@ int Manifold::NumOverlaps(const Manifold& other) const {
  *
  * @param v The vector to add to every vertex.
  */
-Manifold Manifold::Translate(glm::vec3 v) const {
+Manifold Manifold::Translate(vec3 v) const {
   return Manifold(pNode_->Translate(v));
 }
 
@@ -421,7 +700,7 @@ Manifold Manifold::Translate(glm::vec3 v) const {
  *
  * @param v The vector to multiply every vertex by per component.
  */
-Manifold Manifold::Scale(glm::vec3 v) const {
+Manifold Manifold::Scale(vec3 v) const {
   return Manifold(pNode_->Scale(v));
 }
 
@@ -437,8 +716,7 @@ Manifold Manifold::Scale(glm::vec3 v) const {
  * @param yDegrees Second rotation, degrees about the Y-axis.
  * @param zDegrees Third rotation, degrees about the Z-axis.
  */
-Manifold Manifold::Rotate(float xDegrees, float yDegrees,
-                          float zDegrees) const {
+Manifold Manifold::Rotate(Real xDegrees, Real yDegrees, Real zDegrees) const {
   return Manifold(pNode_->Rotate(xDegrees, yDegrees, zDegrees));
 }
 
@@ -449,7 +727,7 @@ Manifold Manifold::Rotate(float xDegrees, float yDegrees,
  *
  * @param m The affine transform matrix to apply to all the vertices.
  */
-Manifold Manifold::Transform(const glm::mat4x3& m) const {
+Manifold Manifold::Transform(const mat4x3& m) const {
   return Manifold(pNode_->Transform(m));
 }
 
@@ -462,10 +740,24 @@ Manifold Manifold::Transform(const glm::mat4x3& m) const {
  *
  * @param warpFunc A function that modifies a given vertex position.
  */
-Manifold Manifold::Warp(std::function<void(glm::vec3&)> warpFunc) const {
+Manifold Manifold::Warp(std::function<void(vec3&)> warpFunc) const {
+  return WarpVerts(
+      [&warpFunc](vec3* vertPos, int numVert) {
+        thrust::for_each_n(thrust::host, vertPos, numVert, warpFunc);
+      },
+      false);
+}
+
+/**
+ * The shared part of the Warp overloads: warpVerts moves the vertex positions
+ * of a copy of this manifold, which are on the device if onDevice, and the
+ * copy is then updated to match.
+ */
+Manifold Manifold::WarpVerts(std::function<void(vec3*, int)> warpVerts,
+                             bool onDevice) const {
   auto pImpl = std::make_shared<Impl>(*GetCsgLeafNode().GetImpl());
-  thrust::for_each_n(thrust::host, pImpl->vertPos_.begin(), NumVert(),
-                     warpFunc);
+  VecDH<vec3>& vertPos = pImpl->vertPos_;
+  warpVerts(onDevice ? vertPos.ptrD() : vertPos.ptrH(), vertPos.size());
   pImpl->Update();
   pImpl->faceNormal_.resize(0);  // force recalculation of triNormal
   pImpl->CalculateNormals();
@@ -489,6 +781,58 @@ Manifold Manifold::Refine(int n) const {
   return Manifold(std::make_shared<CsgLeafNode>(pImpl));
 }
 
+/**
+ * Increase the density of the mesh by splitting each edge into pieces of
+ * roughly the input length. Edges are split independently, rather than into
+ * the same number of pieces like Refine(), so long edges gain detail without
+ * multiplying the short ones. Interior verts are added to each triangle to
+ * match its longest edge, and with halfedgeTangents (e.g. from the Smooth()
+ * constructor) the new verts are moved to the interpolated surface, as in
+ * Refine().
+ *
+ * @param length The maximum length of the pieces of each edge, which is the
+ * length of the edge divided by its number of pieces.
+ */
+Manifold Manifold::RefineToLength(Real length) const {
+  auto pImpl = std::make_shared<Impl>(*GetCsgLeafNode().GetImpl());
+  pImpl->RefineToLength(length);
+  return Manifold(std::make_shared<CsgLeafNode>(pImpl));
+}
+
+/**
+ * Increase the density of a smooth mesh only as far as needed to follow its
+ * curvature: each edge is split into enough pieces that its curve, as given by
+ * the halfedgeTangents (e.g. from the Smooth() constructor), stays within
+ * precision of them. Flat areas stay coarse, while curved ones are refined
+ * like Refine(). A mesh without halfedgeTangents is already exact, so it is
+ * returned unchanged.
+ *
+ * @param precision The maximum distance allowed between the smooth edge curves
+ * and the straight pieces they are split into.
+ */
+Manifold Manifold::RefineToPrecision(Real precision) const {
+  auto pImpl = std::make_shared<Impl>(*GetCsgLeafNode().GetImpl());
+  pImpl->RefineToPrecision(precision);
+  return Manifold(std::make_shared<CsgLeafNode>(pImpl));
+}
+
+/**
+ * Reduce the number of triangles by collapsing edges wherever the surface is
+ * flat enough, the opposite of the Refine() family. Each vert stays where it
+ * was, while the triangles that replace the old ones stay within tolerance of
+ * their planes. The topology is preserved, as is the relation to the original
+ * meshes, though the barycentric coordinates of the moved corners may fall
+ * outside their original triangles. The halfedgeTangents are dropped.
+ *
+ * @param tolerance The maximum distance the surface may move. Use
+ * Precision() to only remove redundant verts, such as those along flat edges.
+ */
+Manifold Manifold::Simplify(Real tolerance) const {
+  auto pImpl = std::make_shared<Impl>(*GetCsgLeafNode().GetImpl());
+  pImpl->Simplify(tolerance);
+  return Manifold(std::make_shared<CsgLeafNode>(pImpl));
+}
+
 /**
  * The central operation of this library: the Boolean combines two manifolds
  * into another by calculating their intersections and removing the unused
@@ -520,6 +864,79 @@ Manifold Manifold::BatchBoolean(const std::vector<Manifold>& manifolds,
   return Manifold(std::make_shared<CsgOpNode>(children, op));
 }
 
+/**
+ * Evaluates many independent Booleans at once, returning the result of each
+ * job in order. This is meant for throughput on many small operands: a single
+ * Boolean of under a few thousand triangles is evaluated sequentially, so
+ * instead the jobs are evaluated concurrently across cores. The operands are
+ * evaluated first and may be shared freely between jobs. The results bypass
+ * the result cache.
+ *
+ * @param jobs The (first, second, op) of each Boolean, as in Boolean().
+ */
+std::vector<Manifold> Manifold::BooleanBatch(
+    const std::vector<std::tuple<Manifold, Manifold, OpType>>& jobs) {
+  const int numJob = jobs.size();
+  std::vector<const CsgLeafNode*> first(numJob);
+  std::vector<const CsgLeafNode*> second(numJob);
+  for (int i = 0; i < numJob; ++i) {
+    first[i] = &std::get<0>(jobs[i]).GetCsgLeafNode();
+    second[i] = &std::get<1>(jobs[i]).GetCsgLeafNode();
+  }
+
+  // CsgLeafNode::Boolean only reads its operands, so shared ones are fine.
+  // Exceptions, e.g. memoryErr, must not escape the parallel backend, so the
+  // first one in job order is rethrown after the loop.
+  std::vector<std::shared_ptr<CsgNode>> results(numJob);
+  std::vector<std::exception_ptr> errors(numJob);
+  for_each_n(numJob > 1 ? ExecutionPolicy::Par : ExecutionPolicy::Seq,
+             countAt(0), numJob, [&](int i) {
+               try {
+                 results[i] = CsgLeafNode::Boolean(*first[i], *second[i],
+                                                   std::get<2>(jobs[i]));
+               } catch (...) {
+                 errors[i] = std::current_exception();
+               }
+             });
+  for (const auto& error : errors) {
+    if (error) std::rethrow_exception(error);
+  }
+
+  std::vector<Manifold> out;
+  out.reserve(numJob);
+  for (auto& result : results) out.push_back(Manifold(result));
+  return out;
+}
+
+/**
+ * Starts evaluating the CSG tree of this manifold on a new thread and returns
+ * the resulting leaf manifold, which is cheap to query. Sibling subtrees of
+ * the tree are evaluated concurrently on the parallel backend. Evaluated
+ * subtrees are kept, so this manifold will not be evaluated again afterwards,
+ * but neither it nor others sharing its subtrees may be evaluated on another
+ * thread in the meantime.
+ *
+ * The progress callback is called as each op node is evaluated, from any of
+ * the worker threads, but never concurrently. If it returns false, no further
+ * Booleans are started and the future throws cancelErr; the subtrees already
+ * evaluated are kept.
+ *
+ * @param progress Optional callback of the number of op nodes done and total.
+ */
+std::future<Manifold> Manifold::EvaluateAsync(ProgressCallback progress) const {
+  std::shared_ptr<CsgNode> node = pNode_;
+  return std::async(std::launch::async, [node, progress]() {
+    EvalContext context;
+    context.progress = progress;
+    if (node->GetNodeType() != CsgNodeType::LEAF)
+      context.total = std::static_pointer_cast<CsgOpNode>(node)->NumPending();
+    std::shared_ptr<CsgNode> leaf = node->ToLeafNode(&context);
+    if (progress && context.done < context.total)
+      progress(context.total, context.total);
+    return Manifold(leaf);
+  });
+}
+
 /**
  * Shorthand for Boolean Union.
  */
@@ -593,9 +1010,10 @@ std::pair<Manifold, Manifold> Manifold::Split(const Manifold& cutter) const {
  * @param originOffset The distance of the plane from the origin in the
  * direction of the normal vector.
  */
-std::pair<Manifold, Manifold> Manifold::SplitByPlane(glm::vec3 normal,
-                                                     float originOffset) const {
-  return Split(Halfspace(BoundingBox(), normal, originOffset));
+std::pair<Manifold, Manifold> Manifold::SplitByPlane(vec3 normal,
+                                                     Real originOffset) const {
+  return std::make_pair(TrimByPlane(normal, originOffset),
+                        TrimByPlane(-normal, -originOffset));
 }
 
 /**
@@ -607,9 +1025,151 @@ std::pair<Manifold, Manifold> Manifold::SplitByPlane(glm::vec3 normal,
  * @param originOffset The distance of the plane from the origin in the
  * direction of the normal vector.
  */
-Manifold Manifold::TrimByPlane(glm::vec3 normal, float originOffset) const {
-  return *this ^ Halfspace(BoundingBox(), normal, originOffset);
+Manifold Manifold::TrimByPlane(vec3 normal, Real originOffset) const {
+  auto pImpl = std::make_shared<Impl>(
+      GetCsgLeafNode().GetImpl()->Trim(glm::normalize(normal), originOffset));
+  return Manifold(std::make_shared<CsgLeafNode>(pImpl));
+}
+
+/**
+ * Enable the process-wide cache of Boolean results by giving it a memory
+ * budget; zero (the default) disables and empties it. When enabled, the
+ * result of each evaluated CSG subtree is stored under a hash of its structure
+ * (op types, transforms and the content of its leaf meshes), so an identical
+ * subtree built separately later is not recomputed. The least recently used
+ * results are evicted to stay within budget.
+ *
+ * @param bytes The approximate memory budget for cached results.
+ */
+void Manifold::SetCacheBudget(size_t bytes) {
+  CsgCache::Get().SetBudget(bytes);
+}
+
+/**
+ * Returns the hit/miss counters and memory use of the Boolean result cache.
+ */
+CacheStats Manifold::GetCacheStats() { return CsgCache::Get().Stats(); }
+
+/**
+ * Drops all cached Boolean results and resets the counters, keeping the
+ * budget.
+ */
+void Manifold::ClearCache() { CsgCache::Get().Clear(); }
+
+/**
+ * For incremental re-evaluation with the result cache enabled: returns the
+ * indices of the operands of this Manifold's top-level operation that are not
+ * found in the cache, i.e. that changed since an otherwise identical tree was
+ * last evaluated. Evaluation reuses the cached partial results and only
+ * recomputes the branches (and union clusters) containing these. Nested
+ * operations of the same type are flattened into the top-level one first, so
+ * indices refer to that flattened list of operands. Returns an empty vector
+ * if this Manifold is already evaluated.
+ */
+std::vector<int> Manifold::ChangedChildren() const {
+  if (pNode_->GetNodeType() == CsgNodeType::LEAF) return {};
+  return std::static_pointer_cast<CsgOpNode>(pNode_)->ChangedChildren();
+}
+
+/**
+ * Returns a copy of this manifold in a compact form for keeping in memory
+ * while it is not in use. Only the mesh itself is stored: the normals and
+ * collision structure are dropped, and the halfedges are reduced to their
+ * start verts and pairs, two ints each instead of four. The bounding box,
+ * precision and any cached volume and surface area are kept.
+ *
+ * A compact manifold is used like any other and is expanded transparently by
+ * the operations that need its mesh: a Boolean, Compose or CSG tree expands
+ * it once per evaluation, while other queries expand a temporary copy. The
+ * returned manifold itself stays compact, so it keeps its small footprint
+ * however often it is used.
+ *
+ * IsEmpty(), Status(), NumVert(), NumEdge(), NumTri(), Genus(),
+ * GetMemoryUsage() and, unless a transform is pending, BoundingBox(),
+ * Precision() and cached GetProperties() are answered without expanding. With
+ * quantized positions the counts are those of the stored mesh, before any
+ * triangles that collapse on expansion are removed.
+ *
+ * @param positionBits If nonzero, from 1 to 21, the vertex positions are also
+ * quantized to a grid of this many bits per axis over the bounding box,
+ * packed into 8 bytes per vertex. This is lossy: on expansion the precision
+ * is raised to the grid spacing and triangles that collapse are removed.
+ * Other values throw argumentErr.
+ */
+Manifold Manifold::Compact(int positionBits) const {
+  if (positionBits < 0 || positionBits > 21)
+    throw argumentErr("positionBits must be in [0, 21].");
+  const CsgLeafNode& leaf = GetCsgLeafNode();
+  if (leaf.IsCompact() || IsEmpty()) return *this;
+  return Manifold(
+      std::make_shared<Impl>(leaf.GetImpl()->Compact(positionBits)));
+}
+
+/**
+ * Whether this manifold is held in the compact form of Compact().
+ */
+bool Manifold::IsCompact() const { return GetCsgLeafNode().IsCompact(); }
+
+/**
+ * Returns the stats of the Boolean operations that produced this manifold,
+ * summed over them and over those of its operands, which were evaluated
+ * earlier or as part of this tree. Unlike GetBooleanStats(), this tells apart
+ * operations run concurrently. A result reused from the cache reports the
+ * operations that first computed it. All zero if no Boolean produced this
+ * manifold. This evaluates the manifold.
+ */
+BooleanStats Manifold::GetResultStats() const {
+  const auto impl = GetCsgLeafNode().GetStoredImpl();
+  return impl->booleanStats_ == nullptr ? BooleanStats()
+                                        : *impl->booleanStats_;
 }
 
+/**
+ * Returns per-phase timings, sparse index sizes and allocation counts summed
+ * over all Boolean operations since the last ResetBooleanStats(). Since
+ * evaluation is lazy, reset before and read after forcing the result, e.g.
+ * with NumTri().
+ */
+BooleanStats Manifold::GetBooleanStats() { return manifold::GetBooleanStats(); }
+
+/**
+ * Zeroes the process-wide Boolean instrumentation counters.
+ */
+void Manifold::ResetBooleanStats() { manifold::ResetBooleanStats(); }
+
+/**
+ * Starts recording a process-wide timeline of the evaluation: a span for each
+ * CSG op node, Compose, pair of a batched Boolean, Boolean3 and its result,
+ * Finish and Refine, with the mesh sizes as arguments and the thread that ran
+ * it. Any earlier recording is discarded. Spans cost a clock read and a lock
+ * while tracing, and nothing measurable otherwise.
+ */
+void Manifold::StartTrace() { manifold::StartTrace(); }
+
+/**
+ * Stops recording and returns the spans since StartTrace() as Chrome
+ * trace-event JSON, which can be saved to a file and opened in Perfetto or
+ * chrome://tracing. Spans still open are dropped.
+ */
+std::string Manifold::StopTrace() { return manifold::StopTrace(); }
+
+/**
+ * Enables the robust mode of the Boolean's intersection kernels, process-wide.
+ * The interpolated coordinates that the symbolic perturbation compares are
+ * still computed in float, but the rare comparisons too close to call within
+ * float's rounding error are re-evaluated in double. This makes near-
+ * degenerate inputs much less likely to produce non-manifold results, at a
+ * small cost only where such cases occur. Off by default.
+ */
+void Manifold::SetRobustPredicates(bool enable) {
+  manifold::SetRobustPredicates(enable);
+}
+
+/**
+ * Whether the robust mode of the Boolean is enabled, see
+ * SetRobustPredicates().
+ */
+bool Manifold::RobustPredicates() { return manifold::RobustPredicates(); }
+
 ExecutionParams& ManifoldParams() { return params; }
 }  // namespace manifold
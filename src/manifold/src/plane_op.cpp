@@ -0,0 +1,502 @@
+// Copyright 2022 The Manifold Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+
+#include "impl.h"
+#include "par.h"
+
+namespace {
+using namespace manifold;
+
+struct SignedDistance {
+  const vec3 normal;
+  const Real originOffset;
+
+  __host__ __device__ Real operator()(vec3 pos) {
+    return glm::dot(normal, pos) - originOffset;
+  }
+};
+
+// Verts strictly in front of the plane are kept, so that exactly one of a
+// pair of opposite planes keeps any given vert.
+struct KeepVert {
+  __host__ __device__ int operator()(Real dist) { return dist > 0; }
+};
+
+struct CutEdge {
+  HalfedgeCPtr halfedge;
+  const Real* dist;
+
+  __host__ __device__ int operator()(int edge) {
+    const Halfedge h = halfedge[edge];
+    return h.IsForward() && (dist[h.startVert] > 0) != (dist[h.endVert] > 0);
+  }
+};
+
+// Gives both halfedges of each cut edge the index of its new vert, which is
+// placed by the forward one, or -1 if it is not cut.
+struct CutVert {
+  vec3* cutPos;
+  int* halfedgeCut;
+  HalfedgeCPtr halfedge;
+  const vec3* vertPos;
+  const Real* dist;
+  const int* isCut;
+  const int* cutIdx;
+
+  __host__ __device__ void operator()(int edge) {
+    const Halfedge h = halfedge[edge];
+    const int forward = h.IsForward() ? edge : h.pairedHalfedge;
+    if (!isCut[forward]) {
+      halfedgeCut[edge] = -1;
+      return;
+    }
+    const int cut = cutIdx[forward];
+    halfedgeCut[edge] = cut;
+    if (edge != forward) return;
+    const Real d0 = dist[h.startVert];
+    const Real t = d0 / (d0 - dist[h.endVert]);
+    cutPos[cut] = glm::mix(vertPos[h.startVert], vertPos[h.endVert], t);
+  }
+};
+
+struct GatherKept {
+  vec3* outPos;
+  const vec3* vertPos;
+  const Real* dist;
+  const int* vertOld2New;
+
+  __host__ __device__ void operator()(int vert) {
+    if (dist[vert] > 0) outPos[vertOld2New[vert]] = vertPos[vert];
+  }
+};
+
+// The number of output faces, cut faces and output halfedges of each face: a
+// cut face leaves a triangle or a quad, plus one edge of the cap.
+struct CountFace {
+  int* keptFace;
+  int* cutFace;
+  int* faceEdges;
+  HalfedgeCPtr halfedge;
+  const Real* dist;
+
+  __host__ __device__ void operator()(int face) {
+    int numKept = 0;
+    for (int i : {0, 1, 2})
+      if (dist[halfedge[3 * face + i].startVert] > 0) ++numKept;
+    keptFace[face] = numKept > 0;
+    cutFace[face] = numKept > 0 && numKept < 3;
+    faceEdges[face] = numKept == 0 ? 0 : numKept == 2 ? 4 : 3;
+  }
+};
+
+struct CutFace {
+  HalfedgePtr outHalfedge;
+  int* halfedgeBary;
+  int* faceEdge;
+  BaryRef* faceRef;
+  vec3* faceNormal;
+  vec3* barycentric;
+  HalfedgeCPtr halfedge;
+  const BaryRef* triBary;
+  const vec3* triNormal;
+  const vec3* cutPos;
+  const Real* dist;
+  const int* vertOld2New;
+  const int* halfedgeCut;
+  const int* keptIdx;
+  const int* cutIdx;
+  const int* edgeIdx;
+  const int numKeptVert;
+  const int baryStart;
+  const int capFace;
+  const int capEdge;
+  const int capBaryStart;
+  const mat3x2 capProjection;
+
+  __host__ __device__ void operator()(int face) {
+    bool kept[3];
+    for (int i : {0, 1, 2})
+      kept[i] = dist[halfedge[3 * face + i].startVert] > 0;
+    if (!kept[0] && !kept[1] && !kept[2]) return;
+
+    const int newFace = keptIdx[face];
+    const BaryRef ref = triBary[face];
+    faceRef[newFace] = ref;
+    faceNormal[newFace] = triNormal[face];
+    faceEdge[newFace] = edgeIdx[face];
+
+    // Walk the triangle, keeping the verts in front and adding a new vert for
+    // each cut edge, with its barycentric interpolated along the edge.
+    int verts[4];
+    int bary[4];
+    int numVert = 0;
+    int nextBary = baryStart + 2 * cutIdx[face];
+    for (int i : {0, 1, 2}) {
+      const Halfedge h = halfedge[3 * face + i];
+      if (kept[i]) {
+        verts[numVert] = vertOld2New[h.startVert];
+        bary[numVert++] = ref.vertBary[i];
+      }
+      const int cut = halfedgeCut[3 * face + i];
+      if (cut < 0) continue;
+      const Real d0 = dist[h.startVert];
+      const Real t = d0 / (d0 - dist[h.endVert]);
+      barycentric[nextBary] =
+          (1 - t) * UVW(ref.vertBary[i], barycentric) +
+          t * UVW(ref.vertBary[(i + 1) % 3], barycentric);
+      verts[numVert] = numKeptVert + cut;
+      bary[numVert++] = nextBary++;
+    }
+
+    const int firstEdge = edgeIdx[face];
+    for (int j = 0; j < numVert; ++j) {
+      const int next = j + 1 == numVert ? 0 : j + 1;
+      outHalfedge.Set(firstEdge + j, {verts[j], verts[next], -1, newFace});
+      halfedgeBary[firstEdge + j] = bary[j];
+      // The edge between the two new verts lies in the plane, so its reverse
+      // is an edge of the cap.
+      if (verts[j] < numKeptVert || verts[next] < numKeptVert) continue;
+      const int cap = cutIdx[face];
+      outHalfedge.Set(capEdge + cap, {verts[next], verts[j], -1, capFace});
+      halfedgeBary[capEdge + cap] = capBaryStart + cap;
+      const vec2 uv = capProjection * cutPos[verts[next] - numKeptVert];
+      barycentric[capBaryStart + cap] = vec3(1 - uv.x - uv.y, uv.x, uv.y);
+    }
+  }
+};
+
+// A piece of the cross section of a face at one height, directed so that the
+// material is on its left when viewed from above. Each end is identified by
+// the forward halfedge of the edge it lies on.
+struct Segment {
+  vec2 start;
+  int layer;
+  int startEdge;
+  int endEdge;
+};
+
+__host__ __device__ int FirstAtOrAbove(const Real* heights, int numHeight,
+                                       Real z) {
+  int start = 0;
+  int end = numHeight;
+  while (start < end) {
+    const int mid = (start + end) / 2;
+    if (heights[mid] < z)
+      start = mid + 1;
+    else
+      end = mid;
+  }
+  return start;
+}
+
+// A face crosses every height from its lowest vert up to, but not including,
+// its highest one, as verts exactly at a height count as below it.
+struct FaceLayers {
+  HalfedgeCPtr halfedge;
+  const vec3* vertPos;
+  const Real* heights;
+  const int numHeight;
+
+  __host__ __device__ thrust::pair<int, int> operator()(int face) {
+    Real zMin = vertPos[halfedge[3 * face].startVert].z;
+    Real zMax = zMin;
+    for (int i : {1, 2}) {
+      const Real z = vertPos[halfedge[3 * face + i].startVert].z;
+      zMin = glm::min(zMin, z);
+      zMax = glm::max(zMax, z);
+    }
+    return thrust::make_pair(FirstAtOrAbove(heights, numHeight, zMin),
+                             FirstAtOrAbove(heights, numHeight, zMax));
+  }
+};
+
+struct NumLayers {
+  __host__ __device__ int operator()(thrust::pair<int, int> layers) {
+    return layers.second - layers.first;
+  }
+};
+
+struct FaceSegments {
+  Segment* segments;
+  HalfedgeCPtr halfedge;
+  const vec3* vertPos;
+  const Real* heights;
+  const thrust::pair<int, int>* faceLayers;
+  const int* segmentStart;
+
+  __host__ __device__ void operator()(int face) {
+    int next = segmentStart[face];
+    for (int layer = faceLayers[face].first; layer < faceLayers[face].second;
+         ++layer) {
+      const Real height = heights[layer];
+      Segment& segment = segments[next++];
+      segment.layer = layer;
+      for (int i : {0, 1, 2}) {
+        const int edge = 3 * face + i;
+        const Halfedge h = halfedge[edge];
+        const bool startAbove = vertPos[h.startVert].z > height;
+        if (startAbove == (vertPos[h.endVert].z > height)) continue;
+        // Interpolate along the forward halfedge, so that both faces of this
+        // edge find exactly the same point.
+        const int forward = h.IsForward() ? edge : h.pairedHalfedge;
+        if (startAbove) {
+          const vec3 p0 = vertPos[halfedge[forward].startVert];
+          const vec3 p1 = vertPos[halfedge[forward].endVert];
+          const Real t = (height - p0.z) / (p1.z - p0.z);
+          const vec3 pos = glm::mix(p0, p1, t);
+          segment.start = vec2(pos.x, pos.y);
+          segment.startEdge = forward;
+        } else {
+          segment.endEdge = forward;
+        }
+      }
+    }
+  }
+};
+
+struct SegmentKey {
+  __host__ __device__ uint64_t operator()(const Segment& segment) {
+    return (static_cast<uint64_t>(segment.layer) << 32) | segment.startEdge;
+  }
+};
+
+struct NextKey {
+  __host__ __device__ uint64_t operator()(const Segment& segment) {
+    return (static_cast<uint64_t>(segment.layer) << 32) | segment.endEdge;
+  }
+};
+
+struct LayerKey {
+  __host__ __device__ uint64_t operator()(int layer) {
+    return static_cast<uint64_t>(layer) << 32;
+  }
+};
+}  // namespace
+
+namespace manifold {
+
+/**
+ * Returns the part of this manifold in front of the plane at originOffset
+ * along the (unit) normal, closed by a planar cap. Rather than a Boolean with
+ * a half-space, the verts are classified by signed distance, only the faces
+ * that straddle the plane are cut, and their new edges in the plane are
+ * triangulated as a single face to form the cap. The cut faces keep their
+ * mesh relation, with interpolated barycentric coordinates, while the cap is a
+ * new original mesh, whose barycentric coordinates are its projected
+ * positions.
+ */
+Manifold::Impl Manifold::Impl::Trim(vec3 normal, Real originOffset) const {
+  const int numVert = NumVert();
+  const int numTri = NumTri();
+  const int numHalfedge = halfedge_.size();
+  auto policy = autoPolicy(numHalfedge);
+
+  VecDH<Real> dist(numVert);
+  transform(policy, vertPos_.begin(), vertPos_.end(), dist.begin(),
+            SignedDistance({normal, originOffset}));
+
+  VecDH<int> keptFace(numTri);
+  VecDH<int> cutFace(numTri);
+  VecDH<int> faceEdges(numTri);
+  for_each_n(policy, countAt(0), numTri,
+             CountFace({keptFace.ptrD(), cutFace.ptrD(), faceEdges.ptrD(),
+                        halfedge_.cptrD(), dist.cptrD()}));
+  const int numKeptFace =
+      reduce<int>(policy, keptFace.begin(), keptFace.end());
+  const int numCutFace = reduce<int>(policy, cutFace.begin(), cutFace.end());
+  if (numCutFace == 0 && numKeptFace == 0) return Impl();
+  if (numCutFace == 0 && numKeptFace == numTri) return *this;
+
+  VecDH<int> vertOld2New(numVert);
+  transform(policy, dist.begin(), dist.end(), vertOld2New.begin(),
+            KeepVert());
+  const int numKeptVert =
+      reduce<int>(policy, vertOld2New.begin(), vertOld2New.end());
+  exclusive_scan(policy, vertOld2New.begin(), vertOld2New.end(),
+                 vertOld2New.begin());
+
+  if (numCutFace == 0) {
+    // Nothing is cut, but whole components lie on each side of the plane, so
+    // those in front are kept as they are, without a cap.
+    VecDH<int> faceNew2Old(numKeptFace);
+    copy_if<decltype(faceNew2Old.begin())>(
+        policy, countAt(0), countAt(numTri), keptFace.begin(),
+        faceNew2Old.begin(), thrust::identity<int>());
+    exclusive_scan(policy, keptFace.begin(), keptFace.end(), keptFace.begin());
+
+    Impl outR;
+    outR.precision_ = precision_;
+    outR.vertPos_.resize(numKeptVert);
+    for_each_n(policy, countAt(0), numVert,
+               GatherKept({outR.vertPos_.ptrD(), vertPos_.cptrD(),
+                           dist.cptrD(), vertOld2New.cptrD()}));
+    outR.GatherFaces(*this, faceNew2Old, keptFace, vertOld2New);
+    outR.Finish();
+    return outR;
+  }
+
+  VecDH<int> isCut(numHalfedge);
+  transform(policy, countAt(0), countAt(numHalfedge), isCut.begin(),
+            CutEdge({halfedge_.cptrD(), dist.cptrD()}));
+  const int numCut = reduce<int>(policy, isCut.begin(), isCut.end());
+  VecDH<int> cutIdx(numHalfedge);
+  exclusive_scan(policy, isCut.begin(), isCut.end(), cutIdx.begin());
+  VecDH<vec3> cutPos(numCut);
+  VecDH<int> halfedgeCut(numHalfedge);
+  for_each_n(policy, countAt(0), numHalfedge,
+             CutVert({cutPos.ptrD(), halfedgeCut.ptrD(), halfedge_.cptrD(),
+                      vertPos_.cptrD(), dist.cptrD(), isCut.cptrD(),
+                      cutIdx.cptrD()}));
+
+  Impl outR;
+  outR.precision_ = precision_;
+  outR.vertPos_.resize(numKeptVert + numCut);
+  for_each_n(policy, countAt(0), numVert,
+             GatherKept({outR.vertPos_.ptrD(), vertPos_.cptrD(), dist.cptrD(),
+                         vertOld2New.cptrD()}));
+  copy(policy, cutPos.begin(), cutPos.end(),
+       outR.vertPos_.begin() + numKeptVert);
+
+  const int numPolyEdge =
+      reduce<int>(policy, faceEdges.begin(), faceEdges.end());
+  exclusive_scan(policy, keptFace.begin(), keptFace.end(), keptFace.begin());
+  exclusive_scan(policy, cutFace.begin(), cutFace.end(), cutFace.begin());
+  exclusive_scan(policy, faceEdges.begin(), faceEdges.end(),
+                 faceEdges.begin());
+
+  // The cap is one more face, made of one edge per cut face.
+  const int numFace = numKeptFace + 1;
+  VecDH<int> faceEdge(numFace + 1);
+  VecDH<BaryRef> faceRef(numFace);
+  VecDH<int> halfedgeBary(numPolyEdge + numCutFace);
+  outR.halfedge_.resize(numPolyEdge + numCutFace);
+  outR.faceNormal_.resize(numFace);
+  const int baryStart = meshRelation_.barycentric.size();
+  const int capBaryStart = baryStart + 2 * numCutFace;
+  outR.meshRelation_.barycentric = meshRelation_.barycentric;
+  outR.meshRelation_.barycentric.resize(capBaryStart + numCutFace);
+
+  for_each_n(
+      policy, countAt(0), numTri,
+      CutFace({outR.halfedge_.ptrD(), halfedgeBary.ptrD(), faceEdge.ptrD(),
+               faceRef.ptrD(), outR.faceNormal_.ptrD(),
+               outR.meshRelation_.barycentric.ptrD(), halfedge_.cptrD(),
+               meshRelation_.triBary.cptrD(), faceNormal_.cptrD(),
+               cutPos.cptrD(), dist.cptrD(), vertOld2New.cptrD(),
+               halfedgeCut.cptrD(), keptFace.cptrD(), cutFace.cptrD(),
+               faceEdges.cptrD(), numKeptVert, baryStart, numKeptFace,
+               numPolyEdge, capBaryStart, GetAxisAlignedProjection(normal)}));
+
+  const int capID = meshIDCounter_.fetch_add(1, std::memory_order_relaxed);
+  faceEdge[numKeptFace] = numPolyEdge;
+  faceEdge[numFace] = numPolyEdge + numCutFace;
+  faceRef[numKeptFace] = {capID, capID, 0, {-3, -2, -1}};
+  outR.faceNormal_[numKeptFace] = -normal;
+
+  outR.Face2Tri(faceEdge, faceRef, halfedgeBary);
+  outR.SimplifyTopology();
+  outR.IncrementMeshIDs(0, outR.NumTri());
+  outR.Finish();
+  return outR;
+}
+/**
+ * Returns the cross sections of this manifold at each of the given heights
+ * along Z, all found in one pass over the faces: each face finds the range of
+ * sorted heights it spans by binary search and emits a segment for each. The
+ * segments are then linked into loops through the edges they share, which is
+ * exact, as both faces of an edge interpolate the same point.
+ */
+std::vector<Polygons> Manifold::Impl::Slices(
+    const std::vector<Real>& heights) const {
+  const int numHeight = heights.size();
+  std::vector<Polygons> slices(numHeight);
+  if (IsEmpty() || numHeight == 0) return slices;
+  const int numTri = NumTri();
+  auto policy = autoPolicy(numTri);
+
+  VecDH<Real> sortedHeight(heights);
+  VecDH<int> layer2height(numHeight);
+  sequence(policy, layer2height.begin(), layer2height.end());
+  stable_sort_by_key(policy, sortedHeight.begin(), sortedHeight.end(),
+                     layer2height.begin());
+
+  VecDH<thrust::pair<int, int>> faceLayers(numTri);
+  transform(policy, countAt(0), countAt(numTri), faceLayers.begin(),
+            FaceLayers({halfedge_.cptrD(), vertPos_.cptrD(),
+                        sortedHeight.cptrD(), numHeight}));
+  VecDH<int> segmentStart(numTri + 1, 0);
+  transform(policy, faceLayers.begin(), faceLayers.end(), segmentStart.begin(),
+            NumLayers());
+  exclusive_scan(policy, segmentStart.begin(), segmentStart.end(),
+                 segmentStart.begin());
+  const int numSegment = segmentStart[numTri];
+  if (numSegment == 0) return slices;
+
+  VecDH<Segment> segments(numSegment);
+  for_each_n(policy, countAt(0), numTri,
+             FaceSegments({segments.ptrD(), halfedge_.cptrD(),
+                           vertPos_.cptrD(), sortedHeight.cptrD(),
+                           faceLayers.cptrD(), segmentStart.cptrD()}));
+
+  // Sort by layer, then by the edge each segment starts on, so that the next
+  // segment of each loop can be found by binary search.
+  policy = autoPolicy(numSegment);
+  VecDH<uint64_t> key(numSegment);
+  transform(policy, segments.begin(), segments.end(), key.begin(),
+            SegmentKey());
+  sort_by_key(policy, key.begin(), key.end(), segments.begin());
+  VecDH<uint64_t> nextKey(numSegment);
+  transform(policy, segments.begin(), segments.end(), nextKey.begin(),
+            NextKey());
+  VecDH<int> next(numSegment);
+  lower_bound(policy, key.begin(), key.end(), nextKey.begin(), nextKey.end(),
+              next.begin());
+  VecDH<uint64_t> layerKey(numHeight + 1);
+  transform(policy, countAt(0), countAt(numHeight + 1), layerKey.begin(),
+            LayerKey());
+  VecDH<int> layerStart(numHeight + 1);
+  lower_bound(policy, key.begin(), key.end(), layerKey.begin(),
+              layerKey.end(), layerStart.begin());
+
+  // Walking the loops is host code; each layer is independent.
+  const Segment* segmentH = segments.cptrH();
+  const int* nextH = next.cptrH();
+  const int* layerStartH = layerStart.cptrH();
+  const int* layer2heightH = layer2height.cptrH();
+  VecDH<char> visited(numSegment, 0);
+  char* visitedH = visited.ptrH();
+  for_each_n(autoPolicy(numHeight) == Seq ? Seq : Par, countAt(0), numHeight,
+             [&](int layer) {
+               Polygons& polys = slices[layer2heightH[layer]];
+               const int start = layerStartH[layer];
+               const int end = layerStartH[layer + 1];
+               int idx = 0;
+               for (int first = start; first < end; ++first) {
+                 if (visitedH[first]) continue;
+                 polys.push_back({});
+                 int current = first;
+                 // A loop only stays open if the mesh is not manifold.
+                 while (current >= start && current < end &&
+                        !visitedH[current]) {
+                   visitedH[current] = 1;
+                   polys.back().push_back({segmentH[current].start, idx++});
+                   current = nextH[current];
+                 }
+               }
+             });
+  return slices;
+}
+}  // namespace manifold
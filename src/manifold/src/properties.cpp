@@ -25,42 +25,40 @@ namespace {
 using namespace manifold;
 
 struct FaceAreaVolume {
-  const Halfedge* halfedges;
-  const glm::vec3* vertPos;
-  const float precision;
+  HalfedgeCPtr halfedges;
+  const vec3* vertPos;
+  const Real precision;
 
-  __host__ __device__ thrust::pair<float, float> operator()(int face) {
-    float perimeter = 0;
-    glm::vec3 edge[3];
+  __host__ __device__ thrust::pair<Real, Real> operator()(int face) {
+    Real perimeter = 0;
+    vec3 edge[3];
     for (int i : {0, 1, 2}) {
       const int j = (i + 1) % 3;
       edge[i] = vertPos[halfedges[3 * face + j].startVert] -
                 vertPos[halfedges[3 * face + i].startVert];
       perimeter += glm::length(edge[i]);
     }
-    glm::vec3 crossP = glm::cross(edge[0], edge[1]);
+    vec3 crossP = glm::cross(edge[0], edge[1]);
 
-    float area = glm::length(crossP);
-    float volume = glm::dot(crossP, vertPos[halfedges[3 * face].startVert]);
+    Real area = glm::length(crossP);
+    Real volume = glm::dot(crossP, vertPos[halfedges[3 * face].startVert]);
 
     return area > perimeter * precision
-               ? thrust::make_pair(area / 2.0f, volume / 6.0f)
-               : thrust::make_pair(0.0f, 0.0f);
+               ? thrust::make_pair(area / 2, volume / 6)
+               : thrust::make_pair(Real(0), Real(0));
   }
 };
 
-struct PosMin
-    : public thrust::binary_function<glm::vec3, glm::vec3, glm::vec3> {
-  __host__ __device__ glm::vec3 operator()(glm::vec3 a, glm::vec3 b) {
+struct PosMin : public thrust::binary_function<vec3, vec3, vec3> {
+  __host__ __device__ vec3 operator()(vec3 a, vec3 b) {
     if (isnan(a.x)) return b;
     if (isnan(b.x)) return a;
     return glm::min(a, b);
   }
 };
 
-struct PosMax
-    : public thrust::binary_function<glm::vec3, glm::vec3, glm::vec3> {
-  __host__ __device__ glm::vec3 operator()(glm::vec3 a, glm::vec3 b) {
+struct PosMax : public thrust::binary_function<vec3, vec3, vec3> {
+  __host__ __device__ vec3 operator()(vec3 a, vec3 b) {
     if (isnan(a.x)) return b;
     if (isnan(b.x)) return a;
     return glm::max(a, b);
@@ -68,7 +66,7 @@ struct PosMax
 };
 
 struct FiniteVert {
-  __host__ __device__ bool operator()(glm::vec3 v) {
+  __host__ __device__ bool operator()(vec3 v) {
     return glm::all(glm::isfinite(v));
   }
 };
@@ -89,11 +87,11 @@ struct MinMax
   }
 };
 
-struct SumPair : public thrust::binary_function<thrust::pair<float, float>,
-                                                thrust::pair<float, float>,
-                                                thrust::pair<float, float>> {
-  __host__ __device__ thrust::pair<float, float> operator()(
-      thrust::pair<float, float> a, thrust::pair<float, float> b) {
+struct SumPair : public thrust::binary_function<thrust::pair<Real, Real>,
+                                                thrust::pair<Real, Real>,
+                                                thrust::pair<Real, Real>> {
+  __host__ __device__ thrust::pair<Real, Real> operator()(
+      thrust::pair<Real, Real> a, thrust::pair<Real, Real> b) {
     a.first += b.first;
     a.second += b.second;
     return a;
@@ -101,17 +99,17 @@ struct SumPair : public thrust::binary_function<thrust::pair<float, float>,
 };
 
 struct CurvatureAngles {
-  float* meanCurvature;
-  float* gaussianCurvature;
-  float* area;
-  float* degree;
-  const Halfedge* halfedge;
-  const glm::vec3* vertPos;
-  const glm::vec3* triNormal;
+  Real* meanCurvature;
+  Real* gaussianCurvature;
+  Real* area;
+  Real* degree;
+  HalfedgeCPtr halfedge;
+  const vec3* vertPos;
+  const vec3* triNormal;
 
   __host__ __device__ void operator()(int tri) {
-    glm::vec3 edge[3];
-    glm::vec3 edgeLength(0.0);
+    vec3 edge[3];
+    vec3 edgeLength(0.0);
     for (int i : {0, 1, 2}) {
       const int startVert = halfedge[3 * tri + i].startVert;
       const int endVert = halfedge[3 * tri + i].endVert;
@@ -119,20 +117,20 @@ struct CurvatureAngles {
       edgeLength[i] = glm::length(edge[i]);
       edge[i] /= edgeLength[i];
       const int neighborTri = halfedge[3 * tri + i].pairedHalfedge / 3;
-      const float dihedral =
+      const Real dihedral =
           0.25 * edgeLength[i] *
           glm::asin(glm::dot(glm::cross(triNormal[tri], triNormal[neighborTri]),
                              edge[i]));
       AtomicAdd(meanCurvature[startVert], dihedral);
       AtomicAdd(meanCurvature[endVert], dihedral);
-      AtomicAdd(degree[startVert], 1.0f);
+      AtomicAdd(degree[startVert], Real(1));
     }
 
-    glm::vec3 phi;
+    vec3 phi;
     phi[0] = glm::acos(-glm::dot(edge[2], edge[0]));
     phi[1] = glm::acos(-glm::dot(edge[0], edge[1]));
-    phi[2] = glm::pi<float>() - phi[0] - phi[1];
-    const float area3 = edgeLength[0] * edgeLength[1] *
+    phi[2] = glm::pi<Real>() - phi[0] - phi[1];
+    const Real area3 = edgeLength[0] * edgeLength[1] *
                         glm::length(glm::cross(edge[0], edge[1])) / 6;
 
     for (int i : {0, 1, 2}) {
@@ -145,19 +143,19 @@ struct CurvatureAngles {
 
 struct NormalizeCurvature {
   __host__ __device__ void operator()(
-      thrust::tuple<float&, float&, float, float> inOut) {
-    float& meanCurvature = thrust::get<0>(inOut);
-    float& gaussianCurvature = thrust::get<1>(inOut);
-    float area = thrust::get<2>(inOut);
-    float degree = thrust::get<3>(inOut);
-    float factor = degree / (6 * area);
+      thrust::tuple<Real&, Real&, Real, Real> inOut) {
+    Real& meanCurvature = thrust::get<0>(inOut);
+    Real& gaussianCurvature = thrust::get<1>(inOut);
+    Real area = thrust::get<2>(inOut);
+    Real degree = thrust::get<3>(inOut);
+    Real factor = degree / (6 * area);
     meanCurvature *= factor;
     gaussianCurvature *= factor;
   }
 };
 
 struct CheckManifold {
-  const Halfedge* halfedges;
+  HalfedgeCPtr halfedges;
 
   __host__ __device__ bool operator()(int edge) {
     const Halfedge halfedge = halfedges[edge];
@@ -176,7 +174,7 @@ struct CheckManifold {
 };
 
 struct NoDuplicates {
-  const Halfedge* halfedges;
+  HalfedgeCPtr halfedges;
 
   __host__ __device__ bool operator()(int edge) {
     const Halfedge halfedge = halfedges[edge];
@@ -189,16 +187,16 @@ struct NoDuplicates {
 };
 
 struct CheckCCW {
-  const Halfedge* halfedges;
-  const glm::vec3* vertPos;
-  const glm::vec3* triNormal;
-  const float tol;
+  HalfedgeCPtr halfedges;
+  const vec3* vertPos;
+  const vec3* triNormal;
+  const Real tol;
 
   __host__ __device__ bool operator()(int face) {
     if (halfedges[3 * face].pairedHalfedge < 0) return true;
 
-    const glm::mat3x2 projection = GetAxisAlignedProjection(triNormal[face]);
-    glm::vec2 v[3];
+    const mat3x2 projection = GetAxisAlignedProjection(triNormal[face]);
+    vec2 v[3];
     for (int i : {0, 1, 2})
       v[i] = projection * vertPos[halfedges[3 * face + i].startVert];
 
@@ -207,15 +205,15 @@ struct CheckCCW {
 
 #ifdef MANIFOLD_DEBUG
     if (tol > 0 && !check) {
-      glm::vec2 v1 = v[1] - v[0];
-      glm::vec2 v2 = v[2] - v[0];
-      float area = v1.x * v2.y - v1.y * v2.x;
-      float base2 = glm::max(glm::dot(v1, v1), glm::dot(v2, v2));
-      float base = glm::sqrt(base2);
-      glm::vec3 V0 = vertPos[halfedges[3 * face].startVert];
-      glm::vec3 V1 = vertPos[halfedges[3 * face + 1].startVert];
-      glm::vec3 V2 = vertPos[halfedges[3 * face + 2].startVert];
-      glm::vec3 norm = glm::cross(V1 - V0, V2 - V0);
+      vec2 v1 = v[1] - v[0];
+      vec2 v2 = v[2] - v[0];
+      Real area = v1.x * v2.y - v1.y * v2.x;
+      Real base2 = glm::max(glm::dot(v1, v1), glm::dot(v2, v2));
+      Real base = glm::sqrt(base2);
+      vec3 V0 = vertPos[halfedges[3 * face].startVert];
+      vec3 V1 = vertPos[halfedges[3 * face + 1].startVert];
+      vec3 V2 = vertPos[halfedges[3 * face + 2].startVert];
+      vec3 norm = glm::cross(V1 - V0, V2 - V0);
       printf(
           "Tri %d does not match normal, approx height = %g, base = %g\n"
           "tol = %g, area2 = %g, base2*tol2 = %g\n"
@@ -256,8 +254,12 @@ bool Manifold::Impl::Is2Manifold() const {
 
   if (!IsManifold()) return false;
 
-  VecDH<Halfedge> halfedge(halfedge_);
-  sort(policy, halfedge.begin(), halfedge.end());
+  HalfedgeVec halfedge(halfedge_);
+  sort(policy,
+       zip(halfedge.startVert.begin(), halfedge.endVert.begin(),
+           halfedge.pairedHalfedge.begin()),
+       zip(halfedge.startVert.end(), halfedge.endVert.end(),
+           halfedge.pairedHalfedge.end()));
 
   return all_of(policy, countAt(0), countAt(2 * NumEdge() - 1),
                 NoDuplicates({halfedge.cptrD()}));
@@ -283,22 +285,60 @@ int Manifold::Impl::NumDegenerateTris() const {
                             faceNormal_.cptrD(), -1 * precision_ / 2}));
 }
 
+/**
+ * The surface area and volume, reduced over the faces on the first call and
+ * cached from then on.
+ */
 Properties Manifold::Impl::GetProperties() const {
   if (IsEmpty()) return {0, 0};
-  auto areaVolume = transform_reduce<thrust::pair<float, float>>(
+  Properties properties;
+  if (properties_.Get(properties)) return properties;
+  auto areaVolume = transform_reduce<thrust::pair<Real, Real>>(
       autoPolicy(NumTri()), countAt(0), countAt(NumTri()),
       FaceAreaVolume({halfedge_.cptrD(), vertPos_.cptrD(), precision_}),
-      thrust::make_pair(0.0f, 0.0f), SumPair());
-  return {areaVolume.first, areaVolume.second};
+      thrust::make_pair(Real(0), Real(0)), SumPair());
+  properties = {areaVolume.first, areaVolume.second};
+  properties_.Set(properties);
+  return properties;
+}
+
+/**
+ * Returns true and the properties of this manifold under the given transform
+ * if they are cached and the transform is a similarity (rotation, reflection,
+ * uniform scale and translation), which scales the area by the square of the
+ * scale and the volume by the determinant. Otherwise returns false and they
+ * must be reduced anew.
+ */
+bool Manifold::Impl::CachedProperties(Properties& properties,
+                                      const mat4x3& transform) const {
+  if (IsEmpty()) {
+    properties = {0, 0};
+    return true;
+  }
+  if (!properties_.Get(properties)) return false;
+  if (transform == mat4x3(1.0f)) return true;
+
+  const mat3 linear(transform);
+  const mat3 gram = glm::transpose(linear) * linear;
+  const Real scale2 = (gram[0][0] + gram[1][1] + gram[2][2]) / 3;
+  for (int i : {0, 1, 2}) {
+    for (int j : {0, 1, 2}) {
+      const Real expected = i == j ? scale2 : 0;
+      if (glm::abs(gram[i][j] - expected) > kTolerance * scale2) return false;
+    }
+  }
+  properties.surfaceArea *= scale2;
+  properties.volume *= glm::determinant(linear);
+  return true;
 }
 
 Curvature Manifold::Impl::GetCurvature() const {
   Curvature result;
   if (IsEmpty()) return result;
-  VecDH<float> vertMeanCurvature(NumVert(), 0);
-  VecDH<float> vertGaussianCurvature(NumVert(), glm::two_pi<float>());
-  VecDH<float> vertArea(NumVert(), 0);
-  VecDH<float> degree(NumVert(), 0);
+  VecDH<Real> vertMeanCurvature(NumVert(), 0);
+  VecDH<Real> vertGaussianCurvature(NumVert(), glm::two_pi<Real>());
+  VecDH<Real> vertArea(NumVert(), 0);
+  VecDH<Real> degree(NumVert(), 0);
   auto policy = autoPolicy(NumTri());
   for_each(
       policy, countAt(0), countAt(NumTri()),
@@ -309,18 +349,18 @@ Curvature Manifold::Impl::GetCurvature() const {
              zip(vertMeanCurvature.begin(), vertGaussianCurvature.begin(),
                  vertArea.begin(), degree.begin()),
              NumVert(), NormalizeCurvature());
-  result.minMeanCurvature = reduce<float>(
+  result.minMeanCurvature = reduce<Real>(
       policy, vertMeanCurvature.begin(), vertMeanCurvature.end(),
-      std::numeric_limits<float>::infinity(), thrust::minimum<float>());
-  result.maxMeanCurvature = reduce<float>(
+      std::numeric_limits<Real>::infinity(), thrust::minimum<Real>());
+  result.maxMeanCurvature = reduce<Real>(
       policy, vertMeanCurvature.begin(), vertMeanCurvature.end(),
-      -std::numeric_limits<float>::infinity(), thrust::maximum<float>());
-  result.minGaussianCurvature = reduce<float>(
+      -std::numeric_limits<Real>::infinity(), thrust::maximum<Real>());
+  result.minGaussianCurvature = reduce<Real>(
       policy, vertGaussianCurvature.begin(), vertGaussianCurvature.end(),
-      std::numeric_limits<float>::infinity(), thrust::minimum<float>());
-  result.maxGaussianCurvature = reduce<float>(
+      std::numeric_limits<Real>::infinity(), thrust::minimum<Real>());
+  result.maxGaussianCurvature = reduce<Real>(
       policy, vertGaussianCurvature.begin(), vertGaussianCurvature.end(),
-      -std::numeric_limits<float>::infinity(), thrust::maximum<float>());
+      -std::numeric_limits<Real>::infinity(), thrust::maximum<Real>());
   result.vertMeanCurvature.insert(result.vertMeanCurvature.end(),
                                   vertMeanCurvature.begin(),
                                   vertMeanCurvature.end());
@@ -330,6 +370,33 @@ Curvature Manifold::Impl::GetCurvature() const {
   return result;
 }
 
+/**
+ * Bytes reserved by each of the buffers of this Impl as it is stored, counted
+ * in full even when they are shared.
+ */
+MemoryUsage Manifold::Impl::GetMemoryUsage() const {
+  MemoryUsage usage;
+  if (IsCompact()) {
+    // the normals and collider are not stored
+    usage.vertPos = compact_->vertPos.Bytes() + compact_->vertGrid.Bytes();
+    usage.halfedge =
+        compact_->cornerVert.Bytes() + compact_->cornerPair.Bytes();
+    usage.halfedgeTangent = compact_->halfedgeTangent.Bytes();
+    usage.meshRelation = compact_->meshRelation.barycentric.Bytes() +
+                         compact_->meshRelation.triBary.Bytes();
+    return usage;
+  }
+  usage.vertPos = vertPos_.Bytes();
+  usage.halfedge = halfedge_.Bytes();
+  usage.vertNormal = vertNormal_.Bytes();
+  usage.faceNormal = faceNormal_.Bytes();
+  usage.halfedgeTangent = halfedgeTangent_.Bytes();
+  usage.meshRelation =
+      meshRelation_.barycentric.Bytes() + meshRelation_.triBary.Bytes();
+  usage.collider = collider_.Bytes();
+  return usage;
+}
+
 /**
  * Calculates the bounding box of the entire manifold, which is stored
  * internally to short-cut Boolean operations and to serve as the precision
@@ -337,12 +404,12 @@ Curvature Manifold::Impl::GetCurvature() const {
  */
 void Manifold::Impl::CalculateBBox() {
   auto policy = autoPolicy(NumVert());
-  bBox_.min = reduce<glm::vec3>(
-      policy, vertPos_.begin(), vertPos_.end(),
-      glm::vec3(std::numeric_limits<float>::infinity()), PosMin());
-  bBox_.max = reduce<glm::vec3>(
-      policy, vertPos_.begin(), vertPos_.end(),
-      glm::vec3(-std::numeric_limits<float>::infinity()), PosMax());
+  bBox_.min = reduce<vec3>(policy, vertPos_.begin(), vertPos_.end(),
+                           vec3(std::numeric_limits<Real>::infinity()),
+                           PosMin());
+  bBox_.max = reduce<vec3>(policy, vertPos_.begin(), vertPos_.end(),
+                           vec3(-std::numeric_limits<Real>::infinity()),
+                           PosMax());
 }
 
 /**
@@ -0,0 +1,466 @@
+// Copyright 2022 The Manifold Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <limits>
+
+#include "impl.h"
+#include "par.h"
+
+namespace {
+using namespace manifold;
+
+// Points are queried this many at a time, which bounds the memory of their
+// collisions.
+constexpr int kQueryBatch = 1 << 18;
+
+/**
+ * Which side of the XY projection of edge ab the point p is on: 1 for the
+ * left, -1 for the right. The edge is evaluated in a canonical direction, so
+ * that the two triangles sharing it agree exactly, and ties are broken by a
+ * symbolic perturbation of p by (epsilon, epsilon^2), so that a point on an
+ * edge or vertex is inside exactly one of the faces around it. Returns 0 only
+ * for a zero-length edge. cross receives the signed doubled area of the
+ * triangle abp, for interpolation.
+ */
+__host__ __device__ int EdgeSide(vec3 a, vec3 b, vec3 p, Real& cross) {
+  const bool flip = b.x < a.x || (b.x == a.x && b.y < a.y);
+  if (flip) thrust::swap(a, b);
+  cross = (b.x - a.x) * (p.y - a.y) - (b.y - a.y) * (p.x - a.x);
+  int side = cross > 0 ? 1 : cross < 0 ? -1 : 0;
+  if (side == 0) side = b.y > a.y ? -1 : b.y < a.y ? 1 : 0;
+  if (side == 0) side = b.x > a.x ? 1 : b.x < a.x ? -1 : 0;
+  if (flip) {
+    cross = -cross;
+    side = -side;
+  }
+  return side;
+}
+
+/**
+ * The contribution of a face to the winding number of a point: the +z ray
+ * from the point exits through a face facing up (+1) and enters through one
+ * facing down (-1).
+ */
+struct RayWinding {
+  const vec3* points;
+  const int* startVert;
+  const vec3* vertPos;
+
+  __host__ __device__ int operator()(thrust::tuple<int, int> pointFace) {
+    const vec3 p = points[thrust::get<0>(pointFace)];
+    const int face = thrust::get<1>(pointFace);
+    vec3 v[3];
+    for (int i : {0, 1, 2}) v[i] = vertPos[startVert[3 * face + i]];
+
+    Real cross[3];
+    int side[3];
+    for (int i : {0, 1, 2})
+      side[i] = EdgeSide(v[i], v[(i + 1) % 3], p, cross[i]);
+    if (side[0] == 0 || side[0] != side[1] || side[1] != side[2]) return 0;
+
+    // each edge's area weights the vert opposite it
+    const Real total = cross[0] + cross[1] + cross[2];
+    if (total == 0) return 0;
+    const Real z =
+        (cross[0] * v[2].z + cross[1] * v[0].z + cross[2] * v[1].z) / total;
+    return z > p.z ? side[0] : 0;
+  }
+};
+
+__host__ __device__ Real PointTriDistance2(vec3 p, vec3 a, vec3 b, vec3 c) {
+  // Closest point on a triangle, after Ericson's Real-Time Collision
+  // Detection, section 5.1.5, by the Voronoi region of p.
+  const vec3 ab = b - a;
+  const vec3 ac = c - a;
+  const vec3 ap = p - a;
+  const Real d1 = glm::dot(ab, ap);
+  const Real d2 = glm::dot(ac, ap);
+  if (d1 <= 0 && d2 <= 0) return glm::dot(ap, ap);
+
+  const vec3 bp = p - b;
+  const Real d3 = glm::dot(ab, bp);
+  const Real d4 = glm::dot(ac, bp);
+  if (d3 >= 0 && d4 <= d3) return glm::dot(bp, bp);
+
+  const Real vc = d1 * d4 - d3 * d2;
+  if (vc <= 0 && d1 >= 0 && d3 <= 0) {
+    const vec3 q = a + ab * (d1 / (d1 - d3));
+    return glm::dot(p - q, p - q);
+  }
+
+  const vec3 cp = p - c;
+  const Real d5 = glm::dot(ab, cp);
+  const Real d6 = glm::dot(ac, cp);
+  if (d6 >= 0 && d5 <= d6) return glm::dot(cp, cp);
+
+  const Real vb = d5 * d2 - d1 * d6;
+  if (vb <= 0 && d2 >= 0 && d6 <= 0) {
+    const vec3 q = a + ac * (d2 / (d2 - d6));
+    return glm::dot(p - q, p - q);
+  }
+
+  const Real va = d3 * d6 - d5 * d4;
+  if (va <= 0 && d4 - d3 >= 0 && d5 - d6 >= 0) {
+    const vec3 q = b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+    return glm::dot(p - q, p - q);
+  }
+
+  const Real denom = va + vb + vc;
+  // a degenerate triangle is covered by its edges
+  if (denom == 0) return glm::dot(ap, ap);
+  const vec3 q = a + ab * (vb / denom) + ac * (vc / denom);
+  return glm::dot(p - q, p - q);
+}
+
+struct QueryBox {
+  const vec3* points;
+
+  __host__ __device__ Box operator()(thrust::tuple<int, Real> pointRadius) {
+    const vec3 p = points[thrust::get<0>(pointRadius)];
+    const vec3 r(thrust::get<1>(pointRadius));
+    return Box(p - r, p + r);
+  }
+};
+
+struct FaceDistance2 {
+  const vec3* points;
+  const int* active;
+  const int* startVert;
+  const vec3* vertPos;
+
+  __host__ __device__ Real operator()(thrust::tuple<int, int> slotFace) {
+    const vec3 p = points[active[thrust::get<0>(slotFace)]];
+    const int face = thrust::get<1>(slotFace);
+    return PointTriDistance2(p, vertPos[startVert[3 * face]],
+                             vertPos[startVert[3 * face + 1]],
+                             vertPos[startVert[3 * face + 2]]);
+  }
+};
+
+/**
+ * A point is done once its nearest candidate is within its search radius, as
+ * the box of that radius catches every face that could be nearer, or once the
+ * radius reaches maxDistance. Otherwise the radius grows: to the candidate's
+ * distance, which the next round then settles, or doubles if there was none.
+ */
+struct UpdateSearch {
+  Real* distance;
+  char* done;
+  const int* active;
+  const Real* nearest2;
+  const Real maxDistance;
+
+  __host__ __device__ void operator()(thrust::tuple<int, Real&> slotRadius) {
+    const int slot = thrust::get<0>(slotRadius);
+    Real& radius = thrust::get<1>(slotRadius);
+    const Real nearest = glm::sqrt(nearest2[slot]);
+    if (nearest <= radius || radius >= maxDistance) {
+      distance[active[slot]] = glm::min(nearest, maxDistance);
+      done[slot] = 1;
+      return;
+    }
+    done[slot] = 0;
+    radius = glm::min(glm::isinf(nearest) ? 2 * radius : nearest, maxDistance);
+  }
+};
+
+struct InitialRadius {
+  const Box bBox;
+  const Real minRadius;
+
+  __host__ __device__ Real operator()(vec3 p) {
+    // the distance to the bounding box is a lower bound
+    const vec3 outside =
+        glm::max(glm::max(bBox.min - p, p - bBox.max), vec3(0));
+    return glm::max(glm::length(outside), minRadius);
+  }
+};
+
+struct NotDone {
+  __host__ __device__ bool operator()(char done) { return !done; }
+};
+
+struct ApplySign {
+  __host__ __device__ Real operator()(Real distance, int winding) {
+    return winding > 0 ? distance : -distance;
+  }
+};
+/**
+ * Moller-Trumbore intersection of a ray with a triangle from either side.
+ * Returns the distance along the ray, or infinity for a miss, and sets the
+ * barycentric coordinates of the hit.
+ */
+__host__ __device__ Real RayTriangle(const Ray& ray, vec3 a, vec3 b, vec3 c,
+                                     vec3& barycentric) {
+  const Real kMiss = std::numeric_limits<Real>::infinity();
+  const vec3 dir = ray.Direction();
+  const vec3 ab = b - a;
+  const vec3 ac = c - a;
+  const vec3 pVec = glm::cross(dir, ac);
+  const Real det = glm::dot(ab, pVec);
+  if (det == 0) return kMiss;
+  const Real invDet = 1 / det;
+  const vec3 tVec = ray.origin - a;
+  const Real u = glm::dot(tVec, pVec) * invDet;
+  if (u < 0 || u > 1) return kMiss;
+  const vec3 qVec = glm::cross(tVec, ab);
+  const Real v = glm::dot(dir, qVec) * invDet;
+  if (v < 0 || u + v > 1) return kMiss;
+  const Real t = glm::dot(ac, qVec) * invDet;
+  if (t < 0 || t > ray.tMax) return kMiss;
+  barycentric = vec3(1 - u - v, u, v);
+  return t;
+}
+
+struct RayFaceDistance {
+  const Ray* rays;
+  const int* startVert;
+  const vec3* vertPos;
+
+  __host__ __device__ thrust::tuple<Real, int> operator()(
+      thrust::tuple<int, int, int> rayFacePair) {
+    const Ray& ray = rays[thrust::get<0>(rayFacePair)];
+    const int face = thrust::get<1>(rayFacePair);
+    vec3 barycentric;
+    const Real t = RayTriangle(ray, vertPos[startVert[3 * face]],
+                               vertPos[startVert[3 * face + 1]],
+                               vertPos[startVert[3 * face + 2]], barycentric);
+    return thrust::make_tuple(t, thrust::get<2>(rayFacePair));
+  }
+};
+
+// The lower pair index breaks ties, so the result does not depend on the
+// order of the reduction.
+struct NearerHit {
+  __host__ __device__ thrust::tuple<Real, int> operator()(
+      thrust::tuple<Real, int> a, thrust::tuple<Real, int> b) {
+    if (thrust::get<0>(a) != thrust::get<0>(b))
+      return thrust::get<0>(a) < thrust::get<0>(b) ? a : b;
+    return thrust::get<1>(a) < thrust::get<1>(b) ? a : b;
+  }
+};
+
+struct RecordHit {
+  RayHit* hits;
+  const Ray* rays;
+  const int* rayFace;
+  const int* startVert;
+  const vec3* vertPos;
+  const BaryRef* triBary;
+  const vec3* barycentric;
+
+  __host__ __device__ void operator()(thrust::tuple<int, Real, int> nearest) {
+    const int rayIdx = thrust::get<0>(nearest);
+    const Real t = thrust::get<1>(nearest);
+    if (glm::isinf(t)) return;
+    const int face = rayFace[thrust::get<2>(nearest)];
+    RayHit& hit = hits[rayIdx];
+    hit.tri = face;
+    hit.distance = t;
+    RayTriangle(rays[rayIdx], vertPos[startVert[3 * face]],
+                vertPos[startVert[3 * face + 1]],
+                vertPos[startVert[3 * face + 2]], hit.barycentric);
+
+    const BaryRef& ref = triBary[face];
+    hit.originalID = ref.originalID;
+    hit.originalTri = ref.tri;
+    hit.originalBarycentric = vec3(0);
+    for (int i : {0, 1, 2}) {
+      const int idx = ref.vertBary[i];
+      if (idx < 0)
+        hit.originalBarycentric[idx + 3] += hit.barycentric[i];
+      else
+        hit.originalBarycentric += hit.barycentric[i] * barycentric[idx];
+    }
+  }
+};
+}  // namespace
+
+namespace manifold {
+
+/**
+ * Writes the winding number of each point, the number of times the surface
+ * wraps around it, counting the faces that a +z ray from it crosses.
+ */
+void Manifold::Impl::Winding(const vec3* points, int numPoint,
+                             int* winding) const {
+  std::fill(winding, winding + numPoint, 0);
+  if (IsEmpty()) return;
+  for (int start = 0; start < numPoint; start += kQueryBatch) {
+    const int size = glm::min(kQueryBatch, numPoint - start);
+    VecDH<vec3> batch(size);
+    std::copy(points + start, points + start + size, batch.ptrH());
+    SparseIndices pointFace = collider_.Collisions(batch);
+    const int numPair = pointFace.size();
+    if (numPair == 0) continue;
+
+    auto policy = autoPolicy(numPair);
+    VecDH<int> pairWinding(numPair);
+    transform(policy, pointFace.beginPQ(), pointFace.endPQ(),
+              pairWinding.begin(),
+              RayWinding({batch.cptrD(), halfedge_.startVert.cptrD(),
+                          vertPos_.cptrD()}));
+    // the collisions are grouped by point
+    VecDH<int> point(size);
+    VecDH<int> sum(size);
+    auto end = reduce_by_key<
+        thrust::pair<decltype(point.begin()), decltype(sum.begin())>>(
+        policy, pointFace.begin(false), pointFace.end(false),
+        pairWinding.begin(), point.begin(), sum.begin());
+    VecDH<int> batchWinding(size, 0);
+    scatter(policy, sum.begin(), end.second, point.begin(),
+            batchWinding.begin());
+    std::copy(batchWinding.cbegin(), batchWinding.cend(), winding + start);
+  }
+}
+
+/**
+ * Writes the signed distance of each point to the surface, positive inside,
+ * clamped to within maxDistance. The nearest faces are found with the
+ * collider, by growing a box around each point until it catches them.
+ */
+void Manifold::Impl::SignedDistance(const vec3* points, int numPoint,
+                                    Real maxDistance, Real* distance) const {
+  if (IsEmpty()) {
+    std::fill(distance, distance + numPoint, -maxDistance);
+    return;
+  }
+  // about the size of a triangle
+  const Real minRadius =
+      glm::length(bBox_.Size()) / glm::sqrt(static_cast<Real>(NumTri()));
+  VecDH<int> winding(numPoint);
+  Winding(points, numPoint, winding.ptrH());
+
+  for (int start = 0; start < numPoint; start += kQueryBatch) {
+    const int size = glm::min(kQueryBatch, numPoint - start);
+    auto policy = autoPolicy(size);
+    VecDH<vec3> batch(size);
+    std::copy(points + start, points + start + size, batch.ptrH());
+    VecDH<Real> batchDistance(size);
+    VecDH<int> active(size);
+    sequence(policy, active.begin(), active.end());
+    VecDH<Real> radius(size);
+    transform(policy, batch.cbegin(), batch.cend(), radius.begin(),
+              InitialRadius({bBox_, minRadius}));
+
+    while (active.size() > 0) {
+      const int numActive = active.size();
+      policy = autoPolicy(numActive);
+      VecDH<Box> boxes(numActive);
+      transform(policy, zip(active.cbegin(), radius.cbegin()),
+                zip(active.cend(), radius.cend()), boxes.begin(),
+                QueryBox({batch.cptrD()}));
+      SparseIndices slotFace = collider_.Collisions(boxes);
+      const int numPair = slotFace.size();
+
+      VecDH<Real> nearest2(numActive, std::numeric_limits<Real>::infinity());
+      if (numPair > 0) {
+        auto pairPolicy = autoPolicy(numPair);
+        VecDH<Real> pairDistance2(numPair);
+        transform(pairPolicy, slotFace.beginPQ(), slotFace.endPQ(),
+                  pairDistance2.begin(),
+                  FaceDistance2({batch.cptrD(), active.cptrD(),
+                                 halfedge_.startVert.cptrD(),
+                                 vertPos_.cptrD()}));
+        VecDH<int> slot(numActive);
+        VecDH<Real> minDistance2(numActive);
+        auto end = reduce_by_key<thrust::pair<decltype(slot.begin()),
+                                              decltype(minDistance2.begin())>>(
+            pairPolicy, slotFace.begin(false), slotFace.end(false),
+            pairDistance2.begin(), slot.begin(), minDistance2.begin(),
+            thrust::equal_to<int>(), thrust::minimum<Real>());
+        scatter(pairPolicy, minDistance2.begin(), end.second, slot.begin(),
+                nearest2.begin());
+      }
+
+      VecDH<char> done(numActive);
+      for_each_n(policy, zip(countAt(0), radius.begin()), numActive,
+                 UpdateSearch({batchDistance.ptrD(), done.ptrD(),
+                               active.cptrD(), nearest2.cptrD(),
+                               maxDistance}));
+
+      VecDH<int> nextActive(numActive);
+      VecDH<Real> nextRadius(numActive);
+      auto next = copy_if<decltype(zip(nextActive.begin(),
+                                       nextRadius.begin()))>(
+          policy, zip(active.cbegin(), radius.cbegin()),
+          zip(active.cend(), radius.cend()), done.cbegin(),
+          zip(nextActive.begin(), nextRadius.begin()), NotDone());
+      const int numNext = thrust::get<0>(next.get_iterator_tuple()) -
+                          nextActive.begin();
+      nextActive.resize(numNext);
+      nextRadius.resize(numNext);
+      active = std::move(nextActive);
+      radius = std::move(nextRadius);
+    }
+
+    transform(policy, batchDistance.cbegin(), batchDistance.cend(),
+              winding.cbegin() + start, batchDistance.begin(), ApplySign());
+    std::copy(batchDistance.cbegin(), batchDistance.cend(), distance + start);
+  }
+}
+/**
+ * Writes the nearest hit of each ray, given by its origin and nonzero
+ * direction, within maxDistance. The candidate faces are those whose boxes
+ * the ray passes through in the collider.
+ */
+void Manifold::Impl::RayCast(const vec3* origins, const vec3* directions,
+                             int numRay, Real maxDistance,
+                             RayHit* hits) const {
+  std::fill(hits, hits + numRay, RayHit());
+  if (IsEmpty()) return;
+  for (int start = 0; start < numRay; start += kQueryBatch) {
+    const int size = glm::min(kQueryBatch, numRay - start);
+    VecDH<Ray> rays(size);
+    for (int i = 0; i < size; ++i)
+      rays[i] = Ray(origins[start + i], directions[start + i], maxDistance);
+    SparseIndices rayFace = collider_.Collisions(rays);
+    const int numPair = rayFace.size();
+    if (numPair == 0) continue;
+
+    auto policy = autoPolicy(numPair);
+    VecDH<Real> pairT(numPair);
+    VecDH<int> pairIdx(numPair);
+    transform(policy,
+              zip(rayFace.begin(false), rayFace.begin(true), countAt(0)),
+              zip(rayFace.end(false), rayFace.end(true), countAt(numPair)),
+              zip(pairT.begin(), pairIdx.begin()),
+              RayFaceDistance({rays.cptrD(), halfedge_.startVert.cptrD(),
+                               vertPos_.cptrD()}));
+    // the collisions are grouped by ray
+    VecDH<int> rayIdx(size);
+    VecDH<Real> nearestT(size);
+    VecDH<int> nearestPair(size);
+    auto end = reduce_by_key<thrust::pair<
+        decltype(rayIdx.begin()),
+        decltype(zip(nearestT.begin(), nearestPair.begin()))>>(
+        policy, rayFace.begin(false), rayFace.end(false),
+        zip(pairT.begin(), pairIdx.begin()), rayIdx.begin(),
+        zip(nearestT.begin(), nearestPair.begin()), thrust::equal_to<int>(),
+        NearerHit());
+    const int numHit = end.first - rayIdx.begin();
+
+    VecDH<RayHit> batchHits(size);
+    for_each_n(autoPolicy(numHit),
+               zip(rayIdx.begin(), nearestT.begin(), nearestPair.begin()),
+               numHit,
+               RecordHit({batchHits.ptrD(), rays.cptrD(), rayFace.ptrD(true),
+                          halfedge_.startVert.cptrD(), vertPos_.cptrD(),
+                          meshRelation_.triBary.cptrD(),
+                          meshRelation_.barycentric.cptrD()}));
+    std::copy(batchHits.cbegin(), batchHits.cend(), hits + start);
+  }
+}
+}  // namespace manifold
@@ -0,0 +1,440 @@
+// Copyright 2022 The Manifold Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstring>
+#include <istream>
+#include <iterator>
+#include <ostream>
+#include <unordered_map>
+
+#include "csg_tree.h"
+#include "impl.h"
+#include "par.h"
+
+namespace {
+using namespace manifold;
+
+constexpr char kMagic[8] = {'M', 'A', 'N', 'I', 'F', 'O', 'L', 'D'};
+constexpr uint32_t kVersion = 2;
+// Written as is, so files are only read back on machines of the same
+// endianness.
+constexpr uint32_t kEndian = 0x01020304;
+// Sections start on cache-line boundaries, so that the arrays of a file
+// mapped into memory are aligned.
+constexpr uint64_t kAlign = 64;
+
+enum SectionID : uint32_t {
+  kVertPos,
+  // the halfedges, one section per field
+  kStartVert,
+  kEndVert,
+  kPairedHalfedge,
+  kFace,
+  kVertNormal,
+  kFaceNormal,
+  kHalfedgeTangent,
+  kBarycentric,
+  kTriBary,
+  // the collider's, which are optional
+  kNodeBBox,
+  kNodeParent,
+  kInternalChildren,
+  kLeafIndex,
+  kWideNode,
+  kInternal2Wide,
+  kWide2Internal,
+  kNumSectionID,
+};
+
+struct FileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t endian;
+  uint32_t numSection;
+  int32_t status;
+  int32_t originalID;
+  float precision;
+  float builtSAH;
+  float bBox[6];
+  uint32_t reserved;
+};
+static_assert(sizeof(FileHeader) == 64, "FileHeader must be packed.");
+
+// Followed by the table of numSection of these, then by the sections.
+struct SectionHeader {
+  uint32_t id;
+  uint32_t elementSize;
+  uint64_t count;
+  uint64_t offset;
+};
+static_assert(sizeof(SectionHeader) == 24, "SectionHeader must be packed.");
+
+struct Array {
+  SectionHeader header;
+  const void* data;
+};
+
+template <typename T>
+Array MakeArray(SectionID id, const VecDH<T>& vec) {
+  return {{id, sizeof(T), static_cast<uint64_t>(vec.size()), 0}, vec.cptrH()};
+}
+
+/**
+ * Copies the section of this id into vec, returning false if it is missing or
+ * does not fit in the buffer.
+ */
+template <typename T>
+bool ReadSection(VecDH<T>& vec, SectionID id,
+                 const std::vector<SectionHeader>& sections, const char* data,
+                 size_t size) {
+  for (const SectionHeader& section : sections) {
+    if (section.id != id || section.id >= kNumSectionID) continue;
+    if (section.elementSize != sizeof(T) || section.offset > size ||
+        section.count > (size - section.offset) / sizeof(T))
+      return false;
+    vec.resize(section.count);
+    if (section.count > 0)
+      std::memcpy(vec.ptrH(), data + section.offset, section.count * sizeof(T));
+    return true;
+  }
+  return false;
+}
+
+struct InRange {
+  const int min;
+  const int end;
+
+  __host__ __device__ bool operator()(int i) { return i >= min && i < end; }
+};
+
+struct ChildrenInRange {
+  const int numNode;
+
+  __host__ __device__ bool operator()(const thrust::pair<int, int>& children) {
+    return children.first >= 0 && children.first < numNode &&
+           children.second >= 0 && children.second < numNode;
+  }
+};
+
+struct WideChildrenInRange {
+  const int numLeaf;
+  const int numWide;
+
+  __host__ __device__ bool operator()(const Collider::WideNode& node) {
+    for (int child : node.child)
+      if (child < -numLeaf || child >= numWide) return false;
+    return true;
+  }
+};
+
+// Corners of new verts index barycentric, the others are -3 to -1.
+struct BaryInRange {
+  const int numBary;
+
+  __host__ __device__ bool operator()(const BaryRef& ref) {
+    for (int i : {0, 1, 2})
+      if (ref.vertBary[i] < -3 || ref.vertBary[i] >= numBary) return false;
+    return true;
+  }
+};
+
+bool AllInRange(const VecDH<int>& vec, int min, int end) {
+  return all_of(autoPolicy(vec.size()), vec.begin(), vec.end(),
+                InRange({min, end}));
+}
+
+/**
+ * Whether all the indices of the mesh read from a file point within their
+ * arrays, and its halfedges are paired consistently, so that a corrupt file
+ * cannot make later operations read out of bounds.
+ */
+bool ValidMesh(const Manifold::Impl& impl) {
+  const int numVert = impl.NumVert();
+  const int numHalfedge = impl.halfedge_.size();
+  const int numBary = impl.meshRelation_.barycentric.size();
+  if (!AllInRange(impl.halfedge_.startVert, 0, numVert) ||
+      !AllInRange(impl.halfedge_.endVert, 0, numVert) ||
+      !AllInRange(impl.halfedge_.pairedHalfedge, 0, numHalfedge) ||
+      !AllInRange(impl.halfedge_.face, 0, impl.NumTri()))
+    return false;
+  const auto& triBary = impl.meshRelation_.triBary;
+  if (!all_of(autoPolicy(triBary.size()), triBary.begin(), triBary.end(),
+              BaryInRange({numBary})))
+    return false;
+  return impl.IsManifold();
+}
+
+/**
+ * The meshIDs of a file may already be in use in this process, so they are
+ * renumbered, as by IncrementMeshIDs(). An original keeps being one, under
+ * its new meshID, while the other originalIDs are kept as saved.
+ */
+void ReassignMeshIDs(Manifold::Impl& impl) {
+  BaryRef* refs = impl.meshRelation_.triBary.ptrH();
+  const int numTri = impl.meshRelation_.triBary.size();
+  std::unordered_map<int, int> rank;
+  for (int i = 0; i < numTri; ++i) rank.emplace(refs[i].meshID, rank.size());
+  const int start = Manifold::Impl::meshIDCounter_.fetch_add(
+      rank.size(), std::memory_order_relaxed);
+
+  const int oldOriginal = impl.meshRelation_.originalID;
+  const auto original = rank.find(oldOriginal);
+  const int newOriginal =
+      original == rank.end() ? -1 : start + original->second;
+  for (int i = 0; i < numTri; ++i) {
+    refs[i].meshID = start + rank[refs[i].meshID];
+    if (oldOriginal >= 0 && refs[i].originalID == oldOriginal)
+      refs[i].originalID = newOriginal;
+  }
+  if (oldOriginal >= 0) impl.meshRelation_.originalID = newOriginal;
+}
+}  // namespace
+
+namespace manifold {
+
+struct Serializer {
+  /**
+   * Whether the indices of a collider read from a file point within its
+   * arrays, for a tree over numLeaf faces. Otherwise it is rebuilt.
+   */
+  static bool ValidCollider(const Collider& collider, int numLeaf) {
+    const int numNode = collider.nodeBBox_.size();
+    const int numInternal = collider.internalChildren_.size();
+    const int numWide = collider.wideNode_.size();
+    const auto& children = collider.internalChildren_;
+    const auto& wideNode = collider.wideNode_;
+    return collider.nodeParent_.size() == numNode &&
+           numNode == 2 * numLeaf - 1 && numInternal == numLeaf - 1 &&
+           (collider.leafIndex_.size() == 0 ||
+            collider.leafIndex_.size() == numLeaf) &&
+           collider.internal2Wide_.size() == numInternal &&
+           collider.wide2Internal_.size() == numWide &&
+           AllInRange(collider.nodeParent_, -1, numNode) &&
+           all_of(autoPolicy(numInternal), children.begin(), children.end(),
+                  ChildrenInRange({numNode})) &&
+           AllInRange(collider.leafIndex_, 0, numLeaf) &&
+           all_of(autoPolicy(numWide), wideNode.begin(), wideNode.end(),
+                  WideChildrenInRange({numLeaf, numWide})) &&
+           AllInRange(collider.internal2Wide_, -1, numWide) &&
+           AllInRange(collider.wide2Internal_, 0, numInternal);
+  }
+
+  static std::vector<Array> Arrays(const Manifold::Impl& impl,
+                                   bool withCollider) {
+    std::vector<Array> arrays = {
+        MakeArray(kVertPos, impl.vertPos_),
+        MakeArray(kStartVert, impl.halfedge_.startVert),
+        MakeArray(kEndVert, impl.halfedge_.endVert),
+        MakeArray(kPairedHalfedge, impl.halfedge_.pairedHalfedge),
+        MakeArray(kFace, impl.halfedge_.face),
+        MakeArray(kVertNormal, impl.vertNormal_),
+        MakeArray(kFaceNormal, impl.faceNormal_),
+        MakeArray(kHalfedgeTangent, impl.halfedgeTangent_),
+        MakeArray(kBarycentric, impl.meshRelation_.barycentric),
+        MakeArray(kTriBary, impl.meshRelation_.triBary)};
+    if (withCollider) {
+      const Collider& collider = impl.collider_;
+      arrays.push_back(MakeArray(kNodeBBox, collider.nodeBBox_));
+      arrays.push_back(MakeArray(kNodeParent, collider.nodeParent_));
+      arrays.push_back(
+          MakeArray(kInternalChildren, collider.internalChildren_));
+      arrays.push_back(MakeArray(kLeafIndex, collider.leafIndex_));
+      arrays.push_back(MakeArray(kWideNode, collider.wideNode_));
+      arrays.push_back(MakeArray(kInternal2Wide, collider.internal2Wide_));
+      arrays.push_back(MakeArray(kWide2Internal, collider.wide2Internal_));
+    }
+    return arrays;
+  }
+
+  static void Write(const Manifold::Impl& impl, bool withCollider,
+                    std::ostream& stream) {
+    std::vector<Array> arrays = Arrays(impl, withCollider);
+
+    FileHeader header = {};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.endian = kEndian;
+    header.numSection = arrays.size();
+    header.status = static_cast<int32_t>(impl.status_);
+    header.originalID = impl.meshRelation_.originalID;
+    header.precision = impl.precision_;
+    header.builtSAH = withCollider ? impl.collider_.builtSAH_ : 0;
+    for (int i : {0, 1, 2}) {
+      header.bBox[i] = impl.bBox_.min[i];
+      header.bBox[3 + i] = impl.bBox_.max[i];
+    }
+
+    uint64_t offset =
+        sizeof(FileHeader) + arrays.size() * sizeof(SectionHeader);
+    for (Array& array : arrays) {
+      offset = (offset + kAlign - 1) / kAlign * kAlign;
+      array.header.offset = offset;
+      offset += array.header.count * array.header.elementSize;
+    }
+
+    stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (const Array& array : arrays)
+      stream.write(reinterpret_cast<const char*>(&array.header),
+                   sizeof(SectionHeader));
+    uint64_t written =
+        sizeof(FileHeader) + arrays.size() * sizeof(SectionHeader);
+    const char zeros[kAlign] = {};
+    for (const Array& array : arrays) {
+      stream.write(zeros, array.header.offset - written);
+      const uint64_t bytes = array.header.count * array.header.elementSize;
+      stream.write(static_cast<const char*>(array.data), bytes);
+      written = array.header.offset + bytes;
+    }
+  }
+
+  /**
+   * Returns the Impl stored in this buffer, or nullptr if it is not a valid
+   * file of this version, including if any of its mesh indices are out of
+   * range or its halfedges are not paired. A stored collider that is not
+   * consistent is rebuilt instead.
+   */
+  static std::shared_ptr<Manifold::Impl> Read(const char* data, size_t size) {
+    FileHeader header;
+    if (size < sizeof(header)) return nullptr;
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+        header.version != kVersion || header.endian != kEndian ||
+        header.numSection > (size - sizeof(header)) / sizeof(SectionHeader))
+      return nullptr;
+    std::vector<SectionHeader> sections(header.numSection);
+    std::memcpy(sections.data(), data + sizeof(header),
+                sections.size() * sizeof(SectionHeader));
+
+    constexpr int kMaxStatus =
+        static_cast<int>(Manifold::Error::INVALID_SERIALIZATION);
+    if (header.status < 0 || header.status > kMaxStatus) return nullptr;
+    auto impl = std::make_shared<Manifold::Impl>();
+    if (header.status != static_cast<int>(Manifold::Error::NO_ERROR)) {
+      impl->MarkFailure(static_cast<Manifold::Error>(header.status));
+      return impl;
+    }
+
+    if (!ReadSection(impl->vertPos_, kVertPos, sections, data, size) ||
+        !ReadSection(impl->halfedge_.startVert, kStartVert, sections, data,
+                     size) ||
+        !ReadSection(impl->halfedge_.endVert, kEndVert, sections, data,
+                     size) ||
+        !ReadSection(impl->halfedge_.pairedHalfedge, kPairedHalfedge,
+                     sections, data, size) ||
+        !ReadSection(impl->halfedge_.face, kFace, sections, data, size) ||
+        !ReadSection(impl->vertNormal_, kVertNormal, sections, data, size) ||
+        !ReadSection(impl->faceNormal_, kFaceNormal, sections, data, size) ||
+        !ReadSection(impl->halfedgeTangent_, kHalfedgeTangent, sections, data,
+                     size) ||
+        !ReadSection(impl->meshRelation_.barycentric, kBarycentric, sections,
+                     data, size) ||
+        !ReadSection(impl->meshRelation_.triBary, kTriBary, sections, data,
+                     size))
+      return nullptr;
+    const int numTri = impl->NumTri();
+    if (impl->halfedge_.size() != 3 * numTri ||
+        impl->halfedge_.endVert.size() != 3 * numTri ||
+        impl->halfedge_.pairedHalfedge.size() != 3 * numTri ||
+        impl->halfedge_.face.size() != 3 * numTri ||
+        impl->vertNormal_.size() != impl->NumVert() ||
+        impl->faceNormal_.size() != numTri ||
+        impl->meshRelation_.triBary.size() != numTri ||
+        (impl->halfedgeTangent_.size() != 0 &&
+         impl->halfedgeTangent_.size() != 3 * numTri) ||
+        !ValidMesh(*impl))
+      return nullptr;
+
+    impl->precision_ = header.precision;
+    impl->meshRelation_.originalID = header.originalID;
+    impl->bBox_ = {{header.bBox[0], header.bBox[1], header.bBox[2]},
+                   {header.bBox[3], header.bBox[4], header.bBox[5]}};
+    // the header is float in both builds, so a double build recomputes it
+    if (sizeof(Real) > sizeof(float)) impl->CalculateBBox();
+    ReassignMeshIDs(*impl);
+
+    Collider& collider = impl->collider_;
+    const bool hasCollider =
+        ReadSection(collider.nodeBBox_, kNodeBBox, sections, data, size) &&
+        ReadSection(collider.nodeParent_, kNodeParent, sections, data, size) &&
+        ReadSection(collider.internalChildren_, kInternalChildren, sections,
+                    data, size) &&
+        ReadSection(collider.leafIndex_, kLeafIndex, sections, data, size) &&
+        ReadSection(collider.wideNode_, kWideNode, sections, data, size) &&
+        ReadSection(collider.internal2Wide_, kInternal2Wide, sections, data,
+                    size) &&
+        ReadSection(collider.wide2Internal_, kWide2Internal, sections, data,
+                    size);
+    if (hasCollider && (numTri == 0 || ValidCollider(collider, numTri))) {
+      collider.builtSAH_ = header.builtSAH;
+    } else if (numTri > 0) {
+      impl->collider_ = Collider();
+      VecDH<Box> faceBox;
+      VecDH<uint32_t> faceMorton;
+      impl->GetFaceBoxMorton(faceBox, faceMorton);
+      impl->collider_.Rebuild(faceBox, faceMorton);
+    }
+    return impl;
+  }
+};
+
+/**
+ * Writes this manifold in the native binary format: its arrays are dumped as
+ * they are held, into sections aligned to 64 bytes, after a versioned header.
+ * The format is specific to the endianness and float layout of the machine,
+ * and is meant for caching rather than interchange.
+ *
+ * @param stream The binary stream to write to.
+ * @param withCollider Whether to store the face hierarchy too, which takes
+ * about half as much space again as the mesh, but skips rebuilding it on load.
+ */
+void Manifold::Serialize(std::ostream& stream, bool withCollider) const {
+  Serializer::Write(*GetCsgLeafNode().GetImpl(), withCollider, stream);
+}
+
+/**
+ * Reads a manifold written by Serialize() from memory, for instance from a
+ * mapped file. The arrays are copied out with one memcpy each, and nothing
+ * is rebuilt, except the collider if it was not stored. The meshIDs are
+ * renumbered for this process. If the data is not a valid file of this
+ * version, the result is empty with the status INVALID_SERIALIZATION.
+ */
+Manifold Manifold::Deserialize(const void* data, size_t size) {
+  std::shared_ptr<Impl> impl =
+      Serializer::Read(static_cast<const char*>(data), size);
+  if (impl == nullptr) {
+    impl = std::make_shared<Impl>();
+    impl->MarkFailure(Error::INVALID_SERIALIZATION);
+  }
+  return Manifold(impl);
+}
+
+/**
+ * Reads a manifold written by Serialize() from the rest of this stream.
+ */
+Manifold Manifold::Deserialize(std::istream& stream) {
+  std::vector<char> buffer;
+  const std::streampos start = stream.tellg();
+  if (start >= 0 && stream.seekg(0, std::ios::end)) {
+    buffer.resize(stream.tellg() - start);
+    stream.seekg(start);
+    stream.read(buffer.data(), buffer.size());
+  } else {
+    stream.clear();
+    buffer.assign(std::istreambuf_iterator<char>(stream),
+                  std::istreambuf_iterator<char>());
+  }
+  return Deserialize(buffer.data(), buffer.size());
+}
+
+}  // namespace manifold
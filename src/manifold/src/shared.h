@@ -14,6 +14,10 @@
 
 #pragma once
 
+#include <thrust/iterator/transform_iterator.h>
+
+#include <atomic>
+
 #include "par.h"
 #include "utils.h"
 #include "vec_dh.h"
@@ -23,9 +27,55 @@ namespace manifold {
 /** @addtogroup Private
  *  @{
  */
-__host__ __device__ inline glm::vec3 SafeNormalize(glm::vec3 v) {
+__host__ __device__ inline vec3 SafeNormalize(vec3 v) {
   v = glm::normalize(v);
-  return glm::isfinite(v.x) ? v : glm::vec3(0);
+  return glm::isfinite(v.x) ? v : vec3(0);
+}
+
+__host__ __device__ inline void AtomicAddVec3(vec3& target, const vec3& add) {
+  for (int i : {0, 1, 2}) {
+#ifdef __CUDA_ARCH__
+    atomicAdd(&target[i], add[i]);
+#else
+    std::atomic<Real>& tar = reinterpret_cast<std::atomic<Real>&>(target[i]);
+    Real old_val = tar.load(std::memory_order_relaxed);
+    while (!tar.compare_exchange_weak(old_val, old_val + add[i],
+                                      std::memory_order_relaxed))
+      ;
+#endif
+  }
+}
+
+/**
+ * Adds the normal of this triangle to those of its verts, weighted by its
+ * angle at each of them. The triangle normal is calculated first if asked.
+ */
+__host__ __device__ inline void AddAngleWeightedNormal(
+    vec3* vertNormal, const vec3* vertPos, const glm::ivec3& triVerts,
+    vec3& triNormal, bool calculateTriNormal) {
+  vec3 edge[3];
+  for (int i : {0, 1, 2}) {
+    const int j = (i + 1) % 3;
+    edge[i] = glm::normalize(vertPos[triVerts[j]] - vertPos[triVerts[i]]);
+  }
+
+  if (calculateTriNormal) {
+    triNormal = glm::normalize(glm::cross(edge[0], edge[1]));
+    if (isnan(triNormal.x)) triNormal = vec3(0, 0, 1);
+  }
+
+  // corner angles
+  vec3 phi;
+  Real dot = -glm::dot(edge[2], edge[0]);
+  phi[0] = dot >= 1 ? 0 : (dot <= -1 ? glm::pi<Real>() : glm::acos(dot));
+  dot = -glm::dot(edge[0], edge[1]);
+  phi[1] = dot >= 1 ? 0 : (dot <= -1 ? glm::pi<Real>() : glm::acos(dot));
+  phi[2] = glm::pi<Real>() - phi[0] - phi[1];
+
+  // assign weighted sum
+  for (int i : {0, 1, 2}) {
+    AtomicAddVec3(vertNormal[triVerts[i]], phi[i] * triNormal);
+  }
 }
 
 __host__ __device__ inline int NextHalfedge(int current) {
@@ -34,9 +84,39 @@ __host__ __device__ inline int NextHalfedge(int current) {
   return current;
 }
 
-__host__ __device__ inline glm::vec3 UVW(int vert,
-                                         const glm::vec3* barycentric) {
-  glm::vec3 uvw(0.0f);
+constexpr uint32_t kNoCode = 0xFFFFFFFFu;
+
+__host__ __device__ inline uint32_t SpreadBits3(uint32_t v) {
+  v = 0xFF0000FFu & (v * 0x00010001u);
+  v = 0x0F00F00Fu & (v * 0x00000101u);
+  v = 0xC30C30C3u & (v * 0x00000011u);
+  v = 0x49249249u & (v * 0x00000005u);
+  return v;
+}
+
+__host__ __device__ inline uint32_t MortonCode(vec3 position, Box bBox) {
+  // Unreferenced vertices are marked NaN, and this will sort them to the end
+  // (the Morton code only uses the first 30 of 32 bits).
+  if (isnan(position.x)) return kNoCode;
+
+  vec3 xyz = (position - bBox.min) / (bBox.max - bBox.min);
+  xyz = glm::min(vec3(1023.0f), glm::max(vec3(0.0f), Real(1024) * xyz));
+  uint32_t x = SpreadBits3(static_cast<uint32_t>(xyz.x));
+  uint32_t y = SpreadBits3(static_cast<uint32_t>(xyz.y));
+  uint32_t z = SpreadBits3(static_cast<uint32_t>(xyz.z));
+  return x * 4 + y * 2 + z;
+}
+
+struct BoxMorton {
+  const Box bBox;
+
+  __host__ __device__ uint32_t operator()(const Box& box) {
+    return MortonCode(box.Center(), bBox);
+  }
+};
+
+__host__ __device__ inline vec3 UVW(int vert, const vec3* barycentric) {
+  vec3 uvw(0.0f);
   if (vert < 0) {
     uvw[vert + 3] = 1;
   } else {
@@ -49,46 +129,45 @@ __host__ __device__ inline glm::vec3 UVW(int vert,
  * By using the closest axis-aligned projection to the normal instead of a
  * projection along the normal, we avoid introducing any rounding error.
  */
-__host__ __device__ inline glm::mat3x2 GetAxisAlignedProjection(
-    glm::vec3 normal) {
-  glm::vec3 absNormal = glm::abs(normal);
-  float xyzMax;
-  glm::mat2x3 projection;
+__host__ __device__ inline mat3x2 GetAxisAlignedProjection(vec3 normal) {
+  vec3 absNormal = glm::abs(normal);
+  Real xyzMax;
+  mat2x3 projection;
   if (absNormal.z > absNormal.x && absNormal.z > absNormal.y) {
-    projection = glm::mat2x3(1.0f, 0.0f, 0.0f,  //
-                             0.0f, 1.0f, 0.0f);
+    projection = mat2x3(1.0f, 0.0f, 0.0f,  //
+                        0.0f, 1.0f, 0.0f);
     xyzMax = normal.z;
   } else if (absNormal.y > absNormal.x) {
-    projection = glm::mat2x3(0.0f, 0.0f, 1.0f,  //
-                             1.0f, 0.0f, 0.0f);
+    projection = mat2x3(0.0f, 0.0f, 1.0f,  //
+                        1.0f, 0.0f, 0.0f);
     xyzMax = normal.y;
   } else {
-    projection = glm::mat2x3(0.0f, 1.0f, 0.0f,  //
-                             0.0f, 0.0f, 1.0f);
+    projection = mat2x3(0.0f, 1.0f, 0.0f,  //
+                        0.0f, 0.0f, 1.0f);
     xyzMax = normal.x;
   }
   if (xyzMax < 0) projection[0] *= -1.0f;
   return glm::transpose(projection);
 }
 
-__host__ __device__ inline glm::vec3 GetBarycentric(const glm::vec3& v,
-                                                    const glm::mat3& triPos,
-                                                    float precision) {
-  const glm::mat3 edges(triPos[2] - triPos[1], triPos[0] - triPos[2],
-                        triPos[1] - triPos[0]);
-  const glm::vec3 d2(glm::dot(edges[0], edges[0]), glm::dot(edges[1], edges[1]),
-                     glm::dot(edges[2], edges[2]));
+__host__ __device__ inline vec3 GetBarycentric(const vec3& v,
+                                               const mat3& triPos,
+                                               Real precision) {
+  const mat3 edges(triPos[2] - triPos[1], triPos[0] - triPos[2],
+                   triPos[1] - triPos[0]);
+  const vec3 d2(glm::dot(edges[0], edges[0]), glm::dot(edges[1], edges[1]),
+                glm::dot(edges[2], edges[2]));
   int longside = d2[0] > d2[1] && d2[0] > d2[2] ? 0 : d2[1] > d2[2] ? 1 : 2;
-  const glm::vec3 crossP = glm::cross(edges[0], edges[1]);
-  const float area2 = glm::dot(crossP, crossP);
-  const float tol2 = precision * precision;
-  const float vol = glm::dot(crossP, v - triPos[2]);
-  if (vol * vol > area2 * tol2) return glm::vec3(NAN);
+  const vec3 crossP = glm::cross(edges[0], edges[1]);
+  const Real area2 = glm::dot(crossP, crossP);
+  const Real tol2 = precision * precision;
+  const Real vol = glm::dot(crossP, v - triPos[2]);
+  if (vol * vol > area2 * tol2) return vec3(NAN);
 
   if (d2[longside] < tol2) {  // point
-    return glm::vec3(1, 0, 0);
+    return vec3(1, 0, 0);
   } else if (area2 > d2[longside] * tol2) {  // triangle
-    glm::vec3 uvw(0);
+    vec3 uvw(0);
     for (int i : {0, 1, 2}) {
       int j = i + 1;
       if (j > 2) j -= 3;
@@ -99,9 +178,9 @@ __host__ __device__ inline glm::vec3 GetBarycentric(const glm::vec3& v,
   } else {  // line
     int nextside = longside + 1;
     if (nextside > 2) nextside -= 3;
-    const float alpha =
+    const Real alpha =
         glm::dot(v - triPos[nextside], edges[longside]) / d2[longside];
-    glm::vec3 uvw(0);
+    vec3 uvw(0);
     uvw[longside] = 0;
     uvw[nextside++] = 1 - alpha;
     if (nextside > 2) nextside -= 3;
@@ -125,6 +204,146 @@ struct Halfedge {
   }
 };
 
+/**
+ * Device pointers to the halfedges of a HalfedgeVec. Indexing gathers a
+ * Halfedge from the four arrays, so functors keep reading whole halfedges,
+ * but once inlined only the fields that are actually used are loaded.
+ */
+struct HalfedgeCPtr {
+  const int* startVert;
+  const int* endVert;
+  const int* pairedHalfedge;
+  const int* face;
+
+  __host__ __device__ Halfedge operator[](int i) const {
+    return {startVert[i], endVert[i], pairedHalfedge[i], face[i]};
+  }
+};
+
+struct HalfedgePtr {
+  int* startVert;
+  int* endVert;
+  int* pairedHalfedge;
+  int* face;
+
+  __host__ __device__ Halfedge operator[](int i) const {
+    return {startVert[i], endVert[i], pairedHalfedge[i], face[i]};
+  }
+
+  __host__ __device__ void Set(int i, const Halfedge& edge) const {
+    startVert[i] = edge.startVert;
+    endVert[i] = edge.endVert;
+    pairedHalfedge[i] = edge.pairedHalfedge;
+    face[i] = edge.face;
+  }
+
+  __host__ __device__ operator HalfedgeCPtr() const {
+    return {startVert, endVert, pairedHalfedge, face};
+  }
+};
+
+/**
+ * The halfedges of a manifold, stored as a structure of arrays. Most kernels
+ * only touch one or two of the fields, and on large meshes they are bound by
+ * memory bandwidth, so each field is its own VecDH. Single fields are read and
+ * written through these vectors directly, while whole halfedges are read with
+ * operator[], through HalfedgeCPtr or through the iterators, which yield
+ * Halfedge values, and written with Set().
+ */
+class HalfedgeVec {
+ public:
+  VecDH<int> startVert;
+  VecDH<int> endVert;
+  VecDH<int> pairedHalfedge;
+  VecDH<int> face;
+
+  HalfedgeVec() {}
+  HalfedgeVec(int size)
+      : startVert(size), endVert(size), pairedHalfedge(size), face(size) {}
+
+  int size() const { return startVert.size(); }
+
+  size_t Bytes() const {
+    return startVert.Bytes() + endVert.Bytes() + pairedHalfedge.Bytes() +
+           face.Bytes();
+  }
+
+  void resize(int size) {
+    startVert.resize(size);
+    endVert.resize(size);
+    pairedHalfedge.resize(size);
+    face.resize(size);
+  }
+
+  void reserve(int size) {
+    startVert.reserve(size);
+    endVert.reserve(size);
+    pairedHalfedge.reserve(size);
+    face.reserve(size);
+  }
+
+  void swap(HalfedgeVec& other) {
+    startVert.swap(other.startVert);
+    endVert.swap(other.endVert);
+    pairedHalfedge.swap(other.pairedHalfedge);
+    face.swap(other.face);
+  }
+
+  void push_back(const Halfedge& edge) {
+    startVert.push_back(edge.startVert);
+    endVert.push_back(edge.endVert);
+    pairedHalfedge.push_back(edge.pairedHalfedge);
+    face.push_back(edge.face);
+  }
+
+  Halfedge operator[](int i) const {
+    return {startVert[i], endVert[i], pairedHalfedge[i], face[i]};
+  }
+
+  void Set(int i, const Halfedge& edge) {
+    startVert[i] = edge.startVert;
+    endVert[i] = edge.endVert;
+    pairedHalfedge[i] = edge.pairedHalfedge;
+    face[i] = edge.face;
+  }
+
+  HalfedgePtr ptrD() {
+    return {startVert.ptrD(), endVert.ptrD(), pairedHalfedge.ptrD(),
+            face.ptrD()};
+  }
+
+  HalfedgeCPtr cptrD() const {
+    return {startVert.cptrD(), endVert.cptrD(), pairedHalfedge.cptrD(),
+            face.cptrD()};
+  }
+
+  HalfedgeCPtr ptrD() const { return cptrD(); }
+
+  HalfedgePtr ptrH() {
+    return {startVert.ptrH(), endVert.ptrH(), pairedHalfedge.ptrH(),
+            face.ptrH()};
+  }
+
+  HalfedgeCPtr cptrH() const {
+    return {startVert.cptrH(), endVert.cptrH(), pairedHalfedge.cptrH(),
+            face.cptrH()};
+  }
+
+  struct Gather {
+    HalfedgeCPtr halfedge;
+    __host__ __device__ Halfedge operator()(int i) const { return halfedge[i]; }
+  };
+
+  using IterC =
+      thrust::transform_iterator<Gather, thrust::counting_iterator<int>>;
+
+  IterC begin() const {
+    return thrust::make_transform_iterator(countAt(0), Gather({cptrD()}));
+  }
+
+  IterC end() const { return begin() + size(); }
+};
+
 /**
  * This is a temporary edge structure which only stores edges forward and
  * references the halfedge it was created from.
@@ -147,12 +366,13 @@ struct TmpEdge {
 
 struct Halfedge2Tmp {
   __host__ __device__ void operator()(
-      thrust::tuple<TmpEdge&, const Halfedge&, int> inout) {
-    const Halfedge& halfedge = thrust::get<1>(inout);
-    int idx = thrust::get<2>(inout);
-    if (!halfedge.IsForward()) idx = -1;
+      thrust::tuple<TmpEdge&, int, int, int> inout) {
+    const int startVert = thrust::get<1>(inout);
+    const int endVert = thrust::get<2>(inout);
+    int idx = thrust::get<3>(inout);
+    if (startVert >= endVert) idx = -1;
 
-    thrust::get<0>(inout) = TmpEdge(halfedge.startVert, halfedge.endVert, idx);
+    thrust::get<0>(inout) = TmpEdge(startVert, endVert, idx);
   }
 };
 
@@ -162,11 +382,12 @@ struct TmpInvalid {
   }
 };
 
-VecDH<TmpEdge> inline CreateTmpEdges(const VecDH<Halfedge>& halfedge) {
+VecDH<TmpEdge> inline CreateTmpEdges(const HalfedgeVec& halfedge) {
   VecDH<TmpEdge> edges(halfedge.size());
   for_each_n(autoPolicy(edges.size()),
-             zip(edges.begin(), halfedge.begin(), countAt(0)), edges.size(),
-             Halfedge2Tmp());
+             zip(edges.begin(), halfedge.startVert.begin(),
+                 halfedge.endVert.begin(), countAt(0)),
+             edges.size(), Halfedge2Tmp());
   int numEdge =
       remove_if<decltype(edges.begin())>(
           autoPolicy(edges.size()), edges.begin(), edges.end(), TmpInvalid()) -
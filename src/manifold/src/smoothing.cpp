@@ -12,15 +12,19 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <thrust/functional.h>
+
 #include <map>
 
 #include "impl.h"
 #include "par.h"
+#include "trace.h"
 
 namespace {
 using namespace manifold;
+using namespace thrust::placeholders;
 
-__host__ __device__ glm::vec3 OrthogonalTo(glm::vec3 in, glm::vec3 ref) {
+__host__ __device__ vec3 OrthogonalTo(vec3 in, vec3 ref) {
   in -= glm::dot(in, ref) * ref;
   return in;
 }
@@ -35,7 +39,7 @@ __host__ __device__ int VertsPerTri(int edgeVerts) {
 
 struct Barycentric {
   int tri;
-  glm::vec3 uvw;
+  vec3 uvw;
 };
 
 struct ReindexHalfedge {
@@ -50,7 +54,7 @@ struct ReindexHalfedge {
 };
 
 struct EdgeVerts {
-  glm::vec3* vertPos;
+  vec3* vertPos;
   const int startIdx;
   const int n;
 
@@ -58,43 +62,42 @@ struct EdgeVerts {
     int edge = thrust::get<0>(in);
     TmpEdge edgeVerts = thrust::get<1>(in);
 
-    float invTotal = 1.0f / n;
+    Real invTotal = 1.0f / n;
     for (int i = 1; i < n; ++i)
       vertPos[startIdx + (n - 1) * edge + i - 1] =
-          (float(n - i) * vertPos[edgeVerts.first] +
-           float(i) * vertPos[edgeVerts.second]) *
-          invTotal;
+          (Real(n - i) * vertPos[edgeVerts.first] +
+           Real(i) * vertPos[edgeVerts.second]) * invTotal;
   }
 };
 
 struct InteriorVerts {
-  glm::vec3* vertPos;
-  glm::vec3* uvw;
+  vec3* vertPos;
+  vec3* uvw;
   BaryRef* triBary;
-  glm::vec3* uvwNew;
+  vec3* uvwNew;
   BaryRef* triBaryNew;
-  const glm::vec3* uvwOld;
+  const vec3* uvwOld;
   const int startIdx;
   const int n;
-  const Halfedge* halfedge;
+  HalfedgeCPtr halfedge;
 
   __host__ __device__ void operator()(thrust::tuple<int, BaryRef> in) {
     const int tri = thrust::get<0>(in);
     const BaryRef baryOld = thrust::get<1>(in);
 
-    glm::mat3 uvwOldTri;
+    mat3 uvwOldTri;
     for (int i : {0, 1, 2}) uvwOldTri[i] = UVW(baryOld.vertBary[i], uvwOld);
 
-    const float invTotal = 1.0f / n;
+    const Real invTotal = 1.0f / n;
     int posTri = tri * n * n;
     int posBary = tri * VertsPerTri(n + 1);
     int pos = startIdx + tri * VertsPerTri(n - 2);
     for (int i = 0; i <= n; ++i) {
       for (int j = 0; j <= n - i; ++j) {
         const int k = n - i - j;
-        const float u = invTotal * j;
-        const float v = invTotal * k;
-        const float w = invTotal * i;
+        const Real u = invTotal * j;
+        const Real v = invTotal * k;
+        const Real w = invTotal * i;
         const int first = posBary;
         uvw[posBary] = {u, v, w};
         uvwNew[posBary] = uvwOldTri * uvw[posBary];
@@ -130,7 +133,7 @@ struct InteriorVerts {
 
 struct SplitTris {
   glm::ivec3* triVerts;
-  const Halfedge* halfedge;
+  HalfedgeCPtr halfedge;
   const int* half2Edge;
   const int edgeIdx;
   const int triIdx;
@@ -191,42 +194,293 @@ struct SplitTris {
   }
 };
 
-struct SmoothBezier {
-  const glm::vec3* vertPos;
-  const glm::vec3* triNormal;
-  const glm::vec3* vertNormal;
-  const Halfedge* halfedge;
+/**
+ * The edge of this halfedge, as an index into the list of edges also indexed
+ * by half2Edge.
+ */
+__host__ __device__ int EdgeOf(HalfedgeCPtr halfedge, const int* half2Edge,
+                               int current) {
+  const Halfedge edge = halfedge[current];
+  return half2Edge[edge.IsForward() ? current : edge.pairedHalfedge];
+}
+
+/**
+ * The number of pieces of the interior grid of a triangle whose edges are
+ * split into edgeDivisions pieces. Any split triangle gets at least one
+ * interior vert, so that every edge can be connected to the interior.
+ */
+__host__ __device__ int TriDivisions(glm::ivec3 edgeDivisions) {
+  const int n =
+      glm::max(edgeDivisions[0], glm::max(edgeDivisions[1], edgeDivisions[2]));
+  return n == 1 ? 1 : glm::max(n, 3);
+}
+
+struct LengthDivisions {
+  const vec3* vertPos;
+  const Real length;
+
+  __host__ __device__ int operator()(const TmpEdge& edge) {
+    const Real edgeLength =
+        glm::length(vertPos[edge.second] - vertPos[edge.first]);
+    return glm::max(1, static_cast<int>(glm::ceil(edgeLength / length)));
+  }
+};
+
+struct PrecisionDivisions {
+  const vec3* vertPos;
+  const vec4* halfedgeTangent;
+  HalfedgeCPtr halfedge;
+  const Real precision;
+
+  __host__ __device__ int operator()(const TmpEdge& edge) {
+    const vec3 dir = SafeNormalize(vertPos[edge.second] - vertPos[edge.first]);
+    const vec3 tangent0 = halfedgeTangent[edge.halfedgeIdx];
+    const vec3 tangent1 =
+        halfedgeTangent[halfedge[edge.halfedgeIdx].pairedHalfedge];
+    // A cubic Bezier stays within 3/4 of the distance of its control points
+    // from its chord, and splitting it into n pieces divides this by n^2.
+    const Real deviation =
+        0.75f * glm::max(glm::length(OrthogonalTo(tangent0, dir)),
+                         glm::length(OrthogonalTo(tangent1, dir)));
+    return glm::max(
+        1, static_cast<int>(glm::ceil(glm::sqrt(deviation / precision))));
+  }
+};
+
+struct PartitionCounts {
+  HalfedgeCPtr halfedge;
+  const int* half2Edge;
+  const int* edgeDivisions;
 
   __host__ __device__ void operator()(
-      thrust::tuple<glm::vec4&, Halfedge> inOut) {
-    glm::vec4& tangent = thrust::get<0>(inOut);
+      thrust::tuple<int&, int&, int&, int> inOut) {
+    const int tri = thrust::get<3>(inOut);
+    glm::ivec3 div;
+    for (int i : {0, 1, 2})
+      div[i] = edgeDivisions[EdgeOf(halfedge, half2Edge, 3 * tri + i)];
+    const int n = TriDivisions(div);
+    const int numInterior = VertsPerTri(n - 2);
+    const int sumDiv = div[0] + div[1] + div[2];
+    thrust::get<0>(inOut) = numInterior;
+    thrust::get<1>(inOut) = sumDiv + numInterior;
+    thrust::get<2>(inOut) =
+        n == 1 ? 1 : sumDiv + 3 * (n - 3) + (n - 3) * (n - 3);
+  }
+};
+
+struct PartitionEdgeVerts {
+  vec3* vertPos;
+  const int* edgeDivisions;
+  const int* edgeVertOffset;
+
+  __host__ __device__ void operator()(thrust::tuple<int, TmpEdge> in) {
+    const int edge = thrust::get<0>(in);
+    const TmpEdge edgeVerts = thrust::get<1>(in);
+    const int n = edgeDivisions[edge];
+    const Real invTotal = 1.0f / n;
+    for (int i = 1; i < n; ++i)
+      vertPos[edgeVertOffset[edge] + i - 1] =
+          (Real(n - i) * vertPos[edgeVerts.first] +
+           Real(i) * vertPos[edgeVerts.second]) * invTotal;
+  }
+};
+
+/**
+ * Splits each triangle according to the divisions of its edges. The interior
+ * is a regular grid of n pieces, where n is the largest division, without its
+ * outer ring; each edge is then connected to the side of the grid along it by
+ * a strip, which zips the two rows of verts together in order. Edge verts
+ * come from the edge, so neighboring triangles share them.
+ */
+struct PartitionTris {
+  vec3* vertPos;
+  glm::ivec3* triVerts;
+  vec3* uvw;
+  BaryRef* triBary;
+  vec3* uvwNew;
+  BaryRef* triBaryNew;
+  const vec3* uvwOld;
+  const BaryRef* triBaryOld;
+  HalfedgeCPtr halfedge;
+  const int* half2Edge;
+  const int* edgeDivisions;
+  const int* edgeVertOffset;
+  const int* triVertOffset;
+  const int* baryOffset;
+  const int* triOffset;
+
+  struct Tri {
+    int tri;
+    glm::ivec3 corner;
+    glm::ivec3 edge;
+    glm::bvec3 forward;
+    glm::ivec3 div;
+    int n;
+    // first bary index of this triangle, and the local ones of its edge verts
+    // and interior verts.
+    int bary;
+    glm::ivec3 edgeBary;
+    int interiorBary;
+    int interiorVert;
+    BaryRef old;
+    mat3 uvwOldTri;
+    int pos;
+  };
+
+  // Verts are returned as (vert index, bary index).
+  __host__ __device__ glm::ivec2 Corner(const Tri& t, int i) const {
+    return {t.corner[i], t.bary + i};
+  }
+
+  // Vert k of the edge starting at corner i, which has div[i] + 1 of them.
+  __host__ __device__ glm::ivec2 EdgeVert(const Tri& t, int i, int k) const {
+    if (k == 0) return Corner(t, i);
+    if (k == t.div[i]) return Corner(t, (i + 1) % 3);
+    const int offset = t.forward[i] ? k - 1 : t.div[i] - k - 1;
+    return {edgeVertOffset[t.edge[i]] + offset, t.bary + t.edgeBary[i] + k - 1};
+  }
+
+  // The interior vert with barycentric coordinates (a, b, n - a - b) / n.
+  __host__ __device__ glm::ivec2 Interior(const Tri& t, int a, int b) const {
+    const int idx = (a - 1) * (t.n - 1) - (a - 1) * a / 2 + b - 1;
+    return {t.interiorVert + idx, t.bary + t.interiorBary + idx};
+  }
+
+  // Vert r of the side of the interior grid along the edge starting at
+  // corner i, which has n - 2 of them.
+  __host__ __device__ glm::ivec2 Ring(const Tri& t, int i, int r) const {
+    glm::ivec3 w;
+    w[i] = t.n - 2 - r;
+    w[(i + 1) % 3] = 1 + r;
+    w[(i + 2) % 3] = 1;
+    return Interior(t, w[0], w[1]);
+  }
+
+  __host__ __device__ void SetBary(const Tri& t, int bary, vec3 coords) const {
+    uvw[bary] = coords;
+    uvwNew[bary] = t.uvwOldTri * coords;
+  }
+
+  __host__ __device__ void AddTri(Tri& t, glm::ivec2 a, glm::ivec2 b,
+                                  glm::ivec2 c) const {
+    const glm::ivec3 vertBary(a.y, b.y, c.y);
+    triVerts[t.pos] = glm::ivec3(a.x, b.x, c.x);
+    triBary[t.pos] = {-1, -1, t.tri, vertBary};
+    triBaryNew[t.pos++] = {t.old.meshID, t.old.originalID, t.old.tri, vertBary};
+  }
+
+  __host__ __device__ void operator()(int tri) {
+    Tri t;
+    t.tri = tri;
+    for (int i : {0, 1, 2}) {
+      const Halfedge edge = halfedge[3 * tri + i];
+      t.corner[i] = edge.startVert;
+      t.forward[i] = edge.IsForward();
+      t.edge[i] = EdgeOf(halfedge, half2Edge, 3 * tri + i);
+      t.div[i] = edgeDivisions[t.edge[i]];
+    }
+    t.n = TriDivisions(t.div);
+    t.bary = baryOffset[tri];
+    t.edgeBary[0] = 3;
+    t.edgeBary[1] = t.edgeBary[0] + t.div[0] - 1;
+    t.edgeBary[2] = t.edgeBary[1] + t.div[1] - 1;
+    t.interiorBary = t.edgeBary[2] + t.div[2] - 1;
+    t.interiorVert = triVertOffset[tri];
+    t.pos = triOffset[tri];
+    t.old = triBaryOld[tri];
+    for (int i : {0, 1, 2}) t.uvwOldTri[i] = UVW(t.old.vertBary[i], uvwOld);
+
+    for (int i : {0, 1, 2}) {
+      vec3 coords(0);
+      coords[i] = 1;
+      SetBary(t, t.bary + i, coords);
+      const int j = (i + 1) % 3;
+      const Real invDiv = 1.0f / t.div[i];
+      for (int k = 1; k < t.div[i]; ++k) {
+        coords = vec3(0);
+        coords[i] = (t.div[i] - k) * invDiv;
+        coords[j] = k * invDiv;
+        SetBary(t, EdgeVert(t, i, k).y, coords);
+      }
+    }
+
+    if (t.n == 1) {
+      AddTri(t, Corner(t, 0), Corner(t, 1), Corner(t, 2));
+      return;
+    }
+
+    const int n = t.n;
+    const Real invN = 1.0f / n;
+    for (int a = 1; a < n - 1; ++a) {
+      for (int b = 1; b < n - a; ++b) {
+        const vec3 coords = vec3(a, b, n - a - b) * invN;
+        const glm::ivec2 vert = Interior(t, a, b);
+        SetBary(t, vert.y, coords);
+        vertPos[vert.x] = coords[0] * vertPos[t.corner[0]] +
+                          coords[1] * vertPos[t.corner[1]] +
+                          coords[2] * vertPos[t.corner[2]];
+        if (a + b < n - 1)
+          AddTri(t, vert, Interior(t, a + 1, b), Interior(t, a, b + 1));
+        if (a + b < n - 2)
+          AddTri(t, Interior(t, a + 1, b), Interior(t, a + 1, b + 1),
+                 Interior(t, a, b + 1));
+      }
+    }
+
+    for (int i : {0, 1, 2}) {
+      const int d = t.div[i];
+      const int m = n - 2;
+      int k = 0;
+      int r = 0;
+      while (k < d || r < m - 1) {
+        // advance along whichever row has the nearer next vert
+        if (r == m - 1 || (k < d && (k + 1) * n <= (r + 2) * d)) {
+          AddTri(t, EdgeVert(t, i, k), EdgeVert(t, i, k + 1), Ring(t, i, r));
+          ++k;
+        } else {
+          AddTri(t, EdgeVert(t, i, k), Ring(t, i, r + 1), Ring(t, i, r));
+          ++r;
+        }
+      }
+    }
+  }
+};
+
+struct SmoothBezier {
+  const vec3* vertPos;
+  const vec3* triNormal;
+  const vec3* vertNormal;
+  HalfedgeCPtr halfedge;
+
+  __host__ __device__ void operator()(thrust::tuple<vec4&, Halfedge> inOut) {
+    vec4& tangent = thrust::get<0>(inOut);
     const Halfedge edge = thrust::get<1>(inOut);
 
-    const glm::vec3 startV = vertPos[edge.startVert];
-    const glm::vec3 edgeVec = vertPos[edge.endVert] - startV;
-    const glm::vec3 edgeNormal =
+    const vec3 startV = vertPos[edge.startVert];
+    const vec3 edgeVec = vertPos[edge.endVert] - startV;
+    const vec3 edgeNormal =
         (triNormal[edge.face] + triNormal[halfedge[edge.pairedHalfedge].face]) /
-        2.0f;
-    glm::vec3 dir = glm::normalize(glm::cross(glm::cross(edgeNormal, edgeVec),
-                                              vertNormal[edge.startVert]));
+        Real(2);
+    vec3 dir = glm::normalize(glm::cross(glm::cross(edgeNormal, edgeVec),
+                                         vertNormal[edge.startVert]));
 
-    const float weight = glm::abs(glm::dot(dir, glm::normalize(edgeVec)));
+    const Real weight = glm::abs(glm::dot(dir, glm::normalize(edgeVec)));
     // Quadratic weighted bezier for circular interpolation
-    const glm::vec4 bz2 =
+    const vec4 bz2 =
         weight *
-        glm::vec4(startV + dir * glm::length(edgeVec) / (2 * weight), 1.0f);
+        vec4(startV + dir * glm::length(edgeVec) / (2 * weight), 1.0f);
     // Equivalent cubic weighted bezier
-    const glm::vec4 bz3 = glm::mix(glm::vec4(startV, 1.0f), bz2, 2 / 3.0f);
+    const vec4 bz3 = glm::mix(vec4(startV, 1.0f), bz2, 2 / 3.0f);
     // Convert from homogeneous form to geometric form
-    tangent = glm::vec4(glm::vec3(bz3) / bz3.w - startV, bz3.w);
+    tangent = vec4(vec3(bz3) / bz3.w - startV, bz3.w);
   }
 };
 
 struct TriBary2Vert {
   Barycentric* vertBary;
   int* lock;
-  const glm::vec3* uvw;
-  const Halfedge* halfedge;
+  const vec3* uvw;
+  HalfedgeCPtr halfedge;
 
   __host__ __device__ void operator()(thrust::tuple<BaryRef, int> in) {
     const BaryRef baryRef = thrust::get<0>(in);
@@ -241,70 +495,68 @@ struct TriBary2Vert {
 };
 
 struct InterpTri {
-  const Halfedge* halfedge;
-  const glm::vec4* halfedgeTangent;
-  const glm::vec3* vertPos;
+  HalfedgeCPtr halfedge;
+  const vec4* halfedgeTangent;
+  const vec3* vertPos;
 
-  __host__ __device__ glm::vec4 Homogeneous(glm::vec4 v) const {
+  __host__ __device__ vec4 Homogeneous(vec4 v) const {
     v.x *= v.w;
     v.y *= v.w;
     v.z *= v.w;
     return v;
   }
 
-  __host__ __device__ glm::vec4 Homogeneous(glm::vec3 v) const {
-    return glm::vec4(v, 1.0f);
+  __host__ __device__ vec4 Homogeneous(vec3 v) const {
+    return vec4(v, 1.0f);
   }
 
-  __host__ __device__ glm::vec3 HNormalize(glm::vec4 v) const {
-    return glm::vec3(v) / v.w;
+  __host__ __device__ vec3 HNormalize(vec4 v) const {
+    return vec3(v) / v.w;
   }
 
-  __host__ __device__ glm::vec4 Bezier(glm::vec3 point,
-                                       glm::vec4 tangent) const {
-    return Homogeneous(glm::vec4(point, 0) + tangent);
+  __host__ __device__ vec4 Bezier(vec3 point, vec4 tangent) const {
+    return Homogeneous(vec4(point, 0) + tangent);
   }
 
-  __host__ __device__ glm::mat2x4 CubicBezier2Linear(glm::vec4 p0, glm::vec4 p1,
-                                                     glm::vec4 p2, glm::vec4 p3,
-                                                     float x) const {
-    glm::mat2x4 out;
-    glm::vec4 p12 = glm::mix(p1, p2, x);
+  __host__ __device__ mat2x4 CubicBezier2Linear(vec4 p0, vec4 p1,
+                                                vec4 p2, vec4 p3,
+                                                Real x) const {
+    mat2x4 out;
+    vec4 p12 = glm::mix(p1, p2, x);
     out[0] = glm::mix(glm::mix(p0, p1, x), p12, x);
     out[1] = glm::mix(p12, glm::mix(p2, p3, x), x);
     return out;
   }
 
-  __host__ __device__ glm::vec3 BezierPoint(glm::mat2x4 points, float x) const {
+  __host__ __device__ vec3 BezierPoint(mat2x4 points, Real x) const {
     return HNormalize(glm::mix(points[0], points[1], x));
   }
 
-  __host__ __device__ glm::vec3 BezierTangent(glm::mat2x4 points) const {
+  __host__ __device__ vec3 BezierTangent(mat2x4 points) const {
     return glm::normalize(HNormalize(points[1]) - HNormalize(points[0]));
   }
 
-  __host__ __device__ void operator()(
-      thrust::tuple<glm::vec3&, Barycentric> inOut) {
-    glm::vec3& pos = thrust::get<0>(inOut);
+  __host__ __device__ void operator()(thrust::tuple<vec3&, Barycentric> inOut) {
+    vec3& pos = thrust::get<0>(inOut);
     const int tri = thrust::get<1>(inOut).tri;
-    const glm::vec3 uvw = thrust::get<1>(inOut).uvw;
+    const vec3 uvw = thrust::get<1>(inOut).uvw;
 
-    glm::vec4 posH(0);
-    const glm::mat3 corners = {vertPos[halfedge[3 * tri].startVert],
-                               vertPos[halfedge[3 * tri + 1].startVert],
-                               vertPos[halfedge[3 * tri + 2].startVert]};
+    vec4 posH(0);
+    const mat3 corners = {vertPos[halfedge[3 * tri].startVert],
+                          vertPos[halfedge[3 * tri + 1].startVert],
+                          vertPos[halfedge[3 * tri + 2].startVert]};
 
     for (const int i : {0, 1, 2}) {
       if (uvw[i] == 1) {
-        pos = glm::vec3(corners[i]);
+        pos = vec3(corners[i]);
         return;
       }
     }
 
-    const glm::mat3x4 tangentR = {halfedgeTangent[3 * tri],
-                                  halfedgeTangent[3 * tri + 1],
-                                  halfedgeTangent[3 * tri + 2]};
-    const glm::mat3x4 tangentL = {
+    const mat3x4 tangentR = {halfedgeTangent[3 * tri],
+                             halfedgeTangent[3 * tri + 1],
+                             halfedgeTangent[3 * tri + 2]};
+    const mat3x4 tangentL = {
         halfedgeTangent[halfedge[3 * tri + 2].pairedHalfedge],
         halfedgeTangent[halfedge[3 * tri].pairedHalfedge],
         halfedgeTangent[halfedge[3 * tri + 1].pairedHalfedge]};
@@ -312,31 +564,31 @@ struct InterpTri {
     for (const int i : {0, 1, 2}) {
       const int j = (i + 1) % 3;
       const int k = (i + 2) % 3;
-      const float x = uvw[k] / (1 - uvw[i]);
+      const Real x = uvw[k] / (1 - uvw[i]);
 
-      const glm::mat2x4 bez = CubicBezier2Linear(
+      const mat2x4 bez = CubicBezier2Linear(
           Homogeneous(corners[j]), Bezier(corners[j], tangentR[j]),
           Bezier(corners[k], tangentL[k]), Homogeneous(corners[k]), x);
-      const glm::vec3 end = BezierPoint(bez, x);
-      const glm::vec3 tangent = BezierTangent(bez);
-
-      const glm::vec3 jBitangent = SafeNormalize(OrthogonalTo(
-          glm::vec3(tangentL[j]), SafeNormalize(glm::vec3(tangentR[j]))));
-      const glm::vec3 kBitangent = SafeNormalize(OrthogonalTo(
-          glm::vec3(tangentR[k]), -SafeNormalize(glm::vec3(tangentL[k]))));
-      const glm::vec3 normal = SafeNormalize(
+      const vec3 end = BezierPoint(bez, x);
+      const vec3 tangent = BezierTangent(bez);
+
+      const vec3 jBitangent = SafeNormalize(OrthogonalTo(
+          vec3(tangentL[j]), SafeNormalize(vec3(tangentR[j]))));
+      const vec3 kBitangent = SafeNormalize(OrthogonalTo(
+          vec3(tangentR[k]), -SafeNormalize(vec3(tangentL[k]))));
+      const vec3 normal = SafeNormalize(
           glm::cross(glm::mix(jBitangent, kBitangent, x), tangent));
-      const glm::vec3 delta = OrthogonalTo(
-          glm::mix(glm::vec3(tangentL[j]), glm::vec3(tangentR[k]), x), normal);
-      const float deltaW = glm::mix(tangentL[j].w, tangentR[k].w, x);
+      const vec3 delta = OrthogonalTo(
+          glm::mix(vec3(tangentL[j]), vec3(tangentR[k]), x), normal);
+      const Real deltaW = glm::mix(tangentL[j].w, tangentR[k].w, x);
 
-      const glm::mat2x4 bez1 = CubicBezier2Linear(
-          Homogeneous(end), Homogeneous(glm::vec4(end + delta, deltaW)),
+      const mat2x4 bez1 = CubicBezier2Linear(
+          Homogeneous(end), Homogeneous(vec4(end + delta, deltaW)),
           Bezier(corners[i], glm::mix(tangentR[i], tangentL[i], x)),
           Homogeneous(corners[i]), uvw[i]);
-      const glm::vec3 p = BezierPoint(bez1, uvw[i]);
-      float w = uvw[j] * uvw[j] * uvw[k] * uvw[k];
-      posH += Homogeneous(glm::vec4(p, w));
+      const vec3 p = BezierPoint(bez1, uvw[i]);
+      Real w = uvw[j] * uvw[j] * uvw[k] * uvw[k];
+      posH += Homogeneous(vec4(p, w));
     }
     pos = HNormalize(posH);
   }
@@ -360,7 +612,7 @@ void Manifold::Impl::CreateTangents(
   halfedgeTangent_.resize(numHalfedge);
 
   for_each_n(autoPolicy(numHalfedge),
-             zip(halfedgeTangent_.begin(), halfedge_.cbegin()), numHalfedge,
+             zip(halfedgeTangent_.begin(), halfedge_.begin()), numHalfedge,
              SmoothBezier({vertPos_.cptrD(), faceNormal_.cptrD(),
                            vertNormal_.cptrD(), halfedge_.cptrD()}));
 
@@ -382,7 +634,7 @@ void Manifold::Impl::CreateTangents(
     for (Smoothness edge : sharpenedEdges) {
       if (edge.smoothness == 1) continue;
       edge.halfedge = oldHalfedge2New[edge.halfedge];
-      int pair = halfedge_[edge.halfedge].pairedHalfedge;
+      int pair = halfedge_.pairedHalfedge[edge.halfedge];
       if (edges.find(pair) == edges.end()) {
         edges[edge.halfedge] = {edge, {pair, 1}};
       } else {
@@ -393,12 +645,12 @@ void Manifold::Impl::CreateTangents(
     std::map<int, std::vector<Pair>> vertTangents;
     for (const auto& value : edges) {
       const Pair edge = value.second;
-      vertTangents[halfedge_[edge.first.halfedge].startVert].push_back(edge);
-      vertTangents[halfedge_[edge.second.halfedge].startVert].push_back(
+      vertTangents[halfedge_.startVert[edge.first.halfedge]].push_back(edge);
+      vertTangents[halfedge_.startVert[edge.second.halfedge]].push_back(
           {edge.second, edge.first});
     }
 
-    VecDH<glm::vec4>& tangent = halfedgeTangent_;
+    VecDH<vec4>& tangent = halfedgeTangent_;
     for (const auto& value : vertTangents) {
       const std::vector<Pair>& vert = value.second;
       // Sharp edges that end are smooth at their terminal vert.
@@ -406,25 +658,23 @@ void Manifold::Impl::CreateTangents(
       if (vert.size() == 2) {  // Make continuous edge
         const int first = vert[0].first.halfedge;
         const int second = vert[1].first.halfedge;
-        const glm::vec3 newTangent = glm::normalize(glm::vec3(tangent[first]) -
-                                                    glm::vec3(tangent[second]));
-        tangent[first] =
-            glm::vec4(glm::length(glm::vec3(tangent[first])) * newTangent,
-                      tangent[first].w);
-        tangent[second] =
-            glm::vec4(-glm::length(glm::vec3(tangent[second])) * newTangent,
-                      tangent[second].w);
-
-        auto SmoothHalf = [&](int first, int last, float smoothness) {
-          int current = NextHalfedge(halfedge_[first].pairedHalfedge);
+        const vec3 newTangent = glm::normalize(vec3(tangent[first]) -
+                                               vec3(tangent[second]));
+        tangent[first] = vec4(glm::length(vec3(tangent[first])) * newTangent,
+                              tangent[first].w);
+        tangent[second] = vec4(-glm::length(vec3(tangent[second])) * newTangent,
+                               tangent[second].w);
+
+        auto SmoothHalf = [&](int first, int last, Real smoothness) {
+          int current = NextHalfedge(halfedge_.pairedHalfedge[first]);
           while (current != last) {
-            const float cosBeta = glm::dot(
-                newTangent, glm::normalize(glm::vec3(tangent[current])));
-            const float factor =
+            const Real cosBeta = glm::dot(
+                newTangent, glm::normalize(vec3(tangent[current])));
+            const Real factor =
                 (1 - smoothness) * cosBeta * cosBeta + smoothness;
-            tangent[current] = glm::vec4(factor * glm::vec3(tangent[current]),
-                                         tangent[current].w);
-            current = NextHalfedge(halfedge_[current].pairedHalfedge);
+            tangent[current] = vec4(factor * vec3(tangent[current]),
+                                    tangent[current].w);
+            current = NextHalfedge(halfedge_.pairedHalfedge[current]);
           }
         };
 
@@ -434,7 +684,7 @@ void Manifold::Impl::CreateTangents(
                    (vert[1].second.smoothness + vert[0].first.smoothness) / 2);
 
       } else {  // Sharpen vertex uniformly
-        float smoothness = 0;
+        Real smoothness = 0;
         for (const Pair& pair : vert) {
           smoothness += pair.first.smoothness;
           smoothness += pair.second.smoothness;
@@ -444,9 +694,9 @@ void Manifold::Impl::CreateTangents(
         const int start = vert[0].first.halfedge;
         int current = start;
         do {
-          tangent[current] = glm::vec4(smoothness * glm::vec3(tangent[current]),
-                                       tangent[current].w);
-          current = NextHalfedge(halfedge_[current].pairedHalfedge);
+          tangent[current] = vec4(smoothness * vec3(tangent[current]),
+                                  tangent[current].w);
+          current = NextHalfedge(halfedge_.pairedHalfedge[current]);
         } while (current != start);
       }
     }
@@ -502,10 +752,133 @@ Manifold::Impl::MeshRelationD Manifold::Impl::Subdivide(int n) {
   return relation;
 }
 
+/**
+ * Split each edge into the number of pieces given by edgeDivisions, indexed
+ * like edges, which are the TmpEdges of this manifold. Each triangle is
+ * sub-triangulated to match (see PartitionTris). Like Subdivide(int), this
+ * doesn't run Finish().
+ */
+Manifold::Impl::MeshRelationD Manifold::Impl::Subdivide(
+    const VecDH<TmpEdge>& edges, const VecDH<int>& edgeDivisions) {
+  faceNormal_.resize(0);
+  vertNormal_.resize(0);
+  const int numVert = NumVert();
+  const int numEdge = NumEdge();
+  const int numTri = NumTri();
+  auto policy = autoPolicy(numTri);
+
+  VecDH<int> half2Edge(2 * numEdge);
+  for_each_n(policy, zip(countAt(0), edges.cbegin()), numEdge,
+             ReindexHalfedge({half2Edge.ptrD()}));
+
+  // Turns counts into offsets, returning their total.
+  auto Offsets = [](VecDH<int>& counts, int start) {
+    const int last = counts.back();
+    exclusive_scan(autoPolicy(counts.size()), counts.begin(), counts.end(),
+                   counts.begin(), start);
+    return counts.back() + last;
+  };
+
+  VecDH<int> edgeVertOffset(numEdge);
+  transform(policy, edgeDivisions.cbegin(), edgeDivisions.cend(),
+            edgeVertOffset.begin(), _1 - 1);
+  VecDH<int> triVertOffset(numTri);
+  VecDH<int> baryOffset(numTri);
+  VecDH<int> triOffset(numTri);
+  for_each_n(policy,
+             zip(triVertOffset.begin(), baryOffset.begin(), triOffset.begin(),
+                 countAt(0)),
+             numTri,
+             PartitionCounts({halfedge_.cptrD(), half2Edge.cptrD(),
+                              edgeDivisions.cptrD()}));
+  const int triVertStart = Offsets(edgeVertOffset, numVert);
+  const int numNewVert = Offsets(triVertOffset, triVertStart);
+  const int numBary = Offsets(baryOffset, 0);
+  const int numNewTri = Offsets(triOffset, 0);
+
+  vertPos_.resize(numNewVert);
+  MeshRelationD relation;
+  relation.barycentric.resize(numBary);
+  relation.triBary.resize(numNewTri);
+  MeshRelationD oldMeshRelation = std::move(meshRelation_);
+  meshRelation_.barycentric.resize(numBary);
+  meshRelation_.triBary.resize(numNewTri);
+  meshRelation_.originalID = oldMeshRelation.originalID;
+
+  for_each_n(policy, zip(countAt(0), edges.cbegin()), numEdge,
+             PartitionEdgeVerts({vertPos_.ptrD(), edgeDivisions.cptrD(),
+                                 edgeVertOffset.cptrD()}));
+  VecDH<glm::ivec3> triVerts(numNewTri);
+  for_each_n(
+      policy, countAt(0), numTri,
+      PartitionTris(
+          {vertPos_.ptrD(), triVerts.ptrD(), relation.barycentric.ptrD(),
+           relation.triBary.ptrD(), meshRelation_.barycentric.ptrD(),
+           meshRelation_.triBary.ptrD(), oldMeshRelation.barycentric.cptrD(),
+           oldMeshRelation.triBary.cptrD(), halfedge_.cptrD(),
+           half2Edge.cptrD(), edgeDivisions.cptrD(), edgeVertOffset.cptrD(),
+           triVertOffset.cptrD(), baryOffset.cptrD(), triOffset.cptrD()}));
+  CreateHalfedges(triVerts);
+  return relation;
+}
+
 void Manifold::Impl::Refine(int n) {
+  TraceSpan span("Refine");
+  span.Arg("n", n);
+  span.Arg("numTriIn", NumTri());
   Manifold::Impl old = *this;
   MeshRelationD relation = Subdivide(n);
+  Interpolate(old, relation);
+  span.Arg("numTri", NumTri());
+}
 
+/**
+ * Refines every edge into pieces no longer than length.
+ */
+void Manifold::Impl::RefineToLength(Real length) {
+  if (IsEmpty() || !(length > 0)) return;
+  VecDH<TmpEdge> edges = CreateTmpEdges(halfedge_);
+  VecDH<int> edgeDivisions(edges.size());
+  transform(autoPolicy(edges.size()), edges.cbegin(), edges.cend(),
+            edgeDivisions.begin(), LengthDivisions({vertPos_.cptrD(), length}));
+  Refine(edges, edgeDivisions);
+}
+
+/**
+ * Refines each edge into as many pieces as its smooth curve, as given by
+ * halfedgeTangent_, needs to stay within precision of its straight pieces.
+ * Without tangents, the edges are already straight and nothing is done.
+ */
+void Manifold::Impl::RefineToPrecision(Real precision) {
+  if (IsEmpty() || !(precision > 0) ||
+      halfedgeTangent_.size() != halfedge_.size())
+    return;
+  VecDH<TmpEdge> edges = CreateTmpEdges(halfedge_);
+  VecDH<int> edgeDivisions(edges.size());
+  transform(autoPolicy(edges.size()), edges.cbegin(), edges.cend(),
+            edgeDivisions.begin(),
+            PrecisionDivisions({vertPos_.cptrD(), halfedgeTangent_.cptrD(),
+                                halfedge_.cptrD(), precision}));
+  Refine(edges, edgeDivisions);
+}
+
+void Manifold::Impl::Refine(const VecDH<TmpEdge>& edges,
+                            const VecDH<int>& edgeDivisions) {
+  const int maxDivisions =
+      reduce<int>(autoPolicy(edgeDivisions.size()), edgeDivisions.cbegin(),
+                  edgeDivisions.cend(), 1, thrust::maximum<int>());
+  if (maxDivisions == 1) return;
+  Manifold::Impl old = *this;
+  MeshRelationD relation = Subdivide(edges, edgeDivisions);
+  Interpolate(old, relation);
+}
+
+/**
+ * Moves the verts of a refined manifold onto the smooth surface of the old
+ * one, if it has halfedgeTangent_, and finishes it.
+ */
+void Manifold::Impl::Interpolate(const Impl& old,
+                                 const MeshRelationD& relation) {
   if (old.halfedgeTangent_.size() == old.halfedge_.size()) {
     VecDH<Barycentric> vertBary(NumVert());
     VecDH<int> lock(NumVert(), 0);
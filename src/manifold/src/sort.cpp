@@ -16,12 +16,11 @@
 
 #include "impl.h"
 #include "par.h"
+#include "trace.h"
 
 namespace {
 using namespace manifold;
 
-constexpr uint32_t kNoCode = 0xFFFFFFFFu;
-
 struct Extrema : public thrust::binary_function<Halfedge, Halfedge, Halfedge> {
   __host__ __device__ void MakeForward(Halfedge& a) {
     if (!a.IsForward()) {
@@ -46,40 +45,19 @@ struct Extrema : public thrust::binary_function<Halfedge, Halfedge, Halfedge> {
   }
 };
 
-__host__ __device__ uint32_t SpreadBits3(uint32_t v) {
-  v = 0xFF0000FFu & (v * 0x00010001u);
-  v = 0x0F00F00Fu & (v * 0x00000101u);
-  v = 0xC30C30C3u & (v * 0x00000011u);
-  v = 0x49249249u & (v * 0x00000005u);
-  return v;
-}
-
-__host__ __device__ uint32_t MortonCode(glm::vec3 position, Box bBox) {
-  // Unreferenced vertices are marked NaN, and this will sort them to the end
-  // (the Morton code only uses the first 30 of 32 bits).
-  if (isnan(position.x)) return kNoCode;
-
-  glm::vec3 xyz = (position - bBox.min) / (bBox.max - bBox.min);
-  xyz = glm::min(glm::vec3(1023.0f), glm::max(glm::vec3(0.0f), 1024.0f * xyz));
-  uint32_t x = SpreadBits3(static_cast<uint32_t>(xyz.x));
-  uint32_t y = SpreadBits3(static_cast<uint32_t>(xyz.y));
-  uint32_t z = SpreadBits3(static_cast<uint32_t>(xyz.z));
-  return x * 4 + y * 2 + z;
-}
-
 struct Morton {
   const Box bBox;
 
   __host__ __device__ void operator()(
-      thrust::tuple<uint32_t&, const glm::vec3&> inout) {
-    glm::vec3 position = thrust::get<1>(inout);
+      thrust::tuple<uint32_t&, const vec3&> inout) {
+    vec3 position = thrust::get<1>(inout);
     thrust::get<0>(inout) = MortonCode(position, bBox);
   }
 };
 
 struct FaceMortonBox {
-  const Halfedge* halfedge;
-  const glm::vec3* vertPos;
+  const HalfedgeCPtr halfedge;
+  const vec3* vertPos;
   const Box bBox;
 
   __host__ __device__ void operator()(
@@ -96,10 +74,10 @@ struct FaceMortonBox {
       return;
     }
 
-    glm::vec3 center(0.0f);
+    vec3 center(0.0f);
 
     for (const int i : {0, 1, 2}) {
-      const glm::vec3 pos = vertPos[halfedge[3 * face + i].startVert];
+      const vec3 pos = vertPos[halfedge[3 * face + i].startVert];
       center += pos;
       faceBox.Union(pos);
     }
@@ -109,53 +87,84 @@ struct FaceMortonBox {
   }
 };
 
-struct Reindex {
-  const int* indexInv;
+struct ReindexFace {
+  HalfedgePtr halfedge;
+  vec4* halfedgeTangent;
+  HalfedgeCPtr oldHalfedge;
+  const vec4* oldHalfedgeTangent;
+  const int* faceNew2Old;
+  const int* faceOld2New;
+  const int* vertOld2New;
 
-  __host__ __device__ void operator()(Halfedge& edge) {
-    if (edge.startVert < 0) return;
-    edge.startVert = indexInv[edge.startVert];
-    edge.endVert = indexInv[edge.endVert];
+  __host__ __device__ void operator()(int newFace) {
+    const int oldFace = faceNew2Old[newFace];
+    for (const int i : {0, 1, 2}) {
+      const int oldEdge = 3 * oldFace + i;
+      Halfedge edge = oldHalfedge[oldEdge];
+      edge.face = newFace;
+      if (vertOld2New != nullptr) {
+        edge.startVert = vertOld2New[edge.startVert];
+        edge.endVert = vertOld2New[edge.endVert];
+      }
+      const int pairedFace = edge.pairedHalfedge / 3;
+      const int offset = edge.pairedHalfedge - 3 * pairedFace;
+      edge.pairedHalfedge = 3 * faceOld2New[pairedFace] + offset;
+      const int newEdge = 3 * newFace + i;
+      halfedge.Set(newEdge, edge);
+      if (oldHalfedgeTangent != nullptr) {
+        halfedgeTangent[newEdge] = oldHalfedgeTangent[oldEdge];
+      }
+    }
   }
 };
 
-template <typename T>
-void Permute(VecDH<T>& inOut, const VecDH<int>& new2Old) {
-  VecDH<T> tmp(std::move(inOut));
-  inOut.resize(new2Old.size());
-  gather(autoPolicy(new2Old.size()), new2Old.begin(), new2Old.end(),
-         tmp.begin(), inOut.begin());
-}
-
-template void Permute<BaryRef>(VecDH<BaryRef>&, const VecDH<int>&);
-template void Permute<glm::vec3>(VecDH<glm::vec3>&, const VecDH<int>&);
-
-struct ReindexFace {
-  Halfedge* halfedge;
-  glm::vec4* halfedgeTangent;
-  const Halfedge* oldHalfedge;
-  const glm::vec4* oldHalfedgeTangent;
+struct FinishFace {
+  HalfedgePtr halfedge;
+  vec4* halfedgeTangent;
+  BaryRef* triBary;
+  vec3* faceNormal;
+  vec3* vertNormal;
+  HalfedgeCPtr oldHalfedge;
+  const vec4* oldHalfedgeTangent;
+  const BaryRef* oldTriBary;
+  const vec3* oldFaceNormal;
+  const vec3* vertPos;
   const int* faceNew2Old;
   const int* faceOld2New;
+  const int* vertOld2New;
 
   __host__ __device__ void operator()(int newFace) {
     const int oldFace = faceNew2Old[newFace];
+    glm::ivec3 triVerts;
     for (const int i : {0, 1, 2}) {
       const int oldEdge = 3 * oldFace + i;
       Halfedge edge = oldHalfedge[oldEdge];
+      edge.startVert = vertOld2New[edge.startVert];
+      edge.endVert = vertOld2New[edge.endVert];
       edge.face = newFace;
       const int pairedFace = edge.pairedHalfedge / 3;
       const int offset = edge.pairedHalfedge - 3 * pairedFace;
       edge.pairedHalfedge = 3 * faceOld2New[pairedFace] + offset;
       const int newEdge = 3 * newFace + i;
-      halfedge[newEdge] = edge;
+      halfedge.Set(newEdge, edge);
+      triVerts[i] = edge.startVert;
       if (oldHalfedgeTangent != nullptr) {
         halfedgeTangent[newEdge] = oldHalfedgeTangent[oldEdge];
       }
     }
+    if (oldTriBary != nullptr) triBary[newFace] = oldTriBary[oldFace];
+
+    vec3& triNormal = faceNormal[newFace];
+    if (oldFaceNormal != nullptr) triNormal = oldFaceNormal[oldFace];
+    AddAngleWeightedNormal(vertNormal, vertPos, triVerts, triNormal,
+                           oldFaceNormal == nullptr);
   }
 };
 
+struct Normalize {
+  __host__ __device__ void operator()(vec3& v) { v = SafeNormalize(v); }
+};
+
 }  // namespace
 
 namespace manifold {
@@ -164,9 +173,27 @@ namespace manifold {
  * Once halfedge_ has been filled in, this function can be called to create the
  * rest of the internal data structures. This function also removes the verts
  * and halfedges flagged for removal (NaN verts and -1 halfedges).
+ *
+ * The face boxes and Morton codes don't depend on the vert order, so they are
+ * found before the verts are sorted. Both sorts share one permutation buffer,
+ * and a single pass over the sorted faces then gathers them, remaps their
+ * verts and accumulates the vert normals. The collider is built directly on
+ * the sorted face Morton codes.
+ *
+ * If vertNew2Old is given, it is filled with the index each remaining vert
+ * had before, so callers can follow the verts through their removal and
+ * reordering.
  */
-void Manifold::Impl::Finish() {
+void Manifold::Impl::Finish(VecDH<int>* vertNew2Old) {
+  properties_.Invalidate();
+  if (vertNew2Old != nullptr) {
+    vertNew2Old->resize(NumVert());
+    sequence(autoPolicy(NumVert()), vertNew2Old->begin(), vertNew2Old->end());
+  }
   if (halfedge_.size() == 0) return;
+  TraceSpan span("Finish");
+  span.Arg("numVert", NumVert());
+  span.Arg("numTri", NumTri());
 
   CalculateBBox();
   SetPrecision(precision_);
@@ -176,11 +203,33 @@ void Manifold::Impl::Finish() {
     return;
   }
 
-  SortVerts();
+  ASSERT(meshRelation_.triBary.size() == NumTri() ||
+             meshRelation_.triBary.size() == 0,
+         logicErr, "Mesh Relation doesn't fit!");
+  ASSERT(faceNormal_.size() == NumTri() || faceNormal_.size() == 0, logicErr,
+         "faceNormal size = " + std::to_string(faceNormal_.size()) +
+             ", NumTri = " + std::to_string(NumTri()));
+  // TODO: figure out why this has a flaky failure and then enable reading
+  // vertNormals from a Mesh.
+  // ASSERT(vertNormal_.size() == NumVert() || vertNormal_.size() == 0,
+  // logicErr,
+  //        "vertNormal size = " + std::to_string(vertNormal_.size()) +
+  //            ", NumVert = " + std::to_string(NumVert()));
+
   VecDH<Box> faceBox;
   VecDH<uint32_t> faceMorton;
   GetFaceBoxMorton(faceBox, faceMorton);
-  SortFaces(faceBox, faceMorton);
+
+  VecDH<int> new2Old;
+  VecDH<int> vertOld2New;
+  SortVerts(new2Old, vertOld2New);
+  if (vertNew2Old != nullptr) {
+    vertNew2Old->resize(NumVert());
+    copy(autoPolicy(NumVert()), new2Old.begin(), new2Old.begin() + NumVert(),
+         vertNew2Old->begin());
+  }
+  SortFaces(faceBox, faceMorton, new2Old);
+  GatherFaces(new2Old, vertOld2New);
   if (halfedge_.size() == 0) return;
 
   ASSERT(halfedge_.size() % 6 == 0, topologyErr,
@@ -202,39 +251,32 @@ void Manifold::Impl::Finish() {
          "Halfedge index is negative!");
   ASSERT(extrema.pairedHalfedge < 2 * NumEdge(), topologyErr,
          "Halfedge index exceeds number of halfedges!");
-  ASSERT(meshRelation_.triBary.size() == NumTri() ||
-             meshRelation_.triBary.size() == 0,
-         logicErr, "Mesh Relation doesn't fit!");
-  ASSERT(faceNormal_.size() == NumTri() || faceNormal_.size() == 0, logicErr,
-         "faceNormal size = " + std::to_string(faceNormal_.size()) +
-             ", NumTri = " + std::to_string(NumTri()));
-  // TODO: figure out why this has a flaky failure and then enable reading
-  // vertNormals from a Mesh.
-  // ASSERT(vertNormal_.size() == NumVert() || vertNormal_.size() == 0,
-  // logicErr,
-  //        "vertNormal size = " + std::to_string(vertNormal_.size()) +
-  //            ", NumVert = " + std::to_string(NumVert()));
 
-  CalculateNormals();
   collider_ = Collider(faceBox, faceMorton);
 }
 
 /**
- * Sorts the vertices according to their Morton code.
+ * Sorts the vertices according to their Morton code, removing those flagged
+ * with NaNs. The halfedges are not updated; instead vertOld2New is filled in
+ * for GatherFaces to apply. vertNew2Old is only scratch space, returned so
+ * that its buffer can be reused.
  */
-void Manifold::Impl::SortVerts() {
+void Manifold::Impl::SortVerts(VecDH<int>& vertNew2Old,
+                               VecDH<int>& vertOld2New) {
   const int numVert = NumVert();
   VecDH<uint32_t> vertMorton(numVert);
-  auto policy = autoPolicy(numVert);
+  auto policy = autoPolicy(numVert, KernelCost::Sort);
   for_each_n(policy, zip(vertMorton.begin(), vertPos_.cbegin()), numVert,
              Morton({bBox_}));
 
-  VecDH<int> vertNew2Old(numVert);
+  vertNew2Old.resize(numVert);
   sequence(policy, vertNew2Old.begin(), vertNew2Old.end());
   sort_by_key(policy, vertMorton.begin(), vertMorton.end(),
               zip(vertPos_.begin(), vertNew2Old.begin()));
 
-  ReindexVerts(vertNew2Old, numVert);
+  vertOld2New.resize(numVert);
+  scatter(autoPolicy(numVert), countAt(0), countAt(numVert),
+          vertNew2Old.begin(), vertOld2New.begin());
 
   // Verts were flagged for removal with NaNs and assigned kNoCode to sort
   // them to the end, which allows them to be removed.
@@ -243,24 +285,6 @@ void Manifold::Impl::SortVerts() {
                                          vertMorton.end(), kNoCode) -
       vertMorton.begin();
   vertPos_.resize(newNumVert);
-  if (vertNormal_.size() == numVert) {
-    Permute(vertNormal_, vertNew2Old);
-    vertNormal_.resize(newNumVert);
-  }
-}
-
-/**
- * Updates the halfedges to point to new vert indices based on a mapping,
- * vertNew2Old. This may be a subset, so the total number of original verts is
- * also given.
- */
-void Manifold::Impl::ReindexVerts(const VecDH<int>& vertNew2Old,
-                                  int oldNumVert) {
-  VecDH<int> vertOld2New(oldNumVert);
-  scatter(autoPolicy(oldNumVert), countAt(0), countAt(NumVert()),
-          vertNew2Old.begin(), vertOld2New.begin());
-  for_each(autoPolicy(oldNumVert), halfedge_.begin(), halfedge_.end(),
-           Reindex({vertOld2New.cptrD()}));
 }
 
 /**
@@ -279,12 +303,13 @@ void Manifold::Impl::GetFaceBoxMorton(VecDH<Box>& faceBox,
 
 /**
  * Sorts the faces of this manifold according to their input Morton code. The
- * bounding box and Morton code arrays are also sorted accordingly.
+ * bounding box and Morton code arrays are also sorted accordingly, and
+ * faceNew2Old returns the permutation, without the faces flagged for removal.
  */
-void Manifold::Impl::SortFaces(VecDH<Box>& faceBox,
-                               VecDH<uint32_t>& faceMorton) {
-  VecDH<int> faceNew2Old(NumTri());
-  auto policy = autoPolicy(faceNew2Old.size());
+void Manifold::Impl::SortFaces(VecDH<Box>& faceBox, VecDH<uint32_t>& faceMorton,
+                               VecDH<int>& faceNew2Old) const {
+  faceNew2Old.resize(NumTri());
+  auto policy = autoPolicy(faceNew2Old.size(), KernelCost::Sort);
   sequence(policy, faceNew2Old.begin(), faceNew2Old.end());
 
   sort_by_key(policy, faceMorton.begin(), faceMorton.end(),
@@ -299,24 +324,24 @@ void Manifold::Impl::SortFaces(VecDH<Box>& faceBox,
   faceBox.resize(newNumTri);
   faceMorton.resize(newNumTri);
   faceNew2Old.resize(newNumTri);
-
-  GatherFaces(faceNew2Old);
 }
 
 /**
- * Creates the halfedge_ vector for this manifold by copying a set of faces from
- * another manifold, given by oldHalfedge. Input faceNew2Old defines the old
- * faces to gather into this.
+ * Rebuilds the halfedges of this manifold in the order of faceNew2Old, with
+ * their verts remapped by vertOld2New, along with the face attributes. The
+ * face normals are calculated if missing and the vert normals are found in the
+ * same pass.
  */
-void Manifold::Impl::GatherFaces(const VecDH<int>& faceNew2Old) {
+void Manifold::Impl::GatherFaces(const VecDH<int>& faceNew2Old,
+                                 const VecDH<int>& vertOld2New) {
   const int numTri = faceNew2Old.size();
-  if (meshRelation_.triBary.size() == NumTri())
-    Permute(meshRelation_.triBary, faceNew2Old);
-
-  if (faceNormal_.size() == NumTri()) Permute(faceNormal_, faceNew2Old);
+  const bool hasTriBary = meshRelation_.triBary.size() == NumTri();
+  const bool hasFaceNormal = faceNormal_.size() == NumTri();
 
-  VecDH<Halfedge> oldHalfedge(std::move(halfedge_));
-  VecDH<glm::vec4> oldHalfedgeTangent(std::move(halfedgeTangent_));
+  HalfedgeVec oldHalfedge(std::move(halfedge_));
+  VecDH<vec4> oldHalfedgeTangent(std::move(halfedgeTangent_));
+  VecDH<BaryRef> oldTriBary(std::move(meshRelation_.triBary));
+  VecDH<vec3> oldFaceNormal(std::move(faceNormal_));
   VecDH<int> faceOld2New(oldHalfedge.size() / 3);
   auto policy = autoPolicy(numTri);
   scatter(policy, countAt(0), countAt(numTri), faceNew2Old.begin(),
@@ -324,14 +349,43 @@ void Manifold::Impl::GatherFaces(const VecDH<int>& faceNew2Old) {
 
   halfedge_.resize(3 * numTri);
   if (oldHalfedgeTangent.size() != 0) halfedgeTangent_.resize(3 * numTri);
-  for_each_n(policy, countAt(0), numTri,
-             ReindexFace({halfedge_.ptrD(), halfedgeTangent_.ptrD(),
-                          oldHalfedge.cptrD(), oldHalfedgeTangent.cptrD(),
-                          faceNew2Old.cptrD(), faceOld2New.cptrD()}));
+  if (hasTriBary) meshRelation_.triBary.resize(numTri);
+  faceNormal_.resize(numTri);
+  vertNormal_.resize(NumVert());
+  fill(autoPolicy(NumVert()), vertNormal_.begin(), vertNormal_.end(), vec3(0));
+  for_each_n(
+      policy, countAt(0), numTri,
+      FinishFace({halfedge_.ptrD(), halfedgeTangent_.ptrD(),
+                  meshRelation_.triBary.ptrD(), faceNormal_.ptrD(),
+                  vertNormal_.ptrD(), oldHalfedge.cptrD(),
+                  oldHalfedgeTangent.cptrD(),
+                  hasTriBary ? oldTriBary.cptrD() : nullptr,
+                  hasFaceNormal ? oldFaceNormal.cptrD() : nullptr,
+                  vertPos_.cptrD(), faceNew2Old.cptrD(), faceOld2New.cptrD(),
+                  vertOld2New.cptrD()}));
+  for_each(autoPolicy(NumVert()), vertNormal_.begin(), vertNormal_.end(),
+           Normalize());
 }
 
 void Manifold::Impl::GatherFaces(const Impl& old,
                                  const VecDH<int>& faceNew2Old) {
+  VecDH<int> faceOld2New(old.NumTri());
+  scatter(autoPolicy(faceNew2Old.size()), countAt(0),
+          countAt(faceNew2Old.size()), faceNew2Old.begin(),
+          faceOld2New.begin());
+  GatherFaces(old, faceNew2Old, faceOld2New, VecDH<int>());
+}
+
+/**
+ * Gathers the faces of old given by faceNew2Old, which must include both sides
+ * of each of their edges, as faceOld2New, which need only be valid for those.
+ * If vertOld2New is not empty, the verts are reindexed by it as well, so that
+ * the old maps can be shared by any number of subsets of old.
+ */
+void Manifold::Impl::GatherFaces(const Impl& old,
+                                 const VecDH<int>& faceNew2Old,
+                                 const VecDH<int>& faceOld2New,
+                                 const VecDH<int>& vertOld2New) {
   const int numTri = faceNew2Old.size();
   meshRelation_.triBary.resize(numTri);
   auto policy = autoPolicy(numTri);
@@ -345,15 +399,12 @@ void Manifold::Impl::GatherFaces(const Impl& old,
            old.faceNormal_.begin(), faceNormal_.begin());
   }
 
-  VecDH<int> faceOld2New(old.NumTri());
-  scatter(policy, countAt(0), countAt(numTri), faceNew2Old.begin(),
-          faceOld2New.begin());
-
   halfedge_.resize(3 * numTri);
   if (old.halfedgeTangent_.size() != 0) halfedgeTangent_.resize(3 * numTri);
   for_each_n(policy, countAt(0), numTri,
              ReindexFace({halfedge_.ptrD(), halfedgeTangent_.ptrD(),
                           old.halfedge_.cptrD(), old.halfedgeTangent_.cptrD(),
-                          faceNew2Old.cptrD(), faceOld2New.cptrD()}));
+                          faceNew2Old.cptrD(), faceOld2New.cptrD(),
+                          vertOld2New.cptrD()}));
 }
 }  // namespace manifold
@@ -22,8 +22,7 @@ namespace manifold {
 /** @addtogroup Private
  *  @{
  */
-std::vector<glm::ivec3> Triangulate(const Polygons &polys,
-                                    float precision = -1);
+std::vector<glm::ivec3> Triangulate(const Polygons &polys, Real precision = -1);
 
 ExecutionParams &PolygonParams();
 /** @} */
@@ -15,6 +15,8 @@
 #include "polygon.h"
 
 #include <algorithm>
+#include <exception>
+#include <limits>
 #include <list>
 #include <map>
 #include <queue>
@@ -22,6 +24,7 @@
 #include <stack>
 
 #include "optional_assert.h"
+#include "par.h"
 
 namespace {
 using namespace manifold;
@@ -139,8 +142,8 @@ void CheckTopology(const std::vector<glm::ivec3> &triangles,
 }
 
 void CheckGeometry(const std::vector<glm::ivec3> &triangles,
-                   const Polygons &polys, float precision) {
-  std::map<int, glm::vec2> vertPos;
+                   const Polygons &polys, Real precision) {
+  std::map<int, vec2> vertPos;
   for (const auto &poly : polys) {
     for (int i = 0; i < poly.size(); ++i) {
       vertPos[poly[i].idx] = poly[i].pos;
@@ -173,7 +176,7 @@ void Dump(const Polygons &polys) {
 }
 
 void PrintFailure(const std::exception &e, const Polygons &polys,
-                  std::vector<glm::ivec3> &triangles, float precision) {
+                  std::vector<glm::ivec3> &triangles, Real precision) {
   std::cout << "-----------------------------------" << std::endl;
   std::cout << "Triangulation failed! Precision = " << precision << std::endl;
   std::cout << e.what() << std::endl;
@@ -196,9 +199,9 @@ void PrintFailure(const std::exception &e, const Polygons &polys,
  */
 class Monotones {
  public:
-  Monotones(const Polygons &polys, float precision) : precision_(precision) {
+  Monotones(const Polygons &polys, Real precision) : precision_(precision) {
     VertItr start, last, current;
-    float bound = 0;
+    Real bound = 0;
     for (const SimplePolygon &poly : polys) {
       for (int i = 0; i < poly.size(); ++i) {
         monotones_.push_back({poly[i].pos,  //
@@ -302,7 +305,7 @@ class Monotones {
 #endif
   }
 
-  float GetPrecision() const { return precision_; }
+  Real GetPrecision() const { return precision_; }
 
  private:
   struct VertAdj;
@@ -314,7 +317,7 @@ class Monotones {
   std::list<VertAdj> monotones_;     // sweep-line list of verts
   std::list<EdgePair> activePairs_;  // west to east list of monotone edge pairs
   std::list<EdgePair> inactivePairs_;  // completed monotones
-  float precision_;  // a triangle of this height or less is degenerate
+  Real precision_;  // a triangle of this height or less is degenerate
 
   /**
    * This is the data structure of the polygons themselves. They are stored as a
@@ -324,7 +327,7 @@ class Monotones {
    * from the mesh Boolean algorithm.
    */
   struct VertAdj {
-    glm::vec2 pos;
+    vec2 pos;
     int mesh_idx;  // This is a global index into the manifold.
     int index;
     VertItr left, right;
@@ -341,7 +344,7 @@ class Monotones {
              (left->pos.y == pos.y && right->pos.y == pos.y &&
               left->pos.x <= pos.x && right->pos.x < pos.x);
     }
-    bool IsPast(const VertItr other, float precision) const {
+    bool IsPast(const VertItr other, Real precision) const {
       return pos.y > other->pos.y + precision;
     }
     bool operator<(const VertAdj &other) const { return pos.y < other.pos.y; }
@@ -368,7 +371,7 @@ class Monotones {
     PairItr nextPair;
     bool westCertain, eastCertain, startCertain;
 
-    int WestOf(VertItr vert, float precision) const {
+    int WestOf(VertItr vert, Real precision) const {
       int westOf = CCW(vEast->right->pos, vEast->pos, vert->pos, precision);
       if (westOf == 0 && !vert->right->Processed())
         westOf =
@@ -378,7 +381,7 @@ class Monotones {
       return westOf;
     }
 
-    int EastOf(VertItr vert, float precision) const {
+    int EastOf(VertItr vert, Real precision) const {
       int eastOf = CCW(vWest->pos, vWest->left->pos, vert->pos, precision);
       if (eastOf == 0 && !vert->right->Processed())
         eastOf = CCW(vWest->pos, vWest->left->pos, vert->right->pos, precision);
@@ -394,7 +397,7 @@ class Monotones {
    */
   class Triangulator {
    public:
-    Triangulator(VertItr vert, float precision) : precision_(precision) {
+    Triangulator(VertItr vert, Real precision) : precision_(precision) {
       reflex_chain_.push(vert);
       other_side_ = vert;
     }
@@ -457,7 +460,7 @@ class Monotones {
     VertItr other_side_;  // The end vertex across from the reflex chain
     bool onRight_;        // The side the reflex chain is on
     int triangles_output_ = 0;
-    const float precision_;
+    const Real precision_;
 
     void AddTriangle(std::vector<glm::ivec3> &triangles, VertItr v0, VertItr v1,
                      VertItr v2) {
@@ -493,8 +496,8 @@ class Monotones {
     return type == WESTSIDE ? vert->eastPair : vert->westPair;
   }
 
-  bool Coincident(glm::vec2 p0, glm::vec2 p1) const {
-    glm::vec2 sep = p0 - p1;
+  bool Coincident(vec2 p0, vec2 p1) const {
+    vec2 sep = p0 - p1;
     return glm::dot(sep, sep) < precision_ * precision_;
   }
 
@@ -609,8 +612,8 @@ class Monotones {
       }
       if (isHole != 0) return isHole;
 
-      glm::vec2 edgeLeft = left->pos - center->pos;
-      glm::vec2 edgeRight = right->pos - center->pos;
+      vec2 edgeLeft = left->pos - center->pos;
+      vec2 edgeRight = right->pos - center->pos;
       if (glm::dot(edgeLeft, edgeRight) > 0) {
         if (glm::dot(edgeLeft, edgeLeft) < glm::dot(edgeRight, edgeRight)) {
           center = left;
@@ -640,10 +643,10 @@ class Monotones {
     VertItr left = start;
     VertItr right = left->right;
     // Find the longest edge to improve error
-    float length2 = 0;
+    Real length2 = 0;
     while (right != start) {
-      glm::vec2 edge = left->pos - right->pos;
-      const float l2 = glm::dot(edge, edge);
+      vec2 edge = left->pos - right->pos;
+      const Real l2 = glm::dot(edge, edge);
       if (l2 > length2) {
         length2 = l2;
         vert = left;
@@ -1031,6 +1034,108 @@ class Monotones {
   }
 #endif
 };
+
+Real PolygonBound(const Polygons &polys) {
+  Real bound = 0;
+  for (const SimplePolygon &poly : polys) {
+    for (const PolyVert &vert : poly) {
+      bound = glm::max(bound,
+                       glm::max(glm::abs(vert.pos.x), glm::abs(vert.pos.y)));
+    }
+  }
+  return bound;
+}
+
+double SignedArea(const SimplePolygon &poly) {
+  double area = 0;
+  for (int i = 0; i < poly.size(); ++i) {
+    const glm::dvec2 a(poly[i].pos);
+    const glm::dvec2 b(poly[(i + 1) % poly.size()].pos);
+    area += a.x * b.y - a.y * b.x;
+  }
+  return area / 2;
+}
+
+bool IsInside(vec2 point, const SimplePolygon &poly) {
+  bool inside = false;
+  for (int i = 0, j = poly.size() - 1; i < poly.size(); j = i++) {
+    const vec2 a = poly[i].pos;
+    const vec2 b = poly[j].pos;
+    if ((a.y > point.y) != (b.y > point.y) &&
+        point.x < (b.x - a.x) * (point.y - a.y) / (b.y - a.y) + a.x)
+      inside = !inside;
+  }
+  return inside;
+}
+
+/**
+ * The contours of an epsilon-valid input may touch, so a contour is only taken
+ * to be inside another when most of its vertices are.
+ */
+bool Contains(const SimplePolygon &outer, const SimplePolygon &inner) {
+  int numInside = 0;
+  for (const PolyVert &vert : inner) {
+    if (IsInside(vert.pos, outer)) ++numInside;
+  }
+  return 2 * numInside > inner.size();
+}
+
+/**
+ * Splits the polygons into groups that can be triangulated independently:
+ * each CCW contour along with the holes directly inside it. A hole, or a
+ * degenerate contour, belongs to the smallest CCW contour that contains it,
+ * which also keeps islands nested inside holes separate. Returns a single
+ * group if some hole is not inside any CCW contour.
+ */
+std::vector<Polygons> GroupContours(const Polygons &polys) {
+  struct Contour {
+    int poly;
+    double area;
+    vec2 min, max;
+  };
+  std::vector<Contour> outers, holes;
+  for (int i = 0; i < polys.size(); ++i) {
+    Contour contour = {i, SignedArea(polys[i]),
+                       vec2(std::numeric_limits<Real>::infinity()),
+                       vec2(-std::numeric_limits<Real>::infinity())};
+    for (const PolyVert &vert : polys[i]) {
+      contour.min = glm::min(contour.min, vert.pos);
+      contour.max = glm::max(contour.max, vert.pos);
+    }
+    (contour.area > 0 ? outers : holes).push_back(contour);
+  }
+  if (outers.size() < 2) return std::vector<Polygons>(1, polys);
+  std::sort(outers.begin(), outers.end(),
+            [](const Contour &a, const Contour &b) { return a.area < b.area; });
+
+  std::vector<int> hole2outer(holes.size(), -1);
+  const int numHole = holes.size();
+  for_each_n(numHole > 1 ? ExecutionPolicy::Par : ExecutionPolicy::Seq,
+             countAt(0), numHole, [&](int i) {
+               const Contour &hole = holes[i];
+               for (int j = 0; j < outers.size(); ++j) {
+                 const Contour &outer = outers[j];
+                 if (glm::any(glm::lessThan(hole.min, outer.min)) ||
+                     glm::any(glm::greaterThan(hole.max, outer.max)))
+                   continue;
+                 if (Contains(polys[outer.poly], polys[hole.poly])) {
+                   hole2outer[i] = j;
+                   return;
+                 }
+               }
+             });
+  if (std::find(hole2outer.begin(), hole2outer.end(), -1) != hole2outer.end())
+    return std::vector<Polygons>(1, polys);
+
+  std::vector<Polygons> groups(outers.size());
+  for (int j = 0; j < outers.size(); ++j) {
+    groups[j].push_back(polys[outers[j].poly]);
+  }
+  for (int i = 0; i < numHole; ++i) {
+    groups[hole2outer[i]].push_back(polys[holes[i].poly]);
+  }
+  return groups;
+}
 }  // namespace
 
 namespace manifold {
@@ -1045,16 +1150,50 @@ namespace manifold {
  * @return std::vector<glm::ivec3> The triangles, referencing the original
  * vertex indicies.
  */
-std::vector<glm::ivec3> Triangulate(const Polygons &polys, float precision) {
+std::vector<glm::ivec3> Triangulate(const Polygons &polys, Real precision) {
   std::vector<glm::ivec3> triangles;
   try {
-    Monotones monotones(polys, precision);
-    monotones.Triangulate(triangles);
+    // The precision is set from the whole input, so that it does not depend
+    // on how the contours are grouped.
+    if (precision < 0) precision = PolygonBound(polys) * kTolerance;
+    int numVert = 0;
+    for (const SimplePolygon &poly : polys) numVert += poly.size();
+    // Large inputs are split into independent groups of contours, which are
+    // swept concurrently and their triangles concatenated in group order.
+    const std::vector<Polygons> groups =
+        polys.size() > 1 &&
+                autoPolicy(numVert, KernelCost::Heavy) != ExecutionPolicy::Seq
+            ? GroupContours(polys)
+            : std::vector<Polygons>();
+    if (groups.size() > 1) {
+      const int numGroup = groups.size();
+      std::vector<std::vector<glm::ivec3>> groupTris(numGroup);
+      // A failed check must not throw out of the parallel region, so the
+      // first error in group order is rethrown after the loop.
+      std::vector<std::exception_ptr> errors(numGroup);
+      for_each_n(ExecutionPolicy::Par, countAt(0), numGroup, [&](int i) {
+        try {
+          Monotones monotones(groups[i], precision);
+          monotones.Triangulate(groupTris[i]);
+        } catch (...) {
+          errors[i] = std::current_exception();
+        }
+      });
+      for (const auto &error : errors) {
+        if (error) std::rethrow_exception(error);
+      }
+      for (const auto &tris : groupTris) {
+        triangles.insert(triangles.end(), tris.begin(), tris.end());
+      }
+    } else {
+      Monotones monotones(polys, precision);
+      monotones.Triangulate(triangles);
+    }
 #ifdef MANIFOLD_DEBUG
     if (params.intermediateChecks) {
       CheckTopology(triangles, polys);
       if (!params.processOverlaps) {
-        CheckGeometry(triangles, polys, 2 * monotones.GetPrecision());
+        CheckGeometry(triangles, polys, 2 * precision);
       }
     }
   } catch (const geometryErr &e) {
@@ -14,6 +14,13 @@
 
 #pragma once
 
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
 #include "public.h"
 #include "utils.h"
 #include "vec_dh.h"
@@ -134,9 +141,31 @@ __host__ __device__ glm::ivec4 DecodeMorton(Uint64 code) {
   return index;
 }
 
+// Bricks are aligned blocks of kBrickSize^3 cells, whose Morton codes (of
+// both w) form contiguous ranges of 2^kBrickShift.
+constexpr int kBrickLog2 = 3;
+constexpr int kBrickSize = 1 << kBrickLog2;
+constexpr int kBrickShift = 3 * kBrickLog2 + 1;
+constexpr Uint64 kBrickMask = (Uint64(1) << kBrickShift) - 1;
+
+struct VertKey {
+  Uint64 code;
+  int edge;
+
+  bool operator==(const VertKey& other) const {
+    return code == other.code && edge == other.edge;
+  }
+};
+
+struct VertKeyHash {
+  size_t operator()(const VertKey& key) const {
+    return std::hash<Uint64>()(key.code * 7 + key.edge);
+  }
+};
+
 struct GridVert {
   Uint64 key = kOpen;
-  float distance = NAN;
+  Real distance = NAN;
   int edgeVerts[7] = {-1, -1, -1, -1, -1, -1, -1};
 
   __host__ __device__ int Inside() const { return distance > 0 ? 1 : -1; }
@@ -200,7 +229,7 @@ class HashTable {
 
   bool Full() const { return used_[0] * 2 > Size(); }
 
-  float FilledFraction() const { return static_cast<float>(used_[0]) / Size(); }
+  Real FilledFraction() const { return static_cast<Real>(used_[0]) / Size(); }
 
  private:
   VecDH<GridVert> alloc_;
@@ -208,43 +237,81 @@ class HashTable {
   HashTableD table_;
 };
 
+/**
+ * Distances of a cube of grid points, evaluated ahead of time by a batched
+ * SDF, stored in linear order with w fastest.
+ */
+struct SampledSDF {
+  const Real* distance;
+  const glm::ivec3 lo;
+  const int size;
+
+  __host__ __device__ Real At(const glm::ivec4& gridIndex) const {
+    const glm::ivec3 local = glm::ivec3(gridIndex) - lo;
+    return distance[2 * ((local.z * size + local.y) * size + local.x) +
+                    gridIndex.w];
+  }
+};
+
+template <typename Func>
+__host__ __device__ Real SampleSDF(const Func& sdf, const glm::ivec4&,
+                                   vec3 position) {
+  return sdf(position);
+}
+
+__host__ __device__ inline Real SampleSDF(const SampledSDF& sdf,
+                                          const glm::ivec4& gridIndex, vec3) {
+  return sdf.At(gridIndex);
+}
+
 template <typename Func>
 struct ComputeVerts {
-  glm::vec3* vertPos;
+  vec3* vertPos;
   int* vertIndex;
   HashTableD gridVerts;
   const Func sdf;
-  const glm::vec3 origin;
+  const vec3 origin;
   const glm::ivec3 gridSize;
-  const glm::vec3 spacing;
-  const float level;
-
-  inline __host__ __device__ glm::vec3 Position(glm::ivec4 gridIndex) const {
-    return origin +
-           spacing * (glm::vec3(gridIndex) + (gridIndex.w == 1 ? 0.0f : -0.5f));
+  const vec3 spacing;
+  const Real level;
+  // near-surface bricks to sweep, or nullptr for the whole grid
+  const Uint64* bricks;
+  // if not nullptr, receives the grid vert and edge each vert comes from
+  VertKey* vertKey;
+
+  inline __host__ __device__ vec3 Position(glm::ivec4 gridIndex) const {
+    const Real offset = gridIndex.w == 1 ? 0 : -0.5;
+    return origin + spacing * (vec3(gridIndex) + offset);
   }
 
-  inline __host__ __device__ float BoundedSDF(glm::ivec4 gridIndex) const {
-    const float d = sdf(Position(gridIndex)) - level;
+  inline __host__ __device__ Real BoundedSDF(glm::ivec4 gridIndex) const {
+    const Real d = SampleSDF(sdf, gridIndex, Position(gridIndex)) - level;
 
     const glm::ivec3 xyz(gridIndex);
     const bool onLowerBound = glm::any(glm::lessThanEqual(xyz, glm::ivec3(0)));
     const bool onUpperBound = glm::any(glm::greaterThanEqual(xyz, gridSize));
     const bool onHalfBound =
         gridIndex.w == 1 && glm::any(glm::greaterThanEqual(xyz, gridSize - 1));
-    if (onLowerBound || onUpperBound || onHalfBound) return glm::min(d, 0.0f);
+    if (onLowerBound || onUpperBound || onHalfBound)
+      return glm::min(d, Real(0));
 
     return d;
   }
 
-  inline __host__ __device__ void operator()(Uint64 mortonCode) {
+  inline __host__ __device__ void operator()(Uint64 work) {
+    Compute(bricks == nullptr ? work
+                              : (bricks[work >> kBrickShift] << kBrickShift) |
+                                    (work & kBrickMask));
+  }
+
+  inline __host__ __device__ void Compute(Uint64 mortonCode) {
     if (gridVerts.Full()) return;
 
     const glm::ivec4 gridIndex = DecodeMorton(mortonCode);
 
     if (glm::any(glm::greaterThan(glm::ivec3(gridIndex), gridSize))) return;
 
-    const glm::vec3 position = Position(gridIndex);
+    const vec3 position = Position(gridIndex);
 
     GridVert gridVert;
     gridVert.key = mortonCode;
@@ -259,7 +326,7 @@ struct ComputeVerts {
         neighborIndex += 1;
         neighborIndex.w = 0;
       }
-      const float val = BoundedSDF(neighborIndex);
+      const Real val = BoundedSDF(neighborIndex);
       if ((val > 0) == (gridVert.distance > 0)) continue;
       keep = true;
 
@@ -267,6 +334,7 @@ struct ComputeVerts {
       vertPos[idx] =
           (val * position - gridVert.distance * Position(neighborIndex)) /
           (val - gridVert.distance);
+      if (vertKey != nullptr) vertKey[idx] = {mortonCode, i};
       gridVert.edgeVerts[i] = idx;
     }
 
@@ -274,10 +342,51 @@ struct ComputeVerts {
   }
 };
 
+/**
+ * Whether a brick may contain part of the surface, given that the SDF changes
+ * by at most lipschitz per unit length: a brick is skipped if its center is
+ * further from the level than that allows within the reach of its grid
+ * points. Bricks on the bounds are kept wherever the interior reaches them, as
+ * that is where the surface is closed off.
+ */
+template <typename Func>
+struct NearSurface {
+  const Func sdf;
+  const vec3 origin;
+  const glm::ivec3 gridSize;
+  const vec3 spacing;
+  const Real level;
+  const Real lipschitz;
+
+  __host__ __device__ bool operator()(Uint64 brick) const {
+    const glm::ivec3 lo(DecodeMorton(brick << kBrickShift));
+    if (glm::any(glm::greaterThan(lo, gridSize))) return false;
+    // The codes of a brick, with their neighbors, evaluate the SDF over the
+    // grid coordinates [lo - 1, lo + kBrickSize].
+    return Near(lo - 1, kBrickSize + 1);
+  }
+
+  // Whether the surface may cross the grid coordinates [lo, lo + size].
+  __host__ __device__ bool Near(glm::ivec3 lo, int size) const {
+    const vec3 halfSize = 0.5f * static_cast<Real>(size) * spacing;
+    const vec3 center = origin + spacing * vec3(lo) + halfSize;
+    const Real reach = lipschitz * glm::length(halfSize);
+    const Real d = sdf(center) - level;
+    if (d < -reach) return false;
+    const bool onBound =
+        glm::any(glm::lessThanEqual(lo, glm::ivec3(0))) ||
+        glm::any(glm::greaterThanEqual(lo + size, gridSize - 1));
+    return d <= reach || onBound;
+  }
+};
+
 struct BuildTris {
   glm::ivec3* triVerts;
   int* triIndex;
   const HashTableD gridVerts;
+  // only grid verts in [ownMin, ownMax) build their tetrahedra
+  const glm::ivec3 ownMin;
+  const glm::ivec3 ownMax;
 
   __host__ __device__ void CreateTri(const glm::ivec3& tri,
                                      const int edges[6]) {
@@ -299,6 +408,10 @@ struct BuildTris {
     if (base.key == kOpen) return;
 
     const glm::ivec4 baseIndex = DecodeMorton(base.key);
+    const glm::ivec3 xyz(baseIndex);
+    if (glm::any(glm::lessThan(xyz, ownMin)) ||
+        glm::any(glm::greaterThanEqual(xyz, ownMax)))
+      return;
 
     glm::ivec4 leadIndex = baseIndex;
     if (leadIndex.w == 0)
@@ -355,6 +468,263 @@ struct BuildTris {
     }
   }
 };
+// Sweeps the grid verts of a cube of the grid in linear order, for a tile
+// together with its halo.
+template <typename Func>
+struct ComputeTileVerts {
+  ComputeVerts<Func> verts;
+  const glm::ivec3 lo;
+  const int size;
+
+  inline __host__ __device__ void operator()(int work) {
+    const int cell = work / 2;
+    const glm::ivec4 gridIndex(lo.x + cell % size, lo.y + (cell / size) % size,
+                               lo.z + cell / (size * size), work % 2);
+    if (glm::any(glm::lessThan(glm::ivec3(gridIndex), glm::ivec3(0)))) return;
+    verts.Compute(MortonCode(gridIndex));
+  }
+};
+
+// Memory used per hash table entry by a tile: the entry itself, the verts
+// of its seven edges and their keys, and up to twelve triangles.
+constexpr size_t kTileBytesPerEntry =
+    sizeof(GridVert) + 7 * (sizeof(vec3) + sizeof(VertKey)) +
+    12 * sizeof(glm::ivec3);
+
+inline int TileTableSize(Uint64 numWork) {
+  return glm::min(2 * numWork,
+                  static_cast<Uint64>(10 * glm::pow(numWork, 0.667)));
+}
+
+// Point SDFs are evaluated as needed, in parallel.
+template <typename Func>
+struct PointSource {
+  static constexpr size_t kBytesPerPoint = 0;
+  const Func sdf;
+
+  const Func& Point() const { return sdf; }
+  Func Tile(glm::ivec3, int, vec3, vec3) { return sdf; }
+};
+
+// Points are evaluated with a single call per block of this many.
+constexpr int kBatchSize = 1 << 16;
+
+using BatchFunc = std::function<void(const vec3*, Real*, int)>;
+
+// Evaluates one point through a batched SDF, e.g. for the coarse pass.
+struct BatchPoint {
+  const BatchFunc* sdf;
+
+  Real operator()(vec3 point) const {
+    Real distance;
+    (*sdf)(&point, &distance, 1);
+    return distance;
+  }
+};
+
+/**
+ * Batched SDFs sample all the grid points of a tile up front, in blocks of
+ * kBatchSize points in Morton order, so that nearby points are evaluated
+ * together.
+ */
+struct BatchSource {
+  static constexpr size_t kBytesPerPoint =
+      sizeof(Real) + sizeof(vec3) + sizeof(Real) + sizeof(int);
+  const BatchFunc sdf;
+  VecDH<Real> distance;
+  std::vector<vec3> points;
+  std::vector<Real> values;
+  std::vector<int> offsets;
+
+  BatchPoint Point() const { return {&sdf}; }
+
+  SampledSDF Tile(glm::ivec3 lo, int size, vec3 origin, vec3 spacing) {
+    const int numPoint = 2 * size * size * size;
+    distance.resize(numPoint);
+    points.clear();
+    offsets.clear();
+    int log2 = 0;
+    while ((1 << log2) < size) ++log2;
+    const Uint64 numCode = Uint64(1) << (3 * log2 + 1);
+    for (Uint64 code = 0; code < numCode; ++code) {
+      const glm::ivec4 local = DecodeMorton(code);
+      if (glm::any(glm::greaterThanEqual(glm::ivec3(local), glm::ivec3(size))))
+        continue;
+      const glm::ivec3 gridIndex = lo + glm::ivec3(local);
+      const Real offset = local.w == 1 ? 0 : -0.5;
+      points.push_back(origin + spacing * (vec3(gridIndex) + offset));
+      offsets.push_back(2 * ((local.z * size + local.y) * size + local.x) +
+                        local.w);
+    }
+    values.resize(numPoint);
+    for (int start = 0; start < numPoint; start += kBatchSize)
+      sdf(points.data() + start, values.data() + start,
+          glm::min(kBatchSize, numPoint - start));
+    Real* out = distance.ptrH();
+    for (int i = 0; i < numPoint; ++i) out[offsets[i]] = values[i];
+    return {distance.cptrD(), lo, size};
+  }
+};
+
+/**
+ * The tile loop of LevelSetTiled(), where source provides the SDF: Point()
+ * evaluates single points and Tile(lo, size, origin, spacing) returns the one
+ * used for a cube of grid points.
+ */
+template <typename Source>
+void TiledLevelSet(Source& source, Box bounds, Real edgeLength,
+                   size_t memoryBudget,
+                   const std::function<void(const Mesh&)>& consumer,
+                   Real level, Real lipschitz) {
+  using Func = decltype(source.Tile(glm::ivec3(0), 0, vec3(0), vec3(0)));
+  const vec3 dim = bounds.Size();
+  const glm::ivec3 gridSize(dim / edgeLength);
+  const vec3 spacing = dim / (vec3(gridSize));
+  const auto near = NearSurface<typename std::decay<decltype(
+      source.Point())>::type>({source.Point(), bounds.min, gridSize + 1,
+                               spacing, level, lipschitz});
+
+  // The largest tiles whose table fits the budget, but at least a brick, and
+  // no larger than the grid.
+  const int maxGrid = glm::max(gridSize.x, glm::max(gridSize.y, gridSize.z));
+  int tileLog2 = kBrickLog2;
+  while ((1 << tileLog2) < maxGrid + 2) {
+    // hash table of the next tile size up, with its halo
+    const Uint64 extent = (Uint64(1) << (tileLog2 + 1)) + 2;
+    const Uint64 sampled = extent + 2;
+    if (TileTableSize(2 * extent * extent * extent) * kTileBytesPerEntry +
+            2 * sampled * sampled * sampled * Source::kBytesPerPoint >
+        memoryBudget)
+      break;
+    ++tileLog2;
+  }
+
+  struct Tile {
+    glm::ivec3 lo;
+    int log2;
+  };
+  // stack of tiles left to process, the next one in Morton order on top
+  std::vector<Tile> tiles;
+  const glm::ivec3 numTile = (gridSize + 1) / (1 << tileLog2) + 1;
+  std::vector<Uint64> tileCodes;
+  for (int x = 0; x < numTile.x; ++x)
+    for (int y = 0; y < numTile.y; ++y)
+      for (int z = 0; z < numTile.z; ++z)
+        tileCodes.push_back(MortonCode(glm::ivec4(x, y, z, 0)));
+  std::sort(tileCodes.begin(), tileCodes.end(), std::greater<Uint64>());
+  for (const Uint64 code : tileCodes)
+    tiles.push_back({glm::ivec3(DecodeMorton(code)) << tileLog2, tileLog2});
+
+  // Verts near tile boundaries, which more than one tile references, with
+  // their global index.
+  std::unordered_map<VertKey, int, VertKeyHash> shared;
+  // The same verts by the code of the last grid vert that may use them, the
+  // earliest on top, so those behind the frontier are retired without
+  // scanning the table.
+  using Retire = std::pair<Uint64, VertKey>;
+  auto later = [](const Retire& a, const Retire& b) {
+    return a.first > b.first;
+  };
+  std::priority_queue<Retire, std::vector<Retire>, decltype(later)> retire(
+      later);
+  int numVert = 0;
+  int tableSize = 0;
+
+  while (!tiles.empty()) {
+    const Tile tile = tiles.back();
+    tiles.pop_back();
+    const int size = 1 << tile.log2;
+    // everything before this is done once the tile is
+    const Uint64 frontier = MortonCode(glm::ivec4(tile.lo, 0)) +
+                            (Uint64(1) << (3 * tile.log2 + 1));
+
+    // The tile's tetrahedra use the grid verts within one of it, whose edges
+    // reach one further.
+    if (lipschitz <= 0 || near.Near(tile.lo - 2, size + 3)) {
+      const glm::ivec3 extLo = tile.lo - 1;
+      const int extSize = size + 2;
+      const int numWork = 2 * extSize * extSize * extSize;
+      const auto policy = autoPolicy(numWork, KernelCost::Heavy);
+      if (tableSize == 0) tableSize = TileTableSize(numWork);
+
+      // Its grid verts' neighbors reach one further than the halo.
+      const Func sdf =
+          source.Tile(tile.lo - 2, size + 4, bounds.min, spacing);
+      HashTable gridVerts(tableSize);
+      VecDH<vec3> vertPos(gridVerts.Size() * 7);
+      VecDH<VertKey> vertKey(gridVerts.Size() * 7);
+      VecDH<int> index(1, 0);
+      for_each_n(
+          policy, countAt(0), numWork,
+          ComputeTileVerts<Func>(
+              {ComputeVerts<Func>({vertPos.ptrD(), index.ptrD(), gridVerts.D(),
+                                   sdf, bounds.min, gridSize + 1, spacing,
+                                   level, nullptr, vertKey.ptrD()}),
+               extLo, extSize}));
+
+      if (gridVerts.Full()) {
+        if (tile.log2 > kBrickLog2) {
+          // Split into eight, pushed so they pop in Morton order.
+          for (int i = 7; i >= 0; --i) {
+            const glm::ivec3 offset(DecodeMorton(Uint64(i) << 1));
+            tiles.push_back({tile.lo + (offset << (tile.log2 - 1)),
+                             tile.log2 - 1});
+          }
+          tableSize = 0;
+        } else {
+          tiles.push_back(tile);
+          tableSize = 2 * gridVerts.Size();
+        }
+        continue;
+      }
+      tableSize = 0;
+      const int numLocal = index[0];
+
+      VecDH<glm::ivec3> triVerts(gridVerts.Entries() * 12);  // worst case
+      index[0] = 0;
+      for_each_n(policy, countAt(0), gridVerts.Size(),
+                 BuildTris({triVerts.ptrD(), index.ptrD(), gridVerts.D(),
+                            tile.lo, tile.lo + size}));
+      triVerts.resize(index[0]);
+
+      // Number the verts the tile's triangles use: those of grid verts well
+      // inside the tile are used by this tile only, while the others are
+      // shared through the table, by whichever tile gets to them first.
+      Mesh out;
+      const VertKey* keys = vertKey.cptrH();
+      const vec3* positions = vertPos.cptrH();
+      std::vector<int> local2global(numLocal, -1);
+      auto global = [&](int local) {
+        int& idx = local2global[local];
+        if (idx >= 0) return idx;
+        const VertKey& key = keys[local];
+        const glm::ivec3 xyz(DecodeMorton(key.code));
+        const bool inner =
+            glm::all(glm::greaterThan(xyz, tile.lo)) &&
+            glm::all(glm::lessThan(xyz, tile.lo + size - 1));
+        if (!inner) {
+          auto it = shared.find(key);
+          if (it != shared.end()) return idx = it->second;
+          shared.emplace(key, numVert);
+          retire.push({MortonCode(glm::ivec4(xyz + 1, 1)), key});
+        }
+        out.vertPos.push_back(positions[local]);
+        return idx = numVert++;
+      };
+      const glm::ivec3* tris = triVerts.cptrH();
+      for (int i = 0; i < triVerts.size(); ++i)
+        out.triVerts.push_back(
+            {global(tris[i][0]), global(tris[i][1]), global(tris[i][2])});
+      if (!out.triVerts.empty()) consumer(out);
+    }
+
+    while (!retire.empty() && retire.top().first < frontier) {
+      shared.erase(retire.top().second);
+      retire.pop();
+    }
+  }
+}
+
 }  // namespace
 
 namespace manifold {
@@ -372,7 +742,7 @@ namespace manifold {
  * the manifold, which is due to the underlying grid.
  *
  * @param sdf The signed-distance functor, containing this function signature:
- * `__host__ __device__ float operator()(glm::vec3 point)`, which returns the
+ * `__host__ __device__ Real operator()(vec3 point)`, which returns the
  * signed distance of a given point in R^3. Positive values are inside,
  * negative outside. The `__host__ __device__` is only needed if you compile for
  * CUDA. If you are using a large grid, the advantage of a GPU speedup is
@@ -383,45 +753,81 @@ namespace manifold {
  * performance.
  * @param level You can inset your Mesh by using a positive value, or outset
  * it with a negative value.
+ * @param lipschitz If positive, a promise that the SDF changes by at most this
+ * much per unit length, e.g. 1 for an exact signed distance. This allows blocks
+ * of the grid that are far from the surface to be skipped after a coarse pass,
+ * so the cost scales with the surface area rather than the volume of the grid.
+ * A value that is too low can miss parts of the surface.
  * @return Mesh This class does not depend on Manifold, so it just returns a
  * Mesh, but it is guaranteed to be manifold and so can always be used as
  * input to the Manifold constructor for further operations.
  */
 template <typename Func>
-inline Mesh LevelSet(Func sdf, Box bounds, float edgeLength, float level = 0) {
+inline Mesh LevelSet(Func sdf, Box bounds, Real edgeLength, Real level = 0,
+                     Real lipschitz = 0) {
   Mesh out;
 
-  const glm::vec3 dim = bounds.Size();
-  const float maxDim = std::max(dim[0], std::max(dim[1], dim[2]));
+  const vec3 dim = bounds.Size();
   const glm::ivec3 gridSize(dim / edgeLength);
-  const glm::vec3 spacing = dim / (glm::vec3(gridSize));
+  const vec3 spacing = dim / (vec3(gridSize));
 
   const Uint64 maxMorton = MortonCode(glm::ivec4(gridSize + 1, 1));
-  const auto policy = autoPolicy(maxMorton);
+  auto policy = autoPolicy(maxMorton, KernelCost::Heavy);
+
+  // Coarse pass: keep only the bricks that may contain the surface.
+  const bool sparse = lipschitz > 0;
+  VecDH<Uint64> bricks;
+  if (sparse) {
+    const Uint64 numBrick = (maxMorton >> kBrickShift) + 1;
+    bricks.resize(numBrick);
+    const int numActive =
+        copy_if<decltype(bricks.begin())>(
+            autoPolicy(numBrick, KernelCost::Heavy), countAt(Uint64(0)),
+            countAt(numBrick), bricks.begin(),
+            NearSurface<Func>({sdf, bounds.min, gridSize + 1, spacing, level,
+                               lipschitz})) -
+        bricks.begin();
+    bricks.resize(numActive);
+    if (numActive == 0) return out;
+  }
+  const Uint64 numWork =
+      sparse ? Uint64(bricks.size()) << kBrickShift : maxMorton + 1;
+  if (sparse) policy = autoPolicy(numWork, KernelCost::Heavy);
 
   int tableSize = glm::min(
-      2 * maxMorton, static_cast<Uint64>(10 * glm::pow(maxMorton, 0.667)));
+      2 * numWork, static_cast<Uint64>(10 * glm::pow(numWork, 0.667)));
   HashTable gridVerts(tableSize);
-  VecDH<glm::vec3> vertPos(gridVerts.Size() * 7);
+  VecDH<vec3> vertPos(gridVerts.Size() * 7);
 
   while (1) {
     VecDH<int> index(1, 0);
-    for_each_n(
-        policy, countAt(0), maxMorton + 1,
-        ComputeVerts<Func>({vertPos.ptrD(), index.ptrD(), gridVerts.D(), sdf,
-                            bounds.min, gridSize + 1, spacing, level}));
+    for_each_n(policy, countAt(Uint64(0)), numWork,
+               ComputeVerts<Func>({vertPos.ptrD(), index.ptrD(), gridVerts.D(),
+                                   sdf, bounds.min, gridSize + 1, spacing,
+                                   level, sparse ? bricks.cptrD() : nullptr,
+                                   nullptr}));
 
     if (gridVerts.Full()) {  // Resize HashTable
-      const glm::vec3 lastVert = vertPos[index[0] - 1];
+      const vec3 lastVert = vertPos[index[0] - 1];
       const Uint64 lastMorton =
           MortonCode(glm::ivec4((lastVert - bounds.min) / spacing, 1));
-      const float ratio = static_cast<float>(maxMorton) / lastMorton;
+      // how far through the work the table filled up
+      Uint64 lastWork = lastMorton;
+      if (sparse) {
+        const Uint64* brick = bricks.cptrH();
+        lastWork = (std::upper_bound(brick, brick + bricks.size(),
+                                     lastMorton >> kBrickShift) -
+                    brick)
+                   << kBrickShift;
+      }
+      const Real ratio =
+          static_cast<Real>(numWork) / glm::max(lastWork, Uint64(1));
       if (ratio > 1000)  // do not trust the ratio if it is too large
         tableSize *= 2;
       else
         tableSize *= ratio;
       gridVerts = HashTable(tableSize);
-      vertPos = VecDH<glm::vec3>(gridVerts.Size() * 7);
+      vertPos = VecDH<vec3>(gridVerts.Size() * 7);
     } else {  // Success
       vertPos.resize(index[0]);
       break;
@@ -432,12 +838,104 @@ inline Mesh LevelSet(Func sdf, Box bounds, float edgeLength, float level = 0) {
 
   VecDH<int> index(1, 0);
   for_each_n(policy, countAt(0), gridVerts.Size(),
-             BuildTris({triVerts.ptrD(), index.ptrD(), gridVerts.D()}));
+             BuildTris({triVerts.ptrD(), index.ptrD(), gridVerts.D(),
+                        glm::ivec3(0),
+                        glm::ivec3(std::numeric_limits<int>::max())}));
   triVerts.resize(index[0]);
 
   out.vertPos.insert(out.vertPos.end(), vertPos.begin(), vertPos.end());
   out.triVerts.insert(out.triVerts.end(), triVerts.begin(), triVerts.end());
   return out;
 }
+
+/**
+ * A tiled, streaming version of LevelSet() for grids too large to process at
+ * once. The grid is cut into cubic tiles, visited in Morton order, each with
+ * its own hash table of at most about memoryBudget bytes. A tile whose table
+ * fills up is split into eight, so completed tiles are never recomputed.
+ *
+ * Each finished tile is passed to consumer as a Mesh holding only its new
+ * verts, which are numbered following those of the earlier tiles, and its
+ * triangles, which may also reference the verts of earlier tiles. The verts on
+ * the boundaries between tiles are shared, so concatenating the output of all
+ * calls gives the same manifold as LevelSet().
+ *
+ * @param sdf The signed-distance functor, as for LevelSet().
+ * @param bounds An axis-aligned box that defines the extent of the grid.
+ * @param edgeLength Approximate maximum edge length of the triangles in the
+ * final result.
+ * @param memoryBudget Approximate bound on the working memory of a tile, in
+ * bytes; the output and the table of shared boundary verts are not included.
+ * @param consumer Called once per tile that contains part of the surface.
+ * @param level You can inset your Mesh by using a positive value, or outset
+ * it with a negative value.
+ * @param lipschitz As for LevelSet(): if positive, tiles far from the surface
+ * are skipped without evaluating their grid points.
+ */
+template <typename Func>
+inline void LevelSetTiled(Func sdf, Box bounds, Real edgeLength,
+                          size_t memoryBudget,
+                          const std::function<void(const Mesh&)>& consumer,
+                          Real level = 0, Real lipschitz = 0) {
+  PointSource<Func> source({sdf});
+  TiledLevelSet(source, bounds, edgeLength, memoryBudget, consumer, level,
+                lipschitz);
+}
+
+/**
+ * A batched signed-distance function, which writes the distance of each of
+ * the n points to distances. Batches of points close together are passed in
+ * Morton order, so this is the place to vectorize, or to amortize the cost of
+ * calling into another language. Lambdas must be wrapped in a BatchSDF to
+ * select the batched overloads.
+ */
+using BatchSDF =
+    std::function<void(const vec3* points, Real* distances, int n)>;
+
+/**
+ * LevelSetTiled() for a batched SDF: the grid points of each tile are sampled
+ * up front, in Morton-ordered blocks, which adds 24 bytes per grid point
+ * of a tile to its working memory. The coarse pass of a positive lipschitz
+ * evaluates single points.
+ */
+inline void LevelSetTiled(const BatchSDF& sdf, Box bounds, Real edgeLength,
+                          size_t memoryBudget,
+                          const std::function<void(const Mesh&)>& consumer,
+                          Real level = 0, Real lipschitz = 0) {
+  BatchSource source({sdf});
+  TiledLevelSet(source, bounds, edgeLength, memoryBudget, consumer, level,
+                lipschitz);
+}
+
+/**
+ * LevelSetTiled() collected into a single Mesh, with the working memory
+ * bounded by memoryBudget.
+ */
+template <typename Func>
+inline Mesh LevelSetTiled(Func sdf, Box bounds, Real edgeLength,
+                          size_t memoryBudget, Real level = 0,
+                          Real lipschitz = 0) {
+  Mesh out;
+  LevelSetTiled(
+      sdf, bounds, edgeLength, memoryBudget,
+      [&out](const Mesh& tile) {
+        out.vertPos.insert(out.vertPos.end(), tile.vertPos.begin(),
+                           tile.vertPos.end());
+        out.triVerts.insert(out.triVerts.end(), tile.triVerts.begin(),
+                            tile.triVerts.end());
+      },
+      level, lipschitz);
+  return out;
+}
+
+/**
+ * LevelSet() for a batched SDF, which goes through LevelSetTiled(), as the
+ * grid points are sampled ahead of time a tile at a time.
+ */
+inline Mesh LevelSet(const BatchSDF& sdf, Box bounds, Real edgeLength,
+                     Real level = 0, Real lipschitz = 0) {
+  constexpr size_t kBudget = size_t(1) << 28;
+  return LevelSetTiled(sdf, bounds, edgeLength, kBudget, level, lipschitz);
+}
 /** @} */
-}  // namespace manifold
\ No newline at end of file
+}  // namespace manifold
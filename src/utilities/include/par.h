@@ -25,6 +25,10 @@
 #include <thrust/uninitialized_copy.h>
 #include <thrust/unique.h>
 
+#include <iterator>
+#include <type_traits>
+#include <vector>
+
 #if MANIFOLD_PAR == 'O'
 #include <thrust/system/omp/execution_policy.h>
 #define MANIFOLD_PAR_NS omp
@@ -39,9 +43,15 @@
 #include <thrust/system/cuda/execution_policy.h>
 #endif
 
+#include "public.h"
+
 namespace manifold {
 
 bool CudaEnabled();
+// The device of the calling thread, see SetCudaDevice(), and whether it was
+// chosen explicitly.
+int CudaDevice();
+bool CudaDeviceExplicit();
 
 enum class ExecutionPolicy {
   ParUnseq,
@@ -57,24 +67,31 @@ constexpr ExecutionPolicy Seq = ExecutionPolicy::Seq;
 // - Sequential for small workload,
 // - Parallel (CPU) for medium workload,
 // - GPU for large workload if available.
-inline ExecutionPolicy autoPolicy(int size) {
-  // some random numbers
-  if (size <= (1 << 12)) {
+// The crossovers depend on the cost of the kernel; see PolicyThresholds.
+inline ExecutionPolicy autoPolicy(int size,
+                                  KernelCost cost = KernelCost::Light) {
+  const PolicyThresholds thresholds = GetPolicyThresholds();
+  if (size <= thresholds.SeqMax(cost)) {
     return Seq;
   }
-  if (size <= (1 << 16) || !CudaEnabled()) {
+  if (size <= thresholds.ParMax(cost) || !CudaEnabled()) {
     return Par;
   }
   return ParUnseq;
 }
 
 #ifdef MANIFOLD_USE_CUDA
+// Kernels go to the per-thread default stream of the calling thread's device,
+// so that operations on different threads, e.g. one per GPU, do not serialize
+// on the legacy default stream.
+inline auto CudaPar() { return thrust::cuda::par.on(cudaStreamPerThread); }
+
 #define THRUST_DYNAMIC_BACKEND_VOID(NAME)                    \
   template <typename... Args>                                \
   void NAME(ExecutionPolicy policy, Args... args) {          \
     switch (policy) {                                        \
       case ExecutionPolicy::ParUnseq:                        \
-        thrust::NAME(thrust::cuda::par, args...);            \
+        thrust::NAME(CudaPar(), args...);                    \
         break;                                               \
       case ExecutionPolicy::Par:                             \
         thrust::NAME(thrust::MANIFOLD_PAR_NS::par, args...); \
@@ -89,7 +106,7 @@ inline ExecutionPolicy autoPolicy(int size) {
   Ret NAME(ExecutionPolicy policy, Args... args) {                  \
     switch (policy) {                                               \
       case ExecutionPolicy::ParUnseq:                               \
-        return thrust::NAME(thrust::cuda::par, args...);            \
+        return thrust::NAME(CudaPar(), args...);                    \
       case ExecutionPolicy::Par:                                    \
         return thrust::NAME(thrust::MANIFOLD_PAR_NS::par, args...); \
       case ExecutionPolicy::Seq:                                    \
@@ -162,4 +179,193 @@ THRUST_DYNAMIC_BACKEND(transform_reduce, void)
 THRUST_DYNAMIC_BACKEND(lower_bound, void)
 THRUST_DYNAMIC_BACKEND(gather_if, void)
 
+/**
+ * On the CPU, sorts by 32- and 64-bit integer keys, such as Morton codes and
+ * packed index pairs, are done by a parallel LSD radix sort instead of
+ * thrust's comparison sorts. The overloads below are chosen over the ones
+ * above for such keys when no comparator is given. The sort is stable, so it
+ * serves stable_sort_by_key as well. The GPU backend already radix sorts these
+ * keys, so it is used as before.
+ */
+namespace radix {
+// Maps keys to unsigned bits of the same order.
+template <typename T, typename = void>
+struct Key : std::false_type {};
+template <typename T>
+struct Key<T, typename std::enable_if<std::is_integral<T>::value &&
+                                      (sizeof(T) == 4 || sizeof(T) == 8)>::type>
+    : std::true_type {
+  using Bits = typename std::conditional<sizeof(T) == 4, uint32_t,
+                                         uint64_t>::type;
+  static constexpr Bits kSign =
+      std::is_signed<T>::value ? Bits(1) << (8 * sizeof(T) - 1) : 0;
+  static Bits ToBits(T key) { return static_cast<Bits>(key) ^ kSign; }
+  static T FromBits(Bits bits) { return static_cast<T>(bits ^ kSign); }
+};
+
+constexpr int kDigitBits = 8;
+constexpr int kNumDigit = 1 << kDigitBits;
+// Elements per block, each of which is counted and scattered by one thread.
+constexpr int kBlock = 1 << 14;
+// Below this comparison sort is faster.
+constexpr int kMinSize = 1 << 11;
+
+/**
+ * Sorts the bits, moving index along with them if it is not null. Digits
+ * that are the same across all keys are skipped, so e.g. 30-bit Morton codes
+ * take four passes and small packed indices fewer.
+ */
+template <typename Bits>
+void SortBits(ExecutionPolicy policy, Bits* bits, int* index, int n) {
+  const int numBlock = (n + kBlock - 1) / kBlock;
+  const thrust::counting_iterator<int> blocks(0);
+
+  std::vector<Bits> blockDiff(numBlock);
+  for_each_n(policy, blocks, numBlock, [&](int block) {
+    const int end = std::min(n, (block + 1) * kBlock);
+    Bits diff = 0;
+    for (int i = block * kBlock; i < end; ++i) diff |= bits[i] ^ bits[0];
+    blockDiff[block] = diff;
+  });
+  Bits diff = 0;
+  for (const Bits d : blockDiff) diff |= d;
+
+  std::vector<Bits> bitsTmp(n);
+  std::vector<int> indexTmp(index == nullptr ? 0 : n);
+  Bits* src = bits;
+  Bits* dst = bitsTmp.data();
+  int* srcIndex = index;
+  int* dstIndex = indexTmp.data();
+  // digit-major, so that scanning it gives each block its output offsets
+  std::vector<int> offset(kNumDigit * numBlock);
+  for (int shift = 0; shift < 8 * static_cast<int>(sizeof(Bits));
+       shift += kDigitBits) {
+    if (((diff >> shift) & (kNumDigit - 1)) == 0) continue;
+    for_each_n(policy, blocks, numBlock, [&](int block) {
+      int count[kNumDigit] = {};
+      const int end = std::min(n, (block + 1) * kBlock);
+      for (int i = block * kBlock; i < end; ++i)
+        ++count[(src[i] >> shift) & (kNumDigit - 1)];
+      for (int d = 0; d < kNumDigit; ++d)
+        offset[d * numBlock + block] = count[d];
+    });
+    int sum = 0;
+    for (int& o : offset) {
+      const int count = o;
+      o = sum;
+      sum += count;
+    }
+    for_each_n(policy, blocks, numBlock, [&](int block) {
+      int next[kNumDigit];
+      for (int d = 0; d < kNumDigit; ++d)
+        next[d] = offset[d * numBlock + block];
+      const int end = std::min(n, (block + 1) * kBlock);
+      for (int i = block * kBlock; i < end; ++i) {
+        const int pos = next[(src[i] >> shift) & (kNumDigit - 1)]++;
+        dst[pos] = src[i];
+        if (index != nullptr) dstIndex[pos] = srcIndex[i];
+      }
+    });
+    std::swap(src, dst);
+    std::swap(srcIndex, dstIndex);
+  }
+  if (src != bits) {
+    for_each_n(policy, blocks, numBlock, [&](int block) {
+      const int end = std::min(n, (block + 1) * kBlock);
+      for (int i = block * kBlock; i < end; ++i) {
+        bits[i] = src[i];
+        if (index != nullptr) index[i] = srcIndex[i];
+      }
+    });
+  }
+}
+
+template <typename KeyIt, typename ValIt>
+void SortByKey(ExecutionPolicy policy, KeyIt keyFirst, KeyIt keyLast,
+               ValIt valFirst) {
+  using K = Key<typename std::iterator_traits<KeyIt>::value_type>;
+  using Value = typename std::iterator_traits<ValIt>::value_type;
+  const int n = keyLast - keyFirst;
+  std::vector<typename K::Bits> bits(n);
+  std::vector<int> index(n);
+  for_each_n(policy, thrust::counting_iterator<int>(0), n, [&](int i) {
+    bits[i] = K::ToBits(keyFirst[i]);
+    index[i] = i;
+  });
+  SortBits(policy, bits.data(), index.data(), n);
+  std::vector<Value> values(n);
+  for_each_n(policy, thrust::counting_iterator<int>(0), n,
+             [&](int i) { values[i] = valFirst[index[i]]; });
+  for_each_n(policy, thrust::counting_iterator<int>(0), n, [&](int i) {
+    keyFirst[i] = K::FromBits(bits[i]);
+    valFirst[i] = values[i];
+  });
+}
+
+template <typename KeyIt>
+void Sort(ExecutionPolicy policy, KeyIt first, KeyIt last) {
+  using K = Key<typename std::iterator_traits<KeyIt>::value_type>;
+  const int n = last - first;
+  std::vector<typename K::Bits> bits(n);
+  for_each_n(policy, thrust::counting_iterator<int>(0), n,
+             [&](int i) { bits[i] = K::ToBits(first[i]); });
+  SortBits(policy, bits.data(), static_cast<int*>(nullptr), n);
+  for_each_n(policy, thrust::counting_iterator<int>(0), n,
+             [&](int i) { first[i] = K::FromBits(bits[i]); });
+}
+
+template <typename Iter>
+using EnableIfKey = typename std::enable_if<
+    Key<typename std::iterator_traits<Iter>::value_type>::value>::type;
+}  // namespace radix
+
+#ifdef MANIFOLD_USE_CUDA
+#define RADIX_GPU_FALLBACK(NAME, ...)          \
+  if (policy == ExecutionPolicy::ParUnseq) {   \
+    thrust::NAME(CudaPar(), __VA_ARGS__);      \
+    return;                                    \
+  }
+#else
+#define RADIX_GPU_FALLBACK(NAME, ...)
+#endif
+
+template <typename KeyIt, typename ValIt, typename = radix::EnableIfKey<KeyIt>>
+void sort_by_key(ExecutionPolicy policy, KeyIt keyFirst, KeyIt keyLast,
+                 ValIt valFirst) {
+  RADIX_GPU_FALLBACK(sort_by_key, keyFirst, keyLast, valFirst)
+  if (keyLast - keyFirst < radix::kMinSize) {
+    thrust::stable_sort_by_key(thrust::cpp::par, keyFirst, keyLast, valFirst);
+    return;
+  }
+  radix::SortByKey(policy == Seq ? Seq : Par, keyFirst, keyLast, valFirst);
+}
+
+template <typename KeyIt, typename ValIt, typename = radix::EnableIfKey<KeyIt>>
+void stable_sort_by_key(ExecutionPolicy policy, KeyIt keyFirst, KeyIt keyLast,
+                        ValIt valFirst) {
+  RADIX_GPU_FALLBACK(stable_sort_by_key, keyFirst, keyLast, valFirst)
+  if (keyLast - keyFirst < radix::kMinSize) {
+    thrust::stable_sort_by_key(thrust::cpp::par, keyFirst, keyLast, valFirst);
+    return;
+  }
+  radix::SortByKey(policy == Seq ? Seq : Par, keyFirst, keyLast, valFirst);
+}
+
+template <typename KeyIt, typename = radix::EnableIfKey<KeyIt>>
+void sort(ExecutionPolicy policy, KeyIt first, KeyIt last) {
+  RADIX_GPU_FALLBACK(sort, first, last)
+  if (last - first < radix::kMinSize) {
+    thrust::sort(thrust::cpp::par, first, last);
+    return;
+  }
+  radix::Sort(policy == Seq ? Seq : Par, first, last);
+}
+
+template <typename KeyIt, typename = radix::EnableIfKey<KeyIt>>
+void stable_sort(ExecutionPolicy policy, KeyIt first, KeyIt last) {
+  sort(policy, first, last);
+}
+
+#undef RADIX_GPU_FALLBACK
+
 }  // namespace manifold
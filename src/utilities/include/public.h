@@ -21,6 +21,7 @@
 #include <glm/gtx/rotate_vector.hpp>
 #include <limits>
 #include <memory>
+#include <stdexcept>
 #include <unordered_map>
 #include <vector>
 
@@ -32,7 +33,31 @@
 
 namespace manifold {
 
-constexpr float kTolerance = 1e-5;
+/**
+ * The scalar of all the geometry. This is float unless the library is built
+ * with MANIFOLD_DOUBLE, and the vector and matrix types below follow it.
+ * MeshGL and the other buffer types of the API are float in both builds.
+ */
+#ifdef MANIFOLD_DOUBLE
+using Real = double;
+constexpr Real kTolerance = 1e-12;
+#else
+using Real = float;
+constexpr Real kTolerance = 1e-5;
+#endif
+
+using vec2 = glm::tvec2<Real>;
+using vec3 = glm::tvec3<Real>;
+using vec4 = glm::tvec4<Real>;
+using mat2 = glm::tmat2x2<Real>;
+using mat3 = glm::tmat3x3<Real>;
+using mat4 = glm::tmat4x4<Real>;
+using mat2x3 = glm::tmat2x3<Real>;
+using mat2x4 = glm::tmat2x4<Real>;
+using mat3x2 = glm::tmat3x2<Real>;
+using mat3x4 = glm::tmat3x4<Real>;
+using mat4x2 = glm::tmat4x2<Real>;
+using mat4x3 = glm::tmat4x3<Real>;
 
 #ifdef __CUDACC__
 #define HOST_DEVICE __host__ __device__
@@ -50,7 +75,7 @@ constexpr float kTolerance = 1e-5;
  *
  * @param x Angle in degrees.
  */
-inline HOST_DEVICE float sind(float x) {
+inline HOST_DEVICE Real sind(Real x) {
   if (!std::isfinite(x)) return sin(x);
   if (x < 0.0f) return -sind(-x);
   int quo;
@@ -73,7 +98,7 @@ inline HOST_DEVICE float sind(float x) {
  *
  * @param x Angle in degrees.
  */
-inline HOST_DEVICE float cosd(float x) { return sind(x + 90.0f); }
+inline HOST_DEVICE Real cosd(Real x) { return sind(x + 90.0f); }
 
 /**
  * This 4x3 matrix can be used as an input to Manifold.Transform() to turn an
@@ -81,18 +106,18 @@ inline HOST_DEVICE float cosd(float x) { return sind(x + 90.0f); }
  *
  * @param up The vector to be turned to point upwards. Length does not matter.
  */
-inline HOST_DEVICE glm::mat4x3 RotateUp(glm::vec3 up) {
+inline HOST_DEVICE mat4x3 RotateUp(vec3 up) {
   up = glm::normalize(up);
-  glm::vec3 axis = glm::cross(up, {0, 0, 1});
-  float angle = glm::asin(glm::length(axis));
-  if (glm::dot(up, {0, 0, 1}) < 0) angle = glm::pi<float>() - angle;
-  return glm::mat4x3(glm::rotate(glm::mat4(1), angle, axis));
+  vec3 axis = glm::cross(up, {0, 0, 1});
+  Real angle = glm::asin(glm::length(axis));
+  if (glm::dot(up, {0, 0, 1}) < 0) angle = glm::pi<Real>() - angle;
+  return mat4x3(glm::rotate(mat4(1), angle, axis));
 }
 
 /**
  * Returns 1 for positive values, -1 for negative, and 0 for exactly zero.
  */
-inline HOST_DEVICE int Signum(float val) { return (val > 0) - (val < 0); }
+inline HOST_DEVICE int Signum(Real val) { return (val > 0) - (val < 0); }
 
 /**
  * Determines if the three points are wound counter-clockwise, clockwise, or
@@ -105,12 +130,11 @@ inline HOST_DEVICE int Signum(float val) { return (val > 0) - (val < 0); }
  * @return int, like Signum, this returns 1 for CCW, -1 for CW, and 0 if within
  * tol of colinear.
  */
-inline HOST_DEVICE int CCW(glm::vec2 p0, glm::vec2 p1, glm::vec2 p2,
-                           float tol) {
-  glm::vec2 v1 = p1 - p0;
-  glm::vec2 v2 = p2 - p0;
-  float area = v1.x * v2.y - v1.y * v2.x;
-  float base2 = glm::max(glm::dot(v1, v1), glm::dot(v2, v2));
+inline HOST_DEVICE int CCW(vec2 p0, vec2 p1, vec2 p2, Real tol) {
+  vec2 v1 = p1 - p0;
+  vec2 v2 = p2 - p0;
+  Real area = v1.x * v2.y - v1.y * v2.x;
+  Real base2 = glm::max(glm::dot(v1, v1), glm::dot(v2, v2));
   if (area * area <= base2 * tol * tol)
     return 0;
   else
@@ -127,7 +151,7 @@ inline HOST_DEVICE int CCW(glm::vec2 p0, glm::vec2 p1, glm::vec2 p2,
  */
 struct PolyVert {
   /// X-Y position
-  glm::vec2 pos;
+  vec2 pos;
   /// ID or index into another vertex vector
   int idx;
 };
@@ -164,30 +188,86 @@ struct MeshGL {
   std::vector<float> halfedgeTangent;
 };
 
+/**
+ * Nested levels of detail of one mesh, created with Manifold.GetMeshGLLods(),
+ * sharing a single vertex buffer. The levels are ordered from coarsest to
+ * finest and so are the verts, so each level only references a prefix of them:
+ * a client can render the first level as soon as its verts and triangles have
+ * arrived, while the finer ones stream in.
+ */
+struct MeshGLLods {
+  /// The verts and normals of the finest level, followed by the triangles of
+  /// every level in order. The halfedgeTangent is left empty.
+  MeshGL mesh;
+  /// The tolerance each level was simplified to.
+  std::vector<float> tolerance;
+  /// The number of leading verts of mesh each level references.
+  std::vector<int> numVert;
+  /// The first triangle of each level in mesh.triVerts, followed by the total
+  /// number of triangles, so level i is [triStart[i], triStart[i + 1]).
+  std::vector<int> triStart;
+};
+
+/**
+ * The layout of the buffers written by Manifold::WriteMeshGL(), which can be
+ * handed to a graphics API as they are: a vertex buffer interleaving each
+ * position with its normal, and an index buffer of three indices per triangle.
+ */
+struct MeshGLLayout {
+  enum class Normal {
+    NONE,     ///< positions only
+    FLOAT,    ///< three floats after each position
+    SNORM16,  ///< four normalized int16s after each position, the last zero
+  };
+  Normal normal = Normal::FLOAT;
+  /// Whether to write 16-bit indices when all vertex indices fit in them.
+  bool index16 = true;
+
+  /// Bytes from the start of one vertex to the next.
+  int VertStride() const {
+    return 3 * sizeof(float) +
+           (normal == Normal::FLOAT     ? 3 * sizeof(float)
+            : normal == Normal::SNORM16 ? 4 * sizeof(int16_t)
+                                        : 0);
+  }
+  /// Bytes per index, 2 or 4, for a mesh of numVert vertices.
+  int IndexSize(int numVert) const {
+    return index16 && numVert <= 65536 ? 2 : 4;
+  }
+  /// Bytes of the vertex buffer for numVert vertices.
+  size_t VertBytes(int numVert) const {
+    return static_cast<size_t>(numVert) * VertStride();
+  }
+  /// Bytes of the index buffer for numTri triangles over numVert vertices.
+  size_t IndexBytes(int numVert, int numTri) const {
+    return 3 * static_cast<size_t>(numTri) * IndexSize(numVert);
+  }
+};
+
 /**
  * The triangle-mesh input and output of this library.
  */
 struct Mesh {
   /// Required: The X-Y-Z positions of all vertices.
-  std::vector<glm::vec3> vertPos;
+  std::vector<vec3> vertPos;
   /// Required: The vertex indices of the three triangle corners in CCW (from
   /// the outside) order, for each triangle.
   std::vector<glm::ivec3> triVerts;
   /// Optional: The X-Y-Z normal vectors of each vertex. If non-empty, must have
   /// the same length as vertPos. If empty, these will be calculated
   /// automatically.
-  std::vector<glm::vec3> vertNormal;
+  std::vector<vec3> vertNormal;
   /// Optional: The X-Y-Z-W weighted tangent vectors for smooth Refine(). If
   /// non-empty, must be exactly three times as long as Mesh.triVerts. Indexed
   /// as 3 * tri + i, representing the tangent from Mesh.triVerts[tri][i] along
   /// the CCW edge. If empty, mesh is faceted.
-  std::vector<glm::vec4> halfedgeTangent;
+  std::vector<vec4> halfedgeTangent;
 
   Mesh() = default;
-  Mesh(const std::vector<glm::vec3>& vertPos_,
+  Mesh(const std::vector<vec3>& vertPos_,
        const std::vector<glm::ivec3>& triVerts_,
-       const std::vector<glm::vec3>& vertNormal_ = {},
-       const std::vector<glm::vec4>& halfedgeTangent_ = {})
+       const std::vector<vec3>& vertNormal_ = {},
+       const std::vector<vec4>& halfedgeTangent_ = {})
       : vertPos(vertPos_),
         triVerts(triVerts_),
         vertNormal(vertNormal_),
@@ -235,14 +315,169 @@ struct Smoothness {
   /// A value between 0 and 1, where 0 is sharp and 1 is the default and the
   /// curvature is interpolated between these values. The two paired halfedges
   /// can have different values while maintaining C-1 continuity (except for 0).
-  float smoothness;
+  Real smoothness;
 };
 
 /**
  * Geometric properties of the manifold, created with Manifold.GetProperties().
  */
 struct Properties {
-  float surfaceArea, volume;
+  Real surfaceArea, volume;
+};
+
+/**
+ * The nearest intersection of a ray with the surface, created with
+ * Manifold.RayCast(). Triangles are hit from either side.
+ */
+struct RayHit {
+  /// The hit triangle of Mesh.triVerts, or -1 if the ray missed.
+  int tri = -1;
+  /// The distance from the ray origin to the hit.
+  Real distance = std::numeric_limits<Real>::infinity();
+  /// The position of the hit relative to the corners of tri.
+  vec3 barycentric = vec3(0);
+  /// The OriginalID and triangle of the original mesh tri is part of, as in
+  /// BaryRef, and the position of the hit relative to that triangle, e.g. for
+  /// interpolating its UV coordinates.
+  int originalID = -1;
+  int originalTri = -1;
+  vec3 originalBarycentric = vec3(0);
+};
+
+/**
+ * Counters of the process-wide Boolean result cache, see
+ * Manifold.SetCacheBudget().
+ */
+struct CacheStats {
+  /// Number of CSG subtrees whose result was found in the cache.
+  size_t hits = 0;
+  /// Number of CSG subtrees which had to be evaluated.
+  size_t misses = 0;
+  /// Number of results currently held.
+  size_t entries = 0;
+  /// Approximate memory held by the cached results, in bytes.
+  size_t bytes = 0;
+  /// Memory budget in bytes; zero means the cache is disabled.
+  size_t budget = 0;
+};
+
+/**
+ * Bytes reserved by each buffer of a manifold, created with
+ * Manifold.GetMemoryUsage(). Buffers shared with copies of the manifold are
+ * counted in full.
+ */
+struct MemoryUsage {
+  size_t vertPos = 0;
+  size_t halfedge = 0;
+  size_t vertNormal = 0;
+  size_t faceNormal = 0;
+  size_t halfedgeTangent = 0;
+  /// Barycentric coordinates and triangle references to the input meshes.
+  size_t meshRelation = 0;
+  /// The bounding volume hierarchy over the triangles.
+  size_t collider = 0;
+
+  size_t Total() const {
+    return vertPos + halfedge + vertNormal + faceNormal + halfedgeTangent +
+           meshRelation + collider;
+  }
+};
+
+/**
+ * Two manifolds whose surfaces may touch, see Manifold.Overlaps().
+ */
+struct OverlapPair {
+  /// Indices of the manifolds, with first < second.
+  int first;
+  int second;
+  /// Number of bounding box overlaps between the edges of each and the faces
+  /// of the other, as counted by Manifold.NumOverlaps(); always positive.
+  int numOverlaps;
+};
+
+/**
+ * Instrumentation of the Boolean operations, accumulated process-wide since
+ * the last Manifold.ResetBooleanStats(), see Manifold.GetBooleanStats(), and
+ * for the operations that produced one result, see Manifold.GetResultStats().
+ * Collected in all builds at the cost of a few clock reads per operation.
+ */
+struct BooleanStats {
+  enum Phase {
+    /// Broad phase: edge-face and vertex-face collisions and their sorting.
+    Collide,
+    Filter11,
+    Shadow11,
+    Shadow02,
+    Intersect12,
+    Winding03,
+    /// Inclusion numbers and output vertices.
+    AddVerts,
+    SizeOutput,
+    AppendPartialEdges,
+    /// AppendNewEdges, AppendWholeEdges and CalculateMeshRelation.
+    AppendEdges,
+    Face2Tri,
+    SimplifyTopology,
+    Finish,
+    kNumPhase
+  };
+
+  /// Number of Boolean operations.
+  int numBoolean = 0;
+  /// Wall time spent in each phase, in seconds.
+  double seconds[kNumPhase] = {};
+  /// Wall time of the slowest single operation, in seconds.
+  double maxSeconds = 0;
+  /// Sizes of the sparse index arrays, summed over the operations.
+  size_t p1q2 = 0, p2q1 = 0, p0q2 = 0, p2q0 = 0, p1q1 = 0;
+  size_t s11 = 0, s02 = 0, s20 = 0, x12 = 0, x21 = 0;
+  /// Comparisons too close to call in float that were re-evaluated in double,
+  /// which only happens with Manifold.SetRobustPredicates().
+  size_t robustTies = 0;
+  /// Size of the results.
+  size_t numVert = 0, numTri = 0;
+  /// Bytes of vector storage requested by the operations, and the part of it
+  /// that was newly allocated rather than recycled by their memory pool. These
+  /// are not counted for an operation nested inside another one's pool.
+  size_t bytesRequested = 0, bytesAllocated = 0;
+
+  static const char* PhaseName(Phase phase) {
+    static const char* names[kNumPhase] = {
+        "Collide",     "Filter11",    "Shadow11",
+        "Shadow02",    "Intersect12", "Winding03",
+        "AddVerts",    "SizeOutput",  "AppendPartialEdges",
+        "AppendEdges", "Face2Tri",    "SimplifyTopology",
+        "Finish"};
+    return names[phase];
+  }
+
+  double TotalSeconds() const {
+    double total = 0;
+    for (double phase : seconds) total += phase;
+    return total;
+  }
+
+  BooleanStats& operator+=(const BooleanStats& other) {
+    numBoolean += other.numBoolean;
+    for (int i = 0; i < kNumPhase; ++i) seconds[i] += other.seconds[i];
+    maxSeconds = glm::max(maxSeconds, other.maxSeconds);
+    p1q2 += other.p1q2;
+    p2q1 += other.p2q1;
+    p0q2 += other.p0q2;
+    p2q0 += other.p2q0;
+    p1q1 += other.p1q1;
+    s11 += other.s11;
+    s02 += other.s02;
+    s20 += other.s20;
+    x12 += other.x12;
+    x21 += other.x21;
+    robustTies += other.robustTies;
+    numVert += other.numVert;
+    numTri += other.numTri;
+    bytesRequested += other.bytesRequested;
+    bytesAllocated += other.bytesAllocated;
+    return *this;
+  }
 };
 
 /**
@@ -250,9 +485,9 @@ struct Properties {
  * Manifold.GetCurvature() for details.
  */
 struct Curvature {
-  float maxMeanCurvature, minMeanCurvature;
-  float maxGaussianCurvature, minGaussianCurvature;
-  std::vector<float> vertMeanCurvature, vertGaussianCurvature;
+  Real maxMeanCurvature, minMeanCurvature;
+  Real maxGaussianCurvature, minGaussianCurvature;
+  std::vector<Real> vertMeanCurvature, vertGaussianCurvature;
 };
 
 /**
@@ -285,7 +520,7 @@ struct BaryRef {
 struct MeshRelation {
   /// A vector of shared barycentric coordinates representing the position of a
   /// vertex relative to its original triangle.
-  std::vector<glm::vec3> barycentric;
+  std::vector<vec3> barycentric;
   /// A vector matching Mesh.triVerts that contains the relation of each output
   /// triangle to a single input triangle.
   std::vector<BaryRef> triBary;
@@ -297,8 +532,8 @@ struct MeshRelation {
    * @param tri A valid triangle index of Mesh.triVerts.
    * @param vert The corner of the triangle: 0, 1, or 2.
    */
-  inline glm::vec3 UVW(int tri, int vert) {
-    glm::vec3 uvw(0.0f);
+  inline vec3 UVW(int tri, int vert) {
+    vec3 uvw(0.0f);
     const int idx = triBary[tri].vertBary[vert];
     if (idx < 0) {
       uvw[idx + 3] = 1;
@@ -314,8 +549,8 @@ struct MeshRelation {
  * Axis-aligned bounding box
  */
 struct Box {
-  glm::vec3 min = glm::vec3(std::numeric_limits<float>::infinity());
-  glm::vec3 max = glm::vec3(-std::numeric_limits<float>::infinity());
+  vec3 min = vec3(std::numeric_limits<Real>::infinity());
+  vec3 max = vec3(-std::numeric_limits<Real>::infinity());
 
   /**
    * Default constructor is an infinite box that contains all space.
@@ -325,7 +560,7 @@ struct Box {
   /**
    * Creates a box that contains the two given points.
    */
-  HOST_DEVICE Box(const glm::vec3 p1, const glm::vec3 p2) {
+  HOST_DEVICE Box(const vec3 p1, const vec3 p2) {
     min = glm::min(p1, p2);
     max = glm::max(p1, p2);
   }
@@ -333,26 +568,26 @@ struct Box {
   /**
    * Returns the dimensions of the Box.
    */
-  HOST_DEVICE glm::vec3 Size() const { return max - min; }
+  HOST_DEVICE vec3 Size() const { return max - min; }
 
   /**
    * Returns the center point of the Box.
    */
-  HOST_DEVICE glm::vec3 Center() const { return 0.5f * (max + min); }
+  HOST_DEVICE vec3 Center() const { return Real(0.5) * (max + min); }
 
   /**
    * Returns the absolute-largest coordinate value of any contained
    * point.
    */
-  HOST_DEVICE float Scale() const {
-    glm::vec3 absMax = glm::max(glm::abs(min), glm::abs(max));
+  HOST_DEVICE Real Scale() const {
+    vec3 absMax = glm::max(glm::abs(min), glm::abs(max));
     return glm::max(absMax.x, glm::max(absMax.y, absMax.z));
   }
 
   /**
    * Does this box contain (includes equal) the given point?
    */
-  HOST_DEVICE bool Contains(const glm::vec3& p) const {
+  HOST_DEVICE bool Contains(const vec3& p) const {
     return glm::all(glm::greaterThanEqual(p, min)) &&
            glm::all(glm::greaterThanEqual(max, p));
   }
@@ -368,7 +603,7 @@ struct Box {
   /**
    * Expand this box to include the given point.
    */
-  HOST_DEVICE void Union(const glm::vec3 p) {
+  HOST_DEVICE void Union(const vec3 p) {
     min = glm::min(min, p);
     max = glm::max(max, p);
   }
@@ -390,10 +625,10 @@ struct Box {
    * multiples of 90 degrees), or else the resulting bounding box will no longer
    * bound properly.
    */
-  HOST_DEVICE Box Transform(const glm::mat4x3& transform) const {
+  HOST_DEVICE Box Transform(const mat4x3& transform) const {
     Box out;
-    glm::vec3 minT = transform * glm::vec4(min, 1.0f);
-    glm::vec3 maxT = transform * glm::vec4(max, 1.0f);
+    vec3 minT = transform * vec4(min, 1.0f);
+    vec3 maxT = transform * vec4(max, 1.0f);
     out.min = glm::min(minT, maxT);
     out.max = glm::max(minT, maxT);
     return out;
@@ -402,7 +637,7 @@ struct Box {
   /**
    * Shift this box by the given vector.
    */
-  HOST_DEVICE Box operator+(glm::vec3 shift) const {
+  HOST_DEVICE Box operator+(vec3 shift) const {
     Box out;
     out.min = min + shift;
     out.max = max + shift;
@@ -412,7 +647,7 @@ struct Box {
   /**
    * Shift this box in-place by the given vector.
    */
-  HOST_DEVICE Box& operator+=(glm::vec3 shift) {
+  HOST_DEVICE Box& operator+=(vec3 shift) {
     min += shift;
     max += shift;
     return *this;
@@ -421,7 +656,7 @@ struct Box {
   /**
    * Scale this box by the given vector.
    */
-  HOST_DEVICE Box operator*(glm::vec3 scale) const {
+  HOST_DEVICE Box operator*(vec3 scale) const {
     Box out;
     out.min = min * scale;
     out.max = max * scale;
@@ -431,7 +666,7 @@ struct Box {
   /**
    * Scale this box in-place by the given vector.
    */
-  HOST_DEVICE Box& operator*=(glm::vec3 scale) {
+  HOST_DEVICE Box& operator*=(vec3 scale) {
     min *= scale;
     max *= scale;
     return *this;
@@ -449,7 +684,7 @@ struct Box {
    * Does the given point project within the XY extent of this box
    * (including equality)?
    */
-  HOST_DEVICE bool DoesOverlap(glm::vec3 p) const {  // projected in z
+  HOST_DEVICE bool DoesOverlap(vec3 p) const {  // projected in z
     return p.x <= max.x && p.x >= min.x && p.y <= max.y && p.y >= min.y;
   }
 
@@ -488,6 +723,29 @@ struct geometryErr : public virtual std::runtime_error {
 };
 using logicErr = std::logic_error;
 #endif
+/**
+ * Thrown by the future of Manifold.EvaluateAsync() once cancelled; unlike the
+ * above, this does not depend on MANIFOLD_DEBUG.
+ */
+struct cancelErr : public virtual std::runtime_error {
+  using std::runtime_error::runtime_error;
+};
+/**
+ * Thrown by an allocation that would exceed SetMemoryBudget(), after the
+ * Boolean result cache has been evicted to make room. Like cancelErr, this
+ * does not depend on MANIFOLD_DEBUG.
+ */
+struct memoryErr : public virtual std::runtime_error {
+  using std::runtime_error::runtime_error;
+};
+/**
+ * Thrown for an invalid argument to a public function that is checked in
+ * every build, as reading past it would be undefined. Like cancelErr, this
+ * does not depend on MANIFOLD_DEBUG.
+ */
+struct argumentErr : public virtual std::runtime_error {
+  using std::runtime_error::runtime_error;
+};
 /** @} */
 
 /**
@@ -507,8 +765,61 @@ struct ExecutionParams {
   /// Suppresses printed errors regarding CW triangles. Has no effect if
   /// processOverlaps is true.
   bool suppressErrors = false;
+  /// Skips SimplifyTopology() when constructing from a Mesh, leaving its short
+  /// edges and degenerate triangles in place. Only set this for meshes known
+  /// to be clean, such as those from GetMesh(). Meshes with edges that are not
+  /// 2-manifold are still simplified.
+  bool trustInputMesh = false;
+};
+
+/**
+ * The relative cost per element of a parallel kernel, used to pick the
+ * workload size at which it is worth running in parallel.
+ */
+enum class KernelCost {
+  /// Simple element-wise functors, copies and fills.
+  Light,
+  /// Prefix sums and reductions.
+  Scan,
+  /// Sorts and sorts by key.
+  Sort,
+  /// Functors doing substantial work per element, such as the Boolean's
+  /// intersection kernels and collider queries.
+  Heavy,
 };
 
+/**
+ * The workload sizes at which autoPolicy() switches backends, per KernelCost.
+ * The defaults are generic; CalibratePolicyThresholds() measures the
+ * crossovers of the current machine. The result can be stored and restored at
+ * startup with SetPolicyThresholds().
+ */
+struct PolicyThresholds {
+  static constexpr int kNumCost = 4;
+  /// Largest workload run sequentially.
+  int seqMax[kNumCost] = {1 << 12, 1 << 12, 1 << 12, 1 << 12};
+  /// Largest workload run in parallel on the CPU when CUDA is enabled; larger
+  /// ones run on the GPU.
+  int parMax[kNumCost] = {1 << 16, 1 << 16, 1 << 16, 1 << 16};
+
+  int SeqMax(KernelCost cost) const { return seqMax[static_cast<int>(cost)]; }
+  int ParMax(KernelCost cost) const { return parMax[static_cast<int>(cost)]; }
+};
+
+PolicyThresholds GetPolicyThresholds();
+void SetPolicyThresholds(const PolicyThresholds& thresholds);
+PolicyThresholds CalibratePolicyThresholds();
+
+void SetMaxThreads(int numThreads);
+int MaxThreads();
+
+int NumCudaDevices();
+void SetCudaDevice(int device);
+
+void SetMemoryBudget(size_t bytes);
+size_t MemoryBudget();
+size_t MemoryInUse();
+
 #ifdef MANIFOLD_DEBUG
 
 inline std::ostream& operator<<(std::ostream& stream, const Box& box) {
@@ -534,8 +845,8 @@ inline std::ostream& operator<<(std::ostream& stream, const glm::tvec4<T>& v) {
                 << ", w = " << v.w;
 }
 
-inline std::ostream& operator<<(std::ostream& stream, const glm::mat4x3& mat) {
-  glm::mat3x4 tam = glm::transpose(mat);
+inline std::ostream& operator<<(std::ostream& stream, const mat4x3& mat) {
+  mat3x4 tam = glm::transpose(mat);
   return stream << tam[0] << std::endl
                 << tam[1] << std::endl
                 << tam[2] << std::endl;
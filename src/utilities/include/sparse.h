@@ -62,7 +62,32 @@ class SparseIndices {
   int size() const { return p.size(); }
   void SwapPQ() { p.swap(q); }
 
-  void Sort(ExecutionPolicy policy) { sort(policy, beginPQ(), endPQ()); }
+  // Orders (p, q) pairs as a single 64-bit key, so they take the radix sort.
+  struct PackPQ {
+    __host__ __device__ uint64_t operator()(thrust::tuple<int, int> pq) const {
+      return (static_cast<uint64_t>(ToBits(thrust::get<0>(pq))) << 32) |
+             ToBits(thrust::get<1>(pq));
+    }
+    __host__ __device__ static uint32_t ToBits(int x) {
+      return static_cast<uint32_t>(x) ^ 0x80000000u;
+    }
+  };
+
+  struct UnpackPQ {
+    __host__ __device__ thrust::tuple<int, int> operator()(uint64_t key) const {
+      return thrust::make_tuple(FromBits(key >> 32), FromBits(key));
+    }
+    __host__ __device__ static int FromBits(uint64_t x) {
+      return static_cast<int>(static_cast<uint32_t>(x) ^ 0x80000000u);
+    }
+  };
+
+  void Sort(ExecutionPolicy policy) {
+    VecDH<uint64_t> keys(size());
+    transform(policy, beginPQ(), endPQ(), keys.begin(), PackPQ());
+    sort(policy, keys.begin(), keys.end());
+    transform(policy, keys.begin(), keys.end(), beginPQ(), UnpackPQ());
+  }
 
   void Resize(int size) {
     p.resize(size, -1);
@@ -98,14 +123,14 @@ class SparseIndices {
 
   template <typename T>
   struct firstNonFinite {
-    __host__ __device__ bool NotFinite(float v) const { return !isfinite(v); }
-    __host__ __device__ bool NotFinite(glm::vec2 v) const {
+    __host__ __device__ bool NotFinite(Real v) const { return !isfinite(v); }
+    __host__ __device__ bool NotFinite(vec2 v) const {
       return !isfinite(v[0]);
     }
-    __host__ __device__ bool NotFinite(glm::vec3 v) const {
+    __host__ __device__ bool NotFinite(vec3 v) const {
       return !isfinite(v[0]);
     }
-    __host__ __device__ bool NotFinite(glm::vec4 v) const {
+    __host__ __device__ bool NotFinite(vec4 v) const {
       return !isfinite(v[0]);
     }
 
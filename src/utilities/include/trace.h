@@ -0,0 +1,70 @@
+// Copyright 2022 The Manifold Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include <chrono>
+#include <string>
+
+namespace manifold {
+
+/** @addtogroup Private
+ *  @{
+ */
+void StartTrace();
+std::string StopTrace();
+bool Tracing();
+
+/**
+ * Records the lifetime of this object as a complete event of the trace, on
+ * the calling thread, if tracing was on when it was created. Otherwise it
+ * costs a single atomic load. The name and argument keys must be string
+ * literals, as they are kept by pointer and written without escaping.
+ */
+class TraceSpan {
+ public:
+  explicit TraceSpan(const char* name) : name_(name), active_(Tracing()) {
+    if (active_) start_ = Clock::now();
+  }
+  ~TraceSpan() {
+    if (active_) Record();
+  }
+  TraceSpan(const TraceSpan&) = delete;
+  TraceSpan& operator=(const TraceSpan&) = delete;
+
+  void Arg(const char* key, long long value) {
+    if (active_) AppendArg(key, std::to_string(value));
+  }
+  void Arg(const char* key, const char* value) {
+    if (active_) AppendArg(key, std::string("\"") + value + "\"");
+  }
+
+ private:
+  using Clock = std::chrono::steady_clock;
+  const char* const name_;
+  const bool active_;
+  Clock::time_point start_;
+  // the JSON members of the event's args object
+  std::string args_;
+
+  void AppendArg(const char* key, const std::string& value) {
+    if (!args_.empty()) args_ += ',';
+    args_ += '"';
+    args_ += key;
+    args_ += "\":";
+    args_ += value;
+  }
+  void Record();
+};
+/** @} */
+}  // namespace manifold
@@ -132,6 +132,46 @@ inline __host__ __device__ int AtomicAdd(int& target, int add) {
 #endif
 }
 
+inline __host__ __device__ int AtomicMin(int& target, int value) {
+#ifdef __CUDA_ARCH__
+  // required for synchronization
+  __threadfence();
+  return atomicMin(&target, value);
+#else
+  std::atomic<int>& tar = reinterpret_cast<std::atomic<int>&>(target);
+  int old_val = tar.load();
+  while (old_val > value &&
+         !tar.compare_exchange_weak(old_val, value, std::memory_order_seq_cst))
+    ;
+  return old_val;
+#endif
+}
+
+inline __host__ __device__ int AtomicLoad(const int& target) {
+#ifdef __CUDA_ARCH__
+  return *reinterpret_cast<const volatile int*>(&target);
+#else
+  const std::atomic<int>& tar =
+      reinterpret_cast<const std::atomic<int>&>(target);
+  return tar.load(std::memory_order_seq_cst);
+#endif
+}
+
+// Returns true if target was expected and has been replaced by desired.
+inline __host__ __device__ bool AtomicCompareExchange(int& target,
+                                                      int expected,
+                                                      int desired) {
+#ifdef __CUDA_ARCH__
+  // required for synchronization
+  __threadfence();
+  return atomicCAS(&target, expected, desired) == expected;
+#else
+  std::atomic<int>& tar = reinterpret_cast<std::atomic<int>&>(target);
+  return tar.compare_exchange_strong(expected, desired,
+                                     std::memory_order_seq_cst);
+#endif
+}
+
 // Copied from
 // https://github.com/thrust/thrust/blob/master/examples/strided_range.cu
 template <typename Iterator>
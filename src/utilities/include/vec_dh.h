@@ -17,6 +17,11 @@
 #include <cuda.h>
 #endif
 
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <vector>
+
 #include "par.h"
 #include "public.h"
 
@@ -26,6 +31,86 @@ namespace manifold {
  *  @{
  */
 
+/**
+ * The source of ManagedVec's memory. The base resource allocates directly with
+ * malloc, or cudaMallocManaged when CUDA is enabled. Another resource can be
+ * installed per thread to serve and recycle allocations, but every block must
+ * ultimately come from the base resource, so that any block can be released
+ * by whichever resource is current when it is freed.
+ */
+class MemoryResource {
+ public:
+  virtual ~MemoryResource() {}
+  // bytes may be rounded up; it is updated to the size actually allocated,
+  // which must be passed back to Deallocate.
+  virtual void *Allocate(size_t &bytes);
+  virtual void Deallocate(void *ptr, size_t bytes);
+
+  static MemoryResource *Base();
+  static MemoryResource *Current();
+  // Installs the resource for the calling thread, nullptr meaning the base
+  // resource, and returns the previous one.
+  static MemoryResource *SetCurrent(MemoryResource *resource);
+  // Called when an allocation would exceed SetMemoryBudget(), before it is
+  // retried once; it should release whatever memory it can.
+  static void SetPressureHandler(std::function<void()> handler);
+};
+
+/**
+ * Size-class pool for the temporaries of an operation. Allocations are rounded
+ * up to a size class (quarter powers of two) and freed blocks are kept in
+ * per-class free lists for reuse, then handed back to the base resource in
+ * bulk by Release() or the destructor. Not thread-safe; it is meant to be used
+ * through MemoryPoolScope.
+ */
+class MemoryPool : public MemoryResource {
+ public:
+  ~MemoryPool() override { Release(); }
+  void *Allocate(size_t &bytes) override;
+  void Deallocate(void *ptr, size_t bytes) override;
+  void Release();
+
+  // bytes served since construction, and the part newly taken from the base
+  size_t BytesRequested() const { return requested_; }
+  size_t BytesAllocated() const { return allocated_; }
+
+ private:
+  // four classes per power of two, up to 2^48 bytes
+  static constexpr int kNumClass = 4 * 48;
+  std::vector<void *> free_[kNumClass];
+  size_t requested_ = 0;
+  size_t allocated_ = 0;
+};
+
+/**
+ * Installs a MemoryPool on the calling thread for the lifetime of this object,
+ * unless a pool is already active, in which case the outer one keeps serving.
+ * Buffers may outlive the scope; they are then simply freed to the base
+ * resource.
+ */
+class MemoryPoolScope {
+ public:
+  MemoryPoolScope() {
+    if (MemoryResource::Current() == MemoryResource::Base()) {
+      pool_.reset(new MemoryPool());
+      MemoryResource::SetCurrent(pool_.get());
+    }
+  }
+
+  ~MemoryPoolScope() {
+    if (pool_ != nullptr) MemoryResource::SetCurrent(nullptr);
+  }
+
+  MemoryPoolScope(const MemoryPoolScope &) = delete;
+  MemoryPoolScope &operator=(const MemoryPoolScope &) = delete;
+
+  // The pool installed by this scope, or nullptr if an outer one is serving.
+  const MemoryPool *Pool() const { return pool_.get(); }
+
+ private:
+  std::unique_ptr<MemoryPool> pool_;
+};
+
 // Vector implementation optimized for managed memory, will perform memory
 // prefetching to minimize page faults and use parallel/GPU copy/fill depending
 // on data size. This will also handle builds without CUDA or builds with CUDA
@@ -53,7 +138,8 @@ class ManagedVec {
     capacity_ = n;
     onHost = autoPolicy(n) != ExecutionPolicy::ParUnseq;
     if (n == 0) return;
-    mallocManaged(&ptr_, size_ * sizeof(T));
+    bytes_ = size_ * sizeof(T);
+    ptr_ = mallocManaged(bytes_);
   }
 
   ManagedVec(size_t n, const T &val) {
@@ -62,16 +148,18 @@ class ManagedVec {
     if (n == 0) return;
     auto policy = autoPolicy(n);
     onHost = policy != ExecutionPolicy::ParUnseq;
-    mallocManaged(&ptr_, size_ * sizeof(T));
+    bytes_ = size_ * sizeof(T);
+    ptr_ = mallocManaged(bytes_);
     prefetch(ptr_, size_ * sizeof(T), onHost);
     uninitialized_fill_n(policy, ptr_, n, val);
   }
 
   ~ManagedVec() {
-    if (ptr_ != nullptr) freeManaged(ptr_);
+    if (ptr_ != nullptr) freeManaged(ptr_, bytes_);
     ptr_ = nullptr;
     size_ = 0;
     capacity_ = 0;
+    bytes_ = 0;
   }
 
   ManagedVec(const std::vector<T> &vec) {
@@ -80,7 +168,8 @@ class ManagedVec {
     auto policy = autoPolicy(size_);
     onHost = policy != ExecutionPolicy::ParUnseq;
     if (size_ != 0) {
-      mallocManaged(&ptr_, size_ * sizeof(T));
+      bytes_ = size_ * sizeof(T);
+      ptr_ = mallocManaged(bytes_);
       fastUninitializedCopy(ptr_, vec.data(), size_, policy);
     }
   }
@@ -91,31 +180,51 @@ class ManagedVec {
     auto policy = autoPolicy(size_);
     onHost = policy != ExecutionPolicy::ParUnseq;
     if (size_ != 0) {
-      mallocManaged(&ptr_, size_ * sizeof(T));
+      bytes_ = size_ * sizeof(T);
+      ptr_ = mallocManaged(bytes_);
       prefetch(ptr_, size_ * sizeof(T), onHost);
       uninitialized_copy(policy, vec.begin(), vec.end(), ptr_);
     }
   }
 
+  // Copies as many of the elements of vec as fit in a buffer of n.
+  ManagedVec(const ManagedVec<T> &vec, size_t n) {
+    size_ = std::min(n, vec.size_);
+    capacity_ = n;
+    auto policy = autoPolicy(size_);
+    onHost = policy != ExecutionPolicy::ParUnseq;
+    if (n != 0) {
+      bytes_ = n * sizeof(T);
+      ptr_ = mallocManaged(bytes_);
+      prefetch(ptr_, size_ * sizeof(T), onHost);
+      uninitialized_copy(policy, vec.begin(), vec.begin() + size_, ptr_);
+    }
+  }
+
   ManagedVec(ManagedVec<T> &&vec) {
     ptr_ = vec.ptr_;
     size_ = vec.size_;
     capacity_ = vec.capacity_;
+    bytes_ = vec.bytes_;
     onHost = vec.onHost;
     vec.ptr_ = nullptr;
     vec.size_ = 0;
     vec.capacity_ = 0;
+    vec.bytes_ = 0;
   }
 
   ManagedVec &operator=(const ManagedVec<T> &vec) {
     if (&vec == this) return *this;
-    if (ptr_ != nullptr) freeManaged(ptr_);
+    if (ptr_ != nullptr) freeManaged(ptr_, bytes_);
+    ptr_ = nullptr;
+    bytes_ = 0;
     size_ = vec.size_;
     capacity_ = vec.size_;
     auto policy = autoPolicy(size_);
     onHost = policy != ExecutionPolicy::ParUnseq;
     if (size_ != 0) {
-      mallocManaged(&ptr_, size_ * sizeof(T));
+      bytes_ = size_ * sizeof(T);
+      ptr_ = mallocManaged(bytes_);
       prefetch(ptr_, size_ * sizeof(T), onHost);
       uninitialized_copy(policy, vec.begin(), vec.end(), ptr_);
     }
@@ -124,14 +233,16 @@ class ManagedVec {
 
   ManagedVec &operator=(ManagedVec<T> &&vec) {
     if (&vec == this) return *this;
-    if (ptr_ != nullptr) freeManaged(ptr_);
+    if (ptr_ != nullptr) freeManaged(ptr_, bytes_);
     onHost = vec.onHost;
     size_ = vec.size_;
     capacity_ = vec.capacity_;
+    bytes_ = vec.bytes_;
     ptr_ = vec.ptr_;
     vec.ptr_ = nullptr;
     vec.size_ = 0;
     vec.capacity_ = 0;
+    vec.bytes_ = 0;
     return *this;
   }
 
@@ -150,27 +261,31 @@ class ManagedVec {
 
   void reserve(size_t n) {
     if (n > capacity_) {
-      T *newBuffer;
-      mallocManaged(&newBuffer, n * sizeof(T));
+      size_t newBytes = n * sizeof(T);
+      T *newBuffer = mallocManaged(newBytes);
       prefetch(newBuffer, size_ * sizeof(T), onHost);
       if (size_ > 0) {
         uninitialized_copy(autoPolicy(size_), ptr_, ptr_ + size_, newBuffer);
       }
-      if (ptr_ != nullptr) freeManaged(ptr_);
+      if (ptr_ != nullptr) freeManaged(ptr_, bytes_);
       ptr_ = newBuffer;
+      bytes_ = newBytes;
       capacity_ = n;
     }
   }
 
   void shrink_to_fit() {
     T *newBuffer = nullptr;
+    size_t newBytes = 0;
     if (size_ > 0) {
-      mallocManaged(&newBuffer, size_ * sizeof(T));
+      newBytes = size_ * sizeof(T);
+      newBuffer = mallocManaged(newBytes);
       prefetch(newBuffer, size_ * sizeof(T), onHost);
       uninitialized_copy(autoPolicy(size_), ptr_, ptr_ + size_, newBuffer);
     }
-    freeManaged(ptr_);
+    if (ptr_ != nullptr) freeManaged(ptr_, bytes_);
     ptr_ = newBuffer;
+    bytes_ = newBytes;
     capacity_ = size_;
   }
 
@@ -190,11 +305,15 @@ class ManagedVec {
     std::swap(ptr_, other.ptr_);
     std::swap(size_, other.size_);
     std::swap(capacity_, other.capacity_);
+    std::swap(bytes_, other.bytes_);
     std::swap(onHost, other.onHost);
   }
 
+  // Only writes on an actual move, so that concurrent host reads of a vector
+  // already on the host don't race.
   void prefetch_to(bool toHost) const {
-    if (toHost != onHost) prefetch(ptr_, size_ * sizeof(T), toHost);
+    if (toHost == onHost) return;
+    prefetch(ptr_, size_ * sizeof(T), toHost);
     onHost = toHost;
   }
 
@@ -236,33 +355,26 @@ class ManagedVec {
   T *ptr_ = nullptr;
   size_t size_ = 0;
   size_t capacity_ = 0;
+  // bytes actually allocated for ptr_, which may exceed capacity_
+  size_t bytes_ = 0;
   mutable bool onHost = true;
 
   static constexpr int DEVICE_MAX_BYTES = 1 << 16;
 
-  static void mallocManaged(T **ptr, size_t bytes) {
-#ifdef MANIFOLD_USE_CUDA
-    if (CudaEnabled())
-      cudaMallocManaged(reinterpret_cast<void **>(ptr), bytes);
-    else
-#endif
-      *ptr = reinterpret_cast<T *>(malloc(bytes));
+  static T *mallocManaged(size_t &bytes) {
+    return reinterpret_cast<T *>(MemoryResource::Current()->Allocate(bytes));
   }
 
-  static void freeManaged(T *ptr) {
-#ifdef MANIFOLD_USE_CUDA
-    if (CudaEnabled())
-      cudaFree(ptr);
-    else
-#endif
-      free(ptr);
+  static void freeManaged(T *ptr, size_t bytes) {
+    MemoryResource::Current()->Deallocate(ptr, bytes);
   }
 
   static void prefetch(T *ptr, int bytes, bool onHost) {
 #ifdef MANIFOLD_USE_CUDA
     if (bytes > 0 && CudaEnabled())
       cudaMemPrefetchAsync(ptr, std::min(bytes, DEVICE_MAX_BYTES),
-                           onHost ? cudaCpuDeviceId : 0);
+                           onHost ? cudaCpuDeviceId : CudaDevice(),
+                           cudaStreamPerThread);
 #endif
   }
 
@@ -301,6 +413,12 @@ class ManagedVec {
  * Note that it is *NOT SAFE* to first obtain a host(device) pointer, perform
  * some device(host) modification, and then read the host(device) pointer again
  * (on the same vector). The memory will be inconsistent in that case.
+ *
+ * Copies share their buffer until one of them is accessed through a non-const
+ * method, which then copies it (copy-on-write). Reading through a const
+ * reference never copies, so prefer const access to vectors that may be
+ * shared. For the same reason, a non-const pointer or iterator must not be
+ * kept across a copy of its vector, as writes through it would show in both.
  */
 template <typename T>
 class VecDH {
@@ -310,11 +428,17 @@ class VecDH {
   // Note that the vector constructed with this constructor will contain
   // uninitialized memory. Please specify `val` if you need to make sure that
   // the data is initialized.
-  VecDH(int size) { impl_.resize(size); }
+  VecDH(int size) {
+    if (size > 0) impl_ = std::make_shared<ManagedVec<T>>(size);
+  }
 
-  VecDH(int size, T val) { impl_.resize(size, val); }
+  VecDH(int size, T val) {
+    if (size > 0) impl_ = std::make_shared<ManagedVec<T>>(size, val);
+  }
 
-  VecDH(const std::vector<T> &vec) { impl_ = vec; }
+  VecDH(const std::vector<T> &vec) {
+    if (!vec.empty()) impl_ = std::make_shared<ManagedVec<T>>(vec);
+  }
 
   VecDH(const VecDH<T> &other) { impl_ = other.impl_; }
 
@@ -330,94 +454,127 @@ class VecDH {
     return *this;
   }
 
-  int size() const { return impl_.size(); }
+  int size() const { return impl_ == nullptr ? 0 : impl_->size(); }
+
+  // Bytes reserved by the buffer, counted in full even when it is shared.
+  size_t Bytes() const {
+    return impl_ == nullptr ? 0 : impl_->capacity() * sizeof(T);
+  }
 
   void resize(int newSize, T val = T()) {
-    bool shrink = size() > 2 * newSize;
-    impl_.resize(newSize, val);
-    if (shrink) impl_.shrink_to_fit();
+    if (newSize == size()) return;
+    if (newSize == 0) {
+      impl_.reset();
+      return;
+    }
+    // a shared buffer is copied at the new size, so it needs no shrinking
+    bool shrink = !IsShared() && size() > 2 * newSize;
+    ManagedVec<T> &vec = Mutable(newSize);
+    vec.resize(newSize, val);
+    if (shrink) vec.shrink_to_fit();
   }
 
   void swap(VecDH<T> &other) { impl_.swap(other.impl_); }
 
+  // Whether this vector's buffer is currently shared with other copies.
+  bool IsShared() const { return impl_ != nullptr && impl_.use_count() > 1; }
+
   using Iter = typename ManagedVec<T>::Iter;
   using IterC = typename ManagedVec<T>::IterC;
 
   Iter begin() {
-    impl_.prefetch_to(autoPolicy(size()) != ExecutionPolicy::ParUnseq);
-    return impl_.begin();
+    if (impl_ == nullptr) return nullptr;
+    ManagedVec<T> &vec = Mutable(size());
+    vec.prefetch_to(autoPolicy(size()) != ExecutionPolicy::ParUnseq);
+    return vec.begin();
   }
 
-  Iter end() { return impl_.end(); }
+  Iter end() { return impl_ == nullptr ? nullptr : Mutable(size()).end(); }
 
   IterC cbegin() const {
-    impl_.prefetch_to(autoPolicy(size()) != ExecutionPolicy::ParUnseq);
-    return impl_.cbegin();
+    if (impl_ == nullptr) return nullptr;
+    impl_->prefetch_to(autoPolicy(size()) != ExecutionPolicy::ParUnseq);
+    return impl_->cbegin();
   }
 
-  IterC cend() const { return impl_.cend(); }
+  IterC cend() const { return impl_ == nullptr ? nullptr : impl_->cend(); }
 
   IterC begin() const { return cbegin(); }
   IterC end() const { return cend(); }
 
   T *ptrD() {
     if (size() == 0) return nullptr;
-    impl_.prefetch_to(autoPolicy(size()) != ExecutionPolicy::ParUnseq);
-    return impl_.data();
+    ManagedVec<T> &vec = Mutable(size());
+    vec.prefetch_to(autoPolicy(size()) != ExecutionPolicy::ParUnseq);
+    return vec.data();
   }
 
   const T *cptrD() const {
     if (size() == 0) return nullptr;
-    impl_.prefetch_to(autoPolicy(size()) != ExecutionPolicy::ParUnseq);
-    return impl_.data();
+    impl_->prefetch_to(autoPolicy(size()) != ExecutionPolicy::ParUnseq);
+    return impl_->data();
   }
 
   const T *ptrD() const { return cptrD(); }
 
   T *ptrH() {
     if (size() == 0) return nullptr;
-    impl_.prefetch_to(true);
-    return impl_.data();
+    ManagedVec<T> &vec = Mutable(size());
+    vec.prefetch_to(true);
+    return vec.data();
   }
 
   const T *cptrH() const {
     if (size() == 0) return nullptr;
-    impl_.prefetch_to(true);
-    return impl_.data();
+    impl_->prefetch_to(true);
+    return impl_->data();
   }
 
   const T *ptrH() const { return cptrH(); }
 
   T &operator[](int i) {
-    impl_.prefetch_to(true);
-    return impl_[i];
+    ManagedVec<T> &vec = Mutable(size());
+    vec.prefetch_to(true);
+    return vec[i];
   }
 
   const T &operator[](int i) const {
-    impl_.prefetch_to(true);
-    return impl_[i];
+    impl_->prefetch_to(true);
+    return (*impl_)[i];
   }
 
-  T &back() { return impl_.back(); }
+  T &back() { return Mutable(size()).back(); }
 
-  const T &back() const { return impl_.back(); }
+  const T &back() const { return impl_->back(); }
 
-  void push_back(const T &val) { impl_.push_back(val); }
+  void push_back(const T &val) { Mutable(size()).push_back(val); }
 
-  void reserve(int n) { impl_.reserve(n); }
+  void reserve(int n) { Mutable(std::max(n, size())).reserve(n); }
 
 #ifdef MANIFOLD_DEBUG
   void Dump() const {
     std::cout << "VecDH = " << std::endl;
-    for (int i = 0; i < impl_.size(); ++i) {
-      std::cout << i << ", " << impl_[i] << ", " << std::endl;
+    for (int i = 0; i < size(); ++i) {
+      std::cout << i << ", " << (*impl_)[i] << ", " << std::endl;
     }
     std::cout << std::endl;
   }
 #endif
 
  private:
-  ManagedVec<T> impl_;
+  // null when empty
+  std::shared_ptr<ManagedVec<T>> impl_;
+
+  // Returns the buffer for writing. If it is shared, this vector first gets a
+  // copy of its own, with room for n elements and as many of the current ones
+  // as fit.
+  ManagedVec<T> &Mutable(int n) {
+    if (impl_ == nullptr)
+      impl_ = std::make_shared<ManagedVec<T>>();
+    else if (impl_.use_count() > 1)
+      impl_ = std::make_shared<ManagedVec<T>>(*impl_, n);
+    return *impl_;
+  }
 };
 
 template <typename T>
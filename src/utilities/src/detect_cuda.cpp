@@ -12,12 +12,27 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <string>
+
+#include "public.h"
+
+namespace {
+void CheckDevice(int device, int numDevices) {
+  if (device >= numDevices)
+    throw manifold::argumentErr("CUDA device " + std::to_string(device) +
+                                " does not exist, there are " +
+                                std::to_string(numDevices) + ".");
+}
+}  // namespace
+
 #ifdef MANIFOLD_USE_CUDA
 #include <cuda_runtime.h>
 
 namespace {
 int CUDA_DEVICES = -1;
-}
+// The device chosen by SetCudaDevice() on this thread, or -1 for the default.
+thread_local int threadDevice = -1;
+}  // namespace
 namespace manifold {
 
 bool CudaEnabled() {
@@ -28,9 +43,34 @@ bool CudaEnabled() {
 
   return CUDA_DEVICES > 0;
 }
+
+int NumCudaDevices() { return CudaEnabled() ? CUDA_DEVICES : 0; }
+
+/**
+ * Places the work of the calling thread on the given GPU: its kernels run
+ * there, on that thread's own stream, and the buffers it allocates prefer to
+ * live there, so that one thread per GPU can run Booleans concurrently. The
+ * inputs of an operation should be allocated on the same device. Negative
+ * restores the default device and placement; a device index of
+ * NumCudaDevices() or more throws argumentErr.
+ */
+void SetCudaDevice(int device) {
+  CheckDevice(device, NumCudaDevices());
+  if (!CudaEnabled()) return;
+  threadDevice = device < 0 ? -1 : device;
+  cudaSetDevice(threadDevice < 0 ? 0 : threadDevice);
+}
+
+int CudaDevice() { return threadDevice < 0 ? 0 : threadDevice; }
+
+bool CudaDeviceExplicit() { return threadDevice >= 0; }
 }  // namespace manifold
 #else
 namespace manifold {
 bool CudaEnabled() { return false; }
+int NumCudaDevices() { return 0; }
+void SetCudaDevice(int device) { CheckDevice(device, 0); }
+int CudaDevice() { return 0; }
+bool CudaDeviceExplicit() { return false; }
 }  // namespace manifold
 #endif
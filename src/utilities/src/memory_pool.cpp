@@ -0,0 +1,219 @@
+// Copyright 2022 The Manifold Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+
+#include "vec_dh.h"
+
+#ifdef MANIFOLD_USE_CUDA
+#include <cuda_runtime.h>
+#endif
+
+namespace {
+using namespace manifold;
+
+MemoryResource*& CurrentResource() {
+  thread_local MemoryResource* current = nullptr;
+  return current;
+}
+
+// bytes currently allocated from the base resource by all threads, and the
+// limit on them, zero meaning none
+std::atomic<size_t> liveBytes(0);
+std::atomic<size_t> memoryBudget(0);
+
+std::mutex& HandlerMutex() {
+  static std::mutex mutex;
+  return mutex;
+}
+
+std::function<void()>& PressureHandler() {
+  static std::function<void()> handler;
+  return handler;
+}
+
+bool TryReserve(size_t bytes) {
+  const size_t budget = memoryBudget.load(std::memory_order_relaxed);
+  const size_t live = liveBytes.fetch_add(bytes, std::memory_order_relaxed);
+  if (budget == 0 || live + bytes <= budget) return true;
+  liveBytes.fetch_sub(bytes, std::memory_order_relaxed);
+  return false;
+}
+
+/**
+ * Accounts for a new allocation against the budget. If it does not fit, the
+ * free blocks of this thread's pool are released and the pressure handler is
+ * run, with the base resource current so that whatever it frees actually
+ * goes back rather than into the pool, and then it is retried once.
+ */
+void Reserve(size_t bytes) {
+  if (TryReserve(bytes)) return;
+  MemoryResource* previous = MemoryResource::SetCurrent(nullptr);
+  MemoryPool* pool = dynamic_cast<MemoryPool*>(previous);
+  if (pool != nullptr) pool->Release();
+  std::function<void()> handler;
+  {
+    std::lock_guard<std::mutex> lock(HandlerMutex());
+    handler = PressureHandler();
+  }
+  if (handler) handler();
+  MemoryResource::SetCurrent(previous);
+  if (TryReserve(bytes)) return;
+  throw memoryErr("Allocating " + std::to_string(bytes) +
+                  " bytes would exceed the memory budget of " +
+                  std::to_string(MemoryBudget()) + " bytes.");
+}
+
+constexpr size_t kMinBytes = 64;
+
+int FloorLog2(size_t x) {
+  int log2 = 0;
+  while (x >>= 1) ++log2;
+  return log2;
+}
+
+// Size classes are spaced by a quarter of a power of two, which bounds the
+// rounding overhead to 25%. Class 4 * k + i holds (4 + i) << (k - 2) bytes.
+size_t ClassBytes(int sizeClass) {
+  return size_t(4 + sizeClass % 4) << (sizeClass / 4 - 2);
+}
+
+// Rounds bytes up to the smallest class holding it and returns that class.
+int RoundToClass(size_t& bytes) {
+  bytes = bytes < kMinBytes ? kMinBytes : bytes;
+  const int log2 = FloorLog2(bytes);
+  const size_t step = size_t(1) << (log2 - 2);
+  const size_t steps = (bytes + step - 1) / step;
+  bytes = steps * step;
+  return 4 * log2 + static_cast<int>(steps - 4);
+}
+
+// Returns the class of a block of exactly this size, or -1 if there is none.
+int ExactClass(size_t bytes) {
+  if (bytes < kMinBytes) return -1;
+  const int log2 = FloorLog2(bytes);
+  const size_t step = size_t(1) << (log2 - 2);
+  if (bytes % step != 0) return -1;
+  return 4 * log2 + static_cast<int>(bytes / step - 4);
+}
+}  // namespace
+
+namespace manifold {
+
+void* MemoryResource::Allocate(size_t& bytes) {
+  Reserve(bytes);
+  void* ptr = nullptr;
+#ifdef MANIFOLD_USE_CUDA
+  if (CudaEnabled()) {
+    cudaMallocManaged(&ptr, bytes);
+    // keep the pages of an explicitly placed thread on its device, rather
+    // than letting them migrate to wherever they were last touched
+    if (CudaDeviceExplicit())
+      cudaMemAdvise(ptr, bytes, cudaMemAdviseSetPreferredLocation,
+                    CudaDevice());
+  } else
+#endif
+    ptr = malloc(bytes);
+  return ptr;
+}
+
+void MemoryResource::Deallocate(void* ptr, size_t bytes) {
+  liveBytes.fetch_sub(bytes, std::memory_order_relaxed);
+#ifdef MANIFOLD_USE_CUDA
+  if (CudaEnabled())
+    cudaFree(ptr);
+  else
+#endif
+    free(ptr);
+}
+
+MemoryResource* MemoryResource::Base() {
+  static MemoryResource base;
+  return &base;
+}
+
+MemoryResource* MemoryResource::Current() {
+  MemoryResource* current = CurrentResource();
+  return current == nullptr ? Base() : current;
+}
+
+MemoryResource* MemoryResource::SetCurrent(MemoryResource* resource) {
+  MemoryResource* previous = Current();
+  CurrentResource() = resource;
+  return previous;
+}
+
+void MemoryResource::SetPressureHandler(std::function<void()> handler) {
+  std::lock_guard<std::mutex> lock(HandlerMutex());
+  PressureHandler() = std::move(handler);
+}
+
+/**
+ * Limits the bytes all threads together may hold in manifold buffers,
+ * including the temporaries of operations in flight and any free blocks kept
+ * by their pools; zero, the default, means no limit. An allocation that would
+ * exceed it first evicts the Boolean result cache, then throws memoryErr, so
+ * that the operation fails alone rather than the whole process running out of
+ * memory. Lowering the budget does not free anything already allocated.
+ */
+void SetMemoryBudget(size_t bytes) {
+  memoryBudget.store(bytes, std::memory_order_relaxed);
+}
+
+size_t MemoryBudget() { return memoryBudget.load(std::memory_order_relaxed); }
+
+/**
+ * Bytes currently held in manifold buffers by all threads.
+ */
+size_t MemoryInUse() { return liveBytes.load(std::memory_order_relaxed); }
+
+void* MemoryPool::Allocate(size_t& bytes) {
+  size_t classBytes = bytes;
+  const int sizeClass = RoundToClass(classBytes);
+  if (sizeClass < kNumClass) bytes = classBytes;
+  requested_ += bytes;
+  if (sizeClass >= kNumClass || free_[sizeClass].empty()) {
+    allocated_ += bytes;
+    return Base()->Allocate(bytes);
+  }
+  std::vector<void*>& freeList = free_[sizeClass];
+  void* ptr = freeList.back();
+  freeList.pop_back();
+  return ptr;
+}
+
+void MemoryPool::Deallocate(void* ptr, size_t bytes) {
+  // Only blocks whose size is exactly that of a class are recycled, as blocks
+  // allocated elsewhere may be smaller than the class they round up to.
+  const int sizeClass = ExactClass(bytes);
+  if (sizeClass >= 0 && sizeClass < kNumClass) {
+    free_[sizeClass].push_back(ptr);
+  } else {
+    Base()->Deallocate(ptr, bytes);
+  }
+}
+
+void MemoryPool::Release() {
+  for (int sizeClass = 0; sizeClass < kNumClass; ++sizeClass) {
+    for (void* ptr : free_[sizeClass]) {
+      Base()->Deallocate(ptr, ClassBytes(sizeClass));
+    }
+    free_[sizeClass].clear();
+  }
+}
+
+}  // namespace manifold
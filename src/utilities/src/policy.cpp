@@ -0,0 +1,233 @@
+// Copyright 2022 The Manifold Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include <memory>
+
+#ifdef MANIFOLD_USE_CUDA
+#include <cuda_runtime.h>
+#endif
+
+#if MANIFOLD_PAR == 'T'
+#include <tbb/global_control.h>
+#include <tbb/task_arena.h>
+#elif MANIFOLD_PAR == 'O'
+#include <omp.h>
+#endif
+
+#include "utils.h"
+#include "vec_dh.h"
+
+namespace {
+using namespace manifold;
+
+// autoPolicy() reads the thresholds from any thread while they may be set or
+// calibrated on another, so each one is kept atomic.
+struct AtomicThresholds {
+  std::atomic<int> seqMax[PolicyThresholds::kNumCost];
+  std::atomic<int> parMax[PolicyThresholds::kNumCost];
+
+  AtomicThresholds() { Store(PolicyThresholds()); }
+
+  void Store(const PolicyThresholds& thresholds) {
+    for (int i = 0; i < PolicyThresholds::kNumCost; ++i) {
+      seqMax[i].store(thresholds.seqMax[i], std::memory_order_relaxed);
+      parMax[i].store(thresholds.parMax[i], std::memory_order_relaxed);
+    }
+  }
+
+  PolicyThresholds Load() const {
+    PolicyThresholds thresholds;
+    for (int i = 0; i < PolicyThresholds::kNumCost; ++i) {
+      thresholds.seqMax[i] = seqMax[i].load(std::memory_order_relaxed);
+      thresholds.parMax[i] = parMax[i].load(std::memory_order_relaxed);
+    }
+    return thresholds;
+  }
+};
+
+AtomicThresholds& Thresholds() {
+  static AtomicThresholds thresholds;
+  return thresholds;
+}
+
+#if MANIFOLD_PAR == 'T'
+std::unique_ptr<tbb::global_control>& ThreadLimit() {
+  static std::unique_ptr<tbb::global_control> limit;
+  return limit;
+}
+#elif MANIFOLD_PAR == 'O'
+// The limit in effect before the first SetMaxThreads(), which honors
+// OMP_NUM_THREADS.
+int DefaultThreads() {
+  static const int threads = omp_get_max_threads();
+  return threads;
+}
+#endif
+
+constexpr int kMinLog2 = 8;
+constexpr int kMaxLog2 = 20;
+constexpr int kRepeat = 3;
+
+struct Affine {
+  __host__ __device__ void operator()(float& x) { x = 0.5f * x + 0.5f; }
+};
+
+// Roughly the arithmetic of one Kernel12 evaluation.
+struct Heavy {
+  __host__ __device__ void operator()(float& x) {
+    float y = x;
+    for (int i = 0; i < 64; ++i) y = glm::sqrt(y * y + 1.0f) - 0.5f;
+    x = y;
+  }
+};
+
+struct Scramble {
+  __host__ __device__ uint32_t operator()(int i) {
+    uint32_t x = i;
+    x = (x ^ (x >> 16)) * 0x45d9f3bu;
+    x = (x ^ (x >> 16)) * 0x45d9f3bu;
+    return x ^ (x >> 16);
+  }
+};
+
+/**
+ * Runs one kernel of the given class on size elements and returns the best
+ * wall time in seconds over a few repetitions.
+ */
+double Time(KernelCost cost, ExecutionPolicy policy, int size) {
+  VecDH<float> values(size, 1.0f);
+  VecDH<int> ints(size, 1);
+  VecDH<int> sums(size);
+  VecDH<uint32_t> keys(size);
+  VecDH<uint32_t> unsorted(size);
+  transform(autoPolicy(size), countAt(0), countAt(size), unsorted.begin(),
+            Scramble());
+
+  double best = std::numeric_limits<double>::infinity();
+  for (int rep = 0; rep < kRepeat; ++rep) {
+    if (cost == KernelCost::Sort)
+      copy(policy, unsorted.begin(), unsorted.end(), keys.begin());
+    const auto start = std::chrono::high_resolution_clock::now();
+    switch (cost) {
+      case KernelCost::Light:
+        for_each(policy, values.begin(), values.end(), Affine());
+        break;
+      case KernelCost::Scan:
+        inclusive_scan(policy, ints.begin(), ints.end(), sums.begin());
+        break;
+      case KernelCost::Sort:
+        sort(policy, keys.begin(), keys.end());
+        break;
+      case KernelCost::Heavy:
+        for_each(policy, values.begin(), values.end(), Heavy());
+        break;
+    }
+#ifdef MANIFOLD_USE_CUDA
+    if (policy == ParUnseq) cudaDeviceSynchronize();
+#endif
+    const std::chrono::duration<double> elapsed =
+        std::chrono::high_resolution_clock::now() - start;
+    best = glm::min(best, elapsed.count());
+  }
+  return best;
+}
+
+/**
+ * Returns the largest size for which the slow policy is still the better
+ * choice: above it, the fast policy wins at every measured size.
+ */
+int Crossover(KernelCost cost, ExecutionPolicy slow, ExecutionPolicy fast) {
+  int crossover = std::numeric_limits<int>::max();
+  for (int log2 = kMaxLog2; log2 >= kMinLog2; --log2) {
+    const int size = 1 << log2;
+    if (Time(cost, fast, size) >= Time(cost, slow, size)) break;
+    crossover = size / 2;
+  }
+  return crossover;
+}
+}  // namespace
+
+namespace manifold {
+
+/**
+ * Returns a copy of the current thresholds. While another thread sets them,
+ * the copy may mix old and new values, each of which is valid on its own.
+ */
+PolicyThresholds GetPolicyThresholds() { return Thresholds().Load(); }
+
+void SetPolicyThresholds(const PolicyThresholds& thresholds) {
+  Thresholds().Store(thresholds);
+}
+
+/**
+ * Measures, for each KernelCost, the workload size at which the parallel CPU
+ * backend starts beating sequential execution, and when CUDA is enabled, the
+ * size at which the GPU starts beating the CPU. This takes a few seconds, so
+ * it is meant to be run once, e.g. at startup, or offline with the result
+ * stored and applied with SetPolicyThresholds(). It does not change the
+ * current thresholds.
+ */
+PolicyThresholds CalibratePolicyThresholds() {
+  PolicyThresholds thresholds = GetPolicyThresholds();
+  for (int i = 0; i < PolicyThresholds::kNumCost; ++i) {
+    const KernelCost cost = static_cast<KernelCost>(i);
+    thresholds.seqMax[i] = Crossover(cost, Seq, Par);
+    if (CudaEnabled()) {
+      thresholds.parMax[i] =
+          glm::max(thresholds.seqMax[i], Crossover(cost, Par, ParUnseq));
+    }
+  }
+  return thresholds;
+}
+
+/**
+ * Limits the number of threads used by the parallel CPU backend, e.g. to
+ * leave cores for other work, or in the browser to stay within the pool of
+ * web workers. Zero restores the backend's default, which is one thread per
+ * core unless set otherwise by its environment, e.g. OMP_NUM_THREADS. This has
+ * no effect without a parallel backend, and is not thread-safe.
+ */
+void SetMaxThreads(int numThreads) {
+#if MANIFOLD_PAR == 'T'
+  ThreadLimit().reset();
+  if (numThreads > 0)
+    ThreadLimit() = std::make_unique<tbb::global_control>(
+        tbb::global_control::max_allowed_parallelism, numThreads);
+#elif MANIFOLD_PAR == 'O'
+  const int defaultThreads = DefaultThreads();
+  omp_set_num_threads(numThreads > 0 ? numThreads : defaultThreads);
+#endif
+}
+
+/**
+ * The number of threads the parallel CPU backend may use, which is one
+ * without a parallel backend.
+ */
+int MaxThreads() {
+#if MANIFOLD_PAR == 'T'
+  return glm::min(
+      tbb::this_task_arena::max_concurrency(),
+      static_cast<int>(tbb::global_control::active_value(
+          tbb::global_control::max_allowed_parallelism)));
+#elif MANIFOLD_PAR == 'O'
+  return omp_get_max_threads();
+#else
+  return 1;
+#endif
+}
+
+}  // namespace manifold
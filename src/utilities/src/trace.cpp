@@ -0,0 +1,117 @@
+// Copyright 2022 The Manifold Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+struct TraceEvent {
+  const char* name;
+  int thread;
+  // microseconds since StartTrace()
+  double start;
+  double duration;
+  std::string args;
+};
+
+std::atomic<bool> tracing(false);
+std::mutex traceMutex;
+Clock::time_point traceStart;
+std::vector<TraceEvent> events;
+
+// Small, stable thread numbers read better in the viewer than native IDs.
+int ThreadNumber() {
+  static std::atomic<int> nextThread(0);
+  thread_local const int thread = nextThread++;
+  return thread;
+}
+
+double Microseconds(Clock::duration duration) {
+  return std::chrono::duration<double, std::micro>(duration).count();
+}
+
+void AppendDouble(std::string& text, double value) {
+  char buffer[32];
+  const int length = std::snprintf(buffer, sizeof(buffer), "%.3f", value);
+  text.append(buffer, length);
+}
+}  // namespace
+
+namespace manifold {
+
+/**
+ * Discards any events recorded so far and starts recording spans.
+ */
+void StartTrace() {
+  std::lock_guard<std::mutex> lock(traceMutex);
+  events.clear();
+  traceStart = Clock::now();
+  tracing = true;
+}
+
+/**
+ * Stops recording and returns the events since StartTrace() in the Chrome
+ * trace-event JSON format, sorted by start time.
+ */
+std::string StopTrace() {
+  std::vector<TraceEvent> recorded;
+  {
+    std::lock_guard<std::mutex> lock(traceMutex);
+    tracing = false;
+    recorded.swap(events);
+  }
+  std::stable_sort(recorded.begin(), recorded.end(),
+                   [](const TraceEvent& a, const TraceEvent& b) {
+                     return a.start < b.start;
+                   });
+
+  std::string json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  for (size_t i = 0; i < recorded.size(); ++i) {
+    const TraceEvent& event = recorded[i];
+    if (i > 0) json += ',';
+    json += "\n{\"name\":\"";
+    json += event.name;
+    json += "\",\"cat\":\"manifold\",\"ph\":\"X\",\"pid\":0,\"tid\":";
+    json += std::to_string(event.thread);
+    json += ",\"ts\":";
+    AppendDouble(json, event.start);
+    json += ",\"dur\":";
+    AppendDouble(json, event.duration);
+    json += ",\"args\":{";
+    json += event.args;
+    json += "}}";
+  }
+  json += "\n]}\n";
+  return json;
+}
+
+bool Tracing() { return tracing.load(std::memory_order_relaxed); }
+
+void TraceSpan::Record() {
+  const Clock::time_point end = Clock::now();
+  const int thread = ThreadNumber();
+  std::lock_guard<std::mutex> lock(traceMutex);
+  // dropped if the trace was stopped or restarted while this span was open
+  if (!tracing || start_ < traceStart) return;
+  events.push_back({name_, thread, Microseconds(start_ - traceStart),
+                    Microseconds(end - start_), std::move(args_)});
+}
+}  // namespace manifold
@@ -0,0 +1,120 @@
+// Copyright 2022 The Manifold Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mesh_io.h"
+
+#include <cstdio>
+
+#include "manifold.h"
+#include "test.h"
+
+using namespace manifold;
+
+namespace {
+
+// A deflated 3MF holding a tetrahedron, built as a component translated by
+// (2, 0, 0), under a build item mirroring in x. A commented-out item
+// precedes them.
+const unsigned char kTetrahedron3MF[] = {
+    0x50, 0x4b, 0x03, 0x04, 0x14, 0x00, 0x00, 0x00, 0x08, 0x00, 0xf7, 0x7c,
+    0x4e, 0x5d, 0xf4, 0x8f, 0xaf, 0x4e, 0x1b, 0x01, 0x00, 0x00, 0xa0, 0x02,
+    0x00, 0x00, 0x10, 0x00, 0x00, 0x00, 0x33, 0x44, 0x2f, 0x33, 0x64, 0x6d,
+    0x6f, 0x64, 0x65, 0x6c, 0x2e, 0x6d, 0x6f, 0x64, 0x65, 0x6c, 0x7d, 0x52,
+    0xd1, 0x6e, 0xc3, 0x20, 0x0c, 0x7c, 0xef, 0x57, 0x30, 0xde, 0x53, 0x03,
+    0xd1, 0x1e, 0x36, 0x11, 0xfa, 0x2d, 0x29, 0x21, 0x0d, 0x53, 0x80, 0x0a,
+    0x48, 0x94, 0xee, 0xeb, 0x47, 0x82, 0xda, 0x24, 0xeb, 0x56, 0x21, 0x61,
+    0xa3, 0x3b, 0xdf, 0x59, 0x36, 0xfc, 0x34, 0x99, 0x1e, 0x8d, 0xca, 0x07,
+    0xed, 0x6c, 0x85, 0xe9, 0x91, 0xe0, 0x93, 0x38, 0x70, 0xe3, 0x1a, 0xd5,
+    0xa3, 0x04, 0xd9, 0x50, 0xe1, 0x2e, 0xc6, 0xeb, 0x27, 0x40, 0x90, 0x9d,
+    0x32, 0x75, 0x38, 0x1a, 0x2d, 0xbd, 0x0b, 0xae, 0x8d, 0x47, 0xe9, 0x0c,
+    0x94, 0x8d, 0xa9, 0xed, 0xd0, 0xd6, 0x32, 0x0e, 0x5e, 0xdb, 0x0b, 0x48,
+    0xe7, 0x15, 0x30, 0x42, 0xdf, 0x81, 0x30, 0x9c, 0x94, 0xde, 0x8a, 0x02,
+    0x71, 0x1d, 0x95, 0x41, 0xee, 0xfc, 0xa5, 0x64, 0xd4, 0x4d, 0x85, 0x3f,
+    0x30, 0x08, 0x54, 0x14, 0x09, 0xf5, 0x2a, 0xb8, 0xc1, 0x4b, 0x15, 0x52,
+    0x9e, 0x71, 0x34, 0x13, 0x28, 0x16, 0xdc, 0xa8, 0xd0, 0x09, 0x9e, 0x3a,
+    0x8b, 0x3a, 0xe3, 0x73, 0xaa, 0x26, 0x34, 0x55, 0x98, 0x60, 0x74, 0x5b,
+    0xee, 0xef, 0xf9, 0x86, 0x1d, 0x46, 0x5f, 0x60, 0xb9, 0x8e, 0xbe, 0xc0,
+    0x72, 0x1d, 0x5d, 0x30, 0x78, 0x78, 0xf3, 0xe8, 0x75, 0x6d, 0x2f, 0xfd,
+    0xd2, 0xc6, 0x3d, 0x47, 0x23, 0x5d, 0xf8, 0x23, 0xab, 0x30, 0x4b, 0xa1,
+    0xbc, 0xd7, 0xfd, 0x45, 0xa0, 0x99, 0x50, 0xfe, 0x4b, 0x28, 0x33, 0x81,
+    0x3d, 0x13, 0xe8, 0xce, 0x22, 0x2b, 0xc0, 0xda, 0x10, 0x87, 0x3c, 0x28,
+    0xc8, 0xe3, 0xdb, 0xcf, 0x31, 0x6d, 0x80, 0xa7, 0x25, 0x5d, 0x9d, 0x55,
+    0x36, 0x86, 0x4d, 0xbe, 0x59, 0x46, 0xd2, 0x8f, 0xbe, 0xb6, 0xa1, 0x75,
+    0xde, 0xa4, 0x17, 0x22, 0xcb, 0x59, 0x23, 0x9b, 0x63, 0x72, 0xe5, 0xb0,
+    0x55, 0x5a, 0xed, 0x60, 0xbb, 0xc3, 0xf3, 0xa0, 0xfb, 0x46, 0xfc, 0xde,
+    0x37, 0xdb, 0x59, 0x14, 0xcf, 0x1e, 0xe4, 0xe1, 0x91, 0x05, 0x92, 0xea,
+    0xf2, 0x03, 0xc5, 0xe1, 0x07, 0x50, 0x4b, 0x01, 0x02, 0x14, 0x03, 0x14,
+    0x00, 0x00, 0x00, 0x08, 0x00, 0xf7, 0x7c, 0x4e, 0x5d, 0xf4, 0x8f, 0xaf,
+    0x4e, 0x1b, 0x01, 0x00, 0x00, 0xa0, 0x02, 0x00, 0x00, 0x10, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80, 0x01, 0x00,
+    0x00, 0x00, 0x00, 0x33, 0x44, 0x2f, 0x33, 0x64, 0x6d, 0x6f, 0x64, 0x65,
+    0x6c, 0x2e, 0x6d, 0x6f, 0x64, 0x65, 0x6c, 0x50, 0x4b, 0x05, 0x06, 0x00,
+    0x00, 0x00, 0x00, 0x01, 0x00, 0x01, 0x00, 0x3e, 0x00, 0x00, 0x00, 0x49,
+    0x01, 0x00, 0x00, 0x00, 0x00};
+
+void ExpectRoundTrip(const std::string& filename) {
+  const Manifold sphere = Manifold::Sphere(1, 64);
+  WriteMesh(filename, sphere.GetMeshGL());
+  const Manifold loaded(ReadMesh(filename));
+  std::remove(filename.c_str());
+  EXPECT_TRUE(loaded.IsManifold());
+  EXPECT_EQ(loaded.NumVert(), sphere.NumVert());
+  EXPECT_EQ(loaded.NumTri(), sphere.NumTri());
+  EXPECT_NEAR(loaded.GetProperties().volume, sphere.GetProperties().volume,
+              1e-5);
+}
+}  // namespace
+
+TEST(MeshIO, STL) { ExpectRoundTrip("sphere.stl"); }
+
+TEST(MeshIO, OBJ) { ExpectRoundTrip("sphere.obj"); }
+
+TEST(MeshIO, ThreeMF) { ExpectRoundTrip("sphere.3mf"); }
+
+/**
+ * Quads are fan-triangulated and negative indices count back from the last
+ * vertex read.
+ */
+TEST(MeshIO, OBJPolygons) {
+  const std::string obj =
+      "# unit cube\n"
+      "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\n"
+      "v 0 0 1\nv 1 0 1\nv 1 1 1\nv 0 1 1\n"
+      "f 1 4 3 2\nf 5 6 7 8\nf 1 2 6 5\n"
+      "f -7/1 -6/2 -2/3 -3/4\r\n"
+      "f 3//1 4//1 8//1 7//1\nf 4 1 5 8 # last\n";
+  const Manifold cube(ReadMesh(obj.data(), obj.size(), MeshFormat::OBJ));
+  EXPECT_TRUE(cube.IsManifold());
+  EXPECT_EQ(cube.NumVert(), 8);
+  EXPECT_EQ(cube.NumTri(), 12);
+  EXPECT_NEAR(cube.GetProperties().volume, 1, 1e-5);
+}
+
+TEST(MeshIO, ThreeMFDeflated) {
+  const Manifold tet(ReadMesh(reinterpret_cast<const char*>(kTetrahedron3MF),
+                              sizeof(kTetrahedron3MF), MeshFormat::THREEMF));
+  EXPECT_TRUE(tet.IsManifold());
+  EXPECT_EQ(tet.NumTri(), 4);
+  EXPECT_NEAR(tet.GetProperties().volume, 1.0f / 6, 1e-5);
+  const Box box = tet.BoundingBox();
+  EXPECT_FLOAT_EQ(box.min.x, -3);
+  EXPECT_FLOAT_EQ(box.max.x, -2);
+}
+
+TEST(MeshIO, Errors) {
+  const std::string bad = "v 0 0 0\nv 1 0 zero\n";
+  EXPECT_THROW(ReadMesh(bad.data(), bad.size(), MeshFormat::OBJ), ioErr);
+  EXPECT_THROW(ReadMesh("missing.stl"), ioErr);
+  EXPECT_THROW(ReadMesh("sphere.ply"), ioErr);
+}
@@ -12,12 +12,18 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <cstring>
 #include <random>
+#include <set>
+#include <sstream>
+#include <thread>
 
 #include "manifold.h"
+#include "par.h"
 #include "polygon.h"
 #include "sdf.h"
 #include "test.h"
+#include "warp.h"
 
 #ifdef MANIFOLD_EXPORT
 #include "meshIO.h"
@@ -27,6 +33,14 @@ namespace {
 
 using namespace manifold;
 
+struct Twist {
+  __host__ __device__ void operator()(glm::vec3& v) const {
+    const float angle = v.z;
+    v = glm::vec3(v.x * glm::cos(angle) - v.y * glm::sin(angle),
+                  v.x * glm::sin(angle) + v.y * glm::cos(angle), v.z);
+  }
+};
+
 Mesh Csaszar() {
   Mesh csaszar;
   csaszar.vertPos = {{-20, -20, -10},  //
@@ -206,6 +220,84 @@ TEST(Manifold, GetMeshGL) {
   }
 }
 
+TEST(Manifold, WriteMeshGL) {
+  Manifold manifold = Manifold::Sphere(1);
+  MeshGL meshGL = manifold.GetMeshGL();
+
+  MeshGLLayout layout;
+  ASSERT_EQ(layout.IndexSize(manifold.NumVert()), 2);
+  std::vector<float> verts(layout.VertBytes(manifold.NumVert()) /
+                           sizeof(float));
+  std::vector<uint16_t> indices(3 * manifold.NumTri());
+  manifold.WriteMeshGL(layout, verts.data(), indices.data());
+  for (int i = 0; i < manifold.NumVert(); ++i) {
+    for (const int j : {0, 1, 2}) {
+      ASSERT_EQ(verts[6 * i + j], meshGL.vertPos[3 * i + j]);
+      ASSERT_EQ(verts[6 * i + 3 + j], meshGL.vertNormal[3 * i + j]);
+    }
+  }
+  for (int i = 0; i < indices.size(); ++i)
+    ASSERT_EQ(indices[i], meshGL.triVerts[i]);
+
+  layout.normal = MeshGLLayout::Normal::SNORM16;
+  layout.index16 = false;
+  ASSERT_EQ(layout.VertStride(), 20);
+  std::vector<char> quantized(layout.VertBytes(manifold.NumVert()));
+  std::vector<uint32_t> indices32(3 * manifold.NumTri());
+  manifold.WriteMeshGL(layout, quantized.data(), indices32.data());
+  for (int i = 0; i < manifold.NumVert(); ++i) {
+    int16_t normal[4];
+    std::memcpy(normal, quantized.data() + 20 * i + 12, sizeof(normal));
+    for (const int j : {0, 1, 2})
+      ASSERT_NEAR(normal[j] / 32767.0f, meshGL.vertNormal[3 * i + j], 1e-4);
+    ASSERT_EQ(normal[3], 0);
+  }
+  for (int i = 0; i < indices32.size(); ++i)
+    ASSERT_EQ(indices32[i], meshGL.triVerts[i]);
+}
+
+TEST(Manifold, Serialize) {
+  Manifold manifold = (Manifold::Sphere(1, 32) - Manifold::Cube(glm::vec3(1)))
+                          .Rotate(20, 30, 40);
+  const Mesh mesh = manifold.GetMesh();
+  const float volume = manifold.GetProperties().volume;
+  const Manifold cutter = Manifold::Cube(glm::vec3(1), true);
+  const float cutVolume = (manifold - cutter).GetProperties().volume;
+
+  for (bool withCollider : {true, false}) {
+    std::stringstream stream;
+    manifold.Serialize(stream, withCollider);
+    Manifold loaded = Manifold::Deserialize(stream);
+    EXPECT_EQ(loaded.Status(), Manifold::Error::NO_ERROR);
+    EXPECT_TRUE(loaded.IsManifold());
+    Identical(loaded.GetMesh(), mesh);
+    EXPECT_EQ(loaded.BoundingBox().min, manifold.BoundingBox().min);
+    EXPECT_EQ(loaded.Precision(), manifold.Precision());
+    EXPECT_NEAR((loaded - cutter).GetProperties().volume, cutVolume, 1e-5);
+    EXPECT_NEAR(loaded.GetProperties().volume, volume, 1e-5);
+  }
+
+  std::stringstream stream;
+  manifold.Serialize(stream);
+  std::string data = stream.str();
+  EXPECT_EQ(Manifold::Deserialize(data.data(), data.size() / 2).Status(),
+            Manifold::Error::INVALID_SERIALIZATION);
+  data[0] = 'X';
+  Manifold corrupt = Manifold::Deserialize(data.data(), data.size());
+  EXPECT_EQ(corrupt.Status(), Manifold::Error::INVALID_SERIALIZATION);
+  EXPECT_TRUE(corrupt.IsEmpty());
+
+  // an out-of-range vert index in the start vert section, the second one,
+  // whose offset follows the 64-byte header and one 24-byte section header
+  data = stream.str();
+  uint64_t offset;
+  std::memcpy(&offset, &data[64 + 24 + 16], sizeof(offset));
+  const int badVert = manifold.NumVert();
+  std::memcpy(&data[offset], &badVert, sizeof(badVert));
+  EXPECT_EQ(Manifold::Deserialize(data.data(), data.size()).Status(),
+            Manifold::Error::INVALID_SERIALIZATION);
+}
+
 TEST(Manifold, Empty) {
   Mesh emptyMesh;
   Manifold empty(emptyMesh);
@@ -226,6 +318,19 @@ TEST(Manifold, ValidInput) {
   EXPECT_TRUE(tet.IsManifold());
 }
 
+TEST(Manifold, TrustInputMesh) {
+  const Manifold sphere = Manifold::Sphere(1, 64);
+  const Mesh mesh = sphere.GetMesh();
+  ManifoldParams().trustInputMesh = true;
+  const Manifold trusted(mesh);
+  ManifoldParams().trustInputMesh = false;
+  EXPECT_EQ(trusted.Status(), Manifold::Error::NO_ERROR);
+  EXPECT_TRUE(trusted.IsManifold());
+  EXPECT_EQ(trusted.NumVert(), sphere.NumVert());
+  EXPECT_EQ(trusted.NumTri(), sphere.NumTri());
+  EXPECT_EQ(trusted.Genus(), 0);
+}
+
 TEST(Manifold, InvalidInput1) {
   Mesh in = Tet();
   in.vertPos[2][1] = NAN;
@@ -328,6 +433,29 @@ TEST(Manifold, Decompose) {
   Related(manifolds, input, meshID2idx);
 }
 
+TEST(Manifold, ComposeInstances) {
+  Manifold sphere = Manifold::Sphere(0.4, 16);
+  const auto prop = sphere.GetProperties();
+  std::vector<Manifold> instances;
+  for (int i = 0; i < 8; ++i) {
+    for (int j = 0; j < 8; ++j) {
+      instances.push_back(sphere.Rotate(10 * i, 0, 10 * j)
+                              .Scale({1, 1, 1 + 0.1f * i})
+                              .Translate({float(i), float(j), 0}));
+    }
+  }
+  instances.push_back(Manifold());
+  instances.push_back(sphere.Translate({-2, 0, 0}));
+  Manifold composed = Manifold::Compose(instances);
+  EXPECT_TRUE(composed.IsManifold());
+  EXPECT_EQ(composed.NumTri(), 65 * sphere.NumTri());
+  EXPECT_EQ(composed.Decompose().size(), 65);
+
+  float volume = prop.volume;
+  for (int i = 0; i < 8; ++i) volume += 8 * prop.volume * (1 + 0.1f * i);
+  EXPECT_NEAR(composed.GetProperties().volume, volume, 1e-3);
+}
+
 /**
  * These tests check the various manifold constructors.
  */
@@ -422,6 +550,121 @@ TEST(Manifold, SmoothSphere) {
   }
 }
 
+TEST(Manifold, RefineToLength) {
+  // Each face side is split in two and each diagonal in three, with one
+  // interior vert per triangle.
+  Manifold refined = Manifold::Cube().RefineToLength(0.5);
+  ExpectMeshes(refined, {{44, 84}});
+  EXPECT_NEAR(refined.GetProperties().volume, 1, 1e-5);
+}
+
+TEST(Manifold, RefineToPrecision) {
+  Manifold sphere = Manifold::Sphere(1, 8);
+  EXPECT_EQ(sphere.RefineToPrecision(0.001).NumTri(), sphere.NumTri());
+
+  Manifold smoothed =
+      Manifold::Smooth(sphere.GetMesh()).RefineToPrecision(0.001);
+  EXPECT_TRUE(smoothed.IsManifold());
+  EXPECT_GT(smoothed.NumTri(), sphere.NumTri());
+  Mesh out = smoothed.GetMesh();
+  for (const glm::vec3& v : out.vertPos) EXPECT_NEAR(glm::length(v), 1, 0.01);
+}
+
+TEST(Manifold, CylinderTopology) {
+  for (int n : {3, 4, 7, 64, 1000}) {
+    const float area = n * glm::sin(glm::two_pi<float>() / n) / 2;
+    const Manifold cylinder = Manifold::Cylinder(2, 1, 1, n);
+    EXPECT_TRUE(cylinder.IsManifold());
+    EXPECT_EQ(cylinder.NumVert(), 2 * n);
+    EXPECT_EQ(cylinder.NumTri(), 4 * n - 4);
+    EXPECT_EQ(cylinder.Genus(), 0);
+    EXPECT_NEAR(cylinder.GetProperties().volume, 2 * area, 1e-4);
+
+    const Manifold cone = Manifold::Cylinder(2, 1, 0, n, true);
+    EXPECT_TRUE(cone.IsManifold());
+    EXPECT_EQ(cone.NumVert(), n + 1);
+    EXPECT_EQ(cone.NumTri(), 2 * n - 2);
+    EXPECT_NEAR(cone.GetProperties().volume, 2 * area / 3, 1e-4);
+    EXPECT_FLOAT_EQ(cone.BoundingBox().max.z, 1);
+  }
+}
+
+TEST(Manifold, Simplify) {
+  Manifold cube = Manifold::Cube().Refine(4);
+  Manifold simple = cube.Simplify(0.001);
+  EXPECT_TRUE(simple.IsManifold());
+  EXPECT_LT(simple.NumTri(), cube.NumTri() / 4);
+  EXPECT_EQ(simple.Genus(), 0);
+  EXPECT_NEAR(simple.GetProperties().volume, 1, 0.001);
+  EXPECT_TRUE(simple.BoundingBox().min == cube.BoundingBox().min);
+  EXPECT_TRUE(simple.BoundingBox().max == cube.BoundingBox().max);
+
+  Manifold sphere = Manifold::Sphere(1, 32);
+  EXPECT_EQ(sphere.Simplify(sphere.Precision()).NumTri(), sphere.NumTri());
+  Manifold coarse = sphere.Simplify(0.05);
+  EXPECT_TRUE(coarse.IsManifold());
+  EXPECT_LT(coarse.NumTri(), sphere.NumTri());
+  Mesh out = coarse.GetMesh();
+  for (const glm::vec3& v : out.vertPos) EXPECT_NEAR(glm::length(v), 1, 0.001);
+}
+
+TEST(Manifold, MeshGLLods) {
+  const Manifold sphere = Manifold::Sphere(1, 64);
+  const MeshGLLods lods = sphere.GetMeshGLLods({0, 0.1, 0.01});
+  ASSERT_EQ(lods.tolerance.size(), 3);
+  EXPECT_EQ(lods.tolerance[0], 0.1f);
+  EXPECT_EQ(lods.tolerance[2], 0);
+  EXPECT_EQ(lods.mesh.NumVert(), sphere.NumVert());
+  EXPECT_EQ(lods.numVert[2], sphere.NumVert());
+  EXPECT_EQ(lods.triStart[3], lods.mesh.NumTri());
+
+  for (int lod = 0; lod < 3; ++lod) {
+    const int numTri = lods.triStart[lod + 1] - lods.triStart[lod];
+    if (lod > 0) {
+      EXPECT_LT(lods.numVert[lod - 1], lods.numVert[lod]);
+      EXPECT_LT(lods.triStart[lod] - lods.triStart[lod - 1], numTri);
+    }
+    // each level is a closed mesh over its prefix of the shared verts
+    Mesh level;
+    level.vertPos.resize(lods.numVert[lod]);
+    for (int v = 0; v < lods.numVert[lod]; ++v) {
+      const float* pos = &lods.mesh.vertPos[3 * v];
+      level.vertPos[v] = {pos[0], pos[1], pos[2]};
+    }
+    for (int tri = lods.triStart[lod]; tri < lods.triStart[lod + 1]; ++tri) {
+      const glm::ivec3 verts(lods.mesh.triVerts[3 * tri],
+                             lods.mesh.triVerts[3 * tri + 1],
+                             lods.mesh.triVerts[3 * tri + 2]);
+      for (int i : {0, 1, 2}) ASSERT_LT(verts[i], lods.numVert[lod]);
+      level.triVerts.push_back(verts);
+    }
+    const Manifold levelManifold(level);
+    EXPECT_EQ(levelManifold.Status(), Manifold::Error::NO_ERROR);
+    EXPECT_EQ(levelManifold.Genus(), 0);
+  }
+}
+
+TEST(Manifold, MeshGLLodsCoincident) {
+  // two cubes sharing an edge, whose verts coincide but are not the same
+  const Manifold cube = Manifold::Cube(glm::vec3(1.0f));
+  const Manifold pair = Manifold::Compose({cube, cube.Translate({1, 1, 0})});
+  const MeshGLLods lods = pair.GetMeshGLLods({0, 0.01});
+  ASSERT_EQ(lods.numVert.size(), 2);
+  EXPECT_EQ(lods.numVert[0], 16);
+  Mesh level;
+  for (int v = 0; v < lods.numVert[0]; ++v) {
+    const float* pos = &lods.mesh.vertPos[3 * v];
+    level.vertPos.push_back({pos[0], pos[1], pos[2]});
+  }
+  for (int tri = lods.triStart[0]; tri < lods.triStart[1]; ++tri)
+    level.triVerts.push_back(glm::ivec3(lods.mesh.triVerts[3 * tri],
+                                        lods.mesh.triVerts[3 * tri + 1],
+                                        lods.mesh.triVerts[3 * tri + 2]));
+  const Manifold levelManifold(level);
+  EXPECT_EQ(levelManifold.Status(), Manifold::Error::NO_ERROR);
+  EXPECT_EQ(levelManifold.NumVert(), 16);
+}
+
 TEST(Manifold, ManualSmooth) {
   // Unit Octahedron
   const Mesh oct = Manifold::Sphere(1, 4).GetMesh();
@@ -511,6 +754,94 @@ TEST(Manifold, GetProperties) {
   EXPECT_FLOAT_EQ(prop.surfaceArea, 6.0f);
 }
 
+TEST(Manifold, CachedProperties) {
+  const Manifold sphere = Manifold::Sphere(1, 32);
+  const auto prop = sphere.GetProperties();
+
+  // Similarities are applied to the cached properties, other transforms and
+  // warps are reduced anew.
+  const Manifold moved =
+      sphere.Rotate(30, 40, 50).Scale(glm::vec3(2)).Translate({1, 2, 3});
+  EXPECT_NEAR(moved.GetProperties().volume, 8 * prop.volume, 1e-4);
+  EXPECT_NEAR(moved.GetProperties().surfaceArea, 4 * prop.surfaceArea, 1e-4);
+  const Manifold stretched = sphere.Scale({1, 1, 2});
+  EXPECT_NEAR(stretched.GetProperties().volume, 2 * prop.volume, 1e-4);
+  const Manifold warped = sphere.Warp([](glm::vec3& v) { v *= 2; });
+  EXPECT_NEAR(warped.GetProperties().volume, 8 * prop.volume, 1e-4);
+
+  const Manifold composed = Manifold::Compose({sphere, moved});
+  EXPECT_NEAR(composed.GetProperties().volume, 9 * prop.volume, 1e-4);
+  EXPECT_NEAR(composed.GetProperties().surfaceArea, 5 * prop.surfaceArea,
+              1e-4);
+}
+
+TEST(Manifold, PointQueries) {
+  const Manifold cube = Manifold::Cube(glm::vec3(2), true);
+  const std::vector<glm::vec3> points = {
+      {0, 0, 0},  {0.5, 0.2, 0.1}, {3, 0, 0},
+      {2, 2, 0},  {0, 0, 5},       {0, 0, -5}};
+  const std::vector<bool> inside = cube.Contains(points);
+  const std::vector<bool> expected = {true, true, false, false, false, false};
+  EXPECT_EQ(inside, expected);
+
+  const std::vector<float> distance = cube.SignedDistance(points);
+  EXPECT_NEAR(distance[0], 1, 1e-6);
+  EXPECT_NEAR(distance[1], 0.5, 1e-6);
+  EXPECT_NEAR(distance[2], -2, 1e-6);
+  EXPECT_NEAR(distance[3], -glm::sqrt(2.0f), 1e-6);
+  EXPECT_NEAR(distance[4], -4, 1e-6);
+  EXPECT_NEAR(distance[5], -4, 1e-6);
+
+  const std::vector<float> clamped = cube.SignedDistance(points, 1.5);
+  EXPECT_NEAR(clamped[0], 1, 1e-6);
+  EXPECT_NEAR(clamped[2], -1.5, 1e-6);
+  EXPECT_NEAR(clamped[4], -1.5, 1e-6);
+
+  const Manifold sphere = Manifold::Sphere(1, 128);
+  const std::vector<float> radial =
+      sphere.SignedDistance({{0, 0, 0}, {0.3, 0.4, 0}, {0, 2, 0}});
+  EXPECT_NEAR(radial[0], 1, 1e-3);
+  EXPECT_NEAR(radial[1], 0.5, 1e-3);
+  EXPECT_NEAR(radial[2], -1, 1e-3);
+}
+
+TEST(Manifold, RayCast) {
+  const Manifold cube = Manifold::Cube(glm::vec3(2), true);
+  const Manifold scene = cube + cube.Translate({5, 0, 0});
+  const std::vector<glm::vec3> origins = {
+      {-5, 0.2, 0.3}, {0, 0, 0}, {-5, 5, 0}, {2.5, 0.1, 0.1}};
+  const std::vector<glm::vec3> directions = {
+      {1, 0, 0}, {0, 0, -2}, {1, 0, 0}, {1, 0, 0}};
+  const std::vector<RayHit> hits = scene.RayCast(origins, directions);
+
+  EXPECT_NEAR(hits[0].distance, 4, 1e-6);
+  EXPECT_NEAR(hits[1].distance, 1, 1e-6);
+  EXPECT_EQ(hits[2].tri, -1);
+  EXPECT_NEAR(hits[3].distance, 1.5, 1e-6);
+  EXPECT_EQ(scene.RayCast(origins, directions, 1)[3].tri, -1);
+  const std::vector<glm::vec3> tooFew(origins.size() - 1, {1, 0, 0});
+  EXPECT_THROW(scene.RayCast(origins, tooFew), argumentErr);
+
+  // the hit interpolates back to its position on both triangles
+  const Mesh mesh = scene.GetMesh();
+  const MeshRelation relation = scene.GetMeshRelation();
+  for (int i : {0, 1, 3}) {
+    const RayHit& hit = hits[i];
+    ASSERT_GE(hit.tri, 0);
+    const glm::vec3 expected =
+        origins[i] + hit.distance * glm::normalize(directions[i]);
+    glm::vec3 position(0);
+    for (int j : {0, 1, 2})
+      position += hit.barycentric[j] * mesh.vertPos[mesh.triVerts[hit.tri][j]];
+    EXPECT_NEAR(glm::distance(position, expected), 0, 1e-5);
+    EXPECT_EQ(hit.originalID, relation.triBary[hit.tri].originalID);
+    EXPECT_EQ(hit.originalTri, relation.triBary[hit.tri].tri);
+    EXPECT_NEAR(hit.originalBarycentric[0] + hit.originalBarycentric[1] +
+                    hit.originalBarycentric[2],
+                1, 1e-5);
+  }
+}
+
 TEST(Manifold, Precision) {
   Manifold cube = Manifold::Cube();
   EXPECT_FLOAT_EQ(cube.Precision(), kTolerance);
@@ -583,6 +914,19 @@ TEST(Manifold, Transform) {
   Identical(cube.GetMesh(), cube2.GetMesh());
 }
 
+TEST(Manifold, WarpThreadSafe) {
+  const Manifold cylinder = Manifold::Cylinder(2, 1, 1, 32).Refine(4);
+  const PolicyThresholds defaults = GetPolicyThresholds();
+  PolicyThresholds parallel;
+  for (int i = 0; i < PolicyThresholds::kNumCost; ++i) parallel.seqMax[i] = 0;
+  SetPolicyThresholds(parallel);
+  const Manifold warped = cylinder.Warp(Twist(), true);
+  SetPolicyThresholds(defaults);
+
+  Identical(warped.GetMesh(), cylinder.Warp(Twist()).GetMesh());
+  EXPECT_TRUE(warped.IsManifold());
+}
+
 TEST(Manifold, MeshRelation) {
   const float period = glm::two_pi<float>();
 
@@ -779,6 +1123,73 @@ TEST(Boolean, SplitByPlane60) {
               splits.second.GetProperties().volume, 1e-5);
 }
 
+TEST(Boolean, TrimByPlaneComponents) {
+  Manifold cube = Manifold::Cube(glm::vec3(1.0f), true);
+  Manifold pair = Manifold::Compose({cube, cube.Translate({0.0f, 0.0f, 3.0f})});
+  // the plane passes between the components without cutting either
+  Manifold top = pair.TrimByPlane({0.0f, 0.0f, 1.0f}, 1.5f);
+  EXPECT_TRUE(top.IsManifold());
+  EXPECT_EQ(top.NumTri(), cube.NumTri());
+  EXPECT_EQ(top.NumVert(), cube.NumVert());
+  EXPECT_NEAR(top.GetProperties().volume, 1, 1e-5);
+  EXPECT_FLOAT_EQ(top.BoundingBox().min.z, 2.5);
+
+  Manifold bottom = pair.TrimByPlane({0.0f, 0.0f, -1.0f}, -1.5f);
+  EXPECT_EQ(bottom.NumTri(), cube.NumTri());
+  EXPECT_FLOAT_EQ(bottom.BoundingBox().max.z, 0.5);
+}
+
+TEST(Boolean, TrimByPlaneRelation) {
+  Manifold sphere = Manifold::Sphere(1, 16);
+  Manifold top = sphere.TrimByPlane({0.0f, 0.0f, 1.0f}, 0.5f);
+  EXPECT_TRUE(top.IsManifold());
+  EXPECT_TRUE(top.MatchesTriNormals());
+  EXPECT_EQ(top.Genus(), 0);
+
+  Mesh out = top.GetMesh();
+  for (const glm::vec3& v : out.vertPos) EXPECT_GT(v.z, 0.5 - top.Precision());
+  // The cap is a new mesh, lying in the plane.
+  MeshRelation relation = top.GetMeshRelation();
+  int numCap = 0;
+  for (int tri = 0; tri < top.NumTri(); ++tri) {
+    if (relation.triBary[tri].originalID == sphere.OriginalID()) continue;
+    ++numCap;
+    for (int j : {0, 1, 2})
+      EXPECT_NEAR(out.vertPos[out.triVerts[tri][j]].z, 0.5, top.Precision());
+  }
+  EXPECT_GT(numCap, 0);
+
+  std::pair<Manifold, Manifold> splits =
+      sphere.SplitByPlane({0.0f, 0.0f, 1.0f}, 0.5f);
+  EXPECT_NEAR(splits.first.GetProperties().volume +
+                  splits.second.GetProperties().volume,
+              sphere.GetProperties().volume, 1e-5);
+}
+
+TEST(Manifold, Slices) {
+  Manifold cube = Manifold::Cube(glm::vec3(2.0f), true);
+  Manifold shape = cube - Manifold::Cube(glm::vec3(1.0f), true);
+  const std::vector<Polygons> slices = shape.Slices({0.75f, 0.0f, 5.0f});
+  ASSERT_EQ(slices.size(), 3);
+  EXPECT_EQ(slices[0].size(), 1);
+  EXPECT_EQ(slices[1].size(), 2);
+  EXPECT_EQ(slices[2].size(), 0);
+
+  for (int i : {0, 1}) {
+    Real area = 0;
+    for (const SimplePolygon& poly : slices[i]) {
+      for (int j = 0; j < poly.size(); ++j) {
+        const glm::vec2 v0 = poly[j].pos;
+        const glm::vec2 v1 = poly[(j + 1) % poly.size()].pos;
+        area += (v0.x * v1.y - v1.x * v0.y) / 2;
+      }
+    }
+    EXPECT_NEAR(area, i == 0 ? 4 : 3, 1e-5);
+  }
+  EXPECT_NEAR(Manifold::Extrude(slices[1], 1).GetProperties().volume, 3,
+              1e-5);
+}
+
 /**
  * This tests that non-intersecting geometry is properly retained.
  */
@@ -1084,3 +1495,725 @@ TEST(Boolean, UnionDifference) {
   float blocksize = block.GetProperties().volume;
   EXPECT_NEAR(resultsize, blocksize * 2, 0.0001);
 }
+
+TEST(Boolean, BatchBoolean) {
+  std::vector<Manifold> cubes;
+  for (int i = 0; i < 21; ++i) {
+    cubes.push_back(Manifold::Cube().Translate({0.5f * i, 0, 0}));
+  }
+  Manifold result = Manifold::BatchBoolean(cubes, Manifold::OpType::ADD);
+  EXPECT_TRUE(result.IsManifold());
+  EXPECT_EQ(result.Genus(), 0);
+  auto prop = result.GetProperties();
+  EXPECT_NEAR(prop.volume, 11, 0.001);
+  EXPECT_NEAR(prop.surfaceArea, 4 * 11 + 2, 0.01);
+
+  result = Manifold::BatchBoolean(cubes, Manifold::OpType::INTERSECT);
+  EXPECT_TRUE(result.IsEmpty());
+}
+
+TEST(Boolean, BatchUnionClusters) {
+  std::vector<Manifold> parts;
+  for (int i = 0; i < 10; ++i) {
+    for (int j = 0; j < 10; ++j) {
+      const glm::vec3 offset(3.0f * i, 3.0f * j, 0);
+      parts.push_back(Manifold::Cube().Translate(offset));
+      parts.push_back(Manifold::Cube().Translate(offset + glm::vec3(0.5f)));
+    }
+  }
+  Manifold result = Manifold::BatchBoolean(parts, Manifold::OpType::ADD);
+  EXPECT_TRUE(result.IsManifold());
+  EXPECT_EQ(result.Decompose().size(), 100);
+  auto prop = result.GetProperties();
+  EXPECT_NEAR(prop.volume, 100 * (2 - 0.125), 0.01);
+}
+
+TEST(Boolean, BatchDifference) {
+  Manifold plate = Manifold::Cube({10, 10, 1});
+  std::vector<Manifold> tools = {plate};
+  for (int i = 0; i < 5; ++i) {
+    for (int j = 0; j < 5; ++j) {
+      tools.push_back(Manifold::Cube({1, 1, 3})
+                          .Translate({2.0f * i + 0.5f, 2.0f * j + 0.5f, -1}));
+    }
+  }
+  // these miss the plate entirely
+  for (int i = 0; i < 5; ++i) {
+    tools.push_back(Manifold::Cube().Translate({2.0f * i, 20, 0}));
+  }
+  Manifold result = Manifold::BatchBoolean(tools, Manifold::OpType::SUBTRACT);
+  EXPECT_TRUE(result.IsManifold());
+  EXPECT_EQ(result.Genus(), 25);
+  EXPECT_NEAR(result.GetProperties().volume, 100 - 25, 0.001);
+
+  tools.push_back(Manifold::Cube().Translate({20, 20, 20}));
+  result = Manifold::BatchBoolean(tools, Manifold::OpType::INTERSECT);
+  EXPECT_TRUE(result.IsEmpty());
+}
+
+TEST(Boolean, BooleanBatch) {
+  Manifold cube = Manifold::Cube({2, 2, 2}, true);
+  Manifold cylinder = Manifold::Cylinder(3, 0.5, -1, 32, true);
+  std::vector<std::tuple<Manifold, Manifold, Manifold::OpType>> jobs;
+  for (int i = 0; i < 16; ++i) {
+    jobs.push_back(std::make_tuple(cube, cylinder.Translate({0.1f * i, 0, 0}),
+                                   static_cast<Manifold::OpType>(i % 3)));
+  }
+  std::vector<Manifold> results = Manifold::BooleanBatch(jobs);
+  ASSERT_EQ(results.size(), jobs.size());
+  for (int i = 0; i < jobs.size(); ++i) {
+    const Manifold& first = std::get<0>(jobs[i]);
+    const Manifold& second = std::get<1>(jobs[i]);
+    Manifold expected = first.Boolean(second, std::get<2>(jobs[i]));
+    EXPECT_TRUE(results[i].IsManifold());
+    EXPECT_EQ(results[i].NumTri(), expected.NumTri());
+    EXPECT_NEAR(results[i].GetProperties().volume,
+                expected.GetProperties().volume, 1e-5);
+  }
+}
+
+TEST(Boolean, EvaluateAsync) {
+  auto tree = []() {
+    Manifold result;
+    for (int i = 0; i < 4; ++i) {
+      Manifold block = Manifold::Cube({2, 2, 2}, true) -
+                       Manifold::Cylinder(3, 0.5, -1, 32, true);
+      result += block.Translate({3.0f * i, 0, 0});
+    }
+    return result - Manifold::Cube({20, 1, 1}, true);
+  };
+  const float volume = tree().GetProperties().volume;
+
+  int calls = 0;
+  int lastDone = 0;
+  Manifold result = tree()
+                        .EvaluateAsync([&](int done, int total) {
+                          ++calls;
+                          EXPECT_LE(done, total);
+                          EXPECT_GE(done, lastDone);
+                          lastDone = done;
+                          return true;
+                        })
+                        .get();
+  EXPECT_GT(calls, 0);
+  EXPECT_TRUE(result.IsManifold());
+  EXPECT_NEAR(result.GetProperties().volume, volume, 1e-5);
+
+  Manifold cancelled = tree();
+  auto future = cancelled.EvaluateAsync([](int, int) { return false; });
+  EXPECT_THROW(future.get(), cancelErr);
+  // the partially evaluated tree can still be evaluated
+  EXPECT_NEAR(cancelled.GetProperties().volume, volume, 1e-5);
+}
+
+TEST(Boolean, Cache) {
+  Manifold::SetCacheBudget(1 << 26);
+  auto bracket = []() {
+    Manifold plate = Manifold::Cube({4, 2, 0.5});
+    Manifold boss = Manifold::Cylinder(2, 0.6).Translate({1, 1, 0});
+    return (plate + boss) - Manifold::Cylinder(3, 0.3).Translate({1, 1, -0.5});
+  };
+  Manifold first = bracket();
+  const float volume = first.GetProperties().volume;
+  CacheStats stats = Manifold::GetCacheStats();
+  EXPECT_EQ(stats.hits, 0);
+  EXPECT_GT(stats.entries, 0);
+
+  Manifold second = bracket();
+  EXPECT_NEAR(second.GetProperties().volume, volume, 1e-5);
+  EXPECT_EQ(Manifold::GetCacheStats().hits, 1);
+  EXPECT_TRUE(second.IsManifold());
+
+  // the relation must refer to the meshes of the second tree
+  std::set<int> originalIDs;
+  for (const BaryRef& ref : second.GetMeshRelation().triBary) {
+    originalIDs.insert(ref.originalID);
+  }
+  for (const BaryRef& ref : first.GetMeshRelation().triBary) {
+    EXPECT_EQ(originalIDs.count(ref.originalID), 0);
+  }
+
+  // results computed in the other predicate mode are not reused
+  Manifold::SetRobustPredicates(true);
+  Manifold robust = bracket();
+  EXPECT_NEAR(robust.GetProperties().volume, volume, 1e-5);
+  Manifold::SetRobustPredicates(false);
+  EXPECT_EQ(Manifold::GetCacheStats().hits, 1);
+
+  Manifold::ClearCache();
+  EXPECT_EQ(Manifold::GetCacheStats().entries, 0);
+  Manifold::SetCacheBudget(0);
+}
+
+TEST(Boolean, Incremental) {
+  Manifold::SetCacheBudget(1 << 26);
+  std::vector<Manifold> parts;
+  for (int i = 0; i < 4; ++i) {
+    parts.push_back(Manifold::Cube().Translate({3.0f * i, 0, 0}));
+    parts.push_back(Manifold::Cube().Translate({3.0f * i + 0.5f, 0.5f, 0.5f}));
+  }
+  Manifold first = Manifold::BatchBoolean(parts, Manifold::OpType::ADD);
+  EXPECT_EQ(first.ChangedChildren().size(), parts.size());
+  EXPECT_NEAR(first.GetProperties().volume, 4 * 1.875, 0.001);
+  EXPECT_TRUE(first.ChangedChildren().empty());
+
+  parts[0] = parts[0].Translate({0.1f, 0, 0});
+  Manifold second = Manifold::BatchBoolean(parts, Manifold::OpType::ADD);
+  std::vector<int> changed = second.ChangedChildren();
+  ASSERT_EQ(changed.size(), 1);
+  EXPECT_EQ(changed[0], 0);
+
+  const size_t hits = Manifold::GetCacheStats().hits;
+  EXPECT_NEAR(second.GetProperties().volume, 3 * 1.875 + 1.85, 0.001);
+  // the three untouched clusters are reused
+  EXPECT_EQ(Manifold::GetCacheStats().hits, hits + 3);
+  EXPECT_TRUE(second.IsManifold());
+
+  Manifold::ClearCache();
+  Manifold::SetCacheBudget(0);
+}
+
+TEST(Boolean, MemoryBudget) {
+  Manifold sphere = Manifold::Sphere(1, 128);
+  Manifold offset = sphere.Translate({0.5, 0, 0});
+  MemoryUsage usage = sphere.GetMemoryUsage();
+  EXPECT_GE(usage.vertPos, sphere.NumVert() * sizeof(glm::vec3));
+  EXPECT_GT(usage.halfedge, 0);
+  EXPECT_GT(usage.collider, 0);
+  EXPECT_GE(MemoryInUse(), usage.Total());
+  EXPECT_EQ(offset.NumTri(), sphere.NumTri());
+
+  Manifold::SetCacheBudget(1 << 26);
+  EXPECT_GT((Manifold::Cube() - Manifold::Sphere(0.5)).NumTri(), 0);
+  EXPECT_GT(Manifold::GetCacheStats().entries, 0);
+
+  SetMemoryBudget(MemoryInUse() + 1024);
+  EXPECT_THROW((sphere - offset).NumTri(), memoryErr);
+  // the cache was evicted before giving up
+  EXPECT_EQ(Manifold::GetCacheStats().entries, 0);
+  SetMemoryBudget(0);
+  Manifold::SetCacheBudget(0);
+
+  Manifold result = sphere - offset;
+  EXPECT_TRUE(result.IsManifold());
+  EXPECT_GT(result.NumTri(), 0);
+}
+
+TEST(Boolean, Compact) {
+  const Manifold sphere = Manifold::Sphere(1, 64);
+  const Manifold cube = Manifold::Cube(glm::vec3(1.2f), true);
+  const Manifold compact = sphere.Compact();
+  EXPECT_TRUE(compact.IsCompact());
+  EXPECT_FALSE(sphere.IsCompact());
+
+  const MemoryUsage full = sphere.GetMemoryUsage();
+  const MemoryUsage cold = compact.GetMemoryUsage();
+  EXPECT_EQ(cold.vertNormal, 0);
+  EXPECT_EQ(cold.faceNormal, 0);
+  EXPECT_EQ(cold.collider, 0);
+  EXPECT_EQ(2 * cold.halfedge, full.halfedge);
+  EXPECT_LT(cold.Total(), full.Total());
+
+  // queries answered from the fields kept in the compact form
+  EXPECT_FALSE(compact.IsEmpty());
+  EXPECT_EQ(compact.Status(), Manifold::Error::NO_ERROR);
+  EXPECT_EQ(compact.NumVert(), sphere.NumVert());
+  EXPECT_EQ(compact.NumTri(), sphere.NumTri());
+  EXPECT_EQ(compact.Genus(), 0);
+  EXPECT_EQ(compact.Precision(), sphere.Precision());
+  EXPECT_EQ(compact.BoundingBox().min, sphere.BoundingBox().min);
+  EXPECT_EQ(compact.BoundingBox().max, sphere.BoundingBox().max);
+  const Properties props = compact.GetProperties();
+  EXPECT_FLOAT_EQ(props.volume, sphere.GetProperties().volume);
+  EXPECT_FLOAT_EQ(props.surfaceArea, sphere.GetProperties().surfaceArea);
+  EXPECT_GT(props.volume, 4);
+
+  // lossless: the mesh and Booleans are unchanged, and it stays compact
+  Identical(compact.GetMesh(), sphere.GetMesh());
+  const Manifold expected = sphere - cube.Translate(glm::vec3(0.5f));
+  const Manifold result = compact - cube.Translate(glm::vec3(0.5f));
+  EXPECT_EQ(result.NumTri(), expected.NumTri());
+  EXPECT_NEAR(result.GetProperties().volume, expected.GetProperties().volume,
+              1e-5);
+  EXPECT_EQ((compact + compact.Translate(glm::vec3(3, 0, 0))).NumTri(),
+            2 * sphere.NumTri());
+  EXPECT_TRUE(compact.IsCompact());
+
+  EXPECT_THROW(sphere.Compact(22), argumentErr);
+  EXPECT_THROW(sphere.Compact(-1), argumentErr);
+  const Manifold quantized = sphere.Compact(12);
+  EXPECT_TRUE(quantized.IsManifold());
+  EXPECT_GE(quantized.Precision(), 2.0f / 4095);
+  EXPECT_NEAR((quantized ^ cube).GetProperties().volume,
+              (sphere ^ cube).GetProperties().volume, 1e-2);
+}
+
+TEST(Boolean, Separate) {
+  Manifold shell =
+      Manifold::Cube({4, 4, 4}, true) - Manifold::Cube({3, 3, 3}, true);
+  Manifold inner = Manifold::Sphere(1, 32);
+  Manifold apart = inner.Translate({10, 0, 0});
+  const int numShell = shell.NumTri();
+  const int numInner = inner.NumTri();
+  const float volShell = shell.GetProperties().volume;
+  const float volInner = inner.GetProperties().volume;
+
+  // bounding boxes apart
+  EXPECT_EQ((shell + apart).NumTri(), numShell + numInner);
+  EXPECT_EQ((shell - apart).NumTri(), numShell);
+  EXPECT_TRUE((shell ^ apart).IsEmpty());
+
+  // bounding boxes overlap, but the surfaces don't
+  Manifold both = shell + inner;
+  EXPECT_EQ(both.NumTri(), numShell + numInner);
+  EXPECT_NEAR(both.GetProperties().volume, volShell + volInner, 1e-3);
+  EXPECT_EQ((shell - inner).NumTri(), numShell);
+  EXPECT_TRUE((shell ^ inner).IsEmpty());
+
+  // one inside the other
+  Manifold block = Manifold::Cube({3, 3, 3}, true);
+  EXPECT_EQ((block + inner).NumTri(), block.NumTri());
+  EXPECT_EQ((block ^ inner).NumTri(), numInner);
+  EXPECT_TRUE((inner - block).IsEmpty());
+  Manifold hollow = block - inner;
+  EXPECT_TRUE(hollow.IsManifold());
+  EXPECT_NEAR(hollow.GetProperties().volume, 27 - volInner, 1e-3);
+}
+
+// The components of one mesh lie on both sides of the other, so neither is
+// kept or dropped whole.
+TEST(Boolean, SeparateComponents) {
+  Manifold block = Manifold::Cube({3, 3, 3}, true);
+  Manifold cube = Manifold::Cube({1, 1, 1}, true);
+  Manifold straddle = Manifold::Compose({cube, cube.Translate({10, 0, 0})});
+
+  Manifold outside = straddle - block;
+  EXPECT_EQ(outside.NumTri(), cube.NumTri());
+  EXPECT_NEAR(outside.GetProperties().volume, 1, 1e-5);
+  EXPECT_FLOAT_EQ(outside.BoundingBox().min.x, 9.5);
+
+  Manifold inside = straddle ^ block;
+  EXPECT_EQ(inside.NumTri(), cube.NumTri());
+  EXPECT_NEAR(inside.GetProperties().volume, 1, 1e-5);
+  EXPECT_FLOAT_EQ(inside.BoundingBox().max.x, 0.5);
+
+  EXPECT_NEAR((block + straddle).GetProperties().volume, 28, 1e-5);
+  Manifold hollow = block - straddle;
+  EXPECT_TRUE(hollow.IsManifold());
+  EXPECT_NEAR(hollow.GetProperties().volume, 26, 1e-5);
+}
+
+TEST(Boolean, MemoryPool) {
+  const float* freed;
+  {
+    MemoryPoolScope scope;
+    VecDH<float> a(1000);
+    freed = a.cptrH();
+    a = VecDH<float>();
+    // a freed block is reused for the next allocation of its size class
+    VecDH<float> b(990);
+    EXPECT_EQ(b.cptrH(), freed);
+  }
+  EXPECT_EQ(MemoryResource::Current(), MemoryResource::Base());
+
+  Manifold result = Manifold::Cube() - Manifold::Sphere(0.6f, 32);
+  EXPECT_TRUE(result.IsManifold());
+  Manifold result2 = result ^ Manifold::Cube(glm::vec3(0.5f));
+  EXPECT_TRUE(result2.IsManifold());
+  EXPECT_EQ(MemoryResource::Current(), MemoryResource::Base());
+}
+
+TEST(Boolean, CopyOnWrite) {
+  VecDH<int> a(100, 1);
+  VecDH<int> b(a);
+  EXPECT_TRUE(b.IsShared());
+  EXPECT_EQ(b.cptrH(), a.cptrH());
+  // writing to a copy gives it a buffer of its own
+  b[0] = 2;
+  EXPECT_FALSE(a.IsShared());
+  EXPECT_NE(b.cptrH(), a.cptrH());
+  EXPECT_EQ(a.cptrH()[0], 1);
+  EXPECT_EQ(b.cptrH()[0], 2);
+  b.resize(10);
+  EXPECT_EQ(a.size(), 100);
+
+  Manifold sphere = Manifold::Sphere(1, 32);
+  const float volume = sphere.GetProperties().volume;
+  Manifold warped = sphere.Warp([](glm::vec3& v) { v.z *= 2; });
+  EXPECT_NEAR(warped.GetProperties().volume, 2 * volume, 1e-4);
+  EXPECT_NEAR(sphere.GetProperties().volume, volume, 1e-5);
+  EXPECT_EQ(warped.NumTri(), sphere.NumTri());
+  EXPECT_TRUE(warped.IsManifold());
+}
+
+TEST(Boolean, PolicyThresholds) {
+  const PolicyThresholds defaults = GetPolicyThresholds();
+  EXPECT_EQ(autoPolicy(100, KernelCost::Heavy), ExecutionPolicy::Seq);
+  const float volume =
+      (Manifold::Cube() - Manifold::Sphere(0.6f, 32)).GetProperties().volume;
+
+  PolicyThresholds parallel;
+  for (int i = 0; i < PolicyThresholds::kNumCost; ++i) parallel.seqMax[i] = 0;
+  SetPolicyThresholds(parallel);
+  EXPECT_EQ(autoPolicy(100, KernelCost::Heavy), ExecutionPolicy::Par);
+  Manifold result = Manifold::Cube() - Manifold::Sphere(0.6f, 32);
+  EXPECT_TRUE(result.IsManifold());
+  EXPECT_NEAR(result.GetProperties().volume, volume, 1e-5);
+
+  SetPolicyThresholds(defaults);
+  EXPECT_EQ(autoPolicy(100, KernelCost::Heavy), ExecutionPolicy::Seq);
+}
+
+TEST(Boolean, SetPolicyThresholdsConcurrent) {
+  const PolicyThresholds defaults = GetPolicyThresholds();
+  const float volume =
+      (Manifold::Cube() - Manifold::Sphere(0.6f, 32)).GetProperties().volume;
+
+  // Booleans keep reading the thresholds while another thread replaces them.
+  PolicyThresholds parallel;
+  for (int i = 0; i < PolicyThresholds::kNumCost; ++i) parallel.seqMax[i] = 0;
+  std::thread toggle([&defaults, &parallel]() {
+    for (int i = 0; i < 100; ++i)
+      SetPolicyThresholds(i % 2 == 0 ? parallel : defaults);
+  });
+  for (int i = 0; i < 4; ++i) {
+    Manifold result = Manifold::Cube() - Manifold::Sphere(0.6f, 32);
+    EXPECT_NEAR(result.GetProperties().volume, volume, 1e-5);
+  }
+  toggle.join();
+
+  const PolicyThresholds current = GetPolicyThresholds();
+  for (int i = 0; i < PolicyThresholds::kNumCost; ++i) {
+    EXPECT_EQ(current.seqMax[i], defaults.seqMax[i]);
+    EXPECT_EQ(current.parMax[i], defaults.parMax[i]);
+  }
+  SetPolicyThresholds(defaults);
+}
+
+TEST(Boolean, MaxThreads) {
+  const int defaultThreads = MaxThreads();
+  EXPECT_GE(defaultThreads, 1);
+  const float volume =
+      (Manifold::Cube() - Manifold::Sphere(0.6f, 32)).GetProperties().volume;
+
+  SetMaxThreads(1);
+  EXPECT_EQ(MaxThreads(), 1);
+  Manifold result = Manifold::Cube() - Manifold::Sphere(0.6f, 32);
+  EXPECT_NEAR(result.GetProperties().volume, volume, 1e-5);
+
+  SetMaxThreads(0);
+  EXPECT_EQ(MaxThreads(), defaultThreads);
+}
+
+TEST(Boolean, CudaDeviceRange) {
+  EXPECT_THROW(SetCudaDevice(NumCudaDevices()), argumentErr);
+  SetCudaDevice(-1);
+  if (NumCudaDevices() > 0) SetCudaDevice(0);
+  SetCudaDevice(-1);
+}
+
+TEST(Boolean, Stats) {
+  Manifold::ResetBooleanStats();
+  Manifold result = Manifold::Cube() - Manifold::Sphere(0.6f, 32);
+  EXPECT_EQ(Manifold::GetBooleanStats().numBoolean, 0);  // not yet evaluated
+  const int numTri = result.NumTri();
+
+  const BooleanStats stats = Manifold::GetBooleanStats();
+  EXPECT_EQ(stats.numBoolean, 1);
+  EXPECT_EQ(stats.numTri, static_cast<size_t>(numTri));
+  EXPECT_GT(stats.p1q2 + stats.p2q1, 0);
+  EXPECT_GT(stats.x12 + stats.x21, 0);
+  EXPECT_GT(stats.bytesRequested, 0);
+  EXPECT_LE(stats.bytesAllocated, stats.bytesRequested);
+  EXPECT_GT(stats.TotalSeconds(), 0);
+  EXPECT_EQ(stats.maxSeconds, stats.TotalSeconds());
+
+  // the result carries the stats of its own operation
+  const BooleanStats own = result.GetResultStats();
+  EXPECT_EQ(own.numBoolean, 1);
+  EXPECT_EQ(own.numTri, static_cast<size_t>(numTri));
+  EXPECT_EQ(own.p1q2 + own.p2q1, stats.p1q2 + stats.p2q1);
+  EXPECT_EQ(Manifold::Cube().GetResultStats().numBoolean, 0);
+  // and of those of its operands
+  Manifold nested = result - Manifold::Sphere(0.3f, 16).Translate({1, 1, 1});
+  EXPECT_EQ(nested.GetResultStats().numBoolean, 2);
+
+  // Split() takes two results of a single operation
+  Manifold::ResetBooleanStats();
+  Manifold::Cube().Split(Manifold::Sphere(0.6f, 32));
+  EXPECT_EQ(Manifold::GetBooleanStats().numBoolean, 1);
+
+  Manifold::ResetBooleanStats();
+  EXPECT_EQ(Manifold::GetBooleanStats().numBoolean, 0);
+}
+
+TEST(Boolean, Trace) {
+  const Manifold cube = Manifold::Cube();
+  const Manifold sphere = Manifold::Sphere(0.6f, 32);
+  Manifold result = cube - sphere;
+  result += cube.Translate(glm::vec3(3, 0, 0)) +
+            cube.Translate(glm::vec3(0, 3, 0));
+
+  Manifold::StartTrace();
+  EXPECT_GT(result.NumTri(), 0);
+  EXPECT_GT(sphere.Refine(2).NumTri(), sphere.NumTri());
+  const std::string trace = Manifold::StopTrace();
+  EXPECT_EQ(trace.find("{\"displayTimeUnit\""), 0);
+  for (const char* name :
+       {"\"CsgOpNode\"", "\"BatchUnion\"", "\"Compose\"", "\"Boolean3\"",
+        "\"Boolean3::Result\"", "\"Finish\"", "\"Refine\""}) {
+    EXPECT_NE(trace.find(name), std::string::npos) << name;
+  }
+  EXPECT_NE(trace.find("\"op\":\"difference\""), std::string::npos);
+  EXPECT_NE(trace.find("\"numVertP\":"), std::string::npos);
+
+  // nothing is recorded once stopped
+  EXPECT_GT((cube + sphere).NumTri(), 0);
+  EXPECT_EQ(Manifold::StopTrace().find("\"ph\""), std::string::npos);
+}
+
+TEST(Boolean, ParallelFace2Tri) {
+  // Intersecting finely tessellated spheres creates many faces with more than
+  // four edges; their triangulation must not depend on the execution policy.
+  const Manifold sphere = Manifold::Sphere(1, 128);
+  const Manifold sphere2 = sphere.Translate(glm::vec3(0.5f)).Rotate(10, 20);
+  const Mesh serial = (sphere - sphere2).GetMesh();
+
+  const PolicyThresholds defaults = GetPolicyThresholds();
+  PolicyThresholds parallel;
+  for (int i = 0; i < PolicyThresholds::kNumCost; ++i) parallel.seqMax[i] = 0;
+  SetPolicyThresholds(parallel);
+  const Mesh concurrent = (sphere - sphere2).GetMesh();
+  SetPolicyThresholds(defaults);
+
+  Identical(serial, concurrent);
+}
+
+TEST(Boolean, ParallelSimplifyTopology) {
+  // Each sphere-sphere intersection creates many redundant edges to collapse.
+  const Manifold sphere = Manifold::Sphere(1, 128);
+  const Manifold sphere2 = sphere.Translate(glm::vec3(0.3f, 0.2f, 0.1f));
+  const Manifold serial = sphere + sphere2;
+  const Properties serialProp = serial.GetProperties();
+
+  const PolicyThresholds defaults = GetPolicyThresholds();
+  PolicyThresholds parallel;
+  for (int i = 0; i < PolicyThresholds::kNumCost; ++i) parallel.seqMax[i] = 0;
+  SetPolicyThresholds(parallel);
+  const Manifold concurrent = sphere + sphere2;
+  const Properties prop = concurrent.GetProperties();
+  EXPECT_TRUE(concurrent.IsManifold());
+  EXPECT_EQ(concurrent.Genus(), serial.Genus());
+  // deterministic
+  EXPECT_EQ((sphere + sphere2).NumTri(), concurrent.NumTri());
+  SetPolicyThresholds(defaults);
+
+  EXPECT_NEAR(prop.volume, serialProp.volume, 1e-4);
+  EXPECT_NEAR(prop.surfaceArea, serialProp.surfaceArea, 1e-4);
+}
+
+TEST(Boolean, ParallelCollapseShared) {
+  // AsOriginal() collapses the coplanar edges of a copy whose buffers are
+  // still shared with the original, which must be left untouched.
+  Manifold cubes = Manifold::Cube();
+  for (int i = 1; i < 8; ++i)
+    cubes += Manifold::Cube().Translate(glm::vec3(0.5f * i, 0.25f * i, 0));
+  const Mesh before = cubes.GetMesh();
+
+  const PolicyThresholds defaults = GetPolicyThresholds();
+  PolicyThresholds parallel;
+  for (int i = 0; i < PolicyThresholds::kNumCost; ++i) parallel.seqMax[i] = 0;
+  SetPolicyThresholds(parallel);
+  const Manifold original = cubes.AsOriginal();
+  SetPolicyThresholds(defaults);
+
+  EXPECT_TRUE(original.IsManifold());
+  EXPECT_LT(original.NumTri(), cubes.NumTri());
+  EXPECT_NEAR(original.GetProperties().volume, cubes.GetProperties().volume,
+              1e-5);
+  EXPECT_TRUE(cubes.IsManifold());
+  Identical(cubes.GetMesh(), before);
+}
+
+TEST(Boolean, RadixSort) {
+  // Large enough for several blocks, with repeated keys to check stability.
+  const int n = 100000;
+  std::mt19937 gen(12345);
+  std::uniform_int_distribution<int> dist(-5000, 5000);
+  std::vector<int> keys(n);
+  std::vector<int64_t> wideKeys(n);
+  for (int i = 0; i < n; ++i) {
+    keys[i] = dist(gen);
+    wideKeys[i] = keys[i] * (int64_t(1) << 33) + (i & 0xFF);
+  }
+  std::vector<std::pair<int, int>> expected(n);
+  for (int i = 0; i < n; ++i) expected[i] = {keys[i], i};
+  std::stable_sort(expected.begin(), expected.end(),
+                   [](const std::pair<int, int>& a,
+                      const std::pair<int, int>& b) {
+                     return a.first < b.first;
+                   });
+
+  std::vector<int> values(n);
+  for (int i = 0; i < n; ++i) values[i] = i;
+  stable_sort_by_key(ExecutionPolicy::Par, keys.begin(), keys.end(),
+                     values.begin());
+  for (int i = 0; i < n; ++i) {
+    ASSERT_EQ(keys[i], expected[i].first);
+    ASSERT_EQ(values[i], expected[i].second);
+  }
+
+  std::vector<int64_t> sortedWide(wideKeys);
+  std::sort(sortedWide.begin(), sortedWide.end());
+  sort(ExecutionPolicy::Par, wideKeys.begin(), wideKeys.end());
+  EXPECT_EQ(wideKeys, sortedWide);
+}
+
+TEST(Boolean, RefitCollider) {
+  // Stretching and twisting a sphere degrades its refit collider until it is
+  // rebuilt; either way the collisions, and so the result, must not change.
+  const Manifold warped =
+      Manifold::Sphere(1, 64).Warp([](glm::vec3& v) {
+        v.x *= 10;
+        const float angle = 3 * v.z;
+        v = glm::vec3(v.x * glm::cos(angle) - v.y * glm::sin(angle),
+                      v.x * glm::sin(angle) + v.y * glm::cos(angle), v.z);
+      });
+  const Manifold rebuilt(warped.GetMesh());
+  const Manifold cube = Manifold::Cube(glm::vec3(4), true);
+  for (int i = 0; i < 8; ++i) {
+    const float angle = 40.0f * i;
+    const Manifold moved = warped.Rotate(angle, 2 * angle, 3 * angle);
+    const Manifold expected =
+        rebuilt.Rotate(angle, 2 * angle, 3 * angle) - cube;
+    const Manifold result = moved - cube;
+    EXPECT_TRUE(result.IsManifold());
+    EXPECT_NEAR(result.GetProperties().volume,
+                expected.GetProperties().volume, 1e-3);
+  }
+}
+
+TEST(Boolean, PendingTransforms) {
+  // Booleans are evaluated in the frame of one operand, leaving its transform
+  // pending; the results must match those of pre-transformed operands.
+  const Manifold part = Manifold::Sphere(1, 32) - Manifold::Cube(glm::vec3(1));
+  std::vector<Manifold> instances;
+  std::vector<Manifold> baked;
+  for (int i = 0; i < 6; ++i) {
+    instances.push_back(
+        part.Rotate(0, 0, 50.0f * i).Translate(glm::vec3(1.2f * i, 0, 0)));
+    baked.push_back(Manifold(instances.back().GetMesh()));
+  }
+  const Manifold result =
+      Manifold::BatchBoolean(instances, Manifold::OpType::ADD);
+  const Manifold expected =
+      Manifold::BatchBoolean(baked, Manifold::OpType::ADD);
+  EXPECT_TRUE(result.IsManifold());
+  EXPECT_EQ(result.Genus(), expected.Genus());
+  EXPECT_NEAR(result.GetProperties().volume,
+              expected.GetProperties().volume, 1e-3);
+
+  // flattening the union gives both overlapping operands the same transform,
+  // so neither is copied
+  const Manifold other = Manifold::Cube(glm::vec3(1)).Translate(glm::vec3(20));
+  const Manifold shared =
+      (baked[0] + baked[1]).Scale(glm::vec3(2, 1, 1)).Rotate(10, 20, 30) +
+      other;
+  const Manifold sharedBaked =
+      Manifold((baked[0] + baked[1]).GetMesh())
+          .Scale(glm::vec3(2, 1, 1))
+          .Rotate(10, 20, 30) +
+      other;
+  EXPECT_TRUE(shared.IsManifold());
+  EXPECT_NEAR(shared.GetProperties().volume,
+              sharedBaked.GetProperties().volume, 1e-3);
+  EXPECT_NEAR(shared.BoundingBox().min.x, sharedBaked.BoundingBox().min.x,
+              1e-4);
+}
+
+TEST(Boolean, RobustPredicates) {
+  // Nearly coincident surfaces put many comparisons within float rounding of
+  // a tie, which robust mode then decides in double.
+  const Manifold sphere = Manifold::Sphere(1, 64);
+  const Manifold nearly = sphere.Rotate(1e-3f, 2e-3f, 3e-3f);
+  const Manifold cube = Manifold::Cube(glm::vec3(1));
+  const Manifold nearCube = cube.Translate(glm::vec3(1e-6f, 0, 0));
+
+  const Manifold diff = sphere - nearly;
+  const Manifold sum = cube + nearCube;
+  EXPECT_FALSE(Manifold::RobustPredicates());
+  Manifold::SetRobustPredicates(true);
+  const Manifold robustDiff = sphere - nearly;
+  const Manifold robustSum = cube + nearCube;
+  EXPECT_TRUE(robustDiff.IsManifold());
+  EXPECT_TRUE(robustSum.IsManifold());
+  Manifold::SetRobustPredicates(false);
+
+  // The coplanar faces of the cubes make exact ties, which only robust mode
+  // re-evaluates.
+  EXPECT_GT(robustSum.GetResultStats().robustTies, 0);
+  EXPECT_EQ(sum.GetResultStats().robustTies, 0);
+
+  EXPECT_NEAR(robustDiff.GetProperties().volume, diff.GetProperties().volume,
+              1e-3);
+  EXPECT_NEAR(robustSum.GetProperties().volume, sum.GetProperties().volume,
+              1e-4);
+}
+
+TEST(Manifold, CollisionScene) {
+  // A row of spheres where each touches its neighbors, plus an empty one.
+  std::vector<Manifold> manifolds;
+  for (int i = 0; i < 6; ++i)
+    manifolds.push_back(
+        Manifold::Sphere(1, 16).Translate(glm::vec3(1.5f * i, 0, 0)));
+  manifolds.push_back(Manifold());
+
+  const std::vector<OverlapPair> pairs = Manifold::Overlaps(manifolds);
+  int k = 0;
+  for (int i = 0; i < manifolds.size(); ++i) {
+    for (int j = i + 1; j < manifolds.size(); ++j) {
+      if (manifolds[i].IsEmpty() || manifolds[j].IsEmpty()) continue;
+      const int numOverlaps = manifolds[i].NumOverlaps(manifolds[j]);
+      if (numOverlaps == 0) continue;
+      ASSERT_LT(k, pairs.size());
+      EXPECT_EQ(pairs[k].first, i);
+      EXPECT_EQ(pairs[k].second, j);
+      EXPECT_EQ(pairs[k].numOverlaps, numOverlaps);
+      ++k;
+    }
+  }
+  EXPECT_EQ(k, pairs.size());
+  EXPECT_GE(k, 5);
+
+  const CollisionScene scene(manifolds);
+  EXPECT_EQ(scene.NumManifold(), 7);
+  // straddles the surface of the first sphere only
+  const Manifold query = Manifold::Cube(glm::vec3(0.5f), true)
+                             .Rotate(30, 40)
+                             .Translate(glm::vec3(0, 1, 0));
+  const std::vector<std::pair<int, int>> hits = scene.Query(query);
+  ASSERT_EQ(hits.size(), 1);
+  EXPECT_EQ(hits[0].first, 0);
+  EXPECT_EQ(hits[0].second, query.NumOverlaps(manifolds[0]));
+}
+
+TEST(Boolean, ParallelCollisions) {
+  // Enough edges for the queries to be split into several chunks.
+  const Manifold sphere = Manifold::Sphere(1, 64);
+  const Manifold sphere2 = sphere.Translate(glm::vec3(0.5f)).Rotate(10, 20);
+  const int serial = sphere.NumOverlaps(sphere2);
+  EXPECT_GT(serial, 0);
+
+  const PolicyThresholds defaults = GetPolicyThresholds();
+  PolicyThresholds parallel;
+  for (int i = 0; i < PolicyThresholds::kNumCost; ++i) parallel.seqMax[i] = 0;
+  SetPolicyThresholds(parallel);
+  const int concurrent = sphere.NumOverlaps(sphere2);
+  const Manifold result = sphere - sphere2;
+  SetPolicyThresholds(defaults);
+
+  EXPECT_EQ(concurrent, serial);
+  EXPECT_TRUE(result.IsManifold());
+  EXPECT_NEAR(result.GetProperties().volume,
+              (sphere - sphere2).GetProperties().volume, 1e-4);
+}
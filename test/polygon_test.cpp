@@ -3007,3 +3007,34 @@ TEST(Polygon, BigSponge) {
   });
   TestPoly(polys, 1771);
 }
+
+TEST(Polygon, ParallelGroups) {
+  // A grid of squares, each with a square hole holding a square island. The
+  // contours are regrouped by containment and the groups swept concurrently.
+  Polygons polys;
+  int idx = 0;
+  auto addSquare = [&](glm::vec2 center, float size, bool hole) {
+    SimplePolygon square;
+    for (const glm::vec2 corner : {glm::vec2(-1, -1), glm::vec2(1, -1),
+                                   glm::vec2(1, 1), glm::vec2(-1, 1)})
+      square.push_back({center + size * corner, idx++});
+    if (hole) std::reverse(square.begin(), square.end());
+    polys.push_back(square);
+  };
+  for (int i = 0; i < 8; ++i) {
+    for (int j = 0; j < 8; ++j) {
+      const glm::vec2 center(3 * i, 3 * j);
+      addSquare(center, 0.5, false);
+      addSquare(center, 1, true);
+      addSquare(center, 1.5, false);
+    }
+  }
+
+  const PolicyThresholds defaults = GetPolicyThresholds();
+  PolicyThresholds parallel;
+  for (int i = 0; i < PolicyThresholds::kNumCost; ++i) parallel.seqMax[i] = 0;
+  SetPolicyThresholds(parallel);
+  TestPoly(polys, 64 * 10);
+  SetPolicyThresholds(defaults);
+  TestPoly(polys, 64 * 10);
+}
@@ -40,6 +40,12 @@ struct Layers {
   }
 };
 
+struct Sphere {
+  __host__ __device__ float operator()(glm::vec3 p) const {
+    return 1 - glm::length(p);
+  }
+};
+
 TEST(SDF, CubeVoid) {
   CubeVoid voidSDF;
 
@@ -114,4 +120,71 @@ TEST(SDF, Resize) {
 
   EXPECT_EQ(layers.Status(), Manifold::Error::NO_ERROR);
   EXPECT_EQ(layers.Genus(), -8);
-}
\ No newline at end of file
+}
+
+TEST(SDF, Sparse) {
+  // The sphere is small relative to the grid, so most bricks are skipped, but
+  // the surface, including where it is closed off by the bounds, must match.
+  const Box bounds = {glm::vec3(-1.5f), glm::vec3(6)};
+  const float edgeLength = 0.1;
+  Manifold dense(LevelSet(Sphere(), bounds, edgeLength));
+  Manifold sparse(LevelSet(Sphere(), bounds, edgeLength, 0, 1));
+  Manifold voidDense(LevelSet(CubeVoid(), bounds, edgeLength));
+  Manifold voidSparse(LevelSet(CubeVoid(), bounds, edgeLength, 0, 1));
+
+  EXPECT_EQ(sparse.Status(), Manifold::Error::NO_ERROR);
+  EXPECT_EQ(sparse.NumTri(), dense.NumTri());
+  EXPECT_NEAR(sparse.GetProperties().volume, dense.GetProperties().volume,
+              1e-4);
+  EXPECT_EQ(voidSparse.Status(), Manifold::Error::NO_ERROR);
+  EXPECT_EQ(voidSparse.Genus(), voidDense.Genus());
+  EXPECT_EQ(voidSparse.NumTri(), voidDense.NumTri());
+  EXPECT_NEAR(voidSparse.GetProperties().volume,
+              voidDense.GetProperties().volume, 1e-3);
+}
+
+TEST(SDF, Tiled) {
+  // Small budgets force many tiles, whose boundary verts must be stitched.
+  const Box bounds = {glm::vec3(-1.5f), glm::vec3(1.5f)};
+  const float edgeLength = 0.05;
+  Manifold dense(LevelSet(Sphere(), bounds, edgeLength));
+  Manifold tiled(LevelSetTiled(Sphere(), bounds, edgeLength, 1 << 23));
+  Manifold sparse(LevelSetTiled(Sphere(), bounds, edgeLength, 1 << 23, 0, 1));
+
+  EXPECT_EQ(tiled.Status(), Manifold::Error::NO_ERROR);
+  EXPECT_EQ(tiled.Genus(), 0);
+  EXPECT_EQ(tiled.NumTri(), dense.NumTri());
+  EXPECT_NEAR(tiled.GetProperties().volume, dense.GetProperties().volume,
+              1e-4);
+  EXPECT_EQ(sparse.NumTri(), dense.NumTri());
+
+  int numTile = 0;
+  LevelSetTiled(Layers(), {glm::vec3(0), glm::vec3(20)}, 1, 1 << 20,
+                [&numTile](const Mesh&) { ++numTile; });
+  EXPECT_GT(numTile, 1);
+  Manifold layers(
+      LevelSetTiled(Layers(), {glm::vec3(0), glm::vec3(20)}, 1, 1 << 20));
+  EXPECT_EQ(layers.Status(), Manifold::Error::NO_ERROR);
+  EXPECT_EQ(layers.Genus(), -8);
+}
+
+TEST(SDF, Batch) {
+  const Box bounds = {glm::vec3(-1.5f), glm::vec3(1.5f)};
+  const float edgeLength = 0.05;
+  int numCall = 0;
+  const BatchSDF sphere = [&numCall](const glm::vec3* points,
+                                     float* distances, int n) {
+    ++numCall;
+    for (int i = 0; i < n; ++i) distances[i] = Sphere()(points[i]);
+  };
+  Manifold point(LevelSet(Sphere(), bounds, edgeLength));
+  Manifold batch(LevelSet(sphere, bounds, edgeLength));
+
+  EXPECT_EQ(batch.Status(), Manifold::Error::NO_ERROR);
+  EXPECT_EQ(batch.Genus(), 0);
+  EXPECT_EQ(batch.NumTri(), point.NumTri());
+  EXPECT_NEAR(batch.GetProperties().volume, point.GetProperties().volume,
+              1e-4);
+  EXPECT_GT(numCall, 0);
+  EXPECT_LT(numCall, 100);
+}